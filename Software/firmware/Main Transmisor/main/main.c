@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_adc/adc_oneshot.h"
@@ -9,7 +10,16 @@
 #include "driver/gpio.h"
 #include "rom/ets_sys.h"
 #include "driver/uart.h"
+#include "driver/spi_master.h"
+#include "esp_check.h"
 #include "esp_log.h"
+#include "esp_random.h"
+#include "sx127x.h"
+#include "sx127x_registers.h"
+#include "telemetria.h"
+#include "comandos.h"
+#include "politica.h"
+#include "anomalias.h"
 
 // --- DS18B20 OneWire ---
 #define DS18B20_GPIO 21
@@ -22,6 +32,8 @@
 
 #define VREF 3300.0
 #define ADC_MAX_READING 4095.0
+#define ADC_RIEL_MIN_MV 20   // por debajo o por encima el canal esta en un extremo del rango (11 dB): sonda
+#define ADC_RIEL_MAX_MV 3050 // suelta, en corto o fuera del agua
 
 // --- UART Defines  ---
 #define LORA_UART_NUM UART_NUM_1
@@ -32,10 +44,68 @@
 #define DEST_ADDR 2
 #define SRC_ADRR 1
 
+// --------Modo radio---------
+// 0: modulo LoRa por UART (comandos AT, texto). 1: SX127x directo por SPI, telemetria binaria con cabecera implicita
+#define MODO_RADIO 0
+#define RADIO_SPI_HOST SPI2_HOST
+#define RADIO_SCK GPIO_NUM_12
+#define RADIO_MISO GPIO_NUM_13
+#define RADIO_MOSI GPIO_NUM_11
+#define RADIO_CS GPIO_NUM_10
+#define RADIO_RST GPIO_NUM_9
+#define RADIO_DIO0 GPIO_NUM_8
+#define RADIO_SF SX127x_SF_12
+#define RADIO_BW SX127x_BW_125000
+#define RADIO_CR SX127x_CR_4_5
+#define RADIO_SYNCWORD 0x12
+// La telemetria va en su propio canal: una radio en modo implicito no puede recibir paquetes con cabecera
+// y viceversa, asi que el receptor dedica una radio a cada modo (ver gateway_radios en el receptor)
+#define CONTROL_FRECUENCIA 914900000    // cabecera explicita, mismo canal que el modo AT
+#define TELEMETRIA_FRECUENCIA 914700000 // cabecera implicita, TELEMETRIA_LEN bytes
+#define FORMATO_CADA_LECTURAS 100       // reenvia el anuncio de formato por si el receptor se reinicio
+#define TEXTO_LEN 43                    // "T:TEMP:25.00C,EC:1548.00,pH:7.00,TDS:300.00" del modo AT, para comparar
+#define TX_CORRIENTE_MA 120             // SX1276 a +20 dBm (datasheet)
+#define TX_VOLTAJE_MV 3300
+// Downlinks de comandos (comandos.h). Clase A: escucha una ventana tras la ultima lectura de cada lote, para
+// bateria. Clase C: escucha el canal de control entre lecturas, para nodos alimentados
+#define CLASE_NODO TELEMETRIA_CLASE_A
+#define PERIODO_DEFECTO_S 2
+#define PERIODO_DISPERSION_PCT 5 // azar en cada periodo para que dos nodos no queden transmitiendo a la vez
+#define SIMBOLO_US ((1000000UL << (RADIO_SF >> 4)) / 125000) // RADIO_BW
+
+// --------Modo sueno---------
+// 1: entre despertares el ESP32 duerme en sueno profundo y el ULP RISC-V toma las muestras del ADC cada periodo
+// (ulp/muestreo_ulp.c, muestreo.h). Los procesadores principales solo despiertan con un lote completo o una
+// muestra fuera de umbral, lo transmiten y vuelven a dormir; el lote, la configuracion y la secuencia siguen en
+// memoria RTC. La temperatura se convierte antes de dormir y se lee al despertar, una por despertar.
+// Necesita MODO_RADIO (el SX127x se duerme por SPI) y clase A (clase C escucha entre lecturas)
+#define MODO_SUENO 0
+
+#if MODO_SUENO && (!MODO_RADIO || CLASE_NODO != TELEMETRIA_CLASE_A)
+#error "MODO_SUENO necesita MODO_RADIO y CLASE_NODO clase A"
+#endif
+
+#if MODO_SUENO
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_private/adc_share_hw_ctrl.h"
+#include "esp_private/esp_clk.h"
+#include "soc/rtc.h"
+#include "soc/rtc_cntl_reg.h"
+#include "ulp_riscv.h"
+#include "ulp_main.h"
+#include "muestreo.h"
+#define RTC_SUENO RTC_DATA_ATTR
+#else
+#define RTC_SUENO
+#endif
+
 static const char *TAG = "LORA_TX";
 
 // ----------- Prototipos -----------
 float leer_temperatura_ds18b20(void);
+static bool ds18b20_convertir(void);
+static float ds18b20_leer(void);
 static float leer_adc_mV(adc_oneshot_unit_handle_t handle, adc_cali_handle_t cali, adc_channel_t canal);
 float calcular_ec(float, float);
 float calcular_ph(float, float);
@@ -81,9 +151,606 @@ void lorawan_uart_cmd(const char *cmd)
     }
 }
 
+#if MODO_RADIO
+static sx127x radio;
+static TaskHandle_t tarea_tx = NULL;
+static RTC_SUENO uint16_t secuencia = 0;
+// tiempo en el aire por lectura en cada formato; la configuracion no cambia, se calcula una vez
+static uint32_t toa_implicito_us = 0;
+static uint32_t toa_explicito_us = 0;
+static RTC_SUENO uint64_t ahorro_total_us = 0;
+static uint32_t toa_downlink_max_us = 0;
+// configuracion que cambian los downlinks
+static RTC_SUENO comandos_config_t config;
+static RTC_SUENO telemetria_lectura_t lote[COMANDOS_MAX_LOTE];
+static RTC_SUENO uint32_t lote_t[COMANDOS_MAX_LOTE]; // segundos desde el arranque de cada lectura
+static RTC_SUENO int lote_num = 0;
+static RTC_SUENO politica_t politica;
+static RTC_SUENO anomalias_t anomalias;
+static anomalias_config_t anomalias_config;
+// lo escribe rx_callback, que corre en sx127x_handle_interrupt desde la misma tarea
+static uint8_t downlink[COMANDOS_MAX_LEN];
+static uint16_t downlink_len = 0;
+
+// En MODO_SUENO solo la primera vez: al despertar siguen la configuracion, la secuencia y el lote
+static bool arranque_en_frio(void)
+{
+#if MODO_SUENO
+    return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UNDEFINED;
+#else
+    return true;
+#endif
+}
+
+static uint32_t energia_uj(uint64_t tiempo_us)
+{
+    return (uint32_t)(tiempo_us * TX_CORRIENTE_MA * TX_VOLTAJE_MV / 1000000ULL);
+}
+
+static void IRAM_ATTR radio_isr(void *arg)
+{
+    BaseType_t despertar = pdFALSE;
+    vTaskNotifyGiveFromISR(tarea_tx, &despertar);
+    portYIELD_FROM_ISR(despertar);
+}
+
+// Telemetria: cabecera implicita en TELEMETRIA_FRECUENCIA. Control: cabecera explicita en CONTROL_FRECUENCIA.
+// Los registros que no cambian no se reescriben (cache de la libreria), asi que repetir el modo es barato.
+static esp_err_t radio_modo(bool implicito)
+{
+    ESP_RETURN_ON_ERROR(sx127x_set_opmod(SX127x_MODE_STANDBY, SX127x_MODULATION_LORA, &radio), TAG, "standby");
+    if (implicito)
+    {
+        sx127x_implicit_header_t cabecera = {.length = TELEMETRIA_LEN, .enable_crc = true, .coding_rate = RADIO_CR};
+        ESP_RETURN_ON_ERROR(sx127x_set_frequency(TELEMETRIA_FRECUENCIA, &radio), TAG, "frecuencia");
+        return sx127x_lora_set_implicit_header(&cabecera, &radio);
+    }
+    sx127x_tx_header_t cabecera = {.enable_crc = true, .coding_rate = RADIO_CR};
+    ESP_RETURN_ON_ERROR(sx127x_set_frequency(CONTROL_FRECUENCIA, &radio), TAG, "frecuencia");
+    ESP_RETURN_ON_ERROR(sx127x_lora_set_implicit_header(NULL, &radio), TAG, "cabecera");
+    return sx127x_lora_tx_set_explicit_header(&cabecera, &radio);
+}
+
+// Transmite y espera TxDone en DIO0, con 100 ms de margen sobre el tiempo en el aire
+static esp_err_t radio_enviar(const uint8_t *datos, uint8_t len, uint32_t toa_us)
+{
+    ulTaskNotifyTake(pdTRUE, 0);
+    ESP_RETURN_ON_ERROR(sx127x_lora_tx_set_for_transmission(datos, len, &radio), TAG, "fifo");
+    ESP_RETURN_ON_ERROR(sx127x_set_opmod(SX127x_MODE_TX, SX127x_MODULATION_LORA, &radio), TAG, "tx");
+    bool enviado = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(toa_us / 1000 + 100)) > 0;
+    sx127x_handle_interrupt(&radio); // limpia las flags
+    return enviado ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+static void rx_callback(sx127x *device, uint8_t *data, uint16_t data_length)
+{
+    downlink_len = data_length > COMANDOS_MAX_LEN ? COMANDOS_MAX_LEN : data_length;
+    memcpy(downlink, data, downlink_len);
+}
+
+// RX continuo en el canal de control (radio_modo(false)) durante espera ticks. Si vence con un preambulo ya
+// detectado se espera el RxDone del downlink mas largo. Devuelve true si llego un downlink con CRC valido
+static bool radio_escuchar(TickType_t espera)
+{
+    downlink_len = 0;
+    ulTaskNotifyTake(pdTRUE, 0);
+    if (sx127x_set_opmod(SX127x_MODE_RX_CONT, SX127x_MODULATION_LORA, &radio) != SX127X_OK)
+    {
+        return false;
+    }
+    bool irq = ulTaskNotifyTake(pdTRUE, espera) > 0;
+    uint8_t estado = 0;
+    if (!irq && sx127x_read_register(REGMODEMSTAT, &radio.spi_device, &estado) == SX127X_OK && (estado & 0x01) != 0)
+    {
+        irq = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(toa_downlink_max_us / 1000 + 100)) > 0;
+    }
+    if (irq)
+    {
+        sx127x_handle_interrupt(&radio);
+    }
+    sx127x_set_opmod(SX127x_MODE_STANDBY, SX127x_MODULATION_LORA, &radio);
+    return downlink_len > 0;
+}
+
+// Ventana clase A: el receptor transmite COMANDOS_RX_RETARDO_MS despues de recibir el uplink que acaba de
+// terminar. Se escucha desde COMANDOS_RX_MARGEN_MS antes y se corta si no aparece el preambulo a tiempo
+static bool escuchar_ventana(void)
+{
+    if (radio_modo(false) != ESP_OK)
+    {
+        return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(COMANDOS_RX_RETARDO_MS - COMANDOS_RX_MARGEN_MS));
+    return radio_escuchar(pdMS_TO_TICKS(2 * COMANDOS_RX_MARGEN_MS + 8 * SIMBOLO_US / 1000));
+}
+
+// Aplica el downlink recibido y lo confirma. Devuelve true si se envio un ACK (abre otra ventana en clase A)
+static bool atender_downlink(void)
+{
+    uint8_t id = 0;
+    comandos_resultado_t resultado = comandos_aplicar(downlink, downlink_len, SRC_ADRR, &config, &id);
+    bool difusion = downlink_len > 1 && downlink[1] == COMANDOS_DIFUSION;
+    if (resultado == COMANDOS_OTRO_DESTINO || downlink_len < 3)
+    {
+        return false;
+    }
+    if (resultado == COMANDOS_APLICADO)
+    {
+        ESP_LOGI(TAG, "Downlink %u aplicado: periodo %u s (%u s cerca de umbral), lote %u, silencio %u s", id,
+                 config.periodo_s, config.rapido_s, config.lote, config.silencio_s);
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Downlink %u %s", id, resultado == COMANDOS_DUPLICADO ? "repetido, se vuelve a confirmar" : "invalido");
+    }
+
+    // un multicast llega a la vez a todos los nodos clase C: cada uno espera un tiempo distinto para confirmar
+    if (CLASE_NODO == TELEMETRIA_CLASE_C && difusion)
+    {
+        vTaskDelay(pdMS_TO_TICKS(esp_random() % COMANDOS_ACK_DISPERSION_MS));
+    }
+    uint8_t ack[COMANDOS_ACK_LEN];
+    size_t len = comandos_codificar_ack(SRC_ADRR, id, resultado, ack);
+    if (radio_modo(false) != ESP_OK || radio_enviar(ack, (uint8_t)len, toa_explicito_us) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error enviando ACK del downlink %u", id);
+        return false;
+    }
+    return true;
+}
+
+// Tras un uplink que abre ventana: cada ACK abre otra, asi salen seguidos varios downlinks pendientes
+static void ventanas_clase_a(void)
+{
+    while (CLASE_NODO == TELEMETRIA_CLASE_A && escuchar_ventana() && atender_downlink())
+    {
+    }
+}
+
+// Espera a la siguiente lectura. Clase C escucha el canal de control mientras tanto
+static void esperar_lectura(TickType_t inicio)
+{
+    uint32_t periodo_ms = (uint32_t)politica_periodo(&politica, &config) * 1000;
+    TickType_t fin = inicio + pdMS_TO_TICKS(periodo_ms + esp_random() % (periodo_ms * PERIODO_DISPERSION_PCT / 100 + 1));
+    if (CLASE_NODO == TELEMETRIA_CLASE_C && radio_modo(false) == ESP_OK)
+    {
+        TickType_t ahora;
+        while ((int32_t)(fin - (ahora = xTaskGetTickCount())) > 0)
+        {
+            if (radio_escuchar(fin - ahora))
+            {
+                atender_downlink();
+                radio_modo(false);
+            }
+        }
+        return;
+    }
+    TickType_t ahora = xTaskGetTickCount();
+    if ((int32_t)(fin - ahora) > 0)
+    {
+        vTaskDelay(fin - ahora);
+    }
+}
+
+// Mensaje de control con cabecera explicita: anuncia longitud, SF, CR de la telemetria implicita y la clase
+static void enviar_formato(void)
+{
+    telemetria_formato_t formato = {
+        .origen = SRC_ADRR,
+        .version = TELEMETRIA_VERSION,
+        .longitud = TELEMETRIA_LEN,
+        .sf = (uint8_t)(RADIO_SF >> 4),
+        .cr = (uint8_t)((RADIO_CR >> 1) + 4),
+        .clase = CLASE_NODO};
+    uint8_t trama[TELEMETRIA_CTRL_FORMATO_LEN];
+    size_t len = telemetria_codificar_formato(&formato, trama);
+    if (radio_modo(false) != ESP_OK || radio_enviar(trama, (uint8_t)len, toa_explicito_us) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error enviando anuncio de formato");
+        return;
+    }
+    ventanas_clase_a();
+}
+
+static esp_err_t radio_init(void)
+{
+    tarea_tx = xTaskGetCurrentTaskHandle();
+    if (arranque_en_frio())
+    {
+        comandos_config_defecto(&config, PERIODO_DEFECTO_S);
+        politica_iniciar(&politica);
+        anomalias_iniciar(&anomalias);
+    }
+    anomalias_config_defecto(&anomalias_config);
+#if MODO_SUENO
+    gpio_hold_dis(RADIO_CS); // se retuvo en alto para dormir
+#endif
+
+    gpio_set_direction(RADIO_RST, GPIO_MODE_OUTPUT);
+    gpio_set_level(RADIO_RST, 0);
+    vTaskDelay(pdMS_TO_TICKS(5));
+    gpio_set_level(RADIO_RST, 1);
+    vTaskDelay(pdMS_TO_TICKS(10));
+
+    spi_bus_config_t bus = {
+        .mosi_io_num = RADIO_MOSI,
+        .miso_io_num = RADIO_MISO,
+        .sclk_io_num = RADIO_SCK,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = 0,
+    };
+    ESP_RETURN_ON_ERROR(spi_bus_initialize(RADIO_SPI_HOST, &bus, SPI_DMA_CH_AUTO), TAG, "spi bus");
+    spi_device_interface_config_t dev_cfg = {
+        .clock_speed_hz = 8E6,
+        .spics_io_num = RADIO_CS,
+        .queue_size = 16,
+        .command_bits = 0,
+        .address_bits = 8,
+        .dummy_bits = 0,
+        .mode = 0};
+    spi_device_handle_t spi;
+    ESP_RETURN_ON_ERROR(spi_bus_add_device(RADIO_SPI_HOST, &dev_cfg, &spi), TAG, "spi radio");
+    ESP_RETURN_ON_ERROR(sx127x_create(spi, &radio), TAG, "sx127x");
+
+    ESP_RETURN_ON_ERROR(sx127x_set_opmod(SX127x_MODE_SLEEP, SX127x_MODULATION_LORA, &radio), TAG, "config");
+    ESP_RETURN_ON_ERROR(sx127x_lora_reset_fifo(&radio), TAG, "config");
+    ESP_RETURN_ON_ERROR(sx127x_set_opmod(SX127x_MODE_STANDBY, SX127x_MODULATION_LORA, &radio), TAG, "config");
+    ESP_RETURN_ON_ERROR(sx127x_lora_set_bandwidth(RADIO_BW, &radio), TAG, "config");
+    ESP_RETURN_ON_ERROR(sx127x_lora_set_modem_config_2(RADIO_SF, &radio), TAG, "config");
+    ESP_RETURN_ON_ERROR(sx127x_lora_set_syncword(RADIO_SYNCWORD, &radio), TAG, "config");
+    ESP_RETURN_ON_ERROR(sx127x_set_preamble_length(8, &radio), TAG, "config");
+    ESP_RETURN_ON_ERROR(sx127x_tx_set_pa_config(SX127x_PA_PIN_BOOST, 20, &radio), TAG, "config");
+
+    gpio_set_direction(RADIO_DIO0, GPIO_MODE_INPUT);
+    gpio_pulldown_en(RADIO_DIO0);
+    gpio_pullup_dis(RADIO_DIO0);
+    gpio_set_intr_type(RADIO_DIO0, GPIO_INTR_POSEDGE);
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
+    {
+        return err;
+    }
+    ESP_RETURN_ON_ERROR(gpio_isr_handler_add(RADIO_DIO0, radio_isr, NULL), TAG, "isr");
+    sx127x_rx_set_callback(rx_callback, &radio);
+
+    // el modelo de tiempo en el aire de la libreria lee la configuracion del modem, se evalua en los dos modos
+    uint32_t toa_texto_us = 0;
+    ESP_RETURN_ON_ERROR(radio_modo(false), TAG, "modo control");
+    ESP_RETURN_ON_ERROR(sx127x_lora_get_time_on_air(TELEMETRIA_LEN, &radio, &toa_explicito_us), TAG, "toa");
+    ESP_RETURN_ON_ERROR(sx127x_lora_get_time_on_air(TEXTO_LEN, &radio, &toa_texto_us), TAG, "toa");
+    ESP_RETURN_ON_ERROR(sx127x_lora_get_time_on_air(COMANDOS_MAX_LEN, &radio, &toa_downlink_max_us), TAG, "toa");
+    ESP_RETURN_ON_ERROR(radio_modo(true), TAG, "modo telemetria");
+    ESP_RETURN_ON_ERROR(sx127x_lora_get_time_on_air(TELEMETRIA_LEN, &radio, &toa_implicito_us), TAG, "toa");
+    ESP_LOGI(TAG, "Tiempo en el aire por lectura: texto %d bytes %lu us, binario explicito %lu us, binario implicito %lu us",
+             TEXTO_LEN, (unsigned long)toa_texto_us, (unsigned long)toa_explicito_us, (unsigned long)toa_implicito_us);
+    return ESP_OK;
+}
+
+// Un lote de varias lecturas sale comprimido (TELEMETRIA_CTRL_LOTE) por el canal de control: como cambian
+// despacio, cada lectura ocupa unos pocos bits en lugar de una trama de TELEMETRIA_LEN bytes con su preambulo
+static void enviar_lote(int num)
+{
+    int i = 0;
+    while (i < num)
+    {
+        uint8_t trama[TELEMETRIA_LOTE_MAX_LEN];
+        size_t len = 0;
+        int n = (int)telemetria_codificar_lote(&lote[i], &lote_t[i], num - i, CLASE_NODO == TELEMETRIA_CLASE_A,
+                                               trama, sizeof(trama), &len);
+        if (n == 0)
+        {
+            ESP_LOGE(TAG, "Lectura %u no cabe en un lote", lote[i].secuencia);
+            return;
+        }
+        if (i + n < num)
+        {
+            trama[1] &= (uint8_t)~TELEMETRIA_FLAG_VENTANA; // quedan lecturas: todavia no se escucha
+        }
+        uint32_t toa_us = 0;
+        if (radio_modo(false) != ESP_OK || sx127x_lora_get_time_on_air((uint8_t)len, &radio, &toa_us) != ESP_OK ||
+            radio_enviar(trama, (uint8_t)len, toa_us) != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Error enviando lote desde la lectura %u", lote[i].secuencia);
+            return;
+        }
+
+        uint64_t por_separado_us = (uint64_t)n * toa_implicito_us;
+        uint32_t ahorro_us = por_separado_us > toa_us ? (uint32_t)(por_separado_us - toa_us) : 0;
+        ahorro_total_us += ahorro_us;
+        ESP_LOGI(TAG, "Lote %u..%u: %d lecturas en %u bytes (%d sin comprimir), %lu us en el aire (%llu us una a una), ahorro %lu uJ, acumulado %llu ms",
+                 lote[i].secuencia, lote[i + n - 1].secuencia, n, (unsigned)len, n * TELEMETRIA_LEN,
+                 (unsigned long)toa_us, (unsigned long long)por_separado_us, (unsigned long)energia_uj(ahorro_us),
+                 (unsigned long long)(ahorro_total_us / 1000));
+        i += n;
+    }
+    ventanas_clase_a();
+}
+
+// Canales del ADC en un extremo de su rango, un bit por parametro (anomalias_evaluar)
+static uint8_t adc_riel(float ec_mV, float ph_mV, float tds_mV)
+{
+    const float mV[] = {ec_mV, ph_mV, tds_mV};
+    const telemetria_parametro_t parametros[] = {TELEMETRIA_EC, TELEMETRIA_PH, TELEMETRIA_TDS};
+    uint8_t riel = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        if (mV[i] <= ADC_RIEL_MIN_MV || mV[i] >= ADC_RIEL_MAX_MV)
+            riel |= (uint8_t)(1u << parametros[i]);
+    }
+    return riel;
+}
+
+// Agrega la lectura al lote si la politica de envio la deja salir; t, segundos desde el arranque en que se tomo,
+// riel como en adc_riel. Una anomalia sale en el acto con lo que haya en el lote. Devuelve true si hay que
+// enviar el lote
+static bool agregar_lectura(float temperatura, float ec, float ph, float tds, uint8_t riel, uint32_t t)
+{
+    telemetria_lectura_t *lectura = &lote[lote_num];
+    lectura->origen = SRC_ADRR;
+    lectura->ventana = false;
+    lectura->temperatura = comandos_calibrar(&config, TELEMETRIA_TEMPERATURA, temperatura);
+    lectura->ec = comandos_calibrar(&config, TELEMETRIA_EC, ec);
+    lectura->ph = comandos_calibrar(&config, TELEMETRIA_PH, ph);
+    lectura->tds = comandos_calibrar(&config, TELEMETRIA_TDS, tds);
+    anomalia_t motivos[TELEMETRIA_NUM_PARAMETROS];
+    anomalia_t anomalia = anomalias_evaluar(&anomalias, &anomalias_config, lectura, riel, t, motivos);
+    politica_motivo_t motivo = politica_evaluar(&politica, &config, lectura, t, anomalia != ANOMALIA_NINGUNA);
+    // con lecturas suprimidas el lote tarda en llenarse: no se retiene mas de silencio_s
+    if (motivo == POLITICA_SUPRIMIDA)
+    {
+        return lote_num > 0 && t - lote_t[0] >= config.silencio_s;
+    }
+
+    if (secuencia % FORMATO_CADA_LECTURAS == 0)
+    {
+        enviar_formato();
+        ESP_LOGI(TAG, "Politica de envio: %lu suprimidas; enviadas por banda %lu, pendiente %lu, umbral %lu, anomalia %lu, silencio %lu",
+                 (unsigned long)politica.motivos[POLITICA_SUPRIMIDA], (unsigned long)politica.motivos[POLITICA_BANDA],
+                 (unsigned long)politica.motivos[POLITICA_PENDIENTE], (unsigned long)politica.motivos[POLITICA_UMBRAL],
+                 (unsigned long)politica.motivos[POLITICA_URGENTE], (unsigned long)politica.motivos[POLITICA_SILENCIO]);
+    }
+    lectura->secuencia = secuencia++;
+    lote_t[lote_num++] = t;
+
+    // las lecturas se acumulan hasta completar el lote, salvo que una salga de sus umbrales
+    bool alarma = comandos_fuera_de_umbral(&config, lectura);
+    if (alarma)
+    {
+        ESP_LOGW(TAG, "Lectura %u fuera de umbral, se envia el lote de %d", lectura->secuencia, lote_num);
+    }
+    static const char *const nombres[TELEMETRIA_NUM_PARAMETROS] = {"temperatura", "EC", "pH", "TDS"};
+    for (int i = 0; i < TELEMETRIA_NUM_PARAMETROS; i++)
+    {
+        if (motivos[i] != ANOMALIA_NINGUNA)
+        {
+            ESP_LOGW(TAG, "Lectura %u: anomalia (%s) en %s, valor %.2f, se envia el lote de %d",
+                     lectura->secuencia, anomalias_nombre(motivos[i]), nombres[i],
+                     telemetria_valor(lectura, (telemetria_parametro_t)i), lote_num);
+        }
+    }
+    bool silencio = motivo == POLITICA_SILENCIO || t - lote_t[0] >= config.silencio_s;
+    return lote_num >= config.lote || alarma || silencio || anomalia != ANOMALIA_NINGUNA;
+}
+
+static void enviar_pendientes(void)
+{
+    // solo la ultima trama abre la ventana de downlink
+    lote[lote_num - 1].ventana = CLASE_NODO == TELEMETRIA_CLASE_A;
+    int enviadas = lote_num;
+    lote_num = 0;
+    if (enviadas > 1)
+    {
+        enviar_lote(enviadas);
+        return;
+    }
+    for (int i = 0; i < enviadas; i++)
+    {
+        uint8_t trama[TELEMETRIA_LEN];
+        telemetria_codificar(&lote[i], trama);
+        if (radio_modo(true) != ESP_OK || radio_enviar(trama, sizeof(trama), toa_implicito_us) != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Error enviando lectura %u", lote[i].secuencia);
+            return;
+        }
+
+        uint32_t ahorro_us = toa_explicito_us - toa_implicito_us;
+        ahorro_total_us += ahorro_us;
+        ESP_LOGI(TAG, "Lectura %u: %lu us en el aire (explicita %lu us), ahorro %lu us / %lu uJ, acumulado %llu ms / %lu mJ",
+                 lote[i].secuencia, (unsigned long)toa_implicito_us, (unsigned long)toa_explicito_us,
+                 (unsigned long)ahorro_us, (unsigned long)energia_uj(ahorro_us),
+                 (unsigned long long)(ahorro_total_us / 1000), (unsigned long)(energia_uj(ahorro_total_us) / 1000));
+    }
+    ventanas_clase_a();
+}
+
+static void enviar_telemetria(float temperatura, float ec, float ph, float tds, uint8_t riel, uint32_t t)
+{
+    if (agregar_lectura(temperatura, ec, ph, tds, riel, t))
+    {
+        enviar_pendientes();
+    }
+}
+#endif
+
+#if MODO_SUENO
+// ----------- SUEÑO PROFUNDO -----------
+extern const uint8_t ulp_main_bin_start[] asm("_binary_ulp_main_bin_start");
+extern const uint8_t ulp_main_bin_end[] asm("_binary_ulp_main_bin_end");
+static muestreo_t *const muestreo = (muestreo_t *)&ulp_muestreo;
+
+// Lo que hace ulp_riscv_adc_init para un canal, para los tres: el ADC1 pasa al ULP
+static esp_err_t adc_ulp_init(void)
+{
+    adc_oneshot_unit_handle_t handle;
+    adc_oneshot_unit_init_cfg_t unidad = {.unit_id = ADC_UNIT_ID, .ulp_mode = ADC_ULP_MODE_RISCV};
+    ESP_RETURN_ON_ERROR(adc_oneshot_new_unit(&unidad, &handle), TAG, "adc ulp");
+    adc_oneshot_chan_cfg_t canal = {.bitwidth = ADC_BITWIDTH_DEFAULT, .atten = ADC_ATTEN_DB_11};
+    ESP_RETURN_ON_ERROR(adc_oneshot_config_channel(handle, EC_ADC_CHANNEL, &canal), TAG, "adc ulp");
+    ESP_RETURN_ON_ERROR(adc_oneshot_config_channel(handle, PH_ADC_CHANNEL, &canal), TAG, "adc ulp");
+    ESP_RETURN_ON_ERROR(adc_oneshot_config_channel(handle, TDS_ADC_CHANNEL, &canal), TAG, "adc ulp");
+    adc_set_hw_calibration_code(ADC_UNIT_ID, ADC_ATTEN_DB_11);
+    esp_sleep_enable_adc_tsens_monitor(true);
+    return ESP_OK;
+}
+
+// Una muestra del ULP cada periodo_ms. El timer del ULP cuenta ciclos del reloj lento en un campo de 24 bits
+// (unos 2 min a 136 kHz) y ulp_set_wakeup_period recibe us en 32 bits: los periodos mas largos se reparten en
+// varios arranques iguales del ULP, que solo muestrea en el ultimo
+static esp_err_t ulp_periodo(uint32_t periodo_ms)
+{
+    uint64_t max_us = ((uint64_t)RTC_CNTL_ULP_CP_TIMER_SLP_CYCLE_V * esp_clk_slowclk_cal_get()) >> RTC_CLK_CAL_FRACT;
+    uint64_t periodo_us = (uint64_t)periodo_ms * 1000;
+    uint64_t despertares = (periodo_us + max_us - 1) / max_us;
+    if (despertares == 0)
+    {
+        despertares = 1;
+    }
+    muestreo_espaciar(muestreo, (uint32_t)despertares);
+    return ulp_set_wakeup_period(0, (uint32_t)(periodo_us / despertares));
+}
+
+// Arranque en frio: carga el programa del ULP y lo pone a muestrear
+static esp_err_t ulp_iniciar(void)
+{
+    ESP_RETURN_ON_ERROR(ulp_riscv_load_binary(ulp_main_bin_start, ulp_main_bin_end - ulp_main_bin_start), TAG, "ulp");
+    muestreo_iniciar(muestreo);
+    ESP_RETURN_ON_ERROR(adc_ulp_init(), TAG, "adc ulp");
+    ESP_RETURN_ON_ERROR(ulp_periodo((uint32_t)config.periodo_s * 1000), TAG, "ulp");
+    return ulp_riscv_run();
+}
+
+// Valor calibrado de un parametro para una cuenta del ADC
+static float valor_crudo(adc_cali_handle_t cali, telemetria_parametro_t parametro, float temperatura, int crudo)
+{
+    int mV = 0;
+    adc_cali_raw_to_voltage(cali, crudo, &mV);
+    float valor = parametro == TELEMETRIA_EC   ? calcular_ec(mV, temperatura)
+                  : parametro == TELEMETRIA_PH ? calcular_ph(mV, temperatura)
+                                               : calcular_tds(mV, temperatura);
+    return comandos_calibrar(&config, parametro, valor);
+}
+
+// Primera cuenta cuyo valor llega a limite (o lo pasa, si estricto) en el sentido signo (1: el valor crece con la
+// cuenta, -1: decrece). Las formulas son monotonas, asi que basta una biseccion
+static int primera_cuenta(adc_cali_handle_t cali, telemetria_parametro_t parametro, float temperatura, float limite,
+                          float signo, bool estricto)
+{
+    int desde = 0, hasta = MUESTREO_CRUDO_MAX + 1;
+    while (desde < hasta)
+    {
+        int mitad = (desde + hasta) / 2;
+        float d = signo * (valor_crudo(cali, parametro, temperatura, mitad) - limite);
+        if (estricto ? d > 0 : d >= 0)
+            hasta = mitad;
+        else
+            desde = mitad + 1;
+    }
+    return desde;
+}
+
+// Umbrales de un parametro en cuentas para el ULP, con la temperatura de este despertar
+static void umbral_crudo(adc_cali_handle_t cali, telemetria_parametro_t parametro, float temperatura, uint16_t *min,
+                         uint16_t *max)
+{
+    float signo = valor_crudo(cali, parametro, temperatura, MUESTREO_CRUDO_MAX) >=
+                          valor_crudo(cali, parametro, temperatura, 0)
+                      ? 1.0f
+                      : -1.0f;
+    float abajo = signo > 0 ? config.umbral_min[parametro] : config.umbral_max[parametro];
+    float arriba = signo > 0 ? config.umbral_max[parametro] : config.umbral_min[parametro];
+    int fuera = primera_cuenta(cali, parametro, temperatura, arriba, signo, true);
+    if (fuera == 0)
+    {
+        *min = MUESTREO_CRUDO_MAX + 1; // ninguna cuenta dentro: cualquier muestra despierta
+        *max = 0;
+        return;
+    }
+    *min = (uint16_t)primera_cuenta(cali, parametro, temperatura, abajo, signo, false);
+    *max = (uint16_t)(fuera - 1);
+}
+
+// Programa al ULP con la configuracion de ahora (puede haber cambiado por un downlink) y duerme hasta que
+// despierte. Lo que falta del lote ya esta en memoria RTC
+static void dormir(const adc_cali_handle_t *cali, float temperatura)
+{
+    static const telemetria_parametro_t parametros[MUESTREO_CANALES] = {TELEMETRIA_EC, TELEMETRIA_PH, TELEMETRIA_TDS};
+    uint16_t min[MUESTREO_CANALES], max[MUESTREO_CANALES];
+    for (int c = 0; c < MUESTREO_CANALES; c++)
+    {
+        umbral_crudo(cali[c], parametros[c], temperatura, &min[c], &max[c]);
+    }
+    int faltan = config.lote - lote_num;
+    muestreo_configurar(muestreo, faltan > 0 ? (uint32_t)faltan : 1, min, max);
+
+    // la misma dispersion que esperar_lectura, una vez por despertar
+    uint32_t periodo_ms = (uint32_t)politica_periodo(&politica, &config) * 1000;
+    periodo_ms += esp_random() % (periodo_ms * PERIODO_DISPERSION_PCT / 100 + 1);
+    ulp_periodo(periodo_ms);
+
+    ds18b20_convertir(); // lista para el proximo despertar
+    sx127x_set_opmod(SX127x_MODE_SLEEP, SX127x_MODULATION_LORA, &radio);
+    gpio_hold_en(RADIO_CS); // que la radio no vea ruido en el bus mientras duerme
+    gpio_deep_sleep_hold_en();
+
+    ESP_LOGI(TAG, "Despierto %lu ms, a dormir hasta %lu muestras (%d en el lote)",
+             (unsigned long)(esp_timer_get_time() / 1000), (unsigned long)muestreo->lote, lote_num);
+    esp_sleep_enable_ulp_wakeup();
+    esp_deep_sleep_start();
+}
+
+// Un despertar: las muestras del ULP se agregan al lote como si se hubieran leido una a una, con la temperatura
+// de este despertar y el tiempo segun el periodo. Lo que toque enviar sale junto al final: si una lectura
+// sale de umbral o el despertar se retraso, las demas muestras pendientes van en la misma trama en vez de una
+// trama (y una ventana clase A) por lectura. No vuelve
+static void ciclo_sueno(const adc_cali_handle_t *cali)
+{
+    if (arranque_en_frio())
+    {
+        ESP_ERROR_CHECK(ulp_iniciar());
+        dormir(cali, leer_temperatura_ds18b20());
+    }
+
+    float temperatura = ds18b20_leer();
+    uint32_t ahora = (uint32_t)time(NULL);
+    int num = muestreo_pendientes(muestreo);
+    uint16_t periodo = politica_periodo(&politica, &config); // el que se programo al dormir
+    ESP_LOGI(TAG, "Despertado por el ULP: %d muestras%s, %lu perdidas", num,
+             muestreo->alarma > muestreo->leidas ? ", fuera de umbral" : "", (unsigned long)muestreo->perdidas);
+    bool enviar = false;
+    for (int i = 0; i < num; i++)
+    {
+        uint16_t crudo[MUESTREO_CANALES];
+        if (!muestreo_leer(muestreo, crudo))
+            break;
+        float valor[MUESTREO_CANALES];
+        for (int c = 0; c < MUESTREO_CANALES; c++)
+        {
+            int mV = 0;
+            adc_cali_raw_to_voltage(cali[c], crudo[c], &mV);
+            valor[c] = (float)mV;
+        }
+        enviar |= agregar_lectura(temperatura, calcular_ec(valor[0], temperatura), calcular_ph(valor[1], temperatura),
+                                  calcular_tds(valor[2], temperatura), adc_riel(valor[0], valor[1], valor[2]),
+                                  ahora - (uint32_t)(num - 1 - i) * periodo);
+        if (lote_num == COMANDOS_MAX_LOTE)
+        {
+            enviar_pendientes();
+            enviar = false;
+        }
+    }
+    if (enviar)
+    {
+        enviar_pendientes();
+    }
+    dormir(cali, temperatura);
+}
+#endif
+
 // ===================  APP MAIN  ===================
 void app_main(void)
 {
+#if !MODO_SUENO
     // --- Inicialización ADC ---
     adc_oneshot_unit_handle_t adc_handle;
     adc_oneshot_unit_init_cfg_t init_config = {.unit_id = ADC_UNIT_ID};
@@ -98,6 +765,7 @@ void app_main(void)
     adc_oneshot_config_channel(adc_handle, EC_ADC_CHANNEL, &chan_config);
     adc_oneshot_config_channel(adc_handle, PH_ADC_CHANNEL, &chan_config);
     adc_oneshot_config_channel(adc_handle, TDS_ADC_CHANNEL, &chan_config);
+#endif
 
     // Calibración por canal
     adc_cali_handle_t cali_ec = NULL, cali_ph = NULL, cali_tds = NULL;
@@ -139,6 +807,11 @@ void app_main(void)
     // --- Inicializar DS18B20 ---
     gpio_set_direction(DS18B20_GPIO, GPIO_MODE_INPUT_OUTPUT);
 
+#if MODO_RADIO
+    ESP_ERROR_CHECK(radio_init());
+    printf("Transmisor SX127x listo (clase %c). Telemetria binaria implicita a %d Hz cada %us...\n",
+           CLASE_NODO == TELEMETRIA_CLASE_C ? 'C' : 'A', TELEMETRIA_FRECUENCIA, config.periodo_s);
+#else
     // --- Inicializar UART para LoRaWAN ---
     lorawan_uart_init();
     lorawan_uart_cmd("AT\r\n");
@@ -163,9 +836,18 @@ void app_main(void)
     vTaskDelay(pdMS_TO_TICKS(1000)); // Espera tras configurar
 
     printf("Transmisor LoRaWAN listo en UART. Enviando datos al nodo 2 cada 5s...\n");
+#endif
 
+#if MODO_SUENO
+    // el ADC lo lee el ULP; aqui solo hace falta la calibracion
+    adc_cali_handle_t cali[MUESTREO_CANALES] = {cali_ec, cali_ph, cali_tds};
+    ciclo_sueno(cali);
+#else
     while (1)
     {
+#if MODO_RADIO
+        TickType_t inicio = xTaskGetTickCount();
+#endif
         // Leer sensores
         float temperatura = leer_temperatura_ds18b20();
         float voltaje_ec = leer_adc_mV(adc_handle, cali_ec, EC_ADC_CHANNEL);
@@ -176,6 +858,10 @@ void app_main(void)
         float valor_ph = calcular_ph(voltaje_ph, temperatura);
         float valor_tds = calcular_tds(voltaje_tds, temperatura);
 
+#if MODO_RADIO
+        enviar_telemetria(temperatura, valor_ec, valor_ph, valor_tds, adc_riel(voltaje_ec, voltaje_ph, voltaje_tds),
+                          xTaskGetTickCount() / configTICK_RATE_HZ);
+#else
         char mensaje[90];
         char temp_msj[3];
         char data[55];
@@ -208,14 +894,20 @@ void app_main(void)
             response[rx_len] = '\0';
             printf("Respuesta Node: %s\n\r", response);
         }
+#endif
 
         // Imprimir local
         printf("Voltaje EC: %.2f mV | Voltaje pH: %.2f mV | Voltaje TDS: %.2f mV\n", voltaje_ec, voltaje_ph, voltaje_tds);
         printf("Temp: %.2f °C | EC: %.2f us/cm | pH: %.2f | TDS: %.2f ppm\n",
                temperatura, valor_ec, valor_ph, valor_tds);
 
+#if MODO_RADIO
+        esperar_lectura(inicio);
+#else
         vTaskDelay(pdMS_TO_TICKS(2000)); // Esperar 5 segundos
+#endif
     }
+#endif
 
     // --- Liberar calibración (nunca se ejecuta por el bucle) ---
     adc_cali_delete_scheme_curve_fitting(cali_ec);
@@ -367,16 +1059,32 @@ static int ds18b20_read_byte(void)
     return data;
 }
 
-float leer_temperatura_ds18b20(void)
+// Arranca la conversion, que tarda hasta 750 ms. El sensor la guarda hasta que se lee
+static bool ds18b20_convertir(void)
 {
     if (!ds18b20_reset())
     {
         printf("DS18B20 no detectado\n");
-        return 25.0;
+        return false;
     }
     ds18b20_write_byte(0xCC); // SKIP ROM
     ds18b20_write_byte(0x44); // CONVERT T
+    return true;
+}
+
+float leer_temperatura_ds18b20(void)
+{
+    if (!ds18b20_convertir())
+    {
+        return 25.0;
+    }
     vTaskDelay(pdMS_TO_TICKS(750));
+    return ds18b20_leer();
+}
+
+// Temperatura de la ultima conversion
+static float ds18b20_leer(void)
+{
     if (!ds18b20_reset())
     {
         printf("DS18B20 no detectado post-conv\n");
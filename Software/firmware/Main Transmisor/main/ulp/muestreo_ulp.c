@@ -0,0 +1,33 @@
+// Programa del ULP RISC-V del transmisor (MODO_SUENO). Lo arranca el timer del ULP, una o varias veces por
+// periodo de muestreo (muestreo_espaciar): lee los canales del ADC, guarda la muestra (muestreo.h) y despierta a
+// los procesadores principales si hay un lote completo o una muestra fuera de umbral. Al volver de main el ULP
+// se para hasta el siguiente arranque.
+#include <stdint.h>
+#include "ulp_riscv_utils.h"
+#include "ulp_riscv_adc_ulp_core.h"
+#include "muestreo.h"
+
+// los mismos canales que main.c, en el mismo orden que las muestras
+#define EC_ADC_CHANNEL ADC_CHANNEL_3  // GPIO4
+#define PH_ADC_CHANNEL ADC_CHANNEL_4  // GPIO5
+#define TDS_ADC_CHANNEL ADC_CHANNEL_5 // GPIO6
+
+// el principal lo ve como ulp_muestreo
+muestreo_t muestreo;
+
+int main(void)
+{
+    if (!muestreo_despertar(&muestreo))
+    {
+        return 0;
+    }
+    uint16_t crudo[MUESTREO_CANALES];
+    crudo[0] = (uint16_t)ulp_riscv_adc_read_channel(ADC_UNIT_1, EC_ADC_CHANNEL);
+    crudo[1] = (uint16_t)ulp_riscv_adc_read_channel(ADC_UNIT_1, PH_ADC_CHANNEL);
+    crudo[2] = (uint16_t)ulp_riscv_adc_read_channel(ADC_UNIT_1, TDS_ADC_CHANNEL);
+    if (muestreo_agregar(&muestreo, crudo))
+    {
+        ulp_riscv_wakeup_main_processor();
+    }
+    return 0;
+}
@@ -0,0 +1,344 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "difusion.h"
+#include "api.h"
+
+static const char *TAG = "API";
+
+// json_float escribe como mucho "-999999999.99" o "-3.40282e+38"
+#define JSON_FLOAT_MAX 13
+// ",[t,nodo,muestras,min,max,media]" en el peor caso: 2 + 10 + 1 + 3 + 1 + 5 + 1 + 3 * JSON_FLOAT_MAX + 2 + 1
+#define API_PUNTO_MAX (26 + 3 * JSON_FLOAT_MAX)
+
+static httpd_handle_t servidor = NULL;
+static api_historia_t historia = NULL;
+// difusion y ultimas: las tocan la tarea que recibe (api_publicar) y la del servidor
+static SemaphoreHandle_t mutex;
+static difusion_t difusion;
+static struct
+{
+    bool valida;
+    uint32_t t;
+    telemetria_lectura_t lectura;
+} ultimas[API_MAX_NODOS];
+
+static const char *const parametros[TELEMETRIA_NUM_PARAMETROS] = {"temp", "ec", "ph", "tds"};
+static const char *const niveles[SERIE_NUM_NIVELES] = {"crudo", "minuto", "hora"};
+
+static uint32_t ahora_ms(void)
+{
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+// JSON no tiene NaN ni infinito. Los valores enormes (lotes XOR o texto corruptos) van en notacion exponencial
+// para que ningun valor pase de JSON_FLOAT_MAX caracteres
+static int json_float(char *buf, size_t len, float valor)
+{
+    if (!isfinite(valor))
+        return snprintf(buf, len, "null");
+    if (fabsf(valor) >= 1e9f)
+        return snprintf(buf, len, "%.5e", valor);
+    return snprintf(buf, len, "%.2f", valor);
+}
+
+// Hay sitio en el buffer de envio del socket. Los envios de esp_http_server son bloqueantes: escribir en el
+// socket lleno de un cliente que no lee pararia la tarea del servidor para todos hasta send_wait_timeout
+static bool escribible(int fd)
+{
+    fd_set escritura;
+    FD_ZERO(&escritura);
+    FD_SET(fd, &escritura);
+    struct timeval cero = {0, 0};
+    return select(fd + 1, NULL, &escritura, NULL, &cero) > 0;
+}
+
+static void envio_terminado(esp_err_t err, int fd, void *arg);
+
+// Lanza el siguiente envio del cliente si no tiene uno en curso y su socket admite mas. Si no, el mensaje espera
+// en su cola (donde se descartan los mas viejos). Con el mutex tomado
+static void enviar_siguiente(int fd)
+{
+    const difusion_cliente_t *cliente = NULL;
+    for (int c = 0; c < DIFUSION_MAX_CLIENTES && cliente == NULL; c++)
+    {
+        if (difusion.clientes[c].fd == fd)
+            cliente = &difusion.clientes[c];
+    }
+    if (cliente == NULL || cliente->en_vuelo || cliente->num == 0 || !escribible(fd))
+    {
+        return;
+    }
+    const uint8_t *mensaje = difusion_siguiente(&difusion, fd, NULL);
+    // el payload (difusion_cliente_t.enviando) sigue valido hasta difusion_enviado
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_BINARY,
+        .payload = (uint8_t *)mensaje,
+        .len = DIFUSION_MENSAJE_LEN};
+    if (httpd_ws_send_data_async(servidor, fd, &frame, envio_terminado, NULL) != ESP_OK)
+    {
+        // cola de trabajo del servidor llena: se reintenta al terminar otro envio o con la siguiente lectura
+        difusion_enviado(&difusion, fd, false, ahora_ms());
+    }
+}
+
+static void enviar_pendientes(void)
+{
+    for (int c = 0; c < DIFUSION_MAX_CLIENTES; c++)
+    {
+        if (difusion.clientes[c].fd != DIFUSION_LIBRE)
+            enviar_siguiente(difusion.clientes[c].fd);
+    }
+}
+
+// En la tarea del servidor, al terminar cada envio
+static void envio_terminado(esp_err_t err, int fd, void *arg)
+{
+    (void)arg;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    difusion_enviado(&difusion, fd, err == ESP_OK, ahora_ms());
+    if (err == ESP_OK)
+    {
+        enviar_pendientes();
+    }
+    xSemaphoreGive(mutex);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Cliente %d: error enviando (%s), se cierra", fd, esp_err_to_name(err));
+        httpd_sess_trigger_close(servidor, fd);
+    }
+}
+
+static void cerrar_sesion(httpd_handle_t hd, int fd)
+{
+    (void)hd;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    difusion_desconectar(&difusion, fd);
+    xSemaphoreGive(mutex);
+    close(fd);
+}
+
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+    if (req->method == HTTP_GET)
+    {
+        // handshake terminado
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        bool conectado = difusion_conectar(&difusion, fd, ahora_ms());
+        int clientes = difusion.num_clientes;
+        xSemaphoreGive(mutex);
+        if (!conectado)
+        {
+            ESP_LOGW(TAG, "Cliente WebSocket %d rechazado: %d conectados", fd, DIFUSION_MAX_CLIENTES);
+            return ESP_FAIL;
+        }
+        ESP_LOGI(TAG, "Cliente WebSocket %d conectado (%d)", fd, clientes);
+        return ESP_OK;
+    }
+    // la app no manda nada; ping, pong y close los contesta el servidor
+    uint8_t buf[32];
+    httpd_ws_frame_t frame = {.payload = buf};
+    return httpd_ws_recv_frame(req, &frame, sizeof(buf));
+}
+
+static void cabeceras_json(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+}
+
+static esp_err_t ultimas_handler(httpd_req_t *req)
+{
+    static telemetria_lectura_t copia[API_MAX_NODOS];
+    static uint32_t t[API_MAX_NODOS];
+    int num = 0;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    for (int i = 0; i < API_MAX_NODOS; i++)
+    {
+        if (ultimas[i].valida)
+        {
+            copia[num] = ultimas[i].lectura;
+            t[num++] = ultimas[i].t;
+        }
+    }
+    xSemaphoreGive(mutex);
+
+    cabeceras_json(req);
+    char buf[256];
+    snprintf(buf, sizeof(buf), "{\"t\":%lu,\"nodos\":[", (unsigned long)time(NULL));
+    httpd_resp_sendstr_chunk(req, buf);
+    for (int i = 0; i < num; i++)
+    {
+        int n = snprintf(buf, sizeof(buf), "%s{\"nodo\":%u,\"t\":%lu,\"secuencia\":%u", i > 0 ? "," : "",
+                         copia[i].origen, (unsigned long)t[i], copia[i].secuencia);
+        for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+        {
+            n += snprintf(buf + n, sizeof(buf) - n, ",\"%s\":", parametros[p]);
+            n += json_float(buf + n, sizeof(buf) - n, telemetria_valor(&copia[i], (telemetria_parametro_t)p));
+        }
+        snprintf(buf + n, sizeof(buf) - n, "}");
+        httpd_resp_sendstr_chunk(req, buf);
+    }
+    httpd_resp_sendstr_chunk(req, "]}");
+    return httpd_resp_sendstr_chunk(req, NULL);
+}
+
+// Indice del nombre en la tabla, -1 si no esta
+static int buscar_nombre(const char *nombre, const char *const *tabla, int num)
+{
+    for (int i = 0; i < num; i++)
+    {
+        if (strcmp(nombre, tabla[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static esp_err_t historia_handler(httpd_req_t *req)
+{
+    char query[128] = "";
+    char valor[16];
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+
+    uint8_t nodo = SERIE_CUALQUIER_NODO;
+    int parametro = TELEMETRIA_TEMPERATURA;
+    int nivel = SERIE_CRUDO;
+    uint32_t hasta = (uint32_t)time(NULL);
+    uint32_t desde = hasta - API_HISTORIA_S;
+    if (httpd_query_key_value(query, "nodo", valor, sizeof(valor)) == ESP_OK && strcmp(valor, "*") != 0)
+        nodo = (uint8_t)atoi(valor);
+    if (httpd_query_key_value(query, "parametro", valor, sizeof(valor)) == ESP_OK)
+        parametro = buscar_nombre(valor, parametros, TELEMETRIA_NUM_PARAMETROS);
+    if (httpd_query_key_value(query, "nivel", valor, sizeof(valor)) == ESP_OK)
+        nivel = buscar_nombre(valor, niveles, SERIE_NUM_NIVELES);
+    if (httpd_query_key_value(query, "desde", valor, sizeof(valor)) == ESP_OK)
+        desde = (uint32_t)strtoul(valor, NULL, 10);
+    if (httpd_query_key_value(query, "hasta", valor, sizeof(valor)) == ESP_OK)
+        hasta = (uint32_t)strtoul(valor, NULL, 10);
+    if (parametro < 0 || nivel < 0)
+    {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "parametro: temp|ec|ph|tds, nivel: crudo|minuto|hora");
+    }
+
+    // se copian los puntos para no tener el historico bloqueado mientras se envian
+    serie_punto_t *puntos = malloc(API_MAX_PUNTOS * sizeof(serie_punto_t));
+    if (puntos == NULL)
+    {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "sin memoria");
+    }
+    int num = historia((serie_nivel_t)nivel, nodo, (telemetria_parametro_t)parametro, desde, hasta, puntos,
+                       API_MAX_PUNTOS);
+    if (num < 0)
+    {
+        free(puntos);
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "historico no disponible");
+    }
+
+    cabeceras_json(req);
+    // [t, nodo, muestras, min, max, media] por punto, en trozos de hasta un buffer
+    char buf[1024];
+    int n = snprintf(buf, sizeof(buf), "{\"parametro\":\"%s\",\"nivel\":\"%s\",\"completo\":%s,\"puntos\":[",
+                     parametros[parametro], niveles[nivel], num < API_MAX_PUNTOS ? "true" : "false");
+    for (int i = 0; i < num; i++)
+    {
+        // deja sitio para el peor punto y el cierre "]}"
+        if (n > (int)sizeof(buf) - API_PUNTO_MAX - 3)
+        {
+            httpd_resp_send_chunk(req, buf, n);
+            n = 0;
+        }
+        n += snprintf(buf + n, sizeof(buf) - n, "%s[%lu,%u,%u,", i > 0 ? "," : "", (unsigned long)puntos[i].t,
+                      puntos[i].nodo, puntos[i].muestras);
+        n += json_float(buf + n, sizeof(buf) - n, puntos[i].min);
+        buf[n++] = ',';
+        n += json_float(buf + n, sizeof(buf) - n, puntos[i].max);
+        buf[n++] = ',';
+        n += json_float(buf + n, sizeof(buf) - n, puntos[i].media);
+        buf[n++] = ']';
+    }
+    n += snprintf(buf + n, sizeof(buf) - n, "]}");
+    httpd_resp_send_chunk(req, buf, n);
+    free(puntos);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+esp_err_t api_iniciar(api_historia_t consulta)
+{
+    historia = consulta;
+    mutex = xSemaphoreCreateMutex();
+    difusion_iniciar(&difusion);
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = API_PUERTO;
+    config.max_open_sockets = API_MAX_SOCKETS;
+    config.send_wait_timeout = API_ENVIO_TIMEOUT_S;
+    config.lru_purge_enable = true; // una app que reconecta sin cerrar no deja al servidor sin sockets
+    config.close_fn = cerrar_sesion;
+    esp_err_t err = httpd_start(&servidor, &config);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "No se pudo arrancar el servidor: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    const httpd_uri_t uris[] = {
+        {.uri = "/api/ultimas", .method = HTTP_GET, .handler = ultimas_handler},
+        {.uri = "/api/historia", .method = HTTP_GET, .handler = historia_handler},
+        {.uri = "/api/ws", .method = HTTP_GET, .handler = ws_handler, .is_websocket = true},
+    };
+    for (int i = 0; i < (int)(sizeof(uris) / sizeof(uris[0])); i++)
+    {
+        httpd_register_uri_handler(servidor, &uris[i]);
+    }
+    ESP_LOGI(TAG, "API local en el puerto %d", API_PUERTO);
+    return ESP_OK;
+}
+
+void api_publicar(const telemetria_lectura_t *lectura, uint32_t t)
+{
+    if (servidor == NULL)
+    {
+        return;
+    }
+    uint8_t mensaje[DIFUSION_MENSAJE_LEN];
+    difusion_codificar(lectura, t, mensaje);
+    uint32_t ahora = ahora_ms();
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    int libre = -1;
+    int i = 0;
+    for (; i < API_MAX_NODOS && !(ultimas[i].valida && ultimas[i].lectura.origen == lectura->origen); i++)
+    {
+        if (!ultimas[i].valida && libre < 0)
+            libre = i;
+    }
+    if (i == API_MAX_NODOS)
+        i = libre;
+    if (i >= 0)
+    {
+        ultimas[i].valida = true;
+        ultimas[i].t = t;
+        ultimas[i].lectura = *lectura;
+    }
+    difusion_publicar(&difusion, mensaje, ahora);
+    enviar_pendientes();
+    int atascado = difusion_atascado(&difusion, ahora);
+    xSemaphoreGive(mutex);
+
+    if (atascado != DIFUSION_LIBRE)
+    {
+        ESP_LOGW(TAG, "Cliente %d sin recibir nada en %d ms, se cierra", atascado, DIFUSION_ATASCO_MS);
+        httpd_sess_trigger_close(servidor, atascado);
+    }
+}
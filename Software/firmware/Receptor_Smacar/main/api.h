@@ -0,0 +1,35 @@
+#ifndef API_H
+#define API_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "telemetria.h"
+#include "serie.h"
+
+// --------API local para la app movil---------
+// Servidor HTTP en la red local (esp_http_server): la app lee los datos sin pasar por Blynk y sigue funcionando
+// sin internet.
+//  GET /api/ultimas    ultima lectura de cada nodo, JSON
+//  GET /api/historia?nodo=<n|*>&parametro=<temp|ec|ph|tds>&nivel=<crudo|minuto|hora>&desde=<s>&hasta=<s>
+//                      puntos del historico (serie.h), JSON. Por defecto: todos los nodos, temp, crudo, ultima hora
+//  GET /api/ws         WebSocket: un mensaje binario de DIFUSION_MENSAJE_LEN bytes (difusion.h) por cada lectura
+//                      nueva, con cola por cliente
+#define API_PUERTO 80
+#define API_MAX_SOCKETS 7     // HTTPD_DEFAULT_CONFIG; LWIP_MAX_SOCKETS (10) menos los 3 internos del servidor
+#define API_ENVIO_TIMEOUT_S 2 // tope de un envio bloqueado (se comprueba antes que el socket tenga sitio)
+#define API_MAX_NODOS 16
+#define API_MAX_PUNTOS 500    // por consulta de historico
+#define API_HISTORIA_S 3600
+
+// Consulta del historico; la implementa quien tiene el serie_t y su mutex. Copia hasta max puntos y devuelve
+// cuantos, -1 si no hay historico
+typedef int (*api_historia_t)(serie_nivel_t nivel, uint8_t nodo, telemetria_parametro_t parametro, uint32_t desde,
+                              uint32_t hasta, serie_punto_t *puntos, int max);
+
+// Arranca el servidor. Llamar con la red ya iniciada
+esp_err_t api_iniciar(api_historia_t historia);
+
+// Lectura nueva: actualiza las ultimas y la encola para los clientes WebSocket. t en s desde 1970, 0 sin hora
+void api_publicar(const telemetria_lectura_t *lectura, uint32_t t);
+
+#endif
@@ -0,0 +1,592 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/spi_master.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sx127x_registers.h"
+#include "sx127x_scheduler.h"
+#include "gateway.h"
+
+#define IRQ_FLAG_PAYLOAD_CRC_ERROR 0x20
+#define IRQ_FLAG_RXDONE 0x40
+
+// bits de notificacion de la tarea de interrupciones: DIO0 en los bits bajos, envios nuevos desde el 8, timers
+// de ciclo desde el 16 y el timer del planificador de envios en el 24
+#define BIT_DIO(i) (1UL << (i))
+#define BIT_TX(i) (1UL << (8 + (i)))
+#define BITS_TX (0xFFUL << 8)
+#define BIT_TIMER(i) (1UL << (16 + (i)))
+#define BIT_PLANIFICADOR (1UL << 24)
+
+#if GATEWAY_MAX_RADIOS > CONFIG_SX127X_SCHEDULER_MAX_DEVICES || GATEWAY_MAX_RADIOS > CONFIG_SX127X_SCHEDULER_MAX_JOBS
+#error "El planificador de envios no tiene sitio para todas las radios del gateway"
+#endif
+
+typedef enum
+{
+    ESTADO_RX_CONTINUO = 0,
+    ESTADO_DORMIDO,
+    ESTADO_CAD,
+    ESTADO_RX_VENTANA,
+    ESTADO_TX
+} radio_estado_t;
+
+static const char *TAG = "GATEWAY";
+
+typedef struct
+{
+    sx127x device; // primer campo: el callback recibe sx127x * y se recupera la radio con un cast
+    spi_device_handle_t spi;
+    gateway_stats_t stats;
+    uint32_t paquetes_ultimo_log;
+    gateway_ciclo_t ciclo;
+    radio_estado_t estado; // solo lo cambia la tarea de interrupciones
+    bool implicito;
+    esp_timer_handle_t timer;
+    // envio: gateway_enviar llena los datos y activa tx_ocupado; la tarea de interrupciones programa el trabajo
+    // en el planificador y libera tx_ocupado al terminar la transmision o si falla
+    bool transmite; // cabecera explicita: acepta envios
+    atomic_bool tx_ocupado;
+    uint64_t tx_hora_ms; // en la escala del planificador, esp_timer_get_time() en ms
+    uint8_t tx_len;
+    uint8_t tx_datos[GATEWAY_TX_MAX_PAYLOAD];
+    sx127x_scheduler_job envio;
+} gateway_radio_t;
+
+static gateway_radio_t radios[GATEWAY_MAX_RADIOS];
+static int num_radios = 0;
+static TaskHandle_t tarea_irq = NULL;
+static TaskHandle_t tarea_consumidor = NULL;
+static int64_t ultimo_log_us = 0;
+
+// Envios de todas las radios. Solo lo usa la tarea de interrupciones
+static sx127x_scheduler planificador;
+static esp_timer_handle_t timer_planificador = NULL;
+
+// Cola SPSC sin locks: solo la tarea de interrupciones escribe (tail) y solo el consumidor lee (head)
+static gateway_packet_t cola[GATEWAY_QUEUE_LEN];
+static atomic_uint cola_head = 0;
+static atomic_uint cola_tail = 0;
+
+// Devuelve el siguiente hueco libre para escribir el paquete directamente en la cola, NULL si esta llena
+static gateway_packet_t *cola_reservar(void)
+{
+    unsigned tail = atomic_load_explicit(&cola_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&cola_head, memory_order_acquire);
+    if (tail - head == GATEWAY_QUEUE_LEN)
+    {
+        return NULL;
+    }
+    return &cola[tail & (GATEWAY_QUEUE_LEN - 1)];
+}
+
+static void cola_publicar(void)
+{
+    unsigned tail = atomic_load_explicit(&cola_tail, memory_order_relaxed);
+    atomic_store_explicit(&cola_tail, tail + 1, memory_order_release);
+}
+
+static bool cola_pop(gateway_packet_t *packet)
+{
+    unsigned head = atomic_load_explicit(&cola_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&cola_tail, memory_order_acquire);
+    if (head == tail)
+    {
+        return false;
+    }
+    *packet = cola[head & (GATEWAY_QUEUE_LEN - 1)];
+    atomic_store_explicit(&cola_head, head + 1, memory_order_release);
+    return true;
+}
+
+// Cada DIO0 solo marca su bit; las radios comparten el bus SPI, asi que se atienden en una sola tarea
+static void IRAM_ATTR gateway_isr(void *arg)
+{
+    BaseType_t despertar = pdFALSE;
+    xTaskNotifyFromISR(tarea_irq, BIT_DIO((uint32_t)(uintptr_t)arg), eSetBits, &despertar);
+    portYIELD_FROM_ISR(despertar);
+}
+
+static void gateway_timer_cb(void *arg)
+{
+    xTaskNotify(tarea_irq, BIT_TIMER((uint32_t)(uintptr_t)arg), eSetBits);
+}
+
+static void gateway_timer_planificador_cb(void *arg)
+{
+    xTaskNotify(tarea_irq, BIT_PLANIFICADOR, eSetBits);
+}
+
+static uint32_t bw_hz(sx127x_bw_t bw)
+{
+    switch (bw)
+    {
+    case SX127x_BW_7800:
+        return 7800;
+    case SX127x_BW_10400:
+        return 10400;
+    case SX127x_BW_15600:
+        return 15600;
+    case SX127x_BW_20800:
+        return 20800;
+    case SX127x_BW_31250:
+        return 31250;
+    case SX127x_BW_41700:
+        return 41700;
+    case SX127x_BW_62500:
+        return 62500;
+    case SX127x_BW_250000:
+        return 250000;
+    case SX127x_BW_500000:
+        return 500000;
+    default:
+        return 125000;
+    }
+}
+
+esp_err_t gateway_calc_ciclo(sx127x_sf_t sf, sx127x_bw_t bw, uint16_t preambulo_tx, gateway_ciclo_t *ciclo)
+{
+    uint32_t sf_num = (uint32_t)sf >> 4;
+    uint32_t simbolo_us = (uint32_t)((1000000ULL << sf_num) / bw_hz(bw));
+
+    // el preambulo puede empezar justo despues de iniciar un CAD: el siguiente CAD tiene que terminar
+    // dejando GATEWAY_LOCK_SIMBOLOS de preambulo, asi que periodo + CAD <= preambulo - lock
+    int32_t dormir = (int32_t)preambulo_tx - GATEWAY_LOCK_SIMBOLOS - 2 * GATEWAY_CAD_SIMBOLOS;
+    if (dormir <= 0)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // simbolos del paquete mas largo (CR 4/5, header explicito, CRC), LDRO por encima de 16 ms por simbolo
+    uint32_t de = simbolo_us > 16000 ? 1 : 0;
+    int32_t bits = 8 * GATEWAY_DC_MAX_PAYLOAD - 4 * (int32_t)sf_num + 28 + 16;
+    uint32_t bloque = 4 * (sf_num - 2 * de);
+    uint32_t payload = 8 + (bits > 0 ? (bits + bloque - 1) / bloque : 0) * 5;
+
+    ciclo->simbolo_us = simbolo_us;
+    ciclo->cad_us = GATEWAY_CAD_SIMBOLOS * simbolo_us;
+    ciclo->dormir_us = (uint32_t)dormir * simbolo_us;
+    ciclo->ventana_us = (preambulo_tx + 5 + payload) * simbolo_us;
+    ciclo->corriente_ua = (uint32_t)(((uint64_t)GATEWAY_I_RX_UA * ciclo->cad_us + (uint64_t)GATEWAY_I_SLEEP_UA * ciclo->dormir_us) /
+                                     (ciclo->cad_us + ciclo->dormir_us));
+    return ESP_OK;
+}
+
+// Las siguientes funciones solo se llaman desde la tarea de interrupciones
+static void radio_dormir(gateway_radio_t *radio)
+{
+    radio->estado = ESTADO_DORMIDO;
+    sx127x_set_opmod(SX127x_MODE_SLEEP, SX127x_MODULATION_LORA, &radio->device);
+    esp_timer_stop(radio->timer);
+    esp_timer_start_once(radio->timer, radio->ciclo.dormir_us);
+}
+
+static void radio_cad(gateway_radio_t *radio)
+{
+    radio->estado = ESTADO_CAD;
+    sx127x_set_opmod(SX127x_MODE_CAD, SX127x_MODULATION_LORA, &radio->device);
+}
+
+static void cad_callback(sx127x *device, int cad_detectado)
+{
+    gateway_radio_t *radio = (gateway_radio_t *)device;
+    radio->stats.cad_ciclos++;
+    if (!cad_detectado)
+    {
+        radio_dormir(radio);
+        return;
+    }
+    // RX cuanto antes para no perder el resto del preambulo
+    radio->estado = ESTADO_RX_VENTANA;
+    sx127x_set_opmod(SX127x_MODE_RX_CONT, SX127x_MODULATION_LORA, device);
+    radio->stats.cad_detectados++;
+    esp_timer_start_once(radio->timer, radio->ciclo.ventana_us);
+}
+
+static void rx_callback(sx127x *device, uint8_t *data, uint16_t data_length)
+{
+    gateway_radio_t *radio = (gateway_radio_t *)device;
+    int16_t rssi = 0;
+    sx127x_rx_get_packet_rssi(device, &rssi);
+
+    radio->stats.paquetes++;
+    int bin = (rssi - GATEWAY_RSSI_MIN) / GATEWAY_RSSI_BIN;
+    if (bin < 0)
+        bin = 0;
+    if (bin >= GATEWAY_RSSI_BINS)
+        bin = GATEWAY_RSSI_BINS - 1;
+    radio->stats.rssi_hist[bin]++;
+
+    gateway_packet_t *packet = cola_reservar();
+    if (packet == NULL)
+    {
+        radio->stats.descartados++;
+        return;
+    }
+    packet->radio = (uint8_t)(radio - radios);
+    packet->len = data_length > GATEWAY_MAX_PAYLOAD ? GATEWAY_MAX_PAYLOAD : data_length;
+    memcpy(packet->data, data, packet->len);
+    packet->data[packet->len] = '\0';
+    packet->timestamp_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    packet->rssi = rssi;
+    packet->implicito = radio->implicito;
+    packet->snr = 0;
+    sx127x_lora_rx_get_packet_snr(device, &packet->snr);
+    cola_publicar();
+    xTaskNotifyGive(tarea_consumidor);
+}
+
+static void envio_fallido(gateway_radio_t *radio)
+{
+    ESP_LOGW(TAG, "Radio %d: no se pudo transmitir", (int)(radio - radios));
+    radio->estado = ESTADO_RX_CONTINUO;
+    sx127x_set_opmod(SX127x_MODE_RX_CONT, SX127x_MODULATION_LORA, &radio->device);
+    atomic_store(&radio->tx_ocupado, false);
+}
+
+// Llamadas por el planificador GATEWAY_TX_PREPARAR_MS antes de la hora y a la hora del envio
+static int envio_preparar(sx127x_scheduler_job *job)
+{
+    // un paquete que se estuviera recibiendo se pierde: la radio es half duplex
+    gateway_radio_t *radio = job->ctx;
+    radio->estado = ESTADO_TX;
+    int err = sx127x_set_opmod(SX127x_MODE_STANDBY, SX127x_MODULATION_LORA, &radio->device);
+    if (err == SX127X_OK)
+        err = sx127x_lora_tx_set_for_transmission(radio->tx_datos, radio->tx_len, &radio->device);
+    if (err != SX127X_OK)
+        envio_fallido(radio);
+    return err;
+}
+
+static int envio_transmitir(sx127x_scheduler_job *job)
+{
+    gateway_radio_t *radio = job->ctx;
+    int err = sx127x_set_opmod(SX127x_MODE_TX, SX127x_MODULATION_LORA, &radio->device);
+    if (err != SX127X_OK)
+        envio_fallido(radio);
+    return err;
+}
+
+static void radio_programar_envio(gateway_radio_t *radio)
+{
+    uint32_t toa_us = 0;
+    sx127x_lora_get_time_on_air(radio->tx_len, &radio->device, &toa_us);
+    radio->envio = (sx127x_scheduler_job){
+        .device = &radio->device,
+        .deadline_ms = radio->tx_hora_ms,
+        .airtime_ms = toa_us / 1000 + 1,
+        .prepare = envio_preparar,
+        .transmit = envio_transmitir,
+        .ctx = radio};
+    if (sx127x_scheduler_add(&radio->envio, &planificador) != SX127X_OK)
+    {
+        envio_fallido(radio);
+    }
+}
+
+// Ejecuta lo que toque del planificador y deja el timer para el siguiente evento
+static void planificador_ejecutar(void)
+{
+    uint64_t siguiente_ms;
+    int64_t ahora_us = esp_timer_get_time();
+    sx127x_scheduler_run((uint64_t)ahora_us / 1000, &planificador, &siguiente_ms);
+    esp_timer_stop(timer_planificador);
+    if (siguiente_ms != UINT64_MAX)
+    {
+        int64_t espera_us = (int64_t)(siguiente_ms * 1000) - esp_timer_get_time();
+        esp_timer_start_once(timer_planificador, espera_us > 0 ? espera_us : 1);
+    }
+}
+
+static void tx_callback(sx127x *device)
+{
+    gateway_radio_t *radio = (gateway_radio_t *)device;
+    radio->stats.downlinks++;
+    radio->estado = ESTADO_RX_CONTINUO;
+    sx127x_set_opmod(SX127x_MODE_RX_CONT, SX127x_MODULATION_LORA, device);
+    atomic_store(&radio->tx_ocupado, false);
+}
+
+static void gateway_irq_task(void *arg)
+{
+    uint32_t pendientes;
+    while (1)
+    {
+        xTaskNotifyWait(0, UINT32_MAX, &pendientes, portMAX_DELAY);
+        for (int i = 0; i < num_radios; i++)
+        {
+            gateway_radio_t *radio = &radios[i];
+            // DIO0 primero: si la ventana de RX vence a la vez que llega el paquete, el FIFO aun se puede leer
+            if ((pendientes & BIT_DIO(i)) != 0)
+            {
+                // la libreria descarta los paquetes con CRC invalido sin avisar, se cuentan antes de limpiar las flags
+                uint8_t flags = 0;
+                if (sx127x_read_register(REGIRQFLAGS, &radio->device.spi_device, &flags) == SX127X_OK &&
+                    (flags & (IRQ_FLAG_RXDONE | IRQ_FLAG_PAYLOAD_CRC_ERROR)) == (IRQ_FLAG_RXDONE | IRQ_FLAG_PAYLOAD_CRC_ERROR))
+                {
+                    radio->stats.crc_errores++;
+                }
+                sx127x_handle_interrupt(&radio->device);
+                if (radio->estado == ESTADO_RX_VENTANA && (flags & IRQ_FLAG_RXDONE) != 0)
+                {
+                    radio_dormir(radio);
+                    continue;
+                }
+            }
+            if ((pendientes & BIT_TX(i)) != 0)
+            {
+                radio_programar_envio(radio);
+            }
+            if ((pendientes & BIT_TIMER(i)) != 0)
+            {
+                if (radio->estado == ESTADO_DORMIDO)
+                {
+                    radio_cad(radio);
+                }
+                else if (radio->estado == ESTADO_RX_VENTANA)
+                {
+                    radio->stats.rx_timeouts++;
+                    radio_dormir(radio);
+                }
+            }
+        }
+        // despues de programar los envios nuevos, que pueden tocar ya
+        if ((pendientes & (BITS_TX | BIT_PLANIFICADOR)) != 0)
+        {
+            planificador_ejecutar();
+        }
+    }
+}
+
+static esp_err_t radio_init(spi_host_device_t spi_host, int idx, const gateway_radio_config_t *cfg)
+{
+    gateway_radio_t *radio = &radios[idx];
+
+    if (cfg->rst != GPIO_NUM_NC)
+    {
+        gpio_set_direction(cfg->rst, GPIO_MODE_OUTPUT);
+        gpio_set_level(cfg->rst, 0);
+        vTaskDelay(pdMS_TO_TICKS(5));
+        gpio_set_level(cfg->rst, 1);
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    spi_device_interface_config_t dev_cfg = {
+        .clock_speed_hz = 8E6,
+        .spics_io_num = cfg->cs,
+        .queue_size = 16,
+        .command_bits = 0,
+        .address_bits = 8,
+        .dummy_bits = 0,
+        .mode = 0};
+    ESP_RETURN_ON_ERROR(spi_bus_add_device(spi_host, &dev_cfg, &radio->spi), TAG, "spi radio %d", idx);
+    ESP_RETURN_ON_ERROR(sx127x_create(radio->spi, &radio->device), TAG, "sx127x radio %d", idx);
+
+    sx127x *device = &radio->device;
+    ESP_RETURN_ON_ERROR(sx127x_set_opmod(SX127x_MODE_SLEEP, SX127x_MODULATION_LORA, device), TAG, "config radio %d", idx);
+    ESP_RETURN_ON_ERROR(sx127x_set_frequency(cfg->frecuencia, device), TAG, "config radio %d", idx);
+    ESP_RETURN_ON_ERROR(sx127x_lora_reset_fifo(device), TAG, "config radio %d", idx);
+    ESP_RETURN_ON_ERROR(sx127x_rx_set_lna_boost_hf(true, device), TAG, "config radio %d", idx);
+    ESP_RETURN_ON_ERROR(sx127x_set_opmod(SX127x_MODE_STANDBY, SX127x_MODULATION_LORA, device), TAG, "config radio %d", idx);
+    ESP_RETURN_ON_ERROR(sx127x_rx_set_lna_gain(SX127x_LNA_GAIN_AUTO, device), TAG, "config radio %d", idx);
+    ESP_RETURN_ON_ERROR(sx127x_lora_set_bandwidth(cfg->bw, device), TAG, "config radio %d", idx);
+    radio->implicito = cfg->longitud_fija > 0;
+    if (radio->implicito)
+    {
+        // el transmisor no manda longitud, CR ni CRC: tienen que coincidir con los suyos
+        sx127x_implicit_header_t cabecera = {.length = cfg->longitud_fija, .enable_crc = true, .coding_rate = SX127x_CR_4_5};
+        ESP_RETURN_ON_ERROR(sx127x_lora_set_implicit_header(&cabecera, device), TAG, "config radio %d", idx);
+    }
+    else
+    {
+        ESP_RETURN_ON_ERROR(sx127x_lora_set_implicit_header(NULL, device), TAG, "config radio %d", idx);
+        // los downlinks salen con la misma cabecera que los uplinks de control: CR 4/5 y CRC
+        sx127x_tx_header_t cabecera = {.enable_crc = true, .coding_rate = SX127x_CR_4_5};
+        ESP_RETURN_ON_ERROR(sx127x_lora_tx_set_explicit_header(&cabecera, device), TAG, "config radio %d", idx);
+        ESP_RETURN_ON_ERROR(sx127x_tx_set_pa_config(SX127x_PA_PIN_BOOST, GATEWAY_TX_DBM, device), TAG, "config radio %d", idx);
+        sx127x_tx_set_callback(tx_callback, device);
+        radio->transmite = true;
+    }
+    ESP_RETURN_ON_ERROR(sx127x_lora_set_modem_config_2(cfg->sf, device), TAG, "config radio %d", idx);
+    ESP_RETURN_ON_ERROR(sx127x_lora_set_syncword(cfg->syncword, device), TAG, "config radio %d", idx);
+    sx127x_rx_set_callback(rx_callback, device);
+
+    radio->estado = ESTADO_RX_CONTINUO;
+    if (cfg->preambulo_tx > 0)
+    {
+        if (gateway_calc_ciclo(cfg->sf, cfg->bw, cfg->preambulo_tx, &radio->ciclo) == ESP_OK)
+        {
+            esp_timer_create_args_t args = {
+                .callback = gateway_timer_cb,
+                .arg = (void *)(uintptr_t)idx,
+                .name = "gateway ciclo"};
+            ESP_RETURN_ON_ERROR(esp_timer_create(&args, &radio->timer), TAG, "timer radio %d", idx);
+            sx127x_lora_cad_set_callback(cad_callback, device);
+            radio->estado = ESTADO_CAD;
+            ESP_LOGI(TAG, "Radio %d por ciclos: CAD %lu us, sleep %lu us, ventana RX %lu us, ~%lu uA",
+                     idx, (unsigned long)radio->ciclo.cad_us, (unsigned long)radio->ciclo.dormir_us,
+                     (unsigned long)radio->ciclo.ventana_us, (unsigned long)radio->ciclo.corriente_ua);
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Radio %d: preambulo de %u simbolos muy corto para CAD por ciclos, RX continuo", idx, cfg->preambulo_tx);
+        }
+    }
+    // el receptor busca un preambulo igual de largo que el del transmisor
+    ESP_RETURN_ON_ERROR(sx127x_set_preamble_length(cfg->preambulo_tx > 8 ? cfg->preambulo_tx : 8, device), TAG, "config radio %d", idx);
+
+    gpio_set_direction(cfg->dio0, GPIO_MODE_INPUT);
+    gpio_pulldown_en(cfg->dio0);
+    gpio_pullup_dis(cfg->dio0);
+    gpio_set_intr_type(cfg->dio0, GPIO_INTR_POSEDGE);
+    ESP_RETURN_ON_ERROR(gpio_isr_handler_add(cfg->dio0, gateway_isr, (void *)(uintptr_t)idx), TAG, "isr radio %d", idx);
+
+    sx127x_mode_t modo = radio->estado == ESTADO_CAD ? SX127x_MODE_CAD : SX127x_MODE_RX_CONT;
+    ESP_RETURN_ON_ERROR(sx127x_set_opmod(modo, SX127x_MODULATION_LORA, device), TAG, "config radio %d", idx);
+    ESP_LOGI(TAG, "Radio %d escuchando en %" PRIu64 " Hz, cabecera %s", idx, cfg->frecuencia, radio->implicito ? "implicita" : "explicita");
+    return ESP_OK;
+}
+
+esp_err_t gateway_start(spi_host_device_t spi_host, gpio_num_t sck, gpio_num_t miso, gpio_num_t mosi,
+                        const gateway_radio_config_t *config, int n)
+{
+    if (n <= 0 || n > GATEWAY_MAX_RADIOS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    spi_bus_config_t bus = {
+        .mosi_io_num = mosi,
+        .miso_io_num = miso,
+        .sclk_io_num = sck,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = 0,
+    };
+    ESP_RETURN_ON_ERROR(spi_bus_initialize(spi_host, &bus, SPI_DMA_CH_AUTO), TAG, "spi bus");
+
+    sx127x_scheduler_create(GATEWAY_TX_PREPARAR_MS, &planificador);
+    esp_timer_create_args_t args = {
+        .callback = gateway_timer_planificador_cb,
+        .name = "gateway tx"};
+    ESP_RETURN_ON_ERROR(esp_timer_create(&args, &timer_planificador), TAG, "timer tx");
+
+    tarea_consumidor = xTaskGetCurrentTaskHandle();
+    if (xTaskCreatePinnedToCore(gateway_irq_task, "gateway irq", 8192, NULL, configMAX_PRIORITIES - 2, &tarea_irq, xPortGetCoreID()) != pdPASS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
+    {
+        return err;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        ESP_RETURN_ON_ERROR(radio_init(spi_host, i, &config[i]), TAG, "radio %d", i);
+        num_radios = i + 1;
+    }
+    ultimo_log_us = esp_timer_get_time();
+    return ESP_OK;
+}
+
+bool gateway_receive(gateway_packet_t *packet, TickType_t timeout)
+{
+    TickType_t inicio = xTaskGetTickCount();
+    while (!cola_pop(packet))
+    {
+        TickType_t transcurrido = xTaskGetTickCount() - inicio;
+        if (transcurrido >= timeout)
+        {
+            return false;
+        }
+        ulTaskNotifyTake(pdTRUE, timeout - transcurrido);
+    }
+    return true;
+}
+
+bool gateway_tx_libre(int radio)
+{
+    return radio >= 0 && radio < num_radios && radios[radio].transmite && radios[radio].timer == NULL &&
+           !atomic_load(&radios[radio].tx_ocupado);
+}
+
+esp_err_t gateway_enviar(int idx, const uint8_t *data, uint8_t len, uint32_t retardo_us)
+{
+    if (idx < 0 || idx >= num_radios || len == 0 || len > GATEWAY_TX_MAX_PAYLOAD)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gateway_radio_t *radio = &radios[idx];
+    // en cabecera implicita la longitud es la de la telemetria y en CAD la radio pasa la mayor parte del tiempo
+    // dormida: solo se transmite desde radios explicitas en RX continuo
+    if (!radio->transmite || radio->timer != NULL)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    bool libre = false;
+    if (!atomic_compare_exchange_strong(&radio->tx_ocupado, &libre, true))
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    memcpy(radio->tx_datos, data, len);
+    radio->tx_len = len;
+    // redondeado al ms mas cercano; el planificador solo lo toca la tarea de interrupciones
+    radio->tx_hora_ms = ((uint64_t)esp_timer_get_time() + retardo_us + 500) / 1000;
+    xTaskNotify(tarea_irq, BIT_TX(idx), eSetBits);
+    return ESP_OK;
+}
+
+void gateway_get_stats(int radio, gateway_stats_t *stats)
+{
+    if (radio < 0 || radio >= num_radios)
+    {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    *stats = radios[radio].stats;
+}
+
+void gateway_log_stats(void)
+{
+    int64_t ahora = esp_timer_get_time();
+    float segundos = (ahora - ultimo_log_us) / 1e6f;
+    ultimo_log_us = ahora;
+    if (segundos <= 0)
+        return;
+
+    float total = 0;
+    for (int i = 0; i < num_radios; i++)
+    {
+        gateway_stats_t s = radios[i].stats;
+        float pps = (s.paquetes - radios[i].paquetes_ultimo_log) / segundos;
+        radios[i].paquetes_ultimo_log = s.paquetes;
+        total += pps;
+
+        char hist[GATEWAY_RSSI_BINS * 11 + 1];
+        int pos = 0;
+        for (int b = 0; b < GATEWAY_RSSI_BINS; b++)
+        {
+            pos += snprintf(hist + pos, sizeof(hist) - pos, " %lu", (unsigned long)s.rssi_hist[b]);
+        }
+        ESP_LOGI(TAG, "Radio %d: %.2f paq/s, total=%lu, crc=%lu, descartados=%lu, downlinks=%lu, rssi[%d dBm/%d dB]:%s",
+                 i, pps, (unsigned long)s.paquetes, (unsigned long)s.crc_errores, (unsigned long)s.descartados,
+                 (unsigned long)s.downlinks, GATEWAY_RSSI_MIN, GATEWAY_RSSI_BIN, hist);
+        if (radios[i].timer != NULL)
+        {
+            // un CAD positivo que no termina en paquete es una falsa deteccion o un paquete perdido en la ventana
+            float perdidos = s.cad_detectados ? 100.0f * s.rx_timeouts / s.cad_detectados : 0;
+            ESP_LOGI(TAG, "Radio %d ciclos: cad=%lu, detectados=%lu, sin paquete=%lu (%.1f%%), consumo estimado ~%lu uA",
+                     i, (unsigned long)s.cad_ciclos, (unsigned long)s.cad_detectados, (unsigned long)s.rx_timeouts,
+                     perdidos, (unsigned long)radios[i].ciclo.corriente_ua);
+        }
+    }
+    ESP_LOGI(TAG, "Total: %.2f paq/s", total);
+}
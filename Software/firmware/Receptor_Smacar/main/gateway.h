@@ -0,0 +1,107 @@
+#ifndef GATEWAY_H
+#define GATEWAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "esp_err.h"
+#include "sx127x.h"
+
+// --------Parametros del gateway---------
+#define GATEWAY_MAX_RADIOS 4
+#define GATEWAY_QUEUE_LEN 16 // potencia de 2
+#define GATEWAY_MAX_PAYLOAD 255
+#define GATEWAY_RSSI_MIN -140 // dBm, primer bin del histograma
+#define GATEWAY_RSSI_BIN 10   // dB por bin
+#define GATEWAY_RSSI_BINS 12  // -140 .. -20 dBm
+#define GATEWAY_TX_MAX_PAYLOAD 64
+#define GATEWAY_TX_DBM 14
+#define GATEWAY_TX_PREPARAR_MS 2 // el paquete se escribe en el FIFO antes de su hora: al llegar solo falta pasar a TX
+
+// --------Recepcion por ciclos (CAD)---------
+#define GATEWAY_CAD_SIMBOLOS 2    // duracion de un CAD, redondeada hacia arriba
+#define GATEWAY_LOCK_SIMBOLOS 4   // preambulo que debe quedar al terminar el CAD para sincronizar en RX
+#define GATEWAY_DC_MAX_PAYLOAD 64 // paquete mas largo esperado, define la ventana de RX tras un CAD positivo
+#define GATEWAY_I_RX_UA 10800     // consumo SX1276 en RX/CAD (datasheet, 125 kHz)
+#define GATEWAY_I_SLEEP_UA 1      // consumo SX1276 en sleep (datasheet, redondeado)
+
+// Configuracion de cada radio SX127x (todas comparten el bus SPI)
+typedef struct
+{
+    gpio_num_t cs;
+    gpio_num_t dio0;
+    gpio_num_t rst; // GPIO_NUM_NC si no esta conectado
+    uint64_t frecuencia;
+    sx127x_sf_t sf;
+    sx127x_bw_t bw;
+    uint8_t syncword;
+    uint16_t preambulo_tx; // preambulo del transmisor en simbolos. 0: RX continuo; >0: CAD por ciclos
+    uint8_t longitud_fija; // 0: cabecera explicita; >0: cabecera implicita con esta longitud (CR 4/5, CRC)
+} gateway_radio_config_t;
+
+// Tiempos de la recepcion por ciclos, derivados del preambulo del transmisor
+typedef struct
+{
+    uint32_t simbolo_us;
+    uint32_t cad_us;     // escucha
+    uint32_t dormir_us;  // sleep entre CADs
+    uint32_t ventana_us; // RX tras un CAD positivo, cubre el resto del preambulo y el paquete mas largo
+    uint32_t corriente_ua; // consumo medio estimado de la radio sin paquetes
+} gateway_ciclo_t;
+
+// Paquete recibido, copiado a la cola compartida
+typedef struct
+{
+    uint8_t radio;
+    uint16_t len;
+    int16_t rssi;
+    float snr;
+    bool implicito; // recibido por una radio con cabecera implicita (trama de longitud fija)
+    uint32_t timestamp_ms;
+    uint8_t data[GATEWAY_MAX_PAYLOAD + 1]; // siempre terminado en '\0'
+} gateway_packet_t;
+
+// Estadisticas por radio. Solo las escribe la tarea de interrupciones
+typedef struct
+{
+    uint32_t paquetes;
+    uint32_t crc_errores;
+    uint32_t descartados; // cola llena
+    uint32_t cad_ciclos;
+    uint32_t cad_detectados;
+    uint32_t rx_timeouts; // CAD positivo sin paquete (falsa deteccion o paquete perdido)
+    uint32_t downlinks;   // transmisiones terminadas
+    uint32_t rssi_hist[GATEWAY_RSSI_BINS];
+} gateway_stats_t;
+
+// Inicializa el bus SPI, las radios y la tarea de interrupciones, y deja todas las radios en RX continuo.
+// La tarea que llama a gateway_start es la que debe consumir los paquetes con gateway_receive.
+esp_err_t gateway_start(spi_host_device_t spi_host, gpio_num_t sck, gpio_num_t miso, gpio_num_t mosi,
+                        const gateway_radio_config_t *radios, int num_radios);
+
+// Calcula los tiempos de escucha/sleep para que un CAD caiga siempre dentro del preambulo.
+// Devuelve ESP_ERR_INVALID_SIZE si el preambulo es demasiado corto para dormir entre CADs.
+esp_err_t gateway_calc_ciclo(sx127x_sf_t sf, sx127x_bw_t bw, uint16_t preambulo_tx, gateway_ciclo_t *ciclo);
+
+// Saca el siguiente paquete de la cola. Espera como maximo timeout ticks; devuelve false si no hay paquetes.
+bool gateway_receive(gateway_packet_t *packet, TickType_t timeout);
+
+// Transmite data por una radio con cabecera explicita en RX continuo, retardo_us despues de la llamada (con
+// resolucion de 1 ms). Los envios de todas las radios comparten un planificador (sx127x_scheduler.h) y un solo
+// timer. La radio deja de recibir GATEWAY_TX_PREPARAR_MS antes, al escribir el FIFO, y vuelve a RX continuo al
+// terminar. Hay un solo envio en curso por radio: devuelve ESP_ERR_INVALID_STATE si ya hay uno programado o
+// transmitiendose.
+esp_err_t gateway_enviar(int radio, const uint8_t *data, uint8_t len, uint32_t retardo_us);
+
+// true si la radio puede aceptar un envio ahora
+bool gateway_tx_libre(int radio);
+
+// Copia las estadisticas de una radio
+void gateway_get_stats(int radio, gateway_stats_t *stats);
+
+// Imprime paquetes/s por radio (desde la llamada anterior), errores CRC, histograma de RSSI y estadisticas de CAD
+void gateway_log_stats(void);
+
+#endif
@@ -1,16 +1,30 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
 #include <string.h>
+#include <time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "driver/uart.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "esp_http_client.h"
 #include "esp_tls.h"
 #include "nvs_flash.h"
-#include "esp_wifi.h"
-#include "esp_event.h"
-#include "esp_netif.h"
+#include "nvs.h"
+#include "esp_sntp.h"
+#include "esp_partition.h"
+#include "gateway.h"
+#include "telemetria.h"
+#include "comandos.h"
+#include "downlink.h"
+#include "alertas.h"
+#include "nodos.h"
+#include "serie.h"
+#include "api.h"
+#include "nube.h"
+#include "red.h"
 
 #define UART_PORT_NUM UART_NUM_1
 #define UART_BAUD_RATE 9600
@@ -18,24 +32,88 @@
 #define UART_RX_PIN GPIO_NUM_16 //--RX ESP32 <- TX LoRa---
 #define BUF_SIZE 1024
 
+// --------Modo gateway---------
+// 0: modulo LoRa por UART (comandos AT). 1: varias radios SX127x en el bus SPI, cada una en su canal/SF
+#define MODO_GATEWAY 0
+#define GATEWAY_SPI_HOST SPI2_HOST
+#define GATEWAY_SCK GPIO_NUM_5
+#define GATEWAY_MISO GPIO_NUM_19
+#define GATEWAY_MOSI GPIO_NUM_27
+#define GATEWAY_STATS_MS 60000
+#define GATEWAY_RADIO_DOWNLINK 0 // radio explicita por la que salen los comandos
+#define GATEWAY_CLASE_C_MS 1000  // cada cuanto se revisa la cola de downlinks clase C
+#define CONSOLA_UART UART_NUM_0  // comandos de configuracion por el monitor serie
+
+#if MODO_GATEWAY
+static const gateway_radio_config_t gateway_radios[] = {
+    // cs, dio0, rst, frecuencia, sf, bw, syncword, preambulo_tx, longitud_fija
+    // preambulo_tx > 0 activa la recepcion por ciclos (CAD + sleep); necesita que el transmisor use un preambulo
+    // largo (p. ej. 16 simbolos) porque con 8 no queda tiempo para dormir entre CADs
+    // longitud_fija > 0 recibe con cabecera implicita: canal de telemetria binaria del transmisor en MODO_RADIO 1.
+    // Texto y mensajes de control (cabecera explicita) llegan por la primera radio
+    {GPIO_NUM_18, GPIO_NUM_26, GPIO_NUM_23, 914900000, SX127x_SF_12, SX127x_BW_125000, 0x12, 0, 0},
+    {GPIO_NUM_4, GPIO_NUM_25, GPIO_NUM_NC, 914700000, SX127x_SF_12, SX127x_BW_125000, 0x12, 0, TELEMETRIA_LEN},
+};
+#endif
+
+// --------Subida a la nube---------
+// 0: Blynk por HTTP, un GET por valor. 1: MQTT con lotes por nodo y QoS1 (nube_mqtt.c, broker alli)
+#define NUBE_MQTT 0
 #define BLYNK_AUTH_TOKEN "UDCOVVtPTGNn6brczRzDivWzspzKN5jG" //---token unico del dashboard
 #define WIFI_SSID "*********" //---nombre del wifi
 #define WIFI_PASS "***********" //===pass del wifi 
 
 // --------Parametros---------
+// Rangos de las reglas de alerta por defecto, para todos los nodos; las reglas guardadas en NVS los reemplazan
 #define TEMP_MIN 05.0
 #define TEMP_MAX 25.0
 #define EC_MAX 35.00 // (en mS/cm)
 #define PH_MIN 6.5
 #define PH_MAX 8.5
 #define TDS_MAX 500.0 // mg/L
+#define TEMP_HISTERESIS 0.5
+#define EC_HISTERESIS 1.0
+#define PH_HISTERESIS 0.1
+#define TDS_HISTERESIS 10.0
+#define ALERTA_DURACION_MS 10000  // fuera de rango al menos este tiempo antes de avisar
+#define ALERTA_ESCALADO_MS 900000 // sigue fuera: nuevo aviso con un nivel mas, hasta ALERTA_MAX_NIVEL
+#define ALERTA_MAX_NIVEL 3
+#define ALERTA_TOKENS 3           // avisos seguidos por tipo de evento...
+#define ALERTA_RECARGA_MS 600000  // ...y despues uno cada 10 min
+#define NVS_ALERTAS "alertas"
+#define NODO_TEXTO 1 // los mensajes de texto del modo AT no llevan origen: transmisor con AT+LORAADDR=1
+
+#define OFFLINE_TIMEOUT_MS 1500000 // 15min sin datos de un nodo (ajusta si es necesario)
 
-#define OFFLINE_TIMEOUT_MS 1500000 // 15min (ajusta si es necesario)
-uint32_t last_data_time = 0;
-bool sensores_reportados_offline = false;
+// --------Historico en flash---------
+#define SERIE_PARTICION "serie" // particion de datos en partitions.csv
+#define SERIE_SYNC_MS 60000     // cada cuanto se vacian los buffers y se escriben los resumenes terminados
+#define SERIE_HORA_VALIDA 1700000000 // hasta que SNTP pone el reloj en hora no se guarda nada
+#define SERIE_CONSOLA_MAX 100   // puntos por consulta desde la consola
 
 static const char *TAG = "LORA_RX";
 
+// Tipos de evento de Blynk, en el orden de telemetria_parametro_t: el indice es alertas_regla_t.evento
+static const struct
+{
+    const char *evento;
+    const char *nombre;
+} eventos_blynk[] = {
+    {"temperatura_fuera_de_rango", "Temperatura"},
+    {"conductividad_fuera_de_rango", "Conductividad"},
+    {"ph_fuera_de_rango", "pH"},
+    {"tds_fuera_de_rango", "TDS"},
+};
+
+static alertas_t alertas;
+static SemaphoreHandle_t alertas_mutex;
+// Nodos vistos y su timeout de offline; solo lo usa la tarea que recibe (gateway_loop o el bucle UART)
+static nodos_t nodos;
+// Historico local: lo escribe la tarea que recibe y lo consulta la consola
+static serie_t serie;
+static bool serie_activa = false;
+static SemaphoreHandle_t serie_mutex;
+
 // Prototipo para evitar warnings
 void uart_init(void);
 
@@ -90,57 +168,12 @@ void urlencode(const char *src, char *dest, size_t dest_len)
     dest[j] = 0;
 }
 
-// ----------- FUNCIONES WIFI -----------
-static void wifi_event_handler(void *arg, esp_event_base_t event_base,
-                               int32_t event_id, void *event_data)
-{
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START)
-    {
-        esp_wifi_connect();
-    }
-    else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED)
-    {
-        esp_wifi_connect();
-        ESP_LOGI(TAG, "Conectando al WiFi...");
-    }
-    else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP)
-    {
-        ESP_LOGI(TAG, "WiFi conectado!");
-    }
-}
-
-void wifi_init_sta(void)
+// Hora real para el historico
+void hora_init(void)
 {
-    esp_netif_init();
-    esp_event_loop_create_default();
-    esp_netif_create_default_wifi_sta();
-
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    esp_wifi_init(&cfg);
-
-    esp_event_handler_instance_t instance_any_id;
-    esp_event_handler_instance_t instance_got_ip;
-    esp_event_handler_instance_register(WIFI_EVENT,
-                                        ESP_EVENT_ANY_ID,
-                                        &wifi_event_handler,
-                                        NULL,
-                                        &instance_any_id);
-    esp_event_handler_instance_register(IP_EVENT,
-                                        IP_EVENT_STA_GOT_IP,
-                                        &wifi_event_handler,
-                                        NULL,
-                                        &instance_got_ip);
-
-    wifi_config_t wifi_config = {
-        .sta = {
-            .ssid = WIFI_SSID,
-            .password = WIFI_PASS,
-            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
-        },
-    };
-    esp_wifi_set_mode(WIFI_MODE_STA);
-    esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
-    esp_wifi_start();
+    esp_sntp_setoperatingmode(ESP_SNTP_OPMODE_POLL);
+    esp_sntp_setservername(0, "pool.ntp.org");
+    esp_sntp_init();
 }
 
 // ----------- ENVÍO A BLYNK -----------
@@ -151,6 +184,14 @@ void send_to_blynk(float temperatura, float ec, float ph, float tds)
     esp_http_client_handle_t client;
     esp_err_t err;
 
+    // sin WiFi cada peticion esperaria su timeout y la lectura se pierde igual
+    if (!red_con_ip())
+    {
+        ESP_LOGW("BLYNK", "Sin WiFi, no se envia la lectura");
+        return;
+    }
+    red_actividad();
+
     // Temperatura en V0
     snprintf(url, sizeof(url), "http://blynk.cloud/external/api/update?token=%s&V0=%.2f", BLYNK_AUTH_TOKEN, temperatura);
     config.url = url;
@@ -187,6 +228,12 @@ void send_to_blynk(float temperatura, float ec, float ph, float tds)
 // Enviar evento a Blynk
 void send_blynk_event(const char *event, const char *desc)
 {
+    if (!red_con_ip())
+    {
+        ESP_LOGW("BLYNK", "Sin WiFi, no se envia el evento %s", event);
+        return;
+    }
+    red_actividad();
     char desc_url[128];
     urlencode(desc, desc_url, sizeof(desc_url));
     char url[256];
@@ -198,6 +245,24 @@ void send_blynk_event(const char *event, const char *desc)
     esp_http_client_cleanup(client);
 }
 
+static void blynk_lectura(const telemetria_lectura_t *lectura, uint32_t t)
+{
+    (void)t;
+    send_to_blynk(lectura->temperatura, lectura->ec, lectura->ph, lectura->tds);
+}
+
+static const nube_backend_t nube_blynk = {
+    .nombre = "Blynk",
+    .lectura = blynk_lectura,
+    .evento = send_blynk_event,
+};
+
+#if NUBE_MQTT
+static const nube_backend_t *nube = &nube_mqtt;
+#else
+static const nube_backend_t *nube = &nube_blynk;
+#endif
+
 // ----------- UART INIT -----------
 void uart_init(void)
 {
@@ -235,6 +300,736 @@ void lorawan_uart_cmd(const char *cmd)
     }
 }
 
+// ----------- ALERTAS -----------
+static void alertas_por_defecto(void)
+{
+    const alertas_regla_t reglas[] = {
+        {ALERTAS_CUALQUIER_NODO, TELEMETRIA_TEMPERATURA, 0, ALERTA_MAX_NIVEL, TEMP_MIN, TEMP_MAX, TEMP_HISTERESIS, ALERTA_DURACION_MS, ALERTA_ESCALADO_MS},
+        {ALERTAS_CUALQUIER_NODO, TELEMETRIA_EC, 1, ALERTA_MAX_NIVEL, -FLT_MAX, EC_MAX, EC_HISTERESIS, ALERTA_DURACION_MS, ALERTA_ESCALADO_MS},
+        {ALERTAS_CUALQUIER_NODO, TELEMETRIA_PH, 2, ALERTA_MAX_NIVEL, PH_MIN, PH_MAX, PH_HISTERESIS, ALERTA_DURACION_MS, ALERTA_ESCALADO_MS},
+        {ALERTAS_CUALQUIER_NODO, TELEMETRIA_TDS, 3, ALERTA_MAX_NIVEL, -FLT_MAX, TDS_MAX, TDS_HISTERESIS, ALERTA_DURACION_MS, ALERTA_ESCALADO_MS},
+    };
+    for (int i = 0; i < sizeof(reglas) / sizeof(reglas[0]); i++)
+    {
+        alertas_agregar_regla(&alertas, &reglas[i]);
+    }
+}
+
+// Carga las reglas de NVS ("alertas"/"reglas": byte de version + alertas_regla_t[]), o las de por defecto
+void alertas_init(void)
+{
+    alertas_mutex = xSemaphoreCreateMutex();
+    alertas_iniciar(&alertas);
+    for (int i = 0; i < sizeof(eventos_blynk) / sizeof(eventos_blynk[0]); i++)
+    {
+        alertas_agregar_evento(&alertas, ALERTA_TOKENS, ALERTA_RECARGA_MS);
+    }
+
+    static uint8_t blob[1 + ALERTAS_MAX_REGLAS * sizeof(alertas_regla_t)];
+    size_t len = sizeof(blob);
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_ALERTAS, NVS_READONLY, &nvs) == ESP_OK)
+    {
+        if (nvs_get_blob(nvs, "reglas", blob, &len) == ESP_OK && len > 1 && blob[0] == ALERTAS_VERSION_REGLAS &&
+            (len - 1) % sizeof(alertas_regla_t) == 0)
+        {
+            for (size_t pos = 1; pos < len; pos += sizeof(alertas_regla_t))
+            {
+                alertas_regla_t regla;
+                memcpy(&regla, &blob[pos], sizeof(regla));
+                if (alertas_agregar_regla(&alertas, &regla) < 0)
+                {
+                    ESP_LOGW(TAG, "Regla de alerta invalida en NVS, se ignora");
+                }
+            }
+        }
+        nvs_close(nvs);
+    }
+    if (alertas.num_reglas == 0)
+    {
+        alertas_por_defecto();
+    }
+    alertas_reiniciar(&alertas, xTaskGetTickCount() * portTICK_PERIOD_MS);
+    ESP_LOGI(TAG, "%d reglas de alerta", alertas.num_reglas);
+}
+
+// Guarda las reglas actuales en NVS. Se llama con alertas_mutex tomado
+esp_err_t alertas_guardar(void)
+{
+    static uint8_t blob[1 + ALERTAS_MAX_REGLAS * sizeof(alertas_regla_t)];
+    blob[0] = ALERTAS_VERSION_REGLAS;
+    memcpy(&blob[1], alertas.reglas, alertas.num_reglas * sizeof(alertas_regla_t));
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_ALERTAS, NVS_READWRITE, &nvs);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    err = nvs_set_blob(nvs, "reglas", blob, 1 + alertas.num_reglas * sizeof(alertas_regla_t));
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return err;
+}
+
+// ----------- HISTORICO -----------
+static bool serie_flash_leer(void *ctx, uint32_t direccion, void *datos, size_t len)
+{
+    return esp_partition_read((const esp_partition_t *)ctx, direccion, datos, len) == ESP_OK;
+}
+
+static bool serie_flash_escribir(void *ctx, uint32_t direccion, const void *datos, size_t len)
+{
+    return esp_partition_write((const esp_partition_t *)ctx, direccion, datos, len) == ESP_OK;
+}
+
+static bool serie_flash_borrar(void *ctx, uint32_t direccion, size_t len)
+{
+    return esp_partition_erase_range((const esp_partition_t *)ctx, direccion, len) == ESP_OK;
+}
+
+// Monta el historico en la particion SERIE_PARTICION; sin ella el receptor funciona igual, sin guardar nada
+void serie_init(void)
+{
+    serie_mutex = xSemaphoreCreateMutex();
+    const esp_partition_t *particion = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                                SERIE_PARTICION);
+    if (particion == NULL)
+    {
+        ESP_LOGW(TAG, "No hay particion '%s': no se guarda historico", SERIE_PARTICION);
+        return;
+    }
+    serie_flash_t flash = {serie_flash_leer, serie_flash_escribir, serie_flash_borrar, (void *)particion};
+    serie_activa = serie_montar(&serie, &flash, particion->size);
+    if (!serie_activa)
+    {
+        ESP_LOGE(TAG, "No se pudo montar el historico");
+        return;
+    }
+    ESP_LOGI(TAG, "Historico de %lu KB: crudo desde %lu, minutos desde %lu, horas desde %lu (%lu registros corruptos)",
+             (unsigned long)(particion->size / 1024), (unsigned long)serie_inicio(&serie, SERIE_CRUDO),
+             (unsigned long)serie_inicio(&serie, SERIE_MINUTO), (unsigned long)serie_inicio(&serie, SERIE_HORA),
+             (unsigned long)serie.corruptos);
+}
+
+// edad_s: segundos que lleva tomada la lectura (las de un lote comprimido llegan juntas)
+void serie_guardar(const telemetria_lectura_t *lectura, uint32_t edad_s)
+{
+    time_t ahora = time(NULL);
+    if (!serie_activa || ahora < SERIE_HORA_VALIDA)
+    {
+        return;
+    }
+    xSemaphoreTake(serie_mutex, portMAX_DELAY);
+    bool ok = serie_insertar(&serie, lectura, (uint32_t)ahora - edad_s);
+    xSemaphoreGive(serie_mutex);
+    if (!ok)
+    {
+        ESP_LOGW(TAG, "Error escribiendo el historico");
+    }
+}
+
+// Cada SERIE_SYNC_MS: escribe los resumenes de nodos que dejaron de mandar y vacia los buffers a la flash
+void serie_mantener(uint32_t now)
+{
+    static uint32_t ultimo = 0;
+    if (!serie_activa || now - ultimo < SERIE_SYNC_MS)
+    {
+        return;
+    }
+    ultimo = now;
+    time_t ahora = time(NULL);
+    xSemaphoreTake(serie_mutex, portMAX_DELAY);
+    if (ahora >= SERIE_HORA_VALIDA)
+    {
+        serie_cerrar_periodos(&serie, (uint32_t)ahora);
+    }
+    serie_sincronizar(&serie);
+    xSemaphoreGive(serie_mutex);
+}
+
+typedef struct
+{
+    serie_punto_t *puntos;
+    int num;
+    int max;
+} api_copia_t;
+
+static bool api_punto(const serie_punto_t *punto, void *arg)
+{
+    api_copia_t *copia = (api_copia_t *)arg;
+    copia->puntos[copia->num++] = *punto;
+    return copia->num < copia->max;
+}
+
+// Consulta del historico para la API local: copia los puntos con el mutex tomado y lo suelta antes de enviar nada
+int api_historia(serie_nivel_t nivel, uint8_t nodo, telemetria_parametro_t parametro, uint32_t desde, uint32_t hasta,
+                 serie_punto_t *puntos, int max)
+{
+    if (!serie_activa || max <= 0)
+    {
+        return -1;
+    }
+    api_copia_t copia = {.puntos = puntos, .num = 0, .max = max};
+    xSemaphoreTake(serie_mutex, portMAX_DELAY);
+    serie_consultar(&serie, nivel, nodo, parametro, desde, hasta, api_punto, &copia);
+    xSemaphoreGive(serie_mutex);
+    return copia.num;
+}
+
+// Envia una lectura a Blynk y pasa las reglas de alerta: solo los avisos que devuelve el motor generan un evento.
+// secuencia es NODOS_SIN_SECUENCIA si el mensaje no la trae; edad_s, lo que lleva tomada la lectura
+void procesar_lectura(const telemetria_lectura_t *lectura, int32_t secuencia, uint32_t edad_s, uint32_t now)
+{
+    serie_guardar(lectura, edad_s);
+    // a la app local antes que a la nube, que tarda
+    time_t ahora = time(NULL);
+    uint32_t t = ahora >= SERIE_HORA_VALIDA ? (uint32_t)ahora - edad_s : 0;
+    api_publicar(lectura, t);
+    nodos_evento_t evento = nodos_recibido(&nodos, lectura->origen, secuencia, now);
+    if (evento == NODOS_NUEVO)
+    {
+        ESP_LOGI(TAG, "Nodo %u registrado (%u nodos)", lectura->origen, nodos.num);
+    }
+    else if (evento == NODOS_DE_VUELTA)
+    {
+        ESP_LOGI(TAG, "Nodo %u de nuevo en linea", lectura->origen);
+    }
+    else if (evento == NODOS_LLENO)
+    {
+        ESP_LOGW(TAG, "Nodo %u: registro lleno (max %d nodos), no se vigila su offline", lectura->origen, NODOS_MAX);
+    }
+
+    nube->lectura(lectura, t);
+    ESP_LOGI(TAG, "Datos extraídos y enviados a %s: T=%.2f, EC=%.2f, pH=%.2f, TDS=%.2f", nube->nombre,
+             lectura->temperatura, lectura->ec, lectura->ph, lectura->tds);
+
+    alertas_aviso_t avisos[ALERTAS_MAX_AVISOS];
+    alertas_regla_t reglas[ALERTAS_MAX_AVISOS];
+    xSemaphoreTake(alertas_mutex, portMAX_DELAY);
+    int num_avisos = alertas_evaluar(&alertas, lectura, now, avisos, ALERTAS_MAX_AVISOS);
+    for (int i = 0; i < num_avisos; i++)
+    {
+        reglas[i] = alertas.reglas[avisos[i].regla];
+    }
+    xSemaphoreGive(alertas_mutex);
+
+    for (int i = 0; i < num_avisos; i++)
+    {
+        const char *nombre = eventos_blynk[avisos[i].evento].nombre;
+        if (avisos[i].nivel == 0)
+        {
+            ESP_LOGI(TAG, "Nodo %u: %s de nuevo en rango (%.2f)", avisos[i].nodo, nombre, avisos[i].valor);
+            continue;
+        }
+        char desc[96];
+        bool alto = avisos[i].valor > reglas[i].max;
+        snprintf(desc, sizeof(desc), "Nodo %u: %s %.2f %s %.2f (nivel %u)", avisos[i].nodo, nombre, avisos[i].valor,
+                 alto ? "sobre el maximo" : "bajo el minimo", alto ? reglas[i].max : reglas[i].min, avisos[i].nivel);
+        ESP_LOGW(TAG, "Alerta: %s", desc);
+        nube->evento(eventos_blynk[avisos[i].evento].evento, desc);
+    }
+}
+
+// Extrae los datos de un mensaje "TEMP:.." y los procesa
+void procesar_mensaje(char *msg, uint32_t now)
+{
+    telemetria_lectura_t lectura = {.origen = NODO_TEXTO};
+    char *ptr = strstr(msg, "TEMP:");
+    if (ptr)
+    {
+        int res = sscanf(ptr, "TEMP:%fC,EC:%f,pH:%f,TDS:%f", &lectura.temperatura, &lectura.ec, &lectura.ph, &lectura.tds);
+        if (res == 4)
+        {
+            procesar_lectura(&lectura, NODOS_SIN_SECUENCIA, 0, now);
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Error extrayendo datos del mensaje: %s", ptr);
+        }
+    }
+    else
+    {
+        ESP_LOGW(TAG, "No se encontró 'TEMP:' en el mensaje recibido");
+    }
+}
+
+static void avisar_offline(const nodo_t *nodo, void *arg)
+{
+    (void)arg;
+    char desc[64];
+    snprintf(desc, sizeof(desc), "Nodo %u: no se reciben datos hace %lu min", nodo->direccion,
+             (unsigned long)(nodo->timeout_ms / 60000));
+    nube->evento("sensores_offline", desc);
+    ESP_LOGW(TAG, "SENSORES OFFLINE detectado! %s", desc);
+}
+
+// Avisa de los nodos que llevan mas de su timeout sin datos validos. Solo hace trabajo una vez por
+// NODOS_TICK_MS, y entonces solo con los nodos que vencen en ese tick
+void revisar_offline(uint32_t now)
+{
+    nodos_avanzar(&nodos, now, avisar_offline, NULL);
+}
+
+void log_nodos(void)
+{
+    for (int i = 0; i < nodos.num; i++)
+    {
+        const nodo_t *nodo = &nodos.nodos[i];
+        ESP_LOGI(TAG, "Nodo %u: %s, recibidos=%lu, perdidos=%lu, desordenados=%lu, reinicios=%lu", nodo->direccion,
+                 nodo->online ? "online" : "offline", (unsigned long)nodo->recibidos, (unsigned long)nodo->perdidos,
+                 (unsigned long)nodo->desordenados, (unsigned long)nodo->reinicios);
+    }
+}
+
+// Trama binaria de longitud fija, recibida con cabecera implicita
+void procesar_telemetria(const uint8_t *trama, size_t len, uint32_t now)
+{
+    telemetria_lectura_t lectura;
+    if (!telemetria_decodificar(trama, len, &lectura))
+    {
+        ESP_LOGW(TAG, "Trama de telemetria de %u bytes, se esperaban %d", (unsigned)len, TELEMETRIA_LEN);
+        return;
+    }
+    ESP_LOGI(TAG, "Telemetria del nodo %u, lectura %u", lectura.origen, lectura.secuencia);
+    procesar_lectura(&lectura, lectura.secuencia, 0, now);
+}
+
+// Lote comprimido (TELEMETRIA_CTRL_LOTE), recibido por el canal de control
+void procesar_lote(const uint8_t *trama, size_t len, uint32_t now)
+{
+    telemetria_lectura_t lecturas[TELEMETRIA_LOTE_MAX_LECTURAS];
+    uint32_t edad_s[TELEMETRIA_LOTE_MAX_LECTURAS];
+    int num = telemetria_decodificar_lote(trama, len, lecturas, edad_s, TELEMETRIA_LOTE_MAX_LECTURAS);
+    if (num < 0)
+    {
+        ESP_LOGW(TAG, "Lote comprimido invalido (%u bytes)", (unsigned)len);
+        return;
+    }
+    ESP_LOGI(TAG, "Lote del nodo %u: lecturas %u..%u en %u bytes (%d sin comprimir)", lecturas[0].origen,
+             lecturas[0].secuencia, lecturas[num - 1].secuencia, (unsigned)len, num * TELEMETRIA_LEN);
+    for (int i = 0; i < num; i++)
+    {
+        // reglas y registro de nodos ven cada lectura en el momento en que se tomo, no todas juntas
+        procesar_lectura(&lecturas[i], lecturas[i].secuencia, edad_s[i], now - edad_s[i] * 1000);
+    }
+}
+
+#if MODO_GATEWAY
+// Cola de downlinks: la llenan la consola y la tarea del gateway, se vacia en las ventanas de los nodos
+static downlink_t downlinks;
+static SemaphoreHandle_t downlinks_mutex;
+
+// Con cabecera implicita un desajuste de longitud, SF o CR no se detecta en el aire (solo fallos de CRC),
+// asi que se compara el anuncio del transmisor con las radios implicitas configuradas
+void procesar_control(const uint8_t *trama, size_t len)
+{
+    uint8_t origen, id;
+    comandos_resultado_t resultado;
+    if (comandos_decodificar_ack(trama, len, &origen, &id, &resultado))
+    {
+        xSemaphoreTake(downlinks_mutex, portMAX_DELAY);
+        downlink_ack(&downlinks, origen, id);
+        int pendientes = downlink_pendientes(&downlinks, origen);
+        xSemaphoreGive(downlinks_mutex);
+        ESP_LOGI(TAG, "Nodo %u: ACK del downlink %u (%s), %d pendientes", origen, id,
+                 resultado == COMANDOS_APLICADO ? "aplicado" : resultado == COMANDOS_DUPLICADO ? "duplicado" : "rechazado", pendientes);
+        return;
+    }
+
+    telemetria_formato_t formato;
+    if (!telemetria_decodificar_formato(trama, len, &formato))
+    {
+        ESP_LOGW(TAG, "Mensaje de control desconocido: tipo 0x%02X, %u bytes", trama[0], (unsigned)len);
+        return;
+    }
+    xSemaphoreTake(downlinks_mutex, portMAX_DELAY);
+    bool registrado = downlink_registrar(&downlinks, formato.origen, formato.clase);
+    xSemaphoreGive(downlinks_mutex);
+    if (!registrado)
+    {
+        ESP_LOGW(TAG, "Nodo %u: no queda sitio para sus downlinks (max %d nodos)", formato.origen, DOWNLINK_MAX_NODOS);
+    }
+    for (int i = 0; i < sizeof(gateway_radios) / sizeof(gateway_radios[0]); i++)
+    {
+        const gateway_radio_config_t *cfg = &gateway_radios[i];
+        if (cfg->longitud_fija == formato.longitud && (cfg->sf >> 4) == formato.sf && formato.cr == 5)
+        {
+            ESP_LOGI(TAG, "Nodo %u (clase %c): telemetria implicita v%u (%u bytes, SF%u, CR 4/%u) por la radio %d",
+                     formato.origen, formato.clase == TELEMETRIA_CLASE_C ? 'C' : 'A', formato.version, formato.longitud,
+                     formato.sf, formato.cr, i);
+            return;
+        }
+    }
+    ESP_LOGW(TAG, "Nodo %u: telemetria implicita de %u bytes, SF%u, CR 4/%u sin radio configurada",
+             formato.origen, formato.longitud, formato.sf, formato.cr);
+}
+
+// Un nodo clase A solo escucha COMANDOS_RX_RETARDO_MS despues de un uplink que abre ventana, asi que se le
+// responde antes de procesar el paquete (la subida a Blynk tarda mas que eso)
+void atender_ventana(const gateway_packet_t *packet)
+{
+    uint8_t nodo;
+    uint8_t id;
+    comandos_resultado_t resultado;
+    telemetria_formato_t formato;
+    if (packet->implicito)
+    {
+        if (packet->len != TELEMETRIA_LEN || (packet->data[0] & TELEMETRIA_FLAG_VENTANA) == 0)
+            return;
+        nodo = packet->data[0] & TELEMETRIA_MAX_ORIGEN;
+    }
+    else if (packet->len > TELEMETRIA_LOTE_CABECERA && packet->data[0] == TELEMETRIA_CTRL_LOTE)
+    {
+        // como la trama implicita: solo el ultimo paquete de un lote abre ventana
+        if ((packet->data[1] & TELEMETRIA_FLAG_VENTANA) == 0)
+            return;
+        nodo = packet->data[1] & TELEMETRIA_MAX_ORIGEN;
+    }
+    else if (!comandos_decodificar_ack(packet->data, packet->len, &nodo, &id, &resultado))
+    {
+        // tras un ACK o un anuncio de formato el nodo tambien abre ventana
+        if (!telemetria_decodificar_formato(packet->data, packet->len, &formato))
+            return;
+        nodo = formato.origen;
+    }
+
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    uint32_t transcurrido = now - packet->timestamp_ms;
+    if (transcurrido + COMANDOS_RX_MARGEN_MS >= COMANDOS_RX_RETARDO_MS || !gateway_tx_libre(GATEWAY_RADIO_DOWNLINK))
+    {
+        // sin tiempo o con la radio ocupada: la trama sigue pendiente para la proxima ventana, sin gastar intento
+        return;
+    }
+    uint8_t trama[COMANDOS_MAX_LEN];
+    xSemaphoreTake(downlinks_mutex, portMAX_DELAY);
+    size_t len = downlink_para_uplink(&downlinks, nodo, now, trama);
+    xSemaphoreGive(downlinks_mutex);
+    if (len > 0 && gateway_enviar(GATEWAY_RADIO_DOWNLINK, trama, len, (COMANDOS_RX_RETARDO_MS - transcurrido) * 1000) == ESP_OK)
+    {
+        ESP_LOGI(TAG, "Downlink %u al nodo %u en su ventana", trama[2], nodo);
+    }
+}
+
+// Los nodos clase C escuchan siempre: sus downlinks salen en cuanto la radio esta libre
+void atender_clase_c(void)
+{
+    if (!gateway_tx_libre(GATEWAY_RADIO_DOWNLINK))
+        return;
+    uint8_t trama[COMANDOS_MAX_LEN];
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    xSemaphoreTake(downlinks_mutex, portMAX_DELAY);
+    size_t len = downlink_para_clase_c(&downlinks, now, trama);
+    xSemaphoreGive(downlinks_mutex);
+    if (len > 0 && gateway_enviar(GATEWAY_RADIO_DOWNLINK, trama, len, 0) == ESP_OK)
+    {
+        ESP_LOGI(TAG, "Downlink %u a %s clase C", trama[2], trama[1] == COMANDOS_DIFUSION ? "todos los nodos" : "un nodo");
+    }
+}
+
+#endif
+
+static bool leer_parametro(const char *nombre, telemetria_parametro_t *parametro)
+{
+    static const char *nombres[TELEMETRIA_NUM_PARAMETROS] = {"temp", "ec", "ph", "tds"};
+    for (int i = 0; i < TELEMETRIA_NUM_PARAMETROS; i++)
+    {
+        if (strcmp(nombre, nombres[i]) == 0)
+        {
+            *parametro = (telemetria_parametro_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// "regla <nodo|*> <temp|ec|ph|tds> <min|-> <max|-> <histeresis> <duracion_s> [escalado_s]": agrega o reemplaza
+// una regla de alerta y la guarda en NVS. "reglas borrar" vuelve a las reglas por defecto
+void consola_regla(const char *linea)
+{
+    if (strcmp(linea, "reglas borrar") == 0)
+    {
+        nvs_handle_t nvs;
+        if (nvs_open(NVS_ALERTAS, NVS_READWRITE, &nvs) == ESP_OK)
+        {
+            nvs_erase_key(nvs, "reglas");
+            nvs_commit(nvs);
+            nvs_close(nvs);
+        }
+        xSemaphoreTake(alertas_mutex, portMAX_DELAY);
+        alertas.num_reglas = 0;
+        alertas_por_defecto();
+        alertas_reiniciar(&alertas, xTaskGetTickCount() * portTICK_PERIOD_MS);
+        xSemaphoreGive(alertas_mutex);
+        ESP_LOGI(TAG, "Reglas de alerta por defecto");
+        return;
+    }
+
+    char nodo_txt[8], nombre[8], min_txt[16], max_txt[16];
+    float histeresis;
+    unsigned duracion_s, escalado_s = 0;
+    telemetria_parametro_t parametro;
+    int campos = sscanf(linea, "regla %7s %7s %15s %15s %f %u %u", nodo_txt, nombre, min_txt, max_txt, &histeresis,
+                        &duracion_s, &escalado_s);
+    if (campos < 6 || !leer_parametro(nombre, &parametro))
+    {
+        ESP_LOGW(TAG, "Uso: regla <nodo|*> <temp|ec|ph|tds> <min|-> <max|-> <histeresis> <duracion_s> [escalado_s]");
+        return;
+    }
+    alertas_regla_t regla = {
+        .nodo = strcmp(nodo_txt, "*") == 0 ? ALERTAS_CUALQUIER_NODO : (uint8_t)atoi(nodo_txt),
+        .parametro = parametro,
+        .evento = parametro,
+        .max_nivel = escalado_s > 0 ? ALERTA_MAX_NIVEL : 1,
+        .min = strcmp(min_txt, "-") == 0 ? -FLT_MAX : strtof(min_txt, NULL),
+        .max = strcmp(max_txt, "-") == 0 ? FLT_MAX : strtof(max_txt, NULL),
+        .histeresis = histeresis,
+        .duracion_ms = duracion_s * 1000,
+        .escalado_ms = escalado_s * 1000};
+
+    xSemaphoreTake(alertas_mutex, portMAX_DELAY);
+    int indice = alertas_agregar_regla(&alertas, &regla);
+    esp_err_t err = indice >= 0 ? alertas_guardar() : ESP_ERR_INVALID_ARG;
+    xSemaphoreGive(alertas_mutex);
+    if (indice < 0)
+    {
+        ESP_LOGW(TAG, "Regla invalida o sin sitio (max %d): %s", ALERTAS_MAX_REGLAS, linea);
+        return;
+    }
+    ESP_LOGI(TAG, "Regla %d guardada%s", indice, err == ESP_OK ? "" : " (error escribiendo NVS)");
+}
+
+#if MODO_GATEWAY
+// "cmd <nodo|*> periodo <s>", "cmd <nodo|*> lote <n>", "cmd <nodo|*> umbral <temp|ec|ph|tds> <min> <max>",
+// "cmd <nodo|*> cal <temp|ec|ph|tds> <ganancia> <offset>",
+// "cmd <nodo|*> politica <temp|ec|ph|tds> <banda> <pendiente/min> <margen>", "cmd <nodo|*> silencio <s> <rapido_s>"
+void consola_downlink(const char *linea)
+{
+    char destino_txt[8], tipo[12], nombre[8];
+    int resto = 0;
+    if (sscanf(linea, "cmd %7s %11s %n", destino_txt, tipo, &resto) != 2 || resto == 0)
+    {
+        ESP_LOGW(TAG, "Uso: cmd <nodo|*> periodo <s> | lote <n> | umbral <param> <min> <max> | cal <param> <ganancia> <offset>"
+                      " | politica <param> <banda> <pendiente> <margen> | silencio <s> <rapido_s>");
+        return;
+    }
+    const char *args = linea + resto;
+    int destino = strcmp(destino_txt, "*") == 0 ? COMANDOS_DIFUSION : atoi(destino_txt);
+    comando_t cmd = {0};
+    unsigned valor, rapido;
+    bool valido = false;
+    if (strcmp(tipo, "periodo") == 0 && sscanf(args, "%u", &valor) == 1 && valor > 0 && valor <= UINT16_MAX)
+    {
+        cmd.tipo = COMANDO_PERIODO;
+        cmd.valor.periodo_s = (uint16_t)valor;
+        valido = true;
+    }
+    else if (strcmp(tipo, "lote") == 0 && sscanf(args, "%u", &valor) == 1 && valor > 0 && valor <= COMANDOS_MAX_LOTE)
+    {
+        cmd.tipo = COMANDO_LOTE;
+        cmd.valor.lote = (uint8_t)valor;
+        valido = true;
+    }
+    else if (strcmp(tipo, "umbral") == 0 && sscanf(args, "%7s %f %f", nombre, &cmd.valor.umbral.min, &cmd.valor.umbral.max) == 3)
+    {
+        cmd.tipo = COMANDO_UMBRAL;
+        valido = leer_parametro(nombre, &cmd.parametro);
+    }
+    else if (strcmp(tipo, "cal") == 0 &&
+             sscanf(args, "%7s %f %f", nombre, &cmd.valor.calibracion.ganancia, &cmd.valor.calibracion.offset) == 3)
+    {
+        cmd.tipo = COMANDO_CALIBRACION;
+        valido = leer_parametro(nombre, &cmd.parametro);
+    }
+    else if (strcmp(tipo, "politica") == 0 &&
+             sscanf(args, "%7s %f %f %f", nombre, &cmd.valor.politica.banda, &cmd.valor.politica.pendiente,
+                    &cmd.valor.politica.margen) == 4)
+    {
+        cmd.tipo = COMANDO_POLITICA;
+        valido = leer_parametro(nombre, &cmd.parametro) && cmd.valor.politica.banda >= 0 &&
+                 cmd.valor.politica.pendiente >= 0 && cmd.valor.politica.margen >= 0;
+    }
+    else if (strcmp(tipo, "silencio") == 0 && sscanf(args, "%u %u", &valor, &rapido) == 2 && valor > 0 &&
+             rapido <= UINT16_MAX)
+    {
+        // un nodo que calla mas que el timeout de offline apareceria caido
+        cmd.tipo = COMANDO_SILENCIO;
+        cmd.valor.silencio.silencio_s = (uint16_t)valor;
+        cmd.valor.silencio.rapido_s = (uint16_t)rapido;
+        valido = valor * 1000ULL < OFFLINE_TIMEOUT_MS;
+    }
+    if (!valido || destino <= 0 || (destino > TELEMETRIA_MAX_ORIGEN && destino != COMANDOS_DIFUSION))
+    {
+        ESP_LOGW(TAG, "Comando invalido: %s", linea);
+        return;
+    }
+
+    int num_nodos = 0;
+    xSemaphoreTake(downlinks_mutex, portMAX_DELAY);
+    int id = downlink_programar(&downlinks, (uint8_t)destino, &cmd, 1, &num_nodos);
+    xSemaphoreGive(downlinks_mutex);
+    if (id < 0)
+    {
+        ESP_LOGW(TAG, "No se pudo programar el comando (sin nodos registrados o colas llenas)");
+        return;
+    }
+    ESP_LOGI(TAG, "Downlink %d programado para %d nodos", id, num_nodos);
+}
+#endif
+
+static bool consola_punto(const serie_punto_t *punto, void *arg)
+{
+    int *restantes = (int *)arg;
+    ESP_LOGI(TAG, "%lu nodo %u: %.2f (min %.2f, max %.2f, %u muestras)", (unsigned long)punto->t, punto->nodo,
+             punto->media, punto->min, punto->max, punto->muestras);
+    return --(*restantes) > 0;
+}
+
+// "serie <nodo|*> <temp|ec|ph|tds> <crudo|minuto|hora> <segundos>": historico de los ultimos segundos
+void consola_serie(const char *linea)
+{
+    static const char *niveles[SERIE_NUM_NIVELES] = {"crudo", "minuto", "hora"};
+    char nodo_txt[8], nombre[8], nivel_txt[8];
+    unsigned segundos;
+    telemetria_parametro_t parametro;
+    int nivel = SERIE_NUM_NIVELES;
+    if (sscanf(linea, "serie %7s %7s %7s %u", nodo_txt, nombre, nivel_txt, &segundos) == 4)
+    {
+        for (nivel = 0; nivel < SERIE_NUM_NIVELES && strcmp(nivel_txt, niveles[nivel]) != 0; nivel++)
+            ;
+    }
+    if (nivel == SERIE_NUM_NIVELES || !leer_parametro(nombre, &parametro))
+    {
+        ESP_LOGW(TAG, "Uso: serie <nodo|*> <temp|ec|ph|tds> <crudo|minuto|hora> <segundos>");
+        return;
+    }
+    if (!serie_activa || time(NULL) < SERIE_HORA_VALIDA)
+    {
+        ESP_LOGW(TAG, "Historico no disponible (sin particion o sin hora)");
+        return;
+    }
+    uint32_t hasta = (uint32_t)time(NULL);
+    uint8_t nodo = strcmp(nodo_txt, "*") == 0 ? SERIE_CUALQUIER_NODO : (uint8_t)atoi(nodo_txt);
+    int restantes = SERIE_CONSOLA_MAX;
+    xSemaphoreTake(serie_mutex, portMAX_DELAY);
+    int puntos = serie_consultar(&serie, (serie_nivel_t)nivel, nodo, parametro, hasta - segundos, hasta,
+                                 consola_punto, &restantes);
+    xSemaphoreGive(serie_mutex);
+    ESP_LOGI(TAG, "%d puntos%s", puntos, restantes == 0 ? " (limite de la consola)" : "");
+}
+
+void consola_comando(const char *linea)
+{
+    if (strncmp(linea, "regla", 5) == 0)
+    {
+        consola_regla(linea);
+    }
+    else if (strncmp(linea, "serie", 5) == 0)
+    {
+        consola_serie(linea);
+    }
+    else
+    {
+#if MODO_GATEWAY
+        consola_downlink(linea);
+#else
+        ESP_LOGW(TAG, "Comandos a los nodos solo con MODO_GATEWAY 1: %s", linea);
+#endif
+    }
+}
+
+// Lee lineas del monitor serie
+static void consola_task(void *arg)
+{
+    char linea[96];
+    size_t pos = 0;
+    uint8_t c;
+    uart_driver_install(CONSOLA_UART, 256, 0, 0, NULL, 0);
+    while (1)
+    {
+        if (uart_read_bytes(CONSOLA_UART, &c, 1, portMAX_DELAY) != 1)
+            continue;
+        if (c == '\r' || c == '\n')
+        {
+            linea[pos] = '\0';
+            if (pos > 0)
+                consola_comando(linea);
+            pos = 0;
+        }
+        else if (pos < sizeof(linea) - 1)
+        {
+            linea[pos++] = (char)c;
+        }
+    }
+}
+
+#if MODO_GATEWAY
+// Recibe de todas las radios SX127x a la vez por la cola del gateway
+void gateway_loop(void)
+{
+
+    ESP_ERROR_CHECK(gateway_start(GATEWAY_SPI_HOST, GATEWAY_SCK, GATEWAY_MISO, GATEWAY_MOSI,
+                                  gateway_radios, sizeof(gateway_radios) / sizeof(gateway_radios[0])));
+    ESP_LOGI(TAG, "Gateway esperando mensajes de %d radios...", (int)(sizeof(gateway_radios) / sizeof(gateway_radios[0])));
+
+    gateway_packet_t *packet = (gateway_packet_t *)malloc(sizeof(gateway_packet_t));
+    uint32_t ultimo_stats = xTaskGetTickCount() * portTICK_PERIOD_MS;
+
+    while (1)
+    {
+        bool recibido = gateway_receive(packet, pdMS_TO_TICKS(GATEWAY_CLASE_C_MS));
+        uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        if (recibido)
+        {
+            atender_ventana(packet);
+            if (packet->implicito)
+            {
+                ESP_LOGI(TAG, "Telemetria recibida por radio %d (rssi=%d, snr=%.1f)", packet->radio, packet->rssi, packet->snr);
+                procesar_telemetria(packet->data, packet->len, now);
+            }
+            else if (telemetria_es_control(packet->data, packet->len) && packet->data[0] == TELEMETRIA_CTRL_LOTE)
+            {
+                procesar_lote(packet->data, packet->len, now);
+            }
+            else if (telemetria_es_control(packet->data, packet->len))
+            {
+                procesar_control(packet->data, packet->len);
+            }
+            else
+            {
+                ESP_LOGI(TAG, "Mensaje recibido por radio %d (rssi=%d, snr=%.1f): %s",
+                         packet->radio, packet->rssi, packet->snr, (char *)packet->data);
+                procesar_mensaje((char *)packet->data, now);
+            }
+        }
+
+        atender_clase_c();
+
+        if (now - ultimo_stats >= GATEWAY_STATS_MS)
+        {
+            gateway_log_stats();
+            red_log_stats();
+            log_nodos();
+            xSemaphoreTake(downlinks_mutex, portMAX_DELAY);
+            ESP_LOGI(TAG, "Downlinks: enviados=%lu, confirmados=%lu, descartados=%lu, pendientes=%d",
+                     (unsigned long)downlinks.enviados, (unsigned long)downlinks.confirmados,
+                     (unsigned long)downlinks.descartados, downlink_pendientes(&downlinks, COMANDOS_DIFUSION));
+            xSemaphoreGive(downlinks_mutex);
+            ultimo_stats = now;
+        }
+
+        revisar_offline(now);
+        serie_mantener(now);
+        if (nube->mantener != NULL)
+        {
+            nube->mantener(now);
+        }
+    }
+}
+#endif
+
 // ========== APP MAIN ==========
 void app_main(void)
 {
@@ -246,9 +1041,32 @@ void app_main(void)
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+    alertas_init();
+    nodos_iniciar(&nodos, OFFLINE_TIMEOUT_MS, xTaskGetTickCount() * portTICK_PERIOD_MS);
+    serie_init();
 
     // Conexión WiFi
-    wifi_init_sta();
+    red_iniciar(WIFI_SSID, WIFI_PASS);
+    hora_init();
+    if (api_iniciar(api_historia) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Sin API local");
+    }
+    if (nube->iniciar != NULL && nube->iniciar() != ESP_OK)
+    {
+        ESP_LOGE(TAG, "No se pudo iniciar la subida a %s", nube->nombre);
+    }
+
+    // reglas e historico se editan y consultan con los dos modos; los downlinks necesitan el gateway
+#if MODO_GATEWAY
+    downlink_iniciar(&downlinks);
+    downlinks_mutex = xSemaphoreCreateMutex();
+#endif
+    xTaskCreate(consola_task, "consola", 4096, NULL, 5, NULL);
+
+#if MODO_GATEWAY
+    gateway_loop();
+#endif
     uart_init();
 
     // --- Configuración AT LoRaWAN Node ---
@@ -279,55 +1097,20 @@ void app_main(void)
     while (1)
     {
         int len = uart_read_bytes(UART_PORT_NUM, data, BUF_SIZE - 1, pdMS_TO_TICKS(5000));
+        uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
         if (len > 0)
         {
             data[len] = '\0'; // Null-terminate para printf seguro
             ESP_LOGI(TAG, "Mensaje recibido por UART: %s", data);
 
-            float temperatura = 0, ec = 0, ph = 0, tds = 0;
-            char *ptr = strstr((char *)data, "TEMP:");
-            if (ptr)
-            {
-                int res = sscanf(ptr, "TEMP:%fC,EC:%f,pH:%f,TDS:%f", &temperatura, &ec, &ph, &tds);
-                if (res == 4)
-                {
-                    send_to_blynk(temperatura, ec, ph, tds);
-                    ESP_LOGI(TAG, "Datos extraídos y enviados a Blynk: T=%.2f, EC=%.2f, pH=%.2f, TDS=%.2f", temperatura, ec, ph, tds);
-
-                    if (temperatura < TEMP_MIN || temperatura > TEMP_MAX)
-                        send_blynk_event("temperatura_fuera_de_rango", "Temperatura fuera del rango 20-25C");
-                    if (ec > EC_MAX)
-                        send_blynk_event("conductividad_fuera_de_rango", "Conductividad fuera de rango max 35 mS/cm");
-                    if (ph < PH_MIN || ph > PH_MAX)
-                        send_blynk_event("ph_fuera_de_rango", "pH fuera de rango 6.5-8.5");
-                    if (tds > TDS_MAX)
-                    {
-                        ESP_LOGI(TAG, "Enviando evento TDS fuera de rango");
-                        send_blynk_event("tds_fuera_de_rango", "TDS fuera de rango max 500 mgL");
-                    }
-
-                    // Actualiza última vez de dato válido
-                    last_data_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
-                    sensores_reportados_offline = false;
-                }
-                else
-                {
-                    ESP_LOGW(TAG, "Error extrayendo datos del mensaje: %s", ptr);
-                }
-            }
-            else
-            {
-                ESP_LOGW(TAG, "No se encontró 'TEMP:' en el mensaje recibido");
-            }
+            procesar_mensaje((char *)data, now);
         }
 
-        // Chequea si han pasado más de OFFLINE_TIMEOUT_MS ms sin datos válidos
-        uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
-        if (!sensores_reportados_offline && last_data_time && (now - last_data_time > OFFLINE_TIMEOUT_MS))
+        revisar_offline(now);
+        serie_mantener(now);
+        if (nube->mantener != NULL)
         {
-            send_blynk_event("sensores_offline", "No se reciben datos de sensores hace 15min");
-            sensores_reportados_offline = true;
-            ESP_LOGW(TAG, "SENSORES OFFLINE detectado!");
+            nube->mantener(now);
         }
 
         vTaskDelay(pdMS_TO_TICKS(100));
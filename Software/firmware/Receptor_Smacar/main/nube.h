@@ -0,0 +1,23 @@
+#ifndef NUBE_H
+#define NUBE_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "telemetria.h"
+
+// --------Subida a la nube---------
+// Backend al que el receptor manda lecturas y eventos. main.c elige uno con NUBE_MQTT: Blynk (HTTP, un GET por
+// valor, en main.c) o MQTT (nube_mqtt.c)
+typedef struct
+{
+    const char *nombre;
+    esp_err_t (*iniciar)(void); // con la red ya iniciada; NULL si no hace falta
+    // Lectura nueva de un nodo. t en s desde 1970, 0 sin hora
+    void (*lectura)(const telemetria_lectura_t *lectura, uint32_t t);
+    void (*evento)(const char *evento, const char *desc);
+    void (*mantener)(uint32_t now); // desde el bucle principal; NULL si no hace falta
+} nube_backend_t;
+
+extern const nube_backend_t nube_mqtt;
+
+#endif
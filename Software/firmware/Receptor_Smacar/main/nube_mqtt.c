@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "mqtt_client.h"
+#include "subida.h"
+#include "nube.h"
+#include "red.h"
+
+// Lecturas por MQTT con QoS1 en una sesion persistente. Las lecturas pasan por la cola de subida (subida.h):
+// se juntan por nodo en un mensaje comprimido, hay como mucho SUBIDA_VENTANA mensajes sin PUBACK y lo que no
+// se pudo subir espera en la cola mientras no hay conexion.
+// La cola de subida solo la toca la tarea que recibe (lectura y mantener). La tarea del cliente MQTT llama a
+// evento_mqtt con el lock interno del cliente tomado, asi que ahi no se espera a nadie: los PUBACK pasan por una
+// cola de FreeRTOS y la conexion por dos banderas, y la tarea que recibe los atiende antes de bombear.
+// Temas:
+//  smacar/<id>/nodo/<n>        lecturas del nodo n, mensajes binarios de subida.h
+//  smacar/<id>/evento/<evento> alertas y nodos offline, texto
+#define NUBE_MQTT_URI "mqtt://192.168.1.10:1883" //---broker
+#define NUBE_MQTT_ID "smacar-receptor"
+#define NUBE_MQTT_USUARIO "smacar"
+#define NUBE_MQTT_CLAVE "**********"
+#define NUBE_MQTT_KEEPALIVE_S 120
+#define NUBE_MQTT_STATS_MS 300000
+#define NUBE_MQTT_EVENTOS 16 // PUBACK y descartes pendientes; si se llena, subida_revisar reenvia lo no confirmado
+
+static const char *TAG = "MQTT";
+
+static esp_mqtt_client_handle_t cliente = NULL;
+static subida_t subida;
+
+// de la tarea del cliente MQTT a la que recibe
+typedef struct
+{
+    esp_mqtt_event_id_t id; // MQTT_EVENT_PUBLISHED o MQTT_EVENT_DELETED
+    int msg_id;
+} evento_t;
+static QueueHandle_t eventos;
+static volatile bool conectado = false;
+static volatile bool conexion_cambio = false;
+static volatile bool sesion_recuperada = false;
+
+static uint32_t ahora_s(void)
+{
+    return xTaskGetTickCount() / configTICK_RATE_HZ;
+}
+
+// Aplica lo que llego de la tarea del cliente MQTT
+static void atender_eventos(void)
+{
+    if (conexion_cambio)
+    {
+        conexion_cambio = false;
+        bool ahora_conectado = conectado;
+        if (ahora_conectado)
+        {
+            ESP_LOGI(TAG, "Conectado (sesion %s), %d lecturas pendientes", sesion_recuperada ? "recuperada" : "nueva",
+                     subida_pendientes(&subida));
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Desconectado, las lecturas quedan en la cola");
+        }
+        subida_conectado(&subida, ahora_conectado, ahora_s());
+    }
+    evento_t evento;
+    while (xQueueReceive(eventos, &evento, 0) == pdTRUE)
+    {
+        if (evento.id == MQTT_EVENT_PUBLISHED)
+        {
+            subida_confirmado(&subida, evento.msg_id);
+        }
+        else
+        {
+            // el outbox lo descarto sin PUBACK: se vuelve a armar desde la cola
+            subida_perdido(&subida, evento.msg_id);
+        }
+    }
+}
+
+// Pasa al cliente MQTT los mensajes que toquen. Solo desde la tarea que recibe
+static void bombear(void)
+{
+    uint8_t mensaje[SUBIDA_MENSAJE_MAX];
+    char tema[48];
+    uint8_t nodo;
+    int hueco;
+    size_t len;
+    atender_eventos();
+    uint32_t ahora = ahora_s();
+    subida_revisar(&subida, ahora);
+    while ((len = subida_siguiente(&subida, ahora, mensaje, &nodo, &hueco)) > 0)
+    {
+        red_actividad();
+        snprintf(tema, sizeof(tema), "smacar/%s/nodo/%u", NUBE_MQTT_ID, nodo);
+        // no bloquea: lo envia la tarea del cliente y lo guarda en su outbox hasta el PUBACK
+        int id = esp_mqtt_client_enqueue(cliente, tema, (const char *)mensaje, (int)len, 1, 0, true);
+        subida_enviado(&subida, hueco, id, ahora);
+        if (id < 0)
+        {
+            ESP_LOGW(TAG, "Outbox lleno, las lecturas esperan en la cola");
+            break;
+        }
+    }
+}
+
+static void evento_mqtt(void *arg, esp_event_base_t base, int32_t id, void *datos)
+{
+    (void)arg;
+    (void)base;
+    esp_mqtt_event_handle_t evento = (esp_mqtt_event_handle_t)datos;
+    switch ((esp_mqtt_event_id_t)id)
+    {
+    case MQTT_EVENT_CONNECTED:
+        sesion_recuperada = evento->session_present;
+        conectado = true;
+        conexion_cambio = true;
+        break;
+    case MQTT_EVENT_DISCONNECTED:
+        conectado = false;
+        conexion_cambio = true;
+        break;
+    case MQTT_EVENT_PUBLISHED:
+    case MQTT_EVENT_DELETED:
+    {
+        // sin esperar: esta tarea tiene el lock del cliente, y la que recibe puede estar en enqueue
+        evento_t e = {.id = (esp_mqtt_event_id_t)id, .msg_id = evento->msg_id};
+        xQueueSend(eventos, &e, 0);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static esp_err_t mqtt_iniciar(void)
+{
+    eventos = xQueueCreate(NUBE_MQTT_EVENTOS, sizeof(evento_t));
+    if (eventos == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    subida_iniciar(&subida);
+    esp_mqtt_client_config_t config = {
+        .broker.address.uri = NUBE_MQTT_URI,
+        .credentials.client_id = NUBE_MQTT_ID,
+        .credentials.username = NUBE_MQTT_USUARIO,
+        .credentials.authentication.password = NUBE_MQTT_CLAVE,
+        .session.keepalive = NUBE_MQTT_KEEPALIVE_S,
+        // el broker guarda la sesion: los QoS1 sin PUBACK se completan al reconectar
+        .session.disable_clean_session = true,
+    };
+    cliente = esp_mqtt_client_init(&config);
+    if (cliente == NULL)
+    {
+        return ESP_FAIL;
+    }
+    esp_mqtt_client_register_event(cliente, (esp_mqtt_event_id_t)ESP_EVENT_ANY_ID, evento_mqtt, NULL);
+    return esp_mqtt_client_start(cliente);
+}
+
+static void mqtt_lectura(const telemetria_lectura_t *lectura, uint32_t t)
+{
+    if (cliente == NULL)
+    {
+        return;
+    }
+    subida_agregar(&subida, lectura, t, ahora_s());
+    bombear();
+}
+
+static void mqtt_evento(const char *evento, const char *desc)
+{
+    if (cliente == NULL)
+    {
+        return;
+    }
+    char tema[64];
+    snprintf(tema, sizeof(tema), "smacar/%s/evento/%s", NUBE_MQTT_ID, evento);
+    // sin conexion queda en el outbox del cliente hasta que vuelve
+    esp_mqtt_client_enqueue(cliente, tema, desc, 0, 1, 0, true);
+}
+
+// Sube los lotes que ya esperaron SUBIDA_ESPERA_S aunque no lleguen mas lecturas
+static void mqtt_mantener(uint32_t now)
+{
+    static uint32_t ultimo_stats = 0;
+    if (cliente == NULL)
+    {
+        return;
+    }
+    bombear();
+    if (now - ultimo_stats >= NUBE_MQTT_STATS_MS)
+    {
+        ESP_LOGI(TAG, "Subida: recibidas=%lu, confirmadas=%lu, descartadas=%lu, mensajes=%lu, reenvios=%lu, "
+                      "pendientes=%d",
+                 (unsigned long)subida.recibidas, (unsigned long)subida.confirmadas,
+                 (unsigned long)subida.descartadas, (unsigned long)subida.mensajes, (unsigned long)subida.reenvios,
+                 subida_pendientes(&subida));
+        ultimo_stats = now;
+    }
+}
+
+const nube_backend_t nube_mqtt = {
+    .nombre = "MQTT",
+    .iniciar = mqtt_iniciar,
+    .lectura = mqtt_lectura,
+    .evento = mqtt_evento,
+    .mantener = mqtt_mantener,
+};
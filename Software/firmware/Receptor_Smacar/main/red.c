@@ -0,0 +1,166 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "conexion.h"
+#include "red.h"
+
+#define RED_CON_IP BIT0
+
+static const char *TAG = "RED";
+
+static conexion_t conexion;
+static SemaphoreHandle_t mutex; // conexion: la tocan el event loop, los timers y las tareas que suben
+static EventGroupHandle_t eventos;
+static esp_timer_handle_t timer_reintento;
+static esp_timer_handle_t timer_ahorro;
+
+static uint32_t ahora_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// Pone el ahorro que toca y programa el siguiente cambio. Con el mutex tomado
+static void aplicar_ahorro(void)
+{
+    static const wifi_ps_type_t modos[] = {WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM};
+    static conexion_ahorro_t actual = CONEXION_AHORRO_NINGUNO;
+    uint32_t ahora = ahora_ms();
+    conexion_ahorro_t ahorro = conexion_ahorro(&conexion, ahora);
+    if (ahorro != actual && ahorro != CONEXION_AHORRO_NINGUNO)
+    {
+        esp_wifi_set_ps(modos[ahorro]);
+        actual = ahorro;
+    }
+    uint32_t cambio_ms = conexion_proximo_ahorro(&conexion, ahora);
+    if (cambio_ms > 0)
+    {
+        esp_timer_stop(timer_ahorro);
+        esp_timer_start_once(timer_ahorro, (uint64_t)cambio_ms * 1000);
+    }
+}
+
+static void reintento_cb(void *arg)
+{
+    (void)arg;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    conexion_intento(&conexion, ahora_ms());
+    xSemaphoreGive(mutex);
+    esp_wifi_connect();
+}
+
+static void ahorro_cb(void *arg)
+{
+    (void)arg;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    aplicar_ahorro();
+    xSemaphoreGive(mutex);
+}
+
+static void evento_wifi(void *arg, esp_event_base_t base, int32_t id, void *datos)
+{
+    (void)arg;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_START)
+    {
+        conexion_intento(&conexion, ahora_ms());
+        esp_wifi_connect();
+        ESP_LOGI(TAG, "Conectando al WiFi...");
+    }
+    else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED)
+    {
+        // en vez de reintentar enseguida: sin AP eso es escanear sin parar y dejar sin CPU a las demas tareas
+        const wifi_event_sta_disconnected_t *desconexion = (const wifi_event_sta_disconnected_t *)datos;
+        xEventGroupClearBits(eventos, RED_CON_IP);
+        uint32_t espera_ms = conexion_caida(&conexion, ahora_ms());
+        esp_timer_stop(timer_reintento);
+        esp_timer_start_once(timer_reintento, (uint64_t)espera_ms * 1000);
+        ESP_LOGW(TAG, "WiFi desconectado (motivo %d), reintento en %lu ms (%u fallos)", desconexion->reason,
+                 (unsigned long)espera_ms, conexion.fallos);
+    }
+    else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP)
+    {
+        conexion_ip(&conexion, ahora_ms());
+        xEventGroupSetBits(eventos, RED_CON_IP);
+        aplicar_ahorro();
+        ESP_LOGI(TAG, "WiFi conectado! IP en %lu ms desde el intento, %lu ms sin red",
+                 (unsigned long)conexion.hasta_ip_ms, (unsigned long)conexion.reconexion_ms);
+    }
+    else if (base == IP_EVENT && id == IP_EVENT_STA_LOST_IP)
+    {
+        xEventGroupClearBits(eventos, RED_CON_IP);
+    }
+    xSemaphoreGive(mutex);
+}
+
+esp_err_t red_iniciar(const char *ssid, const char *clave)
+{
+    mutex = xSemaphoreCreateMutex();
+    eventos = xEventGroupCreate();
+    conexion_iniciar(&conexion, RED_ESPERA_MIN_MS, RED_ESPERA_MAX_MS, esp_random(), ahora_ms());
+    esp_timer_create_args_t reintento = {.callback = reintento_cb, .name = "red reintento"};
+    esp_timer_create_args_t ahorro = {.callback = ahorro_cb, .name = "red ahorro"};
+    ESP_ERROR_CHECK(esp_timer_create(&reintento, &timer_reintento));
+    ESP_ERROR_CHECK(esp_timer_create(&ahorro, &timer_ahorro));
+
+    esp_netif_init();
+    esp_event_loop_create_default();
+    esp_netif_create_default_wifi_sta();
+
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    esp_wifi_init(&cfg);
+
+    esp_event_handler_instance_t instance_any_id;
+    esp_event_handler_instance_t instance_ip;
+    esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &evento_wifi, NULL, &instance_any_id);
+    esp_event_handler_instance_register(IP_EVENT, ESP_EVENT_ANY_ID, &evento_wifi, NULL, &instance_ip);
+
+    wifi_config_t wifi_config = {
+        .sta = {
+            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
+            .listen_interval = RED_LISTEN_INTERVAL,
+        },
+    };
+    strncpy((char *)wifi_config.sta.ssid, ssid, sizeof(wifi_config.sta.ssid));
+    strncpy((char *)wifi_config.sta.password, clave, sizeof(wifi_config.sta.password));
+    esp_wifi_set_mode(WIFI_MODE_STA);
+    esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    return esp_wifi_start();
+}
+
+bool red_con_ip(void)
+{
+    return (xEventGroupGetBits(eventos) & RED_CON_IP) != 0;
+}
+
+bool red_esperar_ip(uint32_t ms)
+{
+    return (xEventGroupWaitBits(eventos, RED_CON_IP, pdFALSE, pdTRUE, pdMS_TO_TICKS(ms)) & RED_CON_IP) != 0;
+}
+
+void red_actividad(void)
+{
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    conexion_actividad(&conexion, ahora_ms());
+    aplicar_ahorro();
+    xSemaphoreGive(mutex);
+}
+
+void red_log_stats(void)
+{
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    uint32_t conexiones = conexion.conexiones > 0 ? conexion.conexiones : 1;
+    ESP_LOGI(TAG, "WiFi: %s, intentos=%lu, conexiones=%lu, caidas=%lu, hasta IP media=%lu max=%lu ms, "
+                  "reconexion media=%lu max=%lu ms",
+             conexion.estado == CONEXION_CON_IP ? "con IP" : "sin IP", (unsigned long)conexion.intentos,
+             (unsigned long)conexion.conexiones, (unsigned long)conexion.caidas,
+             (unsigned long)(conexion.suma_hasta_ip_ms / conexiones), (unsigned long)conexion.max_hasta_ip_ms,
+             (unsigned long)(conexion.suma_reconexion_ms / conexiones), (unsigned long)conexion.max_reconexion_ms);
+    xSemaphoreGive(mutex);
+}
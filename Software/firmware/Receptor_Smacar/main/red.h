@@ -0,0 +1,27 @@
+#ifndef RED_H
+#define RED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// --------Conexion WiFi---------
+// Reintentos con espera exponencial y jitter y ahorro de energia del modem (conexion.h). El estado (con IP o no)
+// lo consultan las tareas que suben datos para no bloquearse en timeouts de red sin WiFi.
+#define RED_ESPERA_MIN_MS 1000
+#define RED_ESPERA_MAX_MS 30000 // con el AP de vuelta se tarda como mucho esto en volver a intentar
+#define RED_LISTEN_INTERVAL 10 // beacons (~1 s) entre despertares en WIFI_PS_MAX_MODEM
+
+esp_err_t red_iniciar(const char *ssid, const char *clave);
+
+bool red_con_ip(void);
+
+// Espera hasta ms a tener IP. Devuelve true si la hay
+bool red_esperar_ip(uint32_t ms);
+
+// Antes de subir algo: despierta el modem en cada DTIM mientras dure el trafico
+void red_actividad(void);
+
+void red_log_stats(void);
+
+#endif
@@ -0,0 +1,140 @@
+/*
+   RadioLib Non-Arduino ESP-IDF HAL Benchmark
+
+   This example measures SPI throughput and interrupt latency
+   of the component-level ESP-IDF HAL and compares it
+   with the example HAL from the ESP-IDF example.
+
+   No radio module is needed, but LOOPBACK_OUT must be wired
+   to LOOPBACK_IN for the interrupt latency measurement.
+
+   For full API reference, see the GitHub Pages
+   https://jgromes.github.io/RadioLib/
+*/
+
+// include the library
+#include <RadioLib.h>
+
+// include both hardware abstraction layers
+#include "hal/ESP-IDF/EspIdfHal.h"
+#if CONFIG_IDF_TARGET_ESP32
+#include "EspHal.h"
+#endif
+
+#include "esp_timer.h"
+#include "esp_log.h"
+
+// SPI pins, same as in the ESP-IDF example
+#define SPI_SCK           (5)
+#define SPI_MISO          (19)
+#define SPI_MOSI          (27)
+
+// loopback pins for the interrupt latency measurement
+#define LOOPBACK_OUT      (25)
+#define LOOPBACK_IN       (26)
+
+#define SPI_ITERATIONS    (1000)
+#define IRQ_ITERATIONS    (100)
+
+static const char *TAG = "benchmark";
+
+static volatile int64_t irqTimestamp = 0;
+static TaskHandle_t benchTask = NULL;
+
+static void IRAM_ATTR irqCallback(void) {
+  irqTimestamp = esp_timer_get_time();
+}
+
+// the example HAL does not wake tasks, so the callback does it on its own
+static void IRAM_ATTR irqCallbackNotify(void) {
+  irqTimestamp = esp_timer_get_time();
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(benchTask, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+static void benchmarkSpi(const char* name, RadioLibHal* hal) {
+  static uint8_t out[255];
+  static uint8_t in[255];
+  const size_t lens[] = { 4, 64, 255 };
+  for(size_t i = 0; i < sizeof(lens)/sizeof(lens[0]); i++) {
+    int64_t start = esp_timer_get_time();
+    for(int n = 0; n < SPI_ITERATIONS; n++) {
+      hal->spiBeginTransaction();
+      hal->spiTransfer(out, lens[i], in);
+      hal->spiEndTransaction();
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    ESP_LOGI(TAG, "[%s] SPI %3u bytes: %6.2f us/transfer, %7.1f kB/s", name, (unsigned)lens[i],
+      (double)elapsed / SPI_ITERATIONS, (double)lens[i] * SPI_ITERATIONS * 1000.0 / (double)elapsed);
+  }
+}
+
+static void benchmarkIrq(const char* name, RadioLibHal* hal, void (*cb)(void), bool (*wait)(RadioLibHal*)) {
+  hal->pinMode(LOOPBACK_OUT, hal->GpioModeOutput);
+  hal->digitalWrite(LOOPBACK_OUT, hal->GpioLevelLow);
+  hal->pinMode(LOOPBACK_IN, hal->GpioModeInput);
+  hal->attachInterrupt(LOOPBACK_IN, cb, hal->GpioInterruptRising);
+
+  int64_t isrSum = 0, isrMax = 0, taskSum = 0, taskMax = 0;
+  int ok = 0;
+  for(int n = 0; n < IRQ_ITERATIONS; n++) {
+    irqTimestamp = 0;
+    int64_t start = esp_timer_get_time();
+    hal->digitalWrite(LOOPBACK_OUT, hal->GpioLevelHigh);
+    if(!wait(hal)) {
+      hal->digitalWrite(LOOPBACK_OUT, hal->GpioLevelLow);
+      continue;
+    }
+    int64_t woken = esp_timer_get_time();
+    hal->digitalWrite(LOOPBACK_OUT, hal->GpioLevelLow);
+
+    int64_t isr = irqTimestamp - start;
+    int64_t task = woken - start;
+    isrSum += isr;
+    taskSum += task;
+    isrMax = (isr > isrMax) ? isr : isrMax;
+    taskMax = (task > taskMax) ? task : taskMax;
+    ok++;
+    hal->delay(2);
+  }
+  hal->detachInterrupt(LOOPBACK_IN);
+
+  if(ok == 0) {
+    ESP_LOGW(TAG, "[%s] no interrupts, is LOOPBACK_OUT wired to LOOPBACK_IN?", name);
+    return;
+  }
+  ESP_LOGI(TAG, "[%s] IRQ to callback: avg %.1f us, max %lld us", name, (double)isrSum / ok, isrMax);
+  ESP_LOGI(TAG, "[%s] IRQ to task:     avg %.1f us, max %lld us", name, (double)taskSum / ok, taskMax);
+}
+
+static bool waitNotify(RadioLibHal* hal) {
+  (void)hal;
+  return(ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100)) > 0);
+}
+
+// the entry point for the program
+// it must be declared as "extern C" because the compiler assumes this will be a C function
+extern "C" void app_main(void) {
+  benchTask = xTaskGetCurrentTaskHandle();
+
+  // component HAL, task is woken by the HAL itself
+  EspIdfHal* idfHal = new EspIdfHal(SPI_SCK, SPI_MISO, SPI_MOSI);
+  idfHal->init();
+  idfHal->setIrqTask(benchTask);
+  benchmarkSpi("EspIdfHal", idfHal);
+  benchmarkIrq("EspIdfHal", idfHal, irqCallback, waitNotify);
+  idfHal->setIrqTask(NULL);
+  idfHal->term();
+
+#if CONFIG_IDF_TARGET_ESP32
+  // example HAL, task is woken from the callback
+  EspHal* exampleHal = new EspHal(SPI_SCK, SPI_MISO, SPI_MOSI);
+  exampleHal->init();
+  benchmarkSpi("EspHal", exampleHal);
+  benchmarkIrq("EspHal", exampleHal, irqCallbackNotify, waitNotify);
+  exampleHal->term();
+#endif
+
+  ESP_LOGI(TAG, "done");
+}
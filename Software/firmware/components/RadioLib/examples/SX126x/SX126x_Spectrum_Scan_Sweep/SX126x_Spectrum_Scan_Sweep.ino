@@ -0,0 +1,96 @@
+/*
+  RadioLib SX126x Spectrum Scan Sweep Example
+
+  This example shows how to sweep a frequency range with spectral scans
+  using SX126x. Scans are performed back-to-back on the device and each
+  33-bin histogram is sent over Serial as a compact binary record,
+  which is much faster than printing the values as text.
+
+  To save the results as a waterfall, build and run the recorder in
+  RadioLib/extras/SX126x_Spectrum_Scan/WaterfallRecorder
+
+  WARNING: This functionality is experimental and requires a binary patch
+  to be uploaded to the SX126x device. There may be some undocumented
+  side effects!
+
+  For default module settings, see the wiki page
+  https://github.com/jgromes/RadioLib/wiki/Default-configuration#sx126x---lora-modem
+
+  For full API reference, see the GitHub Pages
+  https://jgromes.github.io/RadioLib/
+*/
+
+// include the library
+#include <RadioLib.h>
+
+// this file contains binary patch for the SX1262
+#include <modules/SX126x/patches/SX126x_patch_scan.h>
+
+// SX1262 has the following connections:
+// NSS pin:   10
+// DIO1 pin:  2
+// NRST pin:  3
+// BUSY pin:  9
+SX1262 radio = new Module(10, 2, 3, 9);
+
+// or detect the pinout automatically using RadioBoards
+// https://github.com/radiolib-org/RadioBoards
+/*
+#define RADIO_BOARD_AUTO
+#include <RadioBoards.h>
+Radio radio = new RadioModule();
+*/
+
+// frequency range to scan: 902 - 928 MHz in 200 kHz steps
+// the frequency step should be slightly smaller
+// or the same as the Rx bandwidth set in setup
+const float freqStart = 902.0;
+const float freqStep = 0.2;
+const uint16_t numSteps = 130;
+
+// the stream is binary, so nothing else may be printed once the sweep starts
+void streamOutput(const uint8_t* data, size_t len) {
+  Serial.write(data, len);
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  // initialize SX1262 FSK modem at the initial frequency
+  int state = radio.beginFSK(freqStart);
+  if(state != RADIOLIB_ERR_NONE) {
+    Serial.print(F("[SX1262] Initialization failed, code "));
+    Serial.println(state);
+    while (true) { delay(10); }
+  }
+
+  // upload a patch to the SX1262 to enable spectral scan
+  // NOTE: this patch is uploaded into volatile memory,
+  //       and must be re-uploaded on every power up
+  state = radio.uploadPatch(sx126x_patch_scan, sizeof(sx126x_patch_scan));
+  if(state != RADIOLIB_ERR_NONE) {
+    Serial.print(F("[SX1262] Patch upload failed, code "));
+    Serial.println(state);
+    while (true) { delay(10); }
+  }
+
+  // configure scan bandwidth to 234.4 kHz
+  // and disable the data shaping
+  state = radio.setRxBandwidth(234.3);
+  state |= radio.setDataShaping(RADIOLIB_SHAPING_NONE);
+  if(state != RADIOLIB_ERR_NONE) {
+    Serial.print(F("[SX1262] Setting scan parameters failed, code "));
+    Serial.println(state);
+    while (true) { delay(10); }
+  }
+}
+
+void loop() {
+  // perform one sweep over the entire frequency range
+  // number of samples: 2048 (fewer samples = faster sweep, but less sensitive)
+  int state = radio.spectralScanSweep(freqStart, freqStep, numSteps, streamOutput, 1, 2048);
+  if(state != RADIOLIB_ERR_NONE) {
+    // the sweep may have been interrupted, the recorder drops the incomplete one
+    delay(100);
+  }
+}
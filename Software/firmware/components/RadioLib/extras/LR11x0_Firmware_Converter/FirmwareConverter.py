@@ -0,0 +1,57 @@
+#!/usr/bin/python3
+# -*- encoding: utf-8 -*-
+
+import argparse
+import re
+import struct
+import zlib
+from argparse import RawTextHelpFormatter
+
+def main():
+  parser = argparse.ArgumentParser(formatter_class=RawTextHelpFormatter, description='''
+        RadioLib LR11x0 firmware header to binary conversion tool.
+
+        Input is one of the lr11x0_transceiver_*.h firmware headers.
+
+        Output is a raw little-endian binary image (by default named "lr11x0.bin"),
+        which can be stored in a filesystem or a flash partition and uploaded
+        with LR11x0::updateFirmware(cb, size, ctx) without linking the array into the application.
+
+        The images are encrypted, so they do not compress - the tool reports
+        the compression ratio so that this can be verified for new images.
+    ''')
+  parser.add_argument('input',
+      type=str,
+      help='Input firmware header file')
+  parser.add_argument('output',
+      type=str,
+      nargs='?',
+      default='lr11x0',
+      help='Output binary file')
+  args = parser.parse_args()
+  outfile = f'{args.output}.bin'
+  print(f'Converting "{args.input}" to "{outfile}"')
+
+  # parse the array body, skipping the license and the size macro
+  with open(args.input, 'r') as f:
+    src = f.read()
+  body = src[src.index('{'):src.rindex('}')]
+  words = [int(w, 16) for w in re.findall(r'0x[0-9a-fA-F]+', body)]
+
+  # check the image size against the header
+  size = re.search(r'LR11XX_FIRMWARE_IMAGE_SIZE\s+(\d+)', src)
+  if size and int(size.group(1)) != len(words):
+    print(f'Size mismatch: header declares {size.group(1)} words, found {len(words)}')
+    return
+
+  data = b''.join(struct.pack('<I', w) for w in words)
+  with open(outfile, 'wb') as f:
+    f.write(data)
+
+  packed = len(zlib.compress(data, 9))
+  print(f'Image size: {len(words)} words ({len(data)} bytes)')
+  print(f'Deflate size: {packed} bytes ({100.0*packed/len(data):.1f} %)')
+  print('Done!')
+
+if __name__ == "__main__":
+    main()
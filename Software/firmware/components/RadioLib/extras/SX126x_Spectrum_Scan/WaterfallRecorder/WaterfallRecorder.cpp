@@ -0,0 +1,234 @@
+/*
+  RadioLib SX126x spectral scan waterfall recorder
+
+  Decodes the binary stream produced by SX126x::spectralScanSweep
+  (see the SX126x_Spectrum_Scan_Sweep example) and saves every sweep
+  as one row of a waterfall, both as CSV and as a grayscale PGM image.
+
+  Usage:
+    WaterfallRecorder <input> [--speed baud] [--sweeps N] [--out prefix]
+
+  The input is either a serial port (e.g. /dev/ttyUSB0), which is configured
+  to raw mode at the given speed, or a file with a previously captured stream.
+  Recording stops after the requested number of sweeps or at the end of the input.
+
+  Each cell of the waterfall is the mean RSSI of the scan histogram in dBm,
+  first histogram bin corresponds to -11 dBm, each following bin is 4 dB lower.
+*/
+
+#include <RadioLib.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <termios.h>
+  #include <unistd.h>
+#endif
+
+// RSSI of the first histogram bin and the bin width
+#define WATERFALL_RSSI_OFFSET   (-11)
+#define WATERFALL_RSSI_STEP     (4)
+
+// defaults
+#define DEFAULT_BAUDRATE        (115200)
+#define DEFAULT_NUM_SWEEPS      (100)
+#define DEFAULT_OUT_PREFIX      "waterfall"
+
+struct WaterfallRow {
+  RadioLibScanSweep_t sweep;
+  std::vector<float> rssi;
+  std::vector<bool> valid;
+};
+
+// mean RSSI of a single scan line
+static float meanRssi(const uint16_t* bins, uint8_t numBins) {
+  uint32_t total = 0;
+  float sum = 0;
+  for(uint8_t i = 0; i < numBins; i++) {
+    total += bins[i];
+    sum += (float)bins[i] * (WATERFALL_RSSI_OFFSET - WATERFALL_RSSI_STEP*i);
+  }
+  if(total == 0) {
+    return(WATERFALL_RSSI_OFFSET - WATERFALL_RSSI_STEP*numBins);
+  }
+  return(sum / total);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+static speed_t baudToSpeed(long baud) {
+  switch(baud) {
+    case 9600: return(B9600);
+    case 19200: return(B19200);
+    case 38400: return(B38400);
+    case 57600: return(B57600);
+    case 115200: return(B115200);
+    case 230400: return(B230400);
+    default: return(B0);
+  }
+}
+
+// switch a serial port to raw mode, no-op for regular files
+static bool configurePort(FILE* f, long baud) {
+  int fd = fileno(f);
+  if(!isatty(fd)) {
+    return(true);
+  }
+  speed_t speed = baudToSpeed(baud);
+  struct termios tty;
+  if((speed == B0) || (tcgetattr(fd, &tty) != 0)) {
+    return(false);
+  }
+  cfmakeraw(&tty);
+  cfsetispeed(&tty, speed);
+  cfsetospeed(&tty, speed);
+  tty.c_cc[VMIN] = 1;
+  tty.c_cc[VTIME] = 0;
+  return(tcsetattr(fd, TCSANOW, &tty) == 0);
+}
+#else
+static bool configurePort(FILE* f, long baud) {
+  (void)f;
+  (void)baud;
+  return(true);
+}
+#endif
+
+static bool saveCsv(const std::string& path, const std::vector<WaterfallRow>& rows) {
+  FILE* f = fopen(path.c_str(), "w");
+  if(!f) {
+    return(false);
+  }
+
+  // frequencies of the first sweep are used for the header
+  const RadioLibScanSweep_t& first = rows[0].sweep;
+  fprintf(f, "sequence,timestamp_ms");
+  for(uint16_t i = 0; i < first.numSteps; i++) {
+    fprintf(f, ",%.3f", (first.freqStart + (double)first.freqStep*i) / 1000000.0);
+  }
+  fprintf(f, "\n");
+
+  for(const WaterfallRow& row : rows) {
+    fprintf(f, "%lu,%lu", (unsigned long)row.sweep.sequence, (unsigned long)row.sweep.timestamp);
+    for(size_t i = 0; i < row.rssi.size(); i++) {
+      if(row.valid[i]) {
+        fprintf(f, ",%.1f", row.rssi[i]);
+      } else {
+        fprintf(f, ",");
+      }
+    }
+    fprintf(f, "\n");
+  }
+  fclose(f);
+  return(true);
+}
+
+static bool savePgm(const std::string& path, const std::vector<WaterfallRow>& rows) {
+  FILE* f = fopen(path.c_str(), "wb");
+  if(!f) {
+    return(false);
+  }
+
+  // scale to the full histogram range, missing lines are black
+  const size_t width = rows[0].rssi.size();
+  const float lo = WATERFALL_RSSI_OFFSET - WATERFALL_RSSI_STEP*RADIOLIB_SCAN_STREAM_MAX_BINS;
+  const float hi = WATERFALL_RSSI_OFFSET;
+  fprintf(f, "P5\n%zu %zu\n255\n", width, rows.size());
+  for(const WaterfallRow& row : rows) {
+    for(size_t i = 0; i < width; i++) {
+      uint8_t px = 0;
+      if((i < row.rssi.size()) && row.valid[i]) {
+        float val = (row.rssi[i] - lo) * 255.0f / (hi - lo);
+        px = (val < 0) ? 0 : ((val > 255) ? 255 : (uint8_t)val);
+      }
+      fputc(px, f);
+    }
+  }
+  fclose(f);
+  return(true);
+}
+
+int main(int argc, char** argv) {
+  if(argc < 2) {
+    fprintf(stderr, "Usage: %s <port or file> [--speed baud] [--sweeps N] [--out prefix]\n", argv[0]);
+    return(EXIT_FAILURE);
+  }
+
+  const char* input = argv[1];
+  long baud = DEFAULT_BAUDRATE;
+  long numSweeps = DEFAULT_NUM_SWEEPS;
+  std::string prefix = DEFAULT_OUT_PREFIX;
+  for(int i = 2; i < argc - 1; i += 2) {
+    if(strcmp(argv[i], "--speed") == 0) {
+      baud = strtol(argv[i + 1], NULL, 10);
+    } else if(strcmp(argv[i], "--sweeps") == 0) {
+      numSweeps = strtol(argv[i + 1], NULL, 10);
+    } else if(strcmp(argv[i], "--out") == 0) {
+      prefix = argv[i + 1];
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return(EXIT_FAILURE);
+    }
+  }
+
+  FILE* f = fopen(input, "rb");
+  if(!f) {
+    fprintf(stderr, "Failed to open %s\n", input);
+    return(EXIT_FAILURE);
+  }
+  if(!configurePort(f, baud)) {
+    fprintf(stderr, "Failed to configure %s at %ld baud\n", input, baud);
+    fclose(f);
+    return(EXIT_FAILURE);
+  }
+
+  RadioLibScanDecoder decoder;
+  std::vector<WaterfallRow> rows;
+  size_t lines = 0;
+  int c;
+  while(((c = fgetc(f)) != EOF) && ((long)rows.size() <= numSweeps)) {
+    for(uint8_t res = decoder.push((uint8_t)c); res != RADIOLIB_SCAN_STREAM_NONE; res = decoder.poll()) {
+      if(res == RADIOLIB_SCAN_STREAM_SWEEP) {
+        rows.push_back({ decoder.sweep, std::vector<float>(decoder.sweep.numSteps), std::vector<bool>(decoder.sweep.numSteps, false) });
+        fprintf(stderr, "\rSweep %lu", (unsigned long)decoder.sweep.sequence);
+        continue;
+      }
+
+      // lines received before the first sweep record cannot be placed
+      if(rows.empty()) {
+        continue;
+      }
+      WaterfallRow& row = rows.back();
+      if(decoder.step < row.rssi.size()) {
+        row.rssi[decoder.step] = meanRssi(decoder.bins, decoder.sweep.numBins);
+        row.valid[decoder.step] = true;
+        lines++;
+      }
+    }
+  }
+  fclose(f);
+  fprintf(stderr, "\n");
+
+  // the last sweep only started if the requested number was reached
+  if((long)rows.size() > numSweeps) {
+    rows.pop_back();
+  }
+  if(rows.empty()) {
+    fprintf(stderr, "No sweeps received\n");
+    return(EXIT_FAILURE);
+  }
+
+  printf("Sweeps: %zu, lines: %zu, corrupted records: %lu, dropped lines: %lu\n",
+    rows.size(), lines, (unsigned long)decoder.errors, (unsigned long)decoder.dropped);
+
+  if(!saveCsv(prefix + ".csv", rows) || !savePgm(prefix + ".pgm", rows)) {
+    fprintf(stderr, "Failed to save output files\n");
+    return(EXIT_FAILURE);
+  }
+  printf("Saved %s.csv and %s.pgm\n", prefix.c_str(), prefix.c_str());
+  return(EXIT_SUCCESS);
+}
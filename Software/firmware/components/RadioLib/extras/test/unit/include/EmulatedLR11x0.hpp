@@ -0,0 +1,127 @@
+#ifndef EMULATED_LR11X0_HPP
+#define EMULATED_LR11X0_HPP
+
+#include <string.h>
+#include <vector>
+
+#include <RadioLib.h>
+
+#include "HardwareEmulation.hpp"
+
+// longest SPI command, flash write with offset and a full data chunk
+#define EMULATED_LR11X0_CMD_LEN   (2 + 4 + RADIOLIB_LR11X0_SPI_MAX_READ_WRITE_LEN)
+
+// status byte returned as the first byte of every transaction
+#define EMULATED_LR11X0_STAT_1    (RADIOLIB_LR11X0_STAT_1_CMD_OK)
+
+// emulated LR11x0 command interface, enough for begin() and the firmware update through the bootloader
+// reads take two transactions: the command, then the status byte followed by the response
+// reboot with stay set enters the bootloader, a reset always starts the flash image (image validation is not emulated)
+// read commands not emulated here answer with zeros, BUSY (GPIO pin) is always low
+class EmulatedLR11x0 : public EmulatedRadio {
+  public:
+    explicit EmulatedLR11x0(uint8_t device = RADIOLIB_LR11X0_DEVICE_LR1121) : device(device) {}
+
+    uint8_t HandleSPI(uint8_t b) override {
+      uint8_t out = EMULATED_LR11X0_STAT_1;
+      if((this->cmdLen > 0) && (this->cmdLen <= this->resp.size())) {
+        out = this->resp[this->cmdLen - 1];
+      }
+      if(this->cmdLen < EMULATED_LR11X0_CMD_LEN) {
+        this->cmd[this->cmdLen++] = b;
+      }
+      return(out);
+    }
+
+    void HandleGPIO() override {
+      if(this->rst->event && (this->rst->value == 0)) {
+        this->boot = false;
+        this->resets++;
+      }
+
+      if(this->cs->event) {
+        if(this->cs->value == 0) {
+          this->cmdLen = 0;
+        } else if(this->cmdLen >= 2) {
+          this->execute();
+        }
+      }
+    }
+
+    // true while the device runs the bootloader
+    bool boot = false;
+
+    // flash content in 32-bit words, empty after an erase
+    std::vector<uint32_t> flash;
+
+    // number of flash erases and resets through the reset pin
+    unsigned int erases = 0;
+    unsigned int resets = 0;
+
+  protected:
+    uint8_t device;
+    uint8_t packetType = RADIOLIB_LR11X0_PACKET_TYPE_NONE;
+    uint8_t cmd[EMULATED_LR11X0_CMD_LEN] = { 0 };
+    size_t cmdLen = 0;
+
+    // response clocked out in the data phase of the next read transaction
+    std::vector<uint8_t> resp;
+
+    void execute() {
+      uint16_t op = ((uint16_t)this->cmd[0] << 8) | this->cmd[1];
+      const uint8_t* p = &this->cmd[2];
+      size_t argLen = this->cmdLen - 2;
+
+      // NOP is the data phase of a read, the response has been consumed
+      if(op == RADIOLIB_LR11X0_CMD_NOP) {
+        this->resp.clear();
+        return;
+      }
+
+      this->resp.assign(16, 0x00);
+      switch(op) {
+        case RADIOLIB_LR11X0_CMD_GET_VERSION:
+          this->resp[0] = 0x22;
+          this->resp[1] = this->boot ? (uint8_t)RADIOLIB_LR11X0_DEVICE_BOOT : this->device;
+          this->resp[2] = 0x01;
+          this->resp[3] = 0x03;
+          break;
+
+        case RADIOLIB_LR11X0_CMD_SET_PACKET_TYPE:
+          this->packetType = (argLen > 0) ? p[0] : this->packetType;
+          break;
+
+        case RADIOLIB_LR11X0_CMD_GET_PACKET_TYPE:
+          this->resp[0] = this->packetType;
+          break;
+
+        case RADIOLIB_LR11X0_CMD_REBOOT:
+          this->boot = (argLen > 0) && (p[0] != 0);
+          break;
+
+        case RADIOLIB_LR11X0_CMD_BOOT_ERASE_FLASH:
+          if(this->boot) {
+            this->flash.clear();
+            this->erases++;
+          }
+          break;
+
+        case RADIOLIB_LR11X0_CMD_BOOT_WRITE_FLASH_ENCRYPTED: {
+          if(!this->boot || (argLen < 4)) {
+            break;
+          }
+          uint32_t offset = (((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]) / sizeof(uint32_t);
+          size_t words = (argLen - 4) / sizeof(uint32_t);
+          if(this->flash.size() < offset + words) {
+            this->flash.resize(offset + words, 0xFFFFFFFF);
+          }
+          for(size_t i = 0; i < words; i++) {
+            const uint8_t* w = &p[4 + i*sizeof(uint32_t)];
+            this->flash[offset + i] = ((uint32_t)w[0] << 24) | ((uint32_t)w[1] << 16) | ((uint32_t)w[2] << 8) | w[3];
+          }
+        } break;
+      }
+    }
+};
+
+#endif
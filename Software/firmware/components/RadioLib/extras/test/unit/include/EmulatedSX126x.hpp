@@ -0,0 +1,419 @@
+#ifndef EMULATED_SX126X_HPP
+#define EMULATED_SX126X_HPP
+
+#include <string.h>
+#include <vector>
+
+#include <RadioLib.h>
+
+#include "HardwareEmulation.hpp"
+
+// size of the emulated register space (version string, sync word, OCP etc. are all below this)
+#define EMULATED_SX126X_REG_SPACE (0x1000)
+
+// longest SPI command, WriteBuffer with the full data buffer
+#define EMULATED_SX126X_CMD_LEN   (2 + 256)
+
+// chip modes as reported in the status byte
+#define EMULATED_SX126X_MODE_STBY_RC  (0x02)
+#define EMULATED_SX126X_MODE_RX       (0x05)
+#define EMULATED_SX126X_MODE_TX       (0x06)
+
+// noise floor seen by the emulated spectral scan
+#define EMULATED_SX126X_NOISE_FLOOR   (-110)
+
+// emulated SX126x command interface
+// LoRa transmission and reception take the real time-on-air of the configured packet,
+// the DIO1 (IRQ pin) line goes high when an interrupt enabled by SetDioIrqParams occurs
+// spectral scan takes the configured number of samples and reports a histogram of the signals added by addSignal
+// BUSY (GPIO pin) is always low, commands complete instantly
+class EmulatedSX126x : public EmulatedRadio {
+  public:
+    explicit EmulatedSX126x(const char* version = "SX1261 V2D 2D02") {
+      strncpy(this->version, version, sizeof(this->version));
+      this->reset();
+    }
+
+    uint8_t HandleSPI(uint8_t b) override {
+      uint8_t out = this->response(this->cmdLen);
+      if(this->cmdLen < EMULATED_SX126X_CMD_LEN) {
+        this->cmd[this->cmdLen++] = b;
+      }
+      return(out);
+    }
+
+    void HandleGPIO() override {
+      if(this->rst->event && (this->rst->value == 0)) {
+        this->reset();
+      }
+
+      if(this->cs->event) {
+        if(this->cs->value == 0) {
+          // start of a new command
+          this->cmdLen = 0;
+        } else if(this->cmdLen > 0) {
+          // the command is complete when NSS goes high
+          this->execute();
+        }
+      }
+    }
+
+    void HandleTime(unsigned long us) override {
+      EmulatedRadio::HandleTime(us);
+
+      if(this->packetAt <= us) {
+        unsigned long start = this->packetAt;
+        this->packetAt = EMULATED_RADIO_NO_EVENT;
+        if(this->mode == EMULATED_SX126X_MODE_RX) {
+          // preamble detected, the hardware stops the timeout and demodulates the rest of the packet
+          this->rxTimeoutAt = EMULATED_RADIO_NO_EVENT;
+          this->rxDoneAt = start + this->timeOnAir(this->packet.size());
+        } else {
+          this->missed++;
+        }
+      }
+
+      if(this->txDoneAt <= us) {
+        this->txDoneAt = EMULATED_RADIO_NO_EVENT;
+        this->mode = EMULATED_SX126X_MODE_STBY_RC;
+        this->setIrq(RADIOLIB_SX126X_IRQ_TX_DONE);
+      }
+
+      if(this->rxDoneAt <= us) {
+        this->rxDoneAt = EMULATED_RADIO_NO_EVENT;
+        for(size_t i = 0; i < this->packet.size(); i++) {
+          this->buffer[(uint8_t)(this->rxBase + i)] = this->packet[i];
+        }
+        this->rxLen = this->packet.size();
+        if(!this->rxContinuous) {
+          this->mode = EMULATED_SX126X_MODE_STBY_RC;
+        }
+        this->setIrq(RADIOLIB_SX126X_IRQ_HEADER_VALID | RADIOLIB_SX126X_IRQ_RX_DONE);
+      }
+
+      if(this->rxTimeoutAt <= us) {
+        this->rxTimeoutAt = EMULATED_RADIO_NO_EVENT;
+        this->mode = EMULATED_SX126X_MODE_STBY_RC;
+        this->setIrq(RADIOLIB_SX126X_IRQ_TIMEOUT);
+      }
+
+      if(this->scanDoneAt <= us) {
+        this->scanDoneAt = EMULATED_RADIO_NO_EVENT;
+        this->finishScan();
+      }
+    }
+
+    unsigned long NextEvent() override {
+      unsigned long next = this->packetAt;
+      next = (this->txDoneAt < next) ? this->txDoneAt : next;
+      next = (this->rxDoneAt < next) ? this->rxDoneAt : next;
+      next = (this->rxTimeoutAt < next) ? this->rxTimeoutAt : next;
+      next = (this->scanDoneAt < next) ? this->scanDoneAt : next;
+      return(next);
+    }
+
+    // schedule a packet to arrive at the given time, it is received only if the radio is in Rx by then
+    void schedulePacket(const uint8_t* data, size_t len, unsigned long at, int8_t rssi = -60, int8_t snr = 10) {
+      this->packet.assign(data, data + len);
+      this->packetAt = at;
+      this->rssi = rssi;
+      this->snr = snr;
+    }
+
+    // add a constant signal, seen by the spectral scan when the radio is tuned within its bandwidth
+    void addSignal(uint32_t freq, uint32_t bw, int16_t power) {
+      this->signals.push_back({ freq, bw, power });
+    }
+
+    // currently set RF frequency in Hz
+    uint32_t getFrequency() const {
+      return(((uint64_t)this->frf * (uint64_t)(RADIOLIB_SX126X_CRYSTAL_FREQ * 1000000.0f)) >> RADIOLIB_SX126X_DIV_EXPONENT);
+    }
+
+    // time-on-air of a LoRa packet with the current modulation and packet parameters
+    unsigned long timeOnAir(size_t len) const {
+      static const uint32_t bandwidths[] = { 7810, 15630, 31250, 62500, 125000, 250000, 500000, 0, 10420, 20830, 41670 };
+      uint8_t bwIdx = this->modParams[1];
+      if((this->packetType != RADIOLIB_SX126X_PACKET_TYPE_LORA) || (bwIdx >= sizeof(bandwidths)/sizeof(bandwidths[0])) || !bandwidths[bwIdx]) {
+        // only LoRa is timed, anything else completes instantly
+        return(0);
+      }
+
+      LoRaAirTimeConfig_t cfg = {
+        this->modParams[0],
+        bandwidths[bwIdx],
+        (uint8_t)(this->modParams[2] + 4),
+        ((uint32_t)this->packetParams[0] << 8) | this->packetParams[1],
+        this->packetParams[2] == RADIOLIB_SX126X_LORA_HEADER_IMPLICIT,
+        this->packetParams[4] == RADIOLIB_SX126X_LORA_CRC_ON,
+        this->modParams[3] ? (uint8_t)RADIOLIB_AIRTIME_LDRO_ON : (uint8_t)RADIOLIB_AIRTIME_LDRO_OFF,
+        false,
+      };
+      return(RadioLibAirTime::timeOnAirUs(cfg, len));
+    }
+
+    // last transmitted packet and the time its transmission started
+    std::vector<uint8_t> txPacket;
+    unsigned long txStart = 0;
+
+    // number of scheduled packets that arrived while the radio was not receiving
+    unsigned int missed = 0;
+
+    // number of completed spectral scans
+    unsigned int scans = 0;
+
+  protected:
+    char version[16] = { 0 };
+    uint8_t regs[EMULATED_SX126X_REG_SPACE] = { 0 };
+    uint8_t buffer[256] = { 0 };
+    uint8_t cmd[EMULATED_SX126X_CMD_LEN] = { 0 };
+    size_t cmdLen = 0;
+
+    uint8_t mode = EMULATED_SX126X_MODE_STBY_RC;
+    uint8_t packetType = RADIOLIB_SX126X_PACKET_TYPE_GFSK;
+    uint8_t modParams[8] = { 0 };
+    uint8_t packetParams[9] = { 0 };
+    uint8_t txBase = 0;
+    uint8_t rxBase = 0;
+    uint8_t rxLen = 0;
+    bool rxContinuous = false;
+
+    uint16_t irqStatus = 0;
+    uint16_t irqMask = 0;
+    uint16_t dio1Mask = 0;
+
+    unsigned long txDoneAt = EMULATED_RADIO_NO_EVENT;
+    unsigned long rxDoneAt = EMULATED_RADIO_NO_EVENT;
+    unsigned long rxTimeoutAt = EMULATED_RADIO_NO_EVENT;
+
+    uint32_t frf = 0;
+    struct Signal {
+      uint32_t freq;
+      uint32_t bw;
+      int16_t power;
+    };
+    std::vector<Signal> signals;
+    uint16_t scanSamples = 0;
+    unsigned long scanDoneAt = EMULATED_RADIO_NO_EVENT;
+
+    std::vector<uint8_t> packet;
+    unsigned long packetAt = EMULATED_RADIO_NO_EVENT;
+    int8_t rssi = 0;
+    int8_t snr = 0;
+
+    void reset() {
+      memset(this->regs, 0x00, sizeof(this->regs));
+      memcpy(&this->regs[RADIOLIB_SX126X_REG_VERSION_STRING], this->version, sizeof(this->version));
+      this->mode = EMULATED_SX126X_MODE_STBY_RC;
+      this->packetType = RADIOLIB_SX126X_PACKET_TYPE_GFSK;
+      this->irqStatus = 0;
+      this->irqMask = 0;
+      this->dio1Mask = 0;
+      this->txDoneAt = EMULATED_RADIO_NO_EVENT;
+      this->rxDoneAt = EMULATED_RADIO_NO_EVENT;
+      this->rxTimeoutAt = EMULATED_RADIO_NO_EVENT;
+      this->scanDoneAt = EMULATED_RADIO_NO_EVENT;
+      this->frf = 0;
+      if(this->irq) {
+        this->irq->value = 0;
+      }
+    }
+
+    uint8_t status() const {
+      return(this->mode << 4);
+    }
+
+    // byte clocked out while the host sends byte number idx of the command
+    uint8_t response(size_t idx) const {
+      if(idx == 0) {
+        return(this->status());
+      }
+
+      switch(this->cmd[0]) {
+        case RADIOLIB_SX126X_CMD_READ_REGISTER:
+          if(idx >= 4) {
+            uint16_t addr = (((uint16_t)this->cmd[1] << 8) | this->cmd[2]) + (idx - 4);
+            return(this->regs[addr % EMULATED_SX126X_REG_SPACE]);
+          }
+          break;
+
+        case RADIOLIB_SX126X_CMD_READ_BUFFER:
+          if(idx >= 3) {
+            return(this->buffer[(uint8_t)(this->cmd[1] + (idx - 3))]);
+          }
+          break;
+
+        case RADIOLIB_SX126X_CMD_GET_IRQ_STATUS: {
+          const uint8_t data[] = { (uint8_t)(this->irqStatus >> 8), (uint8_t)this->irqStatus };
+          if((idx >= 2) && (idx < 4)) {
+            return(data[idx - 2]);
+          }
+        } break;
+
+        case RADIOLIB_SX126X_CMD_GET_PACKET_TYPE:
+          if(idx == 2) {
+            return(this->packetType);
+          }
+          break;
+
+        case RADIOLIB_SX126X_CMD_GET_RX_BUFFER_STATUS: {
+          const uint8_t data[] = { this->rxLen, this->rxBase };
+          if((idx >= 2) && (idx < 4)) {
+            return(data[idx - 2]);
+          }
+        } break;
+
+        case RADIOLIB_SX126X_CMD_GET_PACKET_STATUS: {
+          // RSSI is reported as -2x dBm, SNR as 4x dB
+          const uint8_t data[] = { (uint8_t)(-2*this->rssi), (uint8_t)(4*this->snr), (uint8_t)(-2*this->rssi) };
+          if((idx >= 2) && (idx < 5)) {
+            return(data[idx - 2]);
+          }
+        } break;
+
+        case RADIOLIB_SX126X_CMD_GET_DEVICE_ERRORS:
+          if(idx >= 2) {
+            return(0x00);
+          }
+          break;
+      }
+
+      return(this->status());
+    }
+
+    void execute() {
+      const uint8_t* p = &this->cmd[1];
+      switch(this->cmd[0]) {
+        case RADIOLIB_SX126X_CMD_SET_STANDBY:
+        case RADIOLIB_SX126X_CMD_SET_SLEEP:
+          this->mode = EMULATED_SX126X_MODE_STBY_RC;
+          this->txDoneAt = EMULATED_RADIO_NO_EVENT;
+          this->rxDoneAt = EMULATED_RADIO_NO_EVENT;
+          this->rxTimeoutAt = EMULATED_RADIO_NO_EVENT;
+          if(this->scanDoneAt != EMULATED_RADIO_NO_EVENT) {
+            this->scanDoneAt = EMULATED_RADIO_NO_EVENT;
+            this->regs[RADIOLIB_SX126X_REG_SPECTRAL_SCAN_STATUS] = RADIOLIB_SX126X_SPECTRAL_SCAN_ABORTED;
+          }
+          break;
+
+        case RADIOLIB_SX126X_CMD_SET_RF_FREQUENCY:
+          this->frf = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+          break;
+
+        case RADIOLIB_SX126X_CMD_SET_SPECTR_SCAN_PARAMS: {
+          // RSSI is sampled every 7.68, 8.20 or 8.68 us
+          static const uint32_t intervalsNs[] = { 7680, 8200, 8680 };
+          uint8_t interval = p[2] - RADIOLIB_SX126X_SCAN_INTERVAL_7_68_US;
+          this->scanSamples = ((uint16_t)p[0] << 8) | p[1];
+          this->scanDoneAt = this->now + ((unsigned long)this->scanSamples * intervalsNs[interval % 3]) / 1000;
+          this->regs[RADIOLIB_SX126X_REG_SPECTRAL_SCAN_STATUS] = RADIOLIB_SX126X_SPECTRAL_SCAN_ONGOING;
+        } break;
+
+        case RADIOLIB_SX126X_CMD_SET_PACKET_TYPE:
+          this->packetType = p[0];
+          break;
+
+        case RADIOLIB_SX126X_CMD_SET_MODULATION_PARAMS:
+          memcpy(this->modParams, p, this->argLen(sizeof(this->modParams)));
+          break;
+
+        case RADIOLIB_SX126X_CMD_SET_PACKET_PARAMS:
+          memcpy(this->packetParams, p, this->argLen(sizeof(this->packetParams)));
+          break;
+
+        case RADIOLIB_SX126X_CMD_SET_BUFFER_BASE_ADDRESS:
+          this->txBase = p[0];
+          this->rxBase = p[1];
+          break;
+
+        case RADIOLIB_SX126X_CMD_WRITE_BUFFER:
+          for(size_t i = 2; i < this->cmdLen; i++) {
+            this->buffer[(uint8_t)(p[0] + i - 2)] = this->cmd[i];
+          }
+          break;
+
+        case RADIOLIB_SX126X_CMD_WRITE_REGISTER:
+          for(size_t i = 3; i < this->cmdLen; i++) {
+            uint16_t addr = (((uint16_t)p[0] << 8) | p[1]) + (i - 3);
+            this->regs[addr % EMULATED_SX126X_REG_SPACE] = this->cmd[i];
+          }
+          break;
+
+        case RADIOLIB_SX126X_CMD_SET_DIO_IRQ_PARAMS:
+          this->irqMask = ((uint16_t)p[0] << 8) | p[1];
+          this->dio1Mask = ((uint16_t)p[2] << 8) | p[3];
+          this->updateIrqPin();
+          break;
+
+        case RADIOLIB_SX126X_CMD_CLEAR_IRQ_STATUS:
+          this->irqStatus &= ~(((uint16_t)p[0] << 8) | p[1]);
+          this->updateIrqPin();
+          break;
+
+        case RADIOLIB_SX126X_CMD_SET_TX: {
+          uint8_t len = this->packetParams[3];
+          this->txPacket.clear();
+          for(size_t i = 0; i < len; i++) {
+            this->txPacket.push_back(this->buffer[(uint8_t)(this->txBase + i)]);
+          }
+          this->txStart = this->now;
+          this->txDoneAt = this->now + this->timeOnAir(len);
+          this->mode = EMULATED_SX126X_MODE_TX;
+        } break;
+
+        case RADIOLIB_SX126X_CMD_SET_RX: {
+          // timeout is in steps of 15.625 us, 0 is single mode without timeout, 0xFFFFFF is continuous mode
+          uint32_t timeout = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+          this->rxContinuous = (timeout == 0xFFFFFF);
+          this->rxTimeoutAt = EMULATED_RADIO_NO_EVENT;
+          if((timeout != 0) && !this->rxContinuous) {
+            this->rxTimeoutAt = this->now + (timeout * 125UL) / 8;
+          }
+          this->mode = EMULATED_SX126X_MODE_RX;
+        } break;
+      }
+    }
+
+    // histogram with 4 dB bins starting at -11 dBm, most samples land in the bin of the strongest signal
+    void finishScan() {
+      uint32_t freq = this->getFrequency();
+      int16_t power = EMULATED_SX126X_NOISE_FLOOR;
+      for(const Signal& sig : this->signals) {
+        if((freq + sig.bw/2 >= sig.freq) && (freq <= sig.freq + sig.bw/2) && (sig.power > power)) {
+          power = sig.power;
+        }
+      }
+      int peak = (-11 - power) / 4;
+      peak = (peak < 0) ? 0 : ((peak >= RADIOLIB_SX126X_SPECTRAL_SCAN_RES_SIZE) ? RADIOLIB_SX126X_SPECTRAL_SCAN_RES_SIZE - 1 : peak);
+
+      uint16_t hist[RADIOLIB_SX126X_SPECTRAL_SCAN_RES_SIZE] = { 0 };
+      uint16_t side = this->scanSamples / 5;
+      hist[peak] = this->scanSamples - 2*side;
+      hist[(peak > 0) ? peak - 1 : peak] += side;
+      hist[(peak < RADIOLIB_SX126X_SPECTRAL_SCAN_RES_SIZE - 1) ? peak + 1 : peak] += side;
+      for(int i = 0; i < RADIOLIB_SX126X_SPECTRAL_SCAN_RES_SIZE; i++) {
+        this->regs[RADIOLIB_SX126X_REG_SPECTRAL_SCAN_RESULT + 2*i] = hist[i] >> 8;
+        this->regs[RADIOLIB_SX126X_REG_SPECTRAL_SCAN_RESULT + 2*i + 1] = hist[i] & 0xFF;
+      }
+      this->regs[RADIOLIB_SX126X_REG_SPECTRAL_SCAN_STATUS] = RADIOLIB_SX126X_SPECTRAL_SCAN_COMPLETED;
+      this->scans++;
+    }
+
+    // number of argument bytes actually sent, capped to the size of the destination
+    size_t argLen(size_t max) const {
+      size_t len = this->cmdLen - 1;
+      return((len < max) ? len : max);
+    }
+
+    void setIrq(uint16_t flags) {
+      // only interrupts enabled in the IRQ mask are latched
+      this->irqStatus |= (flags & this->irqMask);
+      this->updateIrqPin();
+    }
+
+    void updateIrqPin() {
+      this->irq->value = (this->irqStatus & this->dio1Mask) ? 1 : 0;
+    }
+};
+
+#endif
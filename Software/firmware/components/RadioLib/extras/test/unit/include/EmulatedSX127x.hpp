@@ -0,0 +1,311 @@
+#ifndef EMULATED_SX127X_HPP
+#define EMULATED_SX127X_HPP
+
+#include <string.h>
+#include <vector>
+
+#include <RadioLib.h>
+
+#include "HardwareEmulation.hpp"
+
+// number of emulated registers
+#define EMULATED_SX127X_NUM_REGS  (0x80)
+
+// duration of one CAD in symbols, rounded up
+#define EMULATED_SX127X_CAD_SYMBOLS (2)
+
+// emulated SX127x register interface (SX1276/77/78/79 LoRa register map)
+// writing RegOpMode starts transmission, reception or CAD, which complete after the real time-on-air
+// DIO0 (IRQ pin) and DIO1 (GPIO pin) follow RegDioMapping1 and the LoRa IRQ flags
+class EmulatedSX127x : public EmulatedRadio {
+  public:
+    explicit EmulatedSX127x(uint8_t version = RADIOLIB_SX1278_CHIP_VERSION) : version(version) {
+      this->reset();
+    }
+
+    uint8_t HandleSPI(uint8_t b) override {
+      // first byte is the address, MSB set for write access
+      if(this->first) {
+        this->first = false;
+        this->addr = b & 0x7F;
+        this->write = b & 0x80;
+        return(0x00);
+      }
+
+      uint8_t out = 0x00;
+      if(this->write) {
+        this->writeReg(this->addr, b);
+      } else {
+        out = this->readReg(this->addr);
+      }
+
+      // burst access increments the address, except for the FIFO
+      if(this->addr != RADIOLIB_SX127X_REG_FIFO) {
+        this->addr = (this->addr + 1) % EMULATED_SX127X_NUM_REGS;
+      }
+      return(out);
+    }
+
+    void HandleGPIO() override {
+      if(this->rst->event && (this->rst->value == 0)) {
+        this->reset();
+      }
+
+      if(this->cs->event && (this->cs->value == 0)) {
+        this->first = true;
+      }
+    }
+
+    void HandleTime(unsigned long us) override {
+      EmulatedRadio::HandleTime(us);
+
+      if(this->packetAt <= us) {
+        this->packetStart = this->packetAt;
+        this->packetEnd = this->packetAt + this->timeOnAir(this->packet.size());
+        this->packetAt = EMULATED_RADIO_NO_EVENT;
+        uint8_t mode = this->regs[RADIOLIB_SX127X_REG_OP_MODE] & 0x07;
+        if((mode == RADIOLIB_SX127X_RXCONTINUOUS) || (mode == RADIOLIB_SX127X_RXSINGLE)) {
+          this->rxTimeoutAt = EMULATED_RADIO_NO_EVENT;
+          this->rxDoneAt = this->packetEnd;
+        } else {
+          this->missed++;
+        }
+      }
+
+      if(this->txDoneAt <= us) {
+        this->txDoneAt = EMULATED_RADIO_NO_EVENT;
+        this->setMode(RADIOLIB_SX127X_STANDBY);
+        this->setIrq(RADIOLIB_SX127X_CLEAR_IRQ_FLAG_TX_DONE);
+      }
+
+      if(this->rxDoneAt <= us) {
+        this->rxDoneAt = EMULATED_RADIO_NO_EVENT;
+        uint8_t base = this->regs[RADIOLIB_SX127X_REG_FIFO_RX_BASE_ADDR];
+        for(size_t i = 0; i < this->packet.size(); i++) {
+          this->fifo[(uint8_t)(base + i)] = this->packet[i];
+        }
+        this->regs[RADIOLIB_SX127X_REG_FIFO_RX_CURRENT_ADDR] = base;
+        this->regs[RADIOLIB_SX127X_REG_RX_NB_BYTES] = this->packet.size();
+        this->regs[RADIOLIB_SX127X_REG_PKT_SNR_VALUE] = (uint8_t)(4*this->snr);
+        this->regs[RADIOLIB_SX127X_REG_PKT_RSSI_VALUE] = (uint8_t)(this->rssi + 157);
+
+        // CRC presence is reported from the header
+        this->regs[RADIOLIB_SX127X_REG_HOP_CHANNEL] = (this->regs[RADIOLIB_SX127X_REG_MODEM_CONFIG_2] & 0x04) ? 0x40 : 0x00;
+        if((this->regs[RADIOLIB_SX127X_REG_OP_MODE] & 0x07) == RADIOLIB_SX127X_RXSINGLE) {
+          this->setMode(RADIOLIB_SX127X_STANDBY);
+        }
+        this->setIrq(RADIOLIB_SX127X_CLEAR_IRQ_FLAG_VALID_HEADER | RADIOLIB_SX127X_CLEAR_IRQ_FLAG_RX_DONE);
+      }
+
+      if(this->rxTimeoutAt <= us) {
+        this->rxTimeoutAt = EMULATED_RADIO_NO_EVENT;
+        this->setMode(RADIOLIB_SX127X_STANDBY);
+        this->setIrq(RADIOLIB_SX127X_CLEAR_IRQ_FLAG_RX_TIMEOUT);
+      }
+
+      if(this->cadDoneAt <= us) {
+        this->cadDoneAt = EMULATED_RADIO_NO_EVENT;
+        this->setMode(RADIOLIB_SX127X_STANDBY);
+
+        // activity is detected when a packet was on air during the CAD
+        uint8_t flags = RADIOLIB_SX127X_CLEAR_IRQ_FLAG_CAD_DONE;
+        if((this->packetStart < us) && (this->packetEnd > this->cadStart)) {
+          flags |= RADIOLIB_SX127X_CLEAR_IRQ_FLAG_CAD_DETECTED;
+        }
+        this->setIrq(flags);
+      }
+    }
+
+    unsigned long NextEvent() override {
+      unsigned long next = this->packetAt;
+      next = (this->txDoneAt < next) ? this->txDoneAt : next;
+      next = (this->rxDoneAt < next) ? this->rxDoneAt : next;
+      next = (this->rxTimeoutAt < next) ? this->rxTimeoutAt : next;
+      next = (this->cadDoneAt < next) ? this->cadDoneAt : next;
+      return(next);
+    }
+
+    // schedule a packet to arrive at the given time, it is received only if the radio is in Rx by then
+    void schedulePacket(const uint8_t* data, size_t len, unsigned long at, int8_t rssi = -60, int8_t snr = 10) {
+      this->packet.assign(data, data + len);
+      this->packetAt = at;
+      this->packetStart = 0;
+      this->packetEnd = 0;
+      this->rssi = rssi;
+      this->snr = snr;
+    }
+
+    // time-on-air of a LoRa packet with the current modem configuration
+    unsigned long timeOnAir(size_t len) const {
+      if(!this->bandwidth()) {
+        return(0);
+      }
+
+      LoRaAirTimeConfig_t cfg = {
+        this->spreadingFactor(),
+        this->bandwidth(),
+        (uint8_t)(((this->regs[RADIOLIB_SX127X_REG_MODEM_CONFIG_1] >> 1) & 0x07) + 4),
+        ((uint32_t)this->regs[RADIOLIB_SX127X_REG_PREAMBLE_MSB] << 8) | this->regs[RADIOLIB_SX127X_REG_PREAMBLE_LSB],
+        (bool)(this->regs[RADIOLIB_SX127X_REG_MODEM_CONFIG_1] & 0x01),
+        (bool)(this->regs[RADIOLIB_SX127X_REG_MODEM_CONFIG_2] & 0x04),
+        (this->regs[RADIOLIB_SX1278_REG_MODEM_CONFIG_3] & 0x08) ? (uint8_t)RADIOLIB_AIRTIME_LDRO_ON : (uint8_t)RADIOLIB_AIRTIME_LDRO_OFF,
+        true,
+      };
+      return(RadioLibAirTime::timeOnAirUs(cfg, len));
+    }
+
+    // last transmitted packet and the time its transmission started
+    std::vector<uint8_t> txPacket;
+    unsigned long txStart = 0;
+
+    // number of scheduled packets that arrived while the radio was not receiving
+    unsigned int missed = 0;
+
+  protected:
+    uint8_t version;
+    uint8_t regs[EMULATED_SX127X_NUM_REGS] = { 0 };
+    uint8_t fifo[256] = { 0 };
+    uint8_t addr = 0;
+    bool write = false;
+    bool first = true;
+
+    unsigned long txDoneAt = EMULATED_RADIO_NO_EVENT;
+    unsigned long rxDoneAt = EMULATED_RADIO_NO_EVENT;
+    unsigned long rxTimeoutAt = EMULATED_RADIO_NO_EVENT;
+    unsigned long cadDoneAt = EMULATED_RADIO_NO_EVENT;
+    unsigned long cadStart = 0;
+
+    std::vector<uint8_t> packet;
+    unsigned long packetAt = EMULATED_RADIO_NO_EVENT;
+    unsigned long packetStart = 0;
+    unsigned long packetEnd = 0;
+    int8_t rssi = 0;
+    int8_t snr = 0;
+
+    uint8_t spreadingFactor() const {
+      return(this->regs[RADIOLIB_SX127X_REG_MODEM_CONFIG_2] >> 4);
+    }
+
+    // bandwidth in Hz, 0 for reserved values
+    uint32_t bandwidth() const {
+      static const uint32_t bandwidths[] = { 7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000 };
+      uint8_t bwIdx = this->regs[RADIOLIB_SX127X_REG_MODEM_CONFIG_1] >> 4;
+      return((bwIdx < sizeof(bandwidths)/sizeof(bandwidths[0])) ? bandwidths[bwIdx] : 0);
+    }
+
+    void reset() {
+      // reset values from the datasheet, only the ones that matter for LoRa timing
+      memset(this->regs, 0x00, sizeof(this->regs));
+      this->regs[RADIOLIB_SX127X_REG_OP_MODE] = 0x09;
+      this->regs[RADIOLIB_SX127X_REG_FIFO_TX_BASE_ADDR] = 0x80;
+      this->regs[RADIOLIB_SX127X_REG_MODEM_CONFIG_1] = 0x72;
+      this->regs[RADIOLIB_SX127X_REG_MODEM_CONFIG_2] = 0x70;
+      this->regs[RADIOLIB_SX127X_REG_SYMB_TIMEOUT_LSB] = 0x64;
+      this->regs[RADIOLIB_SX127X_REG_PREAMBLE_LSB] = 0x08;
+      this->regs[RADIOLIB_SX127X_REG_PAYLOAD_LENGTH] = 0x01;
+      this->regs[RADIOLIB_SX127X_REG_VERSION] = this->version;
+      this->txDoneAt = EMULATED_RADIO_NO_EVENT;
+      this->rxDoneAt = EMULATED_RADIO_NO_EVENT;
+      this->rxTimeoutAt = EMULATED_RADIO_NO_EVENT;
+      this->cadDoneAt = EMULATED_RADIO_NO_EVENT;
+      this->updateDio();
+    }
+
+    uint8_t readReg(uint8_t reg) {
+      if(reg == RADIOLIB_SX127X_REG_FIFO) {
+        return(this->fifo[this->regs[RADIOLIB_SX127X_REG_FIFO_ADDR_PTR]++]);
+      }
+      return(this->regs[reg]);
+    }
+
+    void writeReg(uint8_t reg, uint8_t value) {
+      switch(reg) {
+        case RADIOLIB_SX127X_REG_FIFO:
+          this->fifo[this->regs[RADIOLIB_SX127X_REG_FIFO_ADDR_PTR]++] = value;
+          break;
+
+        case RADIOLIB_SX127X_REG_OP_MODE:
+          this->regs[reg] = value;
+          this->startMode(value & 0x07);
+          break;
+
+        case RADIOLIB_SX127X_REG_IRQ_FLAGS:
+          // flags are cleared by writing 1
+          this->regs[reg] &= ~value;
+          this->updateDio();
+          break;
+
+        case RADIOLIB_SX127X_REG_DIO_MAPPING_1:
+          this->regs[reg] = value;
+          this->updateDio();
+          break;
+
+        case RADIOLIB_SX127X_REG_VERSION:
+          break;
+
+        default:
+          this->regs[reg] = value;
+      }
+    }
+
+    void setMode(uint8_t mode) {
+      this->regs[RADIOLIB_SX127X_REG_OP_MODE] = (this->regs[RADIOLIB_SX127X_REG_OP_MODE] & 0xF8) | mode;
+    }
+
+    // kick off whatever the new mode does, or cancel the pending operation
+    void startMode(uint8_t mode) {
+      this->txDoneAt = EMULATED_RADIO_NO_EVENT;
+      this->rxDoneAt = EMULATED_RADIO_NO_EVENT;
+      this->rxTimeoutAt = EMULATED_RADIO_NO_EVENT;
+      this->cadDoneAt = EMULATED_RADIO_NO_EVENT;
+
+      unsigned long symbolUs = 0;
+      if(this->bandwidth()) {
+        symbolUs = RadioLibAirTime::symbolDurationNs(this->spreadingFactor(), this->bandwidth()) / 1000;
+      }
+
+      switch(mode) {
+        case RADIOLIB_SX127X_TX: {
+          uint8_t len = this->regs[RADIOLIB_SX127X_REG_PAYLOAD_LENGTH];
+          uint8_t base = this->regs[RADIOLIB_SX127X_REG_FIFO_TX_BASE_ADDR];
+          this->txPacket.clear();
+          for(size_t i = 0; i < len; i++) {
+            this->txPacket.push_back(this->fifo[(uint8_t)(base + i)]);
+          }
+          this->txStart = this->now;
+          this->txDoneAt = this->now + this->timeOnAir(len);
+        } break;
+
+        case RADIOLIB_SX127X_RXSINGLE: {
+          uint32_t symbols = ((uint32_t)(this->regs[RADIOLIB_SX127X_REG_MODEM_CONFIG_2] & 0x03) << 8) | this->regs[RADIOLIB_SX127X_REG_SYMB_TIMEOUT_LSB];
+          this->rxTimeoutAt = this->now + symbols*symbolUs;
+        } break;
+
+        case RADIOLIB_SX127X_CAD:
+          this->cadStart = this->now;
+          this->cadDoneAt = this->now + EMULATED_SX127X_CAD_SYMBOLS*symbolUs;
+          break;
+      }
+    }
+
+    void setIrq(uint8_t flags) {
+      // masked interrupts are not latched
+      this->regs[RADIOLIB_SX127X_REG_IRQ_FLAGS] |= (flags & ~this->regs[RADIOLIB_SX127X_REG_IRQ_FLAGS_MASK]);
+      this->updateDio();
+    }
+
+    void updateDio() {
+      static const uint8_t dio0[] = { RADIOLIB_SX127X_CLEAR_IRQ_FLAG_RX_DONE, RADIOLIB_SX127X_CLEAR_IRQ_FLAG_TX_DONE, RADIOLIB_SX127X_CLEAR_IRQ_FLAG_CAD_DONE, 0 };
+      static const uint8_t dio1[] = { RADIOLIB_SX127X_CLEAR_IRQ_FLAG_RX_TIMEOUT, RADIOLIB_SX127X_CLEAR_IRQ_FLAG_FHSS_CHANGE_CHANNEL, RADIOLIB_SX127X_CLEAR_IRQ_FLAG_CAD_DETECTED, 0 };
+      uint8_t flags = this->regs[RADIOLIB_SX127X_REG_IRQ_FLAGS];
+      uint8_t map = this->regs[RADIOLIB_SX127X_REG_DIO_MAPPING_1];
+      if(this->irq) {
+        this->irq->value = (flags & dio0[map >> 6]) ? 1 : 0;
+      }
+      if(this->gpio) {
+        this->gpio->value = (flags & dio1[(map >> 4) & 0x03]) ? 1 : 0;
+      }
+    }
+};
+
+#endif
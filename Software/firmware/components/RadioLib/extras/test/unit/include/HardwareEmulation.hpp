@@ -2,6 +2,7 @@
 #define HARDWARE_EMULATION_HPP
 
 #include <stdint.h>
+#include <limits.h>
 
 // value that is returned by the emualted radio class when performing SPI transfer to it
 #define EMULATED_RADIO_SPI_RETURN (0xFF)
@@ -12,6 +13,9 @@
 #define EMULATED_RADIO_RST_PIN    (3)
 #define EMULATED_RADIO_GPIO_PIN   (4)
 
+// returned by EmulatedRadio::NextEvent when the radio has nothing scheduled
+#define EMULATED_RADIO_NO_EVENT   (ULONG_MAX)
+
 enum PinFunction_t {
   PIN_UNASSIGNED = 0,
   PIN_CS,
@@ -58,14 +62,29 @@ class EmulatedRadio {
     virtual void HandleGPIO() {
       // handle discrete GPIO signals here (e.g. reset state machine on NSS falling edge)
     }
+
+    virtual void HandleTime(unsigned long us) {
+      // called by the HAL whenever the clock moves, fire all events scheduled up to this time here
+      this->now = us;
+    }
+
+    virtual unsigned long NextEvent() {
+      // time of the earliest scheduled event (e.g. end of transmission), so that the HAL can stop the clock there
+      return(EMULATED_RADIO_NO_EVENT);
+    }
+
+    virtual ~EmulatedRadio() = default;
   
   protected:
     // pointers to emulated GPIO pins
     // this is done via pointers so that the same GPIO entity is shared, like with a real hardware
-    EmulatedPin_t* cs;
-    EmulatedPin_t* irq;
-    EmulatedPin_t* rst;
-    EmulatedPin_t* gpio;
+    EmulatedPin_t* cs = nullptr;
+    EmulatedPin_t* irq = nullptr;
+    EmulatedPin_t* rst = nullptr;
+    EmulatedPin_t* gpio = nullptr;
+
+    // current time in microseconds, as last seen by HandleTime
+    unsigned long now = 0;
 };
 
 #endif
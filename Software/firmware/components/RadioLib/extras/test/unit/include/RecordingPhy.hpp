@@ -0,0 +1,53 @@
+#ifndef RECORDING_PHY_HPP
+#define RECORDING_PHY_HPP
+
+#include <vector>
+
+#include <RadioLib.h>
+
+// physical layer without a radio, it only records what the protocol clients ask it to do
+class RecordingPhy : public PhysicalLayer {
+  public:
+    // last packet passed to transmit
+    std::vector<uint8_t> sent;
+
+    // direct mode frequency changes, with the time at which they were made
+    struct DirectTone {
+      RadioLibTime_t time;
+      uint32_t frf;
+    };
+    std::vector<DirectTone> tones;
+
+    // module providing the clock for direct mode timing, may be left null
+    Module* mod = nullptr;
+
+    // time one frequency change takes, when running on the virtual clock
+    unsigned long directLatencyUs = 0;
+
+    RecordingPhy() {
+      this->freqStep = 1.0f;
+    }
+
+    int16_t transmit(const uint8_t* data, size_t len, uint8_t addr = 0) override {
+      (void)addr;
+      this->sent.assign(data, data + len);
+      return(RADIOLIB_ERR_NONE);
+    }
+
+    int16_t transmitDirect(uint32_t frf = 0) override {
+      if(this->mod) {
+        this->tones.push_back({ this->mod->hal->micros(), frf });
+        if(this->directLatencyUs) {
+          this->mod->hal->delayMicroseconds(this->directLatencyUs);
+        }
+      }
+      return(RADIOLIB_ERR_NONE);
+    }
+
+    int16_t setEncoding(uint8_t encoding) override { (void)encoding; return(RADIOLIB_ERR_NONE); }
+    int16_t setDataShaping(uint8_t sh) override { (void)sh; return(RADIOLIB_ERR_NONE); }
+    int16_t setFrequencyDeviation(float freqDev) override { (void)freqDev; return(RADIOLIB_ERR_NONE); }
+    Module* getMod() override { return(this->mod); }
+};
+
+#endif
@@ -30,15 +30,23 @@
 
 #define TEST_HAL_SPI_LOG_LENGTH (512)
 
+// time that passes in each call to yield() when running on the virtual clock
+// polling loops (waiting for IRQ, BUSY or a timeout) call yield, so this is their time step
+#define TEST_HAL_YIELD_US       (10)
+
 class TestHal : public RadioLibHal {
   public:
-    TestHal() : RadioLibHal(TEST_HAL_INPUT, TEST_HAL_OUTPUT, TEST_HAL_LOW, TEST_HAL_HIGH, TEST_HAL_RISING, TEST_HAL_FALLING) { }
+    // with virtualTime set, delays advance a simulated clock instantly instead of sleeping
+    // and millis/micros return the simulated time, so tests of timeouts run much faster than real time
+    explicit TestHal(bool virtualTime = false) : RadioLibHal(TEST_HAL_INPUT, TEST_HAL_OUTPUT, TEST_HAL_LOW, TEST_HAL_HIGH, TEST_HAL_RISING, TEST_HAL_FALLING),
+      virtualTime(virtualTime) { }
 
     void init() override {
       HAL_LOG("TestHal::init()");
 
       // save program start timestamp
       start = std::chrono::high_resolution_clock::now();
+      this->timeUs = 0;
 
       // init emulated GPIO
       for(int i = 0; i < TEST_HAL_NUM_GPIO_PINS; i++) {
@@ -46,6 +54,7 @@ class TestHal : public RadioLibHal {
         this->gpio[i].value = 0;
         this->gpio[i].event = false;
         this->gpio[i].func = PIN_UNASSIGNED;
+        this->interrupts[i].cb = nullptr;
       }
 
       // wipe history log
@@ -99,6 +108,9 @@ class TestHal : public RadioLibHal {
       // check it is input
       BOOST_ASSERT_MSG(this->gpio[pin].mode == TEST_HAL_INPUT, "GPIO is not input");
 
+      // let the emulated radio catch up, in real time mode nothing else would drive its events
+      this->updateRadio();
+
       // read the value
       uint32_t value = this->gpio[pin].value;
       HAL_LOG("TestHal::digitalRead(pin=" << pin << ")=" << value << " [" << ((value == TEST_HAL_LOW) ? "LOW" : "HIGH") << "]");
@@ -108,21 +120,34 @@ class TestHal : public RadioLibHal {
     void attachInterrupt(uint32_t interruptNum, void (*interruptCb)(void), uint32_t mode) override {
       HAL_LOG("TestHal::attachInterrupt(interruptNum=" << interruptNum << ", interruptCb=" << interruptCb << ", mode=" << mode << ")");
 
-      // TODO implement
-      (void)interruptNum;
-      (void)interruptCb;
-      (void)mode;
+      // check the range
+      BOOST_ASSERT_MSG(interruptNum < TEST_HAL_NUM_GPIO_PINS, "Pin number out of range");
+
+      // check known modes
+      BOOST_ASSERT_MSG(((mode == TEST_HAL_RISING) || (mode == TEST_HAL_FALLING)), "Invalid interrupt mode");
+
+      // the callback is invoked from updateRadio, when the emulated radio changes the pin
+      this->interrupts[interruptNum].cb = interruptCb;
+      this->interrupts[interruptNum].mode = mode;
+      this->interrupts[interruptNum].last = this->gpio[interruptNum].value;
     }
 
     void detachInterrupt(uint32_t interruptNum) override {
       HAL_LOG("TestHal::detachInterrupt(interruptNum=" << interruptNum << ")");
 
-      // TODO implement
-      (void)interruptNum;
+      // check the range
+      BOOST_ASSERT_MSG(interruptNum < TEST_HAL_NUM_GPIO_PINS, "Pin number out of range");
+
+      this->interrupts[interruptNum].cb = nullptr;
     }
 
     void delay(unsigned long ms) override {
       HAL_LOG("TestHal::delay(ms=" << ms << ")");
+      if(this->virtualTime) {
+        this->advance(ms * 1000UL);
+        return;
+      }
+
       const auto start = std::chrono::high_resolution_clock::now();
 
       // sleep_for is sufficient for ms-precision sleep
@@ -136,6 +161,11 @@ class TestHal : public RadioLibHal {
 
     void delayMicroseconds(unsigned long us) override {
       HAL_LOG("TestHal::delayMicroseconds(us=" << us << ")");
+      if(this->virtualTime) {
+        this->advance(us);
+        return;
+      }
+
       const auto start = std::chrono::high_resolution_clock::now();
 
       // busy wait is needed for microseconds precision
@@ -150,10 +180,17 @@ class TestHal : public RadioLibHal {
 
     void yield() override {
       HAL_LOG("TestHal::yield()");
+      if(this->virtualTime) {
+        this->advance(TEST_HAL_YIELD_US);
+      }
     }
 
     unsigned long millis() override {
       HAL_LOG("TestHal::millis()");
+      if(this->virtualTime) {
+        return(this->timeUs / 1000UL);
+      }
+
       std::chrono::time_point now = std::chrono::high_resolution_clock::now();
       auto res = std::chrono::duration_cast<std::chrono::milliseconds>(now - this->start);
       HAL_LOG("TestHal::millis()=" << res.count());
@@ -162,6 +199,10 @@ class TestHal : public RadioLibHal {
 
     unsigned long micros() override {
       HAL_LOG("TestHal::micros()");
+      if(this->virtualTime) {
+        return(this->timeUs);
+      }
+
       std::chrono::time_point now = std::chrono::high_resolution_clock::now();
       auto res = std::chrono::duration_cast<std::chrono::microseconds>(now - this->start);
       HAL_LOG("TestHal::micros()=" << res.count());
@@ -188,10 +229,13 @@ class TestHal : public RadioLibHal {
 
     void spiTransfer(uint8_t* out, size_t len, uint8_t* in) {
       HAL_LOG("TestHal::spiTransfer(len=" << len << ")");
+      this->updateRadio();
       
       for(size_t i = 0; i < len; i++) {
-        // append to log
-        (*this->spiLogPtr++) = out[i];
+        // append to log, long polling loops would otherwise overflow it
+        if(this->spiLogPtr < &this->spiLog[TEST_HAL_SPI_LOG_LENGTH]) {
+          (*this->spiLogPtr++) = out[i];
+        }
 
         // process the SPI byte
         in[i] = this->radio->HandleSPI(out[i]);
@@ -199,7 +243,7 @@ class TestHal : public RadioLibHal {
         // artificial delay to emulate SPI running at a finite speed
         // this is added because timeouts are based on time duration,
         // so we need to make sure some time actually elapses
-        this->delayMicroseconds(100);
+        this->delayMicroseconds(this->spiByteUs);
 
         // output debug
         HAL_LOG(fmt::format("out={:#02x}, in={:#02x}", out[i], in[i]));
@@ -251,19 +295,84 @@ class TestHal : public RadioLibHal {
                            &this->gpio[EMULATED_RADIO_GPIO_PIN]);
     }
 
+    // whether this HAL runs on the simulated clock
+    bool isVirtualTime() const {
+      return(this->virtualTime);
+    }
+
+    // time taken by one SPI byte, the default is slow enough for SPI timeouts to trigger
+    // tests measuring throughput can set a realistic value instead (1 us is 8 MHz SPI)
+    unsigned long spiByteUs = 100;
+
   private:
     // array of emulated GPIO pins
     EmulatedPin_t gpio[TEST_HAL_NUM_GPIO_PINS];
 
+    // attached interrupts, the last seen pin level is kept to detect edges
+    struct {
+      void (*cb)(void);
+      uint32_t mode;
+      uint32_t last;
+    } interrupts[TEST_HAL_NUM_GPIO_PINS] = {};
+
+    // simulated clock in microseconds since init
+    bool virtualTime;
+    unsigned long timeUs = 0;
+
     // start time point
     std::chrono::time_point<std::chrono::high_resolution_clock> start;
 
     // emulated radio hardware
-    EmulatedRadio* radio;
+    EmulatedRadio* radio = nullptr;
 
     // SPI history log
     uint8_t spiLog[TEST_HAL_SPI_LOG_LENGTH];
     uint8_t* spiLogPtr;
+
+    // advance the simulated clock, stopping at every radio event on the way
+    // so that interrupts are delivered in order and see the time at which the event happened
+    void advance(unsigned long us) {
+      const unsigned long target = this->timeUs + us;
+      while(this->radio) {
+        unsigned long next = this->radio->NextEvent();
+        if(next > target) {
+          break;
+        }
+        if(next > this->timeUs) {
+          this->timeUs = next;
+        }
+        this->radio->HandleTime(this->timeUs);
+        this->checkInterrupts();
+      }
+      this->timeUs = target;
+      this->updateRadio();
+    }
+
+    // pass the current time to the emulated radio and deliver any resulting edges
+    void updateRadio() {
+      if(!this->radio) {
+        return;
+      }
+
+      // in virtual time mode, the radio events are already processed by advance
+      this->radio->HandleTime(this->virtualTime ? this->timeUs : this->micros());
+      this->checkInterrupts();
+    }
+
+    void checkInterrupts() {
+      for(int i = 0; i < TEST_HAL_NUM_GPIO_PINS; i++) {
+        uint32_t value = this->gpio[i].value;
+        if(!this->interrupts[i].cb || (value == this->interrupts[i].last)) {
+          continue;
+        }
+
+        this->interrupts[i].last = value;
+        if((this->interrupts[i].mode == TEST_HAL_RISING) == (value == TEST_HAL_HIGH)) {
+          HAL_LOG("TestHal::checkInterrupts(pin=" << i << ")");
+          this->interrupts[i].cb();
+        }
+      }
+    }
 };
 
 #endif
@@ -0,0 +1,177 @@
+// boost test header
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <new>
+#include <stdlib.h>
+
+// PhysicalLayer mock
+#include "RecordingPhy.hpp"
+
+// every heap allocation made by the test executable goes through here
+static size_t allocCount = 0;
+
+void* operator new(size_t size) {
+  allocCount++;
+  void* ptr = malloc(size ? size : 1);
+  if(!ptr) {
+    throw std::bad_alloc();
+  }
+  return(ptr);
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t size) noexcept {
+  (void)size;
+  free(ptr);
+}
+
+// reference output of the previous two-buffer implementation, 8 byte preamble
+static const uint8_t frameUI[] = {
+  0x7E, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x2B, 0x53, 0x6C,
+  0xEC, 0xA9, 0x56, 0xAE, 0x84, 0xAE, 0xEB, 0x2B, 0x44, 0xBB, 0xD1, 0xD5,
+  0x5F, 0x49, 0x91, 0x71, 0x71, 0xF1, 0x72, 0xAD, 0xE1, 0xF1, 0x21, 0x71,
+  0x6E, 0x52, 0xC3, 0x5F, 0x01,
+};
+static const uint8_t frameRepeaters[] = {
+  0x7E, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x14, 0xD3, 0x56,
+  0xA9, 0x56, 0xA9, 0x51, 0x7B, 0x51, 0x14, 0xD4, 0xBB, 0x44, 0xD1, 0x0C,
+  0xDB, 0x4B, 0x34, 0xD1, 0x56, 0xD1, 0x0C, 0xDB, 0x4B, 0x34, 0x91, 0x56,
+  0x6E, 0x2A, 0xA0, 0x7E, 0x07, 0xEF, 0xC7, 0xE5, 0x57, 0xEA, 0x81, 0xD2,
+  0xDD, 0x01,
+};
+static const uint8_t framePosition[] = {
+  0x7E, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x2B, 0x53, 0x6C,
+  0xEC, 0xA9, 0x56, 0xAE, 0x84, 0xAE, 0xEB, 0x2B, 0x44, 0xBB, 0xD1, 0xD5,
+  0x5F, 0xBE, 0xB1, 0x21, 0x2E, 0xD1, 0x79, 0x71, 0x0E, 0x84, 0xF9, 0x51,
+  0x2E, 0x8E, 0xEE, 0xCE, 0x86, 0xDE, 0x8E, 0xCB, 0x7E, 0x92, 0x7B, 0x63,
+  0xAB, 0x53, 0x9B, 0xB7, 0x9B, 0x94, 0x91, 0x64, 0xC0, 0x55,
+};
+
+struct AX25Fixture {
+  RecordingPhy phy;
+  AX25Client ax25 { &phy };
+
+  AX25Fixture() {
+    BOOST_TEST_MESSAGE("--- AX.25 fixture setup ---");
+    ax25.begin("N0CALL", 1, 8);
+
+    // recording the frame must not be counted as an allocation
+    phy.sent.reserve(RADIOLIB_AX25_FRAME_BUFF_LEN);
+  }
+
+  ~AX25Fixture() {
+    BOOST_TEST_MESSAGE("--- AX.25 fixture teardown ---");
+  }
+};
+
+BOOST_AUTO_TEST_SUITE(suite_AX25)
+
+  BOOST_FIXTURE_TEST_CASE(AX25_transmit, AX25Fixture)
+  {
+    BOOST_TEST_MESSAGE("--- Test AX.25 UI frame encoding ---");
+    size_t before = allocCount;
+    int16_t ret = ax25.transmit("Hello, world!", "APRS", 0);
+    BOOST_TEST(allocCount == before);
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+    BOOST_TEST(phy.sent == std::vector<uint8_t>(frameUI, frameUI + sizeof(frameUI)));
+  }
+
+  BOOST_FIXTURE_TEST_CASE(AX25_repeaters, AX25Fixture)
+  {
+    BOOST_TEST_MESSAGE("--- Test AX.25 frame with repeaters and bit stuffing ---");
+    const uint8_t info[] = { 0xFF, 0xFF, 0xFE, 0x7E, 0x00, 0x1F, 0xF8 };
+    char rep1[] = "WIDE1";
+    char rep2[] = "WIDE2";
+    char* reps[] = { rep1, rep2 };
+    const uint8_t ssids[] = { 1, 2 };
+
+    // neither the frame nor the transmission may allocate
+    size_t before = allocCount;
+    AX25Frame frame("CQ", 0, "N0CALL", 1, RADIOLIB_AX25_CONTROL_UNNUMBERED_FRAME);
+    frame.protocolID = RADIOLIB_AX25_PID_NO_LAYER_3;
+    BOOST_TEST(frame.setInfoRef(info, sizeof(info)) == RADIOLIB_ERR_NONE);
+    BOOST_TEST(frame.info == info);
+    BOOST_TEST(frame.setRepeaters(reps, ssids, 2) == RADIOLIB_ERR_NONE);
+    int16_t ret = ax25.sendFrame(&frame);
+    BOOST_TEST(allocCount == before);
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+    BOOST_TEST(phy.sent == std::vector<uint8_t>(frameRepeaters, frameRepeaters + sizeof(frameRepeaters)));
+
+    // copies own their info field
+    AX25Frame copy(frame);
+    BOOST_TEST(copy.info != frame.info);
+    BOOST_TEST(ax25.sendFrame(&copy) == RADIOLIB_ERR_NONE);
+    BOOST_TEST(phy.sent == std::vector<uint8_t>(frameRepeaters, frameRepeaters + sizeof(frameRepeaters)));
+
+    // setInfo copies, later changes to the caller buffer are not sent
+    uint8_t scratch[sizeof(info)];
+    memcpy(scratch, info, sizeof(info));
+    BOOST_TEST(frame.setInfo(scratch, sizeof(scratch)) == RADIOLIB_ERR_NONE);
+    BOOST_TEST(frame.info != scratch);
+    memset(scratch, 0, sizeof(scratch));
+    BOOST_TEST(ax25.sendFrame(&frame) == RADIOLIB_ERR_NONE);
+    BOOST_TEST(phy.sent == std::vector<uint8_t>(frameRepeaters, frameRepeaters + sizeof(frameRepeaters)));
+  }
+
+  BOOST_FIXTURE_TEST_CASE(AX25_frameBuffer, AX25Fixture)
+  {
+    BOOST_TEST_MESSAGE("--- Test AX.25 user frame buffer ---");
+    uint8_t arena[64];
+    ax25.setFrameBuffer(arena, sizeof(arena));
+    int16_t ret = ax25.transmit("Hello, world!", "APRS", 0);
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+    BOOST_TEST(memcmp(arena, frameUI, sizeof(frameUI)) == 0);
+
+    // too small buffer is reported, and the required length is returned
+    AX25Frame frame("APRS", 0, "N0CALL", 1, RADIOLIB_AX25_CONTROL_UNNUMBERED_FRAME);
+    frame.protocolID = RADIOLIB_AX25_PID_NO_LAYER_3;
+    frame.setInfo(reinterpret_cast<const uint8_t*>("Hello, world!"), 13);
+    size_t len = 0;
+    BOOST_TEST(ax25.encodeFrame(&frame, arena, 16, &len) == RADIOLIB_ERR_PACKET_TOO_LONG);
+    BOOST_TEST(len == sizeof(frameUI));
+    ax25.setFrameBuffer(NULL, 0);
+  }
+
+  BOOST_FIXTURE_TEST_CASE(AX25_aprsPosition, AX25Fixture)
+  {
+    BOOST_TEST_MESSAGE("--- Test APRS position report ---");
+    APRSClient aprs(&ax25);
+    aprs.begin('>');
+    char dest[] = "APRS";
+    size_t before = allocCount;
+    int16_t ret = aprs.sendPosition(dest, 0, "4911.67N", "01635.96E", "I'm here!");
+    BOOST_TEST(allocCount == before);
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+    BOOST_TEST(phy.sent == std::vector<uint8_t>(framePosition, framePosition + sizeof(framePosition)));
+  }
+
+  BOOST_FIXTURE_TEST_CASE(AX25_throughput, AX25Fixture)
+  {
+    BOOST_TEST_MESSAGE("--- Test AX.25 encoder throughput ---");
+    uint8_t info[200];
+    for(size_t i = 0; i < sizeof(info); i++) {
+      info[i] = i * 37;
+    }
+    AX25Frame frame("APRS", 0, "N0CALL", 1, RADIOLIB_AX25_CONTROL_UNNUMBERED_FRAME);
+    frame.protocolID = RADIOLIB_AX25_PID_NO_LAYER_3;
+    frame.setInfo(info, sizeof(info));
+
+    uint8_t arena[RADIOLIB_AX25_FRAME_BUFF_LEN];
+    const int numFrames = 2000;
+    size_t len = 0;
+    size_t before = allocCount;
+    const auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < numFrames; i++) {
+      BOOST_REQUIRE(ax25.encodeFrame(&frame, arena, sizeof(arena), &len) == RADIOLIB_ERR_NONE);
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    BOOST_TEST(allocCount == before);
+    BOOST_TEST_MESSAGE("Encoded " << numFrames << " frames of " << len << " bytes, "
+                       << (numFrames / elapsed) << " frames/s");
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,99 @@
+// boost test header
+#include <boost/test/unit_test.hpp>
+
+#include <RadioLib.h>
+
+// SF12, 125 kHz, CR 4/5, 8 symbol preamble, explicit header, CRC on, automatic LDRO
+static constexpr LoRaAirTimeConfig_t cfgSf12 = { 12, 125000, 5, 8, false, true, RADIOLIB_AIRTIME_LDRO_AUTO, false };
+
+// SF7, 125 kHz, CR 4/5, 8 symbol preamble, explicit header, CRC on, automatic LDRO
+static constexpr LoRaAirTimeConfig_t cfgSf7 = { 7, 125000, 5, 8, false, true, RADIOLIB_AIRTIME_LDRO_AUTO, false };
+
+// the model must be usable in constant expressions
+static_assert(RadioLibAirTime::symbolDurationNs(12, 125000) == 32768000UL, "SF12 symbol duration");
+static_assert(RadioLibAirTime::lowDataRate(cfgSf12), "SF12/125 kHz requires LDRO");
+static_assert(!RadioLibAirTime::lowDataRate(cfgSf7), "SF7/125 kHz does not require LDRO");
+static_assert(RadioLibAirTime::symbolsX4(cfgSf12, 20) == 161, "SF12 symbol count");
+static_assert(RadioLibAirTime::timeOnAirUs(cfgSf12, 20) == 1318912UL, "SF12 time-on-air");
+
+BOOST_AUTO_TEST_SUITE(suite_AirTime)
+
+  BOOST_AUTO_TEST_CASE(AirTime_timeOnAir)
+  {
+    BOOST_TEST_MESSAGE("--- Test RadioLibAirTime::timeOnAirUs ---");
+
+    // reference values from the Semtech LoRa calculator
+    BOOST_TEST(RadioLibAirTime::timeOnAirUs(cfgSf7, 10) == 41216UL);
+    BOOST_TEST(RadioLibAirTime::timeOnAirUs(cfgSf12, 20) == 1318912UL);
+    BOOST_TEST(RadioLibAirTime::payloadSymbols(cfgSf12, 20) == 28UL);
+
+    // implicit header saves 20 bits of payload, disabling CRC another 16
+    LoRaAirTimeConfig_t cfg = cfgSf12;
+    cfg.implicitHeader = true;
+    cfg.crcEnabled = false;
+    BOOST_TEST(RadioLibAirTime::timeOnAirUs(cfg, 20) < RadioLibAirTime::timeOnAirUs(cfgSf12, 20));
+
+    // zero-length payload never produces negative symbol count
+    BOOST_TEST(RadioLibAirTime::payloadSymbols(cfg, 0) == 8UL);
+  }
+
+  BOOST_AUTO_TEST_CASE(AirTime_dutyCycleInterval)
+  {
+    BOOST_TEST_MESSAGE("--- Test RadioLibAirTime::dutyCycleIntervalMs ---");
+
+    // 1 % duty cycle, 1 second airtime -> 100 s interval
+    BOOST_TEST(RadioLibAirTime::dutyCycleIntervalMs(36000, 1000) == 100001UL);
+    BOOST_TEST(RadioLibAirTime::dutyCycleIntervalMs(0, 1000) == 0UL);
+  }
+
+  BOOST_AUTO_TEST_CASE(AirTime_budget)
+  {
+    BOOST_TEST_MESSAGE("--- Test RadioLibAirTimeBudget ---");
+
+    // 1 % duty cycle
+    RadioLibAirTimeBudget budget(36000);
+    BOOST_TEST(budget.timeUntilAvailable(0, 1000000UL) == 0UL);
+
+    // use up the whole allowance in one go
+    BOOST_TEST(budget.commit(1000, 36000000UL) == RADIOLIB_ERR_NONE);
+    BOOST_TEST(budget.getUsedMs(2000) == 36000UL);
+
+    // next uplink must wait until the first one leaves the window
+    BOOST_TEST(budget.timeUntilAvailable(2000, 1000UL) == RADIOLIB_AIRTIME_HOUR_MS - 1000UL);
+    BOOST_TEST(budget.timeUntilAvailable(1000 + RADIOLIB_AIRTIME_HOUR_MS, 1000UL) == 0UL);
+
+    // dwell time limit
+    RadioLibAirTimeBudget dwell(0, 400);
+    BOOST_TEST(dwell.commit(0, 500000UL) == RADIOLIB_ERR_DWELL_TIME_EXCEEDED);
+    BOOST_TEST(dwell.timeUntilAvailable(0, 300000UL) == 0UL);
+  }
+
+  BOOST_AUTO_TEST_CASE(AirTime_plan)
+  {
+    BOOST_TEST_MESSAGE("--- Test RadioLibAirTimeBudget::plan/schedule ---");
+
+    // batching amortizes the preamble, so more readings per uplink always deliver more per hour
+    RadioLibAirTimeBudget budget(36000);
+    AirTimePlan_t plan;
+    BOOST_TEST(budget.plan(cfgSf12, 4, 10, 51, &plan) == RADIOLIB_ERR_NONE);
+    BOOST_TEST(plan.readingsPerUplink == 4);
+    BOOST_TEST(plan.readingsPerHour > 0UL);
+
+    // SF12 cannot fit into a 400 ms dwell time at all
+    RadioLibAirTimeBudget us915(0, 400);
+    BOOST_TEST(us915.plan(cfgSf12, 4, 10, 51, &plan) == RADIOLIB_ERR_DWELL_TIME_EXCEEDED);
+
+    // schedule five readings, at most two fit one uplink
+    const size_t lens[] = { 10, 10, 10, 10, 10 };
+    RadioLibTime_t slots[5] = { 0 };
+    BOOST_TEST(budget.schedule(cfgSf12, 4, lens, 5, 25, 0, slots) == 5U);
+    BOOST_TEST(slots[0] == slots[1]);
+    BOOST_TEST(slots[2] == slots[3]);
+    BOOST_TEST(slots[2] > slots[1]);
+    BOOST_TEST(slots[4] > slots[3]);
+
+    // scheduling is a dry run
+    BOOST_TEST(budget.getUsedMs(0) == 0UL);
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
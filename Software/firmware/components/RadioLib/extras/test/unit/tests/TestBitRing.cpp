@@ -0,0 +1,180 @@
+// boost test header
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <thread>
+
+// the ring and the utilities under test
+#include "utils/BitRing.h"
+#include "utils/Utils.h"
+
+// reference bitwise implementation
+static uint32_t reflectNaive(uint32_t in, uint8_t bits) {
+  uint32_t res = 0;
+  for(uint8_t i = 0; i < bits; i++) {
+    res |= (((in & ((uint32_t)1 << i)) >> i) << (bits - i - 1));
+  }
+  return(res);
+}
+
+// push a byte MSB first, the same order in which it arrives on air
+static void pushByte(RadioLibBitRing& ring, uint8_t b) {
+  for(int i = 7; i >= 0; i--) {
+    ring.pushBit((b >> i) & 0x01);
+  }
+}
+
+// simple xorshift generator, used to produce the same stream on both sides
+static uint32_t xorshift(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return(state);
+}
+
+// the unit tests are built without optimization and with coverage, a real target is much faster than this
+#define RING_MIN_MBPS   (4.0)
+
+BOOST_AUTO_TEST_SUITE(suite_BitRing)
+
+  BOOST_AUTO_TEST_CASE(BitRing_order)
+  {
+    BOOST_TEST_MESSAGE("--- Test bit ring byte assembly and order ---");
+    RadioLibBitRing ring;
+    BOOST_TEST(ring.available() == 0U);
+    BOOST_TEST(ring.read() == 0);
+
+    // incomplete byte is not published
+    for(int i = 0; i < 7; i++) {
+      ring.pushBit(1);
+    }
+    BOOST_TEST(ring.available() == 0U);
+    ring.pushBit(0);
+    BOOST_TEST(ring.available() == 1U);
+    BOOST_TEST(ring.read() == 0xFE);
+
+    // alignment drops the partial byte
+    ring.pushBit(1);
+    ring.pushBit(1);
+    ring.alignBits();
+    pushByte(ring, 0x5A);
+    pushByte(ring, 0xC3);
+    BOOST_TEST(ring.available() == 2U);
+    BOOST_TEST(ring.read() == 0x5A);
+    BOOST_TEST(ring.read() == 0xC3);
+    BOOST_TEST(ring.available() == 0U);
+  }
+
+  BOOST_AUTO_TEST_CASE(BitRing_batchWrapAround)
+  {
+    BOOST_TEST_MESSAGE("--- Test bit ring batch read across the buffer end ---");
+    RadioLibBitRing ring;
+
+    // move the indices close to the end of the buffer
+    uint8_t buff[RADIOLIB_DIRECT_RX_BUFFER_LEN] = { 0 };
+    for(int i = 0; i < RADIOLIB_DIRECT_RX_BUFFER_LEN - 10; i++) {
+      pushByte(ring, 0);
+    }
+    BOOST_TEST(ring.read(buff, sizeof(buff)) == (size_t)(RADIOLIB_DIRECT_RX_BUFFER_LEN - 10));
+
+    for(int i = 0; i < 40; i++) {
+      pushByte(ring, i);
+    }
+    BOOST_TEST(ring.available() == 40U);
+
+    // partial read, then the rest
+    BOOST_TEST(ring.read(buff, 16) == 16U);
+    BOOST_TEST(ring.read(&buff[16], sizeof(buff) - 16) == 24U);
+    for(int i = 0; i < 40; i++) {
+      BOOST_TEST(buff[i] == i);
+    }
+    BOOST_TEST(ring.available() == 0U);
+  }
+
+  BOOST_AUTO_TEST_CASE(BitRing_overflow)
+  {
+    BOOST_TEST_MESSAGE("--- Test bit ring overflow and flush ---");
+    RadioLibBitRing ring;
+
+    // one slot is always kept free
+    for(int i = 0; i < RADIOLIB_DIRECT_RX_BUFFER_LEN + 4; i++) {
+      pushByte(ring, i);
+    }
+    BOOST_TEST(ring.available() == (size_t)(RADIOLIB_DIRECT_RX_BUFFER_LEN - 1));
+    BOOST_TEST(ring.getDropped() == 5U);
+
+    // the oldest data is kept
+    BOOST_TEST(ring.read() == 0);
+    BOOST_TEST(ring.read() == 1);
+
+    ring.flush();
+    BOOST_TEST(ring.available() == 0U);
+    pushByte(ring, 0xA5);
+    BOOST_TEST(ring.read() == 0xA5);
+  }
+
+  BOOST_AUTO_TEST_CASE(BitRing_threaded)
+  {
+    BOOST_TEST_MESSAGE("--- Test bit ring with concurrent producer and consumer ---");
+    RadioLibBitRing ring;
+    const size_t numBytes = 256*1024;
+
+    // producer only pushes when there is space, so nothing may be lost
+    std::thread producer([&ring, numBytes]() {
+      uint32_t state = 0x12345678;
+      for(size_t i = 0; i < numBytes; i++) {
+        uint8_t b = xorshift(state);
+        while(ring.available() >= (RADIOLIB_DIRECT_RX_BUFFER_LEN - 1)) {
+          std::this_thread::yield();
+        }
+        pushByte(ring, b);
+      }
+    });
+
+    uint32_t state = 0x12345678;
+    size_t received = 0;
+    size_t errors = 0;
+    uint8_t buff[64];
+    const auto start = std::chrono::steady_clock::now();
+    while(received < numBytes) {
+      size_t num = ring.read(buff, sizeof(buff));
+      if(num == 0) {
+        // let the producer run, it may share the core with this thread
+        std::this_thread::yield();
+        continue;
+      }
+      for(size_t i = 0; i < num; i++) {
+        if(buff[i] != (uint8_t)xorshift(state)) {
+          errors++;
+        }
+      }
+      received += num;
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    producer.join();
+
+    BOOST_TEST(errors == 0U);
+    BOOST_TEST(ring.getDropped() == 0U);
+    const double mbps = 8.0*numBytes / elapsed / 1e6;
+    BOOST_TEST_MESSAGE("Throughput: " << mbps << " Mbps");
+    BOOST_TEST(mbps > RING_MIN_MBPS);
+  }
+
+  BOOST_AUTO_TEST_CASE(BitRing_reflect)
+  {
+    BOOST_TEST_MESSAGE("--- Test table-based bit reflection ---");
+    uint32_t state = 0xCAFEBABE;
+    for(uint8_t bits = 1; bits <= 32; bits++) {
+      for(int i = 0; i < 100; i++) {
+        uint32_t in = xorshift(state);
+        if(bits < 32) {
+          in &= ((uint32_t)1 << bits) - 1;
+        }
+        BOOST_TEST(rlb_reflect(in, bits) == reflectNaive(in, bits));
+      }
+    }
+    BOOST_TEST(rlb_reflect(0x01, 8) == 0x80U);
+    BOOST_TEST(rlb_reflect(0x1, 1) == 0x1U);
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,130 @@
+// boost test header
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+// mock HAL and PhysicalLayer
+#include "TestHal.hpp"
+#include "RecordingPhy.hpp"
+
+// time one frequency change takes, e.g. a register write over SPI
+#define SSTV_TEST_LATENCY_US    (40)
+
+// testing fixture, direct mode tones are recorded on the virtual clock
+struct SSTVFixture {
+  TestHal hal { true };
+  Module mod { &hal, EMULATED_RADIO_NSS_PIN, EMULATED_RADIO_IRQ_PIN, EMULATED_RADIO_RST_PIN, EMULATED_RADIO_GPIO_PIN };
+  RecordingPhy phy;
+  SSTVClient sstv { &phy };
+
+  SSTVFixture() {
+    BOOST_TEST_MESSAGE("--- SSTV fixture setup ---");
+    hal.init();
+    phy.mod = &mod;
+    phy.directLatencyUs = SSTV_TEST_LATENCY_US;
+    phy.tones.reserve(4096);
+  }
+
+  ~SSTVFixture() {
+    BOOST_TEST_MESSAGE("--- SSTV fixture teardown ---");
+  }
+
+  // with 0 MHz base and 1 Hz step, the frequency word is the tone frequency in Hz
+  static uint8_t levelOf(uint32_t frf) {
+    for(int i = 0; i < 256; i++) {
+      if((uint32_t)(RADIOLIB_SSTV_TONE_BRIGHTNESS_MIN + ((float)i * 3.1372549f)) == frf) {
+        return(i);
+      }
+    }
+    BOOST_FAIL("frequency is not a brightness level");
+    return(0);
+  }
+};
+
+BOOST_AUTO_TEST_SUITE(suite_SSTV)
+
+  BOOST_FIXTURE_TEST_CASE(SSTV_timing, SSTVFixture)
+  {
+    BOOST_TEST_MESSAGE("--- Test SSTV tone timing on the virtual clock ---");
+    BOOST_TEST(sstv.begin(0, Martin1) == RADIOLIB_ERR_NONE);
+
+    std::vector<uint32_t> line(Martin1.width);
+    for(size_t i = 0; i < line.size(); i++) {
+      line[i] = i * 0x030507;
+    }
+    sstv.sendHeader();
+    sstv.sendLine(line.data());
+    sstv.sendLine(line.data());
+
+    // expected tone lengths - header, then two lines
+    std::vector<RadioLibTime_t> lens = { 300000, 10000, 300000, 30000 };
+    for(int i = 0; i < 9; i++) {
+      lens.push_back(30000);
+    }
+    for(int l = 0; l < 2; l++) {
+      lens.push_back(4862);
+      for(int c = 0; c < 3; c++) {
+        lens.push_back(572);
+        for(int i = 0; i < Martin1.width; i++) {
+          lens.push_back(Martin1.scanPixelLen);
+        }
+      }
+      lens.push_back(572);
+    }
+
+    // first entry is the direct mode start in sendHeader
+    BOOST_REQUIRE(phy.tones.size() == lens.size() + 1);
+
+    // every tone starts on schedule, within one polling step - the frequency change latency does not add up
+    RadioLibTime_t expected = phy.tones[1].time;
+    RadioLibTime_t maxErr = 0;
+    for(size_t i = 0; i < lens.size(); i++) {
+      RadioLibTime_t err = phy.tones[i + 1].time - expected;
+      maxErr = (err > maxErr) ? err : maxErr;
+      expected += lens[i];
+    }
+    BOOST_TEST(maxErr < (RadioLibTime_t)TEST_HAL_YIELD_US);
+    BOOST_TEST_MESSAGE("Maximum tone start error: " << maxErr << " us over " << lens.size() << " tones");
+  }
+
+  BOOST_FIXTURE_TEST_CASE(SSTV_ycbcr, SSTVFixture)
+  {
+    BOOST_TEST_MESSAGE("--- Test SSTV fixed-point YCbCr conversion ---");
+    BOOST_TEST(sstv.begin(0, Robot72) == RADIOLIB_ERR_NONE);
+
+    std::vector<uint32_t> line(Robot72.width);
+    for(size_t i = 0; i < line.size(); i++) {
+      line[i] = (i * 0x9E3779B1UL) & 0x00FFFFFF;
+    }
+    line[0] = 0x000000;
+    line[1] = 0xFFFFFF;
+    line[2] = 0xFF0000;
+    line[3] = 0x00FF00;
+    line[4] = 0x0000FF;
+    phy.directLatencyUs = 0;
+    sstv.sendLine(line.data());
+
+    // sync, porch, Y scan, separator, porch, Cr scan, separator, porch, Cb scan
+    BOOST_REQUIRE(phy.tones.size() == 6U + 3U*Robot72.width);
+    const size_t scanStart[3] = { 2, 4U + Robot72.width, 6U + 2U*Robot72.width };
+
+    // floating point reference from the previous implementation
+    int maxDiff = 0;
+    for(size_t j = 0; j < line.size(); j++) {
+      uint8_t r = (line[j] & 0x00FF0000) >> 16;
+      uint8_t g = (line[j] & 0x0000FF00) >> 8;
+      uint8_t b = (line[j] & 0x000000FF);
+      uint8_t ref[3];
+      ref[0] = 16.0 + (0.003906 * ((65.738 * r) + (129.057 * g) + (25.064 * b)));
+      ref[1] = 128.0 + (0.003906 * ((112.439 * r) + (-94.154 * g) + (-18.285 * b)));
+      ref[2] = 128.0 + (0.003906 * ((-37.945 * r) + (-74.494 * g) + (112.439 * b)));
+      for(int c = 0; c < 3; c++) {
+        int diff = (int)levelOf(phy.tones[scanStart[c] + j].frf) - (int)ref[c];
+        diff = (diff < 0) ? -diff : diff;
+        maxDiff = (diff > maxDiff) ? diff : maxDiff;
+      }
+    }
+    BOOST_TEST(maxDiff <= 1);
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
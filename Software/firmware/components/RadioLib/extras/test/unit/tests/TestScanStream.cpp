@@ -0,0 +1,266 @@
+// boost test header
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+// mock HAL and emulated radio
+#include "TestHal.hpp"
+#include "EmulatedSX126x.hpp"
+
+// the stream codec under test
+#include "utils/ScanStream.h"
+
+// everything the sweep engine writes ends up here
+static std::vector<uint8_t> stream;
+
+static void streamOutput(const uint8_t* data, size_t len) {
+  stream.insert(stream.end(), data, data + len);
+}
+
+// simple xorshift generator for reproducible histograms
+static uint32_t xorshift(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return(state);
+}
+
+// histogram similar to a real scan, most samples in a few neighbouring bins
+static void makeHistogram(uint32_t& state, uint16_t* bins, uint16_t numSamples) {
+  memset(bins, 0x00, RADIOLIB_SCAN_STREAM_MAX_BINS*sizeof(uint16_t));
+  int peak = 20 + xorshift(state) % 6;
+  uint16_t side = numSamples / 8 + xorshift(state) % 64;
+  bins[peak - 1] = side;
+  bins[peak + 1] = side;
+  bins[peak] = numSamples - 2*side;
+}
+
+// decode the whole stream, collecting all lines in order
+struct DecodedStream {
+  std::vector<RadioLibScanSweep_t> sweeps;
+  std::vector<std::vector<uint16_t>> lines;
+  std::vector<uint16_t> steps;
+  RadioLibScanDecoder decoder;
+
+  explicit DecodedStream(const std::vector<uint8_t>& data) {
+    for(uint8_t b : data) {
+      for(uint8_t res = decoder.push(b); res != RADIOLIB_SCAN_STREAM_NONE; res = decoder.poll()) {
+        if(res == RADIOLIB_SCAN_STREAM_SWEEP) {
+          sweeps.push_back(decoder.sweep);
+        } else {
+          lines.emplace_back(decoder.bins, decoder.bins + decoder.sweep.numBins);
+          steps.push_back(decoder.step);
+        }
+      }
+    }
+  }
+};
+
+// text produced by the SX126x_Spectrum_Scan_Frequency example for a single frequency step
+static std::string textLine(float freq, const uint16_t* bins) {
+  char buff[32];
+  snprintf(buff, sizeof(buff), "FREQ %.2f\r\n", freq);
+  std::string line = buff;
+  line += "[SX1262] Starting spectral scan ... success!\r\n";
+  line += "SCAN ";
+  for(int i = 0; i < RADIOLIB_SX126X_SPECTRAL_SCAN_RES_SIZE; i++) {
+    line += std::to_string(bins[i]) + ",";
+  }
+  line += " END\r\n";
+  return(line);
+}
+
+// UART time of a number of bytes, 8N1 framing
+static double serialTimeUs(size_t bytes, uint32_t baud) {
+  return(bytes * 10 * 1000000.0 / baud);
+}
+
+// testing fixture, SX1262 on the simulated clock
+struct ScanFixture {
+  TestHal hal { true };
+  EmulatedSX126x radioHardware;
+  Module mod { &hal, EMULATED_RADIO_NSS_PIN, EMULATED_RADIO_IRQ_PIN, EMULATED_RADIO_RST_PIN, EMULATED_RADIO_GPIO_PIN };
+  SX1262 radio { &mod };
+
+  ScanFixture() {
+    BOOST_TEST_MESSAGE("--- Scan fixture setup ---");
+    hal.connectRadio(&radioHardware);
+    hal.spiByteUs = 1;
+    stream.clear();
+  }
+
+  ~ScanFixture() {
+    BOOST_TEST_MESSAGE("--- Scan fixture teardown ---");
+  }
+};
+
+BOOST_AUTO_TEST_SUITE(suite_ScanStream)
+
+  BOOST_AUTO_TEST_CASE(ScanStream_roundTrip)
+  {
+    BOOST_TEST_MESSAGE("--- Test scan stream encode/decode round trip ---");
+    RadioLibScanEncoder encoder;
+    uint8_t record[RADIOLIB_SCAN_STREAM_MAX_RECORD_LEN];
+    std::vector<uint8_t> data;
+    std::vector<std::vector<uint16_t>> lines;
+    uint32_t state = 0x1234ABCD;
+
+    // invalid number of bins
+    RadioLibScanSweep_t sweep = { 902000000UL, 200000UL, 50, 0, 0, 0 };
+    BOOST_TEST(encoder.beginSweep(sweep, record) == 0U);
+
+    for(uint32_t s = 0; s < 3; s++) {
+      sweep = { 902000000UL, 200000UL, 50, RADIOLIB_SCAN_STREAM_MAX_BINS, s, 1000*s };
+      size_t len = encoder.beginSweep(sweep, record);
+      BOOST_TEST(len == (size_t)(RADIOLIB_SCAN_STREAM_HEADER_LEN + RADIOLIB_SCAN_STREAM_SWEEP_LEN + RADIOLIB_SCAN_STREAM_CRC_LEN));
+      data.insert(data.end(), record, record + len);
+
+      for(uint16_t i = 0; i < sweep.numSteps; i++) {
+        uint16_t bins[RADIOLIB_SCAN_STREAM_MAX_BINS];
+        makeHistogram(state, bins, 2048);
+
+        // every few lines add worst case values, these take the longest varints
+        if(i % 7 == 0) {
+          bins[0] = 0xFFFF;
+          bins[RADIOLIB_SCAN_STREAM_MAX_BINS - 1] = 0xFFFF;
+        }
+        len = encoder.encodeLine(i, bins, record);
+        BOOST_TEST(len <= (size_t)RADIOLIB_SCAN_STREAM_MAX_RECORD_LEN);
+        data.insert(data.end(), record, record + len);
+        lines.emplace_back(bins, bins + RADIOLIB_SCAN_STREAM_MAX_BINS);
+      }
+    }
+
+    DecodedStream decoded(data);
+    BOOST_TEST(decoded.sweeps.size() == 3U);
+    BOOST_TEST(decoded.sweeps[2].sequence == 2U);
+    BOOST_TEST(decoded.sweeps[2].timestamp == 2000U);
+    BOOST_TEST(decoded.sweeps[0].freqStart == 902000000UL);
+    BOOST_TEST(decoded.sweeps[0].freqStep == 200000UL);
+    BOOST_TEST(decoded.sweeps[0].numSteps == 50);
+    BOOST_TEST(decoded.lines == lines);
+    BOOST_TEST(decoded.steps[49] == 49);
+    BOOST_TEST(decoded.decoder.errors == 0U);
+    BOOST_TEST(decoded.decoder.dropped == 0U);
+  }
+
+  BOOST_AUTO_TEST_CASE(ScanStream_compression)
+  {
+    BOOST_TEST_MESSAGE("--- Test scan stream compression ---");
+    RadioLibScanEncoder encoder;
+    uint8_t record[RADIOLIB_SCAN_STREAM_MAX_RECORD_LEN];
+    RadioLibScanSweep_t sweep = { 902000000UL, 200000UL, 2, RADIOLIB_SCAN_STREAM_MAX_BINS, 0, 0 };
+    encoder.beginSweep(sweep, record);
+
+    // first line of the sweep has nothing to predict from, but empty bins still collapse
+    uint16_t bins[RADIOLIB_SCAN_STREAM_MAX_BINS] = { 0 };
+    bins[24] = 1228;
+    bins[23] = 410;
+    bins[25] = 410;
+    size_t len = encoder.encodeLine(0, bins, record);
+    BOOST_TEST(len == 4U + 2U + 1U + 2U + 2U + 2U + 1U + 2U);
+
+    // unchanged line is a single run token
+    len = encoder.encodeLine(1, bins, record);
+    BOOST_TEST(len == 4U + 2U + 1U + 2U);
+    BOOST_TEST_MESSAGE("Unchanged line: " << len << " bytes, raw histogram: " << 2*RADIOLIB_SCAN_STREAM_MAX_BINS << " bytes");
+  }
+
+  BOOST_AUTO_TEST_CASE(ScanStream_corruption)
+  {
+    BOOST_TEST_MESSAGE("--- Test scan stream recovery from corrupted records ---");
+    RadioLibScanEncoder encoder;
+    uint8_t record[RADIOLIB_SCAN_STREAM_MAX_RECORD_LEN];
+    std::vector<uint8_t> data;
+    size_t corruptAt = 0;
+    uint32_t state = 0xCAFE;
+
+    for(uint32_t s = 0; s < 2; s++) {
+      RadioLibScanSweep_t sweep = { 915000000UL, 100000UL, 10, RADIOLIB_SCAN_STREAM_MAX_BINS, s, 0 };
+      size_t len = encoder.beginSweep(sweep, record);
+      data.insert(data.end(), record, record + len);
+      for(uint16_t i = 0; i < sweep.numSteps; i++) {
+        uint16_t bins[RADIOLIB_SCAN_STREAM_MAX_BINS];
+        makeHistogram(state, bins, 2048);
+        len = encoder.encodeLine(i, bins, record);
+        if((s == 0) && (i == 3)) {
+          corruptAt = data.size() + len - 3;
+        }
+        data.insert(data.end(), record, record + len);
+      }
+    }
+
+    // some line noise before the stream starts and a flipped bit in line 3 of the first sweep
+    data.insert(data.begin(), { 0x00, RADIOLIB_SCAN_STREAM_SYNC, 0x13, 0x37 });
+    data[corruptAt + 4] ^= 0x10;
+
+    // the damaged line is discarded, the rest of the sweep cannot be predicted without it
+    DecodedStream decoded(data);
+    BOOST_TEST(decoded.sweeps.size() == 2U);
+    BOOST_TEST(decoded.decoder.errors >= 1U);
+    BOOST_TEST(decoded.decoder.dropped == 6U);
+    BOOST_TEST(decoded.lines.size() == 3U + 10U);
+    BOOST_TEST(decoded.steps[3] == 0);
+  }
+
+  BOOST_FIXTURE_TEST_CASE(ScanStream_SX1262_sweep, ScanFixture)
+  {
+    BOOST_TEST_MESSAGE("--- Test SX1262 spectral scan sweep on emulated hardware ---");
+    int16_t ret = radio.beginFSK(902.0);
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+
+    // invalid ranges
+    BOOST_TEST(radio.spectralScanSweep(902.0, 0.2, 0, streamOutput) == RADIOLIB_ERR_INVALID_FREQUENCY);
+    BOOST_TEST(radio.spectralScanSweep(902.0, 0.2, 10, NULL) == RADIOLIB_ERR_INVALID_FREQUENCY);
+    BOOST_TEST(radio.spectralScanSweep(950.0, 1.0, 20, streamOutput) == RADIOLIB_ERR_INVALID_FREQUENCY);
+    BOOST_TEST(stream.empty());
+
+    // the 915 MHz band, with a single transmitter in the middle
+    const uint16_t numSteps = 130;
+    const uint16_t numSweeps = 2;
+    const uint16_t numSamples = 2048;
+    radioHardware.addSignal(915000000UL, 100000UL, -59);
+    unsigned long start = hal.micros();
+    ret = radio.spectralScanSweep(902.0, 0.2, numSteps, streamOutput, numSweeps, numSamples);
+    unsigned long elapsed = hal.micros() - start;
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+    BOOST_TEST(radioHardware.scans == (unsigned int)(numSteps*numSweeps));
+
+    // strongest bin of each line is at the signal level only where the radio was tuned to it
+    DecodedStream decoded(stream);
+    BOOST_TEST(decoded.sweeps.size() == numSweeps);
+    BOOST_TEST(decoded.lines.size() == (size_t)(numSteps*numSweeps));
+    BOOST_TEST(decoded.decoder.errors == 0U);
+    BOOST_TEST(decoded.sweeps[0].freqStart == 902000000UL);
+    BOOST_TEST(decoded.sweeps[0].numBins == RADIOLIB_SX126X_SPECTRAL_SCAN_RES_SIZE);
+    for(size_t i = 0; i < decoded.lines.size(); i++) {
+      const std::vector<uint16_t>& line = decoded.lines[i];
+      size_t peak = std::max_element(line.begin(), line.end()) - line.begin();
+      BOOST_TEST(peak == ((decoded.steps[i] == 65) ? 12U : 24U));
+    }
+
+    // no delays between scans, the overhead is only a few SPI transactions
+    double scanTimeUs = numSamples*8.2;
+    double perScanUs = (double)elapsed / (numSteps*numSweeps);
+    BOOST_TEST_MESSAGE("Scan time: " << scanTimeUs << " us, per step: " << perScanUs << " us");
+    BOOST_TEST(perScanUs < scanTimeUs + 500);
+
+    // compare with the text protocol of the existing example, both over a 115200 baud UART
+    // the example polls every 10 ms and waits 5 ms after each scan
+    const uint32_t baud = 115200;
+    size_t textBytes = 0;
+    for(size_t i = 0; i < decoded.lines.size(); i++) {
+      textBytes += textLine(902.0 + 0.2*decoded.steps[i], decoded.lines[i].data()).length();
+    }
+    double textUs = (10000.0*ceil(scanTimeUs / 10000.0) + 5000.0)*decoded.lines.size() + serialTimeUs(textBytes, baud);
+    double binUs = elapsed + serialTimeUs(stream.size(), baud);
+    double textRate = decoded.lines.size() * 1000000.0 / textUs;
+    double binRate = decoded.lines.size() * 1000000.0 / binUs;
+    BOOST_TEST_MESSAGE("Text protocol: " << textBytes / decoded.lines.size() << " bytes/scan, " << textRate << " scans/s");
+    BOOST_TEST_MESSAGE("Binary stream: " << stream.size() / decoded.lines.size() << " bytes/scan, " << binRate << " scans/s");
+    BOOST_TEST(stream.size()*10 < textBytes);
+    BOOST_TEST(binRate > 2*textRate);
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,224 @@
+// boost test header
+#include <boost/test/unit_test.hpp>
+
+// mock HAL and emulated radios
+#include "TestHal.hpp"
+#include "EmulatedSX126x.hpp"
+#include "EmulatedSX127x.hpp"
+#include "EmulatedLR11x0.hpp"
+
+// SF12, 125 kHz, CR 4/5, 8 symbol preamble, explicit header, CRC on - same as the RadioLib defaults
+static constexpr LoRaAirTimeConfig_t cfgSf12 = { 12, 125000, 5, 8, false, true, RADIOLIB_AIRTIME_LDRO_AUTO, false };
+
+// SX127x uses the legacy formula for low spreading factors, irrelevant at SF12
+static constexpr LoRaAirTimeConfig_t cfgSf12Legacy = { 12, 125000, 5, 8, false, true, RADIOLIB_AIRTIME_LDRO_AUTO, true };
+
+static volatile bool irqFlag = false;
+static unsigned long irqTime = 0;
+static TestHal* irqHal = nullptr;
+
+static void irqAction(void) {
+  irqFlag = true;
+  irqTime = irqHal->micros();
+}
+
+// testing fixture, HAL on the simulated clock with an emulated radio attached
+template<typename Emulator, typename Radio>
+struct SimulationFixture {
+  TestHal hal { true };
+  Emulator radioHardware;
+  Module mod { &hal, EMULATED_RADIO_NSS_PIN, EMULATED_RADIO_IRQ_PIN, EMULATED_RADIO_RST_PIN, EMULATED_RADIO_GPIO_PIN };
+  Radio radio { &mod };
+
+  SimulationFixture() {
+    BOOST_TEST_MESSAGE("--- Simulation fixture setup ---");
+    hal.connectRadio(&radioHardware);
+    irqFlag = false;
+    irqHal = &hal;
+  }
+
+  ~SimulationFixture() {
+    BOOST_TEST_MESSAGE("--- Simulation fixture teardown ---");
+  }
+};
+
+typedef SimulationFixture<EmulatedSX126x, SX1262> SX1262Fixture;
+typedef SimulationFixture<EmulatedSX127x, SX1276> SX1276Fixture;
+typedef SimulationFixture<EmulatedLR11x0, LR1121> LR1121Fixture;
+
+// firmware image read by the streamed update, reading fails from failAt onwards
+struct FirmwareSource {
+  std::vector<uint32_t> image;
+  size_t failAt;
+  unsigned int reads;
+};
+
+static size_t firmwareRead(uint32_t offset, uint32_t* data, size_t len, void* ctx) {
+  FirmwareSource* src = static_cast<FirmwareSource*>(ctx);
+  src->reads++;
+  if(offset + len > src->failAt) {
+    return(0);
+  }
+  memcpy(data, &src->image[offset], len*sizeof(uint32_t));
+  return(len);
+}
+
+static FirmwareSource firmwareSource(size_t words, size_t failAt) {
+  FirmwareSource src = { std::vector<uint32_t>(words), failAt, 0 };
+  for(size_t i = 0; i < words; i++) {
+    src.image[i] = 0xA5000000UL ^ (uint32_t)(i * 2654435761UL);
+  }
+  return(src);
+}
+
+BOOST_AUTO_TEST_SUITE(suite_Simulation)
+
+  BOOST_AUTO_TEST_CASE(Simulation_virtualClock)
+  {
+    BOOST_TEST_MESSAGE("--- Test TestHal virtual clock ---");
+    TestHal hal(true);
+    hal.init();
+    BOOST_TEST(hal.isVirtualTime());
+
+    // delays do not sleep, they only move the clock
+    const auto start = std::chrono::steady_clock::now();
+    hal.delay(60000);
+    hal.delayMicroseconds(250);
+    const auto wall = std::chrono::steady_clock::now() - start;
+    BOOST_TEST(hal.millis() == 60000UL);
+    BOOST_TEST(hal.micros() == 60000250UL);
+    BOOST_TEST(std::chrono::duration_cast<std::chrono::seconds>(wall).count() < 1);
+
+    // polling loops advance the clock through yield
+    hal.yield();
+    BOOST_TEST(hal.micros() == 60000250UL + TEST_HAL_YIELD_US);
+  }
+
+  BOOST_FIXTURE_TEST_CASE(Simulation_SX1262_transmit, SX1262Fixture)
+  {
+    BOOST_TEST_MESSAGE("--- Test SX1262 blocking transmit on emulated hardware ---");
+    int16_t ret = radio.begin(868.0, 125.0, 12, 5, RADIOLIB_SX126X_SYNC_WORD_PRIVATE, 10, 8, 0);
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+
+    // 20 bytes at SF12 take over a second on air, here it only takes simulated time
+    uint8_t data[20];
+    for(size_t i = 0; i < sizeof(data); i++) {
+      data[i] = i;
+    }
+    ret = radio.transmit(data, sizeof(data));
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+    BOOST_TEST(radioHardware.txPacket == std::vector<uint8_t>(data, data + sizeof(data)));
+
+    // the emulated radio uses the configured parameters, which must match the reference time-on-air
+    BOOST_TEST(radioHardware.timeOnAir(sizeof(data)) == RadioLibAirTime::timeOnAirUs(cfgSf12, sizeof(data)));
+
+    // transmit returns within one polling step of the end of transmission
+    const unsigned long end = radioHardware.txStart + RadioLibAirTime::timeOnAirUs(cfgSf12, sizeof(data));
+    BOOST_TEST(hal.micros() >= end);
+    BOOST_TEST(hal.micros() < end + 10000UL);
+  }
+
+  BOOST_FIXTURE_TEST_CASE(Simulation_SX1262_receive, SX1262Fixture)
+  {
+    BOOST_TEST_MESSAGE("--- Test SX1262 blocking receive on emulated hardware ---");
+    int16_t ret = radio.begin(868.0, 125.0, 12, 5, RADIOLIB_SX126X_SYNC_WORD_PRIVATE, 10, 8, 0);
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+
+    // nothing on air, the radio times out after 100 symbols (3.3 s at SF12)
+    uint8_t buff[32] = { 0 };
+    unsigned long start = hal.micros();
+    ret = radio.receive(buff, 0);
+    BOOST_TEST(ret == RADIOLIB_ERR_RX_TIMEOUT);
+    BOOST_TEST((hal.micros() - start) >= 100*32768UL);
+
+    // packet starting 1 second into the reception
+    const uint8_t data[] = { 'H', 'e', 'l', 'l', 'o' };
+    start = hal.micros();
+    radioHardware.schedulePacket(data, sizeof(data), start + 1000000UL, -80, 8);
+    ret = radio.receive(buff, 0);
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+    BOOST_TEST(radio.getPacketLength() == sizeof(data));
+    BOOST_TEST(memcmp(buff, data, sizeof(data)) == 0);
+    BOOST_TEST(radio.getRSSI() == -80.0f);
+    BOOST_TEST(radioHardware.missed == 0U);
+    BOOST_TEST((hal.micros() - start) >= 1000000UL + RadioLibAirTime::timeOnAirUs(cfgSf12, sizeof(data)));
+  }
+
+  BOOST_FIXTURE_TEST_CASE(Simulation_SX1276_interrupt, SX1276Fixture)
+  {
+    BOOST_TEST_MESSAGE("--- Test SX1276 interrupt-driven transmit on emulated hardware ---");
+    int16_t ret = radio.begin(915.0, 125.0, 12, 5, RADIOLIB_SX127X_SYNC_WORD, 10, 8, 0);
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+
+    // interrupt fires exactly when the emulated transmission ends
+    radio.setPacketSentAction(irqAction);
+    uint8_t data[20] = { 0 };
+    ret = radio.startTransmit(data, sizeof(data));
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+    while(!irqFlag) {
+      hal.delay(100);
+    }
+    BOOST_TEST(irqTime == radioHardware.txStart + RadioLibAirTime::timeOnAirUs(cfgSf12Legacy, sizeof(data)));
+    BOOST_TEST(radio.finishTransmit() == RADIOLIB_ERR_NONE);
+    radio.clearPacketSentAction();
+  }
+
+  BOOST_FIXTURE_TEST_CASE(Simulation_SX1276_receive, SX1276Fixture)
+  {
+    BOOST_TEST_MESSAGE("--- Test SX1276 receive on emulated hardware ---");
+    int16_t ret = radio.begin(915.0, 125.0, 12, 5, RADIOLIB_SX127X_SYNC_WORD, 10, 8, 0);
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+
+    // the packet arrives while the radio is in continuous Rx
+    const uint8_t data[] = { 'T', ':', '2', '5' };
+    radio.setPacketReceivedAction(irqAction);
+    ret = radio.startReceive();
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+    const unsigned long at = hal.micros() + 500000UL;
+    radioHardware.schedulePacket(data, sizeof(data), at, -90, 5);
+    while(!irqFlag) {
+      hal.delay(100);
+    }
+    BOOST_TEST(irqTime == at + RadioLibAirTime::timeOnAirUs(cfgSf12Legacy, sizeof(data)));
+
+    uint8_t buff[sizeof(data)] = { 0 };
+    ret = radio.readData(buff, 0);
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+    BOOST_TEST(memcmp(buff, data, sizeof(data)) == 0);
+    radio.clearPacketReceivedAction();
+  }
+
+  BOOST_FIXTURE_TEST_CASE(Simulation_LR1121_updateFirmwareStream, LR1121Fixture)
+  {
+    BOOST_TEST_MESSAGE("--- Test LR1121 streamed firmware update on emulated hardware ---");
+    int16_t ret = radio.begin();
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+
+    // 150 words do not fit a single 64-word chunk, the last chunk is partial
+    FirmwareSource src = firmwareSource(150, 150);
+    ret = radio.updateFirmware(firmwareRead, src.image.size(), &src);
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+    BOOST_TEST(src.reads == 3U);
+    BOOST_TEST(radioHardware.erases == 1U);
+    BOOST_TEST(radioHardware.flash == src.image);
+    BOOST_TEST(!radioHardware.boot);
+  }
+
+  BOOST_FIXTURE_TEST_CASE(Simulation_LR1121_updateFirmwareStreamReadFail, LR1121Fixture)
+  {
+    BOOST_TEST_MESSAGE("--- Test LR1121 streamed firmware update with a failing read ---");
+    int16_t ret = radio.begin();
+    BOOST_TEST(ret == RADIOLIB_ERR_NONE);
+
+    // the second chunk cannot be read, the update stops there but the bootloader is still left
+    FirmwareSource src = firmwareSource(150, 100);
+    unsigned int resets = radioHardware.resets;
+    ret = radio.updateFirmware(firmwareRead, src.image.size(), &src);
+    BOOST_TEST(ret == RADIOLIB_ERR_INVALID_PAYLOAD);
+    BOOST_TEST(src.reads == 2U);
+    BOOST_TEST(radioHardware.flash.size() == 64U);
+    BOOST_TEST(radioHardware.resets == resets + 1);
+    BOOST_TEST(!radioHardware.boot);
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -120,5 +120,8 @@
 // utilities
 #include "utils/CRC.h"
 #include "utils/Cryptography.h"
+#include "utils/AirTime.h"
+#include "utils/BitRing.h"
+#include "utils/ScanStream.h"
 
 #endif
@@ -0,0 +1,289 @@
+#include "EspIdfHal.h"
+
+#if defined(ESP_PLATFORM) && !defined(RADIOLIB_BUILD_ARDUINO)
+
+#include <string.h>
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_sys.h"
+#include "esp_rom_gpio.h"
+
+// shared by all interrupts, the ISR service passes only a single argument (the RadioLib callback)
+static TaskHandle_t irqTask = NULL;
+static volatile int64_t lastIrqUs = 0;
+
+// not IRAM_ATTR: the ISR service is installed without ESP_INTR_FLAG_IRAM (see init), so these handlers never
+// run while the flash cache is disabled and RadioLib callbacks don't have to live in IRAM
+void EspIdfHal::isrTrampoline(void* arg) {
+  lastIrqUs = esp_timer_get_time();
+  reinterpret_cast<void (*)(void)>(arg)();
+
+  TaskHandle_t task = irqTask;
+  if(task) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+}
+
+void EspIdfHal::busyIsr(void* arg) {
+  BaseType_t woken = pdFALSE;
+  xSemaphoreGiveFromISR((SemaphoreHandle_t)arg, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+void EspIdfHal::init() {
+  // the trampoline calls arbitrary RadioLib callbacks, which are not guaranteed to be in IRAM: with an IRAM ISR
+  // an edge during a flash write (NVS, OTA) would fault. Interrupts are deferred during flash writes instead
+  gpio_install_isr_service(0);
+  spiBegin();
+}
+
+void EspIdfHal::term() {
+  this->setBusyPin(RADIOLIB_NC);
+  spiEnd();
+}
+
+void EspIdfHal::pinMode(uint32_t pin, uint32_t mode) {
+  if(pin == RADIOLIB_NC) {
+    return;
+  }
+
+  // gpio_reset_pin would also clear the interrupt type, so only route the pad to GPIO and set direction
+  esp_rom_gpio_pad_select_gpio(pin);
+  gpio_set_pull_mode((gpio_num_t)pin, GPIO_FLOATING);
+  gpio_set_direction((gpio_num_t)pin, (gpio_mode_t)mode);
+}
+
+void EspIdfHal::digitalWrite(uint32_t pin, uint32_t value) {
+  if(pin == RADIOLIB_NC) {
+    return;
+  }
+
+  gpio_set_level((gpio_num_t)pin, value);
+}
+
+uint32_t EspIdfHal::digitalRead(uint32_t pin) {
+  if(pin == RADIOLIB_NC) {
+    return(0);
+  }
+
+  return(gpio_get_level((gpio_num_t)pin));
+}
+
+void EspIdfHal::attachInterrupt(uint32_t interruptNum, void (*interruptCb)(void), uint32_t mode) {
+  if(interruptNum == RADIOLIB_NC) {
+    return;
+  }
+
+  gpio_set_intr_type((gpio_num_t)interruptNum, (gpio_int_type_t)mode);
+  gpio_isr_handler_add((gpio_num_t)interruptNum, EspIdfHal::isrTrampoline, reinterpret_cast<void*>(interruptCb));
+  gpio_intr_enable((gpio_num_t)interruptNum);
+}
+
+void EspIdfHal::detachInterrupt(uint32_t interruptNum) {
+  if(interruptNum == RADIOLIB_NC) {
+    return;
+  }
+
+  gpio_isr_handler_remove((gpio_num_t)interruptNum);
+  gpio_set_intr_type((gpio_num_t)interruptNum, GPIO_INTR_DISABLE);
+}
+
+void EspIdfHal::delay(RadioLibTime_t ms) {
+  // round up, vTaskDelay(ms / portTICK_PERIOD_MS) would not wait at all for delays shorter than one tick
+  vTaskDelay((ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+}
+
+void EspIdfHal::delayMicroseconds(RadioLibTime_t us) {
+  // sleep for whole ticks and spin only for the remainder
+  const RadioLibTime_t tickUs = portTICK_PERIOD_MS * 1000UL;
+  if(us >= 2*tickUs) {
+    int64_t end = esp_timer_get_time() + us;
+    vTaskDelay((us / tickUs) - 1);
+    int64_t left = end - esp_timer_get_time();
+    if(left > 0) {
+      esp_rom_delay_us((uint32_t)left);
+    }
+    return;
+  }
+
+  esp_rom_delay_us((uint32_t)us);
+}
+
+RadioLibTime_t EspIdfHal::millis() {
+  return((RadioLibTime_t)(esp_timer_get_time() / 1000ULL));
+}
+
+RadioLibTime_t EspIdfHal::micros() {
+  return((RadioLibTime_t)esp_timer_get_time());
+}
+
+long EspIdfHal::pulseIn(uint32_t pin, uint32_t state, RadioLibTime_t timeout) {
+  if(pin == RADIOLIB_NC) {
+    return(0);
+  }
+
+  this->pinMode(pin, GPIO_MODE_INPUT);
+  RadioLibTime_t start = this->micros();
+  while(this->digitalRead(pin) == state) {
+    if((this->micros() - start) > timeout) {
+      return(0);
+    }
+  }
+
+  return(this->micros() - start);
+}
+
+void EspIdfHal::yield() {
+  // RadioLib calls this both from BUSY wait loops and from microsecond timing loops,
+  // so only block when the module is actually busy
+  if((this->busySem != NULL) && this->digitalRead(this->busyPin)) {
+    xSemaphoreTake(this->busySem, 1);
+  }
+}
+
+void EspIdfHal::spiBegin() {
+  if(this->spiDevice) {
+    return;
+  }
+
+  spi_bus_config_t bus = {};
+  bus.mosi_io_num = this->spiMOSI;
+  bus.miso_io_num = this->spiMISO;
+  bus.sclk_io_num = this->spiSCK;
+  bus.quadwp_io_num = -1;
+  bus.quadhd_io_num = -1;
+  bus.max_transfer_sz = RADIOLIB_ESP_IDF_HAL_DMA_BUFF_LEN;
+
+  // the bus may already be initialized by another driver, in that case it is shared
+  esp_err_t err = spi_bus_initialize(this->spiHost, &bus, SPI_DMA_CH_AUTO);
+  this->spiBusOwner = (err == ESP_OK);
+  if((err != ESP_OK) && (err != ESP_ERR_INVALID_STATE)) {
+    RADIOLIB_DEBUG_BASIC_PRINTLN("SPI bus init failed: %d", err);
+    return;
+  }
+
+  // chip select is controlled by RadioLib
+  spi_device_interface_config_t dev = {};
+  dev.mode = 0;
+  dev.clock_speed_hz = (int)this->spiFreq;
+  dev.spics_io_num = -1;
+  dev.queue_size = 1;
+  if(spi_bus_add_device(this->spiHost, &dev, &this->spiDevice) != ESP_OK) {
+    RADIOLIB_DEBUG_BASIC_PRINTLN("SPI device init failed");
+    this->spiDevice = NULL;
+    return;
+  }
+
+  this->dmaOut = (uint8_t*)heap_caps_malloc(RADIOLIB_ESP_IDF_HAL_DMA_BUFF_LEN, MALLOC_CAP_DMA);
+  this->dmaIn = (uint8_t*)heap_caps_malloc(RADIOLIB_ESP_IDF_HAL_DMA_BUFF_LEN, MALLOC_CAP_DMA);
+}
+
+void EspIdfHal::spiBeginTransaction() {
+  // take the bus for the whole RadioLib transaction, this makes polled transfers cheaper
+  if(this->spiDevice) {
+    spi_device_acquire_bus(this->spiDevice, portMAX_DELAY);
+  }
+}
+
+void EspIdfHal::spiTransfer(uint8_t* out, size_t len, uint8_t* in) {
+  if(!this->spiDevice || !this->dmaOut || !this->dmaIn) {
+    return;
+  }
+
+  size_t pos = 0;
+  while(pos < len) {
+    size_t chunk = len - pos;
+    if(chunk > RADIOLIB_ESP_IDF_HAL_DMA_BUFF_LEN) {
+      chunk = RADIOLIB_ESP_IDF_HAL_DMA_BUFF_LEN;
+    }
+
+    spi_transaction_t t = {};
+    t.length = chunk * 8;
+    t.rxlength = chunk * 8;
+    if(chunk <= 4) {
+      // command and register access fits the transaction descriptor itself
+      t.flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
+      memcpy(t.tx_data, &out[pos], chunk);
+      spi_device_polling_transmit(this->spiDevice, &t);
+      memcpy(&in[pos], t.rx_data, chunk);
+
+    } else {
+      memcpy(this->dmaOut, &out[pos], chunk);
+      t.tx_buffer = this->dmaOut;
+      t.rx_buffer = this->dmaIn;
+      if(chunk <= RADIOLIB_ESP_IDF_HAL_FIFO_LEN) {
+        // too short to be worth a context switch
+        spi_device_polling_transmit(this->spiDevice, &t);
+      } else {
+        // FIFO burst, block on the transaction so that other tasks can run
+        spi_device_transmit(this->spiDevice, &t);
+      }
+      memcpy(&in[pos], this->dmaIn, chunk);
+
+    }
+
+    pos += chunk;
+  }
+}
+
+void EspIdfHal::spiEndTransaction() {
+  if(this->spiDevice) {
+    spi_device_release_bus(this->spiDevice);
+  }
+}
+
+void EspIdfHal::spiEnd() {
+  if(this->spiDevice) {
+    spi_bus_remove_device(this->spiDevice);
+    this->spiDevice = NULL;
+  }
+
+  if(this->spiBusOwner) {
+    spi_bus_free(this->spiHost);
+    this->spiBusOwner = false;
+  }
+
+  heap_caps_free(this->dmaOut);
+  heap_caps_free(this->dmaIn);
+  this->dmaOut = NULL;
+  this->dmaIn = NULL;
+}
+
+void EspIdfHal::setIrqTask(TaskHandle_t task) {
+  irqTask = task;
+}
+
+bool EspIdfHal::waitForIrq(TickType_t timeout) {
+  return(ulTaskNotifyTake(pdTRUE, timeout) > 0);
+}
+
+void EspIdfHal::setBusyPin(uint32_t pin) {
+  if(this->busyPin != RADIOLIB_NC) {
+    gpio_isr_handler_remove((gpio_num_t)this->busyPin);
+    gpio_set_intr_type((gpio_num_t)this->busyPin, GPIO_INTR_DISABLE);
+  }
+
+  this->busyPin = pin;
+  if(pin == RADIOLIB_NC) {
+    if(this->busySem) {
+      vSemaphoreDelete(this->busySem);
+      this->busySem = NULL;
+    }
+    return;
+  }
+
+  if(!this->busySem) {
+    this->busySem = xSemaphoreCreateBinary();
+  }
+  gpio_set_intr_type((gpio_num_t)pin, GPIO_INTR_NEGEDGE);
+  gpio_isr_handler_add((gpio_num_t)pin, EspIdfHal::busyIsr, (void*)this->busySem);
+  gpio_intr_enable((gpio_num_t)pin);
+}
+
+RadioLibTime_t EspIdfHal::getLastIrqMicros() const {
+  return((RadioLibTime_t)lastIrqUs);
+}
+
+#endif
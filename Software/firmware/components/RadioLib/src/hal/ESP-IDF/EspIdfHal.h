@@ -0,0 +1,113 @@
+#ifndef ESP_IDF_HAL_H
+#define ESP_IDF_HAL_H
+
+// include RadioLib
+#include <RadioLib.h>
+
+#if defined(ESP_PLATFORM) && !defined(RADIOLIB_BUILD_ARDUINO)
+
+// include the necessary ESP-IDF libraries
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+
+// length of the SPI hardware buffer, transfers up to this length are done by polling
+#define RADIOLIB_ESP_IDF_HAL_FIFO_LEN                 (64)
+
+// size of the DMA-capable buffers, longer transfers are split into chunks of this size
+#if !defined(RADIOLIB_ESP_IDF_HAL_DMA_BUFF_LEN)
+  #define RADIOLIB_ESP_IDF_HAL_DMA_BUFF_LEN           (512)
+#endif
+
+// create a new ESP-IDF hardware abstraction layer
+// SPI is done through the spi_master driver with preallocated DMA-capable buffers:
+// short transfers are polled, FIFO bursts are queued as DMA transactions so that other tasks can run
+// interrupts use the GPIO ISR service and can additionally wake a task through task notification
+// the ISR service is installed without ESP_INTR_FLAG_IRAM, so callbacks don't need IRAM_ATTR; if the application
+// installs the service itself with ESP_INTR_FLAG_IRAM first, every RadioLib callback must be IRAM_ATTR
+// the chip select is driven by RadioLib, so the bus can be shared with other devices
+class EspIdfHal : public RadioLibHal {
+  public:
+    /*!
+      \brief Default constructor.
+      \param sck SPI clock pin.
+      \param miso SPI MISO pin.
+      \param mosi SPI MOSI pin.
+      \param host SPI peripheral to use, defaults to SPI2_HOST.
+      \param freq SPI clock frequency in Hz, defaults to 8 MHz.
+    */
+    EspIdfHal(int8_t sck, int8_t miso, int8_t mosi, spi_host_device_t host = SPI2_HOST, uint32_t freq = 8000000)
+      : RadioLibHal(GPIO_MODE_INPUT, GPIO_MODE_OUTPUT, 0, 1, GPIO_INTR_POSEDGE, GPIO_INTR_NEGEDGE),
+      spiSCK(sck), spiMISO(miso), spiMOSI(mosi), spiHost(host), spiFreq(freq) {}
+
+    void init() override;
+    void term() override;
+
+    void pinMode(uint32_t pin, uint32_t mode) override;
+    void digitalWrite(uint32_t pin, uint32_t value) override;
+    uint32_t digitalRead(uint32_t pin) override;
+    void attachInterrupt(uint32_t interruptNum, void (*interruptCb)(void), uint32_t mode) override;
+    void detachInterrupt(uint32_t interruptNum) override;
+
+    void delay(RadioLibTime_t ms) override;
+    void delayMicroseconds(RadioLibTime_t us) override;
+    RadioLibTime_t millis() override;
+    RadioLibTime_t micros() override;
+    long pulseIn(uint32_t pin, uint32_t state, RadioLibTime_t timeout) override;
+    void yield() override;
+
+    void spiBegin() override;
+    void spiBeginTransaction() override;
+    void spiTransfer(uint8_t* out, size_t len, uint8_t* in) override;
+    void spiEndTransaction() override;
+    void spiEnd() override;
+
+    /*!
+      \brief Set task to be notified (xTaskNotifyGive) from every interrupt attached through this HAL.
+      \param task Task handle, NULL to disable notifications.
+    */
+    void setIrqTask(TaskHandle_t task);
+
+    /*!
+      \brief Block the calling task until an interrupt arrives. The task must be set by setIrqTask.
+      \param timeout Maximum time to wait in ticks.
+      \returns True if an interrupt arrived, false on timeout.
+    */
+    bool waitForIrq(TickType_t timeout);
+
+    /*!
+      \brief Set the BUSY pin of the module. While BUSY is high, RadioLib's wait loops block
+      on a falling-edge interrupt instead of spinning.
+      \param pin BUSY pin, RADIOLIB_NC to disable.
+    */
+    void setBusyPin(uint32_t pin);
+
+    /*!
+      \brief Get the timestamp of the last interrupt, taken in the ISR.
+      \returns Timestamp in microseconds.
+    */
+    RadioLibTime_t getLastIrqMicros() const;
+
+  private:
+    int8_t spiSCK;
+    int8_t spiMISO;
+    int8_t spiMOSI;
+    spi_host_device_t spiHost;
+    uint32_t spiFreq;
+    spi_device_handle_t spiDevice = NULL;
+    bool spiBusOwner = false;
+    uint8_t* dmaOut = NULL;
+    uint8_t* dmaIn = NULL;
+
+    uint32_t busyPin = RADIOLIB_NC;
+    SemaphoreHandle_t busySem = NULL;
+
+    static void isrTrampoline(void* arg);
+    static void busyIsr(void* arg);
+};
+
+#endif
+
+#endif
@@ -1203,58 +1203,25 @@ RadioLibTime_t LR11x0::getTimeOnAir(size_t len) {
   uint8_t type = RADIOLIB_LR11X0_PACKET_TYPE_NONE;
   (void)getPacketType(&type);
   if(type == RADIOLIB_LR11X0_PACKET_TYPE_LORA) {
-    // calculate number of symbols
-    float N_symbol = 0;
     if(this->codingRate <= RADIOLIB_LR11X0_LORA_CR_4_8_SHORT) {
       // legacy coding rate - nice and simple
-
-      // get SF coefficients
-      float coeff1 = 0;
-      int16_t coeff2 = 0;
-      int16_t coeff3 = 0;
-      if(this->spreadingFactor < 7) {
-        // SF5, SF6
-        coeff1 = 6.25;
-        coeff2 = 4*this->spreadingFactor;
-        coeff3 = 4*this->spreadingFactor;
-      } else if(this->spreadingFactor < 11) {
-        // SF7. SF8, SF9, SF10
-        coeff1 = 4.25;
-        coeff2 = 4*this->spreadingFactor + 8;
-        coeff3 = 4*this->spreadingFactor;
-      } else {
-        // SF11, SF12
-        coeff1 = 4.25;
-        coeff2 = 4*this->spreadingFactor + 8;
-        coeff3 = 4*(this->spreadingFactor - 2);
-      }
-
-      // get CRC length
-      int16_t N_bitCRC = 16;
-      if(this->crcTypeLoRa == RADIOLIB_LR11X0_LORA_CRC_DISABLED) {
-        N_bitCRC = 0;
-      }
-
-      // get header length
-      int16_t N_symbolHeader = 20;
-      if(this->headerType == RADIOLIB_LR11X0_LORA_HEADER_IMPLICIT) {
-        N_symbolHeader = 0;
-      }
-
-      // calculate number of LoRa preamble symbols
-      uint32_t N_symbolPreamble = (this->preambleLengthLoRa & 0x0F) * (uint32_t(1) << ((this->preambleLengthLoRa & 0xF0) >> 4));
-
-      // calculate the number of symbols
-      N_symbol = (float)N_symbolPreamble + coeff1 + 8.0f + ceilf((float)RADIOLIB_MAX((int16_t)(8 * len + N_bitCRC - coeff2 + N_symbolHeader), (int16_t)0) / (float)coeff3) * (float)(this->codingRate + 4);
-
-    } else {
-      // long interleaving - abandon hope all ye who enter here
-      /// \todo implement this mess - SX1280 datasheet v3.0 section 7.4.4.2
+      const LoRaAirTimeConfig_t cfg = {
+        this->spreadingFactor,
+        (uint32_t)(this->bandwidthKhz * 1000.0f + 0.5f),
+        (uint8_t)(this->codingRate + 4),
+        this->preambleLengthLoRa,
+        this->headerType == RADIOLIB_LR11X0_LORA_HEADER_IMPLICIT,
+        this->crcTypeLoRa != RADIOLIB_LR11X0_LORA_CRC_DISABLED,
+        (this->ldrOptimize == RADIOLIB_LR11X0_LORA_LDRO_ENABLED) ? (uint8_t)RADIOLIB_AIRTIME_LDRO_ON : (uint8_t)RADIOLIB_AIRTIME_LDRO_OFF,
+        false,
+      };
+      return(RadioLibAirTime::timeOnAirUs(cfg, len));
 
     }
 
-    // get time-on-air in us
-    return(((uint32_t(1) << this->spreadingFactor) / this->bandwidthKhz) * N_symbol * 1000.0f);
+    // long interleaving - abandon hope all ye who enter here
+    /// \todo implement this mess - SX1280 datasheet v3.0 section 7.4.4.2
+    return(0);
 
   } else if(type == RADIOLIB_LR11X0_PACKET_TYPE_GFSK) {
     return(((uint32_t)len * 8 * 1000000UL) / this->bitRate);
@@ -1457,6 +1424,59 @@ int16_t LR11x0::getVersionInfo(LR11x0VersionInfo_t* info) {
 int16_t LR11x0::updateFirmware(const uint32_t* image, size_t size, bool nonvolatile) {
   RADIOLIB_ASSERT_PTR(image);
 
+  int16_t state = this->bootEnter();
+  RADIOLIB_ASSERT(state);
+
+  // upload the new image
+  const size_t maxLen = RADIOLIB_LR11X0_SPI_MAX_READ_WRITE_LEN / sizeof(uint32_t);
+  size_t rem = size % maxLen;
+  size_t numWrites = (rem == 0) ? (size / maxLen) : ((size / maxLen) + 1);
+  RADIOLIB_DEBUG_BASIC_PRINTLN("Writing image in %lu chunks, last chunk size is %lu words", (unsigned long)numWrites, (unsigned long)rem);
+  for(size_t i = 0; i < numWrites; i ++) {
+    uint32_t offset = i * maxLen;
+    uint32_t len = (i == (numWrites - 1)) ? rem : maxLen;
+    RADIOLIB_DEBUG_BASIC_PRINTLN("Writing chunk %d at offset %08lx (%u words)", (int)i, (unsigned long)offset, (unsigned int)len);
+    this->bootWriteFlashEncrypted(offset*sizeof(uint32_t), const_cast<uint32_t*>(&image[offset]), len, nonvolatile);
+  }
+
+  return(this->bootExit());
+}
+
+int16_t LR11x0::updateFirmware(FirmwareReadCb_t cb, size_t size, void* ctx) {
+  RADIOLIB_ASSERT_PTR(cb);
+
+  #if RADIOLIB_DEBUG_BASIC
+  RadioLibTime_t start = this->mod->hal->millis();
+  #endif
+  int16_t state = this->bootEnter();
+  RADIOLIB_ASSERT(state);
+
+  // stream the image through a single SPI-sized buffer, so the image itself
+  // does not have to be stored in the host flash (e.g. when read from a filesystem or partition)
+  const size_t maxLen = RADIOLIB_LR11X0_SPI_MAX_READ_WRITE_LEN / sizeof(uint32_t);
+  uint32_t buff[RADIOLIB_LR11X0_SPI_MAX_READ_WRITE_LEN / sizeof(uint32_t)];
+  for(size_t offset = 0; offset < size; offset += maxLen) {
+    size_t len = RADIOLIB_MIN(maxLen, size - offset);
+    if(cb(offset, buff, len, ctx) != len) {
+      RADIOLIB_DEBUG_BASIC_PRINTLN("Failed to read image chunk at offset %08lx", (unsigned long)offset);
+      state = RADIOLIB_ERR_INVALID_PAYLOAD;
+      break;
+    }
+
+    state = this->bootWriteFlashEncrypted(offset*sizeof(uint32_t), buff, len, false);
+    if(state != RADIOLIB_ERR_NONE) {
+      break;
+    }
+  }
+
+  // leave the bootloader even if the upload failed, the first error is the one reported
+  int16_t exitState = this->bootExit();
+  RADIOLIB_DEBUG_BASIC_PRINTLN("Streamed %lu words in %lu ms", (unsigned long)size, (unsigned long)(this->mod->hal->millis() - start));
+  RADIOLIB_ASSERT(state);
+  return(exitState);
+}
+
+int16_t LR11x0::bootEnter() {
   // put the device to bootloader mode
   int16_t state = this->reboot(true);
   RADIOLIB_ASSERT(state);
@@ -1485,23 +1505,16 @@ int16_t LR11x0::updateFirmware(const uint32_t* image, size_t size, bool nonvolat
     }
   }
 
-  // upload the new image
-  const size_t maxLen = 64;
-  size_t rem = size % maxLen;
-  size_t numWrites = (rem == 0) ? (size / maxLen) : ((size / maxLen) + 1);
-  RADIOLIB_DEBUG_BASIC_PRINTLN("Writing image in %lu chunks, last chunk size is %lu words", (unsigned long)numWrites, (unsigned long)rem);
-  for(size_t i = 0; i < numWrites; i ++) {
-    uint32_t offset = i * maxLen;
-    uint32_t len = (i == (numWrites - 1)) ? rem : maxLen;
-    RADIOLIB_DEBUG_BASIC_PRINTLN("Writing chunk %d at offset %08lx (%u words)", (int)i, (unsigned long)offset, (unsigned int)len);
-    this->bootWriteFlashEncrypted(offset*sizeof(uint32_t), const_cast<uint32_t*>(&image[offset]), len, nonvolatile);
-  }
+  return(state);
+}
 
+int16_t LR11x0::bootExit() {
   // kick the device from bootloader
-  state = this->reset();
+  int16_t state = this->reset();
   RADIOLIB_ASSERT(state);
 
   // verify we are no longer in bootloader
+  uint8_t device = 0xFF;
   state = this->getVersion(NULL, &device, NULL, NULL);
   RADIOLIB_ASSERT(state);
   if(device == RADIOLIB_LR11X0_DEVICE_BOOT) {
@@ -1541,6 +1541,28 @@ class LR11x0: public PhysicalLayer {
       \returns \ref status_codes
     */
     int16_t updateFirmware(const uint32_t* image, size_t size, bool nonvolatile = true);
+
+    /*!
+      \brief Callback to read a part of a firmware image during a streamed update.
+      \param offset Offset into the image in 32-bit words.
+      \param data Buffer to fill with image data.
+      \param len Number of 32-bit words to read.
+      \param ctx User context passed to updateFirmware.
+      \returns Number of 32-bit words actually read.
+    */
+    typedef size_t (*FirmwareReadCb_t)(uint32_t offset, uint32_t* data, size_t len, void* ctx);
+
+    /*!
+      \brief Method to upload new firmware image to the device, reading it in chunks through a callback.
+      Only one SPI transfer worth of the image (256 bytes) is held in RAM at a time, so the image can be kept
+      outside of the host flash, e.g. in a filesystem, a data partition or received over the network.
+      \param cb Callback that provides the image data.
+      \param size Size of the image in 32-bit words.
+      \param ctx User context passed to the callback. Defaults to NULL.
+      \returns \ref status_codes, RADIOLIB_ERR_INVALID_PAYLOAD when the callback returns fewer words than requested.
+      The device is taken out of bootloader mode also when the upload fails.
+    */
+    int16_t updateFirmware(FirmwareReadCb_t cb, size_t size, void* ctx = NULL);
     
     /*!
       \brief Method to check whether the device is capable of performing a GNSS scan.
@@ -1797,6 +1819,8 @@ class LR11x0: public PhysicalLayer {
 
     int16_t bootEraseFlash(void);
     int16_t bootWriteFlashEncrypted(uint32_t offset, const uint32_t* data, size_t len, bool nonvolatile);
+    int16_t bootEnter();
+    int16_t bootExit();
     int16_t bootReboot(bool stay);
     int16_t bootGetPin(uint8_t* pin);
     int16_t bootGetChipEui(uint8_t* eui);
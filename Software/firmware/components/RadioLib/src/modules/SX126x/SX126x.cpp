@@ -1339,37 +1339,20 @@ int16_t SX126x::variablePacketLengthMode(uint8_t maxLen) {
 }
 
 RadioLibTime_t SX126x::getTimeOnAir(size_t len) {
-  // everything is in microseconds to allow integer arithmetic
-  // some constants have .25, these are multiplied by 4, and have _x4 postfix to indicate that fact
   uint8_t modem = getPacketType();
   if(modem == RADIOLIB_SX126X_PACKET_TYPE_LORA) {
-    uint32_t symbolLength_us = ((uint32_t)(1000 * 10) << this->spreadingFactor) / (this->bandwidthKhz * 10) ;
-    uint8_t sfCoeff1_x4 = 17; // (4.25 * 4)
-    uint8_t sfCoeff2 = 8;
-    if(this->spreadingFactor == 5 || this->spreadingFactor == 6) {
-      sfCoeff1_x4 = 25; // 6.25 * 4
-      sfCoeff2 = 0;
-    }
-    uint8_t sfDivisor = 4*this->spreadingFactor;
-    if(symbolLength_us >= 16000) {
-      sfDivisor = 4*(this->spreadingFactor - 2);
-    }
-    const int8_t bitsPerCrc = 16;
-    const int8_t N_symbol_header = this->headerType == RADIOLIB_SX126X_LORA_HEADER_EXPLICIT ? 20 : 0;
-
-    // numerator of equation in section 6.1.4 of SX1268 datasheet v1.1 (might not actually be bitcount, but it has len * 8)
-    int16_t bitCount = (int16_t) 8 * len + this->crcTypeLoRa * bitsPerCrc - 4 * this->spreadingFactor  + sfCoeff2 + N_symbol_header;
-    if(bitCount < 0) {
-      bitCount = 0;
-    }
-    // add (sfDivisor) - 1 to the numerator to give integer CEIL(...)
-    uint16_t nPreCodedSymbols = (bitCount + (sfDivisor - 1)) / (sfDivisor);
+    const LoRaAirTimeConfig_t cfg = {
+      this->spreadingFactor,
+      (uint32_t)(this->bandwidthKhz * 1000.0f + 0.5f),
+      (uint8_t)(this->codingRate + 4),
+      this->preambleLengthLoRa,
+      this->headerType != RADIOLIB_SX126X_LORA_HEADER_EXPLICIT,
+      this->crcTypeLoRa == RADIOLIB_SX126X_LORA_CRC_ON,
+      this->ldrOptimize ? (uint8_t)RADIOLIB_AIRTIME_LDRO_ON : (uint8_t)RADIOLIB_AIRTIME_LDRO_OFF,
+      false,
+    };
+    return(RadioLibAirTime::timeOnAirUs(cfg, len));
 
-    // preamble can be 65k, therefore nSymbol_x4 needs to be 32 bit
-    uint32_t nSymbol_x4 = (this->preambleLengthLoRa + 8) * 4 + sfCoeff1_x4 + nPreCodedSymbols * (this->codingRate + 4) * 4;
-
-    return((symbolLength_us * nSymbol_x4) / 4);
- 
   } else if(modem == RADIOLIB_SX126X_PACKET_TYPE_GFSK) {
     return(((uint32_t)len * 8 * this->bitRate) / (RADIOLIB_SX126X_CRYSTAL_FREQ * 32));
   
@@ -1789,6 +1772,68 @@ int16_t SX126x::spectralScanGetResult(uint16_t* results) {
   return(RADIOLIB_ERR_NONE);
 }
 
+int16_t SX126x::spectralScanSweep(float freqStart, float freqStep, uint16_t numSteps, void (*output)(const uint8_t* data, size_t len),
+                                  uint16_t numSweeps, uint16_t numSamples, uint8_t window, uint8_t interval) {
+  if((numSteps == 0) || (output == NULL)) {
+    return(RADIOLIB_ERR_INVALID_FREQUENCY);
+  }
+  float freqEnd = freqStart + freqStep*(numSteps - 1);
+  RADIOLIB_CHECK_RANGE(freqStart, 150.0f, 960.0f, RADIOLIB_ERR_INVALID_FREQUENCY);
+  RADIOLIB_CHECK_RANGE(freqEnd, 150.0f, 960.0f, RADIOLIB_ERR_INVALID_FREQUENCY);
+
+  // calibrate once for the whole range, so that the frequency can be changed without recalibrating
+  int16_t state = standby();
+  RADIOLIB_ASSERT(state);
+  state = calibrateImageRejection(RADIOLIB_MIN(freqStart, freqEnd), RADIOLIB_MAX(freqStart, freqEnd));
+  RADIOLIB_ASSERT(state);
+
+  // each sample takes less than 9 us, leave plenty of margin
+  RadioLibTime_t timeout = (RadioLibTime_t)numSamples*40 + 10000;
+
+  RadioLibScanEncoder encoder;
+  uint8_t record[RADIOLIB_SCAN_STREAM_MAX_RECORD_LEN];
+  uint16_t results[RADIOLIB_SX126X_SPECTRAL_SCAN_RES_SIZE];
+  for(uint16_t i = 0; i < numSweeps; i++) {
+    RadioLibScanSweep_t sweep = {
+      (uint32_t)(freqStart*1000000.0f),
+      (uint32_t)(freqStep*1000000.0f),
+      numSteps,
+      RADIOLIB_SX126X_SPECTRAL_SCAN_RES_SIZE,
+      i,
+      (uint32_t)this->mod->hal->millis(),
+    };
+    output(record, encoder.beginSweep(sweep, record));
+
+    for(uint16_t j = 0; j < numSteps; j++) {
+      // frequency can only be changed in standby
+      state = standby();
+      RADIOLIB_ASSERT(state);
+      state = setFrequencyRaw(freqStart + freqStep*j);
+      RADIOLIB_ASSERT(state);
+      state = spectralScanStart(numSamples, window, interval);
+      RADIOLIB_ASSERT(state);
+
+      // poll without delays, the scan only takes a few milliseconds
+      RadioLibTime_t start = this->mod->hal->micros();
+      while(spectralScanGetStatus() != RADIOLIB_ERR_NONE) {
+        this->mod->hal->yield();
+        if(this->mod->hal->micros() - start > timeout) {
+          spectralScanAbort();
+          standby();
+          return(RADIOLIB_ERR_RX_TIMEOUT);
+        }
+      }
+
+      state = spectralScanGetResult(results);
+      RADIOLIB_ASSERT(state);
+      output(record, encoder.encodeLine(j, results, record));
+    }
+  }
+
+  spectralScanAbort();
+  return(standby());
+}
+
 int16_t SX126x::setTCXO(float voltage, uint32_t delay) {
   // check if TCXO is enabled at all
   if(this->XTAL) {
@@ -10,6 +10,7 @@
 #include "../../protocols/PhysicalLayer/PhysicalLayer.h"
 #include "../../utils/FEC.h"
 #include "../../utils/CRC.h"
+#include "../../utils/ScanStream.h"
 
 // SX126X physical layer properties
 #define RADIOLIB_SX126X_FREQUENCY_STEP_SIZE                     0.9536743164
@@ -1157,6 +1158,24 @@ class SX126x: public PhysicalLayer {
     */
     int16_t spectralScanGetResult(uint16_t* results);
 
+    /*!
+      \brief Sweep spectral scan over a frequency range and stream the results as RadioLibScanEncoder records.
+      Scans are run back-to-back, the next frequency is set as soon as the previous result is read out.
+      Image calibration is only performed once for the whole range. Requires binary patch to be uploaded.
+      \param freqStart Frequency of the first step in MHz.
+      \param freqStep Frequency step in MHz, should be the same as or slightly smaller than the Rx bandwidth.
+      \param numSteps Number of frequency steps in each sweep.
+      \param output Callback that receives every encoded record, for example to write it to a serial port.
+      \param numSweeps Number of sweeps to perform. Defaults to 1.
+      \param numSamples Number of samples for each scan. Fewer samples = better temporal resolution.
+      \param window RSSI averaging window size.
+      \param interval Scan interval length, one of RADIOLIB_SX126X_SCAN_INTERVAL_* macros.
+      \returns \ref status_codes
+    */
+    int16_t spectralScanSweep(float freqStart, float freqStep, uint16_t numSteps, void (*output)(const uint8_t* data, size_t len),
+                              uint16_t numSweeps = 1, uint16_t numSamples = 2048, uint8_t window = RADIOLIB_SX126X_SPECTRAL_SCAN_WINDOW_DEFAULT,
+                              uint8_t interval = RADIOLIB_SX126X_SCAN_INTERVAL_8_20_US);
+
     /*!
       \brief Set the PA configuration. Allows user to optimize PA for a specific output power
       and matching network. Any calls to this method must be done after calling begin/beginFSK and/or setOutputPower.
@@ -1112,44 +1112,30 @@ int16_t SX127x::variablePacketLengthMode(uint8_t maxLen) {
   return(SX127x::setPacketMode(RADIOLIB_SX127X_PACKET_VARIABLE, maxLen));
 }
 
-float SX127x::getNumSymbols(size_t len) {
-  // get symbol length in us
-  float symbolLength = (float) (uint32_t(1) << this->spreadingFactor) / (float) this->bandwidth;
-
-  // get Low Data Rate optimization flag
-  float de = 0;
-  if (symbolLength >= 16.0f) {
-    de = 1;
-  }
-
-  // get explicit/implicit header enabled flag
-  float ih = (float) this->mod->SPIgetRegValue(RADIOLIB_SX127X_REG_MODEM_CONFIG_1, 0, 0);
-  
-  // get CRC enabled flag
-  float crc = (float) (this->mod->SPIgetRegValue(RADIOLIB_SX127X_REG_MODEM_CONFIG_2, 2, 2) >> 2);
-
-  // get number of preamble symbols
-  float n_pre = (float) ((this->mod->SPIgetRegValue(RADIOLIB_SX127X_REG_PREAMBLE_MSB) << 8) | this->mod->SPIgetRegValue(RADIOLIB_SX127X_REG_PREAMBLE_LSB));
-
-  // get number of payload symbols
-  float n_pay = 8.0f + RADIOLIB_MAX(ceilf((8.0f * (float) len - 4.0f * (float) this->spreadingFactor + 28.0f + 16.0f * crc - 20.0f * ih) / (4.0f * (float) this->spreadingFactor - 8.0f * de)) * (float) this->codingRate, 0.0f);
+LoRaAirTimeConfig_t SX127x::getAirTimeConfig() {
+  // SX127x datasheet formula does not have the special SF6 coefficients of the newer chips
+  const LoRaAirTimeConfig_t cfg = {
+    this->spreadingFactor,
+    (uint32_t)(this->bandwidth * 1000.0f + 0.5f),
+    this->codingRate,
+    (uint32_t)((this->mod->SPIgetRegValue(RADIOLIB_SX127X_REG_PREAMBLE_MSB) << 8) | this->mod->SPIgetRegValue(RADIOLIB_SX127X_REG_PREAMBLE_LSB)),
+    this->implicitHdr,
+    this->crcEnabled,
+    RADIOLIB_AIRTIME_LDRO_AUTO,
+    true,
+  };
+  return(cfg);
+}
 
-  // add 4.25 symbols for the sync
-  return(n_pre + n_pay + 4.25f);
+float SX127x::getNumSymbols(size_t len) {
+  return((float)RadioLibAirTime::symbolsX4(getAirTimeConfig(), len) / 4.0f);
 }
 
 RadioLibTime_t SX127x::getTimeOnAir(size_t len) {
   // check active modem
   uint8_t modem = getActiveModem();
   if (modem == RADIOLIB_SX127X_LORA) {
-    // get symbol length in us
-    float symbolLength = (float) (uint32_t(1) << this->spreadingFactor) / (float) this->bandwidth;
-
-    // get number of symbols
-    float n_sym = getNumSymbols(len);
-
-    // get time-on-air in us
-    return ceil((double)symbolLength * (double)n_sym) * 1000;
+    return(RadioLibAirTime::timeOnAirUs(getAirTimeConfig(), len));
 
   } else if(modem == RADIOLIB_SX127X_FSK_OOK) {
     // get number of bits preamble
@@ -1262,6 +1262,7 @@ class SX127x: public PhysicalLayer {
     int16_t setMode(uint8_t mode);
     int16_t setActiveModem(uint8_t modem);
     void clearFIFO(size_t count); // used mostly to clear remaining bytes in FIFO after a packet read
+    LoRaAirTimeConfig_t getAirTimeConfig();
 
     /*!
       \brief Calculate exponent and mantissa values for receiver bandwidth and AFC
@@ -1298,59 +1298,27 @@ RadioLibTime_t SX128x::getTimeOnAir(size_t len) {
   // check active modem
   uint8_t modem = getPacketType();
   if(modem == RADIOLIB_SX128X_PACKET_TYPE_LORA) {
-    // calculate number of symbols
-    float N_symbol = 0;
     uint8_t sf = this->spreadingFactor >> 4;
     if(this->codingRateLoRa <= RADIOLIB_SX128X_LORA_CR_4_8) {
       // legacy coding rate - nice and simple
-
-      // get SF coefficients
-      float coeff1 = 0;
-      int16_t coeff2 = 0;
-      int16_t coeff3 = 0;
-      if(sf < 7) {
-        // SF5, SF6
-        coeff1 = 6.25;
-        coeff2 = 4*sf;
-        coeff3 = 4*sf;
-      } else if(sf < 11) {
-        // SF7. SF8, SF9, SF10
-        coeff1 = 4.25;
-        coeff2 = 4*sf + 8;
-        coeff3 = 4*sf;
-      } else {
-        // SF11, SF12
-        coeff1 = 4.25;
-        coeff2 = 4*sf + 8;
-        coeff3 = 4*(sf - 2);
-      }
-
-      // get CRC length
-      int16_t N_bitCRC = 16;
-      if(this->crcLoRa == RADIOLIB_SX128X_LORA_CRC_OFF) {
-        N_bitCRC = 0;
-      }
-
-      // get header length
-      int16_t N_symbolHeader = 20;
-      if(this->headerType == RADIOLIB_SX128X_LORA_HEADER_IMPLICIT) {
-        N_symbolHeader = 0;
-      }
-
-      // calculate number of LoRa preamble symbols
-      uint32_t N_symbolPreamble = (this->preambleLengthLoRa & 0x0F) * (uint32_t(1) << ((this->preambleLengthLoRa & 0xF0) >> 4));
-
-      // calculate the number of symbols
-      N_symbol = (float)N_symbolPreamble + coeff1 + 8.0f + ceilf((float)RADIOLIB_MAX((int16_t)(8 * len + N_bitCRC - coeff2 + N_symbolHeader), (int16_t)0) / (float)coeff3) * (float)(this->codingRateLoRa + 4);
-
-    } else {
-      // long interleaving - abandon hope all ye who enter here
-      /// \todo implement this mess - SX1280 datasheet v3.0 section 7.4.4.2
+      // SX128x always uses the reduced symbol rate for SF11 and SF12
+      const LoRaAirTimeConfig_t cfg = {
+        sf,
+        (uint32_t)(this->bandwidthKhz * 1000.0f + 0.5f),
+        (uint8_t)(this->codingRateLoRa + 4),
+        (this->preambleLengthLoRa & 0x0F) * (uint32_t(1) << ((this->preambleLengthLoRa & 0xF0) >> 4)),
+        this->headerType == RADIOLIB_SX128X_LORA_HEADER_IMPLICIT,
+        this->crcLoRa != RADIOLIB_SX128X_LORA_CRC_OFF,
+        (sf >= 11) ? (uint8_t)RADIOLIB_AIRTIME_LDRO_ON : (uint8_t)RADIOLIB_AIRTIME_LDRO_OFF,
+        false,
+      };
+      return(RadioLibAirTime::timeOnAirUs(cfg, len));
 
     }
 
-    // get time-on-air in us
-    return(((uint32_t(1) << sf) / this->bandwidthKhz) * N_symbol * 1000.0f);
+    // long interleaving - abandon hope all ye who enter here
+    /// \todo implement this mess - SX1280 datasheet v3.0 section 7.4.4.2
+    return(0);
 
   } else {
     return(((uint32_t)len * 8 * 1000) / this->bitRateKbps);
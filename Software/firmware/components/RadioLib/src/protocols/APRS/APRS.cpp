@@ -47,11 +47,10 @@ int16_t APRSClient::sendPosition(char* destCallsign, uint8_t destSSID, const cha
   if(time != NULL) {
     len += strlen(time);
   }
-  #if !RADIOLIB_STATIC_ONLY
-    char* info = new char[len + 2];
-  #else
-    char info[RADIOLIB_STATIC_ARRAY_SIZE];
-  #endif
+  char info[RADIOLIB_STATIC_ARRAY_SIZE];
+  if(len + 2 > sizeof(info)) {
+    return(RADIOLIB_ERR_PACKET_TOO_LONG);
+  }
 
   // build the info field
   if(msg != NULL) {
@@ -77,11 +76,7 @@ int16_t APRSClient::sendPosition(char* destCallsign, uint8_t destSSID, const cha
   // send the frame
   info[len] = '\0';
   RADIOLIB_DEBUG_PROTOCOL_PRINTLN("APRS Info: %s, length = %d", info, (int)len);
-  int16_t state = sendFrame(destCallsign, destSSID, info);
-  #if !RADIOLIB_STATIC_ONLY
-    delete[] info;
-  #endif
-  return(state);
+  return(sendFrame(destCallsign, destSSID, info));
 }
 
 int16_t APRSClient::sendMicE(float lat, float lon, uint16_t heading, uint16_t speed, uint8_t type, const uint8_t* telem, size_t telemLen, const char* grid, const char* status, int32_t alt) {
@@ -101,25 +96,24 @@ int16_t APRSClient::sendMicE(float lat, float lon, uint16_t heading, uint16_t sp
 
   // prepare buffers
   char destCallsign[7];
-  #if !RADIOLIB_STATIC_ONLY
-    size_t infoLen = 10;
-    if(telemLen > 0) {
-      infoLen += 1 + telemLen;
-    } else {
-      if(grid != NULL) {
-        infoLen += strlen(grid) + 2;
-      }
-      if(status != NULL) {
-        infoLen += strlen(status);
-      }
-      if(alt > RADIOLIB_APRS_MIC_E_ALTITUDE_UNUSED) {
-        infoLen += 4;
-      }
+  size_t infoLen = 10;
+  if(telemLen > 0) {
+    infoLen += 1 + 2*telemLen;
+  } else {
+    if(grid != NULL) {
+      infoLen += strlen(grid) + 2;
+    }
+    if(status != NULL) {
+      infoLen += 1 + strlen(status);
+    }
+    if(alt > RADIOLIB_APRS_MIC_E_ALTITUDE_UNUSED) {
+      infoLen += 4;
     }
-    char* info = new char[infoLen];
-  #else
-    char info[RADIOLIB_STATIC_ARRAY_SIZE];
-  #endif
+  }
+  char info[RADIOLIB_STATIC_ARRAY_SIZE];
+  if(infoLen > sizeof(info)) {
+    return(RADIOLIB_ERR_PACKET_TOO_LONG);
+  }
   size_t infoPos = 0;
 
   // the following is based on APRS Mic-E implementation by https://github.com/omegat
@@ -242,11 +236,7 @@ int16_t APRSClient::sendMicE(float lat, float lon, uint16_t heading, uint16_t sp
     // TODO make SSID configurable?
     destSSID = 1;
   }
-  int16_t state = sendFrame(destCallsign, destSSID, info);
-  #if !RADIOLIB_STATIC_ONLY
-    delete[] info;
-  #endif
-  return(state);
+  return(sendFrame(destCallsign, destSSID, info));
 }
 
 int16_t APRSClient::sendFrame(char* destCallsign, uint8_t destSSID, char* info) {
@@ -256,13 +246,16 @@ int16_t APRSClient::sendFrame(char* destCallsign, uint8_t destSSID, char* info)
     char srcCallsign[RADIOLIB_AX25_MAX_CALLSIGN_LEN + 1];
     axClient->getCallsign(srcCallsign);
 
+    // info field is only referenced, not copied
     AX25Frame frameUI(destCallsign, destSSID, srcCallsign, axClient->getSSID(),
-                      RADIOLIB_AX25_CONTROL_UNNUMBERED_FRAME,
-                      RADIOLIB_AX25_PID_NO_LAYER_3, const_cast<char*>(info));
+                      RADIOLIB_AX25_CONTROL_UNNUMBERED_FRAME);
+    frameUI.protocolID = RADIOLIB_AX25_PID_NO_LAYER_3;
+    int16_t state = frameUI.setInfoRef(reinterpret_cast<const uint8_t*>(info), strlen(info));
+    RADIOLIB_ASSERT(state);
 
     // optionally set repeaters
     if(this->repCalls && this->repSSIDs && this->numReps) {
-      int16_t state = frameUI.setRepeaters(this->repCalls, this->repSSIDs, this->numReps);
+      state = frameUI.setRepeaters(this->repCalls, this->repSSIDs, this->numReps);
       RADIOLIB_ASSERT(state);
     }
 
@@ -271,12 +264,13 @@ int16_t APRSClient::sendFrame(char* destCallsign, uint8_t destSSID, char* info)
   } else if(this->phyLayer != nullptr) {
     // non-AX.25/LoRa mode
     size_t len = RADIOLIB_APRS_LORA_HEADER_LEN + strlen(this->src) + 4 + strlen(destCallsign) + 11 + strlen(info);
-    char* buff = new char[len];
+    char buff[RADIOLIB_STATIC_ARRAY_SIZE];
+    if(len > sizeof(buff)) {
+      return(RADIOLIB_ERR_PACKET_TOO_LONG);
+    }
     snprintf(buff, len, RADIOLIB_APRS_LORA_HEADER "%s-%d>%s,WIDE%d-%d:%s", this->src, this->id, destCallsign, destSSID, destSSID, info);
 
-    int16_t res = this->phyLayer->transmit(reinterpret_cast<uint8_t*>(buff), strlen(buff));
-    delete[] buff;
-    return(res);
+    return(this->phyLayer->transmit(reinterpret_cast<uint8_t*>(buff), strlen(buff)));
   } 
   
   return(RADIOLIB_ERR_WRONG_MODEM);
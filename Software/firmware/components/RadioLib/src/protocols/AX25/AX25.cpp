@@ -0,0 +1,506 @@
+#include "AX25.h"
+
+#include <string.h>
+
+#if !RADIOLIB_EXCLUDE_AX25
+
+AX25Frame::AX25Frame(const char* destCallsign, uint8_t destSSID, const char* srcCallsign, uint8_t srcSSID, uint8_t control)
+: AX25Frame(destCallsign, destSSID, srcCallsign, srcSSID, control, 0, NULL, 0) {
+
+}
+
+AX25Frame::AX25Frame(const char* destCallsign, uint8_t destSSID, const char* srcCallsign, uint8_t srcSSID, uint8_t control, uint8_t protocolID, const char* info)
+  : AX25Frame(destCallsign, destSSID, srcCallsign, srcSSID, control, protocolID, reinterpret_cast<uint8_t*>(const_cast<char*>(info)), strlen(info)) {
+
+}
+
+AX25Frame::AX25Frame(const char* destCallsign, uint8_t destSSID, const char* srcCallsign, uint8_t srcSSID, uint8_t control, uint8_t protocolID, const uint8_t* info, uint16_t infoLen) {
+  // destination callsign/SSID
+  memcpy(this->destCallsign, destCallsign, strlen(destCallsign));
+  this->destCallsign[strlen(destCallsign)] = '\0';
+  this->destSSID = destSSID;
+
+  // source callsign/SSID
+  memcpy(this->srcCallsign, srcCallsign, strlen(srcCallsign));
+  this->srcCallsign[strlen(srcCallsign)] = '\0';
+  this->srcSSID = srcSSID;
+
+  // set repeaters
+  this->numRepeaters = 0;
+
+  // control field
+  this->control = control;
+
+  // sequence numbers
+  this->rcvSeqNumber = 0;
+  this->sendSeqNumber = 0;
+
+  // PID field
+  this->protocolID = protocolID;
+
+  // info field
+  this->infoLen = infoLen;
+  if(infoLen > 0) {
+    #if !RADIOLIB_STATIC_ONLY
+      this->info = new uint8_t[infoLen];
+      this->infoOwned = true;
+    #endif
+    memcpy(this->info, info, infoLen);
+  }
+}
+
+AX25Frame::AX25Frame(const AX25Frame& frame)
+  : destSSID(frame.destSSID),
+    srcSSID(frame.srcSSID), 
+    numRepeaters(frame.numRepeaters),
+    control(frame.control),
+    protocolID(frame.protocolID),
+    infoLen(frame.infoLen),
+    rcvSeqNumber(frame.rcvSeqNumber),
+    sendSeqNumber(frame.sendSeqNumber) {
+  strncpy(this->destCallsign, frame.destCallsign, RADIOLIB_AX25_MAX_CALLSIGN_LEN + 1);
+  strncpy(this->srcCallsign, frame.srcCallsign, RADIOLIB_AX25_MAX_CALLSIGN_LEN + 1);
+
+  if(frame.infoLen) {
+    #if !RADIOLIB_STATIC_ONLY
+      this->info = new uint8_t[frame.infoLen];
+      this->infoOwned = true;
+    #endif
+    memcpy(this->info, frame.info, frame.infoLen);
+  }
+
+  memcpy(this->repeaterCallsigns, frame.repeaterCallsigns, sizeof(this->repeaterCallsigns));
+  memcpy(this->repeaterSSIDs, frame.repeaterSSIDs, sizeof(this->repeaterSSIDs));
+}
+
+AX25Frame::~AX25Frame() {
+  #if !RADIOLIB_STATIC_ONLY
+    freeInfo();
+  #endif
+}
+
+AX25Frame& AX25Frame::operator=(const AX25Frame& frame) {
+  if(&frame == this) {
+    return(*this);
+  }
+
+  // destination callsign/SSID
+  memcpy(this->destCallsign, frame.destCallsign, strlen(frame.destCallsign));
+  this->destCallsign[strlen(frame.destCallsign)] = '\0';
+  this->destSSID = frame.destSSID;
+
+  // source callsign/SSID
+  memcpy(this->srcCallsign, frame.srcCallsign, strlen(frame.srcCallsign));
+  this->srcCallsign[strlen(frame.srcCallsign)] = '\0';
+  this->srcSSID = frame.srcSSID;
+
+  // repeaters
+  this->numRepeaters = frame.numRepeaters;
+  memcpy(this->repeaterCallsigns, frame.repeaterCallsigns, sizeof(this->repeaterCallsigns));
+  memcpy(this->repeaterSSIDs, frame.repeaterSSIDs, sizeof(this->repeaterSSIDs));
+
+  // control field
+  this->control = frame.control;
+
+  // sequence numbers
+  this->rcvSeqNumber = frame.rcvSeqNumber;
+  this->sendSeqNumber = frame.sendSeqNumber;
+
+  // PID field
+  this->protocolID = frame.protocolID;
+
+  // info field, the assigned frame always gets its own copy
+  #if !RADIOLIB_STATIC_ONLY
+    freeInfo();
+    if(frame.infoLen > 0) {
+      this->info = new uint8_t[frame.infoLen];
+      this->infoOwned = true;
+    }
+  #endif
+  this->infoLen = frame.infoLen;
+  memcpy(this->info, frame.info, this->infoLen);
+
+  return(*this);
+}
+
+int16_t AX25Frame::setRepeaters(char** repeaterCallsigns, const uint8_t* repeaterSSIDs, uint8_t numRepeaters) {
+  // check number of repeaters
+  if((numRepeaters < 1) || (numRepeaters > RADIOLIB_AX25_MAX_REPEATERS)) {
+    return(RADIOLIB_ERR_INVALID_NUM_REPEATERS);
+  }
+
+  // check repeater configuration
+  if((repeaterCallsigns == NULL) || (repeaterSSIDs == NULL)) {
+    return(RADIOLIB_ERR_INVALID_NUM_REPEATERS);
+  }
+  for(uint16_t i = 0; i < numRepeaters; i++) {
+    if(strlen(repeaterCallsigns[i]) > RADIOLIB_AX25_MAX_CALLSIGN_LEN) {
+      return(RADIOLIB_ERR_INVALID_REPEATER_CALLSIGN);
+    }
+  }
+
+  // copy data
+  this->numRepeaters = numRepeaters;
+  for(uint8_t i = 0; i < numRepeaters; i++) {
+    memcpy(this->repeaterCallsigns[i], repeaterCallsigns[i], strlen(repeaterCallsigns[i]));
+    this->repeaterCallsigns[i][strlen(repeaterCallsigns[i])] = '\0';
+  }
+  memcpy(this->repeaterSSIDs, repeaterSSIDs, numRepeaters);
+
+  return(RADIOLIB_ERR_NONE);
+}
+
+int16_t AX25Frame::setInfo(const uint8_t* info, uint16_t infoLen) {
+  #if !RADIOLIB_STATIC_ONLY
+    freeInfo();
+    if(infoLen > 0) {
+      this->info = new uint8_t[infoLen];
+      this->infoOwned = true;
+    }
+  #else
+    if(infoLen > RADIOLIB_STATIC_ARRAY_SIZE) {
+      return(RADIOLIB_ERR_PACKET_TOO_LONG);
+    }
+  #endif
+  memcpy(this->info, info, infoLen);
+  this->infoLen = infoLen;
+  return(RADIOLIB_ERR_NONE);
+}
+
+int16_t AX25Frame::setInfoRef(const uint8_t* info, uint16_t infoLen) {
+  #if !RADIOLIB_STATIC_ONLY
+    // only keep a reference to the user buffer, the frame never writes through it
+    freeInfo();
+    this->info = const_cast<uint8_t*>(info);
+    this->infoLen = infoLen;
+    return(RADIOLIB_ERR_NONE);
+  #else
+    return(setInfo(info, infoLen));
+  #endif
+}
+
+#if !RADIOLIB_STATIC_ONLY
+void AX25Frame::freeInfo() {
+  if(this->infoOwned) {
+    delete[] this->info;
+    this->infoOwned = false;
+  }
+  this->info = NULL;
+  this->infoLen = 0;
+}
+#endif
+
+void AX25Frame::setRecvSequence(uint8_t seqNumber) {
+  this->rcvSeqNumber = seqNumber;
+}
+
+void AX25Frame::setSendSequence(uint8_t seqNumber) {
+  this->sendSeqNumber = seqNumber;
+}
+
+AX25Client::AX25Client(PhysicalLayer* phy) {
+  phyLayer = phy;
+  #if !RADIOLIB_EXCLUDE_AFSK
+  audio = nullptr;
+  bellModem = nullptr;
+  #endif
+}
+
+#if !RADIOLIB_EXCLUDE_AFSK
+AX25Client::AX25Client(AFSKClient* aud)
+  : audio(aud) {
+  phyLayer = this->audio->phyLayer;
+  bellModem = new BellClient(this->audio);
+  bellModem->setModem(Bell202);
+}
+
+AX25Client::AX25Client(const AX25Client& ax25)
+  : phyLayer(ax25.phyLayer),
+    sourceSSID(ax25.sourceSSID),
+    preambleLen(ax25.preambleLen) {
+  strncpy(sourceCallsign, ax25.sourceCallsign, RADIOLIB_AX25_MAX_CALLSIGN_LEN + 1);
+  #if !RADIOLIB_EXCLUDE_AFSK
+  if(ax25.bellModem) {
+    this->audio = ax25.audio;
+    this->bellModem = new BellClient(ax25.audio);
+  }
+  #endif
+}
+
+AX25Client& AX25Client::operator=(const AX25Client& ax25) {
+  if(&ax25 != this) {
+    this->phyLayer = ax25.phyLayer;
+    this->sourceSSID = ax25.sourceSSID;
+    this->preambleLen = ax25.preambleLen;
+    strncpy(sourceCallsign, ax25.sourceCallsign, RADIOLIB_AX25_MAX_CALLSIGN_LEN + 1);
+    #if !RADIOLIB_EXCLUDE_AFSK
+    if(ax25.bellModem) {
+      this->audio = ax25.audio;
+      this->bellModem = new BellClient(ax25.audio);
+    }
+    #endif
+  }
+  return(*this);
+}
+
+int16_t AX25Client::setCorrection(int16_t mark, int16_t space, float length) {
+  BellModem_t modem;
+  modem.freqMark = Bell202.freqMark + mark;
+  modem.freqSpace = Bell202.freqSpace + space;
+  modem.freqMarkReply = modem.freqMark;
+  modem.freqSpaceReply = modem.freqSpace;
+  modem.baudRate = length*(float)Bell202.baudRate;
+  bellModem->setModem(modem);
+  return(RADIOLIB_ERR_NONE);
+}
+#endif
+
+int16_t AX25Client::begin(const char* srcCallsign, uint8_t srcSSID, uint8_t preLen) {
+  // set source SSID
+  sourceSSID = srcSSID;
+
+  // check source callsign length (6 characters max)
+  if(strlen(srcCallsign) > RADIOLIB_AX25_MAX_CALLSIGN_LEN) {
+    return(RADIOLIB_ERR_INVALID_CALLSIGN);
+  }
+
+  // copy callsign
+  memcpy(sourceCallsign, srcCallsign, strlen(srcCallsign));
+  sourceCallsign[strlen(srcCallsign)] = '\0';
+
+  // save preamble length
+  preambleLen = preLen;
+
+  // configure for direct mode
+  return(phyLayer->startDirect());
+}
+
+#if defined(RADIOLIB_BUILD_ARDUINO)
+int16_t AX25Client::transmit(String& str, const char* destCallsign, uint8_t destSSID) {
+  return(transmit(str.c_str(), destCallsign, destSSID));
+}
+#endif
+
+int16_t AX25Client::transmit(const char* str, const char* destCallsign, uint8_t destSSID) {
+  // create control field
+  uint8_t controlField = RADIOLIB_AX25_CONTROL_UNNUMBERED_FRAME;
+
+  // build the frame, info field is not copied
+  AX25Frame frame(destCallsign, destSSID, sourceCallsign, sourceSSID, controlField);
+  frame.protocolID = RADIOLIB_AX25_PID_NO_LAYER_3;
+  int16_t state = frame.setInfoRef(reinterpret_cast<const uint8_t*>(str), strlen(str));
+  RADIOLIB_ASSERT(state);
+
+  // send Unnumbered Information frame
+  return(sendFrame(&frame));
+}
+
+int16_t AX25Client::sendFrame(AX25Frame* frame) {
+  // use the user buffer if there is one
+  if(this->frameBuff != NULL) {
+    return(sendFrame(frame, this->frameBuff, this->frameBuffLen));
+  }
+  uint8_t buff[RADIOLIB_AX25_FRAME_BUFF_LEN];
+  return(sendFrame(frame, buff, sizeof(buff)));
+}
+
+int16_t AX25Client::sendFrame(AX25Frame* frame, uint8_t* buff, size_t buffLen) {
+  size_t len = 0;
+  int16_t state = encodeFrame(frame, buff, buffLen, &len);
+  RADIOLIB_ASSERT(state);
+
+  // transmit
+  #if !RADIOLIB_EXCLUDE_AFSK
+  if(bellModem != nullptr) {
+    bellModem->idle();
+
+    // iterate over all bytes in the buffer
+    for(uint32_t i = 0; i < len; i++) {
+      bellModem->write(buff[i]);
+    }
+
+    bellModem->standby();
+
+  } else {
+  #endif
+    state = phyLayer->transmit(buff, len);
+  #if !RADIOLIB_EXCLUDE_AFSK
+  }
+  #endif
+
+  return(state);
+}
+
+void AX25Client::setFrameBuffer(uint8_t* buff, size_t len) {
+  this->frameBuff = buff;
+  this->frameBuffLen = buff ? len : 0;
+}
+
+// encoder state - every bit goes through FCS, bit stuffing and NRZI as soon as it is added,
+// so the frame is never assembled in an intermediate buffer
+struct AX25Encoder {
+  uint8_t* buff;
+  size_t buffLen;
+  size_t pos;
+  uint32_t bitPos;
+  uint32_t nrziStart;
+  uint8_t acc;
+  uint8_t prev;
+  uint8_t ones;
+  uint16_t fcs;
+};
+
+// add bit to the output, NRZI is applied from bit nrziStart onwards
+static void ax25PutLineBit(AX25Encoder* enc, uint8_t bit) {
+  if(enc->bitPos >= enc->nrziStart) {
+    // 1 keeps the previous level, 0 is a transition
+    bit = bit ? enc->prev : !enc->prev;
+  }
+  enc->prev = bit;
+  enc->acc = (enc->acc << 1) | bit;
+  enc->bitPos++;
+  if((enc->bitPos % 8) == 0) {
+    // keep counting on overflow, so the required length is known
+    if(enc->pos < enc->buffLen) {
+      enc->buff[enc->pos] = enc->acc;
+    }
+    enc->pos++;
+  }
+}
+
+// add flag, not stuffed
+static void ax25PutFlag(AX25Encoder* enc) {
+  for(int8_t shift = 7; shift >= 0; shift--) {
+    ax25PutLineBit(enc, (RADIOLIB_AX25_FLAG >> shift) & 0x01);
+  }
+}
+
+// add bit of the frame body, with a zero inserted after 5 consecutive ones
+static void ax25PutStuffedBit(AX25Encoder* enc, uint8_t bit) {
+  ax25PutLineBit(enc, bit);
+  if(!bit) {
+    enc->ones = 0;
+  } else if(++enc->ones == 5) {
+    ax25PutLineBit(enc, 0);
+    enc->ones = 0;
+  }
+}
+
+// add byte of the frame body, least significant bit first, and update FCS
+static void ax25PutByte(AX25Encoder* enc, uint8_t b) {
+  for(uint8_t i = 0; i < 8; i++) {
+    uint8_t bit = (b >> i) & 0x01;
+    uint16_t msb = (enc->fcs >> 15) ^ bit;
+    enc->fcs <<= 1;
+    if(msb) {
+      enc->fcs ^= RADIOLIB_CRC_CCITT_POLY;
+    }
+    ax25PutStuffedBit(enc, bit);
+  }
+}
+
+// add address field - callsign padded by spaces and shifted by one bit to make room for HDLC address extension bit
+static void ax25PutAddress(AX25Encoder* enc, const char* callsign, uint8_t ssid) {
+  size_t len = strlen(callsign);
+  for(size_t i = 0; i < RADIOLIB_AX25_MAX_CALLSIGN_LEN; i++) {
+    ax25PutByte(enc, (i < len ? callsign[i] : ' ') << 1);
+  }
+  ax25PutByte(enc, ssid);
+}
+
+int16_t AX25Client::encodeFrame(const AX25Frame* frame, uint8_t* buff, size_t buffLen, size_t* len) {
+  // check destination callsign length (6 characters max)
+  if(strlen(frame->destCallsign) > RADIOLIB_AX25_MAX_CALLSIGN_LEN) {
+    return(RADIOLIB_ERR_INVALID_CALLSIGN);
+  }
+
+  // check repeater configuration
+  if(frame->numRepeaters > RADIOLIB_AX25_MAX_REPEATERS) {
+    return(RADIOLIB_ERR_INVALID_NUM_REPEATERS);
+  }
+  for(uint16_t i = 0; i < frame->numRepeaters; i++) {
+    if(strlen(frame->repeaterCallsigns[i]) > RADIOLIB_AX25_MAX_CALLSIGN_LEN) {
+      return(RADIOLIB_ERR_INVALID_REPEATER_CALLSIGN);
+    }
+  }
+
+  AX25Encoder enc;
+  enc.buff = buff;
+  enc.buffLen = buffLen;
+  enc.pos = 0;
+  enc.bitPos = 0;
+  // NRZI has always started this many bits into the preamble, kept to produce identical output
+  enc.nrziStart = this->preambleLen + 1;
+  enc.acc = 0;
+  enc.prev = 0;
+  enc.ones = 0;
+  enc.fcs = RADIOLIB_CRC_CCITT_INIT;
+
+  // preamble and start flag
+  for(uint16_t i = 0; i < this->preambleLen + 1; i++) {
+    ax25PutFlag(&enc);
+  }
+
+  // destination and source, HDLC extension end bit is set in the last address
+  uint8_t last = (frame->numRepeaters == 0) ? RADIOLIB_AX25_SSID_HDLC_EXTENSION_END : RADIOLIB_AX25_SSID_HDLC_EXTENSION_CONTINUE;
+  ax25PutAddress(&enc, frame->destCallsign, RADIOLIB_AX25_SSID_RESPONSE_DEST | RADIOLIB_AX25_SSID_RESERVED_BITS | (frame->destSSID & 0x0F) << 1 | RADIOLIB_AX25_SSID_HDLC_EXTENSION_CONTINUE);
+  ax25PutAddress(&enc, frame->srcCallsign, RADIOLIB_AX25_SSID_COMMAND_SOURCE | RADIOLIB_AX25_SSID_RESERVED_BITS | (frame->srcSSID & 0x0F) << 1 | last);
+
+  // repeater callsigns
+  for(uint16_t i = 0; i < frame->numRepeaters; i++) {
+    last = (i == frame->numRepeaters - 1) ? RADIOLIB_AX25_SSID_HDLC_EXTENSION_END : RADIOLIB_AX25_SSID_HDLC_EXTENSION_CONTINUE;
+    ax25PutAddress(&enc, frame->repeaterCallsigns[i], RADIOLIB_AX25_SSID_HAS_NOT_BEEN_REPEATED | RADIOLIB_AX25_SSID_RESERVED_BITS | (frame->repeaterSSIDs[i] & 0x0F) << 1 | last);
+  }
+
+  // set sequence numbers of the frames that have it
+  uint8_t controlField = frame->control;
+  if((frame->control & 0x01) == 0) {
+    // information frame, set both sequence numbers
+    controlField |= frame->rcvSeqNumber << 5;
+    controlField |= frame->sendSeqNumber << 1;
+  } else if((frame->control & 0x02) == 0) {
+    // supervisory frame, set only receive sequence number
+    controlField |= frame->rcvSeqNumber << 5;
+  }
+
+  // set control field
+  ax25PutByte(&enc, controlField);
+
+  // set PID field of the frames that have it
+  if(frame->protocolID != 0x00) {
+    ax25PutByte(&enc, frame->protocolID);
+  }
+
+  // set info field of the frames that have it
+  for(uint16_t i = 0; i < frame->infoLen; i++) {
+    ax25PutByte(&enc, frame->info[i]);
+  }
+
+  // frame check sequence, most significant bit first
+  uint16_t fcs = enc.fcs ^ RADIOLIB_CRC_CCITT_OUT;
+  for(int8_t shift = 15; shift >= 0; shift--) {
+    ax25PutStuffedBit(&enc, (fcs >> shift) & 0x01);
+  }
+
+  // end flag, padded to full bytes
+  ax25PutFlag(&enc);
+  while(enc.bitPos % 8) {
+    ax25PutLineBit(&enc, 0);
+  }
+
+  *len = enc.pos;
+  if(enc.pos > buffLen) {
+    return(RADIOLIB_ERR_PACKET_TOO_LONG);
+  }
+  return(RADIOLIB_ERR_NONE);
+}
+
+void AX25Client::getCallsign(char* buff) {
+  strncpy(buff, sourceCallsign, RADIOLIB_AX25_MAX_CALLSIGN_LEN + 1);
+}
+
+uint8_t AX25Client::getSSID() {
+  return(sourceSSID);
+}
+
+#endif
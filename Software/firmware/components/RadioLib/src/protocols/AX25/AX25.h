@@ -14,6 +14,14 @@
 // maximum callsign length in bytes
 #define RADIOLIB_AX25_MAX_CALLSIGN_LEN                          6
 
+// maximum number of repeaters
+#define RADIOLIB_AX25_MAX_REPEATERS                             8
+
+// size of the on-stack buffer used when no frame buffer was set by the user
+#if !defined(RADIOLIB_AX25_FRAME_BUFF_LEN)
+  #define RADIOLIB_AX25_FRAME_BUFF_LEN                          (2*RADIOLIB_STATIC_ARRAY_SIZE)
+#endif
+
 // flag field                                                                 MSB   LSB   DESCRIPTION
 #define RADIOLIB_AX25_FLAG                                      0b01111110  //  7     0     AX.25 frame start/end flag
 
@@ -124,33 +132,23 @@ class AX25Frame {
       /*!
         \brief The info field.
       */
-      uint8_t* info;
-
-      /*!
-        \brief Array of repeater callsigns.
-      */
-      char** repeaterCallsigns;
-
-      /*!
-        \brief Array of repeater SSIDs.
-      */
-      uint8_t* repeaterSSIDs;
+      uint8_t* info = NULL;
     #else
       /*!
         \brief The info field.
       */
       uint8_t info[RADIOLIB_STATIC_ARRAY_SIZE];
+    #endif
 
-      /*!
-        \brief Array of repeater callsigns.
-      */
-      char repeaterCallsigns[8][RADIOLIB_AX25_MAX_CALLSIGN_LEN + 1];
+    /*!
+      \brief Array of repeater callsigns.
+    */
+    char repeaterCallsigns[RADIOLIB_AX25_MAX_REPEATERS][RADIOLIB_AX25_MAX_CALLSIGN_LEN + 1];
 
-      /*!
-        \brief Array of repeater SSIDs.
-      */
-      uint8_t repeaterSSIDs[8];
-    #endif
+    /*!
+      \brief Array of repeater SSIDs.
+    */
+    uint8_t repeaterSSIDs[RADIOLIB_AX25_MAX_REPEATERS];
 
     /*!
       \brief Overloaded constructor, for frames without info field.
@@ -213,6 +211,26 @@ class AX25Frame {
     */
     int16_t setRepeaters(char** repeaterCallsigns, const uint8_t* repeaterSSIDs, uint8_t numRepeaters);
 
+    /*!
+      \brief Method to set the info field. The info field is copied into the frame.
+      \param info Information field, in the form of arbitrary binary buffer.
+      \param infoLen Number of bytes in the information field.
+      \returns \ref status_codes
+    */
+    int16_t setInfo(const uint8_t* info, uint16_t infoLen);
+
+    /*!
+      \brief Method to set the info field without copying it. The frame only keeps the pointer, so the buffer
+      must stay valid and unchanged until the frame has been sent or encoded for the last time, the info field
+      is set again or the frame is destroyed. The frame never writes to the buffer. Copies and assignments of
+      the frame get their own copy of the info field.
+      When static only mode is enabled, the info field is copied into the frame instead.
+      \param info Information field, in the form of arbitrary binary buffer.
+      \param infoLen Number of bytes in the information field.
+      \returns \ref status_codes
+    */
+    int16_t setInfoRef(const uint8_t* info, uint16_t infoLen);
+
     /*!
       \brief Method to set receive sequence number.
       \param seqNumber Sequence number to set, 0 to 7.
@@ -224,6 +242,14 @@ class AX25Frame {
       \param seqNumber Sequence number to set, 0 to 7.
     */
     void setSendSequence(uint8_t seqNumber);
+
+#if !RADIOLIB_GODMODE
+  private:
+#endif
+    #if !RADIOLIB_STATIC_ONLY
+    bool infoOwned = false;
+    void freeInfo();
+    #endif
 };
 
 /*!
@@ -310,6 +336,24 @@ class AX25Client {
     */
     int16_t sendFrame(AX25Frame* frame);
 
+    /*!
+      \brief Set buffer used to assemble frames for transmission. Frames are never assembled on the heap;
+      when no buffer is set, a stack buffer of RADIOLIB_AX25_FRAME_BUFF_LEN bytes is used instead.
+      \param buff Frame buffer, or NULL to go back to the stack buffer.
+      \param len Size of the frame buffer in bytes.
+    */
+    void setFrameBuffer(uint8_t* buff, size_t len);
+
+    /*!
+      \brief Encode frame into the transmitted form (preamble, flags, bit stuffing, FCS and NRZI) in a single pass.
+      \param frame Frame to encode.
+      \param buff Output buffer.
+      \param buffLen Size of the output buffer in bytes.
+      \param len Pointer to variable that will hold the number of encoded bytes.
+      \returns \ref status_codes
+    */
+    int16_t encodeFrame(const AX25Frame* frame, uint8_t* buff, size_t buffLen, size_t* len);
+
 #if !RADIOLIB_GODMODE
   private:
 #endif
@@ -324,7 +368,10 @@ class AX25Client {
     char sourceCallsign[RADIOLIB_AX25_MAX_CALLSIGN_LEN + 1] = { 0 };
     uint8_t sourceSSID = 0;
     uint16_t preambleLen = 0;
+    uint8_t* frameBuff = NULL;
+    size_t frameBuffLen = 0;
 
+    int16_t sendFrame(AX25Frame* frame, uint8_t* buff, size_t buffLen);
     void getCallsign(char* buff);
     uint8_t getSSID();
 };
@@ -3593,13 +3593,7 @@ bool LoRaWANNode::verifyMIC(uint8_t* msg, size_t len, uint8_t* key) {
 // given an airtime in milliseconds, calculate the minimum uplink interval
 // to adhere to a given dutyCycle
 RadioLibTime_t LoRaWANNode::dutyCycleInterval(RadioLibTime_t msPerHour, RadioLibTime_t airtime) {
-  if(msPerHour == 0 || airtime == 0) {
-    return(0);
-  }
-  RadioLibTime_t oneHourInMs = (RadioLibTime_t)60 * (RadioLibTime_t)60 * (RadioLibTime_t)1000;
-  float numPackets = msPerHour / airtime;
-  RadioLibTime_t delayMs = oneHourInMs / numPackets + 1;  // + 1 to prevent rounding problems
-  return(delayMs);
+  return(RadioLibAirTime::dutyCycleIntervalMs(msPerHour, airtime));
 }
 
 RadioLibTime_t LoRaWANNode::timeUntilUplink() {
@@ -346,7 +346,7 @@ int16_t PagerClient::readData(uint8_t* data, size_t* len, uint32_t* addr) {
   bool match = false;
   uint8_t framePos = 0;
   uint8_t symbolLength = 0;
-  while(!match && phyLayer->available()) {
+  while(!match && (phyLayer->available() >= (int16_t)sizeof(uint32_t))) {
     uint32_t cw = read();
     framePos++;
 
@@ -394,7 +394,7 @@ int16_t PagerClient::readData(uint8_t* data, size_t* len, uint32_t* addr) {
   uint32_t prevCw = 0;
   bool overflow = false;
   int8_t ovfBits = 0;
-  while(phyLayer->available()) {
+  while(phyLayer->available() >= (int16_t)sizeof(uint32_t)) {
     uint32_t cw = read();
 
     // check if it's the idle code word
@@ -533,11 +533,9 @@ void PagerClient::write(uint32_t codeWord) {
 
 #if !RADIOLIB_EXCLUDE_DIRECT_RECEIVE
 uint32_t PagerClient::read() {
-  uint32_t codeWord = 0;
-  codeWord |= (uint32_t)phyLayer->read() << 24;
-  codeWord |= (uint32_t)phyLayer->read() << 16;
-  codeWord |= (uint32_t)phyLayer->read() << 8;
-  codeWord |= (uint32_t)phyLayer->read();
+  uint8_t buff[sizeof(uint32_t)] = { 0 };
+  phyLayer->read(buff, sizeof(buff));
+  uint32_t codeWord = ((uint32_t)buff[0] << 24) | ((uint32_t)buff[1] << 16) | ((uint32_t)buff[2] << 8) | (uint32_t)buff[3];
 
   // check if we need to invert bits
   // the logic here is inverted, because modules like SX1278
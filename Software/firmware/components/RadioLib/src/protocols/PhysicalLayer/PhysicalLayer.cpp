@@ -5,10 +5,6 @@
 PhysicalLayer::PhysicalLayer() {
   this->freqStep = 1;
   this->maxPacketLength = 1;
-  #if !RADIOLIB_EXCLUDE_DIRECT_RECEIVE
-  this->bufferBitPos = 0;
-  this->bufferWritePos = 0;
-  #endif
 }
 
 #if defined(RADIOLIB_BUILD_ARDUINO)
@@ -428,13 +424,13 @@ int16_t PhysicalLayer::startDirect() {
 
 #if !RADIOLIB_EXCLUDE_DIRECT_RECEIVE
 int16_t PhysicalLayer::available() {
-  return(this->bufferWritePos);
+  return(this->directBuffer.available());
 }
 
 void PhysicalLayer::dropSync() {
+  // sync state belongs to the interrupt, it is reset there on the next bit
   if(this->directSyncWordLen > 0) {
-    this->gotSync = false;
-    this->syncBuffer = 0;
+    RADIOLIB_RING_STORE(this->syncDropRequest, 1);
   }
 }
 
@@ -442,8 +438,18 @@ uint8_t PhysicalLayer::read(bool drop) {
   if(drop) {
     dropSync();
   }
-  this->bufferWritePos--;
-  return(this->buffer[this->bufferReadPos++]);
+  return(this->directBuffer.read());
+}
+
+size_t PhysicalLayer::read(uint8_t* data, size_t len, bool drop) {
+  if(drop) {
+    dropSync();
+  }
+  return(this->directBuffer.read(data, len));
+}
+
+uint32_t PhysicalLayer::getDirectDropped() const {
+  return(this->directBuffer.getDropped());
 }
 
 int16_t PhysicalLayer::setDirectSyncWord(uint32_t syncWord, uint8_t len) {
@@ -463,6 +469,13 @@ int16_t PhysicalLayer::setDirectSyncWord(uint32_t syncWord, uint8_t len) {
 }
 
 void PhysicalLayer::updateDirectBuffer(uint8_t bit) {
+  // handle sync drop requested by the main loop
+  if(RADIOLIB_RING_LOAD(this->syncDropRequest)) {
+    RADIOLIB_RING_STORE(this->syncDropRequest, 0);
+    this->gotSync = false;
+    this->syncBuffer = 0;
+  }
+
   // check sync word
   if(!this->gotSync) {
     this->syncBuffer <<= 1;
@@ -471,29 +484,14 @@ void PhysicalLayer::updateDirectBuffer(uint8_t bit) {
     RADIOLIB_DEBUG_PROTOCOL_PRINTLN("S\t%lu", (long unsigned int)this->syncBuffer);
 
     if((this->syncBuffer & this->directSyncWordMask) == this->directSyncWord) {
+      // data that was not read yet is kept, only the byte boundary is moved to the end of the sync word
       this->gotSync = true;
-      this->bufferWritePos = 0;
-      this->bufferReadPos = 0;
-      this->bufferBitPos = 0;
+      this->directBuffer.alignBits();
     }
 
   } else {
-    // save the bit
-    if(bit) {
-      this->buffer[this->bufferWritePos] |= 0x01 << this->bufferBitPos;
-    } else {
-      this->buffer[this->bufferWritePos] &= ~(0x01 << this->bufferBitPos);
-    }
-    this->bufferBitPos++;
-
-    // check complete byte
-    if(this->bufferBitPos == 8) {
-      this->buffer[this->bufferWritePos] = rlb_reflect(this->buffer[this->bufferWritePos], 8);
-      RADIOLIB_DEBUG_PROTOCOL_PRINTLN("R\t%X", this->buffer[this->bufferWritePos]);
-
-      this->bufferWritePos++;
-      this->bufferBitPos = 0;
-    }
+    // save the bit, complete bytes are published to the main loop
+    this->directBuffer.pushBit(bit);
   }
 }
 
@@ -3,6 +3,8 @@
 
 #include "../../TypeDef.h"
 #include "../../Module.h"
+#include "../../utils/AirTime.h"
+#include "../../utils/BitRing.h"
 
 // common IRQ values - the IRQ flags in RadioLibIrqFlags_t arguments are offset by this value
 enum RadioLibIrqType_t {
@@ -671,9 +673,25 @@ class PhysicalLayer {
       \brief Get data from direct mode buffer.
       \param drop Drop synchronization on read - next reading will require waiting for the sync word again.
       Defaults to true.
-      \returns Byte from direct mode buffer.
+      \returns Byte from direct mode buffer, 0 if the buffer is empty.
     */
     uint8_t read(bool drop = true);
+
+    /*!
+      \brief Get multiple bytes from direct mode buffer at once.
+      \param data Buffer to copy the bytes to.
+      \param len Maximum number of bytes to read.
+      \param drop Drop synchronization on read - next reading will require waiting for the sync word again.
+      Defaults to true.
+      \returns Number of bytes actually read.
+    */
+    size_t read(uint8_t* data, size_t len, bool drop = true);
+
+    /*!
+      \brief Get the number of direct mode bytes dropped because they were not read in time.
+      \returns Number of dropped bytes.
+    */
+    uint32_t getDirectDropped() const;
     #endif
 
     /*!
@@ -778,15 +796,15 @@ class PhysicalLayer {
 #endif
 
     #if !RADIOLIB_EXCLUDE_DIRECT_RECEIVE
-    uint8_t bufferBitPos = 0;
-    uint8_t bufferWritePos = 0;
-    uint8_t bufferReadPos = 0;
-    uint8_t buffer[RADIOLIB_STATIC_ARRAY_SIZE] = { 0 };
+    // the interrupt is the only writer of the ring and the sync state,
+    // the main loop asks for sync to be dropped through syncDropRequest
+    RadioLibBitRing directBuffer;
     uint32_t syncBuffer = 0;
     uint32_t directSyncWord = 0;
     uint8_t directSyncWordLen = 0;
     uint32_t directSyncWordMask = 0;
     bool gotSync = false;
+    uint8_t syncDropRequest = 0;
     #endif
 
     virtual Module* getMod() = 0;
@@ -215,12 +215,22 @@ int16_t SSTVClient::begin(const SSTVMode_t& mode) {
 #endif
 
 int16_t SSTVClient::begin(float base, const SSTVMode_t& mode) {
+  // check the line fits into the buffer
+  if(mode.width > RADIOLIB_SSTV_MAX_WIDTH) {
+    return(RADIOLIB_ERR_UNSUPPORTED);
+  }
+
   // save mode
   txMode = mode;
 
   // calculate 24-bit frequency
   baseFreq = (base * 1000000.0f) / phyLayer->freqStep;
 
+  // precalculate frequency of all brightness levels, so that no floating point math is needed while sending
+  for(uint16_t i = 0; i < RADIOLIB_SSTV_NUM_LEVELS; i++) {
+    levelWords[i] = getWord(RADIOLIB_SSTV_TONE_BRIGHTNESS_MIN + ((float)i * 3.1372549f));
+  }
+
   // configure for direct mode
   return(phyLayer->startDirect());
 }
@@ -241,6 +251,7 @@ int16_t SSTVClient::setCorrection(float correction) {
 
 void SSTVClient::idle() {
   phyLayer->transmitDirect();
+  this->restartTiming();
   this->tone(RADIOLIB_SSTV_TONE_LEADER);
 }
 
@@ -248,6 +259,7 @@ void SSTVClient::sendHeader() {
   // reset line counter
   lineCount = 0;
   phyLayer->transmitDirect();
+  this->restartTiming();
 
   // send the first part of header (leader-break-leader)
   this->tone(RADIOLIB_SSTV_TONE_LEADER, RADIOLIB_SSTV_HEADER_LEADER_LENGTH);
@@ -282,6 +294,12 @@ void SSTVClient::sendHeader() {
 }
 
 void SSTVClient::sendLine(const uint32_t* imgLine) {
+  // convert the whole line first, the last tone of the previous line is still being sent meanwhile
+  this->prepareLine(imgLine);
+  if(this->toneLen == 0) {
+    this->restartTiming();
+  }
+
   // check first line in Scottie modes
   if((lineCount == 0) && ((txMode.visCode == RADIOLIB_SSTV_SCOTTIE_1) || (txMode.visCode == RADIOLIB_SSTV_SCOTTIE_2) || (txMode.visCode == RADIOLIB_SSTV_SCOTTIE_DX))) {
     // send start sync tone
@@ -289,6 +307,7 @@ void SSTVClient::sendLine(const uint32_t* imgLine) {
   }
 
   // send all tones in sequence
+  bool robot = (txMode.visCode == RADIOLIB_SSTV_ROBOT_36) || (txMode.visCode == RADIOLIB_SSTV_ROBOT_72);
   for(uint8_t i = 0; i < txMode.numTones; i++) {
     if((txMode.tones[i].type == tone_t::GENERIC) && (txMode.tones[i].len > 0)) {
       // Robot36 has different separator tones for even and odd lines
@@ -300,77 +319,111 @@ void SSTVClient::sendLine(const uint32_t* imgLine) {
       // sync/porch tones
       this->tone(freq, txMode.tones[i].len);
 
-    } else {
-      // scan lines
+    } else if(txMode.tones[i].type != tone_t::GENERIC) {
+      // scan lines, chroma is sent at half the pixel length in Robot modes
+      RadioLibTime_t len = txMode.scanPixelLen;
+      if(robot && (txMode.tones[i].type != tone_t::SCAN_GREEN_Y)) {
+        len /= 2;
+      }
+
+      const uint8_t* levels = this->lineLevels[txMode.tones[i].type - 1];
       for(uint16_t j = 0; j < txMode.width; j++) {
-        uint32_t color = imgLine[j];
-        uint32_t len = txMode.scanPixelLen;
-
-        // Robot modes work in YCbCr
-        if((txMode.visCode == RADIOLIB_SSTV_ROBOT_36) || (txMode.visCode == RADIOLIB_SSTV_ROBOT_72)) {
-          uint8_t r = (color & 0x00FF0000) >> 16;
-          uint8_t g = (color & 0x0000FF00) >> 8;
-          uint8_t b = (color & 0x000000FF);
-          uint8_t y = 16.0 + (0.003906 * ((65.738 * r) + (129.057 * g) + (25.064 * b)));
-          uint8_t cb = 128.0 + (0.003906 * ((-37.945 * r) + (-74.494 * g) + (112.439 * b)));
-          uint8_t cr = 128.0 + (0.003906 * ((112.439 * r) + (-94.154 * g) + (-18.285 * b)));
-          color = ((uint32_t)y << 8);
-          if(txMode.visCode == RADIOLIB_SSTV_ROBOT_36) {
-            // odd lines carry Cb, even lines carry Cr
-            color |= (lineCount % 2) ? cb : cr; 
-          } else {
-            color |= ((uint32_t)cr << 16) | cb;
-          }
-          
-        }
-
-        switch(txMode.tones[i].type) {
-          case(tone_t::SCAN_RED_CR):
-            color &= 0x00FF0000;
-            color >>= 16;
-            if((txMode.visCode == RADIOLIB_SSTV_ROBOT_36) || (txMode.visCode == RADIOLIB_SSTV_ROBOT_72)) {
-              len /= 2;
-            }
-            break;
-          case(tone_t::SCAN_GREEN_Y):
-            color &= 0x0000FF00;
-            color >>= 8;
-            break;
-          case(tone_t::SCAN_BLUE_CB):
-            color &= 0x000000FF;
-            if((txMode.visCode == RADIOLIB_SSTV_ROBOT_36) || (txMode.visCode == RADIOLIB_SSTV_ROBOT_72)) {
-              len /= 2;
-            }
-            break;
-          case(tone_t::GENERIC):
-            break;
-        }
-        this->tone(RADIOLIB_SSTV_TONE_BRIGHTNESS_MIN + ((float)color * 3.1372549f), len);
+        this->toneWord(this->levelWords[levels[j]], len);
       }
     }
   }
 
   // increment line counter (needed for Robot36 mode)
   lineCount++;
+
+  // the last line is not followed by anything, so wait for it to finish
+  if(lineCount >= txMode.height) {
+    this->finishTone();
+  }
+}
+
+void SSTVClient::prepareLine(const uint32_t* imgLine) {
+  uint8_t* green = this->lineLevels[tone_t::SCAN_GREEN_Y - 1];
+  uint8_t* blue = this->lineLevels[tone_t::SCAN_BLUE_CB - 1];
+  uint8_t* red = this->lineLevels[tone_t::SCAN_RED_CR - 1];
+
+  // RGB modes only split the color channels
+  if((txMode.visCode != RADIOLIB_SSTV_ROBOT_36) && (txMode.visCode != RADIOLIB_SSTV_ROBOT_72)) {
+    for(uint16_t j = 0; j < txMode.width; j++) {
+      red[j] = (imgLine[j] & 0x00FF0000) >> 16;
+      green[j] = (imgLine[j] & 0x0000FF00) >> 8;
+      blue[j] = (imgLine[j] & 0x000000FF);
+    }
+    return;
+  }
+
+  // Robot modes work in YCbCr, converted in fixed point with the coefficients scaled by 2^16
+  // the offsets keep all sums positive, so the shifts are well defined
+  bool odd = lineCount % 2;
+  for(uint16_t j = 0; j < txMode.width; j++) {
+    int32_t r = (imgLine[j] & 0x00FF0000) >> 16;
+    int32_t g = (imgLine[j] & 0x0000FF00) >> 8;
+    int32_t b = (imgLine[j] & 0x000000FF);
+    uint8_t y = (((int32_t)16 << 16) + 16828*r + 33036*g + 6416*b) >> 16;
+    uint8_t cb = (((int32_t)128 << 16) - 9713*r - 19069*g + 28783*b) >> 16;
+    uint8_t cr = (((int32_t)128 << 16) + 28783*r - 24102*g - 4681*b) >> 16;
+    green[j] = y;
+    if(txMode.visCode == RADIOLIB_SSTV_ROBOT_36) {
+      // odd lines carry Cb, even lines carry Cr
+      blue[j] = odd ? cb : cr;
+    } else {
+      red[j] = cr;
+      blue[j] = cb;
+    }
+  }
 }
 
 uint16_t SSTVClient::getPictureHeight() const {
   return(txMode.height);
 }
 
+uint32_t SSTVClient::getWord(float freq) const {
+  #if !RADIOLIB_EXCLUDE_AFSK
+  if(audioClient != nullptr) {
+    return((uint16_t)freq);
+  }
+  #endif
+  return(baseFreq + (freq / phyLayer->freqStep));
+}
+
 void SSTVClient::tone(float freq, RadioLibTime_t len) {
-  Module* mod = phyLayer->getMod();
-  RadioLibTime_t start = mod->hal->micros();
+  this->toneWord(this->getWord(freq), len);
+}
+
+void SSTVClient::toneWord(uint32_t word, RadioLibTime_t len) {
+  this->finishTone();
   #if !RADIOLIB_EXCLUDE_AFSK
   if(audioClient != nullptr) {
-    audioClient->tone(freq, false);
+    audioClient->tone(word, false);
   } else {
-    phyLayer->transmitDirect(baseFreq + (freq / phyLayer->freqStep));
+    phyLayer->transmitDirect(word);
   }
   #else
-  phyLayer->transmitDirect(baseFreq + (freq / phyLayer->freqStep));
+  phyLayer->transmitDirect(word);
   #endif
-  mod->waitForMicroseconds(start, len);
+  this->toneLen = len;
+}
+
+void SSTVClient::restartTiming() {
+  this->toneStart = phyLayer->getMod()->hal->micros();
+  this->toneLen = 0;
+}
+
+void SSTVClient::finishTone() {
+  if(this->toneLen == 0) {
+    return;
+  }
+
+  // tones are timed from their scheduled start rather than from when they were actually set,
+  // so delays in preparing or switching tones do not accumulate over the line
+  phyLayer->getMod()->waitForMicroseconds(this->toneStart, this->toneLen);
+  this->toneStart += this->toneLen;
+  this->toneLen = 0;
 }
 
 #endif
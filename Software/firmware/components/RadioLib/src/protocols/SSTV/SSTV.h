@@ -32,6 +32,14 @@
 #define RADIOLIB_SSTV_TONE_BRIGHTNESS_MIN                       1500
 #define RADIOLIB_SSTV_TONE_BRIGHTNESS_MAX                       2300
 
+// maximum supported picture width, determines the size of the prepared line buffer
+#if !defined(RADIOLIB_SSTV_MAX_WIDTH)
+  #define RADIOLIB_SSTV_MAX_WIDTH                               640
+#endif
+
+// number of brightness levels
+#define RADIOLIB_SSTV_NUM_LEVELS                                256
+
 // calibration header timing in us
 #define RADIOLIB_SSTV_HEADER_LEADER_LENGTH                      300000
 #define RADIOLIB_SSTV_HEADER_BREAK_LENGTH                       10000
@@ -141,7 +149,7 @@ class SSTVClient {
       \param base Base "0 Hz tone" RF frequency to be used in MHz.
       \param mode SSTV mode to be used. Currently supported modes are Scottie1, Scottie2, 
       ScottieDX, Martin1, Martin2, Wrasse, PasokonP3, PasokonP5 and PasokonP7,
-      Robot36 and Robot37.
+      Robot36 and Robot37. Modes wider than RADIOLIB_SSTV_MAX_WIDTH are not supported.
       \returns \ref status_codes
     */
     int16_t begin(float base, const SSTVMode_t& mode);
@@ -177,6 +185,8 @@ class SSTVClient {
 
     /*!
       \brief Sends single picture line in the currently configured SSTV mode.
+      The whole line is converted before the first tone is sent. Except for the last line of the picture,
+      this method returns while the last tone of the line is still being sent, the next call picks up from there.
       \param imgLine Image line to send, in 24-bit RGB. It is up to the user to ensure that
       imgLine has enough pixels to send it in the current SSTV mode.
     */
@@ -200,7 +210,22 @@ class SSTVClient {
     SSTVMode_t txMode = Scottie1;
     uint32_t lineCount = 0;
 
+    // frequency word for each brightness level, precomputed in begin
+    uint32_t levelWords[RADIOLIB_SSTV_NUM_LEVELS] = { 0 };
+
+    // brightness levels of the next line, one row per scan tone type
+    uint8_t lineLevels[3][RADIOLIB_SSTV_MAX_WIDTH] = { { 0 } };
+
+    // scheduled start and length of the tone that is currently being sent
+    RadioLibTime_t toneStart = 0;
+    RadioLibTime_t toneLen = 0;
+
+    void prepareLine(const uint32_t* imgLine);
+    uint32_t getWord(float freq) const;
     void tone(float freq, RadioLibTime_t len = 0);
+    void toneWord(uint32_t word, RadioLibTime_t len);
+    void restartTiming();
+    void finishTone();
 };
 
 #endif
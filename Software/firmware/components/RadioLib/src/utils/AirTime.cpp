@@ -0,0 +1,157 @@
+#include "AirTime.h"
+
+RadioLibAirTimeBudget::RadioLibAirTimeBudget(RadioLibTime_t msPerHour, RadioLibTime_t dwellTimeMs) {
+  this->msPerHour = msPerHour;
+  this->dwellTimeMs = dwellTimeMs;
+}
+
+RadioLibTime_t RadioLibAirTimeBudget::getUsedMs(RadioLibTime_t now) const {
+  return((RadioLibTime_t)((this->getUsedUs(now) + 999) / 1000));
+}
+
+uint64_t RadioLibAirTimeBudget::getUsedUs(RadioLibTime_t now) const {
+  uint64_t usedUs = 0;
+  for(size_t i = 0; i < this->historyLen; i++) {
+    size_t idx = (this->historyPos + RADIOLIB_AIRTIME_BUDGET_HISTORY - this->historyLen + i) % RADIOLIB_AIRTIME_BUDGET_HISTORY;
+    if(now - this->historyStart[idx] < RADIOLIB_AIRTIME_HOUR_MS) {
+      usedUs += this->historyToA[idx];
+    }
+  }
+  return(usedUs);
+}
+
+RadioLibTime_t RadioLibAirTimeBudget::timeUntilAvailable(RadioLibTime_t now, RadioLibTime_t toaUs) const {
+  if(this->msPerHour == 0) {
+    return(0);
+  }
+
+  // an uplink longer than the whole allowance will never fit
+  const uint64_t allowanceUs = (uint64_t)this->msPerHour * 1000;
+  if(toaUs > allowanceUs) {
+    return(RADIOLIB_AIRTIME_HOUR_MS);
+  }
+
+  uint64_t usedUs = this->getUsedUs(now);
+  if(usedUs + toaUs <= allowanceUs) {
+    return(0);
+  }
+
+  // walk the history from the oldest entry until enough airtime expires from the window
+  for(size_t i = 0; i < this->historyLen; i++) {
+    size_t idx = (this->historyPos + RADIOLIB_AIRTIME_BUDGET_HISTORY - this->historyLen + i) % RADIOLIB_AIRTIME_BUDGET_HISTORY;
+    if(now - this->historyStart[idx] >= RADIOLIB_AIRTIME_HOUR_MS) {
+      continue;
+    }
+
+    usedUs = (this->historyToA[idx] > usedUs) ? 0 : usedUs - this->historyToA[idx];
+    if(usedUs + toaUs <= allowanceUs) {
+      return(this->historyStart[idx] + RADIOLIB_AIRTIME_HOUR_MS - now);
+    }
+  }
+
+  return(RADIOLIB_AIRTIME_HOUR_MS);
+}
+
+int16_t RadioLibAirTimeBudget::commit(RadioLibTime_t now, RadioLibTime_t toaUs) {
+  if(this->dwellTimeMs && (toaUs > this->dwellTimeMs * 1000)) {
+    return(RADIOLIB_ERR_DWELL_TIME_EXCEEDED);
+  }
+
+  // drop entries that left the window
+  while(this->historyLen) {
+    size_t oldest = (this->historyPos + RADIOLIB_AIRTIME_BUDGET_HISTORY - this->historyLen) % RADIOLIB_AIRTIME_BUDGET_HISTORY;
+    if(now - this->historyStart[oldest] < RADIOLIB_AIRTIME_HOUR_MS) {
+      break;
+    }
+    this->historyLen--;
+  }
+
+  // when the history is full, fold the oldest entry into the next one
+  // this overestimates the used airtime slightly, but never underestimates it
+  if(this->historyLen == RADIOLIB_AIRTIME_BUDGET_HISTORY) {
+    size_t next = (this->historyPos + 1) % RADIOLIB_AIRTIME_BUDGET_HISTORY;
+    this->historyToA[next] += this->historyToA[this->historyPos];
+    this->historyLen--;
+  }
+
+  this->historyStart[this->historyPos] = now;
+  this->historyToA[this->historyPos] = toaUs;
+  this->historyPos = (this->historyPos + 1) % RADIOLIB_AIRTIME_BUDGET_HISTORY;
+  this->historyLen++;
+  return(RADIOLIB_ERR_NONE);
+}
+
+int16_t RadioLibAirTimeBudget::plan(const LoRaAirTimeConfig_t& cfg, size_t overhead, size_t readingLen, size_t maxLen, AirTimePlan_t* plan) const {
+  if(!plan || (readingLen == 0)) {
+    return(RADIOLIB_ERR_NULL_POINTER);
+  }
+
+  int16_t state = RADIOLIB_ERR_PACKET_TOO_LONG;
+  plan->readingsPerHour = 0;
+  for(size_t num = 1; (num <= 0xFF) && (overhead + num*readingLen <= maxLen); num++) {
+    RadioLibTime_t toaUs = RadioLibAirTime::timeOnAirUs(cfg, overhead + num*readingLen);
+    if(this->dwellTimeMs && (toaUs > this->dwellTimeMs * 1000)) {
+      // longer uplinks will only exceed the dwell time even more
+      if(num == 1) {
+        state = RADIOLIB_ERR_DWELL_TIME_EXCEEDED;
+      }
+      break;
+    }
+
+    // without a duty-cycle limit, uplinks can be sent back-to-back
+    RadioLibTime_t toaMs = (toaUs + 999) / 1000;
+    RadioLibTime_t intervalMs = this->msPerHour ? RadioLibAirTime::dutyCycleIntervalMs(this->msPerHour, toaMs) : toaMs;
+    uint32_t perHour = (uint32_t)(((uint64_t)num * RADIOLIB_AIRTIME_HOUR_MS) / intervalMs);
+
+    // strictly greater, so that the shortest batch wins ties (lowest latency)
+    if(perHour > plan->readingsPerHour) {
+      plan->readingsPerUplink = num;
+      plan->timeOnAirUs = toaUs;
+      plan->intervalMs = intervalMs;
+      plan->readingsPerHour = perHour;
+    }
+    state = RADIOLIB_ERR_NONE;
+  }
+
+  return(state);
+}
+
+size_t RadioLibAirTimeBudget::schedule(const LoRaAirTimeConfig_t& cfg, size_t overhead, const size_t* lens, size_t num, size_t maxLen, RadioLibTime_t now, RadioLibTime_t* slots) const {
+  if(!lens || !slots) {
+    return(0);
+  }
+
+  // simulate on a copy so that the actual budget is left untouched
+  RadioLibAirTimeBudget sim = *this;
+  RadioLibTime_t t = now;
+  size_t i = 0;
+  while(i < num) {
+    // greedily pack as many consecutive readings as the packet length and dwell time allow
+    size_t len = overhead;
+    size_t end = i;
+    while((end < num) && (len + lens[end] <= maxLen)) {
+      if(sim.dwellTimeMs && (RadioLibAirTime::timeOnAirUs(cfg, len + lens[end]) > sim.dwellTimeMs * 1000)) {
+        break;
+      }
+      len += lens[end];
+      end++;
+    }
+
+    // a single reading that does not fit blocks the rest of the queue
+    if(end == i) {
+      break;
+    }
+
+    RadioLibTime_t toaUs = RadioLibAirTime::timeOnAirUs(cfg, len);
+    t += sim.timeUntilAvailable(t, toaUs);
+    (void)sim.commit(t, toaUs);
+    for(; i < end; i++) {
+      slots[i] = t;
+    }
+
+    // the radio is busy until the uplink is done
+    t += (toaUs + 999) / 1000;
+  }
+
+  return(i);
+}
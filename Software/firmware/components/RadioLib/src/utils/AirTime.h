@@ -0,0 +1,229 @@
+#if !defined(_RADIOLIB_AIRTIME_H)
+#define _RADIOLIB_AIRTIME_H
+
+#include "../TypeDef.h"
+
+// low data rate optimization modes
+#define RADIOLIB_AIRTIME_LDRO_OFF                               (0x00)
+#define RADIOLIB_AIRTIME_LDRO_ON                                (0x01)
+#define RADIOLIB_AIRTIME_LDRO_AUTO                              (0x02)
+
+// symbol duration above which LDRO is enabled automatically (16 ms)
+#define RADIOLIB_AIRTIME_LDRO_THRESHOLD_NS                      (16000000UL)
+
+// one hour in milliseconds, the window all regional duty-cycle limits are expressed in
+#define RADIOLIB_AIRTIME_HOUR_MS                                (3600000UL)
+
+// maximum number of uplinks the budget planner keeps in its sliding window
+#define RADIOLIB_AIRTIME_BUDGET_HISTORY                         (32)
+
+/*!
+  \struct LoRaAirTimeConfig_t
+  \brief LoRa packet parameters needed to calculate time-on-air.
+  Kept as a plain aggregate so that it can be used in constant expressions.
+*/
+struct LoRaAirTimeConfig_t {
+  /*! \brief LoRa spreading factor (5 - 12). */
+  uint8_t spreadingFactor;
+
+  /*! \brief LoRa bandwidth in Hz. */
+  uint32_t bandwidth;
+
+  /*! \brief Coding rate denominator (5 - 8 for 4/5 - 4/8). */
+  uint8_t codingRate;
+
+  /*! \brief Preamble length in symbols. */
+  uint32_t preambleLength;
+
+  /*! \brief Whether implicit header mode is used. */
+  bool implicitHeader;
+
+  /*! \brief Whether payload CRC is enabled. */
+  bool crcEnabled;
+
+  /*! \brief Low data rate optimization, one of RADIOLIB_AIRTIME_LDRO_*. */
+  uint8_t ldrOptimize;
+
+  /*! \brief Use the SX127x formula for SF6 (SX126x, SX128x and LR11x0 use different coefficients for SF5/SF6). */
+  bool legacyLowSf;
+};
+
+/*!
+  \class RadioLibAirTime
+  \brief Modem-agnostic LoRa time-on-air model. All methods are integer-only and constexpr,
+  so the airtime of fixed configurations can be evaluated at compile time.
+*/
+class RadioLibAirTime {
+  public:
+    /*!
+      \brief Get LoRa symbol duration.
+      \param sf Spreading factor.
+      \param bw Bandwidth in Hz.
+      \returns Symbol duration in nanoseconds.
+    */
+    static constexpr uint32_t symbolDurationNs(uint8_t sf, uint32_t bw) {
+      return((uint32_t)((1000000000ULL << sf) / bw));
+    }
+
+    /*!
+      \brief Check whether low data rate optimization is in effect for a configuration.
+      \param cfg Packet configuration.
+      \returns True when LDRO is (or would automatically be) enabled.
+    */
+    static constexpr bool lowDataRate(const LoRaAirTimeConfig_t& cfg) {
+      return((cfg.ldrOptimize == RADIOLIB_AIRTIME_LDRO_ON) ||
+             ((cfg.ldrOptimize == RADIOLIB_AIRTIME_LDRO_AUTO) &&
+              (symbolDurationNs(cfg.spreadingFactor, cfg.bandwidth) >= RADIOLIB_AIRTIME_LDRO_THRESHOLD_NS)));
+    }
+
+    /*!
+      \brief Get number of payload symbols (including the 8 symbols of the header block).
+      \param cfg Packet configuration.
+      \param len Payload length in bytes.
+      \returns Number of payload symbols.
+    */
+    static constexpr uint32_t payloadSymbols(const LoRaAirTimeConfig_t& cfg, size_t len) {
+      return(8 + codedBlocks(payloadBits(cfg, len), 4*(cfg.spreadingFactor - (lowDataRate(cfg) ? 2 : 0))) * cfg.codingRate);
+    }
+
+    /*!
+      \brief Get total number of symbols of a packet, multiplied by 4 to keep the fractional sync symbols exact.
+      \param cfg Packet configuration.
+      \param len Payload length in bytes.
+      \returns Number of symbols times 4.
+    */
+    static constexpr uint32_t symbolsX4(const LoRaAirTimeConfig_t& cfg, size_t len) {
+      return(4*cfg.preambleLength + (shortSf(cfg) ? 25 : 17) + 4*payloadSymbols(cfg, len));
+    }
+
+    /*!
+      \brief Get time-on-air of a packet.
+      \param cfg Packet configuration.
+      \param len Payload length in bytes.
+      \returns Time-on-air in microseconds, rounded up.
+    */
+    static constexpr RadioLibTime_t timeOnAirUs(const LoRaAirTimeConfig_t& cfg, size_t len) {
+      return((RadioLibTime_t)(((uint64_t)symbolsX4(cfg, len) * (1000000ULL << cfg.spreadingFactor) + 4ULL*cfg.bandwidth - 1) / (4ULL*cfg.bandwidth)));
+    }
+
+    /*!
+      \brief Calculate the minimum interval between two uplinks to adhere to a duty-cycle limit.
+      \param msPerHour The maximum allowed airtime (in milliseconds per hour). 0 means no limit.
+      \param airtimeMs The airtime of the uplink in milliseconds.
+      \returns Required interval in milliseconds between the start of consecutive uplinks.
+    */
+    static constexpr RadioLibTime_t dutyCycleIntervalMs(RadioLibTime_t msPerHour, RadioLibTime_t airtimeMs) {
+      return(((msPerHour == 0) || (airtimeMs == 0)) ? 0 :
+             (RadioLibTime_t)(((uint64_t)airtimeMs * RADIOLIB_AIRTIME_HOUR_MS) / msPerHour + 1));
+    }
+
+  private:
+    static constexpr bool shortSf(const LoRaAirTimeConfig_t& cfg) {
+      return((cfg.spreadingFactor < 7) && !cfg.legacyLowSf);
+    }
+
+    static constexpr int32_t payloadBits(const LoRaAirTimeConfig_t& cfg, size_t len) {
+      return(8*(int32_t)len + (cfg.crcEnabled ? 16 : 0) - 4*(int32_t)cfg.spreadingFactor +
+             (shortSf(cfg) ? 0 : 8) + (cfg.implicitHeader ? 0 : 20));
+    }
+
+    static constexpr uint32_t codedBlocks(int32_t bits, int32_t bitsPerBlock) {
+      return((bits <= 0) ? 0 : (uint32_t)((bits + bitsPerBlock - 1) / bitsPerBlock));
+    }
+};
+
+/*!
+  \struct AirTimePlan_t
+  \brief Result of batching readings into uplinks under a duty-cycle limit.
+*/
+struct AirTimePlan_t {
+  /*! \brief Number of readings packed into one uplink. */
+  uint8_t readingsPerUplink;
+
+  /*! \brief Time-on-air of one uplink in microseconds. */
+  RadioLibTime_t timeOnAirUs;
+
+  /*! \brief Minimum interval between uplinks in milliseconds. */
+  RadioLibTime_t intervalMs;
+
+  /*! \brief Maximum number of readings that can be delivered per hour. */
+  uint32_t readingsPerHour;
+};
+
+/*!
+  \class RadioLibAirTimeBudget
+  \brief Tracks consumed airtime in a sliding one-hour window and schedules pending readings
+  against a regional duty-cycle and dwell-time limit.
+*/
+class RadioLibAirTimeBudget {
+  public:
+    /*!
+      \brief Default constructor.
+      \param msPerHour Allowed airtime in milliseconds per hour (e.g. 36000 for 1 %). 0 disables the duty-cycle limit.
+      \param dwellTimeMs Maximum time-on-air of a single uplink in milliseconds (e.g. 400 in US915). 0 disables the limit.
+    */
+    explicit RadioLibAirTimeBudget(RadioLibTime_t msPerHour, RadioLibTime_t dwellTimeMs = 0);
+
+    /*!
+      \brief Get the airtime used within the last hour.
+      \param now Current timestamp in milliseconds.
+      \returns Used airtime in milliseconds.
+    */
+    RadioLibTime_t getUsedMs(RadioLibTime_t now) const;
+
+    /*!
+      \brief Get time until an uplink with a given time-on-air fits the budget.
+      \param now Current timestamp in milliseconds.
+      \param toaUs Time-on-air of the uplink in microseconds.
+      \returns Time to wait in milliseconds, 0 if the uplink may be sent immediately.
+    */
+    RadioLibTime_t timeUntilAvailable(RadioLibTime_t now, RadioLibTime_t toaUs) const;
+
+    /*!
+      \brief Record an uplink in the budget.
+      \param now Timestamp of the start of the uplink in milliseconds.
+      \param toaUs Time-on-air of the uplink in microseconds.
+      \returns \ref status_codes
+    */
+    int16_t commit(RadioLibTime_t now, RadioLibTime_t toaUs);
+
+    /*!
+      \brief Find the number of readings per uplink that maximizes delivered readings per hour.
+      \param cfg Packet configuration.
+      \param overhead Per-uplink overhead in bytes (headers, addressing).
+      \param readingLen Length of one reading in bytes.
+      \param maxLen Maximum payload length in bytes.
+      \param plan Pointer to the plan to fill.
+      \returns \ref status_codes
+    */
+    int16_t plan(const LoRaAirTimeConfig_t& cfg, size_t overhead, size_t readingLen, size_t maxLen, AirTimePlan_t* plan) const;
+
+    /*!
+      \brief Schedule a queue of pending readings. Consecutive readings are packed into uplinks
+      of at most maxLen bytes (and within the dwell time), each uplink is placed at the earliest time
+      allowed by the budget. The budget itself is not modified.
+      \param cfg Packet configuration.
+      \param overhead Per-uplink overhead in bytes.
+      \param lens Lengths of the pending readings in bytes.
+      \param num Number of pending readings.
+      \param maxLen Maximum payload length in bytes.
+      \param now Current timestamp in milliseconds.
+      \param slots Array of num timestamps to fill with the start of the uplink carrying each reading.
+      \returns Number of readings that could be scheduled.
+    */
+    size_t schedule(const LoRaAirTimeConfig_t& cfg, size_t overhead, const size_t* lens, size_t num, size_t maxLen, RadioLibTime_t now, RadioLibTime_t* slots) const;
+
+  private:
+    RadioLibTime_t msPerHour;
+    RadioLibTime_t dwellTimeMs;
+
+    // ring of recent uplinks, start time in ms and time-on-air in us
+    RadioLibTime_t historyStart[RADIOLIB_AIRTIME_BUDGET_HISTORY] = { 0 };
+    RadioLibTime_t historyToA[RADIOLIB_AIRTIME_BUDGET_HISTORY] = { 0 };
+    size_t historyPos = 0;
+    size_t historyLen = 0;
+
+    uint64_t getUsedUs(RadioLibTime_t now) const;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#include "BitRing.h"
+
+#include <string.h>
+
+#define RADIOLIB_RING_MASK                                      (RADIOLIB_DIRECT_RX_BUFFER_LEN - 1)
+
+RadioLibBitRing::RadioLibBitRing() {
+
+}
+
+bool RadioLibBitRing::pushBit(uint8_t bit) {
+  // shifting in from the right keeps the first received bit as MSB, no reflection needed
+  this->acc = (this->acc << 1) | (bit & 0x01);
+  if(++this->accBits < 8) {
+    return(true);
+  }
+  this->accBits = 0;
+
+  // the ISR cannot wait for the consumer, so the byte is lost when the ring is full
+  uint8_t next = (this->head + 1) & RADIOLIB_RING_MASK;
+  if(next == RADIOLIB_RING_LOAD(this->tail)) {
+    this->dropped++;
+    return(false);
+  }
+
+  this->buffer[this->head] = this->acc;
+  RADIOLIB_RING_STORE(this->head, next);
+  return(true);
+}
+
+void RadioLibBitRing::alignBits() {
+  this->acc = 0;
+  this->accBits = 0;
+}
+
+size_t RadioLibBitRing::available() const {
+  return((RADIOLIB_RING_LOAD(this->head) - this->tail) & RADIOLIB_RING_MASK);
+}
+
+uint8_t RadioLibBitRing::read() {
+  uint8_t b = 0;
+  this->read(&b, 1);
+  return(b);
+}
+
+size_t RadioLibBitRing::read(uint8_t* data, size_t len) {
+  uint8_t tail = this->tail;
+  size_t num = (RADIOLIB_RING_LOAD(this->head) - tail) & RADIOLIB_RING_MASK;
+  if(len < num) {
+    num = len;
+  }
+
+  // copy in at most two chunks, up to the end of the buffer and then from its start
+  size_t first = RADIOLIB_DIRECT_RX_BUFFER_LEN - tail;
+  if(first > num) {
+    first = num;
+  }
+  memcpy(data, &this->buffer[tail], first);
+  memcpy(&data[first], this->buffer, num - first);
+
+  RADIOLIB_RING_STORE(this->tail, (uint8_t)((tail + num) & RADIOLIB_RING_MASK));
+  return(num);
+}
+
+void RadioLibBitRing::flush() {
+  RADIOLIB_RING_STORE(this->tail, RADIOLIB_RING_LOAD(this->head));
+}
+
+uint32_t RadioLibBitRing::getDropped() const {
+  return(this->dropped);
+}
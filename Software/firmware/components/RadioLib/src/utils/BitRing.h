@@ -0,0 +1,96 @@
+#if !defined(_RADIOLIB_BIT_RING_H)
+#define _RADIOLIB_BIT_RING_H
+
+#include "../TypeDef.h"
+
+// size of the direct mode receive ring in bytes, must be a power of 2 and at most 256
+// one byte is always kept empty, so the ring holds one byte less
+#if !defined(RADIOLIB_DIRECT_RX_BUFFER_LEN)
+  #define RADIOLIB_DIRECT_RX_BUFFER_LEN                         (256)
+#endif
+
+#if (RADIOLIB_DIRECT_RX_BUFFER_LEN > 256) || (RADIOLIB_DIRECT_RX_BUFFER_LEN & (RADIOLIB_DIRECT_RX_BUFFER_LEN - 1))
+  #error "RADIOLIB_DIRECT_RX_BUFFER_LEN must be a power of 2 and at most 256"
+#endif
+
+// ordered access to the ring indices, which are single bytes and therefore atomic on every platform
+// acquire/release makes sure the data byte is visible before the index that publishes it
+#if defined(__GNUC__)
+  #define RADIOLIB_RING_LOAD(VAR)                               __atomic_load_n(&(VAR), __ATOMIC_ACQUIRE)
+  #define RADIOLIB_RING_STORE(VAR, VAL)                         __atomic_store_n(&(VAR), (VAL), __ATOMIC_RELEASE)
+#else
+  #define RADIOLIB_RING_LOAD(VAR)                               (*(volatile uint8_t*)&(VAR))
+  #define RADIOLIB_RING_STORE(VAR, VAL)                         (*(volatile uint8_t*)&(VAR) = (VAL))
+#endif
+
+/*!
+  \class RadioLibBitRing
+  \brief Wait-free single-producer/single-consumer ring for bits received in direct mode.
+  The producer (bit clock interrupt) shifts bits into a byte accumulator, most significant bit first,
+  and publishes complete bytes. The consumer (main loop) reads bytes one at a time or in batches.
+  Each index is only ever written by one side, so no locking or disabling of interrupts is needed.
+*/
+class RadioLibBitRing {
+  public:
+    /*!
+      \brief Default constructor.
+    */
+    RadioLibBitRing();
+
+    /*!
+      \brief Add a bit, producer side. A byte is published once 8 bits have been accumulated.
+      \param bit Bit value, only the lowest bit is used.
+      \returns False if the ring was full and a complete byte had to be dropped, true otherwise.
+    */
+    bool pushBit(uint8_t bit);
+
+    /*!
+      \brief Discard partially accumulated bits, producer side. Used to align bytes to the end of a sync word.
+    */
+    void alignBits();
+
+    /*!
+      \brief Get the number of bytes that can be read, consumer side.
+      \returns Number of available bytes.
+    */
+    size_t available() const;
+
+    /*!
+      \brief Read a single byte, consumer side.
+      \returns The oldest byte in the ring, or 0 if the ring is empty.
+    */
+    uint8_t read();
+
+    /*!
+      \brief Read multiple bytes at once, consumer side.
+      \param data Buffer to copy the bytes to.
+      \param len Maximum number of bytes to read.
+      \returns Number of bytes actually read.
+    */
+    size_t read(uint8_t* data, size_t len);
+
+    /*!
+      \brief Discard all bytes that have not been read yet, consumer side.
+    */
+    void flush();
+
+    /*!
+      \brief Get the number of bytes dropped because the consumer was not reading fast enough.
+      \returns Number of dropped bytes.
+    */
+    uint32_t getDropped() const;
+
+  private:
+    uint8_t buffer[RADIOLIB_DIRECT_RX_BUFFER_LEN] = { 0 };
+
+    // written by the producer only
+    uint8_t head = 0;
+    uint8_t acc = 0;
+    uint8_t accBits = 0;
+    uint32_t dropped = 0;
+
+    // written by the consumer only
+    uint8_t tail = 0;
+};
+
+#endif
@@ -0,0 +1,251 @@
+#include "ScanStream.h"
+#include "CRC.h"
+
+#include <string.h>
+
+// zigzag mapping, small negative and positive deltas both become small unsigned values
+static uint32_t scanZigzag(int32_t val) {
+  return(((uint32_t)val << 1) ^ (uint32_t)(val >> 31));
+}
+
+static int32_t scanUnzigzag(uint32_t val) {
+  return((int32_t)(val >> 1) ^ -(int32_t)(val & 0x01));
+}
+
+static size_t scanPutVarint(uint8_t* out, uint32_t val) {
+  size_t len = 0;
+  while(val >= 0x80) {
+    out[len++] = (val & 0x7F) | 0x80;
+    val >>= 7;
+  }
+  out[len++] = val;
+  return(len);
+}
+
+// returns number of bytes consumed, 0 on malformed input
+static size_t scanGetVarint(const uint8_t* in, size_t len, uint32_t* val) {
+  *val = 0;
+  for(size_t i = 0; (i < len) && (i < 5); i++) {
+    *val |= (uint32_t)(in[i] & 0x7F) << (7*i);
+    if(!(in[i] & 0x80)) {
+      return(i + 1);
+    }
+  }
+  return(0);
+}
+
+static uint16_t scanChecksum(const uint8_t* buff, size_t len) {
+  RadioLibCRCInstance.size = 16;
+  RadioLibCRCInstance.poly = RADIOLIB_CRC_CCITT_POLY;
+  RadioLibCRCInstance.init = RADIOLIB_CRC_CCITT_INIT;
+  RadioLibCRCInstance.out = RADIOLIB_CRC_CCITT_OUT;
+  RadioLibCRCInstance.refIn = false;
+  RadioLibCRCInstance.refOut = false;
+  return(RadioLibCRCInstance.checksum(buff, len));
+}
+
+static void scanPut32(uint8_t* out, uint32_t val) {
+  for(uint8_t i = 0; i < 4; i++) {
+    out[i] = (val >> (8*i)) & 0xFF;
+  }
+}
+
+static uint32_t scanGet32(const uint8_t* in) {
+  return((uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24));
+}
+
+// add framing around a payload that was already written at out + RADIOLIB_SCAN_STREAM_HEADER_LEN
+static size_t scanFrame(uint8_t* out, uint8_t tag, size_t payloadLen) {
+  out[0] = RADIOLIB_SCAN_STREAM_SYNC;
+  out[1] = tag;
+  out[2] = payloadLen & 0xFF;
+  out[3] = (payloadLen >> 8) & 0xFF;
+  size_t len = RADIOLIB_SCAN_STREAM_HEADER_LEN + payloadLen;
+  uint16_t crc = scanChecksum(&out[1], len - 1);
+  out[len++] = crc & 0xFF;
+  out[len++] = (crc >> 8) & 0xFF;
+  return(len);
+}
+
+size_t RadioLibScanEncoder::beginSweep(const RadioLibScanSweep_t& sweep, uint8_t* out) {
+  if((sweep.numBins == 0) || (sweep.numBins > RADIOLIB_SCAN_STREAM_MAX_BINS)) {
+    return(0);
+  }
+  this->numBins = sweep.numBins;
+  memset(this->prev, 0x00, sizeof(this->prev));
+
+  uint8_t* p = &out[RADIOLIB_SCAN_STREAM_HEADER_LEN];
+  scanPut32(&p[0], sweep.freqStart);
+  scanPut32(&p[4], sweep.freqStep);
+  p[8] = sweep.numSteps & 0xFF;
+  p[9] = (sweep.numSteps >> 8) & 0xFF;
+  p[10] = sweep.numBins;
+  scanPut32(&p[11], sweep.sequence);
+  scanPut32(&p[15], sweep.timestamp);
+  return(scanFrame(out, RADIOLIB_SCAN_STREAM_TAG_SWEEP, RADIOLIB_SCAN_STREAM_SWEEP_LEN));
+}
+
+size_t RadioLibScanEncoder::encodeLine(uint16_t step, const uint16_t* bins, uint8_t* out) {
+  uint8_t* p = &out[RADIOLIB_SCAN_STREAM_HEADER_LEN];
+  p[0] = step & 0xFF;
+  p[1] = (step >> 8) & 0xFF;
+  size_t len = 2;
+
+  // literal tokens have the lowest bit clear, runs of unchanged bins have it set
+  uint32_t run = 0;
+  for(uint8_t i = 0; i < this->numBins; i++) {
+    int32_t delta = (int32_t)bins[i] - (int32_t)this->prev[i];
+    this->prev[i] = bins[i];
+    if(delta == 0) {
+      run++;
+      continue;
+    }
+    if(run) {
+      len += scanPutVarint(&p[len], (run << 1) | 0x01);
+      run = 0;
+    }
+    len += scanPutVarint(&p[len], scanZigzag(delta) << 1);
+  }
+  if(run) {
+    len += scanPutVarint(&p[len], (run << 1) | 0x01);
+  }
+
+  return(scanFrame(out, RADIOLIB_SCAN_STREAM_TAG_LINE, len));
+}
+
+uint8_t RadioLibScanDecoder::push(uint8_t b) {
+  if(this->pendingLen >= sizeof(this->pending)) {
+    // poll was not called, give up on the buffered bytes
+    this->errors++;
+    this->pendingLen = 0;
+    this->pendingPos = 0;
+  }
+  this->pending[this->pendingLen++] = b;
+  return(this->poll());
+}
+
+uint8_t RadioLibScanDecoder::poll() {
+  while(this->pendingPos < this->pendingLen) {
+    uint8_t res = this->feed(this->pending[this->pendingPos++]);
+    if(res != RADIOLIB_SCAN_STREAM_NONE) {
+      return(res);
+    }
+  }
+  this->pendingLen = 0;
+  this->pendingPos = 0;
+  return(RADIOLIB_SCAN_STREAM_NONE);
+}
+
+void RadioLibScanDecoder::resync() {
+  // the sync byte may have been noise, so the real record can start anywhere after it
+  this->synced = false;
+  this->errors++;
+  size_t replayLen = this->recordLen - 1;
+  size_t remaining = this->pendingLen - this->pendingPos;
+  memmove(&this->pending[replayLen], &this->pending[this->pendingPos], remaining);
+  memcpy(this->pending, &this->record[1], replayLen);
+  this->pendingLen = replayLen + remaining;
+  this->pendingPos = 0;
+}
+
+uint8_t RadioLibScanDecoder::feed(uint8_t b) {
+  // wait for sync
+  if(!this->synced) {
+    if(b == RADIOLIB_SCAN_STREAM_SYNC) {
+      this->synced = true;
+      this->recordLen = 0;
+      this->expectedLen = RADIOLIB_SCAN_STREAM_HEADER_LEN;
+      this->record[this->recordLen++] = b;
+    }
+    return(RADIOLIB_SCAN_STREAM_NONE);
+  }
+
+  this->record[this->recordLen++] = b;
+
+  // header complete, check the length is plausible
+  if(this->recordLen == RADIOLIB_SCAN_STREAM_HEADER_LEN) {
+    size_t payloadLen = (size_t)this->record[2] | ((size_t)this->record[3] << 8);
+    this->expectedLen = RADIOLIB_SCAN_STREAM_HEADER_LEN + payloadLen + RADIOLIB_SCAN_STREAM_CRC_LEN;
+    if(this->expectedLen > RADIOLIB_SCAN_STREAM_MAX_RECORD_LEN) {
+      this->resync();
+    }
+    return(RADIOLIB_SCAN_STREAM_NONE);
+  }
+
+  if(this->recordLen < this->expectedLen) {
+    return(RADIOLIB_SCAN_STREAM_NONE);
+  }
+
+  this->synced = false;
+  uint16_t crc = (uint16_t)this->record[this->recordLen - 2] | ((uint16_t)this->record[this->recordLen - 1] << 8);
+  if(crc != scanChecksum(&this->record[1], this->recordLen - 3)) {
+    // the lost record may have been a line, so the prediction can no longer be trusted
+    this->nextStep = -1;
+    this->resync();
+    return(RADIOLIB_SCAN_STREAM_NONE);
+  }
+
+  return(this->parse());
+}
+
+uint8_t RadioLibScanDecoder::parse() {
+  const uint8_t* p = &this->record[RADIOLIB_SCAN_STREAM_HEADER_LEN];
+  size_t len = this->recordLen - RADIOLIB_SCAN_STREAM_HEADER_LEN - RADIOLIB_SCAN_STREAM_CRC_LEN;
+
+  if(this->record[1] == RADIOLIB_SCAN_STREAM_TAG_SWEEP) {
+    if((len != RADIOLIB_SCAN_STREAM_SWEEP_LEN) || (p[10] == 0) || (p[10] > RADIOLIB_SCAN_STREAM_MAX_BINS)) {
+      this->errors++;
+      return(RADIOLIB_SCAN_STREAM_NONE);
+    }
+    this->sweep.freqStart = scanGet32(&p[0]);
+    this->sweep.freqStep = scanGet32(&p[4]);
+    this->sweep.numSteps = (uint16_t)p[8] | ((uint16_t)p[9] << 8);
+    this->sweep.numBins = p[10];
+    this->sweep.sequence = scanGet32(&p[11]);
+    this->sweep.timestamp = scanGet32(&p[15]);
+    memset(this->bins, 0x00, sizeof(this->bins));
+    this->nextStep = 0;
+    return(RADIOLIB_SCAN_STREAM_SWEEP);
+  }
+
+  if((this->record[1] != RADIOLIB_SCAN_STREAM_TAG_LINE) || (len < 2)) {
+    this->errors++;
+    return(RADIOLIB_SCAN_STREAM_NONE);
+  }
+
+  // lines are only decodable if all previous lines of the sweep were received
+  uint16_t step = (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+  if((this->nextStep < 0) || (step != this->nextStep)) {
+    this->dropped++;
+    this->nextStep = -1;
+    return(RADIOLIB_SCAN_STREAM_NONE);
+  }
+
+  size_t pos = 2;
+  uint8_t bin = 0;
+  while((pos < len) && (bin < this->sweep.numBins)) {
+    uint32_t token = 0;
+    size_t num = scanGetVarint(&p[pos], len - pos, &token);
+    if(num == 0) {
+      break;
+    }
+    pos += num;
+    if(token & 0x01) {
+      // unchanged bins
+      bin += RADIOLIB_MIN(token >> 1, (uint32_t)(this->sweep.numBins - bin));
+    } else {
+      this->bins[bin] = (int32_t)this->bins[bin] + scanUnzigzag(token >> 1);
+      bin++;
+    }
+  }
+
+  if((pos != len) || (bin != this->sweep.numBins)) {
+    this->errors++;
+    this->nextStep = -1;
+    return(RADIOLIB_SCAN_STREAM_NONE);
+  }
+
+  this->step = step;
+  this->nextStep++;
+  return(RADIOLIB_SCAN_STREAM_LINE);
+}
@@ -0,0 +1,141 @@
+#if !defined(_RADIOLIB_SCAN_STREAM_H)
+#define _RADIOLIB_SCAN_STREAM_H
+
+#include "../TypeDef.h"
+
+// record framing: sync, tag, 16-bit payload length (LSB first), payload, CRC-16/CCITT of tag, length and payload
+#define RADIOLIB_SCAN_STREAM_SYNC                               (0xA5)
+#define RADIOLIB_SCAN_STREAM_TAG_SWEEP                          (0x53)  // 'S', start of a new sweep
+#define RADIOLIB_SCAN_STREAM_TAG_LINE                           (0x4C)  // 'L', one scan line
+#define RADIOLIB_SCAN_STREAM_HEADER_LEN                         (4)
+#define RADIOLIB_SCAN_STREAM_CRC_LEN                            (2)
+
+// maximum number of histogram bins in one scan line (SX126x produces 33)
+#define RADIOLIB_SCAN_STREAM_MAX_BINS                           (33)
+
+// sweep record payload length
+#define RADIOLIB_SCAN_STREAM_SWEEP_LEN                          (19)
+
+// worst case record length, line payload is step index and one 3-byte varint per bin
+#define RADIOLIB_SCAN_STREAM_MAX_RECORD_LEN                     (RADIOLIB_SCAN_STREAM_HEADER_LEN + 2 + 3*RADIOLIB_SCAN_STREAM_MAX_BINS + RADIOLIB_SCAN_STREAM_CRC_LEN)
+
+// decoder results
+#define RADIOLIB_SCAN_STREAM_NONE                               (0)
+#define RADIOLIB_SCAN_STREAM_SWEEP                              (1)
+#define RADIOLIB_SCAN_STREAM_LINE                               (2)
+
+/*!
+  \struct RadioLibScanSweep_t
+  \brief Description of a frequency sweep, sent at the start of every sweep.
+*/
+struct RadioLibScanSweep_t {
+  /*! \brief Frequency of the first step in Hz. */
+  uint32_t freqStart;
+
+  /*! \brief Frequency step in Hz. */
+  uint32_t freqStep;
+
+  /*! \brief Number of frequency steps in the sweep. */
+  uint16_t numSteps;
+
+  /*! \brief Number of histogram bins in each scan line. */
+  uint8_t numBins;
+
+  /*! \brief Sweep sequence number. */
+  uint32_t sequence;
+
+  /*! \brief Timestamp of the sweep start in milliseconds. */
+  uint32_t timestamp;
+};
+
+/*!
+  \class RadioLibScanEncoder
+  \brief Packs spectral scan histograms into a compact binary stream.
+  Each line is delta-coded against the previous line of the same sweep (the neighbouring frequency step),
+  deltas are zigzag varints and runs of unchanged bins are collapsed into a single token.
+*/
+class RadioLibScanEncoder {
+  public:
+    /*!
+      \brief Start a new sweep, resets the line prediction.
+      \param sweep Sweep description.
+      \param out Output buffer, at least RADIOLIB_SCAN_STREAM_MAX_RECORD_LEN bytes.
+      \returns Record length in bytes, 0 if the sweep is invalid.
+    */
+    size_t beginSweep(const RadioLibScanSweep_t& sweep, uint8_t* out);
+
+    /*!
+      \brief Encode one scan line.
+      \param step Frequency step index of the line.
+      \param bins Histogram, numBins values as set in beginSweep.
+      \param out Output buffer, at least RADIOLIB_SCAN_STREAM_MAX_RECORD_LEN bytes.
+      \returns Record length in bytes.
+    */
+    size_t encodeLine(uint16_t step, const uint16_t* bins, uint8_t* out);
+
+#if !RADIOLIB_GODMODE
+  private:
+#endif
+    uint16_t prev[RADIOLIB_SCAN_STREAM_MAX_BINS] = { 0 };
+    uint8_t numBins = 0;
+};
+
+/*!
+  \class RadioLibScanDecoder
+  \brief Decodes the stream produced by RadioLibScanEncoder, one byte at a time.
+  When a record is corrupted, the bytes following its sync byte are searched again for the next record.
+  A line that cannot be predicted because an earlier line of the sweep was lost is dropped,
+  decoding resumes with the next sweep.
+*/
+class RadioLibScanDecoder {
+  public:
+    /*!
+      \brief Process one byte of the stream.
+      \param b Received byte.
+      \returns RADIOLIB_SCAN_STREAM_SWEEP when a sweep record was completed, RADIOLIB_SCAN_STREAM_LINE
+      when a scan line was completed, RADIOLIB_SCAN_STREAM_NONE otherwise. After a record was completed,
+      poll must be called until it returns RADIOLIB_SCAN_STREAM_NONE.
+    */
+    uint8_t push(uint8_t b);
+
+    /*!
+      \brief Continue processing bytes that were buffered while recovering from a corrupted record.
+      \returns Same as push.
+    */
+    uint8_t poll();
+
+    /*! \brief Description of the current sweep. */
+    RadioLibScanSweep_t sweep = { 0, 0, 0, 0, 0, 0 };
+
+    /*! \brief Step index of the last decoded line. */
+    uint16_t step = 0;
+
+    /*! \brief Histogram of the last decoded line. */
+    uint16_t bins[RADIOLIB_SCAN_STREAM_MAX_BINS] = { 0 };
+
+    /*! \brief Number of records dropped due to CRC or framing errors. */
+    uint32_t errors = 0;
+
+    /*! \brief Number of lines dropped because their prediction was lost. */
+    uint32_t dropped = 0;
+
+#if !RADIOLIB_GODMODE
+  private:
+#endif
+    uint8_t record[RADIOLIB_SCAN_STREAM_MAX_RECORD_LEN] = { 0 };
+    size_t recordLen = 0;
+    size_t expectedLen = 0;
+    bool synced = false;
+    int32_t nextStep = -1;
+
+    // bytes waiting to be processed, only more than one after a corrupted record
+    uint8_t pending[RADIOLIB_SCAN_STREAM_MAX_RECORD_LEN + 1] = { 0 };
+    size_t pendingLen = 0;
+    size_t pendingPos = 0;
+
+    uint8_t feed(uint8_t b);
+    void resync();
+    uint8_t parse();
+};
+
+#endif
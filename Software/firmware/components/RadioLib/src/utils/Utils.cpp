@@ -8,11 +8,18 @@
 #include <inttypes.h>
 
 uint32_t rlb_reflect(uint32_t in, uint8_t bits) {
+  static const uint8_t nibbles[16] = {
+    0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE, 0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF
+  };
+
+  // reflect nibble by nibble and drop the extra bits of the last nibble
+  uint8_t num = (bits + 3) / 4;
   uint32_t res = 0;
-  for(uint8_t i = 0; i < bits; i++) {
-    res |= (((in & ((uint32_t)1 << i)) >> i) << (bits - i - 1));
+  for(uint8_t i = 0; i < num; i++) {
+    res = (res << 4) | nibbles[in & 0x0F];
+    in >>= 4;
   }
-  return(res);
+  return(res >> (4*num - bits));
 }
 
 void rlb_hexdump(const char* level, const uint8_t* data, size_t len, uint32_t offset, uint8_t width, bool be) {
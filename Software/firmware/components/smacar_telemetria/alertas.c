@@ -0,0 +1,203 @@
+#include <string.h>
+#include "alertas.h"
+
+// Indice del nodo en la tabla de estado, lo agrega si es nuevo. -1 si no queda sitio
+static int slot_nodo(alertas_t *alertas, uint8_t nodo)
+{
+    for (int i = 0; i < alertas->num_nodos; i++)
+    {
+        if (alertas->nodos[i] == nodo)
+        {
+            return i;
+        }
+    }
+    if (alertas->num_nodos == ALERTAS_MAX_NODOS)
+    {
+        return -1;
+    }
+    alertas->nodos[alertas->num_nodos] = nodo;
+    return alertas->num_nodos++;
+}
+
+static bool tomar_token(alertas_t *alertas, uint8_t evento, uint32_t ahora_ms)
+{
+    const alertas_limite_t *limite = &alertas->limites[evento];
+    alertas_bucket_t *bucket = &alertas->buckets[evento];
+    if (limite->recarga_ms > 0)
+    {
+        uint32_t nuevos = (ahora_ms - bucket->recarga_desde_ms) / limite->recarga_ms;
+        if ((uint32_t)bucket->tokens + nuevos >= limite->capacidad)
+        {
+            bucket->tokens = limite->capacidad;
+        }
+        else
+        {
+            bucket->tokens += (uint16_t)nuevos;
+            bucket->recarga_desde_ms += nuevos * limite->recarga_ms;
+        }
+    }
+    if (bucket->tokens == 0)
+    {
+        return false;
+    }
+    // con el bucket lleno la recarga empieza al gastar el primer token
+    if (bucket->tokens == limite->capacidad)
+    {
+        bucket->recarga_desde_ms = ahora_ms;
+    }
+    bucket->tokens--;
+    return true;
+}
+
+static void avisar(alertas_t *alertas, int regla, uint8_t nodo, uint8_t nivel, float valor, uint32_t ahora_ms,
+                   alertas_aviso_t *avisos, int max_avisos, int *num_avisos)
+{
+    uint8_t evento = alertas->reglas[regla].evento;
+    if (*num_avisos == max_avisos || (nivel > 0 && !tomar_token(alertas, evento, ahora_ms)))
+    {
+        alertas->suprimidos++;
+        return;
+    }
+    alertas_aviso_t *aviso = &avisos[(*num_avisos)++];
+    aviso->regla = (uint8_t)regla;
+    aviso->nodo = nodo;
+    aviso->evento = evento;
+    aviso->nivel = nivel;
+    aviso->valor = valor;
+    if (nivel > 0)
+    {
+        alertas->avisos++;
+    }
+}
+
+void alertas_iniciar(alertas_t *alertas)
+{
+    memset(alertas, 0, sizeof(*alertas));
+}
+
+int alertas_agregar_evento(alertas_t *alertas, uint16_t capacidad, uint32_t recarga_ms)
+{
+    if (alertas->num_eventos == ALERTAS_MAX_EVENTOS || capacidad == 0)
+    {
+        return -1;
+    }
+    int i = alertas->num_eventos++;
+    alertas->limites[i].capacidad = capacidad;
+    alertas->limites[i].recarga_ms = recarga_ms;
+    alertas->buckets[i].tokens = capacidad;
+    alertas->buckets[i].recarga_desde_ms = 0;
+    return i;
+}
+
+int alertas_agregar_regla(alertas_t *alertas, const alertas_regla_t *regla)
+{
+    // el rango reducido por la histeresis no puede quedar vacio: la alerta no volveria nunca a normal
+    if (regla->parametro >= TELEMETRIA_NUM_PARAMETROS || regla->evento >= alertas->num_eventos ||
+        regla->max_nivel == 0 || !(regla->histeresis >= 0) ||
+        !(regla->min + regla->histeresis <= regla->max - regla->histeresis))
+    {
+        return -1;
+    }
+    int i;
+    for (i = 0; i < alertas->num_reglas; i++)
+    {
+        if (alertas->reglas[i].nodo == regla->nodo && alertas->reglas[i].parametro == regla->parametro)
+        {
+            break;
+        }
+    }
+    if (i == ALERTAS_MAX_REGLAS)
+    {
+        return -1;
+    }
+    if (i == alertas->num_reglas)
+    {
+        alertas->num_reglas++;
+    }
+    alertas->reglas[i] = *regla;
+    memset(alertas->estado[i], 0, sizeof(alertas->estado[i]));
+    return i;
+}
+
+void alertas_reiniciar(alertas_t *alertas, uint32_t ahora_ms)
+{
+    memset(alertas->estado, 0, sizeof(alertas->estado));
+    for (int i = 0; i < alertas->num_eventos; i++)
+    {
+        alertas->buckets[i].tokens = alertas->limites[i].capacidad;
+        alertas->buckets[i].recarga_desde_ms = ahora_ms;
+    }
+}
+
+int alertas_evaluar(alertas_t *alertas, const telemetria_lectura_t *lectura, uint32_t ahora_ms,
+                    alertas_aviso_t *avisos, int max_avisos)
+{
+    alertas->lecturas++;
+    int slot = slot_nodo(alertas, lectura->origen);
+    if (slot < 0)
+    {
+        alertas->sin_sitio++;
+        return 0;
+    }
+
+    // una regla del nodo reemplaza a la general del mismo parametro
+    uint32_t propias = 0;
+    for (int i = 0; i < alertas->num_reglas; i++)
+    {
+        if (alertas->reglas[i].nodo == lectura->origen)
+        {
+            propias |= 1UL << alertas->reglas[i].parametro;
+        }
+    }
+
+    int num_avisos = 0;
+    for (int i = 0; i < alertas->num_reglas; i++)
+    {
+        const alertas_regla_t *regla = &alertas->reglas[i];
+        if (regla->nodo != lectura->origen &&
+            (regla->nodo != ALERTAS_CUALQUIER_NODO || (propias & (1UL << regla->parametro)) != 0))
+        {
+            continue;
+        }
+
+        alertas_estado_t *estado = &alertas->estado[i][slot];
+        float valor = telemetria_valor(lectura, (telemetria_parametro_t)regla->parametro);
+        if (valor != valor) // NaN: sensor sin lectura, no cambia el estado
+        {
+            continue;
+        }
+
+        if (estado->nivel == 0)
+        {
+            if (valor >= regla->min && valor <= regla->max)
+            {
+                estado->fuera = false;
+                continue;
+            }
+            if (!estado->fuera)
+            {
+                estado->fuera = true;
+                estado->desde_ms = ahora_ms;
+            }
+            if (ahora_ms - estado->desde_ms >= regla->duracion_ms)
+            {
+                estado->nivel = 1;
+                estado->aviso_ms = ahora_ms;
+                avisar(alertas, i, lectura->origen, 1, valor, ahora_ms, avisos, max_avisos, &num_avisos);
+            }
+        }
+        else if (valor >= regla->min + regla->histeresis && valor <= regla->max - regla->histeresis)
+        {
+            estado->nivel = 0;
+            estado->fuera = false;
+            avisar(alertas, i, lectura->origen, 0, valor, ahora_ms, avisos, max_avisos, &num_avisos);
+        }
+        else if (regla->escalado_ms > 0 && estado->nivel < regla->max_nivel && ahora_ms - estado->aviso_ms >= regla->escalado_ms)
+        {
+            estado->nivel++;
+            estado->aviso_ms = ahora_ms;
+            avisar(alertas, i, lectura->origen, estado->nivel, valor, ahora_ms, avisos, max_avisos, &num_avisos);
+        }
+    }
+    return num_avisos;
+}
@@ -0,0 +1,119 @@
+#include <string.h>
+#include <math.h>
+#include "anomalias.h"
+
+void anomalias_config_defecto(anomalias_config_t *config)
+{
+    // la temperatura en pasos de 0.0625 C y con el ciclo diario: con menos de 0.1 C el CUSUM salta a diario
+    static const float ruido_min[TELEMETRIA_NUM_PARAMETROS] = {0.1f, 2.0f, 0.01f, 1.0f};
+    // la temperatura de un tanque puede quedarse en el mismo paso de 0.0625 C bastante tiempo; el ADC no
+    static const uint16_t atascado_s[TELEMETRIA_NUM_PARAMETROS] = {3600, 300, 300, 300};
+    memset(config, 0, sizeof(*config));
+    config->alfa = 0.02f;
+    config->z_pico = 5.0f;
+    config->cusum_k = 0.75f;
+    config->cusum_h = 8.0f;
+    config->calentamiento = 30;
+    memcpy(config->ruido_min, ruido_min, sizeof(ruido_min));
+    memcpy(config->atascado_s, atascado_s, sizeof(atascado_s));
+}
+
+void anomalias_iniciar(anomalias_t *anomalias)
+{
+    memset(anomalias, 0, sizeof(*anomalias));
+}
+
+static anomalia_t evaluar_parametro(anomalias_parametro_t *p, const anomalias_config_t *config, int i, float x,
+                                    bool riel, uint32_t t, bool aprendiendo)
+{
+    anomalia_t anomalia = ANOMALIA_NINGUNA;
+
+    if (x != p->anterior)
+    {
+        p->igual_desde = t;
+        p->atascado = false;
+    }
+    else if (!p->atascado && config->atascado_s[i] > 0 && t - p->igual_desde >= config->atascado_s[i])
+    {
+        p->atascado = true;
+        anomalia = ANOMALIA_ATASCADO;
+    }
+    p->anterior = x;
+    if (riel && !p->riel)
+    {
+        anomalia = ANOMALIA_RIEL;
+    }
+    p->riel = riel;
+    if (p->riel || p->atascado)
+    {
+        return anomalia;
+    }
+
+    float minima = config->ruido_min[i] * config->ruido_min[i];
+    float sigma = sqrtf(p->varianza > minima ? p->varianza : minima);
+    float z = (x - p->media) / sigma;
+    float recortada = z > config->z_pico ? config->z_pico : z < -config->z_pico ? -config->z_pico : z;
+    if (!aprendiendo)
+    {
+        if (fabsf(z) > config->z_pico)
+        {
+            anomalia = ANOMALIA_PICO;
+        }
+        p->cusum_alto = fmaxf(0.0f, p->cusum_alto + recortada - config->cusum_k);
+        p->cusum_bajo = fmaxf(0.0f, p->cusum_bajo - recortada - config->cusum_k);
+        if (p->cusum_alto > config->cusum_h || p->cusum_bajo > config->cusum_h)
+        {
+            if (anomalia == ANOMALIA_NINGUNA)
+                anomalia = ANOMALIA_CAMBIO;
+            p->cusum_alto = 0;
+            p->cusum_bajo = 0;
+            p->media = x;
+            return anomalia;
+        }
+    }
+
+    // varianza de la EWMA con la misma desviacion recortada, para que un pico no la infle
+    float d = recortada * sigma;
+    p->media += config->alfa * d;
+    p->varianza = (1.0f - config->alfa) * (p->varianza + config->alfa * d * d);
+    return anomalia;
+}
+
+anomalia_t anomalias_evaluar(anomalias_t *anomalias, const anomalias_config_t *config,
+                             const telemetria_lectura_t *lectura, uint8_t riel, uint32_t t, anomalia_t *motivos)
+{
+    anomalia_t peor = ANOMALIA_NINGUNA;
+    for (int i = 0; i < TELEMETRIA_NUM_PARAMETROS; i++)
+    {
+        anomalias_parametro_t *p = &anomalias->parametros[i];
+        float x = telemetria_valor(lectura, (telemetria_parametro_t)i);
+        anomalia_t anomalia = ANOMALIA_NINGUNA;
+        if (anomalias->lecturas == 0)
+        {
+            p->media = x;
+            p->anterior = x;
+            p->igual_desde = t;
+            p->riel = (riel >> i) & 1;
+            anomalia = p->riel ? ANOMALIA_RIEL : ANOMALIA_NINGUNA;
+        }
+        else
+        {
+            anomalia = evaluar_parametro(p, config, i, x, (riel >> i) & 1, t,
+                                         anomalias->lecturas < config->calentamiento);
+        }
+        if (motivos != NULL)
+            motivos[i] = anomalia;
+        if (anomalia > peor)
+            peor = anomalia;
+        if (anomalia != ANOMALIA_NINGUNA)
+            anomalias->detectadas[anomalia]++;
+    }
+    anomalias->lecturas++;
+    return peor;
+}
+
+const char *anomalias_nombre(anomalia_t anomalia)
+{
+    static const char *const nombres[ANOMALIA_NUM] = {"ninguna", "cambio", "pico", "atascado", "riel"};
+    return anomalia < ANOMALIA_NUM ? nombres[anomalia] : "?";
+}
@@ -0,0 +1,244 @@
+#include <string.h>
+#include <float.h>
+#include "comandos.h"
+
+static void escribir_f32(uint8_t *p, float v)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    for (int i = 0; i < 4; i++)
+    {
+        p[i] = (uint8_t)(bits >> (8 * i));
+    }
+}
+
+static float leer_f32(const uint8_t *p)
+{
+    uint32_t bits = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+// bytes del comando sin contar el tipo, 0 si el tipo no existe
+static size_t longitud_comando(uint8_t tipo)
+{
+    switch (tipo)
+    {
+    case COMANDO_PERIODO:
+        return 2;
+    case COMANDO_SILENCIO:
+        return 4;
+    case COMANDO_LOTE:
+        return 1;
+    case COMANDO_UMBRAL:
+    case COMANDO_CALIBRACION:
+        return 9;
+    case COMANDO_POLITICA:
+        return 13;
+    default:
+        return 0;
+    }
+}
+
+void comandos_config_defecto(comandos_config_t *config, uint16_t periodo_s)
+{
+    memset(config, 0, sizeof(*config));
+    config->periodo_s = periodo_s;
+    config->lote = 1;
+    config->silencio_s = COMANDOS_SILENCIO_DEFECTO_S;
+    for (int i = 0; i < TELEMETRIA_NUM_PARAMETROS; i++)
+    {
+        config->umbral_min[i] = -FLT_MAX;
+        config->umbral_max[i] = FLT_MAX;
+        config->ganancia[i] = 1.0f;
+        config->offset[i] = 0.0f;
+    }
+}
+
+size_t comandos_codificar(uint8_t destino, uint8_t id, const comando_t *comandos, int num_comandos, uint8_t *trama)
+{
+    size_t pos = 3;
+    trama[0] = TELEMETRIA_CTRL_COMANDO;
+    trama[1] = destino;
+    trama[2] = id;
+    for (int i = 0; i < num_comandos; i++)
+    {
+        const comando_t *c = &comandos[i];
+        size_t len = longitud_comando(c->tipo);
+        if (len == 0 || pos + 1 + len > COMANDOS_MAX_LEN)
+        {
+            return 0;
+        }
+        uint8_t *p = &trama[pos];
+        p[0] = (uint8_t)c->tipo;
+        switch (c->tipo)
+        {
+        case COMANDO_PERIODO:
+            p[1] = (uint8_t)c->valor.periodo_s;
+            p[2] = (uint8_t)(c->valor.periodo_s >> 8);
+            break;
+        case COMANDO_LOTE:
+            p[1] = c->valor.lote;
+            break;
+        case COMANDO_UMBRAL:
+            p[1] = (uint8_t)c->parametro;
+            escribir_f32(&p[2], c->valor.umbral.min);
+            escribir_f32(&p[6], c->valor.umbral.max);
+            break;
+        case COMANDO_CALIBRACION:
+            p[1] = (uint8_t)c->parametro;
+            escribir_f32(&p[2], c->valor.calibracion.ganancia);
+            escribir_f32(&p[6], c->valor.calibracion.offset);
+            break;
+        case COMANDO_POLITICA:
+            p[1] = (uint8_t)c->parametro;
+            escribir_f32(&p[2], c->valor.politica.banda);
+            escribir_f32(&p[6], c->valor.politica.pendiente);
+            escribir_f32(&p[10], c->valor.politica.margen);
+            break;
+        case COMANDO_SILENCIO:
+            p[1] = (uint8_t)c->valor.silencio.silencio_s;
+            p[2] = (uint8_t)(c->valor.silencio.silencio_s >> 8);
+            p[3] = (uint8_t)c->valor.silencio.rapido_s;
+            p[4] = (uint8_t)(c->valor.silencio.rapido_s >> 8);
+            break;
+        }
+        pos += 1 + len;
+    }
+    return pos;
+}
+
+comandos_resultado_t comandos_aplicar(const uint8_t *trama, size_t len, uint8_t origen, comandos_config_t *config, uint8_t *id)
+{
+    if (len < 3 || trama[0] != TELEMETRIA_CTRL_COMANDO)
+    {
+        return COMANDOS_INVALIDO;
+    }
+    *id = trama[2];
+    if (trama[1] != origen && trama[1] != COMANDOS_DIFUSION)
+    {
+        return COMANDOS_OTRO_DESTINO;
+    }
+    if (config->id_valido && config->ultimo_id == trama[2])
+    {
+        return COMANDOS_DUPLICADO;
+    }
+
+    // se aplica sobre una copia: si un comando es invalido, la configuracion no cambia
+    comandos_config_t nueva = *config;
+    size_t pos = 3;
+    while (pos < len)
+    {
+        const uint8_t *p = &trama[pos];
+        size_t n = longitud_comando(p[0]);
+        if (n == 0 || pos + 1 + n > len)
+        {
+            return COMANDOS_INVALIDO;
+        }
+        switch (p[0])
+        {
+        case COMANDO_PERIODO:
+        {
+            uint16_t periodo = (uint16_t)(p[1] | (p[2] << 8));
+            if (periodo == 0)
+                return COMANDOS_INVALIDO;
+            nueva.periodo_s = periodo;
+            break;
+        }
+        case COMANDO_LOTE:
+            if (p[1] == 0 || p[1] > COMANDOS_MAX_LOTE)
+                return COMANDOS_INVALIDO;
+            nueva.lote = p[1];
+            break;
+        case COMANDO_UMBRAL:
+        {
+            float min = leer_f32(&p[2]);
+            float max = leer_f32(&p[6]);
+            // !(min <= max) tambien descarta NaN
+            if (p[1] >= TELEMETRIA_NUM_PARAMETROS || !(min <= max))
+                return COMANDOS_INVALIDO;
+            nueva.umbral_min[p[1]] = min;
+            nueva.umbral_max[p[1]] = max;
+            break;
+        }
+        case COMANDO_CALIBRACION:
+        {
+            float ganancia = leer_f32(&p[2]);
+            float offset = leer_f32(&p[6]);
+            if (p[1] >= TELEMETRIA_NUM_PARAMETROS || !(ganancia == ganancia) || !(offset == offset))
+                return COMANDOS_INVALIDO;
+            nueva.ganancia[p[1]] = ganancia;
+            nueva.offset[p[1]] = offset;
+            break;
+        }
+        case COMANDO_POLITICA:
+        {
+            float banda = leer_f32(&p[2]);
+            float pendiente = leer_f32(&p[6]);
+            float margen = leer_f32(&p[10]);
+            // !(x >= 0) tambien descarta NaN
+            if (p[1] >= TELEMETRIA_NUM_PARAMETROS || !(banda >= 0) || !(pendiente >= 0) || !(margen >= 0))
+                return COMANDOS_INVALIDO;
+            nueva.banda[p[1]] = banda;
+            nueva.pendiente[p[1]] = pendiente;
+            nueva.margen[p[1]] = margen;
+            break;
+        }
+        case COMANDO_SILENCIO:
+        {
+            uint16_t silencio = (uint16_t)(p[1] | (p[2] << 8));
+            if (silencio == 0)
+                return COMANDOS_INVALIDO;
+            nueva.silencio_s = silencio;
+            nueva.rapido_s = (uint16_t)(p[3] | (p[4] << 8));
+            break;
+        }
+        }
+        pos += 1 + n;
+    }
+
+    nueva.id_valido = true;
+    nueva.ultimo_id = trama[2];
+    *config = nueva;
+    return COMANDOS_APLICADO;
+}
+
+float comandos_calibrar(const comandos_config_t *config, telemetria_parametro_t parametro, float valor)
+{
+    return valor * config->ganancia[parametro] + config->offset[parametro];
+}
+
+bool comandos_fuera_de_umbral(const comandos_config_t *config, const telemetria_lectura_t *lectura)
+{
+    for (int i = 0; i < TELEMETRIA_NUM_PARAMETROS; i++)
+    {
+        float v = telemetria_valor(lectura, (telemetria_parametro_t)i);
+        if (v < config->umbral_min[i] || v > config->umbral_max[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t comandos_codificar_ack(uint8_t origen, uint8_t id, comandos_resultado_t resultado, uint8_t *trama)
+{
+    trama[0] = TELEMETRIA_CTRL_ACK;
+    trama[1] = origen;
+    trama[2] = id;
+    trama[3] = (uint8_t)resultado;
+    return COMANDOS_ACK_LEN;
+}
+
+bool comandos_decodificar_ack(const uint8_t *trama, size_t len, uint8_t *origen, uint8_t *id, comandos_resultado_t *resultado)
+{
+    if (len != COMANDOS_ACK_LEN || trama[0] != TELEMETRIA_CTRL_ACK)
+    {
+        return false;
+    }
+    *origen = trama[1];
+    *id = trama[2];
+    *resultado = (comandos_resultado_t)trama[3];
+    return true;
+}
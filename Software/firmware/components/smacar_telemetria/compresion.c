@@ -0,0 +1,262 @@
+#include <string.h>
+#include <math.h>
+#include "compresion.h"
+
+#define ENTERO_MAX (1L << 29)
+#define ENTERO_NAN (ENTERO_MAX + 1) // NaN en COMPRESION_ENTEROS; las diferencias siguen cabiendo en 32 bits
+
+const float compresion_escalas_telemetria[COMPRESION_MAX_VALORES] = {100.0f, 1.0f, 100.0f, 10.0f, 1.0f};
+
+// bits de cada codigo de longitud variable, despues del prefijo 10 / 110 / 1110 / 1111
+static const uint8_t anchos_t[4] = {7, 9, 12, 32};
+static const uint8_t anchos_entero[4] = {4, 8, 16, 32};
+
+// n <= 32 bits, del mas significativo al menos; el buffer esta a cero
+static bool poner(compresion_t *bloque, uint32_t valor, int n)
+{
+    if (bloque->bits + n > bloque->capacidad * 8)
+    {
+        return false;
+    }
+    while (n > 0)
+    {
+        int libres = 8 - (int)(bloque->bits & 7);
+        int k = n < libres ? n : libres;
+        uint8_t trozo = (uint8_t)((valor >> (n - k)) & ((1u << k) - 1));
+        bloque->datos[bloque->bits >> 3] |= (uint8_t)(trozo << (libres - k));
+        bloque->bits += k;
+        n -= k;
+    }
+    return true;
+}
+
+static bool tomar(compresion_t *bloque, int n, uint32_t *valor)
+{
+    if (bloque->bits + n > bloque->total_bits)
+    {
+        return false;
+    }
+    uint32_t v = 0;
+    while (n > 0)
+    {
+        int libres = 8 - (int)(bloque->bits & 7);
+        int k = n < libres ? n : libres;
+        uint8_t byte = bloque->datos[bloque->bits >> 3];
+        v = (v << k) | ((byte >> (libres - k)) & ((1u << k) - 1));
+        bloque->bits += k;
+        n -= k;
+    }
+    *valor = v;
+    return true;
+}
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t deshacer_zigzag(uint32_t z)
+{
+    return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+static bool poner_variable(compresion_t *bloque, uint32_t z, const uint8_t *anchos)
+{
+    if (z == 0)
+    {
+        return poner(bloque, 0, 1);
+    }
+    int k = 0;
+    while (k < 3 && (uint64_t)z >= (1ULL << anchos[k]))
+    {
+        k++;
+    }
+    // prefijos 10, 110, 1110 y 1111
+    uint32_t prefijo = k < 3 ? (1u << (k + 2)) - 2 : 0xF;
+    int largo = k < 3 ? k + 2 : 4;
+    return poner(bloque, prefijo, largo) && poner(bloque, z, anchos[k]);
+}
+
+static bool tomar_variable(compresion_t *bloque, const uint8_t *anchos, uint32_t *z)
+{
+    // cuenta los 1 del prefijo, hasta 4
+    uint32_t bit = 1;
+    int unos = 0;
+    while (unos < 4)
+    {
+        if (!tomar(bloque, 1, &bit))
+            return false;
+        if (bit == 0)
+            break;
+        unos++;
+    }
+    if (unos == 0)
+    {
+        *z = 0;
+        return true;
+    }
+    return tomar(bloque, anchos[unos - 1], z);
+}
+
+static int32_t cuantizar(float valor, float escala)
+{
+    float v = valor * escala;
+    if (v != v)
+        return ENTERO_NAN;
+    if (v <= -(float)ENTERO_MAX)
+        return -ENTERO_MAX;
+    if (v >= (float)ENTERO_MAX)
+        return ENTERO_MAX;
+    return (int32_t)(v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+static bool poner_valor(compresion_t *bloque, int i, float valor)
+{
+    if (bloque->modo == COMPRESION_ENTEROS)
+    {
+        int32_t q = cuantizar(valor, bloque->escalas[i]);
+        uint32_t z = zigzag(q - (int32_t)bloque->previo[i]);
+        bloque->previo[i] = (uint32_t)q;
+        return poner_variable(bloque, z, anchos_entero);
+    }
+
+    uint32_t bits;
+    memcpy(&bits, &valor, sizeof(bits));
+    uint32_t x = bits ^ bloque->previo[i];
+    bloque->previo[i] = bits;
+    if (x == 0)
+    {
+        return poner(bloque, 0, 1);
+    }
+    int delante = __builtin_clz(x);
+    int detras = __builtin_ctz(x);
+    int sig_previo = bloque->significativos[i];
+    if (sig_previo > 0 && delante >= bloque->delante[i] && detras >= 32 - bloque->delante[i] - sig_previo)
+    {
+        // cabe en la ventana del valor anterior
+        return poner(bloque, 2, 2) && poner(bloque, x >> (32 - bloque->delante[i] - sig_previo), sig_previo);
+    }
+    int significativos = 32 - delante - detras;
+    bloque->delante[i] = (uint8_t)delante;
+    bloque->significativos[i] = (uint8_t)significativos;
+    return poner(bloque, 3, 2) && poner(bloque, (uint32_t)delante, 5) &&
+           poner(bloque, (uint32_t)(significativos - 1), 5) && poner(bloque, x >> detras, significativos);
+}
+
+static bool tomar_valor(compresion_t *bloque, int i, float *valor)
+{
+    uint32_t z;
+    if (bloque->modo == COMPRESION_ENTEROS)
+    {
+        if (!tomar_variable(bloque, anchos_entero, &z))
+            return false;
+        int32_t q = (int32_t)bloque->previo[i] + deshacer_zigzag(z);
+        bloque->previo[i] = (uint32_t)q;
+        *valor = q == ENTERO_NAN ? NAN : q / bloque->escalas[i];
+        return true;
+    }
+
+    uint32_t control, x = 0;
+    if (!tomar(bloque, 1, &control))
+        return false;
+    if (control == 1)
+    {
+        uint32_t nueva, delante, significativos;
+        if (!tomar(bloque, 1, &nueva))
+            return false;
+        if (nueva == 1)
+        {
+            if (!tomar(bloque, 5, &delante) || !tomar(bloque, 5, &significativos))
+                return false;
+            if (delante + significativos + 1 > 32) // bloque corrupto: la ventana no cabe en 32 bits
+                return false;
+            bloque->delante[i] = (uint8_t)delante;
+            bloque->significativos[i] = (uint8_t)(significativos + 1);
+        }
+        int sig = bloque->significativos[i];
+        if (sig == 0 || !tomar(bloque, sig, &x))
+            return false;
+        x <<= 32 - bloque->delante[i] - sig;
+    }
+    uint32_t bits = bloque->previo[i] ^ x;
+    bloque->previo[i] = bits;
+    memcpy(valor, &bits, sizeof(bits));
+    return true;
+}
+
+void compresion_iniciar(compresion_t *bloque, compresion_modo_t modo, uint8_t num_valores, const float *escalas,
+                        uint8_t *datos, size_t capacidad)
+{
+    memset(bloque, 0, sizeof(*bloque));
+    bloque->datos = datos;
+    bloque->capacidad = capacidad;
+    bloque->modo = (uint8_t)modo;
+    bloque->num_valores = num_valores > COMPRESION_MAX_VALORES ? COMPRESION_MAX_VALORES : num_valores;
+    bloque->escalas = escalas;
+    memset(datos, 0, capacidad);
+}
+
+bool compresion_agregar(compresion_t *bloque, uint32_t t, const float *valores)
+{
+    compresion_t antes = *bloque;
+    int32_t delta = (int32_t)(t - bloque->t);
+    bool ok = poner_variable(bloque, zigzag(delta - bloque->delta), anchos_t);
+    bloque->t = t;
+    bloque->delta = delta;
+    for (int i = 0; ok && i < bloque->num_valores; i++)
+    {
+        ok = poner_valor(bloque, i, valores[i]);
+    }
+    if (!ok)
+    {
+        // borra los bits que llegaron a escribirse
+        size_t byte = antes.bits >> 3;
+        if (antes.bits & 7)
+        {
+            bloque->datos[byte] &= (uint8_t)(0xFF << (8 - (antes.bits & 7)));
+            byte++;
+        }
+        memset(&bloque->datos[byte], 0, bloque->capacidad - byte);
+        *bloque = antes;
+        return false;
+    }
+    bloque->muestras++;
+    return true;
+}
+
+size_t compresion_len(const compresion_t *bloque)
+{
+    return (bloque->bits + 7) / 8;
+}
+
+void compresion_abrir(compresion_t *bloque, compresion_modo_t modo, uint8_t num_valores, const float *escalas,
+                      const uint8_t *datos, size_t len, uint16_t muestras)
+{
+    memset(bloque, 0, sizeof(*bloque));
+    bloque->datos = (uint8_t *)datos; // solo se lee
+    bloque->capacidad = len;
+    bloque->total_bits = len * 8;
+    bloque->modo = (uint8_t)modo;
+    bloque->num_valores = num_valores > COMPRESION_MAX_VALORES ? COMPRESION_MAX_VALORES : num_valores;
+    bloque->escalas = escalas;
+    bloque->muestras = muestras;
+}
+
+bool compresion_leer(compresion_t *bloque, uint32_t *t, float *valores)
+{
+    uint32_t z;
+    if (bloque->muestras == 0 || !tomar_variable(bloque, anchos_t, &z))
+    {
+        return false;
+    }
+    bloque->delta += deshacer_zigzag(z);
+    bloque->t += (uint32_t)bloque->delta;
+    *t = bloque->t;
+    for (int i = 0; i < bloque->num_valores; i++)
+    {
+        if (!tomar_valor(bloque, i, &valores[i]))
+            return false;
+    }
+    bloque->muestras--;
+    return true;
+}
@@ -0,0 +1,101 @@
+#include <string.h>
+#include "conexion.h"
+
+static uint32_t aleatorio(conexion_t *conexion)
+{
+    // xorshift32: no hace falta calidad, solo que cada receptor espere distinto
+    uint32_t x = conexion->semilla;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    conexion->semilla = x;
+    return x;
+}
+
+void conexion_iniciar(conexion_t *conexion, uint32_t espera_min_ms, uint32_t espera_max_ms, uint32_t semilla,
+                      uint32_t ahora_ms)
+{
+    memset(conexion, 0, sizeof(*conexion));
+    conexion->espera_min_ms = espera_min_ms;
+    conexion->espera_max_ms = espera_max_ms;
+    conexion->semilla = semilla != 0 ? semilla : 1;
+    conexion->sin_ip_ms = ahora_ms;
+}
+
+void conexion_intento(conexion_t *conexion, uint32_t ahora_ms)
+{
+    conexion->estado = CONEXION_CONECTANDO;
+    conexion->intento_ms = ahora_ms;
+    conexion->intentos++;
+}
+
+void conexion_ip(conexion_t *conexion, uint32_t ahora_ms)
+{
+    if (conexion->estado == CONEXION_CON_IP)
+    {
+        return;
+    }
+    conexion->hasta_ip_ms = ahora_ms - conexion->intento_ms;
+    conexion->reconexion_ms = ahora_ms - conexion->sin_ip_ms;
+    if (conexion->hasta_ip_ms > conexion->max_hasta_ip_ms)
+        conexion->max_hasta_ip_ms = conexion->hasta_ip_ms;
+    if (conexion->reconexion_ms > conexion->max_reconexion_ms)
+        conexion->max_reconexion_ms = conexion->reconexion_ms;
+    conexion->suma_hasta_ip_ms += conexion->hasta_ip_ms;
+    conexion->suma_reconexion_ms += conexion->reconexion_ms;
+    conexion->conexiones++;
+    conexion->estado = CONEXION_CON_IP;
+    conexion->ip_ms = ahora_ms;
+}
+
+uint32_t conexion_caida(conexion_t *conexion, uint32_t ahora_ms)
+{
+    if (conexion->estado == CONEXION_CON_IP)
+    {
+        conexion->caidas++;
+        conexion->sin_ip_ms = ahora_ms;
+        if (ahora_ms - conexion->ip_ms >= CONEXION_ESTABLE_MS)
+        {
+            conexion->fallos = 0;
+        }
+    }
+    uint32_t tope = conexion->espera_max_ms;
+    if (conexion->fallos < CONEXION_MAX_EXPONENTE && (conexion->espera_min_ms << conexion->fallos) < tope)
+    {
+        tope = conexion->espera_min_ms << conexion->fallos;
+    }
+    if (conexion->fallos < CONEXION_MAX_EXPONENTE)
+    {
+        conexion->fallos++;
+    }
+    conexion->estado = CONEXION_ESPERANDO;
+    return tope / 2 + aleatorio(conexion) % (tope / 2 + 1);
+}
+
+void conexion_actividad(conexion_t *conexion, uint32_t ahora_ms)
+{
+    conexion->actividad = true;
+    conexion->actividad_ms = ahora_ms;
+}
+
+conexion_ahorro_t conexion_ahorro(const conexion_t *conexion, uint32_t ahora_ms)
+{
+    if (conexion->estado != CONEXION_CON_IP)
+    {
+        return CONEXION_AHORRO_NINGUNO;
+    }
+    if (conexion->actividad && ahora_ms - conexion->actividad_ms < CONEXION_ACTIVO_MS)
+    {
+        return CONEXION_AHORRO_MIN;
+    }
+    return CONEXION_AHORRO_MAX;
+}
+
+uint32_t conexion_proximo_ahorro(const conexion_t *conexion, uint32_t ahora_ms)
+{
+    if (conexion_ahorro(conexion, ahora_ms) != CONEXION_AHORRO_MIN)
+    {
+        return 0;
+    }
+    return CONEXION_ACTIVO_MS - (ahora_ms - conexion->actividad_ms);
+}
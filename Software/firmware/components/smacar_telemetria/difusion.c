@@ -0,0 +1,150 @@
+#include <string.h>
+#include "difusion.h"
+
+static difusion_cliente_t *buscar(difusion_t *difusion, int fd)
+{
+    for (int i = 0; i < DIFUSION_MAX_CLIENTES; i++)
+    {
+        if (difusion->clientes[i].fd == fd)
+        {
+            return &difusion->clientes[i];
+        }
+    }
+    return NULL;
+}
+
+void difusion_iniciar(difusion_t *difusion)
+{
+    memset(difusion, 0, sizeof(*difusion));
+    for (int i = 0; i < DIFUSION_MAX_CLIENTES; i++)
+    {
+        difusion->clientes[i].fd = DIFUSION_LIBRE;
+    }
+}
+
+bool difusion_conectar(difusion_t *difusion, int fd, uint32_t ahora_ms)
+{
+    if (fd == DIFUSION_LIBRE)
+    {
+        return false;
+    }
+    if (buscar(difusion, fd) != NULL)
+    {
+        return true; // ya conectado
+    }
+    difusion_cliente_t *cliente = buscar(difusion, DIFUSION_LIBRE);
+    if (cliente == NULL)
+    {
+        difusion->rechazados++;
+        return false;
+    }
+    memset(cliente, 0, sizeof(*cliente));
+    cliente->fd = fd;
+    cliente->progreso_ms = ahora_ms;
+    difusion->num_clientes++;
+    return true;
+}
+
+void difusion_desconectar(difusion_t *difusion, int fd)
+{
+    difusion_cliente_t *cliente = buscar(difusion, fd);
+    if (cliente != NULL && fd != DIFUSION_LIBRE)
+    {
+        cliente->fd = DIFUSION_LIBRE;
+        difusion->num_clientes--;
+    }
+}
+
+void difusion_publicar(difusion_t *difusion, const uint8_t *mensaje, uint32_t ahora_ms)
+{
+    difusion->publicados++;
+    for (int i = 0; i < DIFUSION_MAX_CLIENTES; i++)
+    {
+        difusion_cliente_t *cliente = &difusion->clientes[i];
+        if (cliente->fd == DIFUSION_LIBRE)
+            continue;
+        if (cliente->num == 0 && !cliente->en_vuelo)
+        {
+            cliente->progreso_ms = ahora_ms; // empieza a contar la espera
+        }
+        if (cliente->num == DIFUSION_COLA)
+        {
+            // cola llena: se pierde el mas viejo
+            cliente->primero = (cliente->primero + 1) & (DIFUSION_COLA - 1);
+            cliente->num--;
+            cliente->descartados++;
+        }
+        uint16_t pos = (cliente->primero + cliente->num) & (DIFUSION_COLA - 1);
+        memcpy(cliente->cola[pos], mensaje, DIFUSION_MENSAJE_LEN);
+        cliente->publicado_ms[pos] = ahora_ms;
+        cliente->num++;
+    }
+}
+
+const uint8_t *difusion_siguiente(difusion_t *difusion, int fd, uint32_t *publicado_ms)
+{
+    difusion_cliente_t *cliente = buscar(difusion, fd);
+    if (cliente == NULL || fd == DIFUSION_LIBRE || cliente->en_vuelo || cliente->num == 0)
+    {
+        return NULL;
+    }
+    memcpy(cliente->enviando, cliente->cola[cliente->primero], DIFUSION_MENSAJE_LEN);
+    if (publicado_ms != NULL)
+    {
+        *publicado_ms = cliente->publicado_ms[cliente->primero];
+    }
+    cliente->primero = (cliente->primero + 1) & (DIFUSION_COLA - 1);
+    cliente->num--;
+    cliente->en_vuelo = true;
+    return cliente->enviando;
+}
+
+void difusion_enviado(difusion_t *difusion, int fd, bool ok, uint32_t ahora_ms)
+{
+    difusion_cliente_t *cliente = buscar(difusion, fd);
+    if (cliente != NULL && fd != DIFUSION_LIBRE && cliente->en_vuelo)
+    {
+        cliente->en_vuelo = false;
+        if (ok)
+        {
+            cliente->enviados++;
+            cliente->progreso_ms = ahora_ms;
+        }
+    }
+}
+
+int difusion_atascado(const difusion_t *difusion, uint32_t ahora_ms)
+{
+    for (int i = 0; i < DIFUSION_MAX_CLIENTES; i++)
+    {
+        const difusion_cliente_t *cliente = &difusion->clientes[i];
+        if (cliente->fd != DIFUSION_LIBRE && (cliente->en_vuelo || cliente->num > 0) &&
+            ahora_ms - cliente->progreso_ms >= DIFUSION_ATASCO_MS)
+        {
+            return cliente->fd;
+        }
+    }
+    return DIFUSION_LIBRE;
+}
+
+void difusion_codificar(const telemetria_lectura_t *lectura, uint32_t t, uint8_t *mensaje)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        mensaje[i] = (uint8_t)(t >> (8 * i));
+    }
+    telemetria_lectura_t sin_ventana = *lectura;
+    sin_ventana.ventana = false;
+    telemetria_codificar(&sin_ventana, &mensaje[4]);
+}
+
+bool difusion_decodificar(const uint8_t *mensaje, size_t len, telemetria_lectura_t *lectura, uint32_t *t)
+{
+    if (len != DIFUSION_MENSAJE_LEN)
+    {
+        return false;
+    }
+    *t = (uint32_t)mensaje[0] | ((uint32_t)mensaje[1] << 8) | ((uint32_t)mensaje[2] << 16) |
+         ((uint32_t)mensaje[3] << 24);
+    return telemetria_decodificar(&mensaje[4], TELEMETRIA_LEN, lectura);
+}
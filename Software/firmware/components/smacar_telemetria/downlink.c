@@ -0,0 +1,218 @@
+#include <string.h>
+#include "downlink.h"
+
+static downlink_nodo_t *buscar(downlink_t *dl, uint8_t nodo)
+{
+    for (int i = 0; i < DOWNLINK_MAX_NODOS; i++)
+    {
+        if (dl->nodos[i].activo && dl->nodos[i].nodo == nodo)
+        {
+            return &dl->nodos[i];
+        }
+    }
+    return NULL;
+}
+
+static downlink_nodo_t *buscar_o_crear(downlink_t *dl, uint8_t nodo, uint8_t clase)
+{
+    downlink_nodo_t *n = buscar(dl, nodo);
+    if (n != NULL)
+    {
+        return n;
+    }
+    for (int i = 0; i < DOWNLINK_MAX_NODOS; i++)
+    {
+        if (!dl->nodos[i].activo)
+        {
+            n = &dl->nodos[i];
+            memset(n, 0, sizeof(*n));
+            n->activo = true;
+            n->nodo = nodo;
+            n->clase = clase;
+            return n;
+        }
+    }
+    return NULL;
+}
+
+static downlink_trama_t *cabeza(downlink_nodo_t *n)
+{
+    return n->num > 0 ? &n->cola[n->cabeza] : NULL;
+}
+
+static void sacar(downlink_nodo_t *n)
+{
+    n->cabeza = (n->cabeza + 1) % DOWNLINK_COLA;
+    n->num--;
+}
+
+// Trama en cabeza que se puede transmitir, descartando las que agotaron sus intentos
+static downlink_trama_t *siguiente(downlink_t *dl, downlink_nodo_t *n)
+{
+    downlink_trama_t *t;
+    while ((t = cabeza(n)) != NULL && t->intentos >= DOWNLINK_MAX_INTENTOS)
+    {
+        sacar(n);
+        dl->descartados++;
+    }
+    return t;
+}
+
+static bool toca_clase_c(const downlink_trama_t *t, uint32_t ahora_ms)
+{
+    return t->intentos == 0 || (uint32_t)(ahora_ms - t->enviado_ms) >= DOWNLINK_REINTENTO_MS;
+}
+
+void downlink_iniciar(downlink_t *dl)
+{
+    memset(dl, 0, sizeof(*dl));
+}
+
+bool downlink_registrar(downlink_t *dl, uint8_t nodo, uint8_t clase)
+{
+    downlink_nodo_t *n = buscar_o_crear(dl, nodo, clase);
+    if (n == NULL)
+    {
+        return false;
+    }
+    n->clase = clase;
+    return true;
+}
+
+static bool encolar(downlink_nodo_t *n, uint8_t id, const uint8_t *trama, size_t len)
+{
+    if (n->num == DOWNLINK_COLA)
+    {
+        return false;
+    }
+    downlink_trama_t *t = &n->cola[(n->cabeza + n->num) % DOWNLINK_COLA];
+    t->id = id;
+    t->len = (uint8_t)len;
+    t->intentos = 0;
+    t->enviado_ms = 0;
+    memcpy(t->trama, trama, len);
+    n->num++;
+    return true;
+}
+
+int downlink_programar(downlink_t *dl, uint8_t destino, const comando_t *comandos, int num_comandos, int *num_nodos)
+{
+    uint8_t trama[COMANDOS_MAX_LEN];
+    uint8_t id = dl->siguiente_id;
+    size_t len = comandos_codificar(destino, id, comandos, num_comandos, trama);
+    int programados = 0;
+    if (len > 0)
+    {
+        if (destino == COMANDOS_DIFUSION)
+        {
+            for (int i = 0; i < DOWNLINK_MAX_NODOS; i++)
+            {
+                if (dl->nodos[i].activo && encolar(&dl->nodos[i], id, trama, len))
+                {
+                    programados++;
+                }
+            }
+        }
+        else
+        {
+            downlink_nodo_t *n = buscar_o_crear(dl, destino, TELEMETRIA_CLASE_A);
+            if (n != NULL && encolar(n, id, trama, len))
+            {
+                programados++;
+            }
+        }
+    }
+    if (num_nodos != NULL)
+    {
+        *num_nodos = programados;
+    }
+    if (programados == 0)
+    {
+        return -1;
+    }
+    dl->siguiente_id++;
+    return id;
+}
+
+size_t downlink_para_uplink(downlink_t *dl, uint8_t nodo, uint32_t ahora_ms, uint8_t *trama)
+{
+    downlink_nodo_t *n = buscar(dl, nodo);
+    downlink_trama_t *t = n != NULL ? siguiente(dl, n) : NULL;
+    if (t == NULL)
+    {
+        return 0;
+    }
+    t->intentos++;
+    t->enviado_ms = ahora_ms;
+    dl->enviados++;
+    memcpy(trama, t->trama, t->len);
+    return t->len;
+}
+
+size_t downlink_para_clase_c(downlink_t *dl, uint32_t ahora_ms, uint8_t *trama)
+{
+    // los ACK de la anterior chocarian con esta, y el receptor no los oye mientras transmite
+    if (dl->clase_c_enviada && (uint32_t)(ahora_ms - dl->clase_c_ms) < DOWNLINK_ESPERA_ACK_MS)
+    {
+        return 0;
+    }
+    downlink_trama_t *elegida = NULL;
+    for (int i = 0; i < DOWNLINK_MAX_NODOS && elegida == NULL; i++)
+    {
+        downlink_nodo_t *n = &dl->nodos[i];
+        if (!n->activo || n->clase != TELEMETRIA_CLASE_C)
+            continue;
+        downlink_trama_t *t = siguiente(dl, n);
+        if (t != NULL && toca_clase_c(t, ahora_ms))
+            elegida = t;
+    }
+    if (elegida == NULL)
+    {
+        return 0;
+    }
+    size_t len = elegida->len;
+    memcpy(trama, elegida->trama, len);
+
+    // la misma trama (multicast) pendiente en otros nodos clase C sale en esta transmision
+    for (int i = 0; i < DOWNLINK_MAX_NODOS; i++)
+    {
+        downlink_nodo_t *n = &dl->nodos[i];
+        if (!n->activo || n->clase != TELEMETRIA_CLASE_C)
+            continue;
+        downlink_trama_t *t = cabeza(n);
+        if (t != NULL && t->len == len && memcmp(t->trama, trama, len) == 0 && toca_clase_c(t, ahora_ms))
+        {
+            t->intentos++;
+            t->enviado_ms = ahora_ms;
+        }
+    }
+    dl->clase_c_enviada = true;
+    dl->clase_c_ms = ahora_ms;
+    dl->enviados++;
+    return len;
+}
+
+void downlink_ack(downlink_t *dl, uint8_t nodo, uint8_t id)
+{
+    downlink_nodo_t *n = buscar(dl, nodo);
+    downlink_trama_t *t = n != NULL ? cabeza(n) : NULL;
+    if (t != NULL && t->id == id)
+    {
+        sacar(n);
+        dl->confirmados++;
+    }
+}
+
+int downlink_pendientes(const downlink_t *dl, uint8_t nodo)
+{
+    int total = 0;
+    for (int i = 0; i < DOWNLINK_MAX_NODOS; i++)
+    {
+        const downlink_nodo_t *n = &dl->nodos[i];
+        if (n->activo && (nodo == COMANDOS_DIFUSION || n->nodo == nodo))
+        {
+            total += n->num;
+        }
+    }
+    return total;
+}
@@ -0,0 +1,100 @@
+#ifndef ALERTAS_H
+#define ALERTAS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "telemetria.h"
+
+// Motor de reglas de alerta del receptor. Cada regla vigila un parametro de un nodo (o de todos) y pasa por:
+//  - normal -> fuera de rango: el valor sale de [min, max]; tiene que seguir fuera duracion_ms para disparar
+//  - activa (nivel 1..max_nivel): si sigue fuera escalado_ms desde el ultimo aviso, sube de nivel y avisa otra vez
+//  - activa -> normal: solo cuando el valor vuelve a entrar histeresis dentro del rango
+// Los avisos de cada tipo de evento pasan por un token bucket; un aviso sin token se descarta (el estado avanza
+// igual, no se reintenta). Todo es memoria fija y evaluar una lectura recorre las reglas una vez.
+// No depende de la radio ni del reloj: el receptor y el replay del host pasan el tiempo actual.
+#define ALERTAS_MAX_REGLAS 16
+#define ALERTAS_MAX_NODOS 16
+#define ALERTAS_MAX_EVENTOS 8
+#define ALERTAS_MAX_AVISOS TELEMETRIA_NUM_PARAMETROS // avisos por lectura: una regla por nodo y parametro
+#define ALERTAS_CUALQUIER_NODO 0xFF
+
+// Se guarda tal cual en NVS: solo campos de ancho fijo. Cambiar ALERTAS_VERSION_REGLAS si cambia
+#define ALERTAS_VERSION_REGLAS 1
+typedef struct
+{
+    uint8_t nodo;      // direccion del nodo o ALERTAS_CUALQUIER_NODO
+    uint8_t parametro; // telemetria_parametro_t
+    uint8_t evento;    // tipo de evento, indice de alertas_t.limites
+    uint8_t max_nivel; // 1: sin escalado
+    float min; // -FLT_MAX / FLT_MAX: sin limite por ese lado
+    float max;
+    float histeresis;
+    uint32_t duracion_ms;
+    uint32_t escalado_ms;
+} alertas_regla_t;
+
+// Token bucket de un tipo de evento: hasta capacidad avisos seguidos, luego uno cada recarga_ms
+typedef struct
+{
+    uint16_t capacidad;
+    uint32_t recarga_ms;
+} alertas_limite_t;
+
+typedef struct
+{
+    uint8_t regla;
+    uint8_t nodo;
+    uint8_t evento;
+    uint8_t nivel; // 0: el parametro volvio a su rango (no consume token)
+    float valor;
+} alertas_aviso_t;
+
+typedef struct
+{
+    uint8_t nivel;
+    bool fuera;
+    uint32_t desde_ms; // inicio de la violacion
+    uint32_t aviso_ms; // ultimo aviso, para el escalado
+} alertas_estado_t;
+
+typedef struct
+{
+    uint16_t tokens;
+    uint32_t recarga_desde_ms;
+} alertas_bucket_t;
+
+typedef struct
+{
+    alertas_regla_t reglas[ALERTAS_MAX_REGLAS];
+    int num_reglas;
+    alertas_limite_t limites[ALERTAS_MAX_EVENTOS];
+    int num_eventos;
+    // estado; alertas_reiniciar lo borra
+    uint8_t nodos[ALERTAS_MAX_NODOS];
+    int num_nodos;
+    alertas_estado_t estado[ALERTAS_MAX_REGLAS][ALERTAS_MAX_NODOS];
+    alertas_bucket_t buckets[ALERTAS_MAX_EVENTOS];
+    uint32_t lecturas;
+    uint32_t avisos;
+    uint32_t suprimidos; // avisos sin token
+    uint32_t sin_sitio;  // lecturas de nodos que no caben en la tabla
+} alertas_t;
+
+void alertas_iniciar(alertas_t *alertas);
+
+// Agrega un tipo de evento. Devuelve su indice, o -1 si no queda sitio
+int alertas_agregar_evento(alertas_t *alertas, uint16_t capacidad, uint32_t recarga_ms);
+
+// Agrega una regla, o reemplaza la del mismo nodo y parametro. Devuelve su indice, o -1 si no es valida o no
+// queda sitio
+int alertas_agregar_regla(alertas_t *alertas, const alertas_regla_t *regla);
+
+// Borra el estado de las reglas (niveles, debounce) y llena los buckets. Necesario si cambian las reglas
+void alertas_reiniciar(alertas_t *alertas, uint32_t ahora_ms);
+
+// Evalua una lectura contra las reglas de su nodo. Escribe en avisos (hasta max_avisos) los que hay que
+// notificar y devuelve cuantos
+int alertas_evaluar(alertas_t *alertas, const telemetria_lectura_t *lectura, uint32_t ahora_ms,
+                    alertas_aviso_t *avisos, int max_avisos);
+
+#endif
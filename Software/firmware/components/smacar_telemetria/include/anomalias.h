@@ -0,0 +1,74 @@
+#ifndef ANOMALIAS_H
+#define ANOMALIAS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "telemetria.h"
+
+// Detector de anomalias del transmisor, por parametro y en memoria fija, para enviar en el acto (sin esperar
+// al lote ni a la politica de envio) una lectura rara aunque siga dentro de sus umbrales:
+//  - pico: la lectura se aparta mas de z_pico desviaciones de la media movil (EWMA de media y varianza)
+//  - cambio: CUSUM de dos lados sobre la desviacion normalizada; detecta un escalon o una deriva pequenos
+//    que ninguna lectura sola delata. Tras avisar la media se reancla en la lectura
+//  - atascado: el valor no cambia en atascado_s (sonda desconectada, ADC sin refresco, DS18B20 que no
+//    responde y deja la temperatura por defecto)
+//  - riel: el ADC esta en un extremo de su rango (lo sabe quien llama: crudo o mV, no el valor calibrado)
+// Atascado y riel avisan al empezar, no en cada lectura; mientras duran no se actualiza la media. Las primeras
+// calentamiento lecturas solo aprenden. Un pico entra a la media y al CUSUM recortado a z_pico: uno solo no
+// dispara el CUSUM, dos seguidos si.
+// No depende de ESP-IDF: el tiempo (segundos) lo pone quien llama.
+
+typedef enum
+{
+    ANOMALIA_NINGUNA = 0,
+    ANOMALIA_CAMBIO,
+    ANOMALIA_PICO,
+    ANOMALIA_ATASCADO,
+    ANOMALIA_RIEL,
+    ANOMALIA_NUM
+} anomalia_t; // de menos a mas grave
+
+typedef struct
+{
+    float alfa;    // peso de la lectura nueva en la EWMA
+    float z_pico;  // desviaciones para un pico
+    float cusum_k; // holgura del CUSUM en desviaciones: cambios menores no se acumulan
+    float cusum_h; // umbral del CUSUM
+    uint16_t calentamiento;
+    float ruido_min[TELEMETRIA_NUM_PARAMETROS];   // desviacion minima: resolucion del sensor y lo que la EWMA
+                                                  // se retrasa con el ciclo diario
+    uint16_t atascado_s[TELEMETRIA_NUM_PARAMETROS]; // 0: sin deteccion de valor atascado
+} anomalias_config_t;
+
+typedef struct
+{
+    float media;
+    float varianza;
+    float cusum_alto;
+    float cusum_bajo;
+    float anterior;
+    uint32_t igual_desde; // desde cuando no cambia
+    bool atascado;
+    bool riel;
+} anomalias_parametro_t;
+
+typedef struct
+{
+    anomalias_parametro_t parametros[TELEMETRIA_NUM_PARAMETROS];
+    uint32_t lecturas;
+    uint32_t detectadas[ANOMALIA_NUM];
+} anomalias_t;
+
+// Valores para los sensores del transmisor con una lectura cada pocos segundos
+void anomalias_config_defecto(anomalias_config_t *config);
+
+void anomalias_iniciar(anomalias_t *anomalias);
+
+// Evalua una lectura calibrada tomada en t. riel: bit i si el ADC del parametro i esta en un extremo. motivos
+// (puede ser NULL) recibe la anomalia de cada parametro. Devuelve la mas grave
+anomalia_t anomalias_evaluar(anomalias_t *anomalias, const anomalias_config_t *config,
+                             const telemetria_lectura_t *lectura, uint8_t riel, uint32_t t, anomalia_t *motivos);
+
+const char *anomalias_nombre(anomalia_t anomalia);
+
+#endif
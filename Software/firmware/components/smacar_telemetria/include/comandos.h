@@ -0,0 +1,126 @@
+#ifndef COMANDOS_H
+#define COMANDOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "telemetria.h"
+
+// Protocolo binario de comandos de configuracion, enviados por el receptor como downlink de control
+// (cabecera explicita, canal de control). Una trama puede llevar varios comandos y se aplica entera o nada:
+//
+//  0      TELEMETRIA_CTRL_COMANDO
+//  1      destino     direccion del nodo, o COMANDOS_DIFUSION para todos (multicast)
+//  2      id          identificador del downlink; el nodo lo devuelve en el ACK y no repite uno ya aplicado
+//  3..    comandos, cada uno con un byte de tipo y longitud fija segun el tipo:
+//         COMANDO_PERIODO      [1][periodo_s u16]                  periodo de muestreo en segundos
+//         COMANDO_LOTE         [2][lote u8]                        lecturas por uplink, 1..COMANDOS_MAX_LOTE
+//         COMANDO_UMBRAL       [3][parametro][min f32][max f32]    fuera de rango el lote se envia en el acto
+//         COMANDO_CALIBRACION  [4][parametro][ganancia f32][offset f32]  valor = valor * ganancia + offset
+//         COMANDO_POLITICA     [5][parametro][banda f32][pendiente f32][margen f32]  cuando se envia (politica.h)
+//         COMANDO_SILENCIO     [6][silencio_s u16][rapido_s u16]   maximo sin enviar y periodo cerca de umbral
+//
+// Enteros y floats en little endian. ACK (uplink): [TELEMETRIA_CTRL_ACK][origen][id][resultado]
+#define COMANDOS_DIFUSION 0xFF
+#define COMANDOS_MAX_LEN 64
+#define COMANDOS_ACK_LEN 4
+#define COMANDOS_MAX_LOTE 16
+// Por debajo del timeout de offline del receptor (OFFLINE_TIMEOUT_MS)
+#define COMANDOS_SILENCIO_DEFECTO_S 600
+
+// Ventana de recepcion de un nodo clase A: el receptor transmite COMANDOS_RX_RETARDO_MS despues de recibir
+// el uplink; el nodo escucha desde COMANDOS_RX_MARGEN_MS antes y corta si no detecta preambulo en 2 margenes
+#define COMANDOS_RX_RETARDO_MS 1000
+#define COMANDOS_RX_MARGEN_MS 200
+// Los nodos clase C confirman un multicast tras una espera aleatoria de hasta este tiempo, para no chocar
+#define COMANDOS_ACK_DISPERSION_MS 8000
+
+typedef enum
+{
+    COMANDO_PERIODO = 1,
+    COMANDO_LOTE = 2,
+    COMANDO_UMBRAL = 3,
+    COMANDO_CALIBRACION = 4,
+    COMANDO_POLITICA = 5,
+    COMANDO_SILENCIO = 6
+} comando_tipo_t;
+
+typedef struct
+{
+    comando_tipo_t tipo;
+    telemetria_parametro_t parametro; // COMANDO_UMBRAL, COMANDO_CALIBRACION y COMANDO_POLITICA
+    union
+    {
+        uint16_t periodo_s;
+        uint8_t lote;
+        struct
+        {
+            float min;
+            float max;
+        } umbral;
+        struct
+        {
+            float ganancia;
+            float offset;
+        } calibracion;
+        struct
+        {
+            float banda;
+            float pendiente;
+            float margen;
+        } politica;
+        struct
+        {
+            uint16_t silencio_s;
+            uint16_t rapido_s;
+        } silencio;
+    } valor;
+} comando_t;
+
+typedef enum
+{
+    COMANDOS_APLICADO = 0,
+    COMANDOS_DUPLICADO,     // ya aplicado (se perdio el ACK), se vuelve a confirmar sin aplicar
+    COMANDOS_OTRO_DESTINO,  // no es para este nodo, no se confirma
+    COMANDOS_INVALIDO       // trama mal formada o valores fuera de rango, no se aplica nada
+} comandos_resultado_t;
+
+// Configuracion del nodo que modifican los comandos; el transmisor la consulta en cada ciclo, sin reiniciar
+typedef struct
+{
+    uint16_t periodo_s;
+    uint8_t lote;
+    float umbral_min[TELEMETRIA_NUM_PARAMETROS];
+    float umbral_max[TELEMETRIA_NUM_PARAMETROS];
+    float ganancia[TELEMETRIA_NUM_PARAMETROS];
+    float offset[TELEMETRIA_NUM_PARAMETROS];
+    // politica de envio (politica.h)
+    float banda[TELEMETRIA_NUM_PARAMETROS];     // 0: se envian todas las lecturas
+    float pendiente[TELEMETRIA_NUM_PARAMETROS]; // por minuto; 0: sin disparo por pendiente
+    float margen[TELEMETRIA_NUM_PARAMETROS];    // 0: sin muestreo rapido por ese parametro
+    uint16_t silencio_s;
+    uint16_t rapido_s; // 0: sin muestreo rapido
+    bool id_valido;
+    uint8_t ultimo_id;
+} comandos_config_t;
+
+// Lote de 1, sin umbrales, sin correccion de calibracion y enviando todas las lecturas
+void comandos_config_defecto(comandos_config_t *config, uint16_t periodo_s);
+
+// Empaqueta los comandos en trama (COMANDOS_MAX_LEN bytes). Devuelve la longitud, o 0 si no caben
+size_t comandos_codificar(uint8_t destino, uint8_t id, const comando_t *comandos, int num_comandos, uint8_t *trama);
+
+// Valida la trama completa y, si es para origen y no esta repetida, la aplica a config. id recibe el id
+// de la trama (si se pudo leer) para el ACK
+comandos_resultado_t comandos_aplicar(const uint8_t *trama, size_t len, uint8_t origen, comandos_config_t *config, uint8_t *id);
+
+// Aplica la correccion de calibracion de un parametro
+float comandos_calibrar(const comandos_config_t *config, telemetria_parametro_t parametro, float valor);
+
+// true si algun parametro de la lectura esta fuera de su umbral
+bool comandos_fuera_de_umbral(const comandos_config_t *config, const telemetria_lectura_t *lectura);
+
+size_t comandos_codificar_ack(uint8_t origen, uint8_t id, comandos_resultado_t resultado, uint8_t *trama);
+bool comandos_decodificar_ack(const uint8_t *trama, size_t len, uint8_t *origen, uint8_t *id, comandos_resultado_t *resultado);
+
+#endif
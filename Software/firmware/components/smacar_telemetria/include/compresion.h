@@ -0,0 +1,66 @@
+#ifndef COMPRESION_H
+#define COMPRESION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Compresion de series de lecturas (t, valores) para los lotes del transmisor y el historico del receptor.
+// Los parametros cambian despacio, asi que se guarda la diferencia con la lectura anterior, empaquetada en bits:
+//  - t: delta de delta (con un periodo fijo casi siempre 0 -> 1 bit), codigos de longitud variable:
+//      0 | 10 + 7 bits | 110 + 9 bits | 1110 + 12 bits | 1111 + 32 bits
+//  - COMPRESION_XOR: los floats tal cual, XOR con el anterior (Gorilla). 0 si es igual; si no, los bits con
+//    sentido del XOR, reutilizando la ventana de ceros del anterior cuando caben (10) o con una nueva (11 + 5
+//    bits de ceros delante + 5 de longitud). Sin perdida
+//  - COMPRESION_ENTEROS: cada valor se escala a entero (escalas[]) y se guarda la diferencia en zig-zag con los
+//    mismos codigos que t: 0 | 10 + 4 bits | 110 + 8 | 1110 + 16 | 1111 + 32. Pierde lo que este por debajo de la
+//    escala; con las escalas de la trama binaria (compresion_escalas_telemetria) no pierde nada de lo que llega
+//    por radio
+// El buffer lo da quien llama; compresion_agregar no escribe nada si la lectura no cabe entera.
+#define COMPRESION_MAX_VALORES 5 // los 4 parametros y la secuencia (subida.h)
+
+typedef enum
+{
+    COMPRESION_XOR = 0,
+    COMPRESION_ENTEROS
+} compresion_modo_t;
+
+// Resolucion de la trama binaria (telemetria.h) en el orden de telemetria_parametro_t, y la secuencia
+extern const float compresion_escalas_telemetria[COMPRESION_MAX_VALORES];
+
+// Estado del codificador o del decodificador de un bloque
+typedef struct
+{
+    uint8_t *datos;
+    size_t capacidad; // bytes
+    size_t bits;      // escritos / leidos
+    size_t total_bits; // decodificador: bits del bloque
+    uint8_t modo;
+    uint8_t num_valores;
+    const float *escalas;
+    uint16_t muestras;
+    uint32_t t;
+    int32_t delta;
+    uint32_t previo[COMPRESION_MAX_VALORES]; // XOR: bits del float; ENTEROS: valor escalado
+    uint8_t delante[COMPRESION_MAX_VALORES];  // XOR: ventana de bits con sentido del ultimo valor distinto
+    uint8_t significativos[COMPRESION_MAX_VALORES];
+} compresion_t;
+
+// Empieza un bloque vacio en datos. escalas solo se usa en COMPRESION_ENTEROS
+void compresion_iniciar(compresion_t *bloque, compresion_modo_t modo, uint8_t num_valores, const float *escalas,
+                        uint8_t *datos, size_t capacidad);
+
+// Agrega una lectura. Devuelve false, sin tocar el bloque, si no cabe
+bool compresion_agregar(compresion_t *bloque, uint32_t t, const float *valores);
+
+// Bytes ocupados
+size_t compresion_len(const compresion_t *bloque);
+
+// Prepara la lectura de un bloque de muestras lecturas con los mismos modo, num_valores y escalas
+void compresion_abrir(compresion_t *bloque, compresion_modo_t modo, uint8_t num_valores, const float *escalas,
+                      const uint8_t *datos, size_t len, uint16_t muestras);
+
+// Siguiente lectura del bloque. Devuelve false al terminar o si el bloque esta cortado
+bool compresion_leer(compresion_t *bloque, uint32_t *t, float *valores);
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef CONEXION_H
+#define CONEXION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Politica de la conexion WiFi del receptor: cuando reintentar y que ahorro de energia usar.
+// Tras una caida o un intento fallido se espera antes de reintentar, con espera exponencial y jitter: la espera
+// n es la mitad de min(espera_max, espera_min * 2^n) mas un aleatorio hasta la otra mitad. Sin AP no se
+// escanea en bucle, y varios receptores que pierden el mismo AP no reintentan a la vez. La cuenta solo vuelve a
+// empezar tras CONEXION_ESTABLE_MS con IP: un AP que se cae y vuelve enseguida no la reinicia.
+// Ahorro con IP: CONEXION_AHORRO_MIN (despierta en cada DTIM) mientras hay trafico, hasta CONEXION_ACTIVO_MS
+// despues de la ultima subida, y CONEXION_AHORRO_MAX (despierta cada listen interval) entre subidas.
+// Mide el tiempo hasta IP de cada intento y la latencia de reconexion (sin IP -> IP).
+// No depende de ESP-IDF: el tiempo y el aleatorio los pone quien llama.
+#define CONEXION_ESTABLE_MS 60000
+#define CONEXION_ACTIVO_MS 2000
+#define CONEXION_MAX_EXPONENTE 16
+
+typedef enum
+{
+    CONEXION_PARADA = 0,
+    CONEXION_CONECTANDO, // intento en curso
+    CONEXION_ESPERANDO,  // hasta el siguiente intento
+    CONEXION_CON_IP
+} conexion_estado_t;
+
+typedef enum
+{
+    CONEXION_AHORRO_NINGUNO = 0, // sin IP: conectando o esperando
+    CONEXION_AHORRO_MIN,
+    CONEXION_AHORRO_MAX
+} conexion_ahorro_t;
+
+typedef struct
+{
+    conexion_estado_t estado;
+    uint32_t espera_min_ms;
+    uint32_t espera_max_ms;
+    uint32_t semilla;
+    uint8_t fallos;        // caidas e intentos fallidos desde la ultima conexion estable
+    uint32_t intento_ms;   // inicio del intento en curso
+    uint32_t sin_ip_ms;    // desde cuando no hay IP
+    uint32_t ip_ms;        // desde cuando hay IP
+    uint32_t actividad_ms; // ultima subida
+    bool actividad;
+    // estadisticas
+    uint32_t intentos;
+    uint32_t conexiones;
+    uint32_t caidas; // con IP
+    uint32_t hasta_ip_ms;      // del ultimo intento que consiguio IP
+    uint32_t max_hasta_ip_ms;
+    uint64_t suma_hasta_ip_ms;
+    uint32_t reconexion_ms;    // ultima
+    uint32_t max_reconexion_ms;
+    uint64_t suma_reconexion_ms;
+} conexion_t;
+
+void conexion_iniciar(conexion_t *conexion, uint32_t espera_min_ms, uint32_t espera_max_ms, uint32_t semilla,
+                      uint32_t ahora_ms);
+
+// Empieza un intento (esp_wifi_connect)
+void conexion_intento(conexion_t *conexion, uint32_t ahora_ms);
+
+void conexion_ip(conexion_t *conexion, uint32_t ahora_ms);
+
+// Se perdio la conexion o fallo el intento. Devuelve los ms hasta el siguiente intento
+uint32_t conexion_caida(conexion_t *conexion, uint32_t ahora_ms);
+
+// Hay trafico de subida
+void conexion_actividad(conexion_t *conexion, uint32_t ahora_ms);
+
+conexion_ahorro_t conexion_ahorro(const conexion_t *conexion, uint32_t ahora_ms);
+
+// ms hasta que conexion_ahorro cambia solo (fin del trafico), 0 si no va a cambiar
+uint32_t conexion_proximo_ahorro(const conexion_t *conexion, uint32_t ahora_ms);
+
+#endif
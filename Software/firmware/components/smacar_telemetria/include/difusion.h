@@ -0,0 +1,73 @@
+#ifndef DIFUSION_H
+#define DIFUSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "telemetria.h"
+
+// Difusion de lecturas a los clientes conectados a la API local del receptor (WebSocket).
+// Cada cliente tiene su cola de mensajes y como mucho uno en envio: el siguiente sale cuando termina el
+// anterior, asi que un cliente lento no acumula envios en la tarea del servidor. Si su cola se llena se descarta
+// su mensaje mas viejo (a la app le interesan las lecturas recientes) y un cliente con mensajes pendientes que
+// no completa ningun envio en DIFUSION_ATASCO_MS queda atascado para cerrarlo. La memoria no crece con clientes
+// lentos.
+// No depende de ESP-IDF: los clientes se identifican por su socket y el tiempo lo pasa quien llama.
+//
+// Mensaje binario (little endian):
+//  0..3   t             s desde 1970 (0 si el receptor no tiene hora)
+//  4..14  lectura       trama de telemetria (telemetria.h): origen, secuencia y valores
+#define DIFUSION_MENSAJE_LEN (4 + TELEMETRIA_LEN)
+#define DIFUSION_MAX_CLIENTES 8
+#define DIFUSION_COLA 32 // mensajes pendientes por cliente, potencia de 2
+#define DIFUSION_ATASCO_MS 10000
+#define DIFUSION_LIBRE (-1)
+
+typedef struct
+{
+    int fd; // DIFUSION_LIBRE: hueco sin cliente
+    uint8_t cola[DIFUSION_COLA][DIFUSION_MENSAJE_LEN];
+    uint32_t publicado_ms[DIFUSION_COLA];
+    uint16_t primero;
+    uint16_t num;
+    bool en_vuelo;
+    uint8_t enviando[DIFUSION_MENSAJE_LEN]; // el mensaje en vuelo, hasta difusion_enviado
+    uint32_t progreso_ms; // ultimo envio terminado, o desde cuando tiene pendientes
+    // estadisticas
+    uint32_t enviados;
+    uint32_t descartados;
+} difusion_cliente_t;
+
+typedef struct
+{
+    difusion_cliente_t clientes[DIFUSION_MAX_CLIENTES];
+    int num_clientes;
+    uint32_t publicados;
+    uint32_t rechazados; // conexiones sin hueco
+} difusion_t;
+
+void difusion_iniciar(difusion_t *difusion);
+
+// Devuelve false si no quedan huecos
+bool difusion_conectar(difusion_t *difusion, int fd, uint32_t ahora_ms);
+
+void difusion_desconectar(difusion_t *difusion, int fd);
+
+// Encola el mensaje para todos los clientes
+void difusion_publicar(difusion_t *difusion, const uint8_t *mensaje, uint32_t ahora_ms);
+
+// Si el cliente no tiene un envio en curso y hay mensajes, saca el siguiente, lo marca en vuelo y devuelve un
+// puntero que sigue valido hasta difusion_enviado. publicado_ms (puede ser NULL): cuando se publico
+const uint8_t *difusion_siguiente(difusion_t *difusion, int fd, uint32_t *publicado_ms);
+
+// Termino el envio en vuelo del cliente. ok false: fallo, no cuenta como progreso
+void difusion_enviado(difusion_t *difusion, int fd, bool ok, uint32_t ahora_ms);
+
+// Socket de un cliente con mensajes pendientes que lleva DIFUSION_ATASCO_MS sin terminar un envio,
+// DIFUSION_LIBRE si no hay
+int difusion_atascado(const difusion_t *difusion, uint32_t ahora_ms);
+
+void difusion_codificar(const telemetria_lectura_t *lectura, uint32_t t, uint8_t *mensaje);
+
+bool difusion_decodificar(const uint8_t *mensaje, size_t len, telemetria_lectura_t *lectura, uint32_t *t);
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef DOWNLINK_H
+#define DOWNLINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "comandos.h"
+
+// Cola de downlinks de comandos del receptor, por nodo. No depende de la radio ni del reloj: quien la usa
+// pasa el tiempo actual y transmite las tramas que devuelve (en el gateway y en el simulador de red).
+//  - Clase A: la trama pendiente sale en la ventana tras un uplink del nodo (downlink_para_uplink)
+//  - Clase C: sale en cuanto se programa (downlink_para_clase_c). Un comando a COMANDOS_DIFUSION es una sola
+//    transmision para todos los nodos clase C que lo tengan pendiente; los clase A lo reciben uno a uno
+// Una trama sigue pendiente hasta su ACK; se repite en cada ventana (clase A) o cada DOWNLINK_REINTENTO_MS
+// (clase C), y se descarta tras DOWNLINK_MAX_INTENTOS. Entre dos tramas clase C pasa al menos
+// DOWNLINK_ESPERA_ACK_MS, el tiempo en que llegan los ACK de la anterior.
+#ifndef DOWNLINK_MAX_NODOS
+#define DOWNLINK_MAX_NODOS 16
+#endif
+#define DOWNLINK_COLA 4 // tramas pendientes por nodo
+#define DOWNLINK_REINTENTO_MS 20000
+#define DOWNLINK_MAX_INTENTOS 10 // con 5, sim_reconfiguracion perdia nodos con 50 clase C y 10% de perdidas
+// dispersion de los ACK clase C mas un ACK a SF12 (0.83 s) y margen
+#define DOWNLINK_ESPERA_ACK_MS (COMANDOS_ACK_DISPERSION_MS + 2000)
+
+typedef struct
+{
+    uint8_t id;
+    uint8_t len;
+    uint8_t intentos;
+    uint32_t enviado_ms;
+    uint8_t trama[COMANDOS_MAX_LEN];
+} downlink_trama_t;
+
+typedef struct
+{
+    bool activo;
+    uint8_t nodo;
+    uint8_t clase;
+    uint8_t cabeza;
+    uint8_t num;
+    downlink_trama_t cola[DOWNLINK_COLA];
+} downlink_nodo_t;
+
+typedef struct
+{
+    downlink_nodo_t nodos[DOWNLINK_MAX_NODOS];
+    uint8_t siguiente_id;
+    bool clase_c_enviada;
+    uint32_t clase_c_ms; // ultima transmision clase C
+    uint32_t enviados; // transmisiones, un multicast clase C cuenta una vez
+    uint32_t confirmados;
+    uint32_t descartados;
+} downlink_t;
+
+void downlink_iniciar(downlink_t *dl);
+
+// Registra un nodo (anuncio de formato) o actualiza su clase. Devuelve false si no queda sitio
+bool downlink_registrar(downlink_t *dl, uint8_t nodo, uint8_t clase);
+
+// Programa una trama con los comandos para destino (un nodo o COMANDOS_DIFUSION). Un nodo desconocido se
+// registra como clase A. Devuelve el id de la trama, o -1 si no cabe o ningun nodo tiene sitio en su cola.
+// num_nodos (opcional) recibe a cuantos nodos se programo
+int downlink_programar(downlink_t *dl, uint8_t destino, const comando_t *comandos, int num_comandos, int *num_nodos);
+
+// Trama que se debe transmitir en la ventana que abre un uplink de nodo. Devuelve su longitud, 0 si no hay
+size_t downlink_para_uplink(downlink_t *dl, uint8_t nodo, uint32_t ahora_ms, uint8_t *trama);
+
+// Siguiente trama para nodos clase C que toca transmitir ahora. Devuelve su longitud, 0 si no hay
+size_t downlink_para_clase_c(downlink_t *dl, uint32_t ahora_ms, uint8_t *trama);
+
+// ACK de un nodo: retira la trama con ese id
+void downlink_ack(downlink_t *dl, uint8_t nodo, uint8_t id);
+
+// Tramas pendientes en total (o de un nodo si nodo != COMANDOS_DIFUSION)
+int downlink_pendientes(const downlink_t *dl, uint8_t nodo);
+
+#endif
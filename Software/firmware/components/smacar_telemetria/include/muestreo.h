@@ -0,0 +1,58 @@
+#ifndef MUESTREO_H
+#define MUESTREO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Muestras crudas del ADC que toma el coprocesador ULP mientras el transmisor duerme en sueno profundo.
+// El ULP despierta cada periodo, lee los canales y guarda la muestra en un anillo en memoria RTC; despierta a
+// los procesadores principales cuando hay un lote completo o una muestra sale de los umbrales. Los umbrales
+// van en cuentas del ADC: los convierte el procesador principal antes de dormir (el ULP no tiene coma
+// flotante), asi que son aproximados y el principal vuelve a comprobar con los valores calibrados.
+// Un productor (ULP) y un consumidor (principal): el ULP solo escribe muestras y escritas, el principal solo
+// leidas, y los dos pueden correr a la vez. escritas se publica despues de escribir la muestra y leidas despues
+// de copiarla, con barreras (release/acquire) en los dos lados. Con el anillo lleno el ULP descarta la muestra
+// nueva.
+// Solo enteros y sin libc: el mismo codigo se compila para el ULP y para el principal, y la estructura tiene
+// la misma disposicion en los dos.
+#define MUESTREO_CANALES 3 // EC, pH, TDS
+#define MUESTREO_MAX 32    // potencia de 2, al menos dos lotes
+#define MUESTREO_CRUDO_MAX 4095
+
+typedef struct
+{
+    // lo escribe el principal
+    uint32_t lote; // muestras para despertar
+    volatile uint32_t leidas;
+    uint16_t min[MUESTREO_CANALES];
+    uint16_t max[MUESTREO_CANALES];
+    uint32_t despertares; // arranques del ULP por muestra: su timer no llega a los periodos largos
+    // lo escribe el ULP
+    uint32_t cuenta; // arranques desde la ultima muestra
+    volatile uint32_t escritas;
+    uint32_t perdidas;
+    uint32_t alarma; // escritas al ver la ultima muestra fuera de umbral
+    uint16_t muestras[MUESTREO_MAX][MUESTREO_CANALES];
+} muestreo_t;
+
+// Anillo vacio, lote de 1, una muestra por arranque y sin umbrales
+void muestreo_iniciar(muestreo_t *muestreo);
+
+// Antes de dormir. min/max en cuentas; 0 y MUESTREO_CRUDO_MAX desactivan el umbral
+void muestreo_configurar(muestreo_t *muestreo, uint32_t lote, const uint16_t *min, const uint16_t *max);
+
+// Una muestra cada despertares arranques del ULP (0 cuenta como 1)
+void muestreo_espaciar(muestreo_t *muestreo, uint32_t despertares);
+
+// ULP: cuenta un arranque. Devuelve true si toca tomar la muestra
+bool muestreo_despertar(muestreo_t *muestreo);
+
+// ULP: guarda una muestra. Devuelve true si hay que despertar al principal
+bool muestreo_agregar(muestreo_t *muestreo, const uint16_t *crudo);
+
+int muestreo_pendientes(const muestreo_t *muestreo);
+
+// Principal: saca la muestra mas vieja. Devuelve false si no hay
+bool muestreo_leer(muestreo_t *muestreo, uint16_t *crudo);
+
+#endif
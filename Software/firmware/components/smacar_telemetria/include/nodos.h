@@ -0,0 +1,83 @@
+#ifndef NODOS_H
+#define NODOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Registro de nodos del receptor, por direccion de origen. Memoria fija:
+//  - arena de NODOS_MAX nodos (un nodo no se borra nunca, su indice no cambia)
+//  - tabla hash de direccion -> indice con direccionamiento abierto (sondeo lineal), al 50% como mucho
+//  - rueda de timers jerarquica de 3 niveles de NODOS_RUEDA_SLOTS: cada nodo esta en una lista doble segun
+//    cuando vence su timeout. Recibir de un nodo lo mueve de lista y avanzar un tick solo mira un slot, asi que
+//    el coste no depende del numero de nodos. Resolucion NODOS_TICK_MS, alcance NODOS_RUEDA_SLOTS^3 ticks
+// No depende de la radio ni del reloj: quien lo usa pasa el tiempo actual.
+#ifndef NODOS_MAX
+#define NODOS_MAX 128 // potencia de 2, hasta 32768 (indices de 16 bits)
+#endif
+#define NODOS_TABLA (2 * NODOS_MAX)
+#define NODOS_TICK_MS 1000
+#define NODOS_RUEDA_BITS 6
+#define NODOS_RUEDA_SLOTS (1 << NODOS_RUEDA_BITS)
+#define NODOS_RUEDA_NIVELES 3
+#define NODOS_NINGUNO 0xFFFF
+#define NODOS_SIN_SECUENCIA (-1)
+// Secuencia: un salto hacia delante de hasta NODOS_MAX_HUECO son perdidas; hacia atras hasta NODOS_MAX_HUECO (o
+// repetida) es un paquete desordenado; mas lejos, o volver a 0, es un reinicio del transmisor
+#define NODOS_MAX_HUECO 1024
+
+typedef enum
+{
+    NODOS_NUEVO = 0,
+    NODOS_VISTO,
+    NODOS_DE_VUELTA, // estaba offline
+    NODOS_LLENO      // nodo nuevo sin sitio en la arena
+} nodos_evento_t;
+
+typedef struct
+{
+    uint16_t direccion;
+    bool online;
+    bool secuencia_valida;
+    uint16_t secuencia;
+    uint32_t ultimo_ms;
+    uint32_t timeout_ms;
+    uint32_t recibidos;
+    uint32_t perdidos;      // huecos en la secuencia
+    uint32_t desordenados;  // secuencia repetida o anterior a la ultima
+    uint32_t reinicios;     // la secuencia volvio a 0 o salto mas de NODOS_MAX_HUECO
+    // rueda de timers
+    uint32_t vence; // tick
+    uint16_t siguiente;
+    uint16_t anterior;
+    uint8_t nivel; // NODOS_RUEDA_NIVELES: fuera de la rueda (offline)
+    uint8_t slot;
+} nodo_t;
+
+typedef struct
+{
+    nodo_t nodos[NODOS_MAX];
+    uint16_t num;
+    uint16_t tabla[NODOS_TABLA]; // indice + 1, 0 libre
+    uint16_t rueda[NODOS_RUEDA_NIVELES][NODOS_RUEDA_SLOTS];
+    uint32_t tick;    // ultimo tick procesado
+    uint32_t tick_ms; // tiempo de ese tick; los ticks se cuentan por diferencia, sin problema con el desborde
+    uint32_t timeout_ms;
+} nodos_t;
+
+// timeout_ms: timeout por defecto de los nodos nuevos
+void nodos_iniciar(nodos_t *registro, uint32_t timeout_ms, uint32_t ahora_ms);
+
+// Paquete de un nodo: actualiza ultimo_ms y los contadores de perdidas y reprograma su timeout.
+// secuencia es NODOS_SIN_SECUENCIA si el paquete no la lleva (texto del modo AT)
+nodos_evento_t nodos_recibido(nodos_t *registro, uint16_t direccion, int32_t secuencia, uint32_t ahora_ms);
+
+// Cambia el timeout de un nodo (p. ej. si cambia su periodo), contado desde su ultimo paquete. Devuelve false si
+// no esta registrado
+bool nodos_set_timeout(nodos_t *registro, uint16_t direccion, uint32_t timeout_ms);
+
+nodo_t *nodos_buscar(nodos_t *registro, uint16_t direccion);
+
+// Procesa los ticks hasta ahora_ms y llama a offline por cada nodo cuyo timeout vencio. Devuelve cuantos
+int nodos_avanzar(nodos_t *registro, uint32_t ahora_ms, void (*offline)(const nodo_t *nodo, void *arg), void *arg);
+
+#endif
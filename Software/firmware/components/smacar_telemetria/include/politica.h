@@ -0,0 +1,59 @@
+#ifndef POLITICA_H
+#define POLITICA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "telemetria.h"
+#include "comandos.h"
+
+// Politica de envio del transmisor: que lecturas salen por radio y cada cuanto se muestrea, segun la
+// configuracion de comandos.h (COMANDO_POLITICA y COMANDO_SILENCIO, se cambia en marcha con un downlink).
+// Una lectura se envia si algun parametro:
+//  - se aleja banda o mas del ultimo valor enviado (send-on-delta). El receptor se queda con el ultimo valor,
+//    asi que lo que ve no se aparta mas de banda del valor real en los instantes de muestreo
+//  - cambia pendiente o mas por minuto respecto a la lectura anterior, aunque aun no haya salido de la banda
+//    (entre dos lecturas seguidas el ruido del sensor se multiplica por 60 / periodo: pendiente tiene que
+//    quedar por encima)
+//  - esta fuera de su umbral
+// o si pasaron silencio_s desde el ultimo envio, para que el receptor no marque al nodo offline, o si quien
+// llama la marca urgente (anomalia del detector de anomalias.h).
+// Con banda 0 (por defecto) se envian todas las lecturas, como antes de la politica.
+// Mientras algun parametro esta a menos de margen de un umbral se muestrea cada rapido_s en lugar de periodo_s.
+// Las lecturas suprimidas no llevan secuencia: el receptor no las cuenta como perdidas.
+// No depende de ESP-IDF: el tiempo (segundos) lo pone quien llama.
+
+typedef enum
+{
+    POLITICA_SUPRIMIDA = 0,
+    POLITICA_PRIMERA,
+    POLITICA_BANDA,
+    POLITICA_PENDIENTE,
+    POLITICA_UMBRAL,
+    POLITICA_URGENTE,
+    POLITICA_SILENCIO,
+    POLITICA_NUM_MOTIVOS
+} politica_motivo_t;
+
+typedef struct
+{
+    bool iniciada;
+    float enviado[TELEMETRIA_NUM_PARAMETROS];  // ultimo valor enviado
+    float anterior[TELEMETRIA_NUM_PARAMETROS]; // ultima lectura, enviada o no
+    uint32_t enviado_t;
+    uint32_t anterior_t;
+    uint32_t motivos[POLITICA_NUM_MOTIVOS]; // lecturas por motivo
+} politica_t;
+
+void politica_iniciar(politica_t *politica);
+
+// Decide si la lectura (ya calibrada), tomada en t, se envia, y la recuerda para la siguiente. Una urgente se
+// envia siempre
+politica_motivo_t politica_evaluar(politica_t *politica, const comandos_config_t *config,
+                                   const telemetria_lectura_t *lectura, uint32_t t, bool urgente);
+
+// Periodo hasta la siguiente lectura, segun lo cerca que este la ultima de los umbrales
+uint16_t politica_periodo(const politica_t *politica, const comandos_config_t *config);
+
+const char *politica_nombre(politica_motivo_t motivo);
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef SERIE_H
+#define SERIE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "telemetria.h"
+#include "compresion.h"
+
+// Historico de lecturas del receptor en una particion de flash. Tres niveles, cada uno un anillo de segmentos
+// de un sector:
+//  - crudo: las lecturas de cada nodo, comprimidas (compresion.h) en bloques de SERIE_BLOQUE bytes que se arman
+//    en RAM y se escriben al llenarse o a los SERIE_BLOQUE_MAX_S
+//  - minuto / hora: min, max y media de cada parametro por nodo, calculados al vuelo en RAM al insertar
+// Solo se escribe al final del segmento activo (nunca se reescribe un registro) y un segmento solo se borra
+// cuando el anillo da la vuelta y le toca otra vez: lo mas viejo de cada nivel se pierde, pero para entonces ya
+// esta resumido en el nivel siguiente. Las escrituras pasan por un buffer de una pagina.
+// Cada segmento empieza con una cabecera; al cerrarlo se le escribe un indice (rango de tiempo, nodos, min/max
+// de cada parametro) para que las consultas salten los segmentos que no les tocan sin leerlos.
+// No depende de ESP-IDF: la flash se accede por serie_flash_t y el tiempo lo pasa quien llama.
+#define SERIE_SEGMENTO 4096 // sector: la unidad de borrado
+#define SERIE_PAGINA 256    // buffer de escritura (pagina de programacion de la flash)
+#define SERIE_MAX_NODOS 16  // nodos con resumenes abiertos
+#define SERIE_CUALQUIER_NODO 0xFF
+#define SERIE_MAGIA 0x53455231 // "SER1"
+#define SERIE_VERSION 2
+#define SERIE_BLOQUE 128        // registro del nivel crudo; divide a SERIE_PAGINA
+#define SERIE_BLOQUE_MAX_S 600  // un bloque abierto se escribe aunque no este lleno: lo que se pierde en un reinicio
+// reparto de la particion entre niveles, en %
+#define SERIE_PCT_CRUDO 50
+#define SERIE_PCT_MINUTO 35
+#define SERIE_MINUTO_S 60
+#define SERIE_HORA_S 3600
+
+typedef enum
+{
+    SERIE_CRUDO = 0,
+    SERIE_MINUTO,
+    SERIE_HORA,
+    SERIE_NUM_NIVELES
+} serie_nivel_t;
+
+// Acceso a la particion; las direcciones son relativas a su inicio. Devuelven false si falla
+typedef struct
+{
+    bool (*leer)(void *ctx, uint32_t direccion, void *datos, size_t len);
+    bool (*escribir)(void *ctx, uint32_t direccion, const void *datos, size_t len);
+    bool (*borrar)(void *ctx, uint32_t direccion, size_t len); // sectores enteros
+    void *ctx;
+} serie_flash_t;
+
+// Cabecera de segmento. Se programa en dos veces: magia..reservado al abrir el segmento y el resto (indice) al
+// cerrarlo; hasta entonces el indice queda borrado (0xFF) y el del segmento activo se lleva en RAM
+typedef struct
+{
+    uint32_t magia;
+    uint32_t numero; // orden de escritura dentro del nivel
+    uint8_t nivel;
+    uint8_t version;
+    uint16_t reservado;
+    // indice
+    uint32_t t_min;
+    uint32_t t_max;
+    uint32_t nodos;   // bit (nodo % 32) de cada nodo con registros
+    uint16_t usados;  // bytes de registros
+    uint16_t abierto; // 0 con el indice escrito
+    float min[TELEMETRIA_NUM_PARAMETROS];
+    float max[TELEMETRIA_NUM_PARAMETROS];
+    uint32_t reservado2;
+} serie_cabecera_t;
+
+// Registros. t en segundos (0xFFFFFFFF es flash borrada: fin de los registros del segmento); suma es un
+// checksum del resto del registro, para descartar el que quedo a medias por un corte de luz
+typedef struct
+{
+    uint32_t t; // primera lectura
+    uint8_t nodo;
+    uint8_t suma;
+    uint16_t muestras;
+    uint32_t t_fin; // ultima lectura
+    uint8_t modo;   // COMPRESION_ENTEROS (escalas de la trama binaria) si las lecturas caben sin perder nada,
+                    // si no COMPRESION_XOR
+    uint8_t len;    // bytes de datos
+    uint16_t reservado;
+    uint8_t datos[SERIE_BLOQUE - 16]; // (t - t_inicio, valores) de cada lectura
+} serie_bloque_t;
+
+typedef struct
+{
+    uint32_t t; // inicio del periodo
+    uint8_t nodo;
+    uint8_t suma;
+    uint16_t muestras;
+    float min[TELEMETRIA_NUM_PARAMETROS]; // NaN: ninguna muestra valida del parametro
+    float max[TELEMETRIA_NUM_PARAMETROS];
+    float media[TELEMETRIA_NUM_PARAMETROS];
+} serie_resumen_t;
+
+typedef struct
+{
+    uint32_t t;
+    uint8_t nodo;
+    uint16_t muestras; // 1 en el nivel crudo
+    float min;
+    float max;
+    float media;
+} serie_punto_t;
+
+typedef struct
+{
+    uint32_t primero;   // primer segmento del nivel en la particion
+    uint32_t segmentos;
+    uint32_t activo;    // segmento en el que se escribe, relativo a primero
+    uint16_t tam_registro;
+    uint16_t en_flash;  // bytes de registros del activo ya escritos
+    serie_cabecera_t cabecera; // del activo, con el indice al dia
+    uint8_t buffer[SERIE_PAGINA];
+    uint16_t en_buffer;
+} serie_anillo_t;
+
+// Resumen en curso de un nodo
+typedef struct
+{
+    uint32_t inicio;
+    uint16_t muestras;
+    uint16_t validas[TELEMETRIA_NUM_PARAMETROS];
+    float min[TELEMETRIA_NUM_PARAMETROS];
+    float max[TELEMETRIA_NUM_PARAMETROS];
+    float suma[TELEMETRIA_NUM_PARAMETROS];
+} serie_periodo_t;
+
+typedef struct
+{
+    uint8_t nodo;
+    serie_bloque_t bloque; // crudo en curso
+    compresion_t compresion;
+    serie_periodo_t minuto;
+    serie_periodo_t hora;
+} serie_acumulador_t;
+
+typedef struct
+{
+    serie_flash_t flash;
+    serie_anillo_t niveles[SERIE_NUM_NIVELES];
+    serie_acumulador_t acumuladores[SERIE_MAX_NODOS];
+    int num_acumuladores;
+    uint8_t lectura[SERIE_PAGINA];
+    // estadisticas
+    uint32_t insertados;
+    uint32_t sin_sitio;   // lecturas de nodos sin acumulador: van al nivel crudo (un bloque cada una), no a los
+                          // resumenes
+    uint32_t bloques;     // del nivel crudo escritos
+    uint32_t corruptos;   // registros con checksum incorrecto
+    uint32_t segmentos_leidos;
+    uint64_t bytes_datos;     // registros generados, todos los niveles
+    uint64_t bytes_escritos;  // programados en la flash, con cabeceras
+    uint64_t bytes_borrados;
+} serie_t;
+
+// Devuelve true si los callbacks deben seguir recibiendo puntos
+typedef bool (*serie_callback_t)(const serie_punto_t *punto, void *arg);
+
+// Monta el historico en una particion de tamano bytes (multiplo de SERIE_SEGMENTO, al menos 6 segmentos). Si la
+// particion no tiene un historico valido la prepara. Al reiniciar recupera el segmento activo de cada nivel;
+// los resumenes que estaban en RAM se pierden
+bool serie_montar(serie_t *serie, const serie_flash_t *flash, uint32_t tamano);
+
+// Guarda una lectura en el nivel crudo y la suma a los resumenes de su nodo. t en segundos
+bool serie_insertar(serie_t *serie, const telemetria_lectura_t *lectura, uint32_t t);
+
+// Escribe los resumenes de los periodos que ya terminaron en t (nodos que dejaron de mandar) y los bloques crudos
+// abiertos hace SERIE_BLOQUE_MAX_S
+bool serie_cerrar_periodos(serie_t *serie, uint32_t t);
+
+// Escribe los bloques crudos abiertos aunque no esten llenos, p. ej. antes de apagar
+bool serie_cerrar_bloques(serie_t *serie);
+
+// Vacia los buffers de escritura. Lo que queda en buffer o en bloques abiertos se pierde en un reinicio
+bool serie_sincronizar(serie_t *serie);
+
+// Recorre en orden de escritura los registros de un nivel en [desde, hasta] de un nodo (o
+// SERIE_CUALQUIER_NODO) y llama a callback con el parametro pedido; en el nivel crudo, un punto por lectura,
+// con los bloques abiertos al final. Devuelve cuantos puntos entrego, -1 si falla
+int serie_consultar(serie_t *serie, serie_nivel_t nivel, uint8_t nodo, telemetria_parametro_t parametro,
+                    uint32_t desde, uint32_t hasta, serie_callback_t callback, void *arg);
+
+// Minimo y maximo de un parametro de todos los nodos en [desde, hasta]. Los segmentos enteros dentro del rango
+// salen del indice sin leer sus registros. Devuelve false si no hay datos
+bool serie_extremos(serie_t *serie, serie_nivel_t nivel, telemetria_parametro_t parametro, uint32_t desde,
+                    uint32_t hasta, float *min, float *max);
+
+// Primer tiempo guardado en un nivel (hasta donde llega el historico), 0 si esta vacio
+uint32_t serie_inicio(serie_t *serie, serie_nivel_t nivel);
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef SUBIDA_H
+#define SUBIDA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "telemetria.h"
+
+// Cola de subida de lecturas del receptor a la nube por un transporte con confirmacion (MQTT QoS1).
+// Cada lectura se guarda hasta que el servidor confirma el mensaje que la lleva: con la conexion caida las
+// lecturas esperan aqui y salen al volver. Las de cada nodo se juntan en un mensaje comprimido (compresion.h) de
+// hasta SUBIDA_MAX_LOTE; una lectura espera como mucho SUBIDA_ESPERA_S a que lleguen otras de su nodo.
+// Hay como mucho SUBIDA_VENTANA mensajes sin confirmar, y uno que no se confirma en SUBIDA_CONFIRMACION_S de
+// conexion se vuelve a enviar: la entrega es al menos una vez, quien recibe descarta repetidos por nodo y
+// secuencia. Con la cola llena se pierden las lecturas mas viejas (siguen en el historico local, serie.h).
+// No depende de ESP-IDF: el transporte y el tiempo los pone quien llama.
+//
+// Mensaje (little endian):
+//  0      SUBIDA_FORMATO
+//  1      nodo
+//  2      n         lecturas
+//  3      modo      COMPRESION_ENTEROS, con la resolucion de la trama de telemetria
+//  4..7   t0        s desde 1970 de la lectura mas vieja (0 si el receptor no tiene hora)
+//  8..    (t - t0, temperatura, ec, ph, tds, secuencia) de cada lectura, comprimidas
+#define SUBIDA_FORMATO 1
+#define SUBIDA_CABECERA 8
+#define SUBIDA_MENSAJE_MAX 128
+#define SUBIDA_PENDIENTES 1024 // lecturas sin confirmar: ~10 min de 16 nodos a una lectura cada 10 s, 36 B cada una
+#define SUBIDA_MAX_LOTE 16
+#define SUBIDA_VENTANA 4
+#define SUBIDA_ESPERA_S 30
+#define SUBIDA_CONFIRMACION_S 60
+#define SUBIDA_SIN_MENSAJE 0xFF
+
+typedef struct
+{
+    telemetria_lectura_t lectura;
+    uint32_t t;
+    uint32_t llegada_s;
+    uint8_t mensaje; // hueco de la ventana del mensaje que la lleva, SUBIDA_SIN_MENSAJE si esta pendiente
+    bool confirmada;
+} subida_entrada_t;
+
+typedef struct
+{
+    bool usado;
+    int id; // del transporte (msg_id de MQTT), -1 hasta subida_enviado
+    uint32_t enviado_s;
+    uint8_t num;
+} subida_mensaje_t;
+
+typedef struct
+{
+    subida_entrada_t entradas[SUBIDA_PENDIENTES]; // en orden de llegada
+    uint16_t primero;
+    uint16_t num;
+    uint16_t pendientes_nodo[TELEMETRIA_MAX_ORIGEN + 1];
+    subida_mensaje_t ventana[SUBIDA_VENTANA];
+    bool conectado;
+    // estadisticas
+    uint32_t recibidas;
+    uint32_t confirmadas;
+    uint32_t descartadas; // por cola llena sin haberse enviado
+    uint32_t mensajes;
+    uint32_t reenvios; // mensajes que volvieron a pendientes
+} subida_t;
+
+void subida_iniciar(subida_t *subida);
+
+// Guarda una lectura para subirla. t en s desde 1970 (0 sin hora); ahora_s, reloj monotono de quien llama
+void subida_agregar(subida_t *subida, const telemetria_lectura_t *lectura, uint32_t t, uint32_t ahora_s);
+
+// Sin conexion no se arman mensajes. Al volver, lo que estaba en vuelo tiene otra vez SUBIDA_CONFIRMACION_S
+// para que lo confirme la sesion persistente del transporte
+void subida_conectado(subida_t *subida, bool conectado, uint32_t ahora_s);
+
+// Si hay conexion y hueco en la ventana, arma en mensaje (SUBIDA_MENSAJE_MAX bytes) el siguiente: las lecturas
+// pendientes mas viejas del primer nodo que tenga SUBIDA_MAX_LOTE, o alguna esperando SUBIDA_ESPERA_S.
+// Devuelve su longitud (0 si no toca enviar nada), su nodo y el hueco de la ventana que ocupa
+size_t subida_siguiente(subida_t *subida, uint32_t ahora_s, uint8_t *mensaje, uint8_t *nodo, int *hueco);
+
+// El transporte acepto el mensaje del hueco con ese id. id < 0: no lo acepto y sus lecturas vuelven a pendientes
+void subida_enviado(subida_t *subida, int hueco, int id, uint32_t ahora_s);
+
+void subida_confirmado(subida_t *subida, int id);
+
+// El transporte descarto el mensaje sin confirmarlo: sus lecturas vuelven a pendientes
+void subida_perdido(subida_t *subida, int id);
+
+// Con conexion, vuelve a pendientes lo que lleva SUBIDA_CONFIRMACION_S sin confirmar
+void subida_revisar(subida_t *subida, uint32_t ahora_s);
+
+// Lecturas sin confirmar, enviadas o no
+int subida_pendientes(const subida_t *subida);
+
+// Descomprime un mensaje en lecturas (hasta max) y t. Devuelve cuantas trae, -1 si no es un mensaje valido
+int subida_decodificar(const uint8_t *mensaje, size_t len, telemetria_lectura_t *lecturas, uint32_t *t, size_t max);
+
+#endif
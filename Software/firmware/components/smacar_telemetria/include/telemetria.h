@@ -0,0 +1,116 @@
+#ifndef TELEMETRIA_H
+#define TELEMETRIA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Trama binaria de telemetria, compartida por el transmisor y el receptor.
+// Tiene longitud fija, asi que puede ir en modo LoRa de cabecera implicita: el receptor ya conoce
+// longitud, CR y CRC, y el paquete se ahorra los 20 bits de cabecera (hasta 8 simbolos a SF12).
+//
+//  0      origen      bits 0-6: direccion del transmisor; bit 7: TELEMETRIA_FLAG_VENTANA
+//  1..2   secuencia   little endian, se incrementa en cada lectura
+//  3..4   temperatura int16, centesimas de grado
+//  5..6   ec          uint16, uS/cm
+//  7..8   ph          uint16, centesimas
+//  9..10  tds         uint16, decimas de ppm
+//
+// Los valores fuera de rango se saturan al limite del campo.
+#define TELEMETRIA_LEN 11
+#define TELEMETRIA_VERSION 2
+#define TELEMETRIA_MAX_ORIGEN 0x7F
+// el nodo escucha downlinks despues de esta trama (ultima de un lote). El receptor solo responde a estas tramas:
+// si respondiera a cualquiera, el downlink podria salir mientras el nodo todavia transmite el resto del lote
+#define TELEMETRIA_FLAG_VENTANA 0x80
+
+// Mensajes de control: siempre con cabecera explicita y longitud variable. El primer byte es el tipo;
+// empieza en 0x80 para no confundirse con los mensajes de texto ("T:TEMP:...") del modo AT.
+#define TELEMETRIA_CTRL_MIN 0x80
+#define TELEMETRIA_CTRL_FORMATO 0x80 // uplink: el transmisor anuncia el formato de su telemetria implicita
+#define TELEMETRIA_CTRL_COMANDO 0x81 // downlink: comandos de configuracion (ver comandos.h)
+#define TELEMETRIA_CTRL_ACK 0x82     // uplink: confirmacion de un downlink de comandos
+#define TELEMETRIA_CTRL_LOTE 0x83    // uplink: varias lecturas comprimidas (compresion.h) en un solo paquete
+#define TELEMETRIA_CTRL_FORMATO_LEN 7
+
+// Lote comprimido:
+//  0      TELEMETRIA_CTRL_LOTE
+//  1      origen | TELEMETRIA_FLAG_VENTANA
+//  2..3   secuencia de la primera lectura; las demas son consecutivas
+//  4      lecturas
+//  5      modo de compresion (COMPRESION_ENTEROS con compresion_escalas_telemetria: misma resolucion que la
+//         trama de TELEMETRIA_LEN)
+//  6..    (t, temperatura, ec, ph, tds) de cada lectura; t en segundos, relativo a la primera
+#define TELEMETRIA_LOTE_CABECERA 6
+#define TELEMETRIA_LOTE_MAX_LEN 128
+#define TELEMETRIA_LOTE_MAX_LECTURAS 32
+
+// Como recibe downlinks un nodo. Clase A (bateria): solo en una ventana tras sus uplinks de control o con
+// TELEMETRIA_FLAG_VENTANA. Clase C (alimentado): escucha el canal de control entre uplinks
+#define TELEMETRIA_CLASE_A 0
+#define TELEMETRIA_CLASE_C 1
+
+typedef enum
+{
+    TELEMETRIA_TEMPERATURA = 0,
+    TELEMETRIA_EC,
+    TELEMETRIA_PH,
+    TELEMETRIA_TDS,
+    TELEMETRIA_NUM_PARAMETROS
+} telemetria_parametro_t;
+
+typedef struct
+{
+    uint8_t origen;
+    bool ventana;
+    uint16_t secuencia;
+    float temperatura; // C
+    float ec;          // uS/cm
+    float ph;
+    float tds;         // ppm
+} telemetria_lectura_t;
+
+// Parametros con los que el transmisor envia la telemetria implicita. El receptor los compara con la
+// configuracion de su radio: con cabecera implicita no hay forma de detectar un desajuste en el aire.
+typedef struct
+{
+    uint8_t origen;
+    uint8_t version;
+    uint8_t longitud;
+    uint8_t sf; // 6..12
+    uint8_t cr; // denominador de la tasa de codigo: 5..8 para 4/5..4/8
+    uint8_t clase; // TELEMETRIA_CLASE_A / TELEMETRIA_CLASE_C
+} telemetria_formato_t;
+
+// Empaqueta una lectura en trama, que debe tener TELEMETRIA_LEN bytes
+void telemetria_codificar(const telemetria_lectura_t *lectura, uint8_t *trama);
+
+// Desempaqueta una trama. Devuelve false si la longitud no es TELEMETRIA_LEN
+bool telemetria_decodificar(const uint8_t *trama, size_t len, telemetria_lectura_t *lectura);
+
+// Empaqueta el anuncio de formato en trama (TELEMETRIA_CTRL_FORMATO_LEN bytes) y devuelve su longitud
+size_t telemetria_codificar_formato(const telemetria_formato_t *formato, uint8_t *trama);
+
+// Devuelve false si la trama no es un anuncio de formato valido
+bool telemetria_decodificar_formato(const uint8_t *trama, size_t len, telemetria_formato_t *formato);
+
+// Comprime en trama (hasta max_len bytes) las primeras lecturas que quepan, con t_s[] el instante de cada una en
+// segundos. Devuelve cuantas entraron (0 si ninguna) y su longitud en len
+size_t telemetria_codificar_lote(const telemetria_lectura_t *lecturas, const uint32_t *t_s, size_t num, bool ventana,
+                                 uint8_t *trama, size_t max_len, size_t *len);
+
+// Descomprime un lote en lecturas (hasta max) y en edad_s los segundos de cada una antes de la ultima. Devuelve
+// cuantas lecturas trae, -1 si la trama no es un lote valido
+int telemetria_decodificar_lote(const uint8_t *trama, size_t len, telemetria_lectura_t *lecturas, uint32_t *edad_s,
+                                size_t max);
+
+// Valor de una lectura por parametro
+float telemetria_valor(const telemetria_lectura_t *lectura, telemetria_parametro_t parametro);
+
+// true si el paquete (recibido con cabecera explicita) es un mensaje de control y no texto
+static inline bool telemetria_es_control(const uint8_t *trama, size_t len)
+{
+    return len > 0 && trama[0] >= TELEMETRIA_CTRL_MIN;
+}
+
+#endif
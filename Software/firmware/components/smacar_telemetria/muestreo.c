@@ -0,0 +1,94 @@
+#include "muestreo.h"
+
+// indices del anillo entre el ULP y el principal: la muestra queda escrita (o copiada) antes de mover el indice,
+// y el otro lado lee el indice antes que la muestra
+#define PUBLICAR(indice, valor) __atomic_store_n(&(indice), (valor), __ATOMIC_RELEASE)
+#define OBSERVAR(indice) __atomic_load_n(&(indice), __ATOMIC_ACQUIRE)
+
+void muestreo_iniciar(muestreo_t *muestreo)
+{
+    // sin memset: en el ULP no hay libc
+    uint8_t *p = (uint8_t *)muestreo;
+    for (unsigned i = 0; i < sizeof(*muestreo); i++)
+    {
+        p[i] = 0;
+    }
+    muestreo->lote = 1;
+    muestreo->despertares = 1;
+    for (int c = 0; c < MUESTREO_CANALES; c++)
+    {
+        muestreo->max[c] = MUESTREO_CRUDO_MAX;
+    }
+}
+
+void muestreo_configurar(muestreo_t *muestreo, uint32_t lote, const uint16_t *min, const uint16_t *max)
+{
+    muestreo->lote = lote == 0 ? 1 : lote > MUESTREO_MAX ? MUESTREO_MAX : lote;
+    for (int c = 0; c < MUESTREO_CANALES; c++)
+    {
+        muestreo->min[c] = min[c];
+        muestreo->max[c] = max[c];
+    }
+}
+
+void muestreo_espaciar(muestreo_t *muestreo, uint32_t despertares)
+{
+    muestreo->despertares = despertares == 0 ? 1 : despertares;
+}
+
+bool muestreo_despertar(muestreo_t *muestreo)
+{
+    // si el principal acorta el periodo, la cuenta ya pasada toma la muestra en este arranque
+    if (++muestreo->cuenta < muestreo->despertares)
+    {
+        return false;
+    }
+    muestreo->cuenta = 0;
+    return true;
+}
+
+bool muestreo_agregar(muestreo_t *muestreo, const uint16_t *crudo)
+{
+    uint32_t escritas = muestreo->escritas;
+    uint32_t leidas = OBSERVAR(muestreo->leidas);
+    if (escritas - leidas >= MUESTREO_MAX)
+    {
+        muestreo->perdidas++;
+        return true;
+    }
+    bool fuera = false;
+    uint16_t *muestra = muestreo->muestras[escritas % MUESTREO_MAX];
+    for (int c = 0; c < MUESTREO_CANALES; c++)
+    {
+        muestra[c] = crudo[c];
+        if (crudo[c] < muestreo->min[c] || crudo[c] > muestreo->max[c])
+            fuera = true;
+    }
+    PUBLICAR(muestreo->escritas, ++escritas);
+    if (fuera)
+    {
+        muestreo->alarma = escritas;
+    }
+    return fuera || escritas - leidas >= muestreo->lote;
+}
+
+int muestreo_pendientes(const muestreo_t *muestreo)
+{
+    return (int)(OBSERVAR(muestreo->escritas) - muestreo->leidas);
+}
+
+bool muestreo_leer(muestreo_t *muestreo, uint16_t *crudo)
+{
+    uint32_t leidas = muestreo->leidas;
+    if (leidas == OBSERVAR(muestreo->escritas))
+    {
+        return false;
+    }
+    const uint16_t *muestra = muestreo->muestras[leidas % MUESTREO_MAX];
+    for (int c = 0; c < MUESTREO_CANALES; c++)
+    {
+        crudo[c] = muestra[c];
+    }
+    PUBLICAR(muestreo->leidas, leidas + 1);
+    return true;
+}
@@ -0,0 +1,226 @@
+#include <string.h>
+#include "nodos.h"
+
+#define RUEDA_MASCARA (NODOS_RUEDA_SLOTS - 1)
+#define RUEDA_ALCANCE (1UL << (NODOS_RUEDA_NIVELES * NODOS_RUEDA_BITS)) // ticks
+
+// Fibonacci hashing: las direcciones suelen ser consecutivas, la multiplicacion las reparte por la tabla
+static uint32_t hash(uint16_t direccion)
+{
+    return ((uint32_t)direccion * 2654435761u >> 16) & (NODOS_TABLA - 1);
+}
+
+static void sacar_de_rueda(nodos_t *registro, uint16_t indice)
+{
+    nodo_t *nodo = &registro->nodos[indice];
+    if (nodo->nivel == NODOS_RUEDA_NIVELES)
+    {
+        return;
+    }
+    if (nodo->anterior != NODOS_NINGUNO)
+        registro->nodos[nodo->anterior].siguiente = nodo->siguiente;
+    else
+        registro->rueda[nodo->nivel][nodo->slot] = nodo->siguiente;
+    if (nodo->siguiente != NODOS_NINGUNO)
+        registro->nodos[nodo->siguiente].anterior = nodo->anterior;
+    nodo->nivel = NODOS_RUEDA_NIVELES;
+}
+
+// El nivel sale de cuanto falta para que venza: el nivel 0 tiene un slot por tick, el 1 uno por cada
+// NODOS_RUEDA_SLOTS ticks y el 2 uno por cada NODOS_RUEDA_SLOTS^2. Al empezar cada bloque de un nivel, su slot
+// se reparte en los niveles inferiores (cascada)
+static void poner_en_rueda(nodos_t *registro, uint16_t indice)
+{
+    nodo_t *nodo = &registro->nodos[indice];
+    uint32_t falta = nodo->vence - registro->tick;
+    if (falta >= RUEDA_ALCANCE)
+    {
+        nodo->vence = registro->tick + RUEDA_ALCANCE - 1;
+        falta = RUEDA_ALCANCE - 1;
+    }
+    uint8_t nivel = 0;
+    while (nivel < NODOS_RUEDA_NIVELES - 1 && falta >= (1UL << ((nivel + 1) * NODOS_RUEDA_BITS)))
+    {
+        nivel++;
+    }
+    nodo->nivel = nivel;
+    nodo->slot = (nodo->vence >> (nivel * NODOS_RUEDA_BITS)) & RUEDA_MASCARA;
+    uint16_t *cabeza = &registro->rueda[nivel][nodo->slot];
+    nodo->anterior = NODOS_NINGUNO;
+    nodo->siguiente = *cabeza;
+    if (*cabeza != NODOS_NINGUNO)
+        registro->nodos[*cabeza].anterior = indice;
+    *cabeza = indice;
+}
+
+static void programar(nodos_t *registro, uint16_t indice, uint32_t ahora_ms)
+{
+    nodo_t *nodo = &registro->nodos[indice];
+    sacar_de_rueda(registro, indice);
+    // ms desde el ultimo tick hasta que vence; ahora_ms puede ser anterior al tick (nodos_set_timeout)
+    int64_t restante = (int64_t)(int32_t)(ahora_ms - registro->tick_ms) + nodo->timeout_ms;
+    // redondeo hacia arriba: nunca vence antes del timeout, y como minimo en el siguiente tick
+    uint32_t ticks = restante > 0 ? (uint32_t)((restante + NODOS_TICK_MS - 1) / NODOS_TICK_MS) : 1;
+    nodo->vence = registro->tick + ticks;
+    poner_en_rueda(registro, indice);
+}
+
+static void cascada(nodos_t *registro, int nivel, uint32_t slot)
+{
+    uint16_t indice = registro->rueda[nivel][slot];
+    registro->rueda[nivel][slot] = NODOS_NINGUNO;
+    while (indice != NODOS_NINGUNO)
+    {
+        uint16_t siguiente = registro->nodos[indice].siguiente;
+        poner_en_rueda(registro, indice);
+        indice = siguiente;
+    }
+}
+
+void nodos_iniciar(nodos_t *registro, uint32_t timeout_ms, uint32_t ahora_ms)
+{
+    memset(registro, 0, sizeof(*registro));
+    memset(registro->rueda, 0xFF, sizeof(registro->rueda));
+    registro->timeout_ms = timeout_ms;
+    registro->tick_ms = ahora_ms;
+}
+
+static int32_t buscar_indice(const nodos_t *registro, uint16_t direccion, uint32_t *hueco)
+{
+    uint32_t pos = hash(direccion);
+    // la tabla nunca pasa del 50%, siempre hay un hueco que corta el sondeo
+    while (registro->tabla[pos] != 0)
+    {
+        uint16_t indice = registro->tabla[pos] - 1;
+        if (registro->nodos[indice].direccion == direccion)
+        {
+            return indice;
+        }
+        pos = (pos + 1) & (NODOS_TABLA - 1);
+    }
+    if (hueco != NULL)
+        *hueco = pos;
+    return -1;
+}
+
+nodo_t *nodos_buscar(nodos_t *registro, uint16_t direccion)
+{
+    int32_t indice = buscar_indice(registro, direccion, NULL);
+    return indice >= 0 ? &registro->nodos[indice] : NULL;
+}
+
+nodos_evento_t nodos_recibido(nodos_t *registro, uint16_t direccion, int32_t secuencia, uint32_t ahora_ms)
+{
+    uint32_t hueco = 0;
+    int32_t indice = buscar_indice(registro, direccion, &hueco);
+    nodos_evento_t evento = NODOS_VISTO;
+    if (indice < 0)
+    {
+        if (registro->num == NODOS_MAX)
+        {
+            return NODOS_LLENO;
+        }
+        indice = registro->num++;
+        registro->tabla[hueco] = (uint16_t)(indice + 1);
+        nodo_t *nuevo = &registro->nodos[indice];
+        memset(nuevo, 0, sizeof(*nuevo));
+        nuevo->direccion = direccion;
+        nuevo->timeout_ms = registro->timeout_ms;
+        nuevo->nivel = NODOS_RUEDA_NIVELES;
+        evento = NODOS_NUEVO;
+    }
+
+    nodo_t *nodo = &registro->nodos[indice];
+    if (evento == NODOS_VISTO && !nodo->online)
+    {
+        evento = NODOS_DE_VUELTA;
+    }
+    nodo->online = true;
+    nodo->ultimo_ms = ahora_ms;
+    nodo->recibidos++;
+
+    if (secuencia != NODOS_SIN_SECUENCIA)
+    {
+        uint16_t actual = (uint16_t)secuencia;
+        uint16_t salto = (uint16_t)(actual - nodo->secuencia);
+        bool avanza = true;
+        if (nodo->secuencia_valida)
+        {
+            if (actual == 0 && salto != 1)
+            {
+                nodo->reinicios++;
+            }
+            else if (salto >= 1 && salto <= NODOS_MAX_HUECO)
+            {
+                nodo->perdidos += salto - 1;
+            }
+            else if (salto == 0 || salto >= (uint16_t)(0x10000 - NODOS_MAX_HUECO))
+            {
+                nodo->desordenados++;
+                avanza = false;
+            }
+            else
+            {
+                nodo->reinicios++;
+            }
+        }
+        if (avanza)
+        {
+            nodo->secuencia = actual;
+            nodo->secuencia_valida = true;
+        }
+    }
+
+    programar(registro, (uint16_t)indice, ahora_ms);
+    return evento;
+}
+
+bool nodos_set_timeout(nodos_t *registro, uint16_t direccion, uint32_t timeout_ms)
+{
+    int32_t indice = buscar_indice(registro, direccion, NULL);
+    if (indice < 0)
+    {
+        return false;
+    }
+    nodo_t *nodo = &registro->nodos[indice];
+    nodo->timeout_ms = timeout_ms;
+    if (nodo->online)
+    {
+        // el timeout cuenta desde el ultimo paquete
+        programar(registro, (uint16_t)indice, nodo->ultimo_ms);
+    }
+    return true;
+}
+
+int nodos_avanzar(nodos_t *registro, uint32_t ahora_ms, void (*offline)(const nodo_t *nodo, void *arg), void *arg)
+{
+    int vencidos = 0;
+    while (ahora_ms - registro->tick_ms >= NODOS_TICK_MS)
+    {
+        registro->tick_ms += NODOS_TICK_MS;
+        uint32_t tick = ++registro->tick;
+        for (int nivel = 1; nivel < NODOS_RUEDA_NIVELES; nivel++)
+        {
+            if ((tick & ((1UL << (nivel * NODOS_RUEDA_BITS)) - 1)) != 0)
+            {
+                break;
+            }
+            cascada(registro, nivel, (tick >> (nivel * NODOS_RUEDA_BITS)) & RUEDA_MASCARA);
+        }
+
+        uint16_t *cabeza = &registro->rueda[0][tick & RUEDA_MASCARA];
+        while (*cabeza != NODOS_NINGUNO)
+        {
+            uint16_t indice = *cabeza;
+            nodo_t *nodo = &registro->nodos[indice];
+            sacar_de_rueda(registro, indice);
+            nodo->online = false;
+            vencidos++;
+            if (offline != NULL)
+            {
+                offline(nodo, arg);
+            }
+        }
+    }
+    return vencidos;
+}
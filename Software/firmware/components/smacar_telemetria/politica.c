@@ -0,0 +1,91 @@
+#include <string.h>
+#include <math.h>
+#include "politica.h"
+
+void politica_iniciar(politica_t *politica)
+{
+    memset(politica, 0, sizeof(*politica));
+}
+
+politica_motivo_t politica_evaluar(politica_t *politica, const comandos_config_t *config,
+                                   const telemetria_lectura_t *lectura, uint32_t t, bool urgente)
+{
+    politica_motivo_t motivo = POLITICA_SUPRIMIDA;
+    float valor[TELEMETRIA_NUM_PARAMETROS];
+    for (int i = 0; i < TELEMETRIA_NUM_PARAMETROS; i++)
+    {
+        valor[i] = telemetria_valor(lectura, (telemetria_parametro_t)i);
+    }
+
+    if (!politica->iniciada)
+    {
+        motivo = POLITICA_PRIMERA;
+    }
+    else if (comandos_fuera_de_umbral(config, lectura))
+    {
+        motivo = POLITICA_UMBRAL;
+    }
+    else if (urgente)
+    {
+        motivo = POLITICA_URGENTE;
+    }
+    else
+    {
+        uint32_t dt = t - politica->anterior_t;
+        for (int i = 0; i < TELEMETRIA_NUM_PARAMETROS; i++)
+        {
+            // pendiente primero: dice mas que la banda de por que se envia
+            if (config->pendiente[i] > 0 && dt > 0 &&
+                fabsf(valor[i] - politica->anterior[i]) * 60.0f >= config->pendiente[i] * (float)dt)
+            {
+                motivo = POLITICA_PENDIENTE;
+                break;
+            }
+            if (fabsf(valor[i] - politica->enviado[i]) >= config->banda[i])
+            {
+                motivo = POLITICA_BANDA;
+            }
+        }
+        if (motivo == POLITICA_SUPRIMIDA && t - politica->enviado_t >= config->silencio_s)
+        {
+            motivo = POLITICA_SILENCIO;
+        }
+    }
+
+    politica->iniciada = true;
+    politica->anterior_t = t;
+    memcpy(politica->anterior, valor, sizeof(valor));
+    if (motivo != POLITICA_SUPRIMIDA)
+    {
+        politica->enviado_t = t;
+        memcpy(politica->enviado, valor, sizeof(valor));
+    }
+    politica->motivos[motivo]++;
+    return motivo;
+}
+
+uint16_t politica_periodo(const politica_t *politica, const comandos_config_t *config)
+{
+    if (config->rapido_s == 0 || config->rapido_s >= config->periodo_s || !politica->iniciada)
+    {
+        return config->periodo_s;
+    }
+    for (int i = 0; i < TELEMETRIA_NUM_PARAMETROS; i++)
+    {
+        float v = politica->anterior[i];
+        // fuera de umbral tambien cuenta como cerca
+        if (config->margen[i] > 0 &&
+            (v < config->umbral_min[i] + config->margen[i] || v > config->umbral_max[i] - config->margen[i]))
+        {
+            return config->rapido_s;
+        }
+    }
+    return config->periodo_s;
+}
+
+const char *politica_nombre(politica_motivo_t motivo)
+{
+    static const char *const nombres[POLITICA_NUM_MOTIVOS] = {"suprimida", "primera", "banda", "pendiente",
+                                                              "umbral", "urgente", "silencio"};
+    return motivo < POLITICA_NUM_MOTIVOS ? nombres[motivo] : "?";
+}
@@ -0,0 +1,784 @@
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include "serie.h"
+
+#define CABECERA ((uint32_t)sizeof(serie_cabecera_t))
+#define DATOS (SERIE_SEGMENTO - CABECERA)
+#define INDICE ((uint32_t)offsetof(serie_cabecera_t, t_min))
+#define BORRADO 0xFFFFFFFFu
+
+// los dos tipos de registro empiezan igual: t, nodo, suma
+static uint8_t checksum(const uint8_t *registro, size_t len)
+{
+    uint8_t suma = 0x5A;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (i != offsetof(serie_bloque_t, suma))
+            suma += registro[i];
+    }
+    return suma;
+}
+
+static uint32_t direccion(const serie_anillo_t *anillo, uint32_t segmento)
+{
+    return (anillo->primero + segmento) * SERIE_SEGMENTO;
+}
+
+static void indice_vacio(serie_cabecera_t *cabecera)
+{
+    cabecera->t_min = BORRADO;
+    cabecera->t_max = 0;
+    cabecera->nodos = 0;
+    cabecera->usados = 0;
+    cabecera->abierto = 0xFFFF;
+    for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+    {
+        cabecera->min[p] = FLT_MAX;
+        cabecera->max[p] = -FLT_MAX;
+    }
+    cabecera->reservado2 = BORRADO;
+}
+
+static void bloque_abrir(const serie_bloque_t *bloque, compresion_t *compresion)
+{
+    size_t len = bloque->len < sizeof(bloque->datos) ? bloque->len : sizeof(bloque->datos);
+    compresion_abrir(compresion, (compresion_modo_t)bloque->modo, TELEMETRIA_NUM_PARAMETROS,
+                     compresion_escalas_telemetria, bloque->datos, len, bloque->muestras);
+}
+
+// Rango de cada parametro en un registro; FLT_MAX / -FLT_MAX si no tiene valor (NaN)
+static void extremos_registro(serie_nivel_t nivel, const uint8_t *registro, float *min, float *max)
+{
+    for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+    {
+        min[p] = FLT_MAX;
+        max[p] = -FLT_MAX;
+    }
+    if (nivel != SERIE_CRUDO)
+    {
+        const serie_resumen_t *resumen = (const serie_resumen_t *)registro;
+        for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+        {
+            if (resumen->min[p] == resumen->min[p])
+            {
+                min[p] = resumen->min[p];
+                max[p] = resumen->max[p];
+            }
+        }
+        return;
+    }
+    compresion_t compresion;
+    uint32_t t;
+    float valores[TELEMETRIA_NUM_PARAMETROS];
+    bloque_abrir((const serie_bloque_t *)registro, &compresion);
+    while (compresion_leer(&compresion, &t, valores))
+    {
+        for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+        {
+            if (valores[p] < min[p])
+                min[p] = valores[p];
+            if (valores[p] > max[p])
+                max[p] = valores[p];
+        }
+    }
+}
+
+static void indice_agregar(serie_cabecera_t *cabecera, serie_nivel_t nivel, const uint8_t *registro)
+{
+    const serie_bloque_t *comun = (const serie_bloque_t *)registro;
+    uint32_t t_fin = nivel == SERIE_CRUDO ? comun->t_fin : comun->t;
+    if (cabecera->t_min == BORRADO || comun->t < cabecera->t_min)
+        cabecera->t_min = comun->t;
+    if (t_fin > cabecera->t_max)
+        cabecera->t_max = t_fin;
+    cabecera->nodos |= 1UL << (comun->nodo % 32);
+    float min[TELEMETRIA_NUM_PARAMETROS], max[TELEMETRIA_NUM_PARAMETROS];
+    extremos_registro(nivel, registro, min, max);
+    for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+    {
+        if (min[p] < cabecera->min[p])
+            cabecera->min[p] = min[p];
+        if (max[p] > cabecera->max[p])
+            cabecera->max[p] = max[p];
+    }
+}
+
+static bool abrir_segmento(serie_t *serie, serie_nivel_t nivel, uint32_t segmento, uint32_t numero)
+{
+    serie_anillo_t *anillo = &serie->niveles[nivel];
+    uint32_t dir = direccion(anillo, segmento);
+    if (!serie->flash.borrar(serie->flash.ctx, dir, SERIE_SEGMENTO))
+    {
+        return false;
+    }
+    serie->bytes_borrados += SERIE_SEGMENTO;
+
+    serie_cabecera_t *cabecera = &anillo->cabecera;
+    cabecera->magia = SERIE_MAGIA;
+    cabecera->numero = numero;
+    cabecera->nivel = (uint8_t)nivel;
+    cabecera->version = SERIE_VERSION;
+    cabecera->reservado = 0xFFFF;
+    indice_vacio(cabecera);
+    anillo->activo = segmento;
+    anillo->en_flash = 0;
+    anillo->en_buffer = 0;
+    if (!serie->flash.escribir(serie->flash.ctx, dir, cabecera, INDICE))
+    {
+        return false;
+    }
+    serie->bytes_escritos += INDICE;
+    return true;
+}
+
+static bool vaciar(serie_t *serie, serie_anillo_t *anillo)
+{
+    if (anillo->en_buffer == 0)
+    {
+        return true;
+    }
+    uint32_t dir = direccion(anillo, anillo->activo) + CABECERA + anillo->en_flash;
+    if (!serie->flash.escribir(serie->flash.ctx, dir, anillo->buffer, anillo->en_buffer))
+    {
+        return false;
+    }
+    serie->bytes_escritos += anillo->en_buffer;
+    anillo->en_flash += anillo->en_buffer;
+    anillo->en_buffer = 0;
+    return true;
+}
+
+static bool cerrar_segmento(serie_t *serie, serie_anillo_t *anillo)
+{
+    if (!vaciar(serie, anillo))
+    {
+        return false;
+    }
+    anillo->cabecera.usados = anillo->en_flash;
+    anillo->cabecera.abierto = 0;
+    uint32_t dir = direccion(anillo, anillo->activo) + INDICE;
+    if (!serie->flash.escribir(serie->flash.ctx, dir, (const uint8_t *)&anillo->cabecera + INDICE, CABECERA - INDICE))
+    {
+        return false;
+    }
+    serie->bytes_escritos += CABECERA - INDICE;
+    return true;
+}
+
+static bool agregar(serie_t *serie, serie_nivel_t nivel, void *registro)
+{
+    serie_anillo_t *anillo = &serie->niveles[nivel];
+    uint16_t len = anillo->tam_registro;
+    uint8_t *bytes = (uint8_t *)registro;
+    bytes[offsetof(serie_bloque_t, suma)] = checksum(bytes, len);
+
+    if ((uint32_t)anillo->en_flash + anillo->en_buffer + len > DATOS)
+    {
+        // el anillo da la vuelta: el siguiente segmento es el mas viejo del nivel
+        if (!cerrar_segmento(serie, anillo) ||
+            !abrir_segmento(serie, nivel, (anillo->activo + 1) % anillo->segmentos, anillo->cabecera.numero + 1))
+        {
+            return false;
+        }
+    }
+    if (anillo->en_buffer + len > SERIE_PAGINA && !vaciar(serie, anillo))
+    {
+        return false;
+    }
+    memcpy(&anillo->buffer[anillo->en_buffer], bytes, len);
+    anillo->en_buffer += len;
+    anillo->cabecera.usados = anillo->en_flash + anillo->en_buffer;
+    indice_agregar(&anillo->cabecera, nivel, bytes);
+    serie->bytes_datos += len;
+    return true;
+}
+
+// Llama a visitar con cada registro valido de un segmento, en orden. visitar devuelve false para parar.
+// Devuelve -1 si falla la flash, 0 si visitar paro y 1 si llego al final
+static int recorrer(serie_t *serie, serie_nivel_t nivel, uint32_t segmento, uint32_t usados,
+                    bool (*visitar)(serie_t *serie, serie_nivel_t nivel, const uint8_t *registro, void *arg), void *arg)
+{
+    serie_anillo_t *anillo = &serie->niveles[nivel];
+    uint16_t len = anillo->tam_registro;
+    bool activo = segmento == anillo->activo;
+    uint32_t en_flash = activo ? anillo->en_flash : usados;
+    uint32_t bloque = (SERIE_PAGINA / len) * len;
+    serie->segmentos_leidos++;
+
+    for (uint32_t pos = 0; pos < en_flash; pos += bloque)
+    {
+        uint32_t n = en_flash - pos < bloque ? en_flash - pos : bloque;
+        if (!serie->flash.leer(serie->flash.ctx, direccion(anillo, segmento) + CABECERA + pos, serie->lectura, n))
+        {
+            return -1;
+        }
+        for (uint32_t i = 0; i + len <= n; i += len)
+        {
+            const uint8_t *registro = &serie->lectura[i];
+            if (((const serie_bloque_t *)registro)->t == BORRADO)
+            {
+                return 1;
+            }
+            if (registro[offsetof(serie_bloque_t, suma)] != checksum(registro, len))
+            {
+                serie->corruptos++;
+                continue;
+            }
+            if (!visitar(serie, nivel, registro, arg))
+            {
+                return 0;
+            }
+        }
+    }
+    // lo que todavia esta en el buffer de escritura
+    for (uint32_t i = 0; activo && i + len <= anillo->en_buffer; i += len)
+    {
+        if (!visitar(serie, nivel, &anillo->buffer[i], arg))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Cabecera de un segmento: la de RAM para el activo. false si el segmento no tiene registros de este nivel
+static bool leer_cabecera(serie_t *serie, serie_nivel_t nivel, uint32_t segmento, serie_cabecera_t *cabecera)
+{
+    serie_anillo_t *anillo = &serie->niveles[nivel];
+    if (segmento == anillo->activo)
+    {
+        *cabecera = anillo->cabecera;
+    }
+    else if (!serie->flash.leer(serie->flash.ctx, direccion(anillo, segmento), cabecera, CABECERA) ||
+             cabecera->magia != SERIE_MAGIA || cabecera->version != SERIE_VERSION || cabecera->nivel != nivel)
+    {
+        return false;
+    }
+    else if (cabecera->abierto != 0)
+    {
+        // no llego a cerrarse: sin indice, hay que leerlo entero
+        cabecera->t_min = 0;
+        cabecera->t_max = BORRADO - 1;
+        cabecera->nodos = BORRADO;
+        cabecera->usados = DATOS;
+        for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+        {
+            cabecera->min[p] = -FLT_MAX;
+            cabecera->max[p] = FLT_MAX;
+        }
+        return true;
+    }
+    return cabecera->t_min != BORRADO;
+}
+
+static bool contar_registro(serie_t *serie, serie_nivel_t nivel, const uint8_t *registro, void *arg)
+{
+    serie_anillo_t *anillo = &serie->niveles[nivel];
+    (void)arg;
+    indice_agregar(&anillo->cabecera, nivel, registro);
+    return true;
+}
+
+// Busca el segmento activo de un nivel despues de un reinicio (el de numero mas alto) y rehace su indice
+static bool recuperar(serie_t *serie, serie_nivel_t nivel)
+{
+    serie_anillo_t *anillo = &serie->niveles[nivel];
+    serie_cabecera_t cabecera;
+    bool encontrado = false;
+    for (uint32_t s = 0; s < anillo->segmentos; s++)
+    {
+        if (!serie->flash.leer(serie->flash.ctx, direccion(anillo, s), &cabecera, CABECERA))
+        {
+            return false;
+        }
+        if (cabecera.magia == SERIE_MAGIA && cabecera.version == SERIE_VERSION && cabecera.nivel == nivel &&
+            (!encontrado || cabecera.numero > anillo->cabecera.numero))
+        {
+            anillo->cabecera = cabecera;
+            anillo->activo = s;
+            encontrado = true;
+        }
+    }
+    if (!encontrado)
+    {
+        return abrir_segmento(serie, nivel, 0, 1);
+    }
+    if (anillo->cabecera.abierto == 0)
+    {
+        // se corto despues de cerrar el segmento y antes de abrir el siguiente
+        return abrir_segmento(serie, nivel, (anillo->activo + 1) % anillo->segmentos, anillo->cabecera.numero + 1);
+    }
+
+    // los registros llegan hasta la primera posicion borrada; los corruptos ocupan sitio igual
+    uint16_t len = anillo->tam_registro;
+    uint32_t usados = 0;
+    while (usados + len <= DATOS)
+    {
+        uint32_t t;
+        if (!serie->flash.leer(serie->flash.ctx, direccion(anillo, anillo->activo) + CABECERA + usados, &t, sizeof(t)))
+        {
+            return false;
+        }
+        if (t == BORRADO)
+            break;
+        usados += len;
+    }
+    indice_vacio(&anillo->cabecera);
+    anillo->en_flash = (uint16_t)usados;
+    anillo->en_buffer = 0;
+    if (recorrer(serie, nivel, anillo->activo, usados, contar_registro, NULL) < 0)
+    {
+        return false;
+    }
+    anillo->cabecera.usados = (uint16_t)usados;
+    return true;
+}
+
+bool serie_montar(serie_t *serie, const serie_flash_t *flash, uint32_t tamano)
+{
+    memset(serie, 0, sizeof(*serie));
+    serie->flash = *flash;
+    uint32_t total = tamano / SERIE_SEGMENTO;
+    uint32_t segmentos[SERIE_NUM_NIVELES];
+    segmentos[SERIE_CRUDO] = total * SERIE_PCT_CRUDO / 100;
+    segmentos[SERIE_MINUTO] = total * SERIE_PCT_MINUTO / 100;
+    segmentos[SERIE_HORA] = total - segmentos[SERIE_CRUDO] - segmentos[SERIE_MINUTO];
+    uint32_t primero = 0;
+    for (int nivel = 0; nivel < SERIE_NUM_NIVELES; nivel++)
+    {
+        // con un solo segmento no habria donde seguir escribiendo mientras se borra
+        if (segmentos[nivel] < 2)
+        {
+            return false;
+        }
+        serie_anillo_t *anillo = &serie->niveles[nivel];
+        anillo->primero = primero;
+        anillo->segmentos = segmentos[nivel];
+        anillo->tam_registro = nivel == SERIE_CRUDO ? sizeof(serie_bloque_t) : sizeof(serie_resumen_t);
+        primero += segmentos[nivel];
+        if (!recuperar(serie, (serie_nivel_t)nivel))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void periodo_iniciar(serie_periodo_t *periodo, uint32_t inicio)
+{
+    memset(periodo, 0, sizeof(*periodo));
+    periodo->inicio = inicio;
+    for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+    {
+        periodo->min[p] = FLT_MAX;
+        periodo->max[p] = -FLT_MAX;
+    }
+}
+
+static void periodo_sumar(serie_periodo_t *periodo, const serie_periodo_t *otro)
+{
+    periodo->muestras += otro->muestras;
+    for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+    {
+        periodo->validas[p] += otro->validas[p];
+        periodo->suma[p] += otro->suma[p];
+        if (otro->min[p] < periodo->min[p])
+            periodo->min[p] = otro->min[p];
+        if (otro->max[p] > periodo->max[p])
+            periodo->max[p] = otro->max[p];
+    }
+}
+
+static bool periodo_escribir(serie_t *serie, serie_nivel_t nivel, uint8_t nodo, const serie_periodo_t *periodo)
+{
+    serie_resumen_t resumen;
+    memset(&resumen, 0, sizeof(resumen));
+    resumen.t = periodo->inicio;
+    resumen.nodo = nodo;
+    resumen.muestras = periodo->muestras;
+    for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+    {
+        bool hay = periodo->validas[p] > 0;
+        resumen.min[p] = hay ? periodo->min[p] : NAN;
+        resumen.max[p] = hay ? periodo->max[p] : NAN;
+        resumen.media[p] = hay ? periodo->suma[p] / periodo->validas[p] : NAN;
+    }
+    return agregar(serie, nivel, &resumen);
+}
+
+static bool cerrar_hora(serie_t *serie, serie_acumulador_t *acumulador)
+{
+    bool ok = periodo_escribir(serie, SERIE_HORA, acumulador->nodo, &acumulador->hora);
+    acumulador->hora.muestras = 0;
+    return ok;
+}
+
+// El minuto pasa a su hora; si es de una hora nueva, la anterior se escribe primero
+static bool cerrar_minuto(serie_t *serie, serie_acumulador_t *acumulador)
+{
+    serie_periodo_t *minuto = &acumulador->minuto;
+    bool ok = periodo_escribir(serie, SERIE_MINUTO, acumulador->nodo, minuto);
+    uint32_t hora = minuto->inicio - minuto->inicio % SERIE_HORA_S;
+    if (acumulador->hora.muestras > 0 && acumulador->hora.inicio != hora)
+    {
+        ok = cerrar_hora(serie, acumulador) && ok;
+    }
+    if (acumulador->hora.muestras == 0)
+    {
+        periodo_iniciar(&acumulador->hora, hora);
+    }
+    periodo_sumar(&acumulador->hora, minuto);
+    minuto->muestras = 0;
+    return ok;
+}
+
+static serie_acumulador_t *buscar_acumulador(serie_t *serie, uint8_t nodo)
+{
+    for (int i = 0; i < serie->num_acumuladores; i++)
+    {
+        if (serie->acumuladores[i].nodo == nodo)
+        {
+            return &serie->acumuladores[i];
+        }
+    }
+    if (serie->num_acumuladores == SERIE_MAX_NODOS)
+    {
+        return NULL;
+    }
+    serie_acumulador_t *acumulador = &serie->acumuladores[serie->num_acumuladores++];
+    memset(acumulador, 0, sizeof(*acumulador));
+    acumulador->nodo = nodo;
+    return acumulador;
+}
+
+// Con la resolucion de la trama binaria el bloque se comprime como enteros; las lecturas con mas decimales (texto
+// del modo AT) van como floats para no perderlos
+static bool cabe_en_enteros(const float *valores)
+{
+    for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+    {
+        float v = valores[p] * compresion_escalas_telemetria[p];
+        if (v != v)
+            continue;
+        // mismo redondeo que compresion.c; hasta 2^24 el entero es exacto en un float
+        if (v <= -16777216.0f || v >= 16777216.0f)
+            return false;
+        float q = (float)(int32_t)(v < 0 ? v - 0.5f : v + 0.5f);
+        if (q / compresion_escalas_telemetria[p] != valores[p])
+            return false;
+    }
+    return true;
+}
+
+// Empieza un bloque con su primera lectura
+static void bloque_iniciar(serie_bloque_t *bloque, compresion_t *compresion, uint8_t nodo, uint32_t t,
+                           const float *valores)
+{
+    memset(bloque, 0, sizeof(*bloque));
+    bloque->t = t;
+    bloque->t_fin = t;
+    bloque->nodo = nodo;
+    bloque->modo = cabe_en_enteros(valores) ? COMPRESION_ENTEROS : COMPRESION_XOR;
+    compresion_iniciar(compresion, (compresion_modo_t)bloque->modo, TELEMETRIA_NUM_PARAMETROS,
+                       compresion_escalas_telemetria, bloque->datos, sizeof(bloque->datos));
+    compresion_agregar(compresion, 0, valores); // una lectura siempre cabe
+    bloque->muestras = compresion->muestras;
+    bloque->len = (uint8_t)compresion_len(compresion);
+}
+
+static bool bloque_escribir(serie_t *serie, serie_bloque_t *bloque)
+{
+    if (bloque->muestras == 0)
+    {
+        return true;
+    }
+    bool ok = agregar(serie, SERIE_CRUDO, bloque);
+    serie->bloques++;
+    bloque->muestras = 0;
+    return ok;
+}
+
+// Agrega la lectura al bloque abierto del nodo. Si no cabe, es de antes que la ultima o el bloque ya tiene
+// SERIE_BLOQUE_MAX_S, lo escribe y empieza otro
+static bool bloque_agregar(serie_t *serie, serie_acumulador_t *acumulador, uint32_t t, const float *valores)
+{
+    serie_bloque_t *bloque = &acumulador->bloque;
+    bool agregada = bloque->muestras > 0 && t >= bloque->t_fin && t - bloque->t < SERIE_BLOQUE_MAX_S &&
+                    (bloque->modo == COMPRESION_XOR || cabe_en_enteros(valores)) &&
+                    compresion_agregar(&acumulador->compresion, t - bloque->t, valores);
+    if (!agregada)
+    {
+        bool ok = bloque_escribir(serie, bloque);
+        bloque_iniciar(bloque, &acumulador->compresion, acumulador->nodo, t, valores);
+        return ok;
+    }
+    bloque->muestras = acumulador->compresion.muestras;
+    bloque->t_fin = t;
+    bloque->len = (uint8_t)compresion_len(&acumulador->compresion);
+    return true;
+}
+
+bool serie_insertar(serie_t *serie, const telemetria_lectura_t *lectura, uint32_t t)
+{
+    if (t == BORRADO)
+    {
+        t--;
+    }
+    float valores[TELEMETRIA_NUM_PARAMETROS];
+    for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+    {
+        valores[p] = telemetria_valor(lectura, (telemetria_parametro_t)p);
+    }
+    serie->insertados++;
+
+    serie_acumulador_t *acumulador = buscar_acumulador(serie, lectura->origen);
+    if (acumulador == NULL)
+    {
+        // sin bloque abierto: va sola
+        serie_bloque_t bloque;
+        compresion_t compresion;
+        bloque_iniciar(&bloque, &compresion, lectura->origen, t, valores);
+        serie->sin_sitio++;
+        return bloque_escribir(serie, &bloque);
+    }
+    bool ok = bloque_agregar(serie, acumulador, t, valores);
+    serie_periodo_t *minuto = &acumulador->minuto;
+    if (minuto->muestras > 0 && t >= minuto->inicio + SERIE_MINUTO_S)
+    {
+        ok = cerrar_minuto(serie, acumulador) && ok;
+    }
+    if (minuto->muestras == 0)
+    {
+        periodo_iniciar(minuto, t - t % SERIE_MINUTO_S);
+    }
+    minuto->muestras++;
+    for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+    {
+        float valor = valores[p];
+        if (valor != valor)
+            continue;
+        minuto->validas[p]++;
+        minuto->suma[p] += valor;
+        if (valor < minuto->min[p])
+            minuto->min[p] = valor;
+        if (valor > minuto->max[p])
+            minuto->max[p] = valor;
+    }
+    return ok;
+}
+
+bool serie_cerrar_periodos(serie_t *serie, uint32_t t)
+{
+    bool ok = true;
+    for (int i = 0; i < serie->num_acumuladores; i++)
+    {
+        serie_acumulador_t *acumulador = &serie->acumuladores[i];
+        if (acumulador->bloque.muestras > 0 && t >= acumulador->bloque.t + SERIE_BLOQUE_MAX_S)
+        {
+            ok = bloque_escribir(serie, &acumulador->bloque) && ok;
+        }
+        if (acumulador->minuto.muestras > 0 && t >= acumulador->minuto.inicio + SERIE_MINUTO_S)
+        {
+            ok = cerrar_minuto(serie, acumulador) && ok;
+        }
+        if (acumulador->hora.muestras > 0 && t >= acumulador->hora.inicio + SERIE_HORA_S)
+        {
+            ok = cerrar_hora(serie, acumulador) && ok;
+        }
+    }
+    return ok;
+}
+
+bool serie_cerrar_bloques(serie_t *serie)
+{
+    bool ok = true;
+    for (int i = 0; i < serie->num_acumuladores; i++)
+    {
+        ok = bloque_escribir(serie, &serie->acumuladores[i].bloque) && ok;
+    }
+    return ok;
+}
+
+bool serie_sincronizar(serie_t *serie)
+{
+    bool ok = true;
+    for (int nivel = 0; nivel < SERIE_NUM_NIVELES; nivel++)
+    {
+        ok = vaciar(serie, &serie->niveles[nivel]) && ok;
+    }
+    return ok;
+}
+
+typedef struct
+{
+    uint8_t nodo;
+    int parametro;
+    uint32_t desde;
+    uint32_t hasta;
+    serie_callback_t callback;
+    void *arg;
+    int puntos;
+    float min;
+    float max;
+} consulta_t;
+
+// Pasa a usar los puntos del registro que entran en la consulta: uno por lectura en el nivel crudo. Devuelve
+// false si usar pide parar
+static bool puntos_registro(serie_nivel_t nivel, const uint8_t *registro, consulta_t *consulta,
+                            bool (*usar)(consulta_t *consulta, const serie_punto_t *punto))
+{
+    const serie_bloque_t *comun = (const serie_bloque_t *)registro;
+    if (consulta->nodo != SERIE_CUALQUIER_NODO && comun->nodo != consulta->nodo)
+    {
+        return true;
+    }
+    serie_punto_t punto = {.t = comun->t, .nodo = comun->nodo};
+    if (nivel != SERIE_CRUDO)
+    {
+        const serie_resumen_t *resumen = (const serie_resumen_t *)registro;
+        if (resumen->t < consulta->desde || resumen->t > consulta->hasta)
+            return true;
+        punto.muestras = resumen->muestras;
+        punto.min = resumen->min[consulta->parametro];
+        punto.max = resumen->max[consulta->parametro];
+        punto.media = resumen->media[consulta->parametro];
+        return usar(consulta, &punto);
+    }
+    if (comun->t > consulta->hasta || comun->t_fin < consulta->desde)
+    {
+        return true;
+    }
+    compresion_t compresion;
+    uint32_t t;
+    float valores[TELEMETRIA_NUM_PARAMETROS];
+    bloque_abrir(comun, &compresion);
+    while (compresion_leer(&compresion, &t, valores))
+    {
+        punto.t = comun->t + t;
+        if (punto.t < consulta->desde || punto.t > consulta->hasta)
+            continue;
+        punto.muestras = 1;
+        punto.min = punto.max = punto.media = valores[consulta->parametro];
+        if (!usar(consulta, &punto))
+            return false;
+    }
+    return true;
+}
+
+static bool entregar(consulta_t *consulta, const serie_punto_t *punto)
+{
+    consulta->puntos++;
+    return consulta->callback(punto, consulta->arg);
+}
+
+static bool entregar_punto(serie_t *serie, serie_nivel_t nivel, const uint8_t *registro, void *arg)
+{
+    (void)serie;
+    return puntos_registro(nivel, registro, (consulta_t *)arg, entregar);
+}
+
+int serie_consultar(serie_t *serie, serie_nivel_t nivel, uint8_t nodo, telemetria_parametro_t parametro,
+                    uint32_t desde, uint32_t hasta, serie_callback_t callback, void *arg)
+{
+    if (nivel >= SERIE_NUM_NIVELES || parametro >= TELEMETRIA_NUM_PARAMETROS)
+    {
+        return -1;
+    }
+    serie_anillo_t *anillo = &serie->niveles[nivel];
+    consulta_t consulta = {nodo, parametro, desde, hasta, callback, arg, 0, 0, 0};
+    serie_cabecera_t cabecera;
+    // del segmento mas viejo al activo
+    for (uint32_t i = 1; i <= anillo->segmentos; i++)
+    {
+        uint32_t s = (anillo->activo + i) % anillo->segmentos;
+        if (!leer_cabecera(serie, nivel, s, &cabecera) || cabecera.t_max < desde || cabecera.t_min > hasta ||
+            (nodo != SERIE_CUALQUIER_NODO && (cabecera.nodos & (1UL << (nodo % 32))) == 0))
+        {
+            continue;
+        }
+        int r = recorrer(serie, nivel, s, cabecera.usados, entregar_punto, &consulta);
+        if (r < 0)
+            return -1;
+        if (r == 0)
+            return consulta.puntos;
+    }
+    // y los bloques que todavia se estan armando
+    for (int i = 0; nivel == SERIE_CRUDO && i < serie->num_acumuladores; i++)
+    {
+        const serie_bloque_t *bloque = &serie->acumuladores[i].bloque;
+        if (bloque->muestras > 0 && !puntos_registro(nivel, (const uint8_t *)bloque, &consulta, entregar))
+            break;
+    }
+    return consulta.puntos;
+}
+
+static bool extremo(consulta_t *consulta, const serie_punto_t *punto)
+{
+    // NaN no cambia nada
+    if (punto->min < consulta->min)
+        consulta->min = punto->min;
+    if (punto->max > consulta->max)
+        consulta->max = punto->max;
+    return true;
+}
+
+static bool acumular_extremos(serie_t *serie, serie_nivel_t nivel, const uint8_t *registro, void *arg)
+{
+    (void)serie;
+    return puntos_registro(nivel, registro, (consulta_t *)arg, extremo);
+}
+
+bool serie_extremos(serie_t *serie, serie_nivel_t nivel, telemetria_parametro_t parametro, uint32_t desde,
+                    uint32_t hasta, float *min, float *max)
+{
+    if (nivel >= SERIE_NUM_NIVELES || parametro >= TELEMETRIA_NUM_PARAMETROS)
+    {
+        return false;
+    }
+    serie_anillo_t *anillo = &serie->niveles[nivel];
+    consulta_t consulta = {SERIE_CUALQUIER_NODO, parametro, desde, hasta, NULL, NULL, 0, FLT_MAX, -FLT_MAX};
+    serie_cabecera_t cabecera;
+    for (uint32_t s = 0; s < anillo->segmentos; s++)
+    {
+        if (!leer_cabecera(serie, nivel, s, &cabecera) || cabecera.t_max < desde || cabecera.t_min > hasta)
+        {
+            continue;
+        }
+        // el indice del activo (en RAM) tambien esta al dia
+        if (cabecera.t_min >= desde && cabecera.t_max <= hasta && (cabecera.abierto == 0 || s == anillo->activo))
+        {
+            if (cabecera.min[parametro] < consulta.min)
+                consulta.min = cabecera.min[parametro];
+            if (cabecera.max[parametro] > consulta.max)
+                consulta.max = cabecera.max[parametro];
+        }
+        else if (recorrer(serie, nivel, s, cabecera.usados, acumular_extremos, &consulta) < 0)
+        {
+            return false;
+        }
+    }
+    for (int i = 0; nivel == SERIE_CRUDO && i < serie->num_acumuladores; i++)
+    {
+        const serie_bloque_t *bloque = &serie->acumuladores[i].bloque;
+        if (bloque->muestras > 0)
+            puntos_registro(nivel, (const uint8_t *)bloque, &consulta, extremo);
+    }
+    *min = consulta.min;
+    *max = consulta.max;
+    return consulta.min <= consulta.max;
+}
+
+uint32_t serie_inicio(serie_t *serie, serie_nivel_t nivel)
+{
+    serie_anillo_t *anillo = &serie->niveles[nivel];
+    serie_cabecera_t cabecera;
+    for (uint32_t i = 1; i <= anillo->segmentos; i++)
+    {
+        if (leer_cabecera(serie, nivel, (anillo->activo + i) % anillo->segmentos, &cabecera))
+        {
+            return cabecera.t_min;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,345 @@
+/*
+  Benchmark del detector de anomalias del transmisor (anomalias.c)
+
+  Trazas sinteticas de una lectura cada 10 s con el ciclo diario, el ruido y la resolucion de los sensores del
+  transmisor (DS18B20 en pasos de 0.0625 C; EC, pH y TDS en pasos de 1 mV del ADC). Con la configuracion de
+  anomalias_config_defecto da:
+   - falsas alarmas por dia en trazas limpias (30 dias), por tipo
+   - por cada evento inyectado (200 veces, a una hora al azar entre las 6 y las 18 h): % detectado en 2 h,
+     retraso p50/p90 desde que empieza hasta que el detector marca el parametro (cualquier anomalia: todas
+     envian en el acto) y la anomalia que lo marca primero mas a menudo. Al lado, si lo hubiera visto
+     comandos_fuera_de_umbral con los umbrales de la simulacion, que es lo unico que adelantaba un lote antes
+   - tiempo por lectura (4 parametros) en este host, en ns y en ciclos de TSC si es x86
+  Sale con error si pasa de BENCH_FALSAS_MAX_DIA falsas alarmas por dia, o si un evento queda por debajo de su %
+  minimo de detectados o por encima de su p90 maximo (tabla eventos). El tiempo solo se muestra.
+
+  Uso: bench_anomalias [lecturas para el tiempo]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_TSC 1
+#else
+#define BENCH_TSC 0
+#endif
+
+#include "telemetria.h"
+#include "comandos.h"
+#include "anomalias.h"
+
+#define BENCH_PERIODO_S 10
+#define BENCH_DIA (86400 / BENCH_PERIODO_S)
+#define BENCH_DIAS_LIMPIOS 30
+#define BENCH_PRUEBAS 200
+#define BENCH_VENTANA (7200 / BENCH_PERIODO_S) // lecturas para detectar
+#define BENCH_LECTURAS_TIEMPO 1000000
+#define PI 3.14159265f
+#define BENCH_FALSAS_MAX_DIA 0.5 // todas las anomalias juntas, envian una lectura cada una
+
+// umbrales de la simulacion (EC en uS/cm, como envia el transmisor)
+#define EC_MAX 2000.0f
+#define PH_MIN 6.5f
+#define PH_MAX 8.5f
+#define TDS_MAX 1000.0f
+#define TEMP_MAX 30.0f
+
+// pendientes de calcular_ec y calcular_ph del transmisor: lo que vale 1 mV
+#define EC_POR_MV 4.40f
+#define PH_POR_MV 0.00565f
+#define EC_RIEL 14120.0f // 3100 mV
+
+typedef enum
+{
+    EVENTO_PICO = 0,
+    EVENTO_ESCALON_2,
+    EVENTO_ESCALON_4,
+    EVENTO_ESCALON_10,
+    EVENTO_DERIVA_5,
+    EVENTO_DERIVA_20,
+    EVENTO_PH,
+    EVENTO_ATASCADO_EC,
+    EVENTO_ATASCADO_TEMP,
+    EVENTO_RIEL,
+    NUM_EVENTOS
+} evento_t;
+
+// minimo_pct: % de eventos que se tienen que detectar; p90_max_s: retraso p90 maximo (0 sin limite)
+// La deriva de 5 sigma/h no tiene minimo: en 2 h no se distingue del ciclo diario
+static const struct
+{
+    const char *nombre;
+    telemetria_parametro_t parametro;
+    float minimo_pct;
+    uint32_t p90_max_s;
+} eventos[NUM_EVENTOS] = {
+    {"pico EC +10 sigma, 1 lectura", TELEMETRIA_EC, 99.0f, 10},
+    {"escalon EC +2 sigma", TELEMETRIA_EC, 80.0f, 600},
+    {"escalon EC +4 sigma", TELEMETRIA_EC, 99.0f, 120},
+    {"escalon EC +10 sigma", TELEMETRIA_EC, 99.0f, 10},
+    {"deriva EC +5 sigma/h", TELEMETRIA_EC, 0.0f, 0},
+    {"deriva EC +20 sigma/h", TELEMETRIA_EC, 95.0f, 1200},
+    {"escalon pH -0.1", TELEMETRIA_PH, 99.0f, 60},
+    {"EC atascada", TELEMETRIA_EC, 99.0f, 600},
+    {"DS18B20 suelto (25.0)", TELEMETRIA_TEMPERATURA, 99.0f, 600},
+    {"EC en el riel del ADC", TELEMETRIA_EC, 99.0f, 10},
+};
+
+#define SIGMA_EC 5.0f
+
+static uint32_t semilla = 12345;
+
+static float ruido(float sigma)
+{
+    // suma de 4 uniformes, aproximadamente normal
+    float s = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        semilla = semilla * 1103515245u + 12345u;
+        s += (float)(semilla >> 8) / (float)(1u << 24) - 0.5f;
+    }
+    return s * sigma * 1.732f;
+}
+
+static uint32_t aleatorio(uint32_t n)
+{
+    semilla = semilla * 1103515245u + 12345u;
+    return (semilla >> 8) % n;
+}
+
+static float cuantizar(float v, float paso)
+{
+    return roundf(v / paso) * paso;
+}
+
+// lectura limpia n (tiempo n * BENCH_PERIODO_S)
+static telemetria_lectura_t limpia(uint32_t n)
+{
+    float dia = 2 * PI * (float)(n % BENCH_DIA) / BENCH_DIA;
+    telemetria_lectura_t l = {0};
+    l.origen = 1;
+    l.temperatura = cuantizar(24.0f + 1.5f * sinf(dia) + ruido(0.03f), 0.0625f);
+    l.ec = cuantizar(1500.0f + 30.0f * sinf(dia) + ruido(SIGMA_EC), EC_POR_MV);
+    l.ph = cuantizar(7.2f + ruido(0.01f), PH_POR_MV);
+    l.tds = cuantizar(750.0f + 15.0f * sinf(dia) + ruido(3.0f), 0.5f);
+    return l;
+}
+
+static void configurar_umbrales(comandos_config_t *config)
+{
+    comandos_config_defecto(config, BENCH_PERIODO_S);
+    config->umbral_max[TELEMETRIA_TEMPERATURA] = TEMP_MAX;
+    config->umbral_max[TELEMETRIA_EC] = EC_MAX;
+    config->umbral_min[TELEMETRIA_PH] = PH_MIN;
+    config->umbral_max[TELEMETRIA_PH] = PH_MAX;
+    config->umbral_max[TELEMETRIA_TDS] = TDS_MAX;
+}
+
+// Aplica el evento a la lectura k lecturas despues de empezar. Devuelve los bits de riel
+static uint8_t contaminar(evento_t e, telemetria_lectura_t *l, uint32_t k, const telemetria_lectura_t *congelada)
+{
+    switch (e)
+    {
+    case EVENTO_PICO:
+        if (k == 0)
+            l->ec += 10 * SIGMA_EC;
+        break;
+    case EVENTO_ESCALON_2:
+        l->ec += 2 * SIGMA_EC;
+        break;
+    case EVENTO_ESCALON_4:
+        l->ec += 4 * SIGMA_EC;
+        break;
+    case EVENTO_ESCALON_10:
+        l->ec += 10 * SIGMA_EC;
+        break;
+    case EVENTO_DERIVA_5:
+        l->ec += 5 * SIGMA_EC * (float)(k * BENCH_PERIODO_S) / 3600.0f;
+        break;
+    case EVENTO_DERIVA_20:
+        l->ec += 20 * SIGMA_EC * (float)(k * BENCH_PERIODO_S) / 3600.0f;
+        break;
+    case EVENTO_PH:
+        l->ph -= 0.1f;
+        break;
+    case EVENTO_ATASCADO_EC:
+        l->ec = congelada->ec;
+        break;
+    case EVENTO_ATASCADO_TEMP:
+        l->temperatura = 25.0f; // lo que devuelve ds18b20_leer sin sensor
+        break;
+    case EVENTO_RIEL:
+        l->ec = EC_RIEL;
+        return 1u << TELEMETRIA_EC;
+    default:
+        break;
+    }
+    return 0;
+}
+
+static int comparar(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Devuelve 1 si pasa de BENCH_FALSAS_MAX_DIA
+static int falsas_alarmas(const anomalias_config_t *config)
+{
+    static anomalias_t a;
+    anomalias_iniciar(&a);
+    semilla = 777;
+    uint32_t total = BENCH_DIAS_LIMPIOS * BENCH_DIA;
+    for (uint32_t n = 0; n < total; n++)
+    {
+        telemetria_lectura_t l = limpia(n);
+        anomalias_evaluar(&a, config, &l, 0, n * BENCH_PERIODO_S, NULL);
+    }
+    printf("Falsas alarmas por dia en %d dias limpios (lectura cada %d s, %d lecturas/dia):", BENCH_DIAS_LIMPIOS,
+           BENCH_PERIODO_S, BENCH_DIA);
+    uint32_t falsas = 0;
+    for (int t = ANOMALIA_CAMBIO; t < ANOMALIA_NUM; t++)
+    {
+        printf(" %s %.2f", anomalias_nombre((anomalia_t)t), (double)a.detectadas[t] / BENCH_DIAS_LIMPIOS);
+        falsas += a.detectadas[t];
+    }
+    printf("\n\n");
+    if ((double)falsas / BENCH_DIAS_LIMPIOS > BENCH_FALSAS_MAX_DIA)
+    {
+        printf("FALLO: %.2f falsas alarmas por dia (max %.2f)\n\n", (double)falsas / BENCH_DIAS_LIMPIOS,
+               BENCH_FALSAS_MAX_DIA);
+        return 1;
+    }
+    return 0;
+}
+
+// Devuelve 1 si el evento no cumple su minimo de detectados o su p90 maximo
+static int inyectar(const anomalias_config_t *config, evento_t e)
+{
+    static uint32_t retrasos[BENCH_PRUEBAS];
+    int detectados = 0, por_umbral = 0;
+    int primera[ANOMALIA_NUM] = {0};
+    comandos_config_t umbrales;
+    configurar_umbrales(&umbrales);
+    semilla = 1000 + (uint32_t)e;
+    for (int prueba = 0; prueba < BENCH_PRUEBAS; prueba++)
+    {
+        anomalias_t a;
+        anomalias_iniciar(&a);
+        uint32_t inicio = BENCH_DIA / 4 + aleatorio(BENCH_DIA / 2);
+        telemetria_lectura_t congelada = {0};
+        bool umbral = false, detectado = false;
+        for (uint32_t n = 0; n < inicio + BENCH_VENTANA; n++)
+        {
+            telemetria_lectura_t l = limpia(n);
+            uint8_t riel = 0;
+            if (n < inicio)
+            {
+                congelada = l;
+            }
+            else
+            {
+                riel = contaminar(e, &l, n - inicio, &congelada);
+                umbral |= comandos_fuera_de_umbral(&umbrales, &l);
+            }
+            anomalia_t motivos[TELEMETRIA_NUM_PARAMETROS];
+            anomalias_evaluar(&a, config, &l, riel, n * BENCH_PERIODO_S, motivos);
+            anomalia_t m = motivos[eventos[e].parametro];
+            if (n >= inicio && m != ANOMALIA_NINGUNA && !detectado)
+            {
+                retrasos[detectados++] = (n - inicio) * BENCH_PERIODO_S;
+                primera[m]++;
+                detectado = true;
+            }
+        }
+        por_umbral += umbral;
+    }
+    qsort(retrasos, (size_t)detectados, sizeof(retrasos[0]), comparar);
+    anomalia_t mas = ANOMALIA_NINGUNA;
+    for (int t = ANOMALIA_CAMBIO; t < ANOMALIA_NUM; t++)
+    {
+        if (primera[t] > primera[mas])
+            mas = (anomalia_t)t;
+    }
+    printf("%-30s %9.1f%%", eventos[e].nombre, 100.0 * detectados / BENCH_PRUEBAS);
+    if (detectados > 0)
+        printf(" %9lu %9lu", (unsigned long)retrasos[(detectados - 1) / 2],
+               (unsigned long)retrasos[(detectados - 1) * 9 / 10]);
+    else
+        printf(" %9s %9s", "-", "-");
+    printf(" %-9s %9.1f%%\n", detectados > 0 ? anomalias_nombre(mas) : "-", 100.0 * por_umbral / BENCH_PRUEBAS);
+
+    float pct = 100.0f * detectados / BENCH_PRUEBAS;
+    uint32_t p90 = detectados > 0 ? retrasos[(detectados - 1) * 9 / 10] : 0;
+    if (pct < eventos[e].minimo_pct || (eventos[e].p90_max_s > 0 && p90 > eventos[e].p90_max_s))
+    {
+        printf("FALLO %s: %.1f%% detectados (min %.1f%%), p90 %lu s (max %lu s)\n", eventos[e].nombre, pct,
+               eventos[e].minimo_pct, (unsigned long)p90, (unsigned long)eventos[e].p90_max_s);
+        return 1;
+    }
+    return 0;
+}
+
+static void tiempo(const anomalias_config_t *config, uint32_t num)
+{
+    static telemetria_lectura_t lecturas[BENCH_DIA];
+    semilla = 4242;
+    for (uint32_t n = 0; n < BENCH_DIA; n++)
+    {
+        lecturas[n] = limpia(n);
+    }
+    anomalias_t a;
+    anomalias_iniciar(&a);
+    volatile anomalia_t sumidero = ANOMALIA_NINGUNA;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+#if BENCH_TSC
+    uint64_t c0 = __rdtsc();
+#endif
+    for (uint32_t n = 0; n < num; n++)
+    {
+        sumidero = anomalias_evaluar(&a, config, &lecturas[n % BENCH_DIA], 0, n * BENCH_PERIODO_S, NULL);
+    }
+#if BENCH_TSC
+    uint64_t c1 = __rdtsc();
+#endif
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    (void)sumidero;
+    double ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / num;
+    printf("\nTiempo por lectura (%d parametros, %lu lecturas): %.1f ns", TELEMETRIA_NUM_PARAMETROS,
+           (unsigned long)num, ns);
+#if BENCH_TSC
+    printf(", %.0f ciclos de TSC", (double)(c1 - c0) / num);
+#endif
+    printf("; estado %u bytes\n", (unsigned)sizeof(anomalias_t));
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t num = argc > 1 ? (uint32_t)atoi(argv[1]) : BENCH_LECTURAS_TIEMPO;
+    if (num == 0)
+        num = 1;
+    anomalias_config_t config;
+    anomalias_config_defecto(&config);
+    printf("Detector de anomalias: alfa %.3f, pico %.1f sigma, CUSUM k %.2f h %.1f, calentamiento %u lecturas\n\n",
+           config.alfa, config.z_pico, config.cusum_k, config.cusum_h, config.calentamiento);
+
+    int fallos = falsas_alarmas(&config);
+    printf("%-30s %10s %9s %9s %-9s %10s\n", "evento", "detectado", "p50 s", "p90 s", "primera", "umbral");
+    for (int e = 0; e < NUM_EVENTOS; e++)
+    {
+        fallos += inyectar(&config, (evento_t)e);
+    }
+    tiempo(&config, num);
+    if (fallos > 0)
+    {
+        printf("\nFALLO: %d comprobaciones\n", fallos);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
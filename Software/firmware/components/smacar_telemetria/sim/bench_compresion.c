@@ -0,0 +1,399 @@
+/*
+  Benchmark de la compresion de series de lecturas (compresion.c)
+
+  Compara los bytes por lectura de cada forma de guardar o enviar (t, temperatura, ec, ph, tds):
+   - texto: el mensaje del modo AT ("T:TEMP:25.00C,EC:1548.00,pH:7.00,TDS:300.00")
+   - trama: la trama binaria de TELEMETRIA_LEN bytes, una por lectura
+   - floats: t de 32 bits y los 4 floats, como el registro crudo que tenia el historico
+   - varint: diferencias con la lectura anterior con la resolucion de la trama, en zig-zag y varint de bytes
+     enteros (LEB128). Referencia de lo que se gana empaquetando en bits
+   - xor: COMPRESION_XOR sobre los floats tal cual (sin perdida)
+   - enteros: COMPRESION_ENTEROS con la resolucion de la trama
+   - lote: TELEMETRIA_CTRL_LOTE de COMANDOS_MAX_LOTE lecturas, cabecera incluida, como sale del transmisor
+  Mide tambien la velocidad de codificar y decodificar en el host y comprueba que xor devuelve los mismos bits y
+  enteros lo mismo que la trama binaria, y que se rechaza un bloque corrupto.
+
+  Uso: bench_compresion [log ...]
+  Cada log es la salida de idf.py monitor del receptor, como en replay_alertas: se leen las lineas
+    I (<ms>) LORA_RX: Datos extraídos y enviados a Blynk: T=<t>, EC=<ec>, pH=<ph>, TDS=<tds>
+  Sin argumentos se usan trazas sinteticas de 24 h con una lectura cada 2 s.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "telemetria.h"
+#include "compresion.h"
+
+#define BENCH_MAX_LECTURAS 200000
+#define BENCH_PERIODO_MS 2000
+#define BENCH_DISPERSION_PCT 5 // PERIODO_DISPERSION_PCT del transmisor
+#define BENCH_DURACION_MS (24UL * 3600UL * 1000UL)
+#define BENCH_LOTE 16 // COMANDOS_MAX_LOTE
+#define BENCH_REPETICIONES 5
+#define PI 3.14159265f
+
+typedef struct
+{
+    uint32_t t; // s
+    float valores[TELEMETRIA_NUM_PARAMETROS];
+} muestra_t;
+
+static muestra_t traza[BENCH_MAX_LECTURAS];
+static uint8_t comprimido[BENCH_MAX_LECTURAS * 24];
+static uint32_t semilla = 12345;
+static int fallos = 0;
+
+static float aleatorio(void)
+{
+    semilla = semilla * 1103515245u + 12345u;
+    return (float)(semilla >> 8) / (float)(1u << 24);
+}
+
+static float ruido(float sigma)
+{
+    // suma de 4 uniformes, aproximadamente normal
+    float s = 0;
+    for (int i = 0; i < 4; i++)
+        s += aleatorio() - 0.5f;
+    return s * sigma * 1.732f;
+}
+
+static double ns_entre(const struct timespec *a, const struct timespec *b)
+{
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
+
+static void a_lectura(const muestra_t *m, telemetria_lectura_t *l)
+{
+    memset(l, 0, sizeof(*l));
+    l->origen = 1;
+    l->temperatura = m->valores[TELEMETRIA_TEMPERATURA];
+    l->ec = m->valores[TELEMETRIA_EC];
+    l->ph = m->valores[TELEMETRIA_PH];
+    l->tds = m->valores[TELEMETRIA_TDS];
+}
+
+// lo que llega al receptor por la trama binaria; el NaN (sonda desconectada) se conserva
+static void por_trama(const muestra_t *m, float *valores)
+{
+    telemetria_lectura_t l;
+    uint8_t trama[TELEMETRIA_LEN];
+    a_lectura(m, &l);
+    telemetria_codificar(&l, trama);
+    telemetria_decodificar(trama, sizeof(trama), &l);
+    for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+    {
+        float v = telemetria_valor(&l, (telemetria_parametro_t)p);
+        valores[p] = m->valores[p] != m->valores[p] ? NAN : v;
+    }
+}
+
+static double bytes_texto(int num)
+{
+    size_t total = 0;
+    for (int i = 0; i < num; i++)
+    {
+        char texto[128];
+        const float *v = traza[i].valores;
+        total += (size_t)snprintf(texto, sizeof(texto), "T:TEMP:%.2fC,EC:%.2f,pH:%.2f,TDS:%.2f", v[0], v[1], v[2],
+                                  v[3]);
+    }
+    return (double)total / num;
+}
+
+static size_t varint(uint8_t *p, int32_t v)
+{
+    uint32_t z = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+    size_t n = 0;
+    do
+    {
+        p[n++] = (uint8_t)((z & 0x7F) | (z > 0x7F ? 0x80 : 0));
+        z >>= 7;
+    } while (z > 0);
+    return n;
+}
+
+static double bytes_varint(int num)
+{
+    size_t total = 0;
+    int32_t previo[TELEMETRIA_NUM_PARAMETROS] = {0};
+    uint32_t t_previo = traza[0].t;
+    for (int i = 0; i < num; i++)
+    {
+        uint8_t buffer[5 * (TELEMETRIA_NUM_PARAMETROS + 1)];
+        float valores[TELEMETRIA_NUM_PARAMETROS];
+        por_trama(&traza[i], valores);
+        size_t n = varint(buffer, (int32_t)(traza[i].t - t_previo));
+        t_previo = traza[i].t;
+        for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+        {
+            int32_t q = valores[p] == valores[p] ? (int32_t)lroundf(valores[p] * compresion_escalas_telemetria[p]) : 0;
+            n += varint(&buffer[n], q - previo[p]);
+            previo[p] = q;
+        }
+        total += n;
+    }
+    return (double)total / num;
+}
+
+static bool iguales(float a, float b)
+{
+    return memcmp(&a, &b, sizeof(a)) == 0 || (a != a && b != b);
+}
+
+typedef struct
+{
+    double bytes;      // por lectura
+    double ns_codificar;
+    double ns_decodificar;
+    bool correcto;
+} resultado_t;
+
+// Toda la traza en un solo bloque
+static resultado_t medir(compresion_modo_t modo, int num)
+{
+    resultado_t r = {0, 0, 0, true};
+    compresion_t bloque;
+    static float entrada[BENCH_MAX_LECTURAS][TELEMETRIA_NUM_PARAMETROS];
+    for (int i = 0; i < num; i++)
+    {
+        if (modo == COMPRESION_ENTEROS)
+            por_trama(&traza[i], entrada[i]);
+        else
+            memcpy(entrada[i], traza[i].valores, sizeof(entrada[i]));
+    }
+
+    struct timespec t0, t1;
+    size_t len = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int k = 0; k < BENCH_REPETICIONES; k++)
+    {
+        compresion_iniciar(&bloque, modo, TELEMETRIA_NUM_PARAMETROS, compresion_escalas_telemetria, comprimido,
+                           sizeof(comprimido));
+        for (int i = 0; i < num; i++)
+        {
+            if (!compresion_agregar(&bloque, traza[i].t - traza[0].t, traza[i].valores))
+                r.correcto = false;
+        }
+        len = compresion_len(&bloque);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    r.ns_codificar = ns_entre(&t0, &t1) / BENCH_REPETICIONES / num;
+    r.bytes = (double)len / num;
+
+    int distintas = 0, leidas = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int k = 0; k < BENCH_REPETICIONES; k++)
+    {
+        compresion_abrir(&bloque, modo, TELEMETRIA_NUM_PARAMETROS, compresion_escalas_telemetria, comprimido, len,
+                         (uint16_t)0xFFFF);
+        leidas = 0;
+        uint32_t t;
+        float valores[TELEMETRIA_NUM_PARAMETROS];
+        while (leidas < num && compresion_leer(&bloque, &t, valores))
+        {
+            if (k == 0)
+            {
+                distintas += t != traza[leidas].t - traza[0].t;
+                for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+                    distintas += !iguales(valores[p], entrada[leidas][p]);
+            }
+            leidas++;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    r.ns_decodificar = ns_entre(&t0, &t1) / BENCH_REPETICIONES / num;
+    r.correcto = r.correcto && leidas == num && distintas == 0;
+    return r;
+}
+
+// Lotes de BENCH_LOTE lecturas como los manda el transmisor
+static double bytes_lote(int num, bool *correcto)
+{
+    size_t total = 0;
+    for (int i = 0; i < num; i += BENCH_LOTE)
+    {
+        telemetria_lectura_t lecturas[BENCH_LOTE], recibidas[TELEMETRIA_LOTE_MAX_LECTURAS];
+        uint32_t t_s[BENCH_LOTE], edad_s[TELEMETRIA_LOTE_MAX_LECTURAS];
+        int n = num - i < BENCH_LOTE ? num - i : BENCH_LOTE;
+        for (int k = 0; k < n; k++)
+        {
+            a_lectura(&traza[i + k], &lecturas[k]);
+            lecturas[k].secuencia = (uint16_t)(i + k);
+            t_s[k] = traza[i + k].t;
+        }
+        uint8_t trama[TELEMETRIA_LOTE_MAX_LEN];
+        size_t len;
+        size_t enviadas = telemetria_codificar_lote(lecturas, t_s, n, true, trama, sizeof(trama), &len);
+        int recibidas_num = telemetria_decodificar_lote(trama, len, recibidas, edad_s, TELEMETRIA_LOTE_MAX_LECTURAS);
+        if (enviadas != (size_t)n || recibidas_num != n)
+        {
+            *correcto = false;
+            continue;
+        }
+        for (int k = 0; k < n; k++)
+        {
+            float valores[TELEMETRIA_NUM_PARAMETROS];
+            por_trama(&traza[i + k], valores);
+            for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+            {
+                if (!iguales(telemetria_valor(&recibidas[k], (telemetria_parametro_t)p), valores[p]))
+                    *correcto = false;
+            }
+            if (edad_s[k] != t_s[n - 1] - t_s[k] || recibidas[k].secuencia != i + k)
+                *correcto = false;
+        }
+        total += len;
+    }
+    return (double)total / num;
+}
+
+// Un bloque corrupto con una ventana nueva de 31 ceros delante y 32 bits con sentido, que no cabe en un float:
+// t = 0 | 11 + 11111 + 11111 + 32 bits. compresion_leer tiene que rechazarlo, no desplazar fuera de rango
+static void bloque_corrupto(void)
+{
+    static const uint8_t datos[] = {0x7F, 0xFF, 0xFF, 0xFF, 0xFF, 0xF8};
+    compresion_t bloque;
+    uint32_t t;
+    float valores[TELEMETRIA_NUM_PARAMETROS];
+    compresion_abrir(&bloque, COMPRESION_XOR, TELEMETRIA_NUM_PARAMETROS, compresion_escalas_telemetria, datos,
+                     sizeof(datos), 1);
+    if (compresion_leer(&bloque, &t, valores))
+    {
+        printf("FALLA: se acepto un bloque con la ventana fuera de 32 bits\n");
+        fallos++;
+    }
+}
+
+static void comparar(const char *nombre, int num)
+{
+    if (num < 2)
+    {
+        printf("%-36s sin lecturas\n", nombre);
+        return;
+    }
+    resultado_t xor = medir(COMPRESION_XOR, num);
+    resultado_t enteros = medir(COMPRESION_ENTEROS, num);
+    bool lote_correcto = true;
+    double lote = bytes_lote(num, &lote_correcto);
+    printf("%-36s %8d %6.1f %6d %6d %6.2f %6.2f %6.2f %6.2f %5.0f/%-4.0f %5.0f/%-4.0f\n", nombre, num,
+           bytes_texto(num), TELEMETRIA_LEN, 4 + 4 * TELEMETRIA_NUM_PARAMETROS, bytes_varint(num), xor.bytes,
+           enteros.bytes, lote, xor.ns_codificar, xor.ns_decodificar, enteros.ns_codificar, enteros.ns_decodificar);
+    if (!xor.correcto || !enteros.correcto || !lote_correcto)
+    {
+        printf("  FALLA: xor %s, enteros %s, lote %s\n", xor.correcto ? "ok" : "distinto",
+               enteros.correcto ? "ok" : "distinto", lote_correcto ? "ok" : "distinto");
+        fallos++;
+    }
+}
+
+// genera una traza de 24 h; valor(t) cambia la lectura en el segundo t
+static int sintetica(void (*valor)(float t, float *valores))
+{
+    int num = 0;
+    uint32_t ms = 0;
+    while (ms < BENCH_DURACION_MS && num < BENCH_MAX_LECTURAS)
+    {
+        float *v = traza[num].valores;
+        float dia = 2 * PI * ms / (float)BENCH_DURACION_MS;
+        v[TELEMETRIA_TEMPERATURA] = 20.0f + 2.0f * sinf(dia) + ruido(0.05f);
+        v[TELEMETRIA_EC] = 1500.0f + 30.0f * sinf(dia) + ruido(2.0f);
+        v[TELEMETRIA_PH] = 7.2f + ruido(0.01f);
+        v[TELEMETRIA_TDS] = 300.0f + 5.0f * sinf(dia) + ruido(0.5f);
+        valor(ms / 1000.0f, v);
+        traza[num].t = ms / 1000;
+        num++;
+        ms += BENCH_PERIODO_MS + (uint32_t)(aleatorio() * BENCH_PERIODO_MS * BENCH_DISPERSION_PCT / 100);
+    }
+    return num;
+}
+
+static void tal_cual(float t, float *v)
+{
+    (void)t;
+    (void)v;
+}
+
+// sensor que apenas se mueve: lo normal en un tanque estable
+static void estable(float t, float *v)
+{
+    (void)t;
+    v[TELEMETRIA_TEMPERATURA] = 20.0f + ruido(0.01f);
+    v[TELEMETRIA_EC] = 1500.0f;
+    v[TELEMETRIA_TDS] = 300.0f;
+}
+
+// ruido del ADC sin filtrar: el peor caso
+static void ruidoso(float t, float *v)
+{
+    (void)t;
+    v[TELEMETRIA_TEMPERATURA] += ruido(0.5f);
+    v[TELEMETRIA_EC] += ruido(40.0f);
+    v[TELEMETRIA_PH] += ruido(0.2f);
+    v[TELEMETRIA_TDS] += ruido(10.0f);
+}
+
+// sonda de pH desconectada la mitad del dia
+static void sin_ph(float t, float *v)
+{
+    if (t >= 43200)
+        v[TELEMETRIA_PH] = NAN;
+}
+
+// ESP-IDF monitor del receptor
+static int leer_log(const char *ruta)
+{
+    FILE *f = fopen(ruta, "r");
+    if (f == NULL)
+    {
+        fprintf(stderr, "No se pudo abrir %s\n", ruta);
+        return -1;
+    }
+    char linea[512];
+    int num = 0;
+    while (fgets(linea, sizeof(linea), f) != NULL && num < BENCH_MAX_LECTURAS)
+    {
+        unsigned long ms;
+        char *p = strchr(linea, '(');
+        char *q = strstr(linea, "T=");
+        if (p == NULL || q == NULL || sscanf(p, "(%lu)", &ms) != 1)
+            continue;
+        float *v = traza[num].valores;
+        if (sscanf(q, "T=%f, EC=%f, pH=%f, TDS=%f", &v[0], &v[1], &v[2], &v[3]) == 4)
+        {
+            traza[num].t = (uint32_t)(ms / 1000);
+            num++;
+        }
+    }
+    fclose(f);
+    return num;
+}
+
+int main(int argc, char **argv)
+{
+    bloque_corrupto();
+    printf("bytes por lectura; ns por lectura codificando/decodificando\n");
+    printf("%-36s %8s %6s %6s %6s %6s %6s %6s %6s %10s %10s\n", "traza", "lecturas", "texto", "trama", "floats",
+           "varint", "xor", "enteros", "lote", "ns xor", "ns enteros");
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            int num = leer_log(argv[i]);
+            if (num < 0)
+                return EXIT_FAILURE;
+            comparar(argv[i], num);
+        }
+        return fallos == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    comparar("sintetica: ciclo diario", sintetica(tal_cual));
+    comparar("sintetica: tanque estable", sintetica(estable));
+    comparar("sintetica: ADC ruidoso", sintetica(ruidoso));
+    comparar("sintetica: sin sonda de pH 12 h", sintetica(sin_ph));
+    return fallos == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,388 @@
+/*
+  Benchmark del historico del receptor (serie.c) sobre una flash NOR emulada en RAM
+
+  La flash emulada se comporta como la SPI del ESP32: borrar pone un sector a 0xFF y programar solo puede pasar
+  bits de 1 a 0 (si una escritura necesita un 0 -> 1 el benchmark falla). Cuenta borrados por sector y paginas
+  programadas para estimar desgaste y tiempo de flash con los tiempos tipicos de una W25Q32 (0.4 ms por pagina,
+  45 ms por sector).
+
+  Escenario: particion de 0x270000 (la de partitions.csv del receptor), 4 nodos con una lectura cada 2 s
+  (periodo por defecto del transmisor) durante 30 dias, con la resolucion de la trama binaria; el receptor
+  sincroniza y cierra periodos cada minuto.
+  Mide:
+   - insercion: ns por lectura y llamadas a la flash
+   - bytes por lectura del nivel crudo comprimido frente al registro fijo de 24 bytes
+   - amplificacion de escritura: bytes programados y borrados frente a los bytes de registros
+   - cuanto historico queda en cada nivel
+   - consultas por rango: ns por punto y segmentos leidos frente a los del nivel
+   - serie_extremos con el indice frente a recorrer los registros
+  Y comprueba que el nivel crudo devuelve las lecturas exactas, que los resumenes horarios coinciden con los
+  calculados directamente, que los datos sobreviven a un reinicio y que un registro a medias por un corte de luz
+  se descarta sin perder los demas.
+
+  Uso: bench_serie
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+
+#include "telemetria.h"
+#include "serie.h"
+
+#define BENCH_FLASH 0x270000
+#define BENCH_NODOS 4
+#define BENCH_PERIODO_S 2
+#define BENCH_DIAS 30
+#define BENCH_INICIO 1760000400u // s, oct 2025, en punto
+#define BENCH_T_PAGINA_MS 0.4
+#define BENCH_T_SECTOR_MS 45.0
+#define BENCH_CICLOS 100000.0
+#define BENCH_REGISTRO_FIJO 24 // t, nodo, suma, secuencia y 4 floats: el nivel crudo sin comprimir
+#define PI 3.14159265
+
+typedef struct
+{
+    uint8_t datos[BENCH_FLASH];
+    uint32_t borrados[BENCH_FLASH / SERIE_SEGMENTO];
+    uint64_t paginas;
+    uint64_t escrituras;
+    uint64_t lecturas;
+    int violaciones;
+} flash_t;
+
+static flash_t flash, copia;
+
+static bool flash_leer(void *ctx, uint32_t dir, void *datos, size_t len)
+{
+    flash_t *f = (flash_t *)ctx;
+    if (dir + len > BENCH_FLASH)
+        return false;
+    memcpy(datos, &f->datos[dir], len);
+    f->lecturas++;
+    return true;
+}
+
+static bool flash_escribir(void *ctx, uint32_t dir, const void *datos, size_t len)
+{
+    flash_t *f = (flash_t *)ctx;
+    const uint8_t *d = (const uint8_t *)datos;
+    if (dir + len > BENCH_FLASH)
+        return false;
+    for (size_t i = 0; i < len; i++)
+    {
+        if ((f->datos[dir + i] & d[i]) != d[i])
+            f->violaciones++;
+        f->datos[dir + i] &= d[i];
+    }
+    f->paginas += (dir + len - 1) / SERIE_PAGINA - dir / SERIE_PAGINA + 1;
+    f->escrituras++;
+    return true;
+}
+
+static bool flash_borrar(void *ctx, uint32_t dir, size_t len)
+{
+    flash_t *f = (flash_t *)ctx;
+    if (dir % SERIE_SEGMENTO != 0 || len % SERIE_SEGMENTO != 0 || dir + len > BENCH_FLASH)
+        return false;
+    memset(&f->datos[dir], 0xFF, len);
+    for (size_t s = 0; s < len / SERIE_SEGMENTO; s++)
+        f->borrados[dir / SERIE_SEGMENTO + s]++;
+    return true;
+}
+
+static double ns_entre(const struct timespec *a, const struct timespec *b)
+{
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
+
+// lectura determinista del nodo en el instante t, para poder recalcular los resumenes
+static void generar(uint8_t nodo, uint32_t t, telemetria_lectura_t *l)
+{
+    double dia = 2 * PI * (t % 86400) / 86400.0;
+    double ruido = (double)((t * 7919u + nodo * 104729u) % 1000) / 1000.0 - 0.5;
+    memset(l, 0, sizeof(*l));
+    l->origen = nodo;
+    l->secuencia = (uint16_t)(t / BENCH_PERIODO_S);
+    l->temperatura = (float)(20.0 + 3.0 * sin(dia + nodo) + 0.2 * ruido);
+    l->ec = (float)(1500.0 + 50.0 * nodo + 20.0 * ruido);
+    // el nodo 3 pierde la sonda de pH las horas impares
+    l->ph = (nodo == 3 && (t / 3600) % 2) ? NAN : (float)(7.2 + 0.05 * ruido);
+    l->tds = (float)(300.0 + 10.0 * ruido);
+    // las lecturas llegan por la trama binaria; el NaN (sin sonda) se conserva
+    float ph = l->ph;
+    uint8_t trama[TELEMETRIA_LEN];
+    telemetria_codificar(l, trama);
+    telemetria_decodificar(trama, sizeof(trama), l);
+    if (ph != ph)
+        l->ph = ph;
+}
+
+typedef struct
+{
+    int puntos;
+    float min;
+    float max;
+    double suma;
+} recogida_t;
+
+static bool recoger(const serie_punto_t *punto, void *arg)
+{
+    recogida_t *r = (recogida_t *)arg;
+    r->puntos++;
+    r->suma += punto->media;
+    if (punto->min < r->min)
+        r->min = punto->min;
+    if (punto->max > r->max)
+        r->max = punto->max;
+    return true;
+}
+
+static void consulta(serie_t *serie, const char *nombre, serie_nivel_t nivel, uint8_t nodo, uint32_t desde,
+                     uint32_t hasta)
+{
+    recogida_t r = {0, FLT_MAX, -FLT_MAX, 0};
+    const int repeticiones = 20;
+    serie->segmentos_leidos = 0;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < repeticiones; i++)
+    {
+        r.puntos = 0;
+        serie_consultar(serie, nivel, nodo, TELEMETRIA_TEMPERATURA, desde, hasta, recoger, &r);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ns = ns_entre(&t0, &t1) / repeticiones;
+    printf("  %-34s %7d puntos %9.0f us %7.1f ns/punto %5u/%u segmentos\n", nombre, r.puntos, ns / 1000,
+           r.puntos ? ns / r.puntos : 0, serie->segmentos_leidos / repeticiones, serie->niveles[nivel].segmentos);
+}
+
+static bool montar(serie_t *serie, flash_t *f)
+{
+    serie_flash_t acceso = {flash_leer, flash_escribir, flash_borrar, f};
+    return serie_montar(serie, &acceso, BENCH_FLASH);
+}
+
+static int fallos = 0;
+
+static void comprobar(bool condicion, const char *que)
+{
+    printf("  %-60s %s\n", que, condicion ? "ok" : "FALLA");
+    if (!condicion)
+        fallos++;
+}
+
+// Resumen horario del nodo en [hora, hora + 3600) calculado directamente
+static void hora_esperada(uint8_t nodo, uint32_t hora, float *min, float *max, double *media)
+{
+    *min = FLT_MAX;
+    *max = -FLT_MAX;
+    double suma = 0;
+    int n = 0;
+    for (uint32_t t = hora; t < hora + SERIE_HORA_S; t += BENCH_PERIODO_S)
+    {
+        telemetria_lectura_t l;
+        generar(nodo, t, &l);
+        if (l.temperatura < *min)
+            *min = l.temperatura;
+        if (l.temperatura > *max)
+            *max = l.temperatura;
+        suma += l.temperatura;
+        n++;
+    }
+    *media = suma / n;
+}
+
+static bool comprobar_crudo(const serie_punto_t *punto, void *arg)
+{
+    int *distintas = (int *)arg;
+    telemetria_lectura_t l;
+    generar(punto->nodo, punto->t, &l);
+    if (punto->media != l.temperatura || punto->muestras != 1)
+        (*distintas)++;
+    return true;
+}
+
+static bool comprobar_hora(const serie_punto_t *punto, void *arg)
+{
+    int *errores = (int *)arg;
+    float min, max;
+    double media;
+    hora_esperada(punto->nodo, punto->t, &min, &max, &media);
+    if (punto->min != min || punto->max != max || fabs(punto->media - media) > 1e-3 ||
+        punto->muestras != SERIE_HORA_S / BENCH_PERIODO_S)
+        (*errores)++;
+    return true;
+}
+
+int main(void)
+{
+    static serie_t serie, reiniciada;
+    memset(flash.datos, 0x00, sizeof(flash.datos)); // flash sin formatear
+    if (!montar(&serie, &flash))
+    {
+        fprintf(stderr, "no se pudo montar\n");
+        return EXIT_FAILURE;
+    }
+
+    // --- insercion ---
+    const uint32_t fin = BENCH_INICIO + BENCH_DIAS * 86400u;
+    double ns_insertar = 0;
+    int en_bloques_abiertos = 0; // lecturas que se pierden con la copia
+    uint64_t escrituras_0 = flash.escrituras;
+    struct timespec t0, t1;
+    for (uint32_t t = BENCH_INICIO; t < fin; t += BENCH_PERIODO_S)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (uint8_t nodo = 1; nodo <= BENCH_NODOS; nodo++)
+        {
+            telemetria_lectura_t l;
+            generar(nodo, t, &l);
+            serie_insertar(&serie, &l, t);
+        }
+        if (t % 60 == 0)
+        {
+            serie_cerrar_periodos(&serie, t);
+            serie_sincronizar(&serie);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ns_insertar += ns_entre(&t0, &t1);
+        // a mitad de la prueba se copia la flash como si se cortara la luz
+        if (t == BENCH_INICIO + 15 * 86400u)
+        {
+            copia = flash;
+            for (int i = 0; i < serie.num_acumuladores; i++)
+                en_bloques_abiertos += serie.acumuladores[i].bloque.muestras;
+        }
+    }
+    serie_cerrar_periodos(&serie, fin);
+    serie_sincronizar(&serie);
+
+    uint32_t lecturas = serie.insertados;
+    double dias = BENCH_DIAS;
+    uint32_t max_borrados = 0;
+    uint64_t total_borrados = 0;
+    for (size_t s = 0; s < BENCH_FLASH / SERIE_SEGMENTO; s++)
+    {
+        total_borrados += flash.borrados[s];
+        if (flash.borrados[s] > max_borrados)
+            max_borrados = flash.borrados[s];
+    }
+    uint64_t bytes_crudos = (uint64_t)lecturas * BENCH_REGISTRO_FIJO;
+    uint64_t bytes_bloques = (uint64_t)serie.bloques * sizeof(serie_bloque_t);
+
+    printf("Insercion: %u lecturas de %d nodos cada %d s, %d dias\n", lecturas, BENCH_NODOS, BENCH_PERIODO_S,
+           BENCH_DIAS);
+    printf("  %.0f ns/lectura (%.2f M lecturas/s en el host), %.3f escrituras de flash por lectura\n",
+           ns_insertar / lecturas, lecturas / ns_insertar * 1e3, (double)(flash.escrituras - escrituras_0) / lecturas);
+    printf("Nivel crudo: %u bloques de %u bytes, %.1f lecturas por bloque, %.2f bytes/lectura (registro fijo %d: x%.1f)\n",
+           serie.bloques, (unsigned)sizeof(serie_bloque_t), (double)lecturas / serie.bloques,
+           (double)bytes_bloques / lecturas, BENCH_REGISTRO_FIJO, (double)bytes_crudos / bytes_bloques);
+    printf("Amplificacion de escritura:\n");
+    printf("  bloques crudos    %10.1f MB (%.1f MB sin comprimir)\n", bytes_bloques / 1e6, bytes_crudos / 1e6);
+    printf("  registros totales %10.1f MB (con los resumenes: x%.3f)\n", serie.bytes_datos / 1e6,
+           (double)serie.bytes_datos / bytes_bloques);
+    printf("  programados       %10.1f MB (x%.3f sobre los registros, cabeceras incluidas)\n",
+           serie.bytes_escritos / 1e6, (double)serie.bytes_escritos / serie.bytes_datos);
+    printf("  borrados          %10.1f MB (x%.3f)\n", serie.bytes_borrados / 1e6,
+           (double)serie.bytes_borrados / serie.bytes_datos);
+    printf("  paginas por dia %.0f, sectores borrados por dia %.0f: %.1f s de flash al dia\n", flash.paginas / dias,
+           total_borrados / dias, (flash.paginas * BENCH_T_PAGINA_MS + total_borrados * BENCH_T_SECTOR_MS) / dias / 1000);
+    printf("  desgaste: %.1f borrados/sector/dia en el mas usado, %.0f anios hasta %.0f ciclos\n",
+           max_borrados / dias, BENCH_CICLOS / (max_borrados / dias) / 365, BENCH_CICLOS);
+    printf("Historico retenido:\n");
+    const char *niveles[] = {"crudo", "minuto", "hora"};
+    for (int n = 0; n < SERIE_NUM_NIVELES; n++)
+    {
+        printf("  %-7s %4u segmentos %8.1f KB  %7.1f h\n", niveles[n], serie.niveles[n].segmentos,
+               serie.niveles[n].segmentos * SERIE_SEGMENTO / 1024.0, (fin - serie_inicio(&serie, n)) / 3600.0);
+    }
+
+    // --- consultas ---
+    printf("Consultas (temperatura):\n");
+    consulta(&serie, "crudo, nodo 1, ultima hora", SERIE_CRUDO, 1, fin - 3600, fin);
+    consulta(&serie, "crudo, todos, ultimos 10 min", SERIE_CRUDO, SERIE_CUALQUIER_NODO, fin - 600, fin);
+    consulta(&serie, "minuto, nodo 2, ultimo dia", SERIE_MINUTO, 2, fin - 86400, fin);
+    consulta(&serie, "hora, nodo 3, todo", SERIE_HORA, 3, 0, fin);
+
+    uint32_t desde = serie_inicio(&serie, SERIE_CRUDO);
+    float min_i = 0, max_i = 0;
+    recogida_t r = {0, FLT_MAX, -FLT_MAX, 0};
+    const int repeticiones = 20;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < repeticiones; i++)
+        serie_extremos(&serie, SERIE_CRUDO, TELEMETRIA_TEMPERATURA, desde, fin, &min_i, &max_i);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ns_indice = ns_entre(&t0, &t1) / repeticiones;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < repeticiones; i++)
+        serie_consultar(&serie, SERIE_CRUDO, SERIE_CUALQUIER_NODO, TELEMETRIA_TEMPERATURA, desde, fin, recoger, &r);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ns_barrido = ns_entre(&t0, &t1) / repeticiones;
+    printf("  extremos de todo el nivel crudo: indice %.0f us, recorriendo registros %.0f us (x%.0f)\n",
+           ns_indice / 1000, ns_barrido / 1000, ns_barrido / ns_indice);
+
+    // --- comprobaciones ---
+    printf("Comprobaciones:\n");
+    comprobar(flash.violaciones == 0 && copia.violaciones == 0, "ninguna escritura sobre flash sin borrar");
+    comprobar(min_i == r.min && max_i == r.max, "extremos por indice = extremos recorriendo los registros");
+    int distintas = 0;
+    int crudas = serie_consultar(&serie, SERIE_CRUDO, 1, TELEMETRIA_TEMPERATURA, fin - 86400, fin, comprobar_crudo,
+                                 &distintas);
+    comprobar(crudas == 86400 / BENCH_PERIODO_S && distintas == 0, "el nivel crudo devuelve las lecturas exactas");
+    int errores = 0;
+    int horas = serie_consultar(&serie, SERIE_HORA, 1, TELEMETRIA_TEMPERATURA, 0, fin, comprobar_hora, &errores);
+    comprobar(horas > 0 && errores == 0, "resumenes horarios = calculados desde las lecturas");
+    recogida_t ph = {0, FLT_MAX, -FLT_MAX, 0};
+    serie_consultar(&serie, SERIE_HORA, 3, TELEMETRIA_PH, fin - 86400, fin, recoger, &ph);
+    comprobar(ph.puntos == 24 && ph.suma != ph.suma, "horas sin sonda de pH quedan en NaN");
+
+    // reinicio: la copia se hizo justo despues de sincronizar, en el minuto de la copia
+    uint32_t t_copia = BENCH_INICIO + 15 * 86400u;
+    recogida_t despues = {0, FLT_MAX, -FLT_MAX, 0};
+    static flash_t original;
+    original = copia;
+    bool montada = montar(&reiniciada, &copia);
+    // los bloques se escriben al cerrarse, asi que el segmento mas viejo que queda puede empezar con lecturas
+    // de un nodo cuyos bloques anteriores ya se borraron: se cuenta desde un poco despues
+    uint32_t desde_copia = serie_inicio(&reiniciada, SERIE_CRUDO) + 2 * SERIE_BLOQUE_MAX_S;
+    serie_consultar(&reiniciada, SERIE_CRUDO, SERIE_CUALQUIER_NODO, TELEMETRIA_TEMPERATURA, desde_copia, t_copia,
+                    recoger, &despues);
+    comprobar(montada && despues.puntos > 0 && despues.max == despues.max, "la flash copiada se monta otra vez");
+    int esperados = -en_bloques_abiertos;
+    for (uint32_t t = desde_copia + (BENCH_PERIODO_S - desde_copia % BENCH_PERIODO_S) % BENCH_PERIODO_S;
+         t <= t_copia; t += BENCH_PERIODO_S)
+        esperados += BENCH_NODOS;
+    printf("  (%d lecturas en bloques abiertos al cortar la luz)\n", en_bloques_abiertos);
+    comprobar(despues.puntos == esperados, "tras el reinicio estan todas las lecturas de bloques escritos");
+    recogida_t antes = {0, FLT_MAX, -FLT_MAX, 0};
+    serie_consultar(&reiniciada, SERIE_CRUDO, 1, TELEMETRIA_TEMPERATURA, t_copia - 600, t_copia + 600, recoger,
+                    &antes);
+
+    // corte de luz a mitad de un registro: t escrito, el resto no
+    serie_anillo_t *crudo = &reiniciada.niveles[SERIE_CRUDO];
+    uint32_t dir = (crudo->primero + crudo->activo) * SERIE_SEGMENTO + sizeof(serie_cabecera_t) + crudo->en_flash;
+    uint32_t t_roto = t_copia + 1;
+    flash_escribir(&original, dir, &t_roto, sizeof(t_roto));
+    static serie_t cortada;
+    montar(&cortada, &original);
+    for (uint32_t t = t_copia + 2; t < t_copia + 600; t += BENCH_PERIODO_S)
+    {
+        telemetria_lectura_t l;
+        generar(1, t, &l);
+        serie_insertar(&cortada, &l, t);
+    }
+    serie_sincronizar(&cortada);
+    recogida_t tras_corte = {0, FLT_MAX, -FLT_MAX, 0};
+    cortada.corruptos = 0;
+    serie_consultar(&cortada, SERIE_CRUDO, 1, TELEMETRIA_TEMPERATURA, t_copia - 600, t_copia + 600, recoger,
+                    &tras_corte);
+    comprobar(original.violaciones == 0 && cortada.corruptos == 1 && antes.puntos > 0 &&
+                  tras_corte.puntos == antes.puntos + 299,
+              "un registro a medias se descarta y se sigue escribiendo detras");
+
+    return fallos == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
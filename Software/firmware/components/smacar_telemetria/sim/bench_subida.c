@@ -0,0 +1,337 @@
+/*
+  Benchmark de la subida a la nube del receptor: Blynk por HTTP contra MQTT con la cola de subida (subida.c)
+
+  Bytes en el aire por lectura, contando cabeceras TCP/IP (40 B por segmento, sin opciones ni enlace):
+   - blynk: lo que hace send_to_blynk, cuatro GET (uno por valor) y una conexion TCP nueva en cada uno
+     (SYN, SYN-ACK, ACK, peticion, respuesta, ACK y cierre de 4 segmentos). Cabeceras HTTP minimas
+     (User-Agent y Host; respuesta con Content-Length), asi que se queda corto
+   - mqtt-1: un PUBLISH QoS1 por lectura con la trama de telemetria, PUBACK y el ACK TCP del PUBACK, en una
+     conexion persistente
+   - mqtt-lote: los mensajes de subida.c, hasta SUBIDA_MAX_LOTE lecturas por mensaje
+  Lecturas por segundo que aguanta cada uno con un RTT al servidor: blynk espera cada GET (2 RTT: handshake y
+  peticion) antes de seguir; MQTT tiene una ventana de mensajes sin confirmar.
+
+  Despues simula en pasos de 1 ms la cola de subida contra un broker local de mentira, con el RTT, un enlace de
+  BENCH_ENLACE_BPS y escenarios de 16 nodos con una lectura cada 10 s: normal, un corte de 10 min, mensajes y
+  PUBACK perdidos, y una cola llena de golpe. El broker decodifica cada mensaje y comprueba que cada lectura
+  llega con sus valores (con la resolucion de la trama) y cuantas veces. Da los mensajes por segundo, los bytes
+  por lectura, la espera hasta el broker y lo perdido.
+
+  Uso: bench_subida [rtt_ms]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "telemetria.h"
+#include "subida.h"
+
+#define BENCH_TCPIP 40
+#define BENCH_NODOS 16
+#define BENCH_PERIODO_MS 10000u
+#define BENCH_DURACION_MS (3600u * 1000u)
+#define BENCH_ENLACE_BPS 1000000u
+#define BENCH_RTT_MS 100u
+#define BENCH_TOKEN "UDCOVVtPTGNn6brczRzDivWzspzKN5jG" // 32 caracteres, como BLYNK_AUTH_TOKEN
+#define BENCH_TEMA "smacar/smacar-receptor/nodo/12"
+#define BENCH_MAX_VUELO 64
+#define BENCH_MAX_SEC 4096
+#define BENCH_T0 1700000000u
+
+// ---------- bytes por lectura ----------
+
+// Longitud restante de MQTT: varint de 7 bits
+static int mqtt_varint(int n)
+{
+    return n < 128 ? 1 : n < 16384 ? 2 : 3;
+}
+
+// PUBLISH QoS1 (cabecera fija, tema, packet id, payload) + PUBACK + ACK TCP del PUBACK
+static int mqtt_bytes(int payload, int *segmentos)
+{
+    int variable = 2 + (int)strlen(BENCH_TEMA) + 2 + payload;
+    int publish = 1 + mqtt_varint(variable) + variable;
+    *segmentos = 3;
+    return publish + 4 + 3 * BENCH_TCPIP;
+}
+
+static int blynk_get_bytes(int *segmentos)
+{
+    char peticion[256], respuesta[128];
+    int n = snprintf(peticion, sizeof(peticion),
+                     "GET /external/api/update?token=%s&V0=1548.00 HTTP/1.1\r\n"
+                     "User-Agent: ESP32 HTTP Client/1.0\r\nHost: blynk.cloud\r\n\r\n",
+                     BENCH_TOKEN);
+    int m = snprintf(respuesta, sizeof(respuesta), "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n");
+    // SYN y SYN-ACK llevan 20 B de opciones (MSS, SACK, ventana)
+    *segmentos = 3 + 2 + 1 + 4;
+    return 2 * (BENCH_TCPIP + 20) + BENCH_TCPIP + (BENCH_TCPIP + n) + (BENCH_TCPIP + m) + BENCH_TCPIP +
+           4 * BENCH_TCPIP;
+}
+
+// ---------- simulacion ----------
+
+typedef struct
+{
+    int id;
+    uint32_t llega_ms;  // al broker
+    uint32_t vuelve_ms; // el PUBACK
+    int perdido_publish;
+    int perdido_ack;
+    size_t len;
+    uint8_t mensaje[SUBIDA_MENSAJE_MAX];
+} vuelo_t;
+
+typedef struct
+{
+    const char *nombre;
+    int ventana;
+    uint32_t corte_desde_ms, corte_hasta_ms; // sin conexion
+    int perdida_pct;                         // de PUBLISH y de PUBACK
+    int rafaga;                              // 1: todos los nodos mandan SUBIDA_PENDIENTES lecturas de golpe
+} escenario_t;
+
+typedef struct
+{
+    telemetria_lectura_t lectura;
+    uint32_t t;
+    uint32_t generada_ms;
+    uint16_t llegadas;
+} original_t;
+
+static subida_t subida;
+static vuelo_t vuelos[BENCH_MAX_VUELO];
+static int num_vuelos;
+static original_t originales[BENCH_NODOS + 1][BENCH_MAX_SEC];
+static uint16_t secuencias[BENCH_NODOS + 1];
+static uint32_t esperas[BENCH_NODOS * BENCH_MAX_SEC];
+static int num_esperas;
+static uint32_t semilla = 12345;
+static unsigned rtt_ms = BENCH_RTT_MS;
+
+static uint32_t aleatorio(uint32_t n)
+{
+    semilla = semilla * 1103515245u + 12345u;
+    return (semilla >> 8) % n;
+}
+
+static int comparar(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static float cuantizar(float v, float escala)
+{
+    return roundf(v * escala) / escala;
+}
+
+static void generar(uint8_t nodo, uint32_t ahora)
+{
+    uint16_t sec = secuencias[nodo]++;
+    original_t *o = &originales[nodo][sec % BENCH_MAX_SEC];
+    float fase = (float)sec / 90.0f + nodo;
+    o->lectura = (telemetria_lectura_t){.origen = nodo,
+                                        .secuencia = sec,
+                                        .temperatura = cuantizar(22.0f + 3.0f * sinf(fase), 100.0f),
+                                        .ec = cuantizar(1500.0f + 40.0f * cosf(fase), 1.0f),
+                                        .ph = cuantizar(6.8f + 0.2f * sinf(fase * 3), 100.0f),
+                                        .tds = cuantizar(750.0f + 20.0f * cosf(fase), 10.0f)};
+    o->t = BENCH_T0 + ahora / 1000;
+    o->generada_ms = ahora;
+    o->llegadas = 0;
+    subida_agregar(&subida, &o->lectura, o->t, ahora / 1000);
+}
+
+// El broker recibe un mensaje: comprueba cada lectura contra la original
+static int broker(const uint8_t *mensaje, size_t len, uint32_t ahora)
+{
+    telemetria_lectura_t lecturas[SUBIDA_MAX_LOTE];
+    uint32_t t[SUBIDA_MAX_LOTE];
+    int n = subida_decodificar(mensaje, len, lecturas, t, SUBIDA_MAX_LOTE);
+    int errores = n < 0;
+    for (int i = 0; i < n; i++)
+    {
+        original_t *o = &originales[lecturas[i].origen][lecturas[i].secuencia % BENCH_MAX_SEC];
+        if (o->lectura.secuencia != lecturas[i].secuencia || o->t != t[i] ||
+            o->lectura.temperatura != lecturas[i].temperatura || o->lectura.ec != lecturas[i].ec ||
+            o->lectura.ph != lecturas[i].ph || o->lectura.tds != lecturas[i].tds)
+        {
+            errores++;
+            continue;
+        }
+        if (o->llegadas++ == 0)
+            esperas[num_esperas++] = ahora - o->generada_ms;
+    }
+    return errores;
+}
+
+// Pasa a la red los mensajes que toquen, como bombear() de nube_mqtt.c
+static void bombear(const escenario_t *e, uint32_t ahora, int *siguiente_id, uint32_t *enlace_libre,
+                    uint64_t *bytes, uint32_t *mensajes)
+{
+    subida_revisar(&subida, ahora / 1000);
+    while (num_vuelos < e->ventana && num_vuelos < BENCH_MAX_VUELO)
+    {
+        vuelo_t *v = &vuelos[num_vuelos];
+        uint8_t nodo;
+        int hueco;
+        v->len = subida_siguiente(&subida, ahora / 1000, v->mensaje, &nodo, &hueco);
+        if (v->len == 0)
+            break;
+        int segmentos;
+        int en_aire = mqtt_bytes((int)v->len, &segmentos);
+        uint32_t salida = *enlace_libre > ahora ? *enlace_libre : ahora;
+        *enlace_libre = salida + (uint32_t)((uint64_t)en_aire * 8 * 1000 / BENCH_ENLACE_BPS);
+        v->id = (*siguiente_id)++;
+        v->llega_ms = *enlace_libre + rtt_ms / 2;
+        v->vuelve_ms = v->llega_ms + rtt_ms / 2;
+        v->perdido_publish = (int)aleatorio(100) < e->perdida_pct;
+        v->perdido_ack = (int)aleatorio(100) < e->perdida_pct;
+        subida_enviado(&subida, hueco, v->id, ahora / 1000);
+        num_vuelos++;
+        *bytes += en_aire;
+        (*mensajes)++;
+    }
+}
+
+static int simular(const escenario_t *e)
+{
+    uint32_t fase[BENCH_NODOS];
+    semilla = 12345;
+    subida_iniciar(&subida);
+    memset(secuencias, 0, sizeof(secuencias));
+    num_vuelos = num_esperas = 0;
+    for (int n = 0; n < BENCH_NODOS; n++)
+        fase[n] = aleatorio(BENCH_PERIODO_MS);
+
+    int siguiente_id = 1, errores = 0, conectado = 0;
+    uint32_t enlace_libre = 0, mensajes = 0, generadas = 0, fin_cola_ms = 0;
+    uint64_t bytes = 0;
+    uint32_t duracion = e->rafaga ? 600u * 1000u : BENCH_DURACION_MS;
+    for (uint32_t ahora = 0; ahora < duracion; ahora++)
+    {
+        int debe = !(ahora >= e->corte_desde_ms && ahora < e->corte_hasta_ms);
+        if (e->rafaga)
+            debe = ahora >= 1000;
+        if (debe != conectado)
+        {
+            conectado = debe;
+            subida_conectado(&subida, conectado, ahora / 1000);
+            if (!conectado)
+                num_vuelos = 0; // la conexion se lleva lo que estaba en vuelo
+        }
+        if (e->rafaga)
+        {
+            // la cola se lleno sin conexion: SUBIDA_PENDIENTES lecturas repartidas entre los nodos
+            if (ahora == 0)
+                for (int i = 0; i < SUBIDA_PENDIENTES; i++)
+                    generar((uint8_t)(1 + i % BENCH_NODOS), ahora), generadas++;
+        }
+        else
+        {
+            for (int n = 0; n < BENCH_NODOS; n++)
+            {
+                if (ahora % BENCH_PERIODO_MS == fase[n])
+                {
+                    generar((uint8_t)(n + 1), ahora);
+                    generadas++;
+                }
+            }
+        }
+        for (int i = 0; i < num_vuelos; i++)
+        {
+            vuelo_t *v = &vuelos[i];
+            if (v->llega_ms == ahora && !v->perdido_publish)
+                errores += broker(v->mensaje, v->len, ahora);
+            if (v->vuelve_ms <= ahora)
+            {
+                if (!v->perdido_publish && !v->perdido_ack)
+                    subida_confirmado(&subida, v->id);
+                vuelos[i--] = vuelos[--num_vuelos];
+            }
+        }
+        if (conectado)
+            bombear(e, ahora, &siguiente_id, &enlace_libre, &bytes, &mensajes);
+        if (e->rafaga && fin_cola_ms == 0 && subida_pendientes(&subida) == 0)
+            fin_cola_ms = ahora;
+    }
+
+    // las que siguen en la cola al terminar no cuentan como perdidas
+    uint32_t unicas = 0, repetidas = 0, perdidas = 0, en_cola = (uint32_t)subida_pendientes(&subida);
+    for (int n = 1; n <= BENCH_NODOS; n++)
+    {
+        for (int s = 0; s < secuencias[n] && s < BENCH_MAX_SEC; s++)
+        {
+            uint16_t llegadas = originales[n][s].llegadas;
+            unicas += llegadas > 0;
+            repetidas += llegadas > 1 ? llegadas - 1 : 0;
+        }
+    }
+    perdidas = generadas - unicas - en_cola;
+    qsort(esperas, num_esperas, sizeof(esperas[0]), comparar);
+    uint32_t p50 = num_esperas ? esperas[num_esperas / 2] : 0;
+    uint32_t p99 = num_esperas ? esperas[(num_esperas * 99) / 100] : 0;
+    double segundos = (e->rafaga ? (fin_cola_ms - 1000) : duracion) / 1000.0;
+    printf("%-22s %2d %6lu %6lu %7.2f %7.1f %7.1f %6.1f %6.1f %6lu %6lu %6lu %5lu\n", e->nombre, e->ventana,
+           (unsigned long)generadas, (unsigned long)mensajes, mensajes / segundos, unicas / segundos,
+           unicas ? (double)bytes / unicas : 0.0, p50 / 1000.0, p99 / 1000.0, (unsigned long)repetidas,
+           (unsigned long)subida.descartadas, (unsigned long)perdidas, (unsigned long)subida.reenvios);
+    if (e->rafaga)
+        printf("%-22s    cola de %d lecturas vaciada en %.2f s\n", "", SUBIDA_PENDIENTES, segundos);
+    // sin mas perdidas que las que descarta la cola llena, y todo lo que llega, bien
+    return errores + (perdidas != subida.descartadas);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+        rtt_ms = (unsigned)atoi(argv[1]);
+
+    int seg_get, seg_mqtt;
+    int get = blynk_get_bytes(&seg_get);
+    int blynk = 4 * get;
+    int mqtt1 = mqtt_bytes(TELEMETRIA_LEN, &seg_mqtt);
+    printf("Subida a la nube, RTT %u ms\n\n", rtt_ms);
+    printf("%-10s %10s %10s %14s\n", "", "B/lectura", "segmentos", "lecturas/s max");
+    printf("%-10s %10d %10d %14.2f\n", "blynk", blynk, 4 * seg_get, 1000.0 / (4 * 2 * rtt_ms));
+    printf("%-10s %10d %10d %14.2f\n", "mqtt-1", mqtt1, seg_mqtt, SUBIDA_VENTANA * 1000.0 / rtt_ms);
+
+    // un lote tipico: SUBIDA_MAX_LOTE lecturas seguidas de un nodo
+    subida_iniciar(&subida);
+    subida_conectado(&subida, 1, 0);
+    memset(secuencias, 0, sizeof(secuencias));
+    for (int i = 0; i < SUBIDA_MAX_LOTE; i++)
+        generar(1, i * BENCH_PERIODO_MS);
+    uint8_t mensaje[SUBIDA_MENSAJE_MAX], nodo;
+    int hueco;
+    size_t len = subida_siguiente(&subida, 1000, mensaje, &nodo, &hueco);
+    int lote = mqtt_bytes((int)len, &seg_mqtt);
+    printf("%-10s %10.1f %10.2f %14.2f   (%zu B de mensaje para %d lecturas)\n\n", "mqtt-lote",
+           (double)lote / SUBIDA_MAX_LOTE, (double)seg_mqtt / SUBIDA_MAX_LOTE,
+           SUBIDA_VENTANA * SUBIDA_MAX_LOTE * 1000.0 / rtt_ms, len, SUBIDA_MAX_LOTE);
+    printf("16 nodos a 1 lectura/10 s = 1.6 lecturas/s: blynk necesita %.0f%% del tiempo de la tarea que recibe\n\n",
+           100.0 * 1.6 * 4 * 2 * rtt_ms / 1000.0);
+
+    const escenario_t escenarios[] = {
+        {"normal", SUBIDA_VENTANA, 0, 0, 0, 0},
+        {"normal, ventana 1", 1, 0, 0, 0, 0},
+        {"corte de 10 min", SUBIDA_VENTANA, 1200u * 1000u, 1800u * 1000u, 0, 0},
+        {"2% perdidos", SUBIDA_VENTANA, 0, 0, 2, 0},
+        {"cola llena", SUBIDA_VENTANA, 0, 0, 0, 1},
+        {"cola llena, ventana 1", 1, 0, 0, 0, 1},
+    };
+    printf("%-22s %2s %6s %6s %7s %7s %7s %6s %6s %6s %6s %6s %5s\n", "escenario", "v", "lect", "msgs", "msgs/s",
+           "lect/s", "B/lect", "p50 s", "p99 s", "repet", "descar", "perd", "reenv");
+    int fallos = 0;
+    for (size_t i = 0; i < sizeof(escenarios) / sizeof(escenarios[0]); i++)
+        fallos += simular(&escenarios[i]);
+    if (fallos > 0)
+    {
+        printf("\nFALLO: %d lecturas mal o perdidas\n", fallos);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,525 @@
+/*
+  Benchmark de energia del transmisor: siempre despierto contra sueno profundo (MODO_SUENO del transmisor)
+
+  Simula una semana del transmisor en MODO_RADIO, clase A, sin downlinks, en tres modos:
+   - despierto: el bucle de app_main. CPU y SX127x (standby) encendidos siempre; cada lectura espera los 750 ms
+     de conversion del DS18B20 y luego lee el ADC
+   - timer: sueno profundo con despertar por timer en cada lectura, sin ULP: cada lectura paga un arranque
+   - ulp: MODO_SUENO. El ULP toma las muestras con el anillo de muestreo.c y despierta a los procesadores
+     principales con un lote completo o una muestra fuera de umbral; la temperatura se convierte antes de dormir
+  Las tramas salen como en enviar_telemetria: una implicita por lectura con lote 1, lotes comprimidos
+  (telemetria_codificar_lote) con lote > 1, el anuncio de formato cada 100 lecturas, y una ventana clase A sin
+  downlink tras la ultima. Tiempo en el aire con la formula de Semtech para SF12, BW 125 kHz, CR 4/5.
+
+  La EC de la traza sale de su umbral (2000 uS/cm) 5 min cada 1-3 h. Da la corriente media sin contar los
+  sensores analogicos (en esta placa estan siempre alimentados y no dependen del modo), despertares por hora y la
+  latencia de una alerta: desde que la EC sale del umbral, y desde que despiertan los procesadores, hasta que
+  termina la trama que la lleva, y las muestras que el ULP descarto con el anillo lleno. Despues, el presupuesto de energia de un despertar de lote en modo ulp.
+
+  Corrientes y tiempos: valores tipicos de las hojas de datos del ESP32-S3, SX1276 y DS18B20, no medidos en esta
+  placa. El arranque supone CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP (sdkconfig.defaults del transmisor).
+
+  Falla (sale con error) si en algun modo y configuracion:
+   - una alerta de EC no llega a salir, o sale mas de un periodo mas BENCH_ALERTA_EXTRA_MS despues de empezar
+     (las tramas y ventanas de SF12 que haya por delante)
+   - el ULP descarta muestras con el anillo lleno
+   - con periodo de BENCH_PERIODO_SUENO_S o mas, ulp consume mas que timer o mas de BENCH_SUENO_MAX veces lo
+     que consume despierto. Con periodos mas cortos el aire de SF12 llena el tiempo y dormir no compensa
+
+  Uso: bench_sueno [dias]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "telemetria.h"
+#include "comandos.h"
+#include "muestreo.h"
+
+#define BENCH_DIAS 7
+#define BENCH_PI 3.14159265358979
+#define BENCH_VOLTAJE 3.3
+#define BENCH_SF 12
+#define BENCH_PREAMBULO 8
+#define BENCH_SIMBOLO_MS (4096.0 / 125.0) // 2^SF / BW
+#define BENCH_UMBRAL_EC 2000.0f
+#define BENCH_EXCURSION_MS (5.0 * 60000.0)
+#define BENCH_MAX_EXCURSIONES 2048
+#define BENCH_FORMATO_CADA 100 // FORMATO_CADA_LECTURAS
+
+// umbrales
+#define BENCH_ALERTA_EXTRA_MS 10000.0
+#define BENCH_PERIODO_SUENO_S 10
+#define BENCH_SUENO_MAX 0.5
+
+// ESP32-S3
+#define CPU_MA 30.0      // despierto sin light sleep, esperando en FreeRTOS
+#define ARRANQUE_MS 80.0 // ROM, bootloader sin validar la imagen y arranque de la app hasta app_main
+#define ARRANQUE_MA 35.0
+#define INIT_MS 20.0 // calibracion del ADC, reset (15 ms) y configuracion del SX127x
+#define ADC_MS 1.0
+#define DORMIR_MS 2.0   // umbrales por biseccion, conversion del DS18B20, SX127x a sleep
+#define SUENO_MA 0.010  // sueno profundo con memoria RTC y timer del ULP; SX127x en sleep (0.2 uA)
+#define ULP_MS 0.5      // una muestra: arranque del ULP y 3 lecturas del ADC
+#define ULP_MA 1.5
+// SX1276
+#define TX_MA 120.0 // +20 dBm, TX_CORRIENTE_MA del transmisor
+#define RX_MA 11.5
+#define STANDBY_MA 1.6
+// DS18B20
+#define TEMP_CONVERSION_MS 750.0
+#define TEMP_LEER_MS 6.0 // reset y scratchpad por OneWire
+#define DS18B20_MA 1.0
+
+typedef enum
+{
+    MODO_DESPIERTO = 0,
+    MODO_TIMER,
+    MODO_ULP,
+    NUM_MODOS
+} modo_t;
+
+typedef enum
+{
+    FASE_ARRANQUE = 0,
+    FASE_INIT,
+    FASE_SENSORES,
+    FASE_TX,
+    FASE_VENTANA,
+    FASE_DORMIR,
+    FASE_ULP,
+    FASE_ESPERA,
+    NUM_FASES
+} fase_t;
+
+static const char *const modos[NUM_MODOS] = {"despierto", "timer", "ulp"};
+static const char *const fases[NUM_FASES] = {"arranque", "init", "sensores", "tx", "ventana", "dormir", "ulp",
+                                             "espera"};
+
+typedef struct
+{
+    double carga[NUM_FASES];  // mA * ms
+    double tiempo[NUM_FASES]; // ms
+    uint32_t despertares;
+    uint32_t tramas;
+    uint32_t perdidas; // muestras que el ULP descarto con el anillo lleno
+    double latencias[BENCH_MAX_EXCURSIONES];    // desde que la EC sale del umbral
+    double desde_despertar[BENCH_MAX_EXCURSIONES];
+    int num_latencias;
+} resultado_t;
+
+static double excursiones[BENCH_MAX_EXCURSIONES];
+static int num_excursiones;
+static double duracion_ms;
+
+// estado del transmisor simulado
+static resultado_t *r;
+static modo_t modo;
+static double ahora;
+static double despertar_ms;
+static comandos_config_t config;
+static telemetria_lectura_t lote[COMANDOS_MAX_LOTE];
+static uint32_t lote_t[COMANDOS_MAX_LOTE];
+static int lote_marca[COMANDOS_MAX_LOTE]; // excursion que empieza con esa lectura, -1 si ninguna
+static int lote_num;
+static uint16_t secuencia;
+static int siguiente_excursion;
+
+static uint32_t hash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+static bool en_excursion(double t)
+{
+    for (int e = 0; e < num_excursiones; e++)
+    {
+        if (t >= excursiones[e] && t < excursiones[e] + BENCH_EXCURSION_MS)
+            return true;
+        if (excursiones[e] > t)
+            break;
+    }
+    return false;
+}
+
+static float valor_ec(double t)
+{
+    float ruido = (float)(hash((uint32_t)(t / 100.0)) % 41) - 20.0f;
+    return 1500.0f + ruido + (en_excursion(t) ? 1000.0f : 0.0f);
+}
+
+static telemetria_lectura_t lectura_en(double t)
+{
+    uint32_t h = hash((uint32_t)(t / 100.0) ^ 0x9e3779b9u);
+    telemetria_lectura_t l = {0};
+    l.origen = 1;
+    l.temperatura = 24.0f + 2.0f * sinf((float)(t / 86400000.0 * 2.0 * BENCH_PI)) + (float)(h % 5) * 0.01f;
+    l.ec = valor_ec(t);
+    l.ph = 7.0f + (float)((h >> 8) % 11) * 0.01f - 0.05f;
+    l.tds = 750.0f + (float)((h >> 16) % 21) - 10.0f;
+    return l;
+}
+
+// Tiempo en el aire (Semtech AN1200.13), SF12 con optimizacion de tasa baja
+static double toa_ms(int bytes, bool implicita)
+{
+    double num = 8.0 * bytes - 4.0 * BENCH_SF + 28 + 16 - (implicita ? 20 : 0);
+    double simbolos = ceil(num / (4.0 * (BENCH_SF - 2))) * 5;
+    if (simbolos < 0)
+        simbolos = 0;
+    return (BENCH_PREAMBULO + 4.25 + 8 + simbolos) * BENCH_SIMBOLO_MS;
+}
+
+// Pasa ms en una fase con corriente ma
+static void gastar(fase_t fase, double ms, double ma)
+{
+    r->carga[fase] += ms * ma;
+    r->tiempo[fase] += ms;
+    ahora += ms;
+}
+
+// Lo que consume en paralelo con otra fase (el DS18B20 convirtiendo mientras se duerme)
+static void cargar(fase_t fase, double ms, double ma)
+{
+    r->carga[fase] += ms * ma;
+}
+
+static double cpu_ma(void)
+{
+    return modo == MODO_DESPIERTO ? CPU_MA + STANDBY_MA : CPU_MA;
+}
+
+static void transmitir(int bytes, bool implicita)
+{
+    gastar(FASE_TX, toa_ms(bytes, implicita), CPU_MA + TX_MA);
+    r->tramas++;
+}
+
+// Ventana clase A sin downlink: standby hasta el margen y RX hasta que no aparece preambulo
+static void ventana(void)
+{
+    gastar(FASE_VENTANA, COMANDOS_RX_RETARDO_MS - COMANDOS_RX_MARGEN_MS, CPU_MA + STANDBY_MA);
+    gastar(FASE_VENTANA, 2 * COMANDOS_RX_MARGEN_MS + 8 * BENCH_SIMBOLO_MS, CPU_MA + RX_MA);
+}
+
+static void enviar_lote(void)
+{
+    int i = 0;
+    if (lote_num == 1)
+    {
+        transmitir(TELEMETRIA_LEN, true);
+    }
+    while (lote_num > 1 && i < lote_num)
+    {
+        uint8_t trama[TELEMETRIA_LOTE_MAX_LEN];
+        size_t len = 0;
+        size_t n = telemetria_codificar_lote(&lote[i], &lote_t[i], (size_t)(lote_num - i), true, trama,
+                                             sizeof(trama), &len);
+        if (n == 0)
+            break;
+        transmitir((int)len, false);
+        i += (int)n;
+    }
+    for (int j = 0; j < lote_num; j++)
+    {
+        if (lote_marca[j] >= 0 && r->num_latencias < BENCH_MAX_EXCURSIONES)
+        {
+            r->latencias[r->num_latencias] = ahora - excursiones[lote_marca[j]];
+            r->desde_despertar[r->num_latencias] = modo == MODO_DESPIERTO ? 0 : ahora - despertar_ms;
+            r->num_latencias++;
+        }
+    }
+    lote_num = 0;
+    ventana();
+}
+
+// agregar_lectura del transmisor con la lectura tomada en t. Devuelve true si hay que enviar el lote
+static bool agregar_lectura(double t)
+{
+    if (secuencia % BENCH_FORMATO_CADA == 0)
+    {
+        transmitir(TELEMETRIA_CTRL_FORMATO_LEN, false);
+        ventana();
+    }
+    secuencia++;
+    telemetria_lectura_t l = lectura_en(t);
+    lote[lote_num] = l;
+    lote_t[lote_num] = (uint32_t)(t / 1000.0);
+    lote_marca[lote_num] = -1;
+    if (siguiente_excursion < num_excursiones && t >= excursiones[siguiente_excursion])
+    {
+        if (t < excursiones[siguiente_excursion] + BENCH_EXCURSION_MS)
+            lote_marca[lote_num] = siguiente_excursion;
+        siguiente_excursion++;
+    }
+    lote_num++;
+    bool alarma = comandos_fuera_de_umbral(&config, &l);
+    return lote_num >= config.lote || alarma;
+}
+
+static void simular_despierto(void)
+{
+    double periodo = config.periodo_s * 1000.0;
+    while (ahora < duracion_ms)
+    {
+        double inicio = ahora;
+        gastar(FASE_SENSORES, TEMP_CONVERSION_MS, cpu_ma() + DS18B20_MA);
+        gastar(FASE_SENSORES, ADC_MS, cpu_ma());
+        if (agregar_lectura(ahora))
+            enviar_lote();
+        if (ahora < inicio + periodo)
+            gastar(FASE_ESPERA, inicio + periodo - ahora, cpu_ma());
+    }
+}
+
+// Arranque tras el sueno y lectura de la temperatura convertida antes de dormir
+static void despertar(void)
+{
+    despertar_ms = ahora;
+    r->despertares++;
+    gastar(FASE_ARRANQUE, ARRANQUE_MS, ARRANQUE_MA);
+    gastar(FASE_INIT, INIT_MS, CPU_MA);
+    gastar(FASE_SENSORES, TEMP_LEER_MS, CPU_MA);
+}
+
+static void dormir(void)
+{
+    gastar(FASE_DORMIR, DORMIR_MS, CPU_MA);
+    cargar(FASE_SENSORES, TEMP_CONVERSION_MS, DS18B20_MA);
+}
+
+static void simular_timer(void)
+{
+    double periodo = config.periodo_s * 1000.0;
+    while (ahora < duracion_ms)
+    {
+        double inicio = ahora;
+        despertar();
+        gastar(FASE_SENSORES, ADC_MS, CPU_MA);
+        if (agregar_lectura(ahora))
+            enviar_lote();
+        dormir();
+        if (ahora < inicio + periodo)
+            gastar(FASE_ESPERA, inicio + periodo - ahora, SUENO_MA);
+    }
+}
+
+static muestreo_t muestreo;
+static double tomadas[MUESTREO_MAX]; // instante de cada muestra del anillo
+static double siguiente_muestra;
+static bool despertar_pendiente;
+
+// Muestras que toma el ULP hasta ahora, duerman o no los procesadores principales
+static void muestrear_hasta(double t)
+{
+    while (siguiente_muestra <= t)
+    {
+        uint16_t crudo[MUESTREO_CANALES] = {(uint16_t)valor_ec(siguiente_muestra), 2048, 2048};
+        cargar(FASE_ULP, ULP_MS, ULP_MA);
+        tomadas[muestreo.escritas % MUESTREO_MAX] = siguiente_muestra;
+        if (muestreo_agregar(&muestreo, crudo))
+            despertar_pendiente = true;
+        siguiente_muestra += config.periodo_s * 1000.0;
+    }
+}
+
+static void simular_ulp(void)
+{
+    double periodo = config.periodo_s * 1000.0;
+    uint16_t min[MUESTREO_CANALES] = {0, 0, 0};
+    uint16_t max[MUESTREO_CANALES] = {(uint16_t)BENCH_UMBRAL_EC, MUESTREO_CRUDO_MAX, MUESTREO_CRUDO_MAX};
+    muestreo_iniciar(&muestreo);
+    muestreo_configurar(&muestreo, config.lote, min, max);
+    siguiente_muestra = periodo;
+    despertar_pendiente = false;
+    while (ahora < duracion_ms)
+    {
+        // dormido hasta que el ULP despierte a los principales
+        double inicio = ahora;
+        while (!despertar_pendiente && siguiente_muestra < duracion_ms)
+        {
+            double t = siguiente_muestra;
+            muestrear_hasta(t);
+            ahora = t + ULP_MS;
+        }
+        r->carga[FASE_ESPERA] += (ahora - inicio) * SUENO_MA;
+        r->tiempo[FASE_ESPERA] += ahora - inicio;
+        if (!despertar_pendiente)
+            break;
+
+        despertar_pendiente = false;
+        despertar();
+        muestrear_hasta(ahora);
+        int num = muestreo_pendientes(&muestreo);
+        bool enviar = false;
+        for (int i = 0; i < num; i++)
+        {
+            uint16_t crudo[MUESTREO_CANALES];
+            double t = tomadas[muestreo.leidas % MUESTREO_MAX];
+            muestreo_leer(&muestreo, crudo);
+            enviar |= agregar_lectura(t);
+            if (lote_num == COMANDOS_MAX_LOTE)
+            {
+                enviar_lote();
+                muestrear_hasta(ahora);
+                enviar = false;
+            }
+        }
+        if (enviar)
+        {
+            enviar_lote();
+            muestrear_hasta(ahora);
+        }
+        dormir();
+        int faltan = config.lote - lote_num;
+        muestreo_configurar(&muestreo, faltan > 0 ? (uint32_t)faltan : 1, min, max);
+        muestrear_hasta(ahora);
+    }
+    r->perdidas = muestreo.perdidas;
+}
+
+static int comparar(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentil(double *v, int n, int p)
+{
+    if (n == 0)
+        return 0;
+    qsort(v, (size_t)n, sizeof(v[0]), comparar);
+    return v[(n - 1) * p / 100];
+}
+
+static void simular(resultado_t *resultado, modo_t m, uint16_t periodo_s, uint8_t lote_max)
+{
+    memset(resultado, 0, sizeof(*resultado));
+    r = resultado;
+    modo = m;
+    ahora = 0;
+    lote_num = 0;
+    secuencia = 0;
+    siguiente_excursion = 0;
+    comandos_config_defecto(&config, periodo_s);
+    config.lote = lote_max;
+    config.umbral_max[TELEMETRIA_EC] = BENCH_UMBRAL_EC;
+    if (m == MODO_DESPIERTO)
+        simular_despierto();
+    else if (m == MODO_TIMER)
+        simular_timer();
+    else
+        simular_ulp();
+}
+
+static double total(const double *v)
+{
+    double suma = 0;
+    for (int f = 0; f < NUM_FASES; f++)
+        suma += v[f];
+    return suma;
+}
+
+int main(int argc, char **argv)
+{
+    int dias = argc > 1 ? atoi(argv[1]) : BENCH_DIAS;
+    if (dias <= 0)
+        dias = 1;
+    duracion_ms = dias * 86400000.0;
+    uint32_t semilla = 12345;
+    for (double t = 3600000.0; t < duracion_ms && num_excursiones < BENCH_MAX_EXCURSIONES;)
+    {
+        excursiones[num_excursiones++] = t;
+        semilla = hash(semilla);
+        t += 3600000.0 + (double)(semilla % 7200000u);
+    }
+
+    static const uint16_t periodos[] = {2, 10, 60};
+    static const uint8_t lotes[] = {1, 4, 16};
+    static resultado_t resultado;
+    int fallos = 0;
+    printf("Transmisor, %d dias, %d alertas de EC; corrientes estimadas (ver cabecera), sin los sensores analogicos\n\n",
+           dias, num_excursiones);
+    printf("%-10s %8s %5s %9s %10s %9s %22s %14s %8s\n", "modo", "periodo", "lote", "mA medio", "desp/h", "tramas/h",
+           "alerta p50/max (ms)", "despertar->tx", "perdidas");
+    for (size_t p = 0; p < sizeof(periodos) / sizeof(periodos[0]); p++)
+    {
+        for (size_t l = 0; l < sizeof(lotes) / sizeof(lotes[0]); l++)
+        {
+            double media_ma_modo[NUM_MODOS];
+            for (int m = 0; m < NUM_MODOS; m++)
+            {
+                simular(&resultado, (modo_t)m, periodos[p], lotes[l]);
+                double horas = duracion_ms / 3600000.0;
+                double media_ma = total(resultado.carga) / duracion_ms;
+                double p50 = percentil(resultado.latencias, resultado.num_latencias, 50);
+                double max = percentil(resultado.latencias, resultado.num_latencias, 100);
+                double desde = percentil(resultado.desde_despertar, resultado.num_latencias, 50);
+                printf("%-10s %6u s %5u %9.3f %10.1f %9.1f %10.0f/%-11.0f %14.0f %8lu\n", modos[m], periodos[p],
+                       lotes[l], media_ma, resultado.despertares / horas, resultado.tramas / horas, p50, max,
+                       m == MODO_DESPIERTO ? 0.0 : desde, (unsigned long)resultado.perdidas);
+                media_ma_modo[m] = media_ma;
+                if (resultado.num_latencias < num_excursiones)
+                {
+                    printf("FALLO %s, %u s, lote %u: %d de %d alertas enviadas\n", modos[m], periodos[p], lotes[l],
+                           resultado.num_latencias, num_excursiones);
+                    fallos++;
+                }
+                if (max > periodos[p] * 1000.0 + BENCH_ALERTA_EXTRA_MS)
+                {
+                    printf("FALLO %s, %u s, lote %u: alerta en %.0f ms (max %.0f)\n", modos[m], periodos[p], lotes[l],
+                           max, periodos[p] * 1000.0 + BENCH_ALERTA_EXTRA_MS);
+                    fallos++;
+                }
+                if (resultado.perdidas > 0)
+                {
+                    printf("FALLO %s, %u s, lote %u: %lu muestras perdidas\n", modos[m], periodos[p], lotes[l],
+                           (unsigned long)resultado.perdidas);
+                    fallos++;
+                }
+            }
+            if (periodos[p] >= BENCH_PERIODO_SUENO_S &&
+                (media_ma_modo[MODO_ULP] > media_ma_modo[MODO_TIMER] ||
+                 media_ma_modo[MODO_ULP] > BENCH_SUENO_MAX * media_ma_modo[MODO_DESPIERTO]))
+            {
+                printf("FALLO ulp, %u s, lote %u: %.3f mA, timer %.3f mA, despierto %.3f mA (max %.0f %%)\n", periodos[p],
+                       lotes[l], media_ma_modo[MODO_ULP], media_ma_modo[MODO_TIMER], media_ma_modo[MODO_DESPIERTO],
+                       100.0 * BENCH_SUENO_MAX);
+                fallos++;
+            }
+        }
+    }
+
+    // presupuesto de un despertar de lote en modo ulp, con el periodo y el lote de fabrica del transmisor y el
+    // lote maximo
+    for (size_t l = 0; l < 2; l++)
+    {
+        uint8_t lote_max = l == 0 ? 1 : COMANDOS_MAX_LOTE;
+        simular(&resultado, MODO_ULP, 2, lote_max);
+        double n = resultado.despertares > 0 ? resultado.despertares : 1;
+        printf("\nulp, periodo 2 s, lote %u: energia media por despertar (%u despertares)\n", lote_max,
+               resultado.despertares);
+        printf("%-10s %10s %10s\n", "fase", "ms", "mJ");
+        for (int f = 0; f < NUM_FASES; f++)
+        {
+            if (f == FASE_ESPERA)
+                continue;
+            printf("%-10s %10.1f %10.3f\n", fases[f], resultado.tiempo[f] / n, resultado.carga[f] * BENCH_VOLTAJE / 1000.0 / n);
+        }
+        double despierto = total(resultado.carga) - resultado.carga[FASE_ESPERA];
+        printf("%-10s %10.1f %10.3f   + sueno %.3f mJ\n", "total", (total(resultado.tiempo) - resultado.tiempo[FASE_ESPERA]) / n,
+               despierto * BENCH_VOLTAJE / 1000.0 / n, resultado.carga[FASE_ESPERA] * BENCH_VOLTAJE / 1000.0 / n);
+    }
+
+    printf("\n%s: alertas en un periodo + %.0f ms, sin muestras perdidas, ulp <= timer y <= %.0f %% de despierto desde "
+           "%u s\n",
+           fallos == 0 ? "OK" : "FALLO", BENCH_ALERTA_EXTRA_MS, 100.0 * BENCH_SUENO_MAX, BENCH_PERIODO_SUENO_S);
+    return fallos == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
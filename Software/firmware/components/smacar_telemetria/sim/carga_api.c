@@ -0,0 +1,392 @@
+/*
+  Prueba de carga del WebSocket de la API local del receptor (difusion.c, Receptor_Smacar/main/api.c)
+
+  Simula en pasos de 1 ms media hora de la tarea de esp_http_server repartiendo lecturas a N clientes:
+   - 16 nodos; 12 mandan una lectura cada 10 s y 4 un lote de 16 lecturas cada 160 s, que llegan juntas
+   - cada envio cuesta CARGA_COSTE_US de la tarea del servidor, que es una sola y hace los envios en serie
+   - los envios pasan por la cola de trabajo del servidor (httpd_queue_work, CARGA_TRABAJO_MAX huecos)
+   - cada cliente tiene un buffer de envio TCP de CARGA_SOCKET_BUF bytes que se vacia a la velocidad de su
+     enlace; escribir en un buffer lleno bloquea la tarea hasta que hay sitio o pasa send_wait_timeout, y
+     entonces se cierra el cliente
+  Clientes: rapido (la app en la misma wifi), lento (enlace mas lento que el ritmo de lecturas) y parado (la app
+  en segundo plano, no lee nada).
+
+  Dos formas de repartir:
+   - cola: la de api.c. Cola por cliente con descarte del mas viejo, un envio en vuelo por cliente, solo se
+     envia si el socket tiene sitio y se cierra al cliente sin progreso en DIFUSION_ATASCO_MS
+   - directo: un httpd_ws_send_data_async por lectura y cliente, sin mirar el socket
+  Para los clientes rapidos se da la latencia publicacion -> llegada al cliente (p50, p99, max) y las lecturas
+  perdidas; para el resto, las descartadas y si se cerraron. Mide tambien el coste de difusion_publicar en el
+  host.
+
+  Uso: carga_api
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "telemetria.h"
+#include "difusion.h"
+
+#define CARGA_DURACION_MS (1800u * 1000u)
+#define CARGA_NODOS 16
+#define CARGA_NODOS_LOTE 4
+#define CARGA_PERIODO_MS 10000u
+#define CARGA_LOTE 16 // COMANDOS_MAX_LOTE
+#define CARGA_TRAMA_WS (2 + DIFUSION_MENSAJE_LEN) // cabecera WebSocket corta + mensaje
+#define CARGA_SOCKET_BUF 5744  // CONFIG_LWIP_TCP_SND_BUF_DEFAULT
+#define CARGA_COSTE_US 300     // escribir una trama en el socket y el callback
+#define CARGA_TRABAJO_MAX 6    // CONFIG_LWIP_UDP_RECVMBOX_SIZE: httpd_queue_work va por un socket UDP de control
+#define CARGA_TIMEOUT_MS 2000  // API_ENVIO_TIMEOUT_S
+#define CARGA_MAX_CLIENTES 6   // API_MAX_SOCKETS menos uno para las peticiones REST
+#define CARGA_MAX_LATENCIAS (CARGA_MAX_CLIENTES * 8000)
+#define CARGA_REPETICIONES 200000
+
+typedef enum
+{
+    RAPIDO,
+    LENTO,
+    PARADO
+} tipo_t;
+
+static const double bytes_ms[] = {100.0, 0.01, 0.0}; // 100 kB/s, 10 B/s (menos que las lecturas), nada
+
+typedef struct
+{
+    int fd;
+    tipo_t tipo;
+    double ocupado; // bytes en el buffer de envio
+    int conectado;
+    uint32_t recibidos;
+    uint32_t perdidos;
+} cliente_t;
+
+typedef struct
+{
+    int fd;
+    uint32_t publicado_ms;
+} trabajo_t;
+
+typedef struct
+{
+    const char *nombre;
+    int num;
+    tipo_t tipos[CARGA_MAX_CLIENTES];
+} escenario_t;
+
+static const escenario_t escenarios[] = {
+    {"1 rapido", 1, {RAPIDO}},
+    {"2 rapidos", 2, {RAPIDO, RAPIDO}},
+    {"4 rapidos", 4, {RAPIDO, RAPIDO, RAPIDO, RAPIDO}},
+    {"6 rapidos", 6, {RAPIDO, RAPIDO, RAPIDO, RAPIDO, RAPIDO, RAPIDO}},
+    {"4 rapidos + lento", 5, {RAPIDO, RAPIDO, RAPIDO, RAPIDO, LENTO}},
+    {"4 rapidos + parado", 5, {RAPIDO, RAPIDO, RAPIDO, RAPIDO, PARADO}},
+    {"4 rapidos + lento + parado", 6, {RAPIDO, RAPIDO, RAPIDO, RAPIDO, LENTO, PARADO}},
+};
+
+static cliente_t clientes[CARGA_MAX_CLIENTES];
+static int num_clientes;
+static int modo_cola;
+static difusion_t difusion;
+static trabajo_t trabajos[CARGA_TRABAJO_MAX];
+static int primer_trabajo, num_trabajos;
+static uint32_t latencias[CARGA_MAX_LATENCIAS];
+static int num_latencias;
+static uint32_t desconexiones, max_bloqueo_ms;
+static uint32_t semilla = 12345;
+
+static uint32_t aleatorio(uint32_t n)
+{
+    semilla = semilla * 1103515245u + 12345u;
+    return (semilla >> 8) % n;
+}
+
+static cliente_t *cliente_fd(int fd)
+{
+    for (int i = 0; i < num_clientes; i++)
+    {
+        if (clientes[i].fd == fd && clientes[i].conectado)
+            return &clientes[i];
+    }
+    return NULL;
+}
+
+static int encolar(int fd, uint32_t publicado_ms)
+{
+    if (num_trabajos == CARGA_TRABAJO_MAX)
+        return 0;
+    trabajos[(primer_trabajo + num_trabajos++) % CARGA_TRABAJO_MAX] = (trabajo_t){fd, publicado_ms};
+    return 1;
+}
+
+// close_fn de api.c
+static void cerrar(cliente_t *cliente)
+{
+    cliente->conectado = 0;
+    desconexiones++;
+    if (modo_cola)
+        difusion_desconectar(&difusion, cliente->fd);
+}
+
+// enviar_siguiente de api.c
+static void enviar_siguiente(cliente_t *cliente, uint32_t ahora)
+{
+    const difusion_cliente_t *dc = NULL;
+    for (int c = 0; c < DIFUSION_MAX_CLIENTES && dc == NULL; c++)
+    {
+        if (difusion.clientes[c].fd == cliente->fd)
+            dc = &difusion.clientes[c];
+    }
+    if (dc == NULL || dc->en_vuelo || dc->num == 0 || cliente->ocupado + CARGA_TRAMA_WS > CARGA_SOCKET_BUF)
+        return;
+    uint32_t publicado_ms;
+    difusion_siguiente(&difusion, cliente->fd, &publicado_ms);
+    if (!encolar(cliente->fd, publicado_ms))
+        difusion_enviado(&difusion, cliente->fd, 0, ahora);
+}
+
+static void enviar_pendientes(uint32_t ahora)
+{
+    for (int i = 0; i < num_clientes; i++)
+    {
+        if (clientes[i].conectado)
+            enviar_siguiente(&clientes[i], ahora);
+    }
+}
+
+static void publicar(const telemetria_lectura_t *lectura, uint32_t ahora)
+{
+    if (modo_cola)
+    {
+        uint8_t mensaje[DIFUSION_MENSAJE_LEN];
+        difusion_codificar(lectura, ahora / 1000, mensaje);
+        difusion_publicar(&difusion, mensaje, ahora);
+        enviar_pendientes(ahora);
+        int atascado = difusion_atascado(&difusion, ahora);
+        if (atascado != DIFUSION_LIBRE)
+            cerrar(cliente_fd(atascado));
+        return;
+    }
+    for (int i = 0; i < num_clientes; i++)
+    {
+        if (clientes[i].conectado && !encolar(clientes[i].fd, ahora))
+            clientes[i].perdidos++;
+    }
+}
+
+// Un ms de la tarea del servidor
+static void servidor(uint32_t ahora)
+{
+    static trabajo_t actual;
+    static int ocupado = 0;
+    static uint32_t bloqueado_desde;
+    static int bloqueado = 0;
+    int presupuesto_us = 1000;
+    if (ahora == 0)
+        ocupado = bloqueado = 0;
+    while (presupuesto_us > 0)
+    {
+        if (!ocupado)
+        {
+            if (num_trabajos == 0)
+                return;
+            actual = trabajos[primer_trabajo];
+            primer_trabajo = (primer_trabajo + 1) % CARGA_TRABAJO_MAX;
+            num_trabajos--;
+            ocupado = 1;
+        }
+        cliente_t *cliente = cliente_fd(actual.fd);
+        if (cliente == NULL)
+        {
+            ocupado = 0; // socket ya cerrado: falla enseguida
+            continue;
+        }
+        if (cliente->ocupado + CARGA_TRAMA_WS > CARGA_SOCKET_BUF)
+        {
+            if (!bloqueado)
+            {
+                bloqueado = 1;
+                bloqueado_desde = ahora;
+            }
+            if (ahora - bloqueado_desde > max_bloqueo_ms)
+                max_bloqueo_ms = ahora - bloqueado_desde;
+            if (ahora - bloqueado_desde >= CARGA_TIMEOUT_MS)
+            {
+                bloqueado = ocupado = 0;
+                if (modo_cola)
+                    difusion_enviado(&difusion, cliente->fd, 0, ahora);
+                cerrar(cliente);
+            }
+            return;
+        }
+        bloqueado = ocupado = 0;
+        cliente->ocupado += CARGA_TRAMA_WS;
+        cliente->recibidos++;
+        presupuesto_us -= CARGA_COSTE_US;
+        if (cliente->tipo == RAPIDO && num_latencias < CARGA_MAX_LATENCIAS)
+        {
+            double llegada = ahora + (1000 - presupuesto_us) / 1000.0 + cliente->ocupado / bytes_ms[RAPIDO];
+            latencias[num_latencias++] = (uint32_t)(llegada - actual.publicado_ms + 0.5);
+        }
+        if (modo_cola)
+        {
+            difusion_enviado(&difusion, cliente->fd, 1, ahora);
+            enviar_pendientes(ahora);
+        }
+    }
+}
+
+static int comparar(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void simular(const escenario_t *escenario, int cola)
+{
+    uint32_t fase[CARGA_NODOS];
+    semilla = 12345;
+    for (int n = 0; n < CARGA_NODOS; n++)
+        fase[n] = aleatorio(n < CARGA_NODOS_LOTE ? CARGA_LOTE * CARGA_PERIODO_MS : CARGA_PERIODO_MS);
+
+    modo_cola = cola;
+    num_clientes = escenario->num;
+    primer_trabajo = num_trabajos = num_latencias = 0;
+    desconexiones = max_bloqueo_ms = 0;
+    difusion_iniciar(&difusion);
+    for (int i = 0; i < num_clientes; i++)
+    {
+        clientes[i] = (cliente_t){.fd = 50 + i, .tipo = escenario->tipos[i], .conectado = 1};
+        difusion_conectar(&difusion, clientes[i].fd, 0);
+    }
+
+    telemetria_lectura_t lectura = {.temperatura = 24.5f, .ec = 1500, .ph = 6.8f, .tds = 750};
+    for (uint32_t ahora = 0; ahora < CARGA_DURACION_MS; ahora++)
+    {
+        for (int i = 0; i < num_clientes; i++)
+        {
+            clientes[i].ocupado -= bytes_ms[clientes[i].tipo];
+            if (clientes[i].ocupado < 0)
+                clientes[i].ocupado = 0;
+        }
+        for (int n = 0; n < CARGA_NODOS; n++)
+        {
+            int lote = n < CARGA_NODOS_LOTE;
+            uint32_t periodo = lote ? CARGA_LOTE * CARGA_PERIODO_MS : CARGA_PERIODO_MS;
+            if (ahora % periodo != fase[n])
+                continue;
+            lectura.origen = (uint8_t)(n + 1);
+            for (int k = 0; k < (lote ? CARGA_LOTE : 1); k++)
+            {
+                lectura.secuencia++;
+                publicar(&lectura, ahora);
+            }
+        }
+        servidor(ahora);
+    }
+
+    uint32_t perdidos_rapidos = 0, otros_recibidos = 0, otros_perdidos = 0;
+    for (int i = 0; i < num_clientes; i++)
+    {
+        uint32_t perdidos = clientes[i].perdidos;
+        if (cola)
+        {
+            for (int c = 0; c < DIFUSION_MAX_CLIENTES; c++)
+            {
+                if (difusion.clientes[c].fd == clientes[i].fd)
+                    perdidos += difusion.clientes[c].descartados;
+            }
+        }
+        if (clientes[i].tipo == RAPIDO)
+        {
+            perdidos_rapidos += perdidos;
+        }
+        else
+        {
+            otros_recibidos += clientes[i].recibidos;
+            otros_perdidos += perdidos;
+        }
+    }
+    qsort(latencias, num_latencias, sizeof(latencias[0]), comparar);
+    uint32_t p50 = num_latencias ? latencias[num_latencias / 2] : 0;
+    uint32_t p99 = num_latencias ? latencias[(num_latencias * 99) / 100] : 0;
+    uint32_t max = num_latencias ? latencias[num_latencias - 1] : 0;
+    printf("%-8s %-27s %6lu %6lu %7lu %8lu %9lu/%-6lu %6lu %9lu\n", cola ? "cola" : "directo", escenario->nombre,
+           (unsigned long)p50, (unsigned long)p99, (unsigned long)max, (unsigned long)perdidos_rapidos,
+           (unsigned long)otros_recibidos, (unsigned long)otros_perdidos, (unsigned long)desconexiones,
+           (unsigned long)max_bloqueo_ms);
+}
+
+// Coste en el host de publicar una lectura a DIFUSION_MAX_CLIENTES clientes y sacarla de sus colas
+static void medir_publicar(void)
+{
+    uint8_t mensaje[DIFUSION_MENSAJE_LEN];
+    telemetria_lectura_t lectura = {.origen = 1, .temperatura = 24.5f, .ec = 1500, .ph = 6.8f, .tds = 750};
+    difusion_iniciar(&difusion);
+    for (int i = 0; i < DIFUSION_MAX_CLIENTES; i++)
+        difusion_conectar(&difusion, 50 + i, 0);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    uint32_t control = 0;
+    for (uint32_t r = 0; r < CARGA_REPETICIONES; r++)
+    {
+        lectura.secuencia = (uint16_t)r;
+        difusion_codificar(&lectura, r, mensaje);
+        difusion_publicar(&difusion, mensaje, r);
+        for (int i = 0; i < DIFUSION_MAX_CLIENTES; i++)
+        {
+            const uint8_t *enviado = difusion_siguiente(&difusion, 50 + i, NULL);
+            control += enviado[4 + 2];
+            difusion_enviado(&difusion, 50 + i, 1, r);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / CARGA_REPETICIONES;
+    printf("\npublicar + sacar de %d colas: %.0f ns por lectura (%lu)\n", DIFUSION_MAX_CLIENTES, ns,
+           (unsigned long)(control & 1));
+    printf("memoria: %lu bytes por cliente, %lu en total\n", (unsigned long)sizeof(difusion_cliente_t),
+           (unsigned long)sizeof(difusion_t));
+}
+
+int main(void)
+{
+    printf("Carga del WebSocket: %d nodos, %.1f lecturas/s, %lu s, envio %d us, socket %d B\n", CARGA_NODOS,
+           (CARGA_NODOS * 1000.0) / CARGA_PERIODO_MS, (unsigned long)(CARGA_DURACION_MS / 1000), CARGA_COSTE_US,
+           CARGA_SOCKET_BUF);
+    printf("latencia (ms) y perdidas de los clientes rapidos; recibidas/perdidas de lentos y parados\n\n");
+    printf("%-8s %-27s %6s %6s %7s %8s %16s %6s %9s\n", "modo", "clientes", "p50", "p99", "max", "perdidas",
+           "lentos rec/perd", "cierres", "bloqueo");
+    int fallos = 0;
+    for (int cola = 1; cola >= 0; cola--)
+    {
+        for (size_t e = 0; e < sizeof(escenarios) / sizeof(escenarios[0]); e++)
+        {
+            simular(&escenarios[e], cola);
+            if (!cola)
+                continue;
+            // con la cola los rapidos no pierden nada ni esperan a los demas
+            uint32_t perdidos = 0;
+            for (int i = 0; i < num_clientes; i++)
+            {
+                if (clientes[i].tipo == RAPIDO)
+                    perdidos += clientes[i].perdidos;
+                if (clientes[i].tipo == RAPIDO && !clientes[i].conectado)
+                    fallos++;
+                if (clientes[i].tipo == PARADO && clientes[i].conectado)
+                    fallos++;
+            }
+            if (perdidos > 0 || max_bloqueo_ms > 0 || latencias[num_latencias - 1] > 100)
+                fallos++;
+        }
+        printf("\n");
+    }
+    medir_publicar();
+    if (fallos > 0)
+    {
+        printf("\nFALLO: %d comprobaciones\n", fallos);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,241 @@
+/*
+  Escalado del registro de nodos del receptor (nodos.c)
+
+  Simula 24 h de una red de N nodos que mandan una lectura por minuto, con un 2% de paquetes perdidos y un 10%
+  de nodos que se callan un rato y vuelven. Los timeouts son de 5 min, 15 min o 2 h segun el nodo, para que
+  haya nodos en los tres niveles de la rueda. El reloj en ms empieza cerca de 2^32 y desborda a la hora.
+
+  Cada nodo se pasa por el registro y por un barrido lineal de referencia (lo que hacia revisar_offline con una
+  sola variable, generalizado a N nodos). Se comprueba que los dos detectan los mismos offline en el mismo tick
+  y que las perdidas contadas coinciden con las inyectadas, y se mide el coste por paquete y por tick.
+
+  Uso: escala_nodos
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nodos.h"
+
+#define ESCALA_MAX_NODOS NODOS_MAX
+#define ESCALA_PERIODO_S 60
+#define ESCALA_DURACION_S (24 * 3600)
+#define ESCALA_PERDIDA_PCT 2
+#define ESCALA_SILENCIO_PCT 10
+#define ESCALA_INICIO_MS (0xFFFFFFFFu - 3600u * 1000u)
+
+typedef struct
+{
+    uint16_t direccion;
+    uint16_t desfase_ms;   // dentro del segundo en que transmite
+    uint32_t timeout_ms;
+    uint32_t silencio_desde; // s
+    uint32_t silencio_hasta;
+    uint16_t secuencia;
+    uint32_t perdidos;
+    // referencia
+    uint32_t ultimo_ms;
+    int online;
+} simulado_t;
+
+typedef struct
+{
+    uint16_t direccion;
+    uint32_t segundo;
+} offline_t;
+
+static simulado_t sim[ESCALA_MAX_NODOS];
+static int calendario[ESCALA_PERIODO_S][ESCALA_MAX_NODOS]; // nodos que transmiten en cada segundo del minuto
+static int en_calendario[ESCALA_PERIODO_S];
+static offline_t eventos_rueda[4 * ESCALA_MAX_NODOS];
+static offline_t eventos_lineal[4 * ESCALA_MAX_NODOS];
+static int num_rueda, num_lineal;
+static uint32_t segundo_actual;
+static nodos_t registro;
+static uint32_t semilla = 12345;
+
+static uint32_t aleatorio(uint32_t n)
+{
+    semilla = semilla * 1103515245u + 12345u;
+    return (semilla >> 8) % n;
+}
+
+static double ns_entre(const struct timespec *a, const struct timespec *b)
+{
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
+
+static void preparar(int num)
+{
+    static uint8_t usada[65536];
+    memset(usada, 0, sizeof(usada));
+    memset(en_calendario, 0, sizeof(en_calendario));
+    const uint32_t timeouts[] = {5 * 60000, 15 * 60000, 2 * 3600000};
+    for (int i = 0; i < num; i++)
+    {
+        simulado_t *s = &sim[i];
+        memset(s, 0, sizeof(*s));
+        do
+        {
+            s->direccion = (uint16_t)aleatorio(0xFFFF);
+        } while (usada[s->direccion]);
+        usada[s->direccion] = 1;
+        s->desfase_ms = (uint16_t)aleatorio(1000);
+        s->timeout_ms = timeouts[i % 3];
+        s->secuencia = (uint16_t)aleatorio(0x10000);
+        if ((int)aleatorio(100) < ESCALA_SILENCIO_PCT)
+        {
+            s->silencio_desde = aleatorio(ESCALA_DURACION_S);
+            s->silencio_hasta = s->silencio_desde + 600 + aleatorio(6 * 3600);
+        }
+        int fase = (int)aleatorio(ESCALA_PERIODO_S);
+        calendario[fase][en_calendario[fase]++] = i;
+    }
+}
+
+static void al_offline(const nodo_t *nodo, void *arg)
+{
+    (void)arg;
+    eventos_rueda[num_rueda].direccion = nodo->direccion;
+    eventos_rueda[num_rueda].segundo = segundo_actual;
+    num_rueda++;
+}
+
+static int transmite(const simulado_t *s, uint32_t t)
+{
+    return s->silencio_hasta == 0 || t < s->silencio_desde || t >= s->silencio_hasta;
+}
+
+static int comparar_offline(const void *a, const void *b)
+{
+    const offline_t *x = a, *y = b;
+    if (x->segundo != y->segundo)
+        return x->segundo < y->segundo ? -1 : 1;
+    return (int)x->direccion - (int)y->direccion;
+}
+
+static void escenario(int num)
+{
+    preparar(num);
+    nodos_iniciar(&registro, 15 * 60000, ESCALA_INICIO_MS);
+    num_rueda = num_lineal = 0;
+
+    uint32_t inicio_semilla = semilla;
+    double ns_recibido = 0, ns_avanzar = 0, ns_lineal = 0;
+    long paquetes = 0, perdidos = 0, de_vuelta = 0, nuevos = 0;
+    struct timespec t0, t1;
+
+    // registro de nodos y rueda
+    for (uint32_t t = 0; t < ESCALA_DURACION_S; t++)
+    {
+        uint32_t ahora = ESCALA_INICIO_MS + t * 1000u;
+        segundo_actual = t;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        nodos_avanzar(&registro, ahora, al_offline, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ns_avanzar += ns_entre(&t0, &t1);
+
+        int fase = t % ESCALA_PERIODO_S;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (int k = 0; k < en_calendario[fase]; k++)
+        {
+            simulado_t *s = &sim[calendario[fase][k]];
+            if (!transmite(s, t))
+                continue;
+            s->secuencia++;
+            if ((int)aleatorio(100) < ESCALA_PERDIDA_PCT)
+            {
+                s->perdidos++;
+                continue;
+            }
+            nodos_evento_t evento = nodos_recibido(&registro, s->direccion, s->secuencia, ahora + s->desfase_ms);
+            if (evento == NODOS_NUEVO)
+            {
+                nodos_set_timeout(&registro, s->direccion, s->timeout_ms);
+                nuevos++;
+            }
+            else if (evento == NODOS_DE_VUELTA)
+            {
+                de_vuelta++;
+            }
+            paquetes++;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ns_recibido += ns_entre(&t0, &t1);
+    }
+
+    // referencia: mismas transmisiones (misma semilla), barrido de todos los nodos en cada tick
+    semilla = inicio_semilla;
+    for (int i = 0; i < num; i++)
+    {
+        sim[i].online = 0;
+        sim[i].ultimo_ms = 0;
+    }
+    for (uint32_t t = 0; t < ESCALA_DURACION_S; t++)
+    {
+        uint32_t ahora = ESCALA_INICIO_MS + t * 1000u;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (int i = 0; i < num; i++)
+        {
+            simulado_t *s = &sim[i];
+            if (s->online && ahora - s->ultimo_ms >= s->timeout_ms)
+            {
+                s->online = 0;
+                eventos_lineal[num_lineal].direccion = s->direccion;
+                eventos_lineal[num_lineal].segundo = t;
+                num_lineal++;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ns_lineal += ns_entre(&t0, &t1);
+
+        int fase = t % ESCALA_PERIODO_S;
+        for (int k = 0; k < en_calendario[fase]; k++)
+        {
+            simulado_t *s = &sim[calendario[fase][k]];
+            if (!transmite(s, t))
+                continue;
+            if ((int)aleatorio(100) < ESCALA_PERDIDA_PCT)
+                continue;
+            s->online = 1;
+            s->ultimo_ms = ahora + s->desfase_ms;
+        }
+    }
+
+    qsort(eventos_rueda, num_rueda, sizeof(offline_t), comparar_offline);
+    qsort(eventos_lineal, num_lineal, sizeof(offline_t), comparar_offline);
+    int iguales = num_rueda == num_lineal &&
+                  memcmp(eventos_rueda, eventos_lineal, num_rueda * sizeof(offline_t)) == 0;
+
+    long perdidos_registro = 0;
+    for (int i = 0; i < num; i++)
+    {
+        const nodo_t *nodo = nodos_buscar(&registro, sim[i].direccion);
+        perdidos += sim[i].perdidos;
+        if (nodo != NULL)
+            perdidos_registro += nodo->perdidos;
+    }
+    // las perdidas antes del primer paquete de cada nodo no se pueden contar
+    printf("%6d %9ld %6d %6d %3s %9ld %9ld %9ld %8.1f %9.0f %9.0f\n", num, paquetes, num_rueda, num_lineal,
+           iguales ? "si" : "NO", de_vuelta, perdidos, perdidos_registro, ns_recibido / (paquetes ? paquetes : 1),
+           ns_avanzar / ESCALA_DURACION_S, ns_lineal / ESCALA_DURACION_S);
+    if (!iguales || nuevos != num)
+    {
+        fprintf(stderr, "escenario de %d nodos: los offline no coinciden con la referencia\n", num);
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(void)
+{
+    printf("%6s %9s %6s %6s %3s %9s %9s %9s %8s %9s %9s\n", "nodos", "paquetes", "offl.", "ref.", "ok", "vuelven",
+           "perd.sim", "perd.reg", "ns/paq", "ns/tick", "ns/barr.");
+    const int escenarios[] = {100, 1000, 10000};
+    for (size_t i = 0; i < sizeof(escenarios) / sizeof(escenarios[0]); i++)
+    {
+        escenario(escenarios[i]);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,262 @@
+/*
+  Replay de lecturas contra las alertas del receptor
+
+  Compara cuantos eventos de Blynk (llamadas HTTP) genera la cadena de if que habia en procesar_lectura, que
+  avisaba en cada paquete fuera de rango, con el motor de reglas (alertas.c) y las reglas por defecto del receptor.
+
+  Uso: replay_alertas [log ...]
+  Cada log es la salida de idf.py monitor del receptor: se leen las lineas
+    I (<ms>) LORA_RX: Telemetria del nodo <n>, lectura <s>
+    I (<ms>) LORA_RX: Datos extraídos y enviados a Blynk: T=<t>, EC=<ec>, pH=<ph>, TDS=<tds>
+  Sin argumentos se reproducen trazas sinteticas de 24 h con una lectura cada 2 s, y falla (sale con error) si
+  los eventos de alguna quedan fuera de lo esperado: ninguno con todo en rango, al menos uno en las que salen del
+  rango (no se pierde la alerta), como mucho ALERTA_MAX_NIVEL (uno por nivel de escalado) en las que salen una
+  sola vez, y como mucho lo que dejan los tokens del parametro (ALERTA_TOKENS y uno por ALERTA_RECARGA_MS) con
+  ruido en el limite. Los logs solo se miden.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+
+#include "telemetria.h"
+#include "alertas.h"
+
+// mismas reglas por defecto que Receptor_Smacar/main/main.c
+#define TEMP_MIN 05.0f
+#define TEMP_MAX 25.0f
+#define EC_MAX 35.00f
+#define PH_MIN 6.5f
+#define PH_MAX 8.5f
+#define TDS_MAX 500.0f
+#define ALERTA_DURACION_MS 10000
+#define ALERTA_ESCALADO_MS 900000
+#define ALERTA_MAX_NIVEL 3
+#define ALERTA_TOKENS 3
+#define ALERTA_RECARGA_MS 600000
+
+#define REPLAY_MAX_LECTURAS 200000
+#define REPLAY_PERIODO_MS 2000
+#define REPLAY_DURACION_MS (24UL * 3600UL * 1000UL)
+#define PI 3.14159265f
+
+// eventos que dejan pasar los tokens de un parametro en la traza
+#define REPLAY_MAX_TOKENS (ALERTA_TOKENS + REPLAY_DURACION_MS / ALERTA_RECARGA_MS)
+
+typedef struct
+{
+    uint32_t ms;
+    telemetria_lectura_t lectura;
+} muestra_t;
+
+static muestra_t traza[REPLAY_MAX_LECTURAS];
+static uint32_t semilla = 12345;
+
+static void configurar(alertas_t *alertas)
+{
+    const alertas_regla_t reglas[] = {
+        {ALERTAS_CUALQUIER_NODO, TELEMETRIA_TEMPERATURA, 0, ALERTA_MAX_NIVEL, TEMP_MIN, TEMP_MAX, 0.5f, ALERTA_DURACION_MS, ALERTA_ESCALADO_MS},
+        {ALERTAS_CUALQUIER_NODO, TELEMETRIA_EC, 1, ALERTA_MAX_NIVEL, -FLT_MAX, EC_MAX, 1.0f, ALERTA_DURACION_MS, ALERTA_ESCALADO_MS},
+        {ALERTAS_CUALQUIER_NODO, TELEMETRIA_PH, 2, ALERTA_MAX_NIVEL, PH_MIN, PH_MAX, 0.1f, ALERTA_DURACION_MS, ALERTA_ESCALADO_MS},
+        {ALERTAS_CUALQUIER_NODO, TELEMETRIA_TDS, 3, ALERTA_MAX_NIVEL, -FLT_MAX, TDS_MAX, 10.0f, ALERTA_DURACION_MS, ALERTA_ESCALADO_MS},
+    };
+    alertas_iniciar(alertas);
+    for (int i = 0; i < TELEMETRIA_NUM_PARAMETROS; i++)
+    {
+        alertas_agregar_evento(alertas, ALERTA_TOKENS, ALERTA_RECARGA_MS);
+    }
+    for (size_t i = 0; i < sizeof(reglas) / sizeof(reglas[0]); i++)
+    {
+        alertas_agregar_regla(alertas, &reglas[i]);
+    }
+    alertas_reiniciar(alertas, 0);
+}
+
+// la cadena de if de procesar_lectura antes del motor de reglas: un evento por parametro fuera, en cada paquete
+static int eventos_if(const telemetria_lectura_t *l)
+{
+    return (l->temperatura < TEMP_MIN || l->temperatura > TEMP_MAX) + (l->ec > EC_MAX) +
+           (l->ph < PH_MIN || l->ph > PH_MAX) + (l->tds > TDS_MAX);
+}
+
+static float ruido(float sigma)
+{
+    // suma de 4 uniformes, aproximadamente normal
+    float s = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        semilla = semilla * 1103515245u + 12345u;
+        s += (float)(semilla >> 8) / (float)(1u << 24) - 0.5f;
+    }
+    return s * sigma * 1.732f;
+}
+
+// Devuelve los eventos de Blynk de la traza con el motor de reglas
+static long replay(const char *nombre, int num)
+{
+    static alertas_t alertas;
+    configurar(&alertas);
+    alertas_aviso_t avisos[ALERTAS_MAX_AVISOS];
+    long llamadas_if = 0, llamadas = 0, recuperaciones = 0;
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < num; i++)
+    {
+        int n = alertas_evaluar(&alertas, &traza[i].lectura, traza[i].ms, avisos, ALERTAS_MAX_AVISOS);
+        for (int k = 0; k < n; k++)
+        {
+            if (avisos[k].nivel > 0)
+                llamadas++;
+            else
+                recuperaciones++;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (int i = 0; i < num; i++)
+    {
+        llamadas_if += eventos_if(&traza[i].lectura);
+    }
+
+    double ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / (num > 0 ? num : 1);
+    double reduccion = llamadas_if > 0 ? 100.0 * (llamadas_if - llamadas) / llamadas_if : 0;
+    printf("%-40s %8d %10ld %10ld %7.1f%% %8ld %8lu %8.0f\n", nombre, num, llamadas_if, llamadas, reduccion,
+           recuperaciones, (unsigned long)alertas.suprimidos, ns);
+    return llamadas;
+}
+
+// genera una traza de 24 h; valor(t) devuelve la lectura en el segundo t
+static int sintetica(void (*valor)(float t, telemetria_lectura_t *l))
+{
+    int num = 0;
+    for (uint32_t ms = 0; ms < REPLAY_DURACION_MS && num < REPLAY_MAX_LECTURAS; ms += REPLAY_PERIODO_MS)
+    {
+        telemetria_lectura_t *l = &traza[num].lectura;
+        memset(l, 0, sizeof(*l));
+        l->origen = 1;
+        l->secuencia = (uint16_t)num;
+        // en rango por defecto
+        l->temperatura = 20.0f + ruido(0.1f);
+        l->ec = 30.0f + ruido(0.5f);
+        l->ph = 7.2f + ruido(0.03f);
+        l->tds = 300.0f + ruido(3.0f);
+        valor(ms / 1000.0f, l);
+        traza[num].ms = ms;
+        num++;
+    }
+    return num;
+}
+
+static void en_rango(float t, telemetria_lectura_t *l)
+{
+    (void)t;
+    (void)l;
+}
+
+// temperatura oscilando alrededor del maximo con el ciclo diario
+static void temperatura_en_el_limite(float t, telemetria_lectura_t *l)
+{
+    l->temperatura = 24.8f + 0.6f * sinf(2 * PI * t / 86400.0f) + ruido(0.15f);
+}
+
+// pH justo en el minimo, solo ruido del sensor
+static void ph_ruidoso(float t, telemetria_lectura_t *l)
+{
+    (void)t;
+    l->ph = 6.5f + ruido(0.05f);
+}
+
+// excursion real de 30 min a las 12 h
+static void excursion(float t, telemetria_lectura_t *l)
+{
+    if (t >= 43200 && t < 45000)
+        l->temperatura = 28.0f + ruido(0.1f);
+}
+
+// EC en uS/cm como la manda el transmisor ("EC:1548.00") contra EC_MAX en mS/cm: fuera en todos los paquetes
+static void ec_siempre_fuera(float t, telemetria_lectura_t *l)
+{
+    (void)t;
+    l->ec = 1548.0f + ruido(10.0f);
+}
+
+// ESP-IDF monitor del receptor
+static int leer_log(const char *ruta)
+{
+    FILE *f = fopen(ruta, "r");
+    if (f == NULL)
+    {
+        fprintf(stderr, "No se pudo abrir %s\n", ruta);
+        return -1;
+    }
+    char linea[512];
+    int num = 0;
+    unsigned nodo = 1;
+    while (fgets(linea, sizeof(linea), f) != NULL && num < REPLAY_MAX_LECTURAS)
+    {
+        unsigned long ms;
+        char *p = strchr(linea, '(');
+        if (p == NULL || sscanf(p, "(%lu)", &ms) != 1)
+            continue;
+        char *q;
+        if ((q = strstr(linea, "Telemetria del nodo ")) != NULL)
+        {
+            sscanf(q, "Telemetria del nodo %u", &nodo);
+        }
+        else if ((q = strstr(linea, "T=")) != NULL)
+        {
+            telemetria_lectura_t *l = &traza[num].lectura;
+            memset(l, 0, sizeof(*l));
+            if (sscanf(q, "T=%f, EC=%f, pH=%f, TDS=%f", &l->temperatura, &l->ec, &l->ph, &l->tds) == 4)
+            {
+                l->origen = (uint8_t)nodo;
+                traza[num].ms = (uint32_t)ms;
+                num++;
+            }
+        }
+    }
+    fclose(f);
+    return num;
+}
+
+// Fallos de una traza sintetica con eventos fuera de [minimo, maximo]
+static int comprobar(const char *nombre, void (*valor)(float t, telemetria_lectura_t *l), long minimo, long maximo)
+{
+    long eventos = replay(nombre, sintetica(valor));
+    if (eventos < minimo || eventos > maximo)
+    {
+        printf("FALLO %s: %ld eventos (esperados %ld-%ld)\n", nombre, eventos, minimo, maximo);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    printf("%-40s %8s %10s %10s %8s %8s %8s %8s\n", "traza", "lecturas", "eventos if", "eventos", "menos",
+           "normal", "sin tok.", "ns/lect");
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            int num = leer_log(argv[i]);
+            if (num < 0)
+                return EXIT_FAILURE;
+            replay(argv[i], num);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    int fallos = 0;
+    fallos += comprobar("sintetica: todo en rango", en_rango, 0, 0);
+    fallos += comprobar("sintetica: temperatura en el limite", temperatura_en_el_limite, 1, ALERTA_MAX_NIVEL);
+    fallos += comprobar("sintetica: pH con ruido en el minimo", ph_ruidoso, 1, REPLAY_MAX_TOKENS);
+    fallos += comprobar("sintetica: excursion de 30 min", excursion, 1, ALERTA_MAX_NIVEL);
+    fallos += comprobar("sintetica: EC en uS/cm (siempre fuera)", ec_siempre_fuera, 1, ALERTA_MAX_NIVEL);
+    printf("\n%s: eventos por traza dentro de lo esperado (tokens: %d por dia)\n", fallos == 0 ? "OK" : "FALLO",
+           (int)REPLAY_MAX_TOKENS);
+    return fallos == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,380 @@
+/*
+  Simulador de la politica de envio del transmisor (politica.c) sobre trazas de lecturas
+
+  Cada traza es la verdad: una lectura cada 2 s durante 24 h. El transmisor simulado muestrea la traza con el
+  periodo que le da politica_periodo, pasa cada lectura por politica_evaluar y envia las que salen (lote de 1,
+  una trama por lectura). El receptor se queda con el ultimo valor recibido, y con eso se mide el error de
+  reconstruccion contra la traza en cada punto (RMS y maximo por parametro).
+  Da lecturas y uplinks por dia, el silencio mas largo entre uplinks y la latencia de una alerta: desde que la
+  traza sale de un umbral hasta que llega una lectura fuera de umbral (la peor de la traza).
+
+  Con las trazas sinteticas comprueba la politica adaptativa (la ultima): su tiempo en el aire por dia sin contar
+  las lecturas fuera de umbral (salen todas a proposito) no pasa de SIM_AIRE_MAX_S_DIA y su alerta no llega mas de rapido_s despues que con todas las lecturas cada 10 s. Ninguna
+  politica puede dejar una alerta sin enviar. Sale con error si algo no se cumple.
+
+  Uso: sim_politica [log ...]
+  Cada log es la salida de idf.py monitor del receptor, como en replay_alertas (lineas "Telemetria del nodo" y
+  "Datos extraídos y enviados a Blynk: T=..."); se usan las lecturas del primer nodo como traza. Sin argumentos
+  se usan trazas sinteticas.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include "telemetria.h"
+#include "comandos.h"
+#include "politica.h"
+
+#define SIM_MAX_LECTURAS 100000
+#define SIM_PASO_S 2
+#define SIM_DURACION_S (24u * 3600u)
+#define PI 3.14159265f
+
+// presupuesto de aire de un nodo: 1% de ciclo de trabajo. Cada uplink es una trama de telemetria a SF12, 125 kHz
+#define SIM_AIRE_MAX_S_DIA 864.0
+#define SIM_SIMBOLO_MS 32.768
+#define SIM_POLITICA_ADAPTATIVA (SIM_NUM_POLITICAS - 1)
+
+// umbrales del transmisor en la simulacion (COMANDO_UMBRAL), en las unidades que envia (EC en uS/cm)
+#define TEMP_MIN 5.0f
+#define TEMP_MAX 30.0f
+#define EC_MAX 2000.0f
+#define PH_MIN 6.5f
+#define PH_MAX 8.5f
+#define TDS_MAX 1000.0f
+
+typedef struct
+{
+    uint32_t s;
+    telemetria_lectura_t lectura;
+} muestra_t;
+
+typedef struct
+{
+    const char *nombre;
+    uint16_t periodo_s;
+    uint16_t rapido_s;
+    uint16_t silencio_s;
+    float banda[TELEMETRIA_NUM_PARAMETROS];
+    float pendiente[TELEMETRIA_NUM_PARAMETROS]; // por minuto
+    float margen[TELEMETRIA_NUM_PARAMETROS];
+} sim_politica_t;
+
+// temperatura, EC, pH, TDS
+static const sim_politica_t politicas[] = {
+    {"todas, 10 s", 10, 0, COMANDOS_SILENCIO_DEFECTO_S, {0}, {0}, {0}},
+    {"todas, 60 s", 60, 0, COMANDOS_SILENCIO_DEFECTO_S, {0}, {0}, {0}},
+    {"banda, 10 s", 10, 0, COMANDOS_SILENCIO_DEFECTO_S, {0.2f, 20.0f, 0.05f, 10.0f}, {0}, {0}},
+    {"banda+pendiente, 10 s", 10, 0, COMANDOS_SILENCIO_DEFECTO_S, {0.2f, 20.0f, 0.05f, 10.0f},
+     {1.0f, 150.0f, 0.3f, 60.0f}, {0}},
+    {"adaptativa, 60/10 s", 60, 10, COMANDOS_SILENCIO_DEFECTO_S, {0.2f, 20.0f, 0.05f, 10.0f},
+     {1.0f, 150.0f, 0.3f, 60.0f}, {1.0f, 150.0f, 0.3f, 100.0f}},
+};
+#define SIM_NUM_POLITICAS (int)(sizeof(politicas) / sizeof(politicas[0]))
+
+typedef struct
+{
+    double aire_s_dia; // sin las lecturas fuera de umbral
+    uint32_t latencia_s;
+    bool alerta;           // la traza tuvo alguna alerta
+    bool alerta_pendiente; // y quedo sin enviar
+} resultado_t;
+
+static const char *const parametros[TELEMETRIA_NUM_PARAMETROS] = {"temp", "ec", "ph", "tds"};
+
+static muestra_t traza[SIM_MAX_LECTURAS];
+static uint32_t semilla = 12345;
+
+// Tiempo en el aire de una trama de telemetria (cabecera implicita, CRC, LDRO, preambulo de 8 simbolos)
+static double toa_ms(int bytes)
+{
+    double num = 8.0 * bytes - 4.0 * 12 + 28 + 16 - 20;
+    double simbolos = num > 0 ? ceil(num / (4.0 * (12 - 2))) * 5 : 0;
+    return (8 + 4.25 + 8 + simbolos) * SIM_SIMBOLO_MS;
+}
+
+static float ruido(float sigma)
+{
+    // suma de 4 uniformes, aproximadamente normal
+    float s = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        semilla = semilla * 1103515245u + 12345u;
+        s += (float)(semilla >> 8) / (float)(1u << 24) - 0.5f;
+    }
+    return s * sigma * 1.732f;
+}
+
+static void configurar(comandos_config_t *config, const sim_politica_t *p)
+{
+    comandos_config_defecto(config, p->periodo_s);
+    config->rapido_s = p->rapido_s;
+    config->silencio_s = p->silencio_s;
+    config->umbral_min[TELEMETRIA_TEMPERATURA] = TEMP_MIN;
+    config->umbral_max[TELEMETRIA_TEMPERATURA] = TEMP_MAX;
+    config->umbral_max[TELEMETRIA_EC] = EC_MAX;
+    config->umbral_min[TELEMETRIA_PH] = PH_MIN;
+    config->umbral_max[TELEMETRIA_PH] = PH_MAX;
+    config->umbral_max[TELEMETRIA_TDS] = TDS_MAX;
+    for (int i = 0; i < TELEMETRIA_NUM_PARAMETROS; i++)
+    {
+        config->banda[i] = p->banda[i];
+        config->pendiente[i] = p->pendiente[i];
+        config->margen[i] = p->margen[i];
+    }
+}
+
+static resultado_t simular(const char *traza_nombre, int num, const sim_politica_t *p, double lecturas_base)
+{
+    comandos_config_t config;
+    configurar(&config, p);
+    politica_t politica;
+    politica_iniciar(&politica);
+
+    telemetria_lectura_t recibida = {0};
+    bool hay_recibida = false;
+    uint32_t siguiente = traza[0].s;
+    uint32_t ultimo_uplink = traza[0].s, silencio_max = 0;
+    long lecturas = 0, uplinks = 0, uplinks_umbral = 0;
+    double cuadrado[TELEMETRIA_NUM_PARAMETROS] = {0};
+    float maximo[TELEMETRIA_NUM_PARAMETROS] = {0};
+    bool fuera_antes = false;
+    uint32_t alerta_desde = 0;
+    bool alerta_pendiente = false;
+    uint32_t latencia_max = 0;
+    int alertas = 0;
+
+    for (int k = 0; k < num; k++)
+    {
+        const telemetria_lectura_t *verdad = &traza[k].lectura;
+        uint32_t s = traza[k].s;
+        bool fuera = comandos_fuera_de_umbral(&config, verdad);
+        if (fuera && !fuera_antes && !alerta_pendiente)
+        {
+            alerta_desde = s;
+            alerta_pendiente = true;
+        }
+        fuera_antes = fuera;
+
+        if (s >= siguiente)
+        {
+            lecturas++;
+            politica_motivo_t motivo = politica_evaluar(&politica, &config, verdad, s, false);
+            if (motivo != POLITICA_SUPRIMIDA)
+            {
+                uplinks++;
+                uplinks_umbral += motivo == POLITICA_UMBRAL;
+                if (s - ultimo_uplink > silencio_max)
+                    silencio_max = s - ultimo_uplink;
+                ultimo_uplink = s;
+                recibida = *verdad;
+                hay_recibida = true;
+                if (alerta_pendiente && comandos_fuera_de_umbral(&config, verdad))
+                {
+                    if (s - alerta_desde > latencia_max)
+                        latencia_max = s - alerta_desde;
+                    alerta_pendiente = false;
+                    alertas++;
+                }
+            }
+            siguiente = s + politica_periodo(&politica, &config);
+        }
+
+        if (!hay_recibida)
+            continue;
+        for (int i = 0; i < TELEMETRIA_NUM_PARAMETROS; i++)
+        {
+            float e = fabsf(telemetria_valor(verdad, (telemetria_parametro_t)i) -
+                            telemetria_valor(&recibida, (telemetria_parametro_t)i));
+            cuadrado[i] += (double)e * e;
+            if (e > maximo[i])
+                maximo[i] = e;
+        }
+    }
+
+    double dias = (traza[num - 1].s - traza[0].s + SIM_PASO_S) / 86400.0;
+    resultado_t r = {(uplinks - uplinks_umbral) / dias * toa_ms(TELEMETRIA_LEN) / 1000.0, latencia_max, alertas > 0 || alerta_pendiente,
+                     alerta_pendiente};
+    printf("%-26s %-22s %8.0f %8.0f %6.1f%% %6lu", traza_nombre, p->nombre, lecturas / dias, uplinks / dias,
+           lecturas_base > 0 ? 100.0 * uplinks / dias / lecturas_base : 0, (unsigned long)silencio_max);
+    for (int i = 0; i < TELEMETRIA_NUM_PARAMETROS; i++)
+    {
+        printf(" %6.3f/%-7.3f", sqrt(cuadrado[i] / num), maximo[i]);
+    }
+    if (alertas > 0 || alerta_pendiente)
+        printf(" %5lu%s\n", (unsigned long)latencia_max, alerta_pendiente ? "+" : "");
+    else
+        printf(" %5s\n", "-");
+    return r;
+}
+
+// Devuelve el numero de comprobaciones que fallan (solo si comprobar)
+static int comparar(const char *nombre, int num, bool comprobar)
+{
+    if (num <= 0)
+        return 0;
+    // lecturas por dia de la primera politica (todas, 10 s), para el % de uplinks
+    double dias = (traza[num - 1].s - traza[0].s + SIM_PASO_S) / 86400.0;
+    double base = (double)(traza[num - 1].s - traza[0].s) / politicas[0].periodo_s / dias;
+    resultado_t r[SIM_NUM_POLITICAS];
+    for (int p = 0; p < SIM_NUM_POLITICAS; p++)
+    {
+        r[p] = simular(p == 0 ? nombre : "", num, &politicas[p], base);
+    }
+    printf("\n");
+    if (!comprobar)
+        return 0;
+
+    int fallos = 0;
+    const resultado_t *a = &r[SIM_POLITICA_ADAPTATIVA];
+    if (a->aire_s_dia > SIM_AIRE_MAX_S_DIA)
+    {
+        printf("FALLO %s: %s usa %.0f s de aire por dia (max %.0f)\n", nombre, politicas[SIM_POLITICA_ADAPTATIVA].nombre,
+               a->aire_s_dia, SIM_AIRE_MAX_S_DIA);
+        fallos++;
+    }
+    if (a->alerta && r[0].alerta && a->latencia_s > r[0].latencia_s + politicas[SIM_POLITICA_ADAPTATIVA].rapido_s)
+    {
+        printf("FALLO %s: alerta en %lu s con %s, %lu s con %s\n", nombre, (unsigned long)a->latencia_s,
+               politicas[SIM_POLITICA_ADAPTATIVA].nombre, (unsigned long)r[0].latencia_s, politicas[0].nombre);
+        fallos++;
+    }
+    for (int p = 0; p < SIM_NUM_POLITICAS; p++)
+    {
+        if (r[p].alerta_pendiente)
+        {
+            printf("FALLO %s: %s deja una alerta sin enviar\n", nombre, politicas[p].nombre);
+            fallos++;
+        }
+    }
+    return fallos;
+}
+
+// genera una traza de 24 h; valor(t) modifica la lectura en el segundo t
+static int sintetica(void (*valor)(float t, telemetria_lectura_t *l))
+{
+    int num = 0;
+    semilla = 12345;
+    for (uint32_t s = 0; s < SIM_DURACION_S && num < SIM_MAX_LECTURAS; s += SIM_PASO_S)
+    {
+        telemetria_lectura_t *l = &traza[num].lectura;
+        memset(l, 0, sizeof(*l));
+        l->origen = 1;
+        // ciclo diario de temperatura y ruido de los sensores
+        l->temperatura = 24.0f + 1.5f * sinf(2 * PI * (float)s / 86400.0f) + ruido(0.03f);
+        l->ec = 1500.0f + ruido(5.0f);
+        l->ph = 7.2f + ruido(0.01f);
+        l->tds = 750.0f + ruido(3.0f);
+        valor((float)s, l);
+        traza[num].s = s;
+        num++;
+    }
+    return num;
+}
+
+static void estable(float t, telemetria_lectura_t *l)
+{
+    (void)t;
+    (void)l;
+}
+
+// EC subiendo toda la jornada (evaporacion): cruza EC_MAX a las 20 h
+static void deriva_ec(float t, telemetria_lectura_t *l)
+{
+    l->ec += 500.0f * t / 72000.0f;
+}
+
+// bajada de pH a 6.2 de 30 min a las 12 h, con rampas de 5 min
+static void excursion_ph(float t, telemetria_lectura_t *l)
+{
+    float d = 0;
+    if (t >= 43200 && t < 43500)
+        d = (t - 43200) / 300.0f;
+    else if (t >= 43500 && t < 45000)
+        d = 1;
+    else if (t >= 45000 && t < 45300)
+        d = 1 - (t - 45000) / 300.0f;
+    l->ph -= 1.0f * d;
+}
+
+// sonda de pH ruidosa: el ruido supera la banda
+static void ph_ruidoso(float t, telemetria_lectura_t *l)
+{
+    (void)t;
+    l->ph = 7.2f + ruido(0.06f);
+}
+
+// ESP-IDF monitor del receptor, como en replay_alertas; solo el primer nodo
+static int leer_log(const char *ruta)
+{
+    FILE *f = fopen(ruta, "r");
+    if (f == NULL)
+    {
+        fprintf(stderr, "No se pudo abrir %s\n", ruta);
+        return -1;
+    }
+    char linea[512];
+    int num = 0;
+    unsigned nodo = 1, primero = 0;
+    while (fgets(linea, sizeof(linea), f) != NULL && num < SIM_MAX_LECTURAS)
+    {
+        unsigned long ms;
+        char *p = strchr(linea, '(');
+        if (p == NULL || sscanf(p, "(%lu)", &ms) != 1)
+            continue;
+        char *q;
+        if ((q = strstr(linea, "Telemetria del nodo ")) != NULL)
+        {
+            sscanf(q, "Telemetria del nodo %u", &nodo);
+        }
+        else if ((q = strstr(linea, "T=")) != NULL && (primero == 0 || nodo == primero))
+        {
+            telemetria_lectura_t *l = &traza[num].lectura;
+            memset(l, 0, sizeof(*l));
+            if (sscanf(q, "T=%f, EC=%f, pH=%f, TDS=%f", &l->temperatura, &l->ec, &l->ph, &l->tds) == 4)
+            {
+                primero = nodo;
+                l->origen = (uint8_t)nodo;
+                traza[num].s = (uint32_t)(ms / 1000);
+                num++;
+            }
+        }
+    }
+    fclose(f);
+    return num;
+}
+
+int main(int argc, char **argv)
+{
+    printf("Politica de envio: error de reconstruccion RMS/max por parametro con el ultimo valor recibido\n\n");
+    printf("%-26s %-22s %8s %8s %7s %6s", "traza", "politica", "lect/dia", "upl/dia", "upl", "sil s");
+    for (int i = 0; i < TELEMETRIA_NUM_PARAMETROS; i++)
+    {
+        printf(" %14s", parametros[i]);
+    }
+    printf(" %6s\n", "alerta");
+
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            int num = leer_log(argv[i]);
+            if (num < 0)
+                return EXIT_FAILURE;
+            comparar(argv[i], num, false);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    int fallos = 0;
+    fallos += comparar("estable", sintetica(estable), true);
+    fallos += comparar("deriva de EC", sintetica(deriva_ec), true);
+    fallos += comparar("excursion de pH, 30 min", sintetica(excursion_ph), true);
+    fallos += comparar("pH ruidoso", sintetica(ph_ruidoso), true);
+    printf("%s: aire de %s max %.0f s/dia (%.0f ms por uplink)\n", fallos == 0 ? "OK" : "FALLO",
+           politicas[SIM_POLITICA_ADAPTATIVA].nombre, SIM_AIRE_MAX_S_DIA, toa_ms(TELEMETRIA_LEN));
+    return fallos == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,505 @@
+/*
+  Simulador de reconfiguracion de una flota de nodos
+
+  Mide cuanto tarda un cambio de configuracion (comando PERIODO) en aplicarse en todos los nodos, usando la
+  misma cola de downlinks (downlink.c) y el mismo codec de comandos (comandos.c) que el receptor y el transmisor.
+
+  Modelo, con los parametros de radio del firmware (SF12, 125 kHz, CR 4/5, CRC, preambulo de 8 simbolos):
+  - Dos canales: telemetria (cabecera implicita, solo uplinks) y control (cabecera explicita: downlinks y ACKs).
+    Dos transmisiones que se solapan en el mismo canal se pierden las dos (sin efecto captura). Ademas cada
+    paquete se pierde con una probabilidad fija.
+  - El receptor tiene una radio por canal. La de control es half duplex y tiene un solo hueco de transmision
+    (gateway_enviar): si esta ocupada, la ventana de un nodo clase A se pierde sin gastar un intento.
+  - Clase A: el nodo escucha solo en la ventana COMANDOS_RX_RETARDO_MS +- COMANDOS_RX_MARGEN_MS despues de cada
+    uplink con TELEMETRIA_FLAG_VENTANA y de cada ACK. Clase C: escucha el canal de control mientras no transmite,
+    y el receptor revisa la cola de clase C cada segundo.
+  - Cada nodo hace un uplink de telemetria por periodo, con una fase aleatoria y un retardo aleatorio de hasta el
+    5% del periodo en cada uplink.
+
+  Uso: sim_reconfiguracion [semillas]. Sale con error si algun nodo no aplica el comando o falta algun ACK.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "telemetria.h"
+#include "comandos.h"
+#include "downlink.h"
+
+#define SIM_MAX_NODOS 128
+#define SIM_MAX_TX 512
+#define SIM_FIN_MS (12UL * 3600UL * 1000UL)
+#define SIM_T0_MS 10000 // momento en que se programa el comando
+#define SIM_POLL_CLASE_C_MS 1000
+#define SIM_PROCESO_MS 50 // del fin de un downlink al inicio del ACK (aplicar, cambiar de modo)
+#define SIM_NUEVO_PERIODO_S 900
+#define SIM_DISPERSION_PCT 5
+
+#define CANAL_TELEMETRIA 0
+#define CANAL_CONTROL 1
+#define GATEWAY -1
+#define NUNCA UINT32_MAX
+
+typedef struct
+{
+    bool activa;
+    bool entregada;
+    int canal;
+    int emisor;
+    uint32_t inicio;
+    uint32_t fin;
+    uint8_t len;
+    uint8_t trama[COMANDOS_MAX_LEN];
+} transmision_t;
+
+typedef struct
+{
+    uint8_t direccion;
+    uint8_t clase;
+    comandos_config_t config;
+    uint16_t secuencia;
+    uint32_t proximo_uplink;
+    uint32_t tx_desde;
+    uint32_t tx_hasta;
+    uint32_t ventana_desde; // clase A: un downlink que empiece en [desde, hasta] se recibe
+    uint32_t ventana_hasta;
+    uint32_t ack_en;
+    uint8_t ack[COMANDOS_ACK_LEN];
+    uint32_t aplicado_ms;
+} nodo_t;
+
+typedef struct
+{
+    const char *nombre;
+    int num_nodos;
+    int pct_clase_c;
+    uint16_t periodo_s;
+    int perdida_pct;
+    bool multicast;
+} escenario_t;
+
+typedef struct
+{
+    double p50_s;
+    double p95_s;
+    double max_s;
+    double confirmado_s; // hasta que el receptor tiene todos los ACK
+    double downlinks;
+    double aire_s;
+    int sin_aplicar;
+} resultado_t;
+
+static transmision_t tx[SIM_MAX_TX];
+static nodo_t nodos[SIM_MAX_NODOS];
+static int num_nodos;
+static downlink_t dl;
+static uint32_t semilla;
+static int perdida_pct;
+
+// hueco de transmision de la radio de control del receptor
+static bool gw_pendiente;
+static uint32_t gw_en;
+static uint8_t gw_trama[COMANDOS_MAX_LEN];
+static uint8_t gw_len;
+static uint32_t gw_tx_hasta;
+static uint64_t gw_aire_us;
+
+static uint32_t aleatorio(void)
+{
+    // xorshift32
+    semilla ^= semilla << 13;
+    semilla ^= semilla >> 17;
+    semilla ^= semilla << 5;
+    return semilla;
+}
+
+static bool perdido(void)
+{
+    return (int)(aleatorio() % 100) < perdida_pct;
+}
+
+// Tiempo en el aire a SF12, 125 kHz, CR 4/5, CRC, LDRO y preambulo de 8 simbolos (AN1200.13)
+static uint32_t toa_ms(uint8_t len, bool implicito)
+{
+    int32_t num = 8 * len - 4 * 12 + 28 + 16 - (implicito ? 20 : 0);
+    int32_t den = 4 * (12 - 2);
+    uint32_t simbolos = 8 + (num > 0 ? (uint32_t)((num + den - 1) / den) * 5 : 0);
+    uint64_t cuartos = 4 * 8 + 17 + 4 * (uint64_t)simbolos;
+    return (uint32_t)((cuartos * 1000ULL << 12) / (4 * 125000ULL));
+}
+
+static transmision_t *transmitir(int canal, int emisor, const uint8_t *trama, uint8_t len, uint32_t ahora)
+{
+    for (int i = 0; i < SIM_MAX_TX; i++)
+    {
+        if (!tx[i].activa)
+        {
+            transmision_t *t = &tx[i];
+            t->activa = true;
+            t->entregada = false;
+            t->canal = canal;
+            t->emisor = emisor;
+            t->inicio = ahora;
+            t->fin = ahora + toa_ms(len, canal == CANAL_TELEMETRIA);
+            t->len = len;
+            memcpy(t->trama, trama, len);
+            if (emisor == GATEWAY)
+            {
+                gw_tx_hasta = t->fin;
+                gw_aire_us += (uint64_t)(t->fin - t->inicio) * 1000;
+            }
+            else
+            {
+                nodos[emisor].tx_desde = ahora;
+                nodos[emisor].tx_hasta = t->fin;
+            }
+            return t;
+        }
+    }
+    fprintf(stderr, "Demasiadas transmisiones simultaneas\n");
+    exit(EXIT_FAILURE);
+}
+
+static bool colision(const transmision_t *t)
+{
+    for (int i = 0; i < SIM_MAX_TX; i++)
+    {
+        const transmision_t *o = &tx[i];
+        if (o != t && o->activa && o->canal == t->canal && o->inicio < t->fin && o->fin > t->inicio)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool gw_libre(uint32_t ahora)
+{
+    return !gw_pendiente && gw_tx_hasta <= ahora;
+}
+
+// el receptor responde en la ventana de un nodo, como gateway_loop en el firmware
+static void ventana_del_nodo(uint8_t direccion, uint32_t fin)
+{
+    if (!gw_libre(fin))
+    {
+        return;
+    }
+    uint8_t len = (uint8_t)downlink_para_uplink(&dl, direccion, fin, gw_trama);
+    if (len > 0)
+    {
+        gw_pendiente = true;
+        gw_en = fin + COMANDOS_RX_RETARDO_MS;
+        gw_len = len;
+    }
+}
+
+static void abrir_ventana(nodo_t *n, uint32_t fin)
+{
+    n->ventana_desde = fin + COMANDOS_RX_RETARDO_MS - COMANDOS_RX_MARGEN_MS;
+    n->ventana_hasta = fin + COMANDOS_RX_RETARDO_MS + COMANDOS_RX_MARGEN_MS;
+}
+
+static void entregar(transmision_t *t)
+{
+    bool choque = colision(t);
+    t->entregada = true;
+
+    if (t->emisor != GATEWAY)
+    {
+        nodo_t *n = &nodos[t->emisor];
+        if (n->clase == TELEMETRIA_CLASE_A && (t->canal == CANAL_CONTROL || (t->trama[0] & TELEMETRIA_FLAG_VENTANA)))
+        {
+            abrir_ventana(n, t->fin);
+        }
+        if (choque || perdido())
+        {
+            return;
+        }
+        if (t->canal == CANAL_TELEMETRIA)
+        {
+            telemetria_lectura_t lectura;
+            if (telemetria_decodificar(t->trama, t->len, &lectura) && lectura.ventana)
+            {
+                ventana_del_nodo(lectura.origen, t->fin);
+            }
+            return;
+        }
+        uint8_t origen, id;
+        comandos_resultado_t resultado;
+        if (comandos_decodificar_ack(t->trama, t->len, &origen, &id, &resultado))
+        {
+            downlink_ack(&dl, origen, id);
+            ventana_del_nodo(origen, t->fin);
+        }
+        return;
+    }
+
+    // downlink del receptor
+    for (int i = 0; i < num_nodos; i++)
+    {
+        nodo_t *n = &nodos[i];
+        bool transmitiendo = n->tx_desde < t->fin && n->tx_hasta > t->inicio;
+        bool escuchando = n->clase == TELEMETRIA_CLASE_C || (t->inicio >= n->ventana_desde && t->inicio <= n->ventana_hasta);
+        if (choque || transmitiendo || !escuchando || perdido())
+        {
+            continue;
+        }
+        uint8_t id = 0;
+        comandos_resultado_t r = comandos_aplicar(t->trama, t->len, n->direccion, &n->config, &id);
+        if (r == COMANDOS_APLICADO && n->aplicado_ms == NUNCA)
+        {
+            n->aplicado_ms = t->fin;
+        }
+        if (r == COMANDOS_APLICADO || r == COMANDOS_DUPLICADO)
+        {
+            comandos_codificar_ack(n->direccion, id, r, n->ack);
+            n->ack_en = t->fin + SIM_PROCESO_MS;
+            if (n->clase == TELEMETRIA_CLASE_C)
+            {
+                n->ack_en += aleatorio() % COMANDOS_ACK_DISPERSION_MS;
+            }
+        }
+    }
+}
+
+static void enviar_uplink(nodo_t *n, int indice, uint32_t ahora)
+{
+    telemetria_lectura_t lectura = {
+        .origen = n->direccion,
+        .ventana = true,
+        .secuencia = n->secuencia++,
+        .temperatura = 20.0f,
+        .ec = 1500.0f,
+        .ph = 7.0f,
+        .tds = 300.0f};
+    uint8_t trama[TELEMETRIA_LEN];
+    telemetria_codificar(&lectura, trama);
+    transmitir(CANAL_TELEMETRIA, indice, trama, TELEMETRIA_LEN, ahora);
+    // el transmisor reparte cada periodo con un azar de hasta SIM_DISPERSION_PCT, si no dos nodos que chocan una
+    // vez chocarian siempre
+    uint32_t periodo_ms = (uint32_t)n->config.periodo_s * n->config.lote * 1000;
+    n->proximo_uplink = ahora + periodo_ms + aleatorio() % (periodo_ms * SIM_DISPERSION_PCT / 100 + 1);
+}
+
+static int comparar(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static resultado_t simular(const escenario_t *e, uint32_t s)
+{
+    semilla = s;
+    perdida_pct = e->perdida_pct;
+    num_nodos = e->num_nodos;
+    memset(tx, 0, sizeof(tx));
+    downlink_iniciar(&dl);
+    gw_pendiente = false;
+    gw_tx_hasta = 0;
+    gw_aire_us = 0;
+
+    for (int i = 0; i < num_nodos; i++)
+    {
+        nodo_t *n = &nodos[i];
+        memset(n, 0, sizeof(*n));
+        n->direccion = (uint8_t)(i + 1);
+        n->clase = (i * 100 < e->pct_clase_c * num_nodos) ? TELEMETRIA_CLASE_C : TELEMETRIA_CLASE_A;
+        comandos_config_defecto(&n->config, e->periodo_s);
+        n->proximo_uplink = aleatorio() % ((uint32_t)e->periodo_s * 1000);
+        n->ack_en = NUNCA;
+        n->aplicado_ms = NUNCA;
+        // el anuncio de formato ya se recibio
+        downlink_registrar(&dl, n->direccion, n->clase);
+    }
+
+    bool programado = false;
+    uint32_t confirmado = NUNCA;
+    uint32_t ahora = 0;
+    while (ahora < SIM_FIN_MS)
+    {
+        if (!programado && ahora >= SIM_T0_MS)
+        {
+            comando_t c = {.tipo = COMANDO_PERIODO, .valor.periodo_s = SIM_NUEVO_PERIODO_S};
+            if (e->multicast)
+            {
+                downlink_programar(&dl, COMANDOS_DIFUSION, &c, 1, NULL);
+            }
+            else
+            {
+                for (int i = 0; i < num_nodos; i++)
+                {
+                    downlink_programar(&dl, nodos[i].direccion, &c, 1, NULL);
+                }
+            }
+            programado = true;
+        }
+
+        // fin de transmisiones; se liberan las que ya no pueden solaparse con ninguna activa
+        for (int i = 0; i < SIM_MAX_TX; i++)
+        {
+            if (tx[i].activa && !tx[i].entregada && tx[i].fin == ahora)
+            {
+                entregar(&tx[i]);
+            }
+            if (tx[i].activa && tx[i].entregada && tx[i].fin + 10000 < ahora)
+            {
+                tx[i].activa = false;
+            }
+        }
+
+        if (gw_pendiente && gw_en == ahora)
+        {
+            gw_pendiente = false;
+            transmitir(CANAL_CONTROL, GATEWAY, gw_trama, gw_len, ahora);
+        }
+        if (ahora % SIM_POLL_CLASE_C_MS == 0 && gw_libre(ahora))
+        {
+            uint8_t trama[COMANDOS_MAX_LEN];
+            uint8_t len = (uint8_t)downlink_para_clase_c(&dl, ahora, trama);
+            if (len > 0)
+            {
+                transmitir(CANAL_CONTROL, GATEWAY, trama, len, ahora);
+            }
+        }
+
+        for (int i = 0; i < num_nodos; i++)
+        {
+            nodo_t *n = &nodos[i];
+            bool ocupado = n->tx_hasta > ahora;
+            if (n->ack_en == ahora)
+            {
+                if (ocupado)
+                {
+                    n->ack_en = n->tx_hasta;
+                }
+                else
+                {
+                    transmitir(CANAL_CONTROL, i, n->ack, COMANDOS_ACK_LEN, ahora);
+                    n->ack_en = NUNCA;
+                    ocupado = true;
+                }
+            }
+            if (n->proximo_uplink == ahora)
+            {
+                if (ocupado)
+                {
+                    n->proximo_uplink = n->tx_hasta;
+                }
+                else
+                {
+                    enviar_uplink(n, i, ahora);
+                }
+            }
+        }
+
+        if (programado && confirmado == NUNCA && downlink_pendientes(&dl, COMANDOS_DIFUSION) == 0)
+        {
+            confirmado = ahora;
+            break;
+        }
+
+        // salta al siguiente evento
+        uint32_t siguiente = SIM_FIN_MS;
+        if (!programado && SIM_T0_MS < siguiente)
+            siguiente = SIM_T0_MS;
+        uint32_t poll = (ahora / SIM_POLL_CLASE_C_MS + 1) * SIM_POLL_CLASE_C_MS;
+        if (poll < siguiente)
+            siguiente = poll;
+        if (gw_pendiente && gw_en > ahora && gw_en < siguiente)
+            siguiente = gw_en;
+        for (int i = 0; i < SIM_MAX_TX; i++)
+        {
+            if (tx[i].activa && !tx[i].entregada && tx[i].fin > ahora && tx[i].fin < siguiente)
+                siguiente = tx[i].fin;
+        }
+        for (int i = 0; i < num_nodos; i++)
+        {
+            if (nodos[i].ack_en > ahora && nodos[i].ack_en < siguiente)
+                siguiente = nodos[i].ack_en;
+            if (nodos[i].proximo_uplink > ahora && nodos[i].proximo_uplink < siguiente)
+                siguiente = nodos[i].proximo_uplink;
+        }
+        ahora = siguiente;
+    }
+
+    resultado_t r = {0};
+    uint32_t tiempos[SIM_MAX_NODOS];
+    int aplicados = 0;
+    for (int i = 0; i < num_nodos; i++)
+    {
+        if (nodos[i].aplicado_ms != NUNCA)
+            tiempos[aplicados++] = nodos[i].aplicado_ms - SIM_T0_MS;
+    }
+    r.sin_aplicar = num_nodos - aplicados;
+    if (aplicados > 0)
+    {
+        qsort(tiempos, aplicados, sizeof(uint32_t), comparar);
+        r.p50_s = tiempos[aplicados / 2] / 1000.0;
+        r.p95_s = tiempos[(aplicados * 95) / 100 < aplicados ? (aplicados * 95) / 100 : aplicados - 1] / 1000.0;
+        r.max_s = tiempos[aplicados - 1] / 1000.0;
+    }
+    r.confirmado_s = confirmado == NUNCA ? -1.0 : (confirmado - SIM_T0_MS) / 1000.0;
+    r.downlinks = dl.enviados;
+    r.aire_s = gw_aire_us / 1e6;
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    int semillas = argc > 1 ? atoi(argv[1]) : 20;
+    if (semillas <= 0)
+    {
+        fprintf(stderr, "Uso: %s [semillas]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    static const escenario_t escenarios[] = {
+        {"16 clase A, uplink 60 s", 16, 0, 60, 0, true},
+        {"16 clase A, uplink 60 s, 10% perdidas", 16, 0, 60, 10, true},
+        {"16 clase C, multicast, 10% perdidas", 16, 100, 60, 10, true},
+        {"16 clase C, unicast, 10% perdidas", 16, 100, 60, 10, false},
+        {"100 clase A, uplink 300 s, 10% perdidas", 100, 0, 300, 10, true},
+        {"100 mixtos (50% C), uplink 300 s, 10% perdidas", 100, 50, 300, 10, true},
+        {"100 clase C, multicast, 10% perdidas", 100, 100, 300, 10, true},
+    };
+
+    printf("Comando PERIODO a toda la flota, media de %d semillas. Tiempos desde que se programa el comando.\n", semillas);
+    int fallos = 0;
+    printf("%-48s %8s %8s %8s %12s %10s %10s %6s\n", "escenario", "p50 s", "p95 s", "max s", "confirmado s", "downlinks", "aire s", "fallos");
+    for (size_t i = 0; i < sizeof(escenarios) / sizeof(escenarios[0]); i++)
+    {
+        resultado_t media = {0};
+        int sin_confirmar = 0;
+        for (int s = 0; s < semillas; s++)
+        {
+            resultado_t r = simular(&escenarios[i], 0x9E3779B9u + (uint32_t)s * 7919u);
+            media.p50_s += r.p50_s / semillas;
+            media.p95_s += r.p95_s / semillas;
+            media.max_s += r.max_s / semillas;
+            media.downlinks += r.downlinks / semillas;
+            media.aire_s += r.aire_s / semillas;
+            media.sin_aplicar += r.sin_aplicar;
+            if (r.confirmado_s < 0)
+                sin_confirmar++;
+            else
+                media.confirmado_s += r.confirmado_s;
+        }
+        if (semillas > sin_confirmar)
+            media.confirmado_s /= (semillas - sin_confirmar);
+        printf("%-48s %8.1f %8.1f %8.1f %12.1f %10.1f %10.1f %6d\n", escenarios[i].nombre, media.p50_s, media.p95_s,
+               media.max_s, media.confirmado_s, media.downlinks, media.aire_s, media.sin_aplicar + sin_confirmar);
+        fallos += media.sin_aplicar + sin_confirmar;
+    }
+    printf("fallos: nodos que no aplicaron el comando mas simulaciones sin todos los ACK (descartes tras %d intentos)\n",
+           DOWNLINK_MAX_INTENTOS);
+    if (fallos > 0)
+    {
+        printf("FALLO: %d comandos descartados o sin confirmar\n", fallos);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,342 @@
+/*
+  Simulador de la conexion WiFi del receptor: reintentos y ahorro de energia del modem (conexion.c)
+
+  Compara dos politicas en pasos de 10 ms durante 24 h:
+   - antes: lo que hacia wifi_event_handler, esp_wifi_connect en cuanto llega WIFI_EVENT_STA_DISCONNECTED, y el
+     ahorro por defecto de ESP-IDF (WIFI_PS_MIN_MODEM) siempre
+   - conexion: la espera exponencial con jitter de conexion_caida y WIFI_PS_MIN_MODEM solo mientras hay subidas
+     (CONEXION_ACTIVO_MS), WIFI_PS_MAX_MODEM entre ellas
+  con un AP que se comporta segun el escenario (estable, cortes cortos, una caida de 1 h, encendido y apagado
+  cada 2 min) y subidas a la nube a varios ritmos: una por lectura de 16 nodos cada 10 s (Blynk), una cada 2 s
+  y una cada 7.5 s (lotes de MQTT).
+
+  La estacion: un intento con el AP arriba da IP en 1.2-2.5 s; sin AP falla tras SIM_FALLO_MS de escaneo. Con
+  IP, si el AP desaparece la caida se detecta tras SIM_BEACON_MS sin beacons; un corte mas corto no se nota.
+
+  Corrientes del ESP32 (mA): valores tipicos de hoja de datos y de medidas publicadas, no medidos en este
+  receptor. La CPU sigue despierta en los dos casos (la tarea que recibe LoRa no duerme), asi que solo cambia
+  la radio. Hay que calibrarlas con un medidor en la placa; los resultados relativos no dependen mucho de ellas.
+
+  Da la corriente media, intentos por hora, % del tiempo con IP, tiempo medio hasta IP de un intento, la
+  latencia de reconexion (desde que se detecta la caida y desde que vuelve el AP hasta tener IP, p50 y p99) y
+  el % del tiempo en WIFI_PS_MAX_MODEM.
+
+  Falla (sale con error) si, en algun escenario y ritmo de subidas, la politica conexion:
+   - consume mas corriente media que antes
+   - hace mas intentos fallidos por hora que antes, o no menos cuando antes tiene alguno
+   - pasa mas de SIM_IP_MARGEN_PCT puntos menos de tiempo con IP que antes (salvo con el AP encendiendo y
+     apagando, donde la espera cuesta IP a proposito: ahi se limita el p99 tras volver el AP)
+   - tarda mas de SIM_TRAS_AP_MAX_MS en tener IP desde que vuelve el AP (p99): la espera maxima, un escaneo
+     fallido y un intento con AP
+   - pasa menos del SIM_MAX_MIN_PCT % del tiempo en WIFI_PS_MAX_MODEM al ritmo de subidas mas bajo con un AP
+     que no se cae cada 2 min
+
+  Uso: sim_wifi [horas]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "conexion.h"
+
+#define SIM_PASO_MS 10u
+#define SIM_HORAS 24u
+#define SIM_FALLO_MS 2500u
+#define SIM_BEACON_MS 6000u
+#define SIM_IP_MIN_MS 1200u
+#define SIM_IP_MAX_MS 2500u
+#define SIM_ESPERA_MIN_MS 1000u // RED_ESPERA_MIN_MS
+#define SIM_ESPERA_MAX_MS 30000u // RED_ESPERA_MAX_MS
+#define SIM_TX_MS 30u
+#define SIM_MAX_MUESTRAS 20000
+
+// umbrales de la politica conexion frente a antes
+#define SIM_IP_MARGEN_PCT 0.5
+#define SIM_TRAS_AP_MAX_MS (SIM_ESPERA_MAX_MS + SIM_FALLO_MS + SIM_IP_MAX_MS)
+#define SIM_MAX_MIN_PCT 50.0
+
+// corrientes en mA
+#define SIM_CPU_MA 40.0
+#define SIM_CONECTANDO_MA 80.0 // escaneo y asociacion, RX casi todo el tiempo
+#define SIM_ESPERA_MA 20.0     // sin asociar ni escanear
+#define SIM_PS_MIN_MA 15.0     // despierta en cada DTIM (DTIM 1)
+#define SIM_PS_MAX_MA 4.0      // despierta cada listen interval (10)
+#define SIM_TX_MA 100.0        // encima de lo anterior mientras sube
+
+typedef enum
+{
+    SIM_ESTABLE = 0,
+    SIM_CORTES,
+    SIM_CAIDA,
+    SIM_INESTABLE,
+    SIM_NUM_ESCENARIOS
+} sim_escenario_t;
+
+static const char *const nombres[SIM_NUM_ESCENARIOS] = {"estable", "cortes 10 s/5 min", "caida de 1 h",
+                                                       "2 min si/2 min no"};
+
+typedef enum
+{
+    SIM_ESPERANDO,
+    SIM_INTENTANDO,
+    SIM_CON_IP
+} sim_estado_t;
+
+typedef struct
+{
+    double media_ma;
+    double intentos_h;
+    double fallidos_h; // intentos sin IP
+    double con_ip;
+    double hasta_ip_ms;
+    uint32_t reconexion_p50;
+    uint32_t reconexion_p99;
+    uint32_t ap_p50;
+    uint32_t ap_p99;
+    double ahorro_max;
+    uint32_t sin_red; // subidas sin IP
+} sim_resultado_t;
+
+static uint32_t semilla = 12345;
+static uint32_t reconexiones[SIM_MAX_MUESTRAS];
+static uint32_t desde_ap[SIM_MAX_MUESTRAS];
+
+static uint32_t aleatorio(uint32_t n)
+{
+    semilla = semilla * 1103515245u + 12345u;
+    return (semilla >> 8) % n;
+}
+
+static int comparar(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint32_t percentil(uint32_t *v, int n, int p)
+{
+    if (n == 0)
+        return 0;
+    qsort(v, (size_t)n, sizeof(v[0]), comparar);
+    return v[(n - 1) * p / 100];
+}
+
+static bool ap_arriba(sim_escenario_t escenario, uint32_t t)
+{
+    switch (escenario)
+    {
+    case SIM_CORTES:
+        return t % 300000u >= 10000u;
+    case SIM_CAIDA:
+        return t < 6u * 3600000u || t >= 7u * 3600000u;
+    case SIM_INESTABLE:
+        return t % 240000u < 120000u;
+    default:
+        return true;
+    }
+}
+
+static sim_resultado_t simular(sim_escenario_t escenario, bool backoff, uint32_t periodo_ms, uint32_t duracion_ms)
+{
+    conexion_t c;
+    conexion_iniciar(&c, SIM_ESPERA_MIN_MS, SIM_ESPERA_MAX_MS, 0x5eed1234u, 0);
+    sim_estado_t estado = SIM_ESPERANDO;
+    uint32_t fin_ms = 0;     // del intento o la espera en curso
+    uint32_t sin_beacon = 0; // desde cuando no se ve el AP con IP, 0 si se ve
+    uint32_t ap_volvio = 0;
+    bool ap_antes = true;
+    bool perdio_ip = false; // se perdio la IP en este corte del AP
+    uint32_t subida = periodo_ms;
+    uint32_t tx_hasta = 0;
+    double carga = 0;
+    uint32_t con_ip = 0, en_max = 0;
+    int num_reconexiones = 0, num_ap = 0;
+    sim_resultado_t r = {0};
+
+    for (uint32_t t = 0; t < duracion_ms; t += SIM_PASO_MS)
+    {
+        bool ap = ap_arriba(escenario, t);
+        if (ap && !ap_antes)
+            ap_volvio = t;
+        ap_antes = ap;
+
+        if (estado == SIM_ESPERANDO && t >= fin_ms)
+        {
+            conexion_intento(&c, t);
+            estado = SIM_INTENTANDO;
+            fin_ms = t + (ap ? SIM_IP_MIN_MS + aleatorio(SIM_IP_MAX_MS - SIM_IP_MIN_MS + 1) : SIM_FALLO_MS);
+        }
+        else if (estado == SIM_INTENTANDO && t >= fin_ms)
+        {
+            if (ap && ap_arriba(escenario, c.intento_ms))
+            {
+                conexion_ip(&c, t);
+                estado = SIM_CON_IP;
+                sin_beacon = 0;
+                if (num_reconexiones < SIM_MAX_MUESTRAS && c.conexiones > 1)
+                    reconexiones[num_reconexiones++] = c.reconexion_ms;
+                if (perdio_ip && num_ap < SIM_MAX_MUESTRAS)
+                    desde_ap[num_ap++] = t - ap_volvio;
+                perdio_ip = false;
+            }
+            else
+            {
+                uint32_t espera = conexion_caida(&c, t);
+                estado = SIM_ESPERANDO;
+                fin_ms = t + (backoff ? espera : 0);
+            }
+        }
+        else if (estado == SIM_CON_IP)
+        {
+            if (ap)
+            {
+                sin_beacon = 0;
+            }
+            else
+            {
+                if (sin_beacon == 0)
+                    sin_beacon = t;
+                if (t - sin_beacon >= SIM_BEACON_MS)
+                {
+                    uint32_t espera = conexion_caida(&c, t);
+                    estado = SIM_ESPERANDO;
+                    fin_ms = t + (backoff ? espera : 0);
+                    perdio_ip = true;
+                }
+            }
+        }
+
+        if (t >= subida)
+        {
+            if (estado == SIM_CON_IP && ap)
+            {
+                conexion_actividad(&c, t);
+                tx_hasta = t + SIM_TX_MS;
+            }
+            else
+            {
+                r.sin_red++;
+            }
+            subida += periodo_ms;
+        }
+
+        double ma = SIM_CPU_MA;
+        if (estado == SIM_INTENTANDO)
+        {
+            ma += SIM_CONECTANDO_MA;
+        }
+        else if (estado == SIM_ESPERANDO)
+        {
+            ma += SIM_ESPERA_MA;
+        }
+        else
+        {
+            con_ip++;
+            conexion_ahorro_t ahorro = backoff ? conexion_ahorro(&c, t) : CONEXION_AHORRO_MIN;
+            if (ahorro == CONEXION_AHORRO_MAX)
+            {
+                ma += SIM_PS_MAX_MA;
+                en_max++;
+            }
+            else
+            {
+                ma += SIM_PS_MIN_MA;
+            }
+        }
+        if (t < tx_hasta)
+            ma += SIM_TX_MA;
+        carga += ma;
+    }
+
+    uint32_t pasos = duracion_ms / SIM_PASO_MS;
+    r.media_ma = carga / pasos;
+    r.intentos_h = c.intentos * 3600000.0 / duracion_ms;
+    r.fallidos_h = (c.intentos - c.conexiones) * 3600000.0 / duracion_ms;
+    r.con_ip = 100.0 * con_ip / pasos;
+    r.hasta_ip_ms = c.conexiones > 0 ? (double)c.suma_hasta_ip_ms / c.conexiones : 0;
+    r.reconexion_p50 = percentil(reconexiones, num_reconexiones, 50);
+    r.reconexion_p99 = percentil(reconexiones, num_reconexiones, 99);
+    r.ap_p50 = percentil(desde_ap, num_ap, 50);
+    r.ap_p99 = percentil(desde_ap, num_ap, 99);
+    r.ahorro_max = 100.0 * en_max / pasos;
+    return r;
+}
+
+// fallos de la politica conexion (n) frente a antes (a) en un escenario y ritmo de subidas
+static int comprobar(sim_escenario_t escenario, uint32_t periodo_ms, bool ritmo_bajo, const sim_resultado_t *a,
+                     const sim_resultado_t *n)
+{
+    int fallos = 0;
+    double sub_s = 1000.0 / periodo_ms;
+    if (n->media_ma > a->media_ma)
+    {
+        printf("FALLO %s, %.2f sub/s: %.2f mA con conexion, %.2f mA antes\n", nombres[escenario], sub_s, n->media_ma,
+               a->media_ma);
+        fallos++;
+    }
+    if (a->fallidos_h > 0 ? n->fallidos_h >= a->fallidos_h : n->fallidos_h > 0)
+    {
+        printf("FALLO %s, %.2f sub/s: %.1f intentos fallidos/h con conexion, %.1f antes\n", nombres[escenario], sub_s,
+               n->fallidos_h, a->fallidos_h);
+        fallos++;
+    }
+    if (escenario != SIM_INESTABLE && n->con_ip < a->con_ip - SIM_IP_MARGEN_PCT)
+    {
+        printf("FALLO %s, %.2f sub/s: %.2f %% con IP con conexion, %.2f %% antes (margen %.1f)\n", nombres[escenario],
+               sub_s, n->con_ip, a->con_ip, SIM_IP_MARGEN_PCT);
+        fallos++;
+    }
+    if (n->ap_p99 > SIM_TRAS_AP_MAX_MS)
+    {
+        printf("FALLO %s, %.2f sub/s: IP %.1f s tras volver el AP (p99, max %.1f)\n", nombres[escenario], sub_s,
+               n->ap_p99 / 1000.0, SIM_TRAS_AP_MAX_MS / 1000.0);
+        fallos++;
+    }
+    if (ritmo_bajo && escenario != SIM_INESTABLE && n->ahorro_max < SIM_MAX_MIN_PCT)
+    {
+        printf("FALLO %s, %.2f sub/s: %.1f %% del tiempo en WIFI_PS_MAX_MODEM (min %.0f)\n", nombres[escenario],
+               sub_s, n->ahorro_max, SIM_MAX_MIN_PCT);
+        fallos++;
+    }
+    return fallos;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t horas = argc > 1 ? (uint32_t)atoi(argv[1]) : SIM_HORAS;
+    if (horas == 0)
+        horas = 1;
+    static const uint32_t periodos[] = {625, 2000, 7500};
+    size_t num_periodos = sizeof(periodos) / sizeof(periodos[0]);
+    uint32_t duracion = horas * 3600000u;
+    int fallos = 0;
+
+    printf("WiFi del receptor, %u h, espera %u-%u ms, corrientes estimadas (ver cabecera)\n\n", horas,
+           SIM_ESPERA_MIN_MS, SIM_ESPERA_MAX_MS);
+    printf("%-18s %-9s %6s %7s %9s %6s %8s %15s %15s %6s %7s\n", "escenario", "politica", "sub/s", "mA", "intent/h",
+           "%IP", "IP ms", "reconex p50/p99", "tras AP p50/p99", "%MAX", "sin red");
+    for (int e = 0; e < SIM_NUM_ESCENARIOS; e++)
+    {
+        for (size_t p = 0; p < num_periodos; p++)
+        {
+            sim_resultado_t resultados[2];
+            for (int b = 0; b < 2; b++)
+            {
+                semilla = 12345;
+                sim_resultado_t r = simular((sim_escenario_t)e, b, periodos[p], duracion);
+                resultados[b] = r;
+                printf("%-18s %-9s %6.2f %7.2f %9.1f %6.2f %8.0f %7.1f/%-7.1f %7.1f/%-7.1f %6.1f %7lu\n",
+                       p == 0 && b == 0 ? nombres[e] : "", b ? "conexion" : "antes", 1000.0 / periodos[p],
+                       r.media_ma, r.intentos_h, r.con_ip, r.hasta_ip_ms, r.reconexion_p50 / 1000.0,
+                       r.reconexion_p99 / 1000.0, r.ap_p50 / 1000.0, r.ap_p99 / 1000.0, r.ahorro_max,
+                       (unsigned long)r.sin_red);
+            }
+            fallos += comprobar((sim_escenario_t)e, periodos[p], p == num_periodos - 1, &resultados[0], &resultados[1]);
+        }
+    }
+    printf("\n%s: conexion frente a antes, IP -%.1f puntos, tras AP p99 max %.1f s, WIFI_PS_MAX_MODEM min %.0f %%\n",
+           fallos == 0 ? "OK" : "FALLO", SIM_IP_MARGEN_PCT, SIM_TRAS_AP_MAX_MS / 1000.0, SIM_MAX_MIN_PCT);
+    return fallos == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,281 @@
+#include <string.h>
+#include "compresion.h"
+#include "subida.h"
+
+#define VALORES (TELEMETRIA_NUM_PARAMETROS + 1) // y la secuencia
+
+static subida_entrada_t *entrada(subida_t *subida, int i)
+{
+    return &subida->entradas[(subida->primero + i) % SUBIDA_PENDIENTES];
+}
+
+static uint8_t nodo_de(const subida_entrada_t *e)
+{
+    return e->lectura.origen & TELEMETRIA_MAX_ORIGEN;
+}
+
+static void escribir_u32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+// Saca del principio las lecturas ya confirmadas
+static void avanzar(subida_t *subida)
+{
+    while (subida->num > 0 && entrada(subida, 0)->confirmada)
+    {
+        subida->primero = (subida->primero + 1) % SUBIDA_PENDIENTES;
+        subida->num--;
+    }
+}
+
+static int hueco_de(const subida_t *subida, int id)
+{
+    for (int h = 0; h < SUBIDA_VENTANA; h++)
+    {
+        if (subida->ventana[h].usado && subida->ventana[h].id == id)
+        {
+            return h;
+        }
+    }
+    return -1;
+}
+
+// Cierra el mensaje del hueco: sus lecturas quedan confirmadas o vuelven a pendientes
+static void liberar(subida_t *subida, int hueco, bool confirmado)
+{
+    for (int i = 0; i < subida->num; i++)
+    {
+        subida_entrada_t *e = entrada(subida, i);
+        if (e->mensaje != hueco)
+            continue;
+        e->mensaje = SUBIDA_SIN_MENSAJE;
+        if (confirmado)
+        {
+            e->confirmada = true;
+            subida->confirmadas++;
+        }
+        else
+        {
+            subida->pendientes_nodo[nodo_de(e)]++;
+        }
+    }
+    if (!confirmado)
+    {
+        subida->reenvios++;
+    }
+    subida->ventana[hueco].usado = false;
+    avanzar(subida);
+}
+
+void subida_iniciar(subida_t *subida)
+{
+    memset(subida, 0, sizeof(*subida));
+}
+
+void subida_agregar(subida_t *subida, const telemetria_lectura_t *lectura, uint32_t t, uint32_t ahora_s)
+{
+    subida->recibidas++;
+    if (subida->num == SUBIDA_PENDIENTES)
+    {
+        // se pierde la mas vieja; si ya iba en un mensaje se da por enviada
+        subida_entrada_t *vieja = entrada(subida, 0);
+        if (vieja->mensaje == SUBIDA_SIN_MENSAJE)
+        {
+            subida->pendientes_nodo[nodo_de(vieja)]--;
+            subida->descartadas++;
+        }
+        else
+        {
+            subida->ventana[vieja->mensaje].num--;
+        }
+        subida->primero = (subida->primero + 1) % SUBIDA_PENDIENTES;
+        subida->num--;
+        avanzar(subida);
+    }
+    subida_entrada_t *e = entrada(subida, subida->num++);
+    e->lectura = *lectura;
+    e->t = t;
+    e->llegada_s = ahora_s;
+    e->mensaje = SUBIDA_SIN_MENSAJE;
+    e->confirmada = false;
+    subida->pendientes_nodo[nodo_de(e)]++;
+}
+
+void subida_conectado(subida_t *subida, bool conectado, uint32_t ahora_s)
+{
+    subida->conectado = conectado;
+    if (!conectado)
+        return;
+    for (int h = 0; h < SUBIDA_VENTANA; h++)
+    {
+        subida->ventana[h].enviado_s = ahora_s;
+    }
+}
+
+size_t subida_siguiente(subida_t *subida, uint32_t ahora_s, uint8_t *mensaje, uint8_t *nodo, int *hueco)
+{
+    int h = 0;
+    while (h < SUBIDA_VENTANA && subida->ventana[h].usado)
+        h++;
+    if (!subida->conectado || h == SUBIDA_VENTANA)
+    {
+        return 0;
+    }
+
+    // primer nodo con un lote lleno o con una lectura que ya espero bastante
+    int primera = 0;
+    for (; primera < subida->num; primera++)
+    {
+        const subida_entrada_t *e = entrada(subida, primera);
+        if (e->mensaje == SUBIDA_SIN_MENSAJE && !e->confirmada &&
+            (ahora_s - e->llegada_s >= SUBIDA_ESPERA_S || subida->pendientes_nodo[nodo_de(e)] >= SUBIDA_MAX_LOTE))
+            break;
+    }
+    if (primera == subida->num)
+    {
+        return 0;
+    }
+    uint8_t elegido = nodo_de(entrada(subida, primera));
+
+    int indices[SUBIDA_MAX_LOTE];
+    int num = 0;
+    uint32_t t0 = UINT32_MAX;
+    for (int i = primera; i < subida->num && num < SUBIDA_MAX_LOTE; i++)
+    {
+        const subida_entrada_t *e = entrada(subida, i);
+        if (e->mensaje == SUBIDA_SIN_MENSAJE && !e->confirmada && nodo_de(e) == elegido)
+        {
+            indices[num++] = i;
+            if (e->t < t0)
+                t0 = e->t;
+        }
+    }
+
+    compresion_t bloque;
+    compresion_iniciar(&bloque, COMPRESION_ENTEROS, VALORES, compresion_escalas_telemetria,
+                       &mensaje[SUBIDA_CABECERA], SUBIDA_MENSAJE_MAX - SUBIDA_CABECERA);
+    int n = 0;
+    for (; n < num; n++)
+    {
+        subida_entrada_t *e = entrada(subida, indices[n]);
+        float valores[VALORES];
+        for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+        {
+            valores[p] = telemetria_valor(&e->lectura, (telemetria_parametro_t)p);
+        }
+        valores[TELEMETRIA_NUM_PARAMETROS] = e->lectura.secuencia;
+        if (!compresion_agregar(&bloque, e->t - t0, valores))
+            break;
+        e->mensaje = (uint8_t)h;
+    }
+    if (n == 0)
+    {
+        return 0;
+    }
+    subida->pendientes_nodo[elegido] -= n;
+
+    mensaje[0] = SUBIDA_FORMATO;
+    mensaje[1] = elegido;
+    mensaje[2] = (uint8_t)n;
+    mensaje[3] = COMPRESION_ENTEROS;
+    escribir_u32(&mensaje[4], t0);
+    subida->ventana[h] = (subida_mensaje_t){.usado = true, .id = -1, .enviado_s = ahora_s, .num = (uint8_t)n};
+    subida->mensajes++;
+    *nodo = elegido;
+    *hueco = h;
+    return SUBIDA_CABECERA + compresion_len(&bloque);
+}
+
+void subida_enviado(subida_t *subida, int hueco, int id, uint32_t ahora_s)
+{
+    if (hueco < 0 || hueco >= SUBIDA_VENTANA || !subida->ventana[hueco].usado)
+    {
+        return;
+    }
+    if (id < 0)
+    {
+        liberar(subida, hueco, false);
+        return;
+    }
+    subida->ventana[hueco].id = id;
+    subida->ventana[hueco].enviado_s = ahora_s;
+}
+
+void subida_confirmado(subida_t *subida, int id)
+{
+    int h = hueco_de(subida, id);
+    if (h >= 0)
+    {
+        liberar(subida, h, true);
+    }
+}
+
+void subida_perdido(subida_t *subida, int id)
+{
+    int h = hueco_de(subida, id);
+    if (h >= 0)
+    {
+        liberar(subida, h, false);
+    }
+}
+
+void subida_revisar(subida_t *subida, uint32_t ahora_s)
+{
+    if (!subida->conectado)
+        return;
+    for (int h = 0; h < SUBIDA_VENTANA; h++)
+    {
+        if (subida->ventana[h].usado && ahora_s - subida->ventana[h].enviado_s >= SUBIDA_CONFIRMACION_S)
+        {
+            liberar(subida, h, false);
+        }
+    }
+}
+
+int subida_pendientes(const subida_t *subida)
+{
+    int num = 0;
+    for (int i = 0; i < subida->num; i++)
+    {
+        if (!subida->entradas[(subida->primero + i) % SUBIDA_PENDIENTES].confirmada)
+            num++;
+    }
+    return num;
+}
+
+int subida_decodificar(const uint8_t *mensaje, size_t len, telemetria_lectura_t *lecturas, uint32_t *t, size_t max)
+{
+    if (len <= SUBIDA_CABECERA || mensaje[0] != SUBIDA_FORMATO || mensaje[2] == 0 || mensaje[2] > max ||
+        mensaje[3] != COMPRESION_ENTEROS)
+    {
+        return -1;
+    }
+    int num = mensaje[2];
+    uint32_t t0 = (uint32_t)mensaje[4] | ((uint32_t)mensaje[5] << 8) | ((uint32_t)mensaje[6] << 16) |
+                  ((uint32_t)mensaje[7] << 24);
+    compresion_t bloque;
+    compresion_abrir(&bloque, COMPRESION_ENTEROS, VALORES, compresion_escalas_telemetria, &mensaje[SUBIDA_CABECERA],
+                     len - SUBIDA_CABECERA, (uint16_t)num);
+    for (int i = 0; i < num; i++)
+    {
+        float valores[VALORES];
+        uint32_t dt;
+        if (!compresion_leer(&bloque, &dt, valores))
+        {
+            return -1;
+        }
+        memset(&lecturas[i], 0, sizeof(lecturas[i]));
+        lecturas[i].origen = mensaje[1];
+        lecturas[i].temperatura = valores[TELEMETRIA_TEMPERATURA];
+        lecturas[i].ec = valores[TELEMETRIA_EC];
+        lecturas[i].ph = valores[TELEMETRIA_PH];
+        lecturas[i].tds = valores[TELEMETRIA_TDS];
+        lecturas[i].secuencia = (uint16_t)valores[TELEMETRIA_NUM_PARAMETROS];
+        t[i] = t0 + dt;
+    }
+    return num;
+}
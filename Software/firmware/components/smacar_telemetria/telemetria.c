@@ -0,0 +1,174 @@
+#include "telemetria.h"
+#include "compresion.h"
+
+// redondea al entero mas cercano y satura al rango del campo
+static int32_t escalar(float valor, float escala, int32_t min, int32_t max)
+{
+    float v = valor * escala;
+    if (v != v) // NaN, p. ej. sensor desconectado
+        return 0;
+    if (v <= (float)min)
+        return min;
+    if (v >= (float)max)
+        return max;
+    return (int32_t)(v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+static void escribir_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t leer_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+void telemetria_codificar(const telemetria_lectura_t *lectura, uint8_t *trama)
+{
+    trama[0] = (lectura->origen & TELEMETRIA_MAX_ORIGEN) | (lectura->ventana ? TELEMETRIA_FLAG_VENTANA : 0);
+    escribir_u16(&trama[1], lectura->secuencia);
+    escribir_u16(&trama[3], (uint16_t)(int16_t)escalar(lectura->temperatura, 100.0f, INT16_MIN, INT16_MAX));
+    escribir_u16(&trama[5], (uint16_t)escalar(lectura->ec, 1.0f, 0, UINT16_MAX));
+    escribir_u16(&trama[7], (uint16_t)escalar(lectura->ph, 100.0f, 0, UINT16_MAX));
+    escribir_u16(&trama[9], (uint16_t)escalar(lectura->tds, 10.0f, 0, UINT16_MAX));
+}
+
+bool telemetria_decodificar(const uint8_t *trama, size_t len, telemetria_lectura_t *lectura)
+{
+    if (len != TELEMETRIA_LEN)
+    {
+        return false;
+    }
+    lectura->origen = trama[0] & TELEMETRIA_MAX_ORIGEN;
+    lectura->ventana = (trama[0] & TELEMETRIA_FLAG_VENTANA) != 0;
+    lectura->secuencia = leer_u16(&trama[1]);
+    lectura->temperatura = (int16_t)leer_u16(&trama[3]) / 100.0f;
+    lectura->ec = (float)leer_u16(&trama[5]);
+    lectura->ph = leer_u16(&trama[7]) / 100.0f;
+    lectura->tds = leer_u16(&trama[9]) / 10.0f;
+    return true;
+}
+
+size_t telemetria_codificar_formato(const telemetria_formato_t *formato, uint8_t *trama)
+{
+    trama[0] = TELEMETRIA_CTRL_FORMATO;
+    trama[1] = formato->origen;
+    trama[2] = formato->version;
+    trama[3] = formato->longitud;
+    trama[4] = formato->sf;
+    trama[5] = formato->cr;
+    trama[6] = formato->clase;
+    return TELEMETRIA_CTRL_FORMATO_LEN;
+}
+
+bool telemetria_decodificar_formato(const uint8_t *trama, size_t len, telemetria_formato_t *formato)
+{
+    if (len != TELEMETRIA_CTRL_FORMATO_LEN || trama[0] != TELEMETRIA_CTRL_FORMATO)
+    {
+        return false;
+    }
+    formato->origen = trama[1];
+    formato->version = trama[2];
+    formato->longitud = trama[3];
+    formato->sf = trama[4];
+    formato->cr = trama[5];
+    formato->clase = trama[6];
+    return true;
+}
+
+size_t telemetria_codificar_lote(const telemetria_lectura_t *lecturas, const uint32_t *t_s, size_t num, bool ventana,
+                                 uint8_t *trama, size_t max_len, size_t *len)
+{
+    *len = 0;
+    if (num == 0 || max_len <= TELEMETRIA_LOTE_CABECERA)
+    {
+        return 0;
+    }
+    if (num > TELEMETRIA_LOTE_MAX_LECTURAS)
+    {
+        num = TELEMETRIA_LOTE_MAX_LECTURAS;
+    }
+    compresion_t bloque;
+    compresion_iniciar(&bloque, COMPRESION_ENTEROS, TELEMETRIA_NUM_PARAMETROS, compresion_escalas_telemetria,
+                       &trama[TELEMETRIA_LOTE_CABECERA], max_len - TELEMETRIA_LOTE_CABECERA);
+    size_t n = 0;
+    while (n < num)
+    {
+        float valores[TELEMETRIA_NUM_PARAMETROS];
+        for (int p = 0; p < TELEMETRIA_NUM_PARAMETROS; p++)
+        {
+            valores[p] = telemetria_valor(&lecturas[n], (telemetria_parametro_t)p);
+        }
+        if (!compresion_agregar(&bloque, t_s[n] - t_s[0], valores))
+        {
+            break;
+        }
+        n++;
+    }
+    if (n == 0)
+    {
+        return 0;
+    }
+    trama[0] = TELEMETRIA_CTRL_LOTE;
+    trama[1] = (lecturas[0].origen & TELEMETRIA_MAX_ORIGEN) | (ventana ? TELEMETRIA_FLAG_VENTANA : 0);
+    escribir_u16(&trama[2], lecturas[0].secuencia);
+    trama[4] = (uint8_t)n;
+    trama[5] = COMPRESION_ENTEROS;
+    *len = TELEMETRIA_LOTE_CABECERA + compresion_len(&bloque);
+    return n;
+}
+
+int telemetria_decodificar_lote(const uint8_t *trama, size_t len, telemetria_lectura_t *lecturas, uint32_t *edad_s,
+                                size_t max)
+{
+    if (len <= TELEMETRIA_LOTE_CABECERA || trama[0] != TELEMETRIA_CTRL_LOTE || trama[4] == 0 || trama[4] > max ||
+        trama[5] > COMPRESION_ENTEROS)
+    {
+        return -1;
+    }
+    int num = trama[4];
+    compresion_t bloque;
+    compresion_abrir(&bloque, (compresion_modo_t)trama[5], TELEMETRIA_NUM_PARAMETROS, compresion_escalas_telemetria,
+                     &trama[TELEMETRIA_LOTE_CABECERA], len - TELEMETRIA_LOTE_CABECERA, (uint16_t)num);
+    uint16_t secuencia = leer_u16(&trama[2]);
+    for (int i = 0; i < num; i++)
+    {
+        float valores[TELEMETRIA_NUM_PARAMETROS];
+        if (!compresion_leer(&bloque, &edad_s[i], valores))
+        {
+            return -1;
+        }
+        telemetria_lectura_t *lectura = &lecturas[i];
+        lectura->origen = trama[1] & TELEMETRIA_MAX_ORIGEN;
+        lectura->ventana = (trama[1] & TELEMETRIA_FLAG_VENTANA) != 0 && i == num - 1;
+        lectura->secuencia = (uint16_t)(secuencia + i);
+        lectura->temperatura = valores[TELEMETRIA_TEMPERATURA];
+        lectura->ec = valores[TELEMETRIA_EC];
+        lectura->ph = valores[TELEMETRIA_PH];
+        lectura->tds = valores[TELEMETRIA_TDS];
+    }
+    // de tiempo relativo a la primera a edad respecto a la ultima
+    uint32_t ultimo = edad_s[num - 1];
+    for (int i = 0; i < num; i++)
+    {
+        edad_s[i] = ultimo - edad_s[i];
+    }
+    return num;
+}
+
+float telemetria_valor(const telemetria_lectura_t *lectura, telemetria_parametro_t parametro)
+{
+    switch (parametro)
+    {
+    case TELEMETRIA_TEMPERATURA:
+        return lectura->temperatura;
+    case TELEMETRIA_EC:
+        return lectura->ec;
+    case TELEMETRIA_PH:
+        return lectura->ph;
+    default:
+        return lectura->tds;
+    }
+}
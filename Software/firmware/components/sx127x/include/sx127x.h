@@ -39,6 +39,21 @@ extern "C" {
 #define CONFIG_SX127X_MAX_PACKET_SIZE MAX_PACKET_SIZE_FSK_FIXED
 #endif
 
+#ifndef CONFIG_SX127X_MAX_HOP_FREQUENCIES
+#define CONFIG_SX127X_MAX_HOP_FREQUENCIES 64
+#endif
+
+#define SX127X_OSCILLATOR_FREQUENCY_HZ 32000000UL
+
+/*
+ * Register values for FSK/OOK configuration, calculated at compile time when the argument is a constant.
+ * Arguments are integer bits/s or Hz. Bit rate values contain the integer part of FXOSC / bitrate in bits 19-4
+ * and the fractional part (FSK only) in bits 3-0, see sx127x_fsk_ook_set_bitrate_raw.
+ */
+#define SX127X_FSK_BITRATE_REG(bitrate) ((uint32_t) ((SX127X_OSCILLATOR_FREQUENCY_HZ * 16ULL) / (bitrate)))
+#define SX127X_OOK_BITRATE_REG(bitrate) ((uint32_t) ((SX127X_OSCILLATOR_FREQUENCY_HZ / (bitrate)) << 4))
+#define SX127X_FSK_FDEV_REG(frequency_deviation) ((uint16_t) (((uint64_t) (frequency_deviation) << 19) / SX127X_OSCILLATOR_FREQUENCY_HZ))
+
 /*
  * This structure used to change mode
  */
@@ -218,6 +233,53 @@ typedef enum {
   SX127x_BW_500000 = 0b10010000
 } sx127x_bw_t;
 
+/**
+ * @brief Common FSK bit rates. Values can be passed directly to sx127x_fsk_ook_set_bitrate_raw.
+ *
+ */
+typedef enum {
+  SX127X_FSK_BITRATE_1200 = SX127X_FSK_BITRATE_REG(1200),
+  SX127X_FSK_BITRATE_2400 = SX127X_FSK_BITRATE_REG(2400),
+  SX127X_FSK_BITRATE_4800 = SX127X_FSK_BITRATE_REG(4800),  // default
+  SX127X_FSK_BITRATE_9600 = SX127X_FSK_BITRATE_REG(9600),
+  SX127X_FSK_BITRATE_19200 = SX127X_FSK_BITRATE_REG(19200),
+  SX127X_FSK_BITRATE_38400 = SX127X_FSK_BITRATE_REG(38400),
+  SX127X_FSK_BITRATE_57600 = SX127X_FSK_BITRATE_REG(57600),
+  SX127X_FSK_BITRATE_76800 = SX127X_FSK_BITRATE_REG(76800),
+  SX127X_FSK_BITRATE_115200 = SX127X_FSK_BITRATE_REG(115200),
+  SX127X_FSK_BITRATE_150000 = SX127X_FSK_BITRATE_REG(150000),
+  SX127X_FSK_BITRATE_250000 = SX127X_FSK_BITRATE_REG(250000),
+  SX127X_FSK_BITRATE_300000 = SX127X_FSK_BITRATE_REG(300000)
+} sx127x_fsk_bitrate_t;
+
+/**
+ * @brief Single-side channel filter bandwidth for FSK/OOK. Value is RxBwMant in bits 4-3 and RxBwExp in bits 2-0.
+ *
+ */
+typedef enum {
+  SX127X_FSK_OOK_BW_2600 = 0b00010111,
+  SX127X_FSK_OOK_BW_3100 = 0b00001111,
+  SX127X_FSK_OOK_BW_3900 = 0b00000111,
+  SX127X_FSK_OOK_BW_5200 = 0b00010110,
+  SX127X_FSK_OOK_BW_6300 = 0b00001110,
+  SX127X_FSK_OOK_BW_7800 = 0b00000110,
+  SX127X_FSK_OOK_BW_10400 = 0b00010101,  // default for RxBw
+  SX127X_FSK_OOK_BW_12500 = 0b00001101,
+  SX127X_FSK_OOK_BW_15600 = 0b00000101,
+  SX127X_FSK_OOK_BW_20800 = 0b00010100,
+  SX127X_FSK_OOK_BW_25000 = 0b00001100,
+  SX127X_FSK_OOK_BW_31300 = 0b00000100,
+  SX127X_FSK_OOK_BW_41700 = 0b00010011,
+  SX127X_FSK_OOK_BW_50000 = 0b00001011,  // default for AfcBw
+  SX127X_FSK_OOK_BW_62500 = 0b00000011,
+  SX127X_FSK_OOK_BW_83300 = 0b00010010,
+  SX127X_FSK_OOK_BW_100000 = 0b00001010,
+  SX127X_FSK_OOK_BW_125000 = 0b00000010,
+  SX127X_FSK_OOK_BW_166700 = 0b00010001,
+  SX127X_FSK_OOK_BW_200000 = 0b00001001,
+  SX127X_FSK_OOK_BW_250000 = 0b00000001
+} sx127x_fsk_ook_bw_t;
+
 typedef enum {
   SX127x_CR_4_5 = 0b00000010, // default
   SX127x_CR_4_6 = 0b00000100,
@@ -353,7 +415,8 @@ struct sx127x_t {
   sx127x_packet_format_t fsk_ook_format;
   sx127x_crc_type_t fsk_crc_type;
 
-  uint64_t *frequencies;
+  // RegFrf values of the hop frequencies, so that the hop interrupt only writes them
+  uint8_t frequencies_frf[CONFIG_SX127X_MAX_HOP_FREQUENCIES][3];
   uint8_t frequencies_length;
   uint8_t current_frequency;
 };
@@ -508,8 +571,8 @@ int sx127x_lora_set_implicit_header(sx127x_implicit_header_t *header, sx127x *de
 regulatory requirements relating to the maximum permissible channel dwell time.
  *
  * @param period Symbol periods between frequency hops.
- * @param frequencies Set of predefined frequencies. Should be the same on RX and TX
- * @param frequencies_length Size of predefined frequencies
+ * @param frequencies Set of predefined frequencies. Should be the same on RX and TX. Converted to register values immediately, the array is not used afterwards
+ * @param frequencies_length Size of predefined frequencies. Cannot be more than CONFIG_SX127X_MAX_HOP_FREQUENCIES
  * @param device Pointer to variable to hold the device handle
  * @return
  *         - SX127X_ERR_INVALID_ARG   if parameter is invalid
@@ -613,6 +676,19 @@ int sx127x_lora_set_ppm_offset(int32_t frequency_error, sx127x *device);
  */
 int sx127x_rx_get_frequency_error(sx127x *device, int32_t *frequency_error);
 
+/**
+ * @brief Calculate time on air of a LoRa packet using the current modem configuration: bandwidth, spreading factor, coding rate, header mode, CRC, low data rate optimization and preamble length. Integer arithmetic only.
+ *
+ * @param payload_length Length of the payload in bytes
+ * @param device Pointer to variable to hold the device handle
+ * @param time_on_air Time on air in microseconds
+ * @return int
+ *         - SX127X_ERR_INVALID_STATE if modem is not LoRa
+ *         - SX127X_ERR_INVALID_ARG   if configuration in the registers is invalid
+ *         - SX127X_OK                on success
+ */
+int sx127x_lora_get_time_on_air(uint8_t payload_length, sx127x *device, uint32_t *time_on_air);
+
 // TX-related functions
 /**
  * @brief Set output power for transmittion.
@@ -743,6 +819,28 @@ void sx127x_lora_cad_set_callback(void (*cad_callback)(sx127x *, int), sx127x *d
  */
 int sx127x_fsk_ook_set_bitrate(float bitrate, sx127x *device);
 
+/**
+ * @brief Same as sx127x_fsk_ook_set_bitrate, but without floating point arithmetic.
+ *
+ * @param bitrate Bit rate in bits/s. FSK: 1200 - 300000, OOK: 1200 - 25000.
+ * @param device Pointer to variable to hold the device handle
+ * @return int
+ *         - SX127X_ERR_INVALID_ARG   if parameter is invalid
+ *         - SX127X_OK                on success
+ */
+int sx127x_fsk_ook_set_bitrate_bps(uint32_t bitrate, sx127x *device);
+
+/**
+ * @brief Write precalculated bit rate registers. No calculation is done, so this can be used from ISR.
+ *
+ * @param value Value from sx127x_fsk_bitrate_t, SX127X_FSK_BITRATE_REG or SX127X_OOK_BITRATE_REG
+ * @param device Pointer to variable to hold the device handle
+ * @return int
+ *         - SX127X_ERR_INVALID_STATE if modem is not FSK or OOK
+ *         - SX127X_OK                on success
+ */
+int sx127x_fsk_ook_set_bitrate_raw(uint32_t value, sx127x *device);
+
 /**
  * @brief Set frequency deviation for FSK modulation. It is most efficient when the modulation index of the signal is greater than 0.5 and below 10.
  *
@@ -754,6 +852,17 @@ int sx127x_fsk_ook_set_bitrate(float bitrate, sx127x *device);
  */
 int sx127x_fsk_set_fdev(float frequency_deviation, sx127x *device);
 
+/**
+ * @brief Same as sx127x_fsk_set_fdev, but without floating point arithmetic.
+ *
+ * @param frequency_deviation Frequency deviation in Hz. Minimum 600 hz, maximum - 200 khz.
+ * @param device Pointer to variable to hold the device handle
+ * @return int
+ *         - SX127X_ERR_INVALID_ARG   if parameter is invalid
+ *         - SX127X_OK                on success
+ */
+int sx127x_fsk_set_fdev_hz(uint32_t frequency_deviation, sx127x *device);
+
 /**
  * @brief Configure sync word. Sync word can be used to separate several different networks.
  *
@@ -906,6 +1015,17 @@ int sx127x_fsk_ook_rx_set_afc_auto(bool afc_auto, sx127x *device);
  */
 int sx127x_fsk_ook_rx_set_afc_bandwidth(float bandwidth, sx127x *device);
 
+/**
+ * @brief Same as sx127x_fsk_ook_rx_set_afc_bandwidth, but without floating point arithmetic.
+ *
+ * @param bandwidth The single-side channel filter bandwidth in Hz. The closest supported value is used.
+ * @param device Pointer to variable to hold the device handle
+ * @return int
+ *         - SX127X_ERR_INVALID_STATE if modem is not FSK or OOK
+ *         - SX127X_OK                on success
+ */
+int sx127x_fsk_ook_rx_set_afc_bandwidth_hz(uint32_t bandwidth, sx127x *device);
+
 /**
  * @brief Configure bandwidth of channel filter. The role of the channel filter is to reject noise and interference outside of the wanted channel. Channel filtering is implemented with a 16-tap finite impulse response (FIR) filter. To respect sampling criterion in the decimation chain of the receiver, the communication bit rate cannot be set at a higher than twice the single side receiver bandwidth (BitRate < 2 x RxBw)
  *
@@ -917,6 +1037,29 @@ int sx127x_fsk_ook_rx_set_afc_bandwidth(float bandwidth, sx127x *device);
  */
 int sx127x_fsk_ook_rx_set_bandwidth(float bandwidth, sx127x *device);
 
+/**
+ * @brief Same as sx127x_fsk_ook_rx_set_bandwidth, but without floating point arithmetic.
+ *
+ * @param bandwidth The single-side channel filter bandwidth in Hz. The closest supported value is used.
+ * @param device Pointer to variable to hold the device handle
+ * @return int
+ *         - SX127X_ERR_INVALID_STATE if modem is not FSK or OOK
+ *         - SX127X_OK                on success
+ */
+int sx127x_fsk_ook_rx_set_bandwidth_hz(uint32_t bandwidth, sx127x *device);
+
+/**
+ * @brief Set one of the supported channel filter bandwidths directly.
+ *
+ * @param bandwidth Channel filter bandwidth
+ * @param afc_bandwidth Bandwidth during the AFC phase
+ * @param device Pointer to variable to hold the device handle
+ * @return int
+ *         - SX127X_ERR_INVALID_STATE if modem is not FSK or OOK
+ *         - SX127X_OK                on success
+ */
+int sx127x_fsk_ook_rx_set_bandwidth_preset(sx127x_fsk_ook_bw_t bandwidth, sx127x_fsk_ook_bw_t afc_bandwidth, sx127x *device);
+
 /**
  * @brief Configure RSSI calculation
  *
@@ -0,0 +1,129 @@
+#ifndef sx127x_scheduler_h
+#define sx127x_scheduler_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sx127x.h"
+
+#ifndef CONFIG_SX127X_SCHEDULER_MAX_JOBS
+#define CONFIG_SX127X_SCHEDULER_MAX_JOBS 16
+#endif
+
+#ifndef CONFIG_SX127X_SCHEDULER_MAX_DEVICES
+#define CONFIG_SX127X_SCHEDULER_MAX_DEVICES 4
+#endif
+
+/**
+ * @brief Scheduled transmission. Memory is owned by the caller and must stay valid until the job is removed or completed.
+ *
+ */
+typedef struct sx127x_scheduler_job_t sx127x_scheduler_job;
+
+struct sx127x_scheduler_job_t {
+  sx127x *device;
+
+  // time when transmission should start, in milliseconds of the scheduler's clock
+  uint64_t deadline_ms;
+  // 0 for one-shot jobs
+  uint32_t period_ms;
+  // expected time-on-air. Device is not used by other jobs while transmitting
+  uint32_t airtime_ms;
+
+  // write packet into the FIFO. Called ahead of the deadline
+  int (*prepare)(sx127x_scheduler_job *);
+  // start transmission. When NULL, device is switched into TX mode of the active modem
+  int (*transmit)(sx127x_scheduler_job *);
+
+  void *ctx;
+
+  // result of the last prepare or transmit call
+  int last_code;
+  // number of periods skipped because device was busy or scheduler was polled late
+  uint32_t missed;
+
+  // internal state
+  uint64_t key_ms;
+  size_t heap_index;
+  int prepared;
+};
+
+/**
+ * @brief Per-device state.
+ *
+ */
+typedef struct {
+  sx127x *device;
+  uint64_t busy_until_ms;
+  sx127x_scheduler_job *prepared_job;
+} sx127x_scheduler_device_t;
+
+/**
+ * @brief Transmission scheduler shared between several devices. Jobs are kept in a min-heap ordered by the next event time.
+ * Scheduler doesn't use any timers or threads. Caller should invoke @ref sx127x_scheduler_run with the current time and sleep until returned wakeup time.
+ * Scheduler is not thread-safe.
+ *
+ */
+typedef struct {
+  sx127x_scheduler_job *heap[CONFIG_SX127X_SCHEDULER_MAX_JOBS];
+  size_t heap_length;
+  sx127x_scheduler_device_t devices[CONFIG_SX127X_SCHEDULER_MAX_DEVICES];
+  size_t devices_length;
+  uint32_t prepare_ahead_ms;
+} sx127x_scheduler;
+
+/**
+ * @brief Initialize scheduler.
+ *
+ * @param prepare_ahead_ms Time before the deadline when packet should be written into the FIFO. All preparations that fall into this window are executed in a single @ref sx127x_scheduler_run call.
+ * @param scheduler Pointer to variable to hold the scheduler
+ * @return
+ *         - SX127X_ERR_INVALID_ARG   if parameter is invalid
+ *         - SX127X_OK                on success
+ */
+int sx127x_scheduler_create(uint32_t prepare_ahead_ms, sx127x_scheduler *scheduler);
+
+/**
+ * @brief Add job into the scheduler. Job's deadline_ms, airtime_ms, device and prepare must be set.
+ *
+ * @param job Job to add
+ * @param scheduler Pointer to the scheduler
+ * @return
+ *         - SX127X_ERR_INVALID_ARG   if parameter is invalid
+ *         - SX127X_ERR_NOT_FOUND     if there is no space for the job or device
+ *         - SX127X_OK                on success
+ */
+int sx127x_scheduler_add(sx127x_scheduler_job *job, sx127x_scheduler *scheduler);
+
+/**
+ * @brief Remove job from the scheduler. If packet was already written into the FIFO, it is not transmitted.
+ *
+ * @param job Job to remove
+ * @param scheduler Pointer to the scheduler
+ * @return
+ *         - SX127X_ERR_NOT_FOUND     if job is not scheduled
+ *         - SX127X_OK                on success
+ */
+int sx127x_scheduler_remove(sx127x_scheduler_job *job, sx127x_scheduler *scheduler);
+
+/**
+ * @brief Execute all events due at the current time. Events are executed in order of their time.
+ *
+ * @param now_ms Current time in milliseconds
+ * @param scheduler Pointer to the scheduler
+ * @param next_wakeup_ms Time of the next event. UINT64_MAX if no jobs are scheduled. Can be NULL
+ * @return
+ *         - SX127X_ERR_INVALID_ARG   if parameter is invalid
+ *         - SX127X_OK                on success. Errors from the job callbacks are stored in the job's last_code
+ */
+int sx127x_scheduler_run(uint64_t now_ms, sx127x_scheduler *scheduler, uint64_t *next_wakeup_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -13,16 +13,17 @@
 // limitations under the License.
 #include "sx127x.h"
 
-#include <math.h>
 #include <string.h>
 #include <sx127x_spi.h>
 #include <sx127x_registers.h>
 
 #define SX127x_VERSION 0x12
 
-#define SX127x_OSCILLATOR_FREQUENCY 32000000.0f
-#define SX127x_FREQ_ERROR_FACTOR ((1 << 24) / SX127x_OSCILLATOR_FREQUENCY)
-#define SX127x_FSTEP (SX127x_OSCILLATOR_FREQUENCY / (1 << 19))
+// FSTEP = FXOSC / 2^19 = 15625 / 2^8 Hz
+#define SX127x_FSTEP_NUM 15625
+#define SX127x_FSTEP_SHIFT 8
+// LoRa frequency error = FEI * 2^24 / FXOSC * BW / 500 kHz = FEI * BW * 2^8 / 5^12
+#define SX127x_FREQ_ERROR_DEN 244140625ULL
 #define SX127x_REG_MODEM_CONFIG_3_AGC_ON 0b00000100
 #define SX127x_REG_MODEM_CONFIG_3_AGC_OFF 0b00000000
 
@@ -509,7 +510,7 @@ void sx127x_lora_handle_interrupt(sx127x *device) {
     if (device->current_frequency >= device->frequencies_length) {
       device->current_frequency = 0;
     }
-    ERROR_CHECK_NOCODE(sx127x_set_frequency(device->frequencies[device->current_frequency], device));
+    ERROR_CHECK_NOCODE(sx127x_shadow_spi_write_register(REGFRFMSB, device->frequencies_frf[device->current_frequency], 3, &device->spi_device));
     device->current_frequency++;
     return;
   }
@@ -605,9 +606,16 @@ int sx127x_set_opmod(sx127x_mode_t opmod, sx127x_modulation_t modulation, sx127x
   return result;
 }
 
+static void sx127x_frequency_to_frf(uint64_t frequency, uint8_t *frf) {
+  uint64_t adjusted = (frequency << 19) / SX127X_OSCILLATOR_FREQUENCY_HZ;
+  frf[0] = (uint8_t) (adjusted >> 16);
+  frf[1] = (uint8_t) (adjusted >> 8);
+  frf[2] = (uint8_t) (adjusted >> 0);
+}
+
 int sx127x_set_frequency(uint64_t frequency, sx127x *device) {
-  uint64_t adjusted = (frequency << 19) / SX127x_OSCILLATOR_FREQUENCY;
-  uint8_t data[] = {(uint8_t) (adjusted >> 16), (uint8_t) (adjusted >> 8), (uint8_t) (adjusted >> 0)};
+  uint8_t data[3];
+  sx127x_frequency_to_frf(frequency, data);
   ERROR_CHECK(sx127x_shadow_spi_write_register(REGFRFMSB, data, 3, &device->spi_device));
   return SX127X_OK;
 }
@@ -615,7 +623,7 @@ int sx127x_set_frequency(uint64_t frequency, sx127x *device) {
 int sx127x_get_frequency(sx127x *device, uint64_t *frequency) {
   uint32_t frequency_raw;
   ERROR_CHECK(sx127x_shadow_spi_read_registers(REGFRFMSB, &device->spi_device, 3, &frequency_raw));
-  *frequency = (uint64_t) (frequency_raw * SX127x_OSCILLATOR_FREQUENCY) >> 19;
+  *frequency = ((uint64_t) frequency_raw * SX127X_OSCILLATOR_FREQUENCY_HZ) >> 19;
   return SX127X_OK;
 }
 
@@ -715,10 +723,12 @@ int sx127x_lora_set_implicit_header(sx127x_implicit_header_t *header, sx127x *de
 
 int sx127x_lora_set_frequency_hopping(uint8_t period, uint64_t *frequencies, uint8_t frequencies_length, sx127x *device) {
   CHECK_MODULATION(device, SX127x_MODULATION_LORA);
-  if (frequencies == NULL || frequencies_length == 0) {
+  if (frequencies == NULL || frequencies_length == 0 || frequencies_length > CONFIG_SX127X_MAX_HOP_FREQUENCIES) {
     return SX127X_ERR_INVALID_ARG;
   }
-  device->frequencies = frequencies;
+  for (uint8_t i = 0; i < frequencies_length; i++) {
+    sx127x_frequency_to_frf(frequencies[i], device->frequencies_frf[i]);
+  }
   device->frequencies_length = frequencies_length;
   return sx127x_shadow_spi_write_register(REGHOPPERIOD, &period, 1, &device->spi_device);
 }
@@ -777,7 +787,7 @@ int sx127x_rx_get_frequency_error(sx127x *device, int32_t *result) {
     } else {
       *result = 1;
     }
-    *result = (*result) * (frequency_error * SX127x_FREQ_ERROR_FACTOR * bandwidth / 500000.0f);
+    *result = (*result) * (int32_t) (((uint64_t) frequency_error * bandwidth << 8) / SX127x_FREQ_ERROR_DEN);
     return SX127X_OK;
   } else if (device->active_modem == SX127x_MODULATION_FSK || device->active_modem == SX127x_MODULATION_OOK) {
     uint32_t frequency_error;
@@ -790,13 +800,49 @@ int sx127x_rx_get_frequency_error(sx127x *device, int32_t *result) {
     } else {
       *result = 1;
     }
-    *result = (*result) * SX127x_FSTEP * frequency_error;
+    *result = (*result) * (int32_t) ((frequency_error * SX127x_FSTEP_NUM) >> SX127x_FSTEP_SHIFT);
     return SX127X_OK;
   } else {
     return SX127X_ERR_INVALID_ARG;
   }
 }
 
+int sx127x_lora_get_time_on_air(uint8_t payload_length, sx127x *device, uint32_t *time_on_air) {
+  CHECK_MODULATION(device, SX127x_MODULATION_LORA);
+  uint32_t bandwidth;
+  ERROR_CHECK(sx127x_lora_get_bandwidth(device, &bandwidth));
+  uint8_t config1;
+  ERROR_CHECK(sx127x_read_register(REGMODEMCONFIG1, &device->spi_device, &config1));
+  uint8_t config2;
+  ERROR_CHECK(sx127x_read_register(REGMODEMCONFIG2, &device->spi_device, &config2));
+  uint8_t config3;
+  ERROR_CHECK(sx127x_read_register(REGMODEMCONFIG3, &device->spi_device, &config3));
+  uint32_t preamble_length;
+  ERROR_CHECK(sx127x_shadow_spi_read_registers(REGPREAMBLEMSB, &device->spi_device, 2, &preamble_length));
+
+  int32_t spreading_factor = (config2 >> 4);
+  int32_t coding_rate = ((config1 >> 1) & 0b111);
+  if (spreading_factor < 6 || spreading_factor > 12 || coding_rate < 1 || coding_rate > 4) {
+    return SX127X_ERR_INVALID_ARG;
+  }
+  int32_t implicit_header = (config1 & SX127x_HEADER_MODE_IMPLICIT);
+  int32_t crc = ((config2 >> 2) & 1);
+  int32_t low_datarate = ((config3 >> 3) & 1);
+
+  // AN1200.13: n_payload = 8 + max(ceil((8PL - 4SF + 28 + 16CRC - 20IH) / (4(SF - 2DE))) * (CR + 4), 0)
+  int32_t numerator = 8 * payload_length - 4 * spreading_factor + 28 + 16 * crc - 20 * implicit_header;
+  int32_t denominator = 4 * (spreading_factor - 2 * low_datarate);
+  uint32_t payload_symbols = 8;
+  if (numerator > 0) {
+    payload_symbols += ((numerator + denominator - 1) / denominator) * (coding_rate + 4);
+  }
+
+  // total symbols (n_preamble + 4.25 + n_payload), counted in quarters of a symbol
+  uint64_t quarter_symbols = 4 * (uint64_t) preamble_length + 17 + 4 * (uint64_t) payload_symbols;
+  *time_on_air = (uint32_t) ((quarter_symbols * 1000000ULL << spreading_factor) / (4 * (uint64_t) bandwidth));
+  return SX127X_OK;
+}
+
 int sx127x_dump_registers(uint8_t *output, sx127x *device) {
   //Reading from 0x00 register will actually read from fifo
   //skip it
@@ -906,7 +952,11 @@ int sx127x_lora_tx_set_for_transmission(const uint8_t *data, uint8_t data_length
 int sx127x_lora_set_ppm_offset(int32_t frequency_error, sx127x *device) {
   uint64_t frequency;
   ERROR_CHECK(sx127x_get_frequency(device, &frequency));
-  uint8_t value = (uint8_t) (0.95f * ((float) frequency_error / (frequency / 1E6f)));
+  if (frequency == 0) {
+    return SX127X_ERR_INVALID_STATE;
+  }
+  // 0.95 * frequency_error / (frequency / 1E6). register is two's complement
+  uint8_t value = (uint8_t) (int32_t) (((int64_t) frequency_error * 950000) / (int64_t) frequency);
   return sx127x_shadow_spi_write_register(0x27, &value, 1, &device->spi_device);
 }
 
@@ -1055,41 +1105,53 @@ void sx127x_lora_cad_set_callback(void (*cad_callback)(sx127x *, int), sx127x *d
   device->cad_callback = cad_callback;
 }
 
-int sx127x_fsk_ook_set_bitrate(float bitrate, sx127x *device) {
+int sx127x_fsk_ook_set_bitrate_raw(uint32_t value, sx127x *device) {
+  CHECK_FSK_OOK_MODULATION(device);
+  uint8_t data[] = {(uint8_t) (value >> 12), (uint8_t) (value >> 4)};
+  ERROR_CHECK(sx127x_shadow_spi_write_register(REGBITRATEMSB, data, 2, &device->spi_device));
+  uint8_t bitrate_fractional = (uint8_t) (value & 0x0F);
+  return sx127x_shadow_spi_write_register(REGBITRATEFRAC, &bitrate_fractional, 1, &device->spi_device);
+}
+
+int sx127x_fsk_ook_set_bitrate_bps(uint32_t bitrate, sx127x *device) {
   CHECK_FSK_OOK_MODULATION(device);
-  uint16_t bitrate_value;
-  uint8_t bitrate_fractional;
   if (device->active_modem == SX127x_MODULATION_FSK) {
     if (bitrate < 1200 || bitrate > 300000) {
       return SX127X_ERR_INVALID_ARG;
     }
-    uint32_t value = (uint32_t) (SX127x_OSCILLATOR_FREQUENCY * 16.0 / bitrate);
-    bitrate_value = (value >> 4) & 0xFFFF;
-    bitrate_fractional = value & 0x0F;
-  } else if (device->active_modem == SX127x_MODULATION_OOK) {
+    return sx127x_fsk_ook_set_bitrate_raw(SX127X_FSK_BITRATE_REG(bitrate), device);
+  } else {
     if (bitrate < 1200 || bitrate > 25000) {
       return SX127X_ERR_INVALID_ARG;
     }
-    bitrate_value = (uint16_t) (SX127x_OSCILLATOR_FREQUENCY / bitrate);
-    bitrate_fractional = 0;
-  } else {
+    return sx127x_fsk_ook_set_bitrate_raw(SX127X_OOK_BITRATE_REG(bitrate), device);
+  }
+}
+
+int sx127x_fsk_ook_set_bitrate(float bitrate, sx127x *device) {
+  if (!(bitrate >= 0.0f && bitrate <= 300000.0f)) {
     return SX127X_ERR_INVALID_ARG;
   }
-  uint8_t data[] = {(uint8_t) (bitrate_value >> 8), (uint8_t) (bitrate_value >> 0)};
-  ERROR_CHECK(sx127x_shadow_spi_write_register(REGBITRATEMSB, data, 2, &device->spi_device));
-  return sx127x_shadow_spi_write_register(REGBITRATEFRAC, &bitrate_fractional, 1, &device->spi_device);
+  return sx127x_fsk_ook_set_bitrate_bps((uint32_t) bitrate, device);
 }
 
-int sx127x_fsk_set_fdev(float frequency_deviation, sx127x *device) {
+int sx127x_fsk_set_fdev_hz(uint32_t frequency_deviation, sx127x *device) {
   CHECK_MODULATION(device, SX127x_MODULATION_FSK);
   if (frequency_deviation < 600 || frequency_deviation > 200000) {
     return SX127X_ERR_INVALID_ARG;
   }
-  uint16_t value = (uint16_t) (frequency_deviation / SX127x_FSTEP);
+  uint16_t value = SX127X_FSK_FDEV_REG(frequency_deviation);
   uint8_t data[] = {(uint8_t) (value >> 8), (uint8_t) (value >> 0)};
   return sx127x_shadow_spi_write_register(REGFDEVMSB, data, 2, &device->spi_device);
 }
 
+int sx127x_fsk_set_fdev(float frequency_deviation, sx127x *device) {
+  if (!(frequency_deviation >= 600 && frequency_deviation <= 200000)) {
+    return SX127X_ERR_INVALID_ARG;
+  }
+  return sx127x_fsk_set_fdev_hz((uint32_t) frequency_deviation, device);
+}
+
 int sx127x_ook_rx_set_peak_mode(sx127x_ook_peak_thresh_step_t step, uint8_t floor_threshold, sx127x_ook_peak_thresh_dec_t decrement, sx127x *device) {
   CHECK_MODULATION(device, SX127x_MODULATION_OOK);
   ERROR_CHECK(sx127x_shadow_spi_write_register(REGOOKFIX, &floor_threshold, 1, &device->spi_device));
@@ -1122,34 +1184,65 @@ int sx127x_fsk_ook_rx_set_afc_auto(bool afc_auto, sx127x *device) {
   return sx127x_append_register(REGRXCONFIG, value, 0b11101111, &device->spi_device);
 }
 
-uint8_t sx127x_fsk_ook_calculate_bw_register(float bandwidth) {
-  float min_tolerance = bandwidth;
+uint8_t sx127x_fsk_ook_calculate_bw_register(uint32_t bandwidth) {
+  // each supported bandwidth is FXOSC / divisor. |bandwidth - FXOSC / divisor| is compared as a fraction,
+  // numerator |bandwidth * divisor - FXOSC| over the divisor, so that no division is needed
+  uint64_t min_tolerance = bandwidth;
+  uint32_t min_divisor = 1;
   uint8_t result = 0;
   for (uint8_t e = 7; e >= 1; e--) {
     for (int8_t m = 2; m >= 0; m--) {
-      float point = SX127x_OSCILLATOR_FREQUENCY / (float) (((4 * m) + 16) * ((uint32_t) 1 << (e + 2)));
-      float current_tolerance = fabsf(bandwidth - point);
-      if (current_tolerance < min_tolerance) {
+      uint32_t divisor = ((4 * m) + 16) << (e + 2);
+      uint64_t scaled = (uint64_t) bandwidth * divisor;
+      uint64_t current_tolerance = (scaled > SX127X_OSCILLATOR_FREQUENCY_HZ) ? (scaled - SX127X_OSCILLATOR_FREQUENCY_HZ) : (SX127X_OSCILLATOR_FREQUENCY_HZ - scaled);
+      if (current_tolerance * min_divisor < min_tolerance * divisor) {
         result = ((m << 3) | e);
         min_tolerance = current_tolerance;
+        min_divisor = divisor;
       }
     }
   }
   return result;
 }
 
-int sx127x_fsk_ook_rx_set_afc_bandwidth(float bandwidth, sx127x *device) {
+// float bandwidth is only truncated to whole Hz, anything above the maximum selects the maximum anyway
+static uint32_t sx127x_fsk_ook_bandwidth_to_hz(float bandwidth) {
+  if (!(bandwidth > 0.0f)) {
+    return 0;
+  }
+  if (bandwidth > 1000000.0f) {
+    return 1000000;
+  }
+  return (uint32_t) bandwidth;
+}
+
+int sx127x_fsk_ook_rx_set_afc_bandwidth_hz(uint32_t bandwidth, sx127x *device) {
   CHECK_FSK_OOK_MODULATION(device);
   uint8_t value = sx127x_fsk_ook_calculate_bw_register(bandwidth);
   return sx127x_shadow_spi_write_register(REGAFCBW, &value, 1, &device->spi_device);
 }
 
-int sx127x_fsk_ook_rx_set_bandwidth(float bandwidth, sx127x *device) {
+int sx127x_fsk_ook_rx_set_afc_bandwidth(float bandwidth, sx127x *device) {
+  return sx127x_fsk_ook_rx_set_afc_bandwidth_hz(sx127x_fsk_ook_bandwidth_to_hz(bandwidth), device);
+}
+
+int sx127x_fsk_ook_rx_set_bandwidth_hz(uint32_t bandwidth, sx127x *device) {
   CHECK_FSK_OOK_MODULATION(device);
   uint8_t value = sx127x_fsk_ook_calculate_bw_register(bandwidth);
   return sx127x_shadow_spi_write_register(REGRXBW, &value, 1, &device->spi_device);
 }
 
+int sx127x_fsk_ook_rx_set_bandwidth(float bandwidth, sx127x *device) {
+  return sx127x_fsk_ook_rx_set_bandwidth_hz(sx127x_fsk_ook_bandwidth_to_hz(bandwidth), device);
+}
+
+int sx127x_fsk_ook_rx_set_bandwidth_preset(sx127x_fsk_ook_bw_t bandwidth, sx127x_fsk_ook_bw_t afc_bandwidth, sx127x *device) {
+  CHECK_FSK_OOK_MODULATION(device);
+  // RegRxBw and RegAfcBw are next to each other
+  uint8_t data[] = {(uint8_t) bandwidth, (uint8_t) afc_bandwidth};
+  return sx127x_shadow_spi_write_register(REGRXBW, data, 2, &device->spi_device);
+}
+
 int sx127x_fsk_ook_rx_set_trigger(sx127x_rx_trigger_t trigger, sx127x *device) {
   CHECK_FSK_OOK_MODULATION(device);
   return sx127x_append_register(REGRXCONFIG, trigger, 0b11111000, &device->spi_device);
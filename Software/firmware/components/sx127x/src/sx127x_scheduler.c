@@ -0,0 +1,211 @@
+#include "sx127x_scheduler.h"
+
+#include <string.h>
+
+// prepared jobs go first on equal time so that FIFO owner is transmitted before anyone else tries to use FIFO
+static int sx127x_scheduler_less(const sx127x_scheduler_job *a, const sx127x_scheduler_job *b) {
+  if (a->key_ms != b->key_ms) {
+    return a->key_ms < b->key_ms;
+  }
+  return a->prepared > b->prepared;
+}
+
+static void sx127x_scheduler_swap(size_t i, size_t j, sx127x_scheduler *scheduler) {
+  sx127x_scheduler_job *tmp = scheduler->heap[i];
+  scheduler->heap[i] = scheduler->heap[j];
+  scheduler->heap[j] = tmp;
+  scheduler->heap[i]->heap_index = i;
+  scheduler->heap[j]->heap_index = j;
+}
+
+static void sx127x_scheduler_sift_up(size_t index, sx127x_scheduler *scheduler) {
+  while (index > 0) {
+    size_t parent = (index - 1) / 2;
+    if (!sx127x_scheduler_less(scheduler->heap[index], scheduler->heap[parent])) {
+      break;
+    }
+    sx127x_scheduler_swap(index, parent, scheduler);
+    index = parent;
+  }
+}
+
+static void sx127x_scheduler_sift_down(size_t index, sx127x_scheduler *scheduler) {
+  while (1) {
+    size_t smallest = index;
+    size_t left = 2 * index + 1;
+    size_t right = left + 1;
+    if (left < scheduler->heap_length && sx127x_scheduler_less(scheduler->heap[left], scheduler->heap[smallest])) {
+      smallest = left;
+    }
+    if (right < scheduler->heap_length && sx127x_scheduler_less(scheduler->heap[right], scheduler->heap[smallest])) {
+      smallest = right;
+    }
+    if (smallest == index) {
+      return;
+    }
+    sx127x_scheduler_swap(index, smallest, scheduler);
+    index = smallest;
+  }
+}
+
+static void sx127x_scheduler_update(sx127x_scheduler_job *job, uint64_t key_ms, sx127x_scheduler *scheduler) {
+  uint64_t old_key = job->key_ms;
+  job->key_ms = key_ms;
+  if (key_ms < old_key) {
+    sx127x_scheduler_sift_up(job->heap_index, scheduler);
+  } else {
+    sx127x_scheduler_sift_down(job->heap_index, scheduler);
+  }
+}
+
+static void sx127x_scheduler_pop(size_t index, sx127x_scheduler *scheduler) {
+  scheduler->heap_length--;
+  if (index == scheduler->heap_length) {
+    return;
+  }
+  scheduler->heap[index] = scheduler->heap[scheduler->heap_length];
+  scheduler->heap[index]->heap_index = index;
+  sx127x_scheduler_sift_down(index, scheduler);
+  sx127x_scheduler_sift_up(index, scheduler);
+}
+
+static uint64_t sx127x_scheduler_prepare_time(const sx127x_scheduler_job *job, const sx127x_scheduler *scheduler) {
+  if (job->deadline_ms < scheduler->prepare_ahead_ms) {
+    return 0;
+  }
+  return job->deadline_ms - scheduler->prepare_ahead_ms;
+}
+
+static sx127x_scheduler_device_t *sx127x_scheduler_find_device(sx127x *device, sx127x_scheduler *scheduler) {
+  for (size_t i = 0; i < scheduler->devices_length; i++) {
+    if (scheduler->devices[i].device == device) {
+      return &scheduler->devices[i];
+    }
+  }
+  return NULL;
+}
+
+// move job to the next period after now or remove one-shot job
+static void sx127x_scheduler_complete(uint64_t now_ms, sx127x_scheduler_job *job, sx127x_scheduler *scheduler) {
+  job->prepared = 0;
+  if (job->period_ms == 0) {
+    sx127x_scheduler_pop(job->heap_index, scheduler);
+    return;
+  }
+  job->deadline_ms += job->period_ms;
+  if (job->deadline_ms <= now_ms) {
+    // don't transmit missed periods in a burst
+    uint64_t periods = (now_ms - job->deadline_ms) / job->period_ms + 1;
+    job->deadline_ms += periods * job->period_ms;
+    job->missed += (uint32_t) periods;
+  }
+  sx127x_scheduler_update(job, sx127x_scheduler_prepare_time(job, scheduler), scheduler);
+}
+
+int sx127x_scheduler_create(uint32_t prepare_ahead_ms, sx127x_scheduler *scheduler) {
+  if (scheduler == NULL) {
+    return SX127X_ERR_INVALID_ARG;
+  }
+  memset(scheduler, 0, sizeof(sx127x_scheduler));
+  scheduler->prepare_ahead_ms = prepare_ahead_ms;
+  return SX127X_OK;
+}
+
+int sx127x_scheduler_add(sx127x_scheduler_job *job, sx127x_scheduler *scheduler) {
+  if (job == NULL || scheduler == NULL || job->device == NULL || job->prepare == NULL) {
+    return SX127X_ERR_INVALID_ARG;
+  }
+  if (scheduler->heap_length >= CONFIG_SX127X_SCHEDULER_MAX_JOBS) {
+    return SX127X_ERR_NOT_FOUND;
+  }
+  for (size_t i = 0; i < scheduler->heap_length; i++) {
+    if (scheduler->heap[i] == job) {
+      return SX127X_ERR_INVALID_STATE;
+    }
+  }
+  if (sx127x_scheduler_find_device(job->device, scheduler) == NULL) {
+    if (scheduler->devices_length >= CONFIG_SX127X_SCHEDULER_MAX_DEVICES) {
+      return SX127X_ERR_NOT_FOUND;
+    }
+    sx127x_scheduler_device_t *device = &scheduler->devices[scheduler->devices_length];
+    device->device = job->device;
+    device->busy_until_ms = 0;
+    device->prepared_job = NULL;
+    scheduler->devices_length++;
+  }
+  job->last_code = SX127X_OK;
+  job->missed = 0;
+  job->prepared = 0;
+  job->key_ms = sx127x_scheduler_prepare_time(job, scheduler);
+  job->heap_index = scheduler->heap_length;
+  scheduler->heap[scheduler->heap_length] = job;
+  scheduler->heap_length++;
+  sx127x_scheduler_sift_up(job->heap_index, scheduler);
+  return SX127X_OK;
+}
+
+int sx127x_scheduler_remove(sx127x_scheduler_job *job, sx127x_scheduler *scheduler) {
+  if (job == NULL || scheduler == NULL) {
+    return SX127X_ERR_INVALID_ARG;
+  }
+  if (job->heap_index >= scheduler->heap_length || scheduler->heap[job->heap_index] != job) {
+    return SX127X_ERR_NOT_FOUND;
+  }
+  sx127x_scheduler_device_t *device = sx127x_scheduler_find_device(job->device, scheduler);
+  if (device != NULL && device->prepared_job == job) {
+    device->prepared_job = NULL;
+  }
+  job->prepared = 0;
+  sx127x_scheduler_pop(job->heap_index, scheduler);
+  return SX127X_OK;
+}
+
+int sx127x_scheduler_run(uint64_t now_ms, sx127x_scheduler *scheduler, uint64_t *next_wakeup_ms) {
+  if (scheduler == NULL) {
+    return SX127X_ERR_INVALID_ARG;
+  }
+  while (scheduler->heap_length > 0 && scheduler->heap[0]->key_ms <= now_ms) {
+    sx127x_scheduler_job *job = scheduler->heap[0];
+    sx127x_scheduler_device_t *device = sx127x_scheduler_find_device(job->device, scheduler);
+    if (!job->prepared) {
+      if (device->prepared_job != NULL) {
+        // FIFO is occupied by another job. retry right after it was transmitted
+        sx127x_scheduler_update(job, device->prepared_job->key_ms, scheduler);
+        continue;
+      }
+      if (device->busy_until_ms > now_ms) {
+        // FIFO can't be changed while transmitting
+        sx127x_scheduler_update(job, device->busy_until_ms, scheduler);
+        continue;
+      }
+      job->last_code = job->prepare(job);
+      if (job->last_code != SX127X_OK) {
+        sx127x_scheduler_complete(now_ms, job, scheduler);
+        continue;
+      }
+      job->prepared = 1;
+      device->prepared_job = job;
+      sx127x_scheduler_update(job, job->deadline_ms, scheduler);
+      continue;
+    }
+
+    if (device->busy_until_ms > now_ms) {
+      sx127x_scheduler_update(job, device->busy_until_ms, scheduler);
+      continue;
+    }
+    if (job->transmit != NULL) {
+      job->last_code = job->transmit(job);
+    } else {
+      job->last_code = sx127x_set_opmod(SX127x_MODE_TX, job->device->active_modem, job->device);
+    }
+    device->prepared_job = NULL;
+    if (job->last_code == SX127X_OK) {
+      device->busy_until_ms = now_ms + job->airtime_ms;
+    }
+    sx127x_scheduler_complete(now_ms, job, scheduler);
+  }
+  if (next_wakeup_ms != NULL) {
+    *next_wakeup_ms = (scheduler->heap_length > 0 ? scheduler->heap[0]->key_ms : UINT64_MAX);
+  }
+  return SX127X_OK;
+}
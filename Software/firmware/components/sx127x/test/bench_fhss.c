@@ -0,0 +1,114 @@
+// FHSS hop interrupt on the emulated register file: SPI traffic and time per interrupt, 50 channels.
+// SPI counts and RegFrf values are checked, the times are only printed: they are host times without the bus,
+// useful to compare handler versions, not as the on-target ISR time.
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mock_spi.h"
+#include "sx127x_registers.h"
+#include "test_common.h"
+
+#define CHANNELS 50
+#define SAMPLES 200000
+#define WARMUP 1000
+
+static uint64_t frequencies[CHANNELS];
+static uint32_t expected_frf[CHANNELS];
+static uint32_t samples[SAMPLES];
+
+static uint32_t now_ns(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint32_t) ((uint64_t) t.tv_sec * 1000000000ULL + (uint64_t) t.tv_nsec);
+}
+
+static int compare(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *) a;
+  uint32_t y = *(const uint32_t *) b;
+  return (x > y) - (x < y);
+}
+
+static uint32_t frf(const mock_spi_device *spi) {
+  return ((uint32_t) spi->registers[REGFRFMSB] << 16) | ((uint32_t) spi->registers[REGFRFMSB + 1] << 8) | spi->registers[REGFRFMSB + 2];
+}
+
+static void print_samples(const char *name, uint32_t overhead) {
+  qsort(samples, SAMPLES, sizeof(uint32_t), compare);
+  printf("%-22s p50 %5u ns, p99.9 %5u ns, max %6u ns (clock overhead %u ns included)\n", name, samples[SAMPLES / 2], samples[SAMPLES * 999 / 1000], samples[SAMPLES - 1], overhead);
+}
+
+// each sample times a single call, so the worst case is not averaged away; the clock cost is measured alone
+static uint32_t clock_overhead(void) {
+  for (int i = 0; i < SAMPLES; i++) {
+    uint32_t start = now_ns();
+    samples[i] = now_ns() - start;
+  }
+  qsort(samples, SAMPLES, sizeof(uint32_t), compare);
+  return samples[SAMPLES / 2];
+}
+
+int main(void) {
+  mock_spi_device spi;
+  sx127x device;
+  for (int i = 0; i < CHANNELS; i++) {
+    frequencies[i] = 902300000ULL + 200000ULL * i;
+  }
+
+  // reference RegFrf values: what sx127x_set_frequency writes for every channel
+  mock_spi_init(&spi);
+  EXPECT_EQ(sx127x_create(&spi, &device), SX127X_OK);
+  for (int i = 0; i < CHANNELS; i++) {
+    EXPECT_EQ(sx127x_set_frequency(frequencies[i], &device), SX127X_OK);
+    expected_frf[i] = frf(&spi);
+  }
+
+  mock_spi_init(&spi);
+  EXPECT_EQ(sx127x_create(&spi, &device), SX127X_OK);
+  EXPECT_EQ(sx127x_set_opmod(SX127x_MODE_RX_CONT, SX127x_MODULATION_LORA, &device), SX127X_OK);
+  EXPECT_EQ(sx127x_lora_set_frequency_hopping(5, frequencies, CHANNELS, &device), SX127X_OK);
+  uint32_t overhead = clock_overhead();
+
+  // every hop: RegIrqFlags read and clear, then one 3-byte RegFrf write of the next channel, wrapping around
+  unsigned long transactions = spi.transactions;
+  unsigned long bytes = spi.bytes;
+  for (int i = 0; i < 3 * CHANNELS; i++) {
+    spi.registers[REGIRQFLAGS] = 0x02;
+    sx127x_handle_interrupt(&device);
+    EXPECT_EQ(frf(&spi), expected_frf[i % CHANNELS]);
+    EXPECT_EQ(spi.transactions - transactions, 3);
+    EXPECT_EQ(spi.bytes - bytes, 8);
+    transactions = spi.transactions;
+    bytes = spi.bytes;
+  }
+
+  for (int i = 0; i < WARMUP; i++) {
+    spi.registers[REGIRQFLAGS] = 0x02;
+    sx127x_handle_interrupt(&device);
+  }
+  transactions = spi.transactions;
+  bytes = spi.bytes;
+  for (int i = 0; i < SAMPLES; i++) {
+    spi.registers[REGIRQFLAGS] = 0x02;
+    uint32_t start = now_ns();
+    sx127x_handle_interrupt(&device);
+    samples[i] = now_ns() - start;
+  }
+  printf("hop interrupt: %.2f SPI transactions, %.2f bytes\n", (double) (spi.transactions - transactions) / SAMPLES, (double) (spi.bytes - bytes) / SAMPLES);
+  print_samples("hop interrupt", overhead);
+
+  // for comparison: the RegFrf calculation and write the interrupt used to do on every hop
+  for (int i = 0; i < SAMPLES; i++) {
+    uint32_t start = now_ns();
+    sx127x_set_frequency(frequencies[i % CHANNELS], &device);
+    samples[i] = now_ns() - start;
+  }
+  print_samples("sx127x_set_frequency", overhead);
+
+  printf("bench_fhss: %d failures\n", test_failures);
+  return test_failures == 0 ? 0 : 1;
+}
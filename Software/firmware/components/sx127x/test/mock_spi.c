@@ -0,0 +1,69 @@
+#include "mock_spi.h"
+
+#include <string.h>
+
+#include "sx127x_registers.h"
+#include "sx127x_spi.h"
+
+void mock_spi_init(mock_spi_device *device) {
+  memset(device, 0, sizeof(mock_spi_device));
+  device->registers[REGVERSION] = 0x12;  // SX127x_VERSION is private to sx127x.c
+}
+
+static void mock_spi_count(mock_spi_device *device, size_t data_length) {
+  device->transactions++;
+  device->bytes += 1 + data_length;
+}
+
+int sx127x_spi_read_registers(int reg, void *spi_device, size_t data_length, uint32_t *result) {
+  mock_spi_device *device = (mock_spi_device *) spi_device;
+  if (data_length == 0 || data_length > 4 || reg + data_length > MAX_NUMBER_OF_REGISTERS) {
+    return SX127X_ERR_INVALID_ARG;
+  }
+  uint32_t value = 0;
+  for (size_t i = 0; i < data_length; i++) {
+    value = (value << 8) | device->registers[reg + i];
+  }
+  *result = value;
+  mock_spi_count(device, data_length);
+  return SX127X_OK;
+}
+
+int sx127x_spi_read_buffer(int reg, uint8_t *buffer, size_t buffer_length, void *spi_device) {
+  mock_spi_device *device = (mock_spi_device *) spi_device;
+  if (reg == REGFIFO) {
+    if (buffer_length > sizeof(device->fifo)) {
+      return SX127X_ERR_INVALID_ARG;
+    }
+    memcpy(buffer, device->fifo, buffer_length);
+  } else {
+    if (reg + buffer_length > MAX_NUMBER_OF_REGISTERS) {
+      return SX127X_ERR_INVALID_ARG;
+    }
+    memcpy(buffer, device->registers + reg, buffer_length);
+  }
+  mock_spi_count(device, buffer_length);
+  return SX127X_OK;
+}
+
+int sx127x_spi_write_register(int reg, const uint8_t *data, size_t data_length, void *spi_device) {
+  return sx127x_spi_write_buffer(reg, data, data_length, spi_device);
+}
+
+int sx127x_spi_write_buffer(int reg, const uint8_t *buffer, size_t buffer_length, void *spi_device) {
+  mock_spi_device *device = (mock_spi_device *) spi_device;
+  if (reg == REGFIFO) {
+    if (device->fifo_length + buffer_length > sizeof(device->fifo)) {
+      return SX127X_ERR_INVALID_ARG;
+    }
+    memcpy(device->fifo + device->fifo_length, buffer, buffer_length);
+    device->fifo_length += buffer_length;
+  } else {
+    if (reg + buffer_length > MAX_NUMBER_OF_REGISTERS) {
+      return SX127X_ERR_INVALID_ARG;
+    }
+    memcpy(device->registers + reg, buffer, buffer_length);
+  }
+  mock_spi_count(device, buffer_length);
+  return SX127X_OK;
+}
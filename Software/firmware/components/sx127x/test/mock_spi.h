@@ -0,0 +1,29 @@
+#ifndef mock_spi_h
+#define mock_spi_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sx127x.h"
+
+/**
+ * @brief Emulated sx127x register file behind the sx127x_spi.h interface. Pass a pointer to it as spi_device.
+ * Writes to RegFifo are appended to fifo, reads from RegFifo return it from the start. Every call is counted
+ * as one SPI transaction of 1 address byte plus the data bytes.
+ *
+ */
+typedef struct {
+  uint8_t registers[MAX_NUMBER_OF_REGISTERS];
+  uint8_t fifo[256];
+  size_t fifo_length;
+  unsigned long transactions;
+  unsigned long bytes;
+} mock_spi_device;
+
+/**
+ * @brief Reset registers to zero, except RegVersion, and clear counters.
+ *
+ */
+void mock_spi_init(mock_spi_device *device);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef test_common_h
+#define test_common_h
+
+#include <stdio.h>
+
+// minimal checks for the host tests: report every failure and keep going, main returns the count
+static int test_failures = 0;
+
+#define EXPECT(x)                                                 \
+  do {                                                            \
+    if (!(x)) {                                                   \
+      printf("%s:%d: expected %s\n", __FILE__, __LINE__, #x);     \
+      test_failures++;                                            \
+    }                                                             \
+  } while (0)
+
+#define EXPECT_EQ(a, b)                                                                                                  \
+  do {                                                                                                                   \
+    long long a_ = (long long) (a);                                                                                      \
+    long long b_ = (long long) (b);                                                                                      \
+    if (a_ != b_) {                                                                                                      \
+      printf("%s:%d: expected %s == %s, got %lld and %lld\n", __FILE__, __LINE__, #a, #b, a_, b_);                        \
+      test_failures++;                                                                                                   \
+    }                                                                                                                    \
+  } while (0)
+
+#endif
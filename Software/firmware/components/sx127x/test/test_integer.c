@@ -0,0 +1,346 @@
+// Host check of the integer register math against the float code it replaced (sx127x 4.0.1) and against the
+// exact value. Every valid input is swept through the public API and read back from the emulated registers.
+// The integer result must always be exact. Differences from float are counted, and bounded where float was close.
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mock_spi.h"
+#include "sx127x_registers.h"
+#include "test_common.h"
+
+// not in the public header, used by the bandwidth setters
+uint8_t sx127x_fsk_ook_calculate_bw_register(uint32_t bandwidth);
+
+// float code of sx127x 4.0.1, verbatim apart from the function wrappers
+#define SX127x_OSCILLATOR_FREQUENCY 32000000.0f
+#define SX127x_FREQ_ERROR_FACTOR ((1 << 24) / SX127x_OSCILLATOR_FREQUENCY)
+#define SX127x_FSTEP (SX127x_OSCILLATOR_FREQUENCY / (1 << 19))
+
+static uint32_t float_fsk_bitrate(float bitrate) {
+  return (uint32_t) (SX127x_OSCILLATOR_FREQUENCY * 16.0 / bitrate);
+}
+
+static uint16_t float_ook_bitrate(float bitrate) {
+  return (uint16_t) (SX127x_OSCILLATOR_FREQUENCY / bitrate);
+}
+
+static uint16_t float_fdev(float frequency_deviation) {
+  return (uint16_t) (frequency_deviation / SX127x_FSTEP);
+}
+
+static uint8_t float_bw_register(float bandwidth) {
+  float min_tolerance = bandwidth;
+  uint8_t result = 0;
+  for (uint8_t e = 7; e >= 1; e--) {
+    for (int8_t m = 2; m >= 0; m--) {
+      float point = SX127x_OSCILLATOR_FREQUENCY / (float) (((4 * m) + 16) * ((uint32_t) 1 << (e + 2)));
+      float current_tolerance = fabsf(bandwidth - point);
+      if (current_tolerance < min_tolerance) {
+        result = ((m << 3) | e);
+        min_tolerance = current_tolerance;
+      }
+    }
+  }
+  return result;
+}
+
+static uint32_t float_frf(uint64_t frequency) {
+  uint64_t adjusted = (frequency << 19) / SX127x_OSCILLATOR_FREQUENCY;
+  return (uint32_t) adjusted;
+}
+
+static uint64_t float_frequency(uint32_t frequency_raw) {
+  return (uint64_t) (frequency_raw * SX127x_OSCILLATOR_FREQUENCY) >> 19;
+}
+
+static int32_t float_lora_frequency_error(uint32_t frequency_error, uint32_t bandwidth) {
+  int32_t result;
+  if (frequency_error & 0x80000) {
+    frequency_error = ((~frequency_error) + 1) & 0xFFFFF;
+    result = -1;
+  } else {
+    result = 1;
+  }
+  result = result * (frequency_error * SX127x_FREQ_ERROR_FACTOR * bandwidth / 500000.0f);
+  return result;
+}
+
+static int32_t float_fsk_frequency_error(uint32_t frequency_error) {
+  int32_t result;
+  if (frequency_error & 0x8000) {
+    frequency_error = ((~frequency_error) + 1) & 0xFFFF;
+    result = -1;
+  } else {
+    result = 1;
+  }
+  result = result * SX127x_FSTEP * frequency_error;
+  return result;
+}
+
+// 4.0.1 cast the negative float straight to uint8_t, which is undefined. This is what the compiler emitted
+static uint8_t float_ppm(int32_t frequency_error, uint64_t frequency) {
+  return (uint8_t) (int32_t) (0.95f * ((float) frequency_error / (frequency / 1E6f)));
+}
+
+// one sweep: how many inputs, how many differ from float, largest difference
+typedef struct {
+  const char *name;
+  unsigned long checked;
+  unsigned long float_differs;
+  long long max_difference;
+} sweep;
+
+static void sweep_add(sweep *s, long long integer, long long exact, long long from_float, long long arg) {
+  s->checked++;
+  if (integer != exact) {
+    test_failures++;
+    if (test_failures < 10) {
+      printf("%s: %lld gives %lld, exact %lld\n", s->name, arg, integer, exact);
+    }
+  }
+  if (integer != from_float) {
+    long long difference = llabs(integer - from_float);
+    s->float_differs++;
+    if (difference > s->max_difference) {
+      s->max_difference = difference;
+    }
+  }
+}
+
+static void sweep_print(const sweep *s) {
+  printf("%-22s %9lu inputs, %6lu differ from float, max %lld LSB\n", s->name, s->checked, s->float_differs, s->max_difference);
+}
+
+static mock_spi_device spi;
+static sx127x device;
+
+static uint32_t read_registers(int reg, int count) {
+  uint32_t result = 0;
+  for (int i = 0; i < count; i++) {
+    result = (result << 8) | spi.registers[reg + i];
+  }
+  return result;
+}
+
+static void write_registers(int reg, int count, uint32_t value) {
+  for (int i = count - 1; i >= 0; i--) {
+    spi.registers[reg + i] = (uint8_t) value;
+    value >>= 8;
+  }
+}
+
+static void modulation(sx127x_modulation_t value) {
+  EXPECT_EQ(sx127x_set_opmod(SX127x_MODE_SLEEP, value, &device), SX127X_OK);
+}
+
+static void test_bitrate(void) {
+  sweep fsk = {.name = "FSK bitrate"}, ook = {.name = "OOK bitrate"};
+  modulation(SX127x_MODULATION_FSK);
+  for (uint32_t bitrate = 1200; bitrate <= 300000; bitrate++) {
+    EXPECT_EQ(sx127x_fsk_ook_set_bitrate_bps(bitrate, &device), SX127X_OK);
+    uint32_t value = (read_registers(REGBITRATEMSB, 2) << 4) | spi.registers[REGBITRATEFRAC];
+    sweep_add(&fsk, value, (32000000ULL * 16) / bitrate, float_fsk_bitrate((float) bitrate), bitrate);
+  }
+  modulation(SX127x_MODULATION_OOK);
+  for (uint32_t bitrate = 1200; bitrate <= 25000; bitrate++) {
+    EXPECT_EQ(sx127x_fsk_ook_set_bitrate_bps(bitrate, &device), SX127X_OK);
+    EXPECT_EQ(spi.registers[REGBITRATEFRAC], 0);
+    sweep_add(&ook, read_registers(REGBITRATEMSB, 2), 32000000 / bitrate, float_ook_bitrate((float) bitrate), bitrate);
+  }
+  EXPECT_EQ(sx127x_fsk_ook_set_bitrate_bps(25001, &device), SX127X_ERR_INVALID_ARG);
+  sweep_print(&fsk);
+  sweep_print(&ook);
+  EXPECT_EQ(fsk.float_differs, 0);
+  EXPECT_EQ(ook.float_differs, 0);
+  EXPECT_EQ(SX127X_FSK_BITRATE_4800, (32000000 * 16) / 4800);
+}
+
+static void test_fdev(void) {
+  sweep fdev = {.name = "Fdev"};
+  modulation(SX127x_MODULATION_FSK);
+  for (uint32_t hz = 600; hz <= 200000; hz++) {
+    EXPECT_EQ(sx127x_fsk_set_fdev_hz(hz, &device), SX127X_OK);
+    sweep_add(&fdev, read_registers(REGFDEVMSB, 2), ((uint64_t) hz << 19) / 32000000, float_fdev((float) hz), hz);
+  }
+  sweep_print(&fdev);
+  EXPECT(fdev.max_difference <= 1);
+  // 128479 * 2^19 / 32 MHz = 2104.9...: float rounds the quotient to 2105 before truncating
+  EXPECT_EQ(sx127x_fsk_set_fdev_hz(128479, &device), SX127X_OK);
+  EXPECT_EQ(read_registers(REGFDEVMSB, 2), 2104);
+  EXPECT_EQ(float_fdev(128479.0f), 2105);
+}
+
+static void test_bw_register(void) {
+  sweep bw = {.name = "RxBw register"};
+  for (uint32_t hz = 0; hz <= 600000; hz++) {
+    // the nearest FXOSC / divisor, in exact rational arithmetic
+    long double min_tolerance = hz;
+    uint8_t exact = 0;
+    for (int e = 7; e >= 1; e--) {
+      for (int m = 2; m >= 0; m--) {
+        long double tolerance = fabsl((long double) hz - 32000000.0L / (((4 * m) + 16) << (e + 2)));
+        if (tolerance < min_tolerance) {
+          exact = (uint8_t) ((m << 3) | e);
+          min_tolerance = tolerance;
+        }
+      }
+    }
+    sweep_add(&bw, sx127x_fsk_ook_calculate_bw_register(hz), exact, float_bw_register((float) hz), hz);
+  }
+  sweep_print(&bw);
+  EXPECT_EQ(bw.float_differs, 0);
+  // presets are the rounded bandwidths of the datasheet table
+  EXPECT_EQ(sx127x_fsk_ook_calculate_bw_register(2600), SX127X_FSK_OOK_BW_2600);
+  EXPECT_EQ(sx127x_fsk_ook_calculate_bw_register(10400), SX127X_FSK_OOK_BW_10400);
+  EXPECT_EQ(sx127x_fsk_ook_calculate_bw_register(31300), SX127X_FSK_OOK_BW_31300);
+  EXPECT_EQ(sx127x_fsk_ook_calculate_bw_register(166700), SX127X_FSK_OOK_BW_166700);
+  EXPECT_EQ(sx127x_fsk_ook_calculate_bw_register(250000), SX127X_FSK_OOK_BW_250000);
+}
+
+static void test_frequency_error(void) {
+  static const uint8_t bandwidths[] = {SX127x_BW_7800, SX127x_BW_10400, SX127x_BW_15600, SX127x_BW_20800, SX127x_BW_31250, SX127x_BW_41700, SX127x_BW_62500, SX127x_BW_125000, SX127x_BW_250000, SX127x_BW_500000};
+  static const uint32_t bandwidths_hz[] = {7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000};
+  sweep lora = {.name = "LoRa frequency error"}, fsk = {.name = "FSK frequency error"};
+  int32_t result;
+  modulation(SX127x_MODULATION_LORA);
+  for (size_t b = 0; b < sizeof(bandwidths); b++) {
+    spi.registers[REGMODEMCONFIG1] = bandwidths[b];
+    for (uint32_t raw = 0; raw < (1 << 20); raw++) {
+      write_registers(REGFEIMSB, 3, raw);
+      EXPECT_EQ(sx127x_rx_get_frequency_error(&device, &result), SX127X_OK);
+      // FEI * 2^24 / FXOSC * BW / 500 kHz, truncated towards zero
+      int64_t fei = (raw & 0x80000) ? (int64_t) raw - (1 << 20) : (int64_t) raw;
+      long double exact = (long double) llabs(fei) * 16777216.0L / 32000000.0L * bandwidths_hz[b] / 500000.0L;
+      sweep_add(&lora, result, (fei < 0 ? -1 : 1) * (int64_t) exact, float_lora_frequency_error(raw, bandwidths_hz[b]), raw);
+    }
+  }
+  modulation(SX127x_MODULATION_FSK);
+  for (uint32_t raw = 0; raw < (1 << 16); raw++) {
+    write_registers(REGAFCMSB, 2, raw);
+    EXPECT_EQ(sx127x_rx_get_frequency_error(&device, &result), SX127X_OK);
+    int64_t afc = (raw & 0x8000) ? (int64_t) raw - (1 << 16) : (int64_t) raw;
+    int64_t exact = (afc < 0 ? -1 : 1) * ((llabs(afc) * 32000000) >> 19);
+    sweep_add(&fsk, result, exact, float_fsk_frequency_error(raw), raw);
+  }
+  sweep_print(&lora);
+  sweep_print(&fsk);
+  EXPECT(lora.max_difference <= 1);
+  EXPECT(fsk.max_difference <= 1);
+  // 18013 * 0.131072 = 2360.99...: float rounds to 2361 before truncating
+  modulation(SX127x_MODULATION_LORA);
+  spi.registers[REGMODEMCONFIG1] = SX127x_BW_125000;
+  write_registers(REGFEIMSB, 3, 18013);
+  EXPECT_EQ(sx127x_rx_get_frequency_error(&device, &result), SX127X_OK);
+  EXPECT_EQ(result, 2360);
+  EXPECT_EQ(float_lora_frequency_error(18013, 125000), 2361);
+  write_registers(REGFEIMSB, 3, (1 << 20) - 18013);
+  EXPECT_EQ(sx127x_rx_get_frequency_error(&device, &result), SX127X_OK);
+  EXPECT_EQ(result, -2360);
+  // 1223 * 61.03515625 = 74645.99...
+  modulation(SX127x_MODULATION_FSK);
+  write_registers(REGAFCMSB, 2, 1223);
+  EXPECT_EQ(sx127x_rx_get_frequency_error(&device, &result), SX127X_OK);
+  EXPECT_EQ(result, 74645);
+  EXPECT_EQ(float_fsk_frequency_error(1223), 74646);
+}
+
+static void test_frequency(void) {
+  sweep frf = {.name = "Frf from frequency"}, frequency = {.name = "frequency from Frf"};
+  uint64_t hz;
+  for (hz = 137000000; hz <= 1020000000; hz += 997) {
+    EXPECT_EQ(sx127x_set_frequency(hz, &device), SX127X_OK);
+    sweep_add(&frf, read_registers(REGFRFMSB, 3), (hz << 19) / 32000000, float_frf(hz), (long long) hz);
+  }
+  for (uint32_t raw = 0; raw < (1 << 24); raw++) {
+    write_registers(REGFRFMSB, 3, raw);
+    EXPECT_EQ(sx127x_get_frequency(&device, &hz), SX127X_OK);
+    sweep_add(&frequency, (long long) hz, ((uint64_t) raw * 32000000) >> 19, (long long) float_frequency(raw), raw);
+  }
+  sweep_print(&frf);
+  sweep_print(&frequency);
+  // f << 19 is rounded to 24 bits when converted to float, before the division: up to 2 LSB off
+  EXPECT(frf.max_difference <= 2);
+  // 137055832 * 2^19 / 32 MHz = 2245522.9...: float rounds up to 2245523
+  EXPECT_EQ(sx127x_set_frequency(137055832, &device), SX127X_OK);
+  EXPECT_EQ(read_registers(REGFRFMSB, 3), 2245522);
+  EXPECT_EQ(float_frf(137055832), 2245523);
+  // float only has 24 bits: the old get_frequency was off by up to 32 Hz
+  write_registers(REGFRFMSB, 3, 0xFFFFFF);
+  EXPECT_EQ(sx127x_get_frequency(&device, &hz), SX127X_OK);
+  EXPECT_EQ(hz, 1023999938);
+  EXPECT(frequency.max_difference <= 32);
+}
+
+static void test_ppm(void) {
+  static const uint64_t frequencies[] = {433000000, 868000000, 928000000};
+  sweep ppm = {.name = "ppm correction"};
+  modulation(SX127x_MODULATION_LORA);
+  for (size_t f = 0; f < sizeof(frequencies) / sizeof(frequencies[0]); f++) {
+    uint64_t actual;
+    EXPECT_EQ(sx127x_set_frequency(frequencies[f], &device), SX127X_OK);
+    EXPECT_EQ(sx127x_get_frequency(&device, &actual), SX127X_OK);
+    for (int32_t error = -60000; error <= 60000; error++) {
+      EXPECT_EQ(sx127x_lora_set_ppm_offset(error, &device), SX127X_OK);
+      int64_t exact = ((int64_t) error * 950000) / (int64_t) actual;
+      sweep_add(&ppm, spi.registers[0x27], (uint8_t) exact, float_ppm(error, actual), error);
+    }
+  }
+  sweep_print(&ppm);
+  EXPECT_EQ(ppm.float_differs, 0);
+}
+
+// there was no time on air before: the reference is the AN1200.13 formula in double
+static void test_time_on_air(void) {
+  static const uint32_t bandwidths_hz[] = {7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000};
+  sweep toa = {.name = "time on air"};
+  modulation(SX127x_MODULATION_LORA);
+  for (int b = 0; b < 10; b++) {
+    for (int sf = 6; sf <= 12; sf++) {
+      for (int cr = 1; cr <= 4; cr++) {
+        for (int flags = 0; flags < 8; flags++) {
+          for (int preamble = 6; preamble <= 6000; preamble = preamble * 3 + 2) {
+            for (int length = 0; length <= 255; length++) {
+              int ih = flags & 1, crc = (flags >> 1) & 1, de = (flags >> 2) & 1;
+              spi.registers[REGMODEMCONFIG1] = (uint8_t) ((b << 4) | (cr << 1) | ih);
+              spi.registers[REGMODEMCONFIG2] = (uint8_t) ((sf << 4) | (crc << 2));
+              spi.registers[REGMODEMCONFIG3] = (uint8_t) (de << 3);
+              write_registers(REGPREAMBLEMSB, 2, preamble);
+              uint32_t result;
+              EXPECT_EQ(sx127x_lora_get_time_on_air((uint8_t) length, &device, &result), SX127X_OK);
+              double symbol = (double) (1 << sf) / bandwidths_hz[b];
+              double payload = 8 + fmax(ceil((8.0 * length - 4 * sf + 28 + 16 * crc - 20 * ih) / (4.0 * (sf - 2 * de))) * (cr + 4), 0);
+              uint32_t expected = (uint32_t) floor(((preamble + 4.25) + payload) * symbol * 1e6 + 1e-6);
+              sweep_add(&toa, result, expected, expected, length);
+            }
+          }
+        }
+      }
+    }
+  }
+  sweep_print(&toa);
+  // 10 bytes, SF7, 125 kHz, CR 4/5, CRC, explicit header, 8 symbols preamble: 41.216 ms
+  spi.registers[REGMODEMCONFIG1] = SX127x_BW_125000 | (1 << 1);
+  spi.registers[REGMODEMCONFIG2] = (7 << 4) | (1 << 2);
+  spi.registers[REGMODEMCONFIG3] = 0;
+  write_registers(REGPREAMBLEMSB, 2, 8);
+  uint32_t result;
+  EXPECT_EQ(sx127x_lora_get_time_on_air(10, &device, &result), SX127X_OK);
+  EXPECT_EQ(result, 41216);
+}
+
+int main(void) {
+  mock_spi_init(&spi);
+  EXPECT_EQ(sx127x_create(&spi, &device), SX127X_OK);
+  test_bitrate();
+  test_fdev();
+  test_bw_register();
+  test_frequency_error();
+  test_frequency();
+  test_ppm();
+  test_time_on_air();
+  printf("test_integer: %d failures\n", test_failures);
+  return test_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,320 @@
+// Host test of sx127x_scheduler driven by a virtual clock: the clock jumps straight to every wakeup time
+// returned by sx127x_scheduler_run, so hours of schedule run in milliseconds and every result is exact.
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mock_spi.h"
+#include "sx127x_registers.h"
+#include "sx127x_scheduler.h"
+#include "test_common.h"
+
+#define MAX_EVENTS 4096
+
+typedef struct {
+  char kind;  // 'P' prepare, 'T' transmit
+  int id;
+  uint64_t at_ms;
+} event_t;
+
+typedef struct {
+  sx127x_scheduler_job job;
+  int id;
+  int prepare_code;
+  uint64_t last_transmit_ms;
+  uint32_t transmissions;
+} test_job;
+
+static uint64_t clock_ms;
+static event_t events[MAX_EVENTS];
+static size_t events_length;
+
+static void record(char kind, const sx127x_scheduler_job *job) {
+  if (events_length < MAX_EVENTS) {
+    events[events_length].kind = kind;
+    events[events_length].id = ((const test_job *) job->ctx)->id;
+    events[events_length].at_ms = clock_ms;
+    events_length++;
+  }
+}
+
+static int test_prepare(sx127x_scheduler_job *job) {
+  record('P', job);
+  return ((test_job *) job->ctx)->prepare_code;
+}
+
+static int test_transmit(sx127x_scheduler_job *job) {
+  test_job *test = (test_job *) job->ctx;
+  record('T', job);
+  test->last_transmit_ms = clock_ms;
+  test->transmissions++;
+  return SX127X_OK;
+}
+
+static void job_init(test_job *test, int id, sx127x *device, uint64_t deadline_ms, uint32_t period_ms, uint32_t airtime_ms) {
+  memset(test, 0, sizeof(test_job));
+  test->id = id;
+  test->job.device = device;
+  test->job.deadline_ms = deadline_ms;
+  test->job.period_ms = period_ms;
+  test->job.airtime_ms = airtime_ms;
+  test->job.prepare = test_prepare;
+  test->job.transmit = test_transmit;
+  test->job.ctx = test;
+}
+
+static void reset(sx127x_scheduler *scheduler, uint32_t prepare_ahead_ms) {
+  clock_ms = 0;
+  events_length = 0;
+  EXPECT_EQ(sx127x_scheduler_create(prepare_ahead_ms, scheduler), SX127X_OK);
+}
+
+// run every event up to and including until_ms, as an ideal timer would
+static void advance(sx127x_scheduler *scheduler, uint64_t until_ms) {
+  uint64_t next_ms;
+  EXPECT_EQ(sx127x_scheduler_run(clock_ms, scheduler, &next_ms), SX127X_OK);
+  while (next_ms <= until_ms) {
+    EXPECT(next_ms >= clock_ms);
+    clock_ms = next_ms;
+    EXPECT_EQ(sx127x_scheduler_run(clock_ms, scheduler, &next_ms), SX127X_OK);
+  }
+  clock_ms = until_ms;
+}
+
+static int has_event(char kind, int id, uint64_t at_ms) {
+  for (size_t i = 0; i < events_length; i++) {
+    if (events[i].kind == kind && events[i].id == id && events[i].at_ms == at_ms) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void test_two_devices(void) {
+  sx127x a, b;
+  sx127x_scheduler scheduler;
+  test_job beacon, heartbeat, report;
+  reset(&scheduler, 10);
+  job_init(&beacon, 1, &a, 100, 1000, 50);
+  job_init(&heartbeat, 2, &a, 120, 2000, 30);
+  job_init(&report, 3, &b, 100, 0, 500);
+  EXPECT_EQ(sx127x_scheduler_add(&beacon.job, &scheduler), SX127X_OK);
+  EXPECT_EQ(sx127x_scheduler_add(&heartbeat.job, &scheduler), SX127X_OK);
+  EXPECT_EQ(sx127x_scheduler_add(&report.job, &scheduler), SX127X_OK);
+  advance(&scheduler, 2200);
+
+  // both devices prepare ahead and transmit on time, independently
+  EXPECT(has_event('P', 1, 90));
+  EXPECT(has_event('T', 1, 100));
+  EXPECT(has_event('P', 3, 90));
+  EXPECT(has_event('T', 3, 100));
+  // device a is busy with the beacon until 150: the heartbeat is written and sent right after
+  EXPECT(has_event('P', 2, 150));
+  EXPECT(has_event('T', 2, 150));
+  EXPECT(has_event('P', 1, 1090));
+  EXPECT(has_event('T', 1, 1100));
+  EXPECT(has_event('P', 1, 2090));
+  EXPECT(has_event('T', 1, 2100));
+  // the periods keep their phase: the beacon is on the air again at 2120
+  EXPECT(has_event('P', 2, 2150));
+  EXPECT(has_event('T', 2, 2150));
+  EXPECT_EQ(events_length, 12);
+  // one-shot report is gone, periodic jobs stay
+  EXPECT_EQ(scheduler.heap_length, 2);
+  EXPECT_EQ(beacon.job.missed, 0);
+  EXPECT_EQ(heartbeat.job.missed, 0);
+}
+
+static void test_fifo_owner_first(void) {
+  sx127x a;
+  sx127x_scheduler scheduler;
+  test_job first, second;
+  reset(&scheduler, 10);
+  job_init(&first, 1, &a, 100, 0, 5);
+  job_init(&second, 2, &a, 101, 0, 5);
+  EXPECT_EQ(sx127x_scheduler_add(&second.job, &scheduler), SX127X_OK);
+  EXPECT_EQ(sx127x_scheduler_add(&first.job, &scheduler), SX127X_OK);
+  advance(&scheduler, 1000);
+  // the FIFO holds the first packet until it is sent; the second waits for the airtime
+  EXPECT(has_event('P', 1, 90));
+  EXPECT(has_event('T', 1, 100));
+  EXPECT(has_event('P', 2, 105));
+  EXPECT(has_event('T', 2, 105));
+  EXPECT_EQ(events_length, 4);
+  EXPECT(events[0].id == 1 && events[1].id == 1);
+}
+
+static void test_late_poll(void) {
+  sx127x a;
+  sx127x_scheduler scheduler;
+  test_job job;
+  uint64_t next_ms;
+  reset(&scheduler, 10);
+  job_init(&job, 1, &a, 100, 100, 10);
+  EXPECT_EQ(sx127x_scheduler_add(&job.job, &scheduler), SX127X_OK);
+  advance(&scheduler, 90);
+  EXPECT(has_event('P', 1, 90));
+  // the caller wakes up 455 ms late: one transmission, missed periods are skipped and counted
+  clock_ms = 555;
+  EXPECT_EQ(sx127x_scheduler_run(clock_ms, &scheduler, &next_ms), SX127X_OK);
+  EXPECT(has_event('T', 1, 555));
+  EXPECT_EQ(job.transmissions, 1);
+  EXPECT_EQ(job.job.missed, 4);
+  EXPECT_EQ(job.job.deadline_ms, 600);
+  EXPECT_EQ(next_ms, 590);
+}
+
+static void test_prepare_failure(void) {
+  sx127x a;
+  sx127x_scheduler scheduler;
+  test_job job;
+  uint64_t next_ms;
+  reset(&scheduler, 10);
+  job_init(&job, 1, &a, 100, 0, 10);
+  job.prepare_code = SX127X_ERR_INVALID_STATE;
+  EXPECT_EQ(sx127x_scheduler_add(&job.job, &scheduler), SX127X_OK);
+  clock_ms = 90;
+  EXPECT_EQ(sx127x_scheduler_run(clock_ms, &scheduler, &next_ms), SX127X_OK);
+  EXPECT_EQ(job.job.last_code, SX127X_ERR_INVALID_STATE);
+  EXPECT_EQ(job.transmissions, 0);
+  EXPECT_EQ(scheduler.heap_length, 0);
+  EXPECT(next_ms == UINT64_MAX);
+  EXPECT_EQ(scheduler.devices[0].prepared_job == NULL, 1);
+}
+
+static void test_remove_prepared(void) {
+  sx127x a;
+  sx127x_scheduler scheduler;
+  test_job cancelled, next;
+  reset(&scheduler, 10);
+  job_init(&cancelled, 1, &a, 100, 0, 10);
+  job_init(&next, 2, &a, 96, 0, 10);
+  EXPECT_EQ(sx127x_scheduler_add(&cancelled.job, &scheduler), SX127X_OK);
+  advance(&scheduler, 95);
+  EXPECT(has_event('P', 1, 90));
+  EXPECT_EQ(sx127x_scheduler_remove(&cancelled.job, &scheduler), SX127X_OK);
+  EXPECT_EQ(sx127x_scheduler_remove(&cancelled.job, &scheduler), SX127X_ERR_NOT_FOUND);
+  // the FIFO is free again
+  EXPECT_EQ(sx127x_scheduler_add(&next.job, &scheduler), SX127X_OK);
+  advance(&scheduler, 200);
+  EXPECT(has_event('P', 2, 95));
+  EXPECT(has_event('T', 2, 96));
+  EXPECT_EQ(cancelled.transmissions, 0);
+}
+
+static void test_limits(void) {
+  sx127x devices[CONFIG_SX127X_SCHEDULER_MAX_DEVICES + 1];
+  sx127x_scheduler scheduler;
+  static test_job jobs[CONFIG_SX127X_SCHEDULER_MAX_JOBS + 1];
+  reset(&scheduler, 10);
+  EXPECT_EQ(sx127x_scheduler_create(10, NULL), SX127X_ERR_INVALID_ARG);
+  EXPECT_EQ(sx127x_scheduler_add(NULL, &scheduler), SX127X_ERR_INVALID_ARG);
+  EXPECT_EQ(sx127x_scheduler_run(0, NULL, NULL), SX127X_ERR_INVALID_ARG);
+  job_init(&jobs[0], 0, NULL, 100, 0, 10);
+  EXPECT_EQ(sx127x_scheduler_add(&jobs[0].job, &scheduler), SX127X_ERR_INVALID_ARG);
+
+  for (int i = 0; i < CONFIG_SX127X_SCHEDULER_MAX_DEVICES; i++) {
+    job_init(&jobs[i], i, &devices[i], 100 + i, 0, 10);
+    EXPECT_EQ(sx127x_scheduler_add(&jobs[i].job, &scheduler), SX127X_OK);
+  }
+  EXPECT_EQ(sx127x_scheduler_add(&jobs[0].job, &scheduler), SX127X_ERR_INVALID_STATE);
+  job_init(&jobs[CONFIG_SX127X_SCHEDULER_MAX_DEVICES], 99, &devices[CONFIG_SX127X_SCHEDULER_MAX_DEVICES], 100, 0, 10);
+  EXPECT_EQ(sx127x_scheduler_add(&jobs[CONFIG_SX127X_SCHEDULER_MAX_DEVICES].job, &scheduler), SX127X_ERR_NOT_FOUND);
+
+  for (int i = CONFIG_SX127X_SCHEDULER_MAX_DEVICES; i < CONFIG_SX127X_SCHEDULER_MAX_JOBS; i++) {
+    job_init(&jobs[i], i, &devices[0], 200 + i, 0, 10);
+    EXPECT_EQ(sx127x_scheduler_add(&jobs[i].job, &scheduler), SX127X_OK);
+  }
+  job_init(&jobs[CONFIG_SX127X_SCHEDULER_MAX_JOBS], 99, &devices[0], 100, 0, 10);
+  EXPECT_EQ(sx127x_scheduler_add(&jobs[CONFIG_SX127X_SCHEDULER_MAX_JOBS].job, &scheduler), SX127X_ERR_NOT_FOUND);
+}
+
+// default transmit switches the real driver into TX
+static void test_default_transmit(void) {
+  mock_spi_device spi;
+  sx127x device;
+  sx127x_scheduler scheduler;
+  test_job job;
+  mock_spi_init(&spi);
+  EXPECT_EQ(sx127x_create(&spi, &device), SX127X_OK);
+  reset(&scheduler, 10);
+  job_init(&job, 1, &device, 100, 0, 10);
+  job.job.transmit = NULL;
+  EXPECT_EQ(sx127x_scheduler_add(&job.job, &scheduler), SX127X_OK);
+  advance(&scheduler, 99);
+  EXPECT((spi.registers[REGOPMODE] & 0b111) != SX127x_MODE_TX);
+  advance(&scheduler, 100);
+  EXPECT_EQ(job.job.last_code, SX127X_OK);
+  EXPECT_EQ(spi.registers[REGOPMODE] & 0b111, SX127x_MODE_TX);
+}
+
+static uint32_t random_state = 12345;
+
+static uint32_t random_next(uint32_t max) {
+  random_state = random_state * 1103515245u + 12345u;
+  return (random_state >> 8) % max;
+}
+
+// random jobs on every device: nothing is sent early, airtimes on a device never overlap and every period is
+// either sent or counted as missed
+static void test_random_schedule(void) {
+  sx127x devices[CONFIG_SX127X_SCHEDULER_MAX_DEVICES];
+  sx127x_scheduler scheduler;
+  static test_job jobs[CONFIG_SX127X_SCHEDULER_MAX_JOBS];
+  const uint64_t end_ms = 3600 * 1000;
+  for (int round = 0; round < 20; round++) {
+    reset(&scheduler, 1 + random_next(20));
+    for (int i = 0; i < CONFIG_SX127X_SCHEDULER_MAX_JOBS; i++) {
+      uint32_t period = (random_next(4) == 0 ? 0 : 200 + random_next(5000));
+      job_init(&jobs[i], i, &devices[random_next(CONFIG_SX127X_SCHEDULER_MAX_DEVICES)], random_next(5000), period, 1 + random_next(150));
+      EXPECT_EQ(sx127x_scheduler_add(&jobs[i].job, &scheduler), SX127X_OK);
+    }
+    uint64_t first_deadline[CONFIG_SX127X_SCHEDULER_MAX_JOBS];
+    uint64_t deadline[CONFIG_SX127X_SCHEDULER_MAX_JOBS];
+    for (int i = 0; i < CONFIG_SX127X_SCHEDULER_MAX_JOBS; i++) {
+      first_deadline[i] = deadline[i] = jobs[i].job.deadline_ms;
+    }
+    uint64_t busy_until[CONFIG_SX127X_SCHEDULER_MAX_DEVICES] = {0};
+
+    uint64_t next_ms;
+    EXPECT_EQ(sx127x_scheduler_run(clock_ms, &scheduler, &next_ms), SX127X_OK);
+    while (next_ms <= end_ms) {
+      clock_ms = next_ms;
+      events_length = 0;
+      EXPECT_EQ(sx127x_scheduler_run(clock_ms, &scheduler, &next_ms), SX127X_OK);
+      for (size_t e = 0; e < events_length; e++) {
+        test_job *job = &jobs[events[e].id];
+        int device = (int) (job->job.device - devices);
+        if (events[e].kind == 'P') {
+          EXPECT(clock_ms + scheduler.prepare_ahead_ms >= deadline[events[e].id]);
+          continue;
+        }
+        EXPECT(clock_ms >= deadline[events[e].id]);
+        EXPECT(clock_ms >= busy_until[device]);
+        busy_until[device] = clock_ms + job->job.airtime_ms;
+        deadline[events[e].id] = job->job.deadline_ms;
+      }
+    }
+    for (int i = 0; i < CONFIG_SX127X_SCHEDULER_MAX_JOBS; i++) {
+      if (jobs[i].job.period_ms == 0) {
+        EXPECT_EQ(jobs[i].transmissions, 1);
+        continue;
+      }
+      uint64_t periods = (jobs[i].job.deadline_ms - first_deadline[i]) / jobs[i].job.period_ms;
+      EXPECT_EQ(jobs[i].transmissions + jobs[i].job.missed, periods);
+    }
+  }
+}
+
+int main(void) {
+  test_two_devices();
+  test_fifo_owner_first();
+  test_late_poll();
+  test_prepare_failure();
+  test_remove_prepared();
+  test_limits();
+  test_default_transmit();
+  test_random_schedule();
+  printf("test_scheduler: %d failures\n", test_failures);
+  return test_failures == 0 ? 0 : 1;
+}